@@ -205,6 +205,10 @@ enum
 #define SUPPORTED_CLOCK_FORMATS (GST_MPD_UTCTIMING_TYPE_NTP | GST_MPD_UTCTIMING_TYPE_HTTP_HEAD | GST_MPD_UTCTIMING_TYPE_HTTP_XSDATE | GST_MPD_UTCTIMING_TYPE_HTTP_ISO | GST_MPD_UTCTIMING_TYPE_HTTP_NTP)
 #define NTP_TO_UNIX_EPOCH G_GUINT64_CONSTANT(2208988800)        /* difference (in seconds) between NTP epoch and Unix epoch */
 
+/* Initial size of the first range requested for a subsegment in key unit
+ * trick modes, it is then adjusted to the size of the last key frame */
+#define DEFAULT_KEYFRAME_SIZE_GUESS (16 * 1024)
+
 struct _GstDashDemuxClockDrift
 {
   GMutex clock_lock;            /* used to protect access to struct */
@@ -232,6 +236,9 @@ static gboolean gst_dash_demux_process_manifest (GstAdaptiveDemux * ademux,
 static gboolean gst_dash_demux_seek (GstAdaptiveDemux * demux, GstEvent * seek);
 static GstFlowReturn
 gst_dash_demux_stream_update_fragment_info (GstAdaptiveDemuxStream * stream);
+static GstFlowReturn
+gst_dash_demux_stream_peek_fragment_info (GstAdaptiveDemuxStream * stream,
+    guint n, GstAdaptiveDemuxStreamFragment * fragment);
 static GstFlowReturn gst_dash_demux_stream_seek (GstAdaptiveDemuxStream *
     stream, gboolean forward, GstSeekFlags flags, GstClockTime ts,
     GstClockTime * final_ts);
@@ -241,6 +248,8 @@ static GstFlowReturn
 gst_dash_demux_stream_advance_fragment (GstAdaptiveDemuxStream * stream);
 static gboolean
 gst_dash_demux_stream_advance_subfragment (GstAdaptiveDemuxStream * stream);
+static GArray *gst_dash_demux_stream_get_bitrates (GstAdaptiveDemuxStream *
+    stream);
 static gboolean gst_dash_demux_stream_select_bitrate (GstAdaptiveDemuxStream *
     stream, guint64 bitrate);
 static gint64 gst_dash_demux_get_manifest_update_interval (GstAdaptiveDemux *
@@ -429,8 +438,12 @@ gst_dash_demux_class_init (GstDashDemuxClass * klass)
   gstadaptivedemux_class->stream_seek = gst_dash_demux_stream_seek;
   gstadaptivedemux_class->stream_select_bitrate =
       gst_dash_demux_stream_select_bitrate;
+  gstadaptivedemux_class->stream_get_bitrates =
+      gst_dash_demux_stream_get_bitrates;
   gstadaptivedemux_class->stream_update_fragment_info =
       gst_dash_demux_stream_update_fragment_info;
+  gstadaptivedemux_class->stream_peek_fragment_info =
+      gst_dash_demux_stream_peek_fragment_info;
   gstadaptivedemux_class->stream_free = gst_dash_demux_stream_free;
   gstadaptivedemux_class->get_live_seek_range =
       gst_dash_demux_get_live_seek_range;
@@ -616,6 +629,8 @@ gst_dash_demux_setup_all_streams (GstDashDemux * demux)
     }
 
     gst_isoff_sidx_parser_init (&stream->sidx_parser);
+    stream->keyframe_adapter = gst_adapter_new ();
+    stream->keyframe_size_guess = DEFAULT_KEYFRAME_SIZE_GUESS;
   }
 
   return TRUE;
@@ -992,6 +1007,29 @@ gst_dash_demux_stream_update_headers_info (GstAdaptiveDemuxStream * stream)
   }
 }
 
+/* In key unit trick modes, subsegments of on-demand video streams are
+ * reduced to their first sync sample, see
+ * gst_dash_demux_stream_keyframe_data_received() */
+static gboolean
+gst_dash_demux_stream_is_keyframe_trick_mode (GstDashDemuxStream * dashstream)
+{
+  GstAdaptiveDemux *demux = GST_ADAPTIVE_DEMUX_STREAM_CAST (dashstream)->demux;
+
+  return (demux->segment.flags & GST_SEGMENT_FLAG_TRICKMODE_KEY_UNITS)
+      && dashstream->active_stream->mimeType == GST_STREAM_VIDEO
+      && dashstream->sidx_parser.status == GST_ISOFF_SIDX_PARSER_FINISHED;
+}
+
+static void
+gst_dash_demux_stream_clear_keyframe_state (GstDashDemuxStream * dashstream)
+{
+  dashstream->keyframe_state = GST_DASH_DEMUX_KEYFRAME_STATE_MOOF;
+  dashstream->keyframe_offset = 0;
+  dashstream->keyframe_end = 0;
+  dashstream->moof_size = 0;
+  gst_adapter_clear (dashstream->keyframe_adapter);
+}
+
 static GstFlowReturn
 gst_dash_demux_stream_update_fragment_info (GstAdaptiveDemuxStream * stream)
 {
@@ -1002,6 +1040,7 @@ gst_dash_demux_stream_update_fragment_info (GstAdaptiveDemuxStream * stream)
   gboolean isombff;
 
   gst_adaptive_demux_stream_fragment_clear (&stream->fragment);
+  dashstream->keyframe_download = FALSE;
 
   isombff = gst_mpd_client_has_isoff_ondemand_profile (dashdemux->client);
 
@@ -1026,7 +1065,26 @@ gst_dash_demux_stream_update_fragment_info (GstAdaptiveDemuxStream * stream)
         &fragment);
 
     stream->fragment.uri = fragment.uri;
-    if (isombff && dashstream->sidx_index != 0) {
+    if (isombff && gst_dash_demux_stream_is_keyframe_trick_mode (dashstream)) {
+      GstSidxBoxEntry *entry = SIDX_CURRENT_ENTRY (dashstream);
+      guint64 end;
+
+      /* request the part of the subsegment that is still needed, guessing
+       * its size if the moof hasn't been seen yet */
+      if (dashstream->keyframe_end > dashstream->keyframe_offset)
+        end = dashstream->keyframe_end;
+      else
+        end = dashstream->keyframe_offset + dashstream->keyframe_size_guess;
+      end = MIN (end, entry->size);
+
+      stream->fragment.range_start = dashstream->sidx_base_offset +
+          entry->offset + dashstream->keyframe_offset;
+      stream->fragment.range_end =
+          dashstream->sidx_base_offset + entry->offset + end - 1;
+      stream->fragment.timestamp = entry->pts;
+      stream->fragment.duration = entry->duration;
+      dashstream->keyframe_download = TRUE;
+    } else if (isombff && dashstream->sidx_index != 0) {
       GstSidxBoxEntry *entry = SIDX_CURRENT_ENTRY (dashstream);
       stream->fragment.range_start =
           dashstream->sidx_base_offset + entry->offset;
@@ -1052,6 +1110,33 @@ gst_dash_demux_stream_update_fragment_info (GstAdaptiveDemuxStream * stream)
   return GST_FLOW_EOS;
 }
 
+static GstFlowReturn
+gst_dash_demux_stream_peek_fragment_info (GstAdaptiveDemuxStream * stream,
+    guint n, GstAdaptiveDemuxStreamFragment * fragment)
+{
+  GstDashDemuxStream *dashstream = (GstDashDemuxStream *) stream;
+  GstDashDemux *dashdemux = GST_DASH_DEMUX_CAST (stream->demux);
+  GstActiveStream *active_stream = dashstream->active_stream;
+  GstMediaFragmentInfo info;
+
+  /* The subsegments of on-demand profile streams are ranges of a single
+   * file that are only known from the index, don't look ahead for them */
+  if (active_stream == NULL
+      || gst_mpd_client_has_isoff_ondemand_profile (dashdemux->client))
+    return GST_FLOW_EOS;
+
+  if (!gst_mpd_client_peek_fragment (dashdemux->client, dashstream->index, n,
+          &info))
+    return GST_FLOW_EOS;
+
+  fragment->uri = info.uri;
+  fragment->range_start = MAX (info.range_start, dashstream->sidx_base_offset);
+  fragment->range_end = info.range_end;
+  g_free (info.index_uri);
+
+  return GST_FLOW_OK;
+}
+
 static gint
 gst_dash_demux_index_entry_search (GstSidxBoxEntry * entry, GstClockTime * ts,
     gpointer user_data)
@@ -1128,6 +1213,7 @@ gst_dash_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
   GstDashDemux *dashdemux = GST_DASH_DEMUX_CAST (stream->demux);
 
   if (gst_mpd_client_has_isoff_ondemand_profile (dashdemux->client)) {
+    gst_dash_demux_stream_clear_keyframe_state (dashstream);
     if (dashstream->sidx_parser.status == GST_ISOFF_SIDX_PARSER_FINISHED) {
       gst_dash_demux_stream_sidx_seek (dashstream, forward, flags, ts,
           final_ts);
@@ -1225,12 +1311,35 @@ gst_dash_demux_stream_advance_fragment (GstAdaptiveDemuxStream * stream)
       dashstream->active_stream, stream->demux->segment.rate > 0.0);
 }
 
+static GArray *
+gst_dash_demux_stream_get_bitrates (GstAdaptiveDemuxStream * stream)
+{
+  GstDashDemuxStream *dashstream = (GstDashDemuxStream *) stream;
+  GstActiveStream *active_stream = dashstream->active_stream;
+  GArray *bitrates, *reps;
+  guint i;
+
+  if (active_stream == NULL || active_stream->cur_adapt_set == NULL
+      || active_stream->cur_adapt_set->Representations->len == 0)
+    return NULL;
+
+  reps = active_stream->cur_adapt_set->Representations;
+  bitrates = g_array_sized_new (FALSE, FALSE, sizeof (guint64), reps->len);
+  for (i = 0; i < reps->len; i++) {
+    guint64 bitrate = g_array_index (reps, GstRepresentationNode, i).bandwidth;
+
+    g_array_append_val (bitrates, bitrate);
+  }
+
+  return bitrates;
+}
+
 static gboolean
 gst_dash_demux_stream_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate)
 {
   GstActiveStream *active_stream = NULL;
-  GList *rep_list = NULL;
+  GArray *rep_list = NULL;
   gint new_index;
   GstDashDemux *demux = GST_DASH_DEMUX_CAST (stream->demux);
   GstDashDemuxStream *dashstream = (GstDashDemuxStream *) stream;
@@ -1244,7 +1353,7 @@ gst_dash_demux_stream_select_bitrate (GstAdaptiveDemuxStream * stream,
   /* retrieve representation list */
   if (active_stream->cur_adapt_set)
     rep_list = active_stream->cur_adapt_set->Representations;
-  if (!rep_list) {
+  if (!rep_list || rep_list->len == 0) {
     goto end;
   }
 
@@ -1259,7 +1368,8 @@ gst_dash_demux_stream_select_bitrate (GstAdaptiveDemuxStream * stream,
     new_index = gst_mpdparser_get_rep_idx_with_min_bandwidth (rep_list);
 
   if (new_index != active_stream->representation_idx) {
-    GstRepresentationNode *rep = g_list_nth_data (rep_list, new_index);
+    GstRepresentationNode *rep =
+        &g_array_index (rep_list, GstRepresentationNode, new_index);
     GST_INFO_OBJECT (demux, "Changing representation idx: %d %d %u",
         dashstream->index, new_index, rep->bandwidth);
     if (gst_mpd_client_setup_representation (demux->client, active_stream, rep)) {
@@ -1286,6 +1396,7 @@ gst_dash_demux_stream_select_bitrate (GstAdaptiveDemuxStream * stream,
       /* if we switched, we need a new index */
       gst_isoff_sidx_parser_clear (&dashstream->sidx_parser);
       gst_isoff_sidx_parser_init (&dashstream->sidx_parser);
+      gst_dash_demux_stream_clear_keyframe_state (dashstream);
     }
   }
 
@@ -1436,47 +1547,57 @@ gst_dash_demux_update_manifest_data (GstAdaptiveDemux * demux,
       }
     }
 
-    if (!gst_dash_demux_setup_mpdparser_streams (dashdemux, new_client)) {
-      GST_ERROR_OBJECT (demux, "Failed to setup streams on manifest " "update");
-      return GST_FLOW_ERROR;
-    }
-
-    /* update the streams to play from the next segment */
-    for (iter = demux->streams, streams_iter = new_client->active_streams;
-        iter && streams_iter;
-        iter = g_list_next (iter), streams_iter = g_list_next (streams_iter)) {
-      GstDashDemuxStream *demux_stream = iter->data;
-      GstActiveStream *new_stream = streams_iter->data;
-      GstClockTime ts;
-
-      if (!new_stream) {
-        GST_DEBUG_OBJECT (demux,
-            "Stream of index %d is missing from manifest update",
-            demux_stream->index);
-        return GST_FLOW_EOS;
+    /* when only new segments were added to the timelines, keep the current
+     * streams and their position instead of setting them up again */
+    if (gst_mpd_client_update_active_streams (new_client, dashdemux->client)) {
+      GST_DEBUG_OBJECT (demux, "Manifest structure unchanged, appended the "
+          "new segments to the active streams");
+    } else {
+      if (!gst_dash_demux_setup_mpdparser_streams (dashdemux, new_client)) {
+        GST_ERROR_OBJECT (demux,
+            "Failed to setup streams on manifest " "update");
+        return GST_FLOW_ERROR;
       }
 
-      if (gst_mpd_client_get_next_fragment_timestamp (dashdemux->client,
-              demux_stream->index, &ts)
-          || gst_mpd_client_get_last_fragment_timestamp_end (dashdemux->client,
-              demux_stream->index, &ts)) {
-
-        /* Due to rounding when doing the timescale conversions it might happen
-         * that the ts falls back to a previous segment, leading the same data
-         * to be downloaded twice. We try to work around this by always adding
-         * 10 microseconds to get back to the correct segment. The errors are
-         * usually on the order of nanoseconds so it should be enough.
-         */
-        GST_DEBUG_OBJECT (GST_ADAPTIVE_DEMUX_STREAM_PAD (demux_stream),
-            "Current position: %" GST_TIME_FORMAT ", updating to %"
-            GST_TIME_FORMAT, GST_TIME_ARGS (ts),
-            GST_TIME_ARGS (ts + (10 * GST_USECOND)));
-        ts += 10 * GST_USECOND;
-        gst_mpd_client_stream_seek (new_client, new_stream,
-            demux->segment.rate >= 0, 0, ts, NULL);
-      }
+      /* update the streams to play from the next segment */
+      for (iter = demux->streams, streams_iter = new_client->active_streams;
+          iter && streams_iter;
+          iter = g_list_next (iter),
+          streams_iter = g_list_next (streams_iter)) {
+        GstDashDemuxStream *demux_stream = iter->data;
+        GstActiveStream *new_stream = streams_iter->data;
+        GstClockTime ts;
+
+        if (!new_stream) {
+          GST_DEBUG_OBJECT (demux,
+              "Stream of index %d is missing from manifest update",
+              demux_stream->index);
+          return GST_FLOW_EOS;
+        }
 
-      demux_stream->active_stream = new_stream;
+        if (gst_mpd_client_get_next_fragment_timestamp (dashdemux->client,
+                demux_stream->index, &ts)
+            || gst_mpd_client_get_last_fragment_timestamp_end
+            (dashdemux->client, demux_stream->index, &ts)) {
+
+          /* Due to rounding when doing the timescale conversions it might
+           * happen that the ts falls back to a previous segment, leading the
+           * same data to be downloaded twice. We try to work around this by
+           * always adding 10 microseconds to get back to the correct segment.
+           * The errors are usually on the order of nanoseconds so it should be
+           * enough.
+           */
+          GST_DEBUG_OBJECT (GST_ADAPTIVE_DEMUX_STREAM_PAD (demux_stream),
+              "Current position: %" GST_TIME_FORMAT ", updating to %"
+              GST_TIME_FORMAT, GST_TIME_ARGS (ts),
+              GST_TIME_ARGS (ts + (10 * GST_USECOND)));
+          ts += 10 * GST_USECOND;
+          gst_mpd_client_stream_seek (new_client, new_stream,
+              demux->segment.rate >= 0, 0, ts, NULL);
+        }
+
+        demux_stream->active_stream = new_stream;
+      }
     }
 
     gst_mpd_client_free (dashdemux->client);
@@ -1578,6 +1699,177 @@ _gst_buffer_split (GstBuffer * buffer, gint offset, gsize size)
   return newbuf;
 }
 
+/* Parses the moof box at the start of the subsegment and locates its first
+ * sync sample. Returns GST_ISOFF_PARSER_OK while more data is needed and
+ * GST_ISOFF_PARSER_DONE once keyframe_end covers the sync sample */
+static GstIsoffParserResult
+gst_dash_demux_stream_parse_keyframe_moof (GstDashDemuxStream * dash_stream)
+{
+  GstSidxBoxEntry *entry = SIDX_CURRENT_ENTRY (dash_stream);
+  GstIsoffParserResult res = GST_ISOFF_PARSER_OK;
+  GstIsoffSyncSample *sync_sample;
+  GArray *sync_samples = NULL;
+  GstMoofBox *moof = NULL;
+  GstByteReader reader;
+  const guint8 *data;
+  gsize available;
+  guint header_size;
+  guint64 size;
+  guint32 fourcc;
+
+  available = gst_adapter_available (dash_stream->keyframe_adapter);
+  if (available < 8)
+    return GST_ISOFF_PARSER_OK;
+
+  data = gst_adapter_map (dash_stream->keyframe_adapter, available);
+  gst_byte_reader_init (&reader, data, available);
+
+  if (!gst_isoff_parse_box_header (&reader, &fourcc, NULL, &header_size,
+          &size))
+    goto out;
+
+  /* the sync sample has to follow the moof in the same subsegment */
+  if (fourcc != GST_ISOFF_FOURCC_MOOF || size < header_size
+      || size + 8 > entry->size) {
+    res = GST_ISOFF_PARSER_UNEXPECTED;
+    goto out;
+  }
+
+  if (available < size) {
+    /* moof and mdat header */
+    dash_stream->keyframe_end = size + 8;
+    goto out;
+  }
+
+  gst_byte_reader_init (&reader, data + header_size, size - header_size);
+  moof = gst_isoff_moof_box_parse (&reader);
+  if (moof == NULL) {
+    res = GST_ISOFF_PARSER_ERROR;
+    goto out;
+  }
+
+  /* only a single track whose first sample is a sync sample placed right
+   * after the mdat header can be reduced to that sample */
+  sync_samples = gst_isoff_moof_box_get_sync_samples (moof);
+  if (moof->traf->len != 1 || sync_samples == NULL || sync_samples->len == 0) {
+    res = GST_ISOFF_PARSER_UNEXPECTED;
+    goto out;
+  }
+
+  sync_sample = &g_array_index (sync_samples, GstIsoffSyncSample, 0);
+  if (sync_sample->offset != size + 8
+      || sync_sample->offset + sync_sample->size > entry->size) {
+    res = GST_ISOFF_PARSER_UNEXPECTED;
+    goto out;
+  }
+
+  dash_stream->moof_size = size;
+  dash_stream->keyframe_end = sync_sample->offset + sync_sample->size;
+  res = GST_ISOFF_PARSER_DONE;
+
+out:
+  gst_adapter_unmap (dash_stream->keyframe_adapter);
+  if (sync_samples)
+    g_array_free (sync_samples, TRUE);
+  if (moof)
+    gst_isoff_moof_box_free (moof);
+
+  return res;
+}
+
+/* Rewrites the moof and mdat boxes so that they only contain the first
+ * sync sample, the buffer is left untouched if that's not possible */
+static gboolean
+gst_dash_demux_stream_strip_keyframe (GstDashDemuxStream * dash_stream,
+    GstBuffer * buffer)
+{
+  GstMapInfo map;
+  gboolean ret = FALSE;
+  guint64 moof_size = dash_stream->moof_size;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READWRITE))
+    return FALSE;
+
+  if (GST_READ_UINT32_LE (map.data + moof_size + 4) == GST_ISOFF_FOURCC_MDAT
+      && gst_isoff_moof_box_keep_first_sample (map.data, moof_size)) {
+    GST_WRITE_UINT32_BE (map.data + moof_size,
+        dash_stream->keyframe_end - moof_size);
+    ret = TRUE;
+  }
+
+  gst_buffer_unmap (buffer, &map);
+  return ret;
+}
+
+static GstFlowReturn
+gst_dash_demux_stream_keyframe_data_received (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream)
+{
+  GstDashDemuxStream *dash_stream = (GstDashDemuxStream *) stream;
+  GstIsoffParserResult res;
+  GstBuffer *buffer;
+  gsize available;
+
+  available = gst_adapter_available (stream->adapter);
+  buffer = gst_adapter_take_buffer (stream->adapter, available);
+  dash_stream->keyframe_offset += available;
+
+  switch (dash_stream->keyframe_state) {
+    case GST_DASH_DEMUX_KEYFRAME_STATE_DONE:
+      /* the guessed range went past the sync sample */
+      gst_buffer_unref (buffer);
+      return GST_FLOW_OK;
+    case GST_DASH_DEMUX_KEYFRAME_STATE_FALLBACK:
+      return gst_adaptive_demux_stream_push_buffer (stream, buffer);
+    default:
+      break;
+  }
+
+  gst_adapter_push (dash_stream->keyframe_adapter, buffer);
+
+  if (dash_stream->keyframe_state == GST_DASH_DEMUX_KEYFRAME_STATE_MOOF) {
+    res = gst_dash_demux_stream_parse_keyframe_moof (dash_stream);
+    if (res == GST_ISOFF_PARSER_OK)
+      return GST_FLOW_OK;
+    if (res != GST_ISOFF_PARSER_DONE)
+      goto fallback;
+    dash_stream->keyframe_state = GST_DASH_DEMUX_KEYFRAME_STATE_SAMPLE;
+  }
+
+  if (gst_adapter_available (dash_stream->keyframe_adapter) <
+      dash_stream->keyframe_end)
+    return GST_FLOW_OK;
+
+  /* the rewrite copies the mapped memory, the adapter keeps the original
+   * data in case it fails */
+  buffer = gst_adapter_get_buffer (dash_stream->keyframe_adapter,
+      dash_stream->keyframe_end);
+  buffer = gst_buffer_make_writable (buffer);
+  if (!gst_dash_demux_stream_strip_keyframe (dash_stream, buffer)) {
+    gst_buffer_unref (buffer);
+    goto fallback;
+  }
+
+  GST_LOG_OBJECT (stream->pad, "Pushing key frame of subsegment %d, %"
+      G_GUINT64_FORMAT " bytes", SIDX (dash_stream)->entry_index,
+      dash_stream->keyframe_end);
+
+  gst_adapter_clear (dash_stream->keyframe_adapter);
+  dash_stream->keyframe_size_guess = dash_stream->keyframe_end;
+  dash_stream->keyframe_state = GST_DASH_DEMUX_KEYFRAME_STATE_DONE;
+  return gst_adaptive_demux_stream_push_buffer (stream, buffer);
+
+fallback:
+  /* push the subsegment as it is */
+  GST_DEBUG_OBJECT (stream->pad, "Can't extract the key frame of subsegment "
+      "%d, downloading all of it", SIDX (dash_stream)->entry_index);
+  dash_stream->keyframe_state = GST_DASH_DEMUX_KEYFRAME_STATE_FALLBACK;
+  dash_stream->keyframe_end = SIDX_CURRENT_ENTRY (dash_stream)->size;
+  available = gst_adapter_available (dash_stream->keyframe_adapter);
+  return gst_adaptive_demux_stream_push_buffer (stream,
+      gst_adapter_take_buffer (dash_stream->keyframe_adapter, available));
+}
+
 static GstFlowReturn
 gst_dash_demux_stream_fragment_finished (GstAdaptiveDemux * demux,
     GstAdaptiveDemuxStream * stream)
@@ -1585,6 +1877,29 @@ gst_dash_demux_stream_fragment_finished (GstAdaptiveDemux * demux,
   GstDashDemux *dashdemux = GST_DASH_DEMUX_CAST (demux);
   GstDashDemuxStream *dashstream = (GstDashDemuxStream *) stream;
 
+  if (dashstream->keyframe_download && !stream->downloading_header
+      && !stream->downloading_index) {
+    GstSidxBoxEntry *entry = SIDX_CURRENT_ENTRY (dashstream);
+    GstFlowReturn ret = GST_FLOW_OK;
+    gsize available;
+
+    /* request the rest of the subsegment if needed */
+    if (dashstream->keyframe_state != GST_DASH_DEMUX_KEYFRAME_STATE_DONE
+        && dashstream->keyframe_offset < entry->size)
+      return GST_FLOW_OK;
+
+    available = gst_adapter_available (dashstream->keyframe_adapter);
+    if (available > 0)
+      ret = gst_adaptive_demux_stream_push_buffer (stream,
+          gst_adapter_take_buffer (dashstream->keyframe_adapter, available));
+    gst_dash_demux_stream_clear_keyframe_state (dashstream);
+    if (ret != GST_FLOW_OK)
+      return ret;
+
+    return gst_adaptive_demux_stream_advance_fragment (demux, stream,
+        entry->duration);
+  }
+
   if (gst_mpd_client_has_isoff_ondemand_profile (dashdemux->client) &&
       dashstream->sidx_parser.status == GST_ISOFF_SIDX_PARSER_FINISHED) {
     /* fragment is advanced on data_received when byte limits are reached */
@@ -1653,6 +1968,8 @@ gst_dash_demux_data_received (GstAdaptiveDemux * demux,
       }
     }
     ret = gst_adaptive_demux_stream_push_buffer (stream, buffer);
+  } else if (dash_stream->keyframe_download && !stream->downloading_header) {
+    ret = gst_dash_demux_stream_keyframe_data_received (demux, stream);
   } else if (dash_stream->sidx_parser.status == GST_ISOFF_SIDX_PARSER_FINISHED) {
 
     while (ret == GST_FLOW_OK
@@ -1698,6 +2015,8 @@ gst_dash_demux_stream_free (GstAdaptiveDemuxStream * stream)
   GstDashDemuxStream *dash_stream = (GstDashDemuxStream *) stream;
 
   gst_isoff_sidx_parser_clear (&dash_stream->sidx_parser);
+  if (dash_stream->keyframe_adapter)
+    g_object_unref (dash_stream->keyframe_adapter);
 }
 
 static GstDashDemuxClockDrift *
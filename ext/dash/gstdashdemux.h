@@ -57,6 +57,14 @@ typedef struct _GstDashDemuxStream GstDashDemuxStream;
 typedef struct _GstDashDemux GstDashDemux;
 typedef struct _GstDashDemuxClass GstDashDemuxClass;
 
+typedef enum
+{
+  GST_DASH_DEMUX_KEYFRAME_STATE_MOOF,     /* waiting for the moof box */
+  GST_DASH_DEMUX_KEYFRAME_STATE_SAMPLE,   /* waiting for the sync sample */
+  GST_DASH_DEMUX_KEYFRAME_STATE_FALLBACK, /* passing the subsegment through */
+  GST_DASH_DEMUX_KEYFRAME_STATE_DONE
+} GstDashDemuxKeyframeState;
+
 struct _GstDashDemuxStream
 {
   GstAdaptiveDemuxStream parent;
@@ -72,6 +80,16 @@ struct _GstDashDemuxStream
   gint sidx_index;
   gint64 sidx_base_offset;
   GstClockTime pending_seek_ts;
+
+  /* key unit trick modes: only the moof and the first sync sample of each
+   * subsegment are downloaded. Offsets are relative to the subsegment */
+  gboolean keyframe_download;
+  GstDashDemuxKeyframeState keyframe_state;
+  GstAdapter *keyframe_adapter;
+  guint64 keyframe_offset;      /* bytes received so far */
+  guint64 keyframe_end;         /* bytes needed for the current state */
+  guint64 keyframe_size_guess;  /* size of the last moof and sync sample */
+  guint64 moof_size;
 };
 
 /**
@@ -23,7 +23,47 @@
  */
 
 #include "gstisoff.h"
-#include <gst/base/gstbytereader.h>
+#include <string.h>
+
+gboolean
+gst_isoff_parse_box_header (GstByteReader * reader, guint32 * type,
+    guint8 extended_type[16], guint * header_size, guint64 * size)
+{
+  guint header_start_offset;
+  guint32 size_field;
+
+  header_start_offset = gst_byte_reader_get_pos (reader);
+
+  if (!gst_byte_reader_get_uint32_be (reader, &size_field))
+    goto error;
+  *size = size_field;
+
+  if (!gst_byte_reader_get_uint32_le (reader, type))
+    goto error;
+
+  if (*size == 1) {
+    if (!gst_byte_reader_get_uint64_be (reader, size))
+      goto error;
+  }
+
+  if (*type == GST_ISOFF_FOURCC_UUID) {
+    const guint8 *uuid;
+
+    if (!gst_byte_reader_get_data (reader, 16, &uuid))
+      goto error;
+    if (extended_type)
+      memcpy (extended_type, uuid, 16);
+  }
+
+  if (header_size)
+    *header_size = gst_byte_reader_get_pos (reader) - header_start_offset;
+
+  return TRUE;
+
+error:
+  gst_byte_reader_set_pos (reader, header_start_offset);
+  return FALSE;
+}
 
 void
 gst_isoff_sidx_parser_init (GstSidxParser * parser)
@@ -185,3 +225,464 @@ gst_isoff_sidx_parser_add_buffer (GstSidxParser * parser, GstBuffer * buffer,
   gst_buffer_unmap (buffer, &info);
   return res;
 }
+
+/* Reads the header of the next child box of a container and checks that its
+ * data is available. On success, @child is set up to read the box data and
+ * @reader is moved past the box */
+static gboolean
+gst_isoff_next_child_box (GstByteReader * reader, guint32 * type,
+    GstByteReader * child)
+{
+  guint header_size;
+  guint64 size;
+  const guint8 *data;
+
+  if (!gst_isoff_parse_box_header (reader, type, NULL, &header_size, &size))
+    return FALSE;
+
+  if (size < header_size
+      || !gst_byte_reader_get_data (reader, size - header_size, &data))
+    return FALSE;
+
+  gst_byte_reader_init (child, data, size - header_size);
+  return TRUE;
+}
+
+static gboolean
+gst_isoff_mfhd_box_parse (GstMfhdBox * mfhd, GstByteReader * reader)
+{
+  guint8 version;
+  guint32 flags;
+
+  if (gst_byte_reader_get_remaining (reader) != 8)
+    return FALSE;
+
+  version = gst_byte_reader_get_uint8_unchecked (reader);
+  if (version != 0)
+    return FALSE;
+
+  flags = gst_byte_reader_get_uint24_be_unchecked (reader);
+  if (flags != 0)
+    return FALSE;
+
+  mfhd->sequence_number = gst_byte_reader_get_uint32_be_unchecked (reader);
+
+  return TRUE;
+}
+
+static gboolean
+gst_isoff_tfhd_box_parse (GstTfhdBox * tfhd, GstByteReader * reader)
+{
+  memset (tfhd, 0, sizeof (*tfhd));
+
+  if (gst_byte_reader_get_remaining (reader) < 4)
+    return FALSE;
+
+  tfhd->version = gst_byte_reader_get_uint8_unchecked (reader);
+  if (tfhd->version != 0)
+    return FALSE;
+
+  tfhd->flags = gst_byte_reader_get_uint24_be_unchecked (reader);
+
+  if (!gst_byte_reader_get_uint32_be (reader, &tfhd->track_id))
+    return FALSE;
+
+  if ((tfhd->flags & GST_TFHD_FLAGS_BASE_DATA_OFFSET_PRESENT) &&
+      !gst_byte_reader_get_uint64_be (reader, &tfhd->base_data_offset))
+    return FALSE;
+
+  if ((tfhd->flags & GST_TFHD_FLAGS_SAMPLE_DESCRIPTION_INDEX_PRESENT) &&
+      !gst_byte_reader_get_uint32_be (reader, &tfhd->sample_description_index))
+    return FALSE;
+
+  if ((tfhd->flags & GST_TFHD_FLAGS_DEFAULT_SAMPLE_DURATION_PRESENT) &&
+      !gst_byte_reader_get_uint32_be (reader, &tfhd->default_sample_duration))
+    return FALSE;
+
+  if ((tfhd->flags & GST_TFHD_FLAGS_DEFAULT_SAMPLE_SIZE_PRESENT) &&
+      !gst_byte_reader_get_uint32_be (reader, &tfhd->default_sample_size))
+    return FALSE;
+
+  if ((tfhd->flags & GST_TFHD_FLAGS_DEFAULT_SAMPLE_FLAGS_PRESENT) &&
+      !gst_byte_reader_get_uint32_be (reader, &tfhd->default_sample_flags))
+    return FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+gst_isoff_tfdt_box_parse (GstTfdtBox * tfdt, GstByteReader * reader)
+{
+  guint8 version;
+
+  if (gst_byte_reader_get_remaining (reader) < 4)
+    return FALSE;
+
+  version = gst_byte_reader_get_uint8_unchecked (reader);
+  gst_byte_reader_skip_unchecked (reader, 3);
+
+  if (version == 1)
+    return gst_byte_reader_get_uint64_be (reader, &tfdt->decode_time);
+  else {
+    guint32 decode_time;
+
+    if (!gst_byte_reader_get_uint32_be (reader, &decode_time))
+      return FALSE;
+    tfdt->decode_time = decode_time;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_isoff_trun_box_clear (GstTrunBox * trun)
+{
+  if (trun->samples)
+    g_array_free (trun->samples, TRUE);
+  trun->samples = NULL;
+}
+
+static gboolean
+gst_isoff_trun_box_parse (GstTrunBox * trun, GstByteReader * reader)
+{
+  guint i, sample_size = 0;
+
+  memset (trun, 0, sizeof (*trun));
+
+  if (gst_byte_reader_get_remaining (reader) < 4)
+    return FALSE;
+
+  trun->version = gst_byte_reader_get_uint8_unchecked (reader);
+  if (trun->version != 0 && trun->version != 1)
+    return FALSE;
+
+  trun->flags = gst_byte_reader_get_uint24_be_unchecked (reader);
+
+  if (!gst_byte_reader_get_uint32_be (reader, &trun->sample_count))
+    return FALSE;
+
+  if ((trun->flags & GST_TRUN_FLAGS_DATA_OFFSET_PRESENT) &&
+      !gst_byte_reader_get_uint32_be (reader, (guint32 *) & trun->data_offset))
+    return FALSE;
+
+  if ((trun->flags & GST_TRUN_FLAGS_FIRST_SAMPLE_FLAGS_PRESENT) &&
+      !gst_byte_reader_get_uint32_be (reader, &trun->first_sample_flags))
+    return FALSE;
+
+  if (trun->flags & GST_TRUN_FLAGS_SAMPLE_DURATION_PRESENT)
+    sample_size += 4;
+  if (trun->flags & GST_TRUN_FLAGS_SAMPLE_SIZE_PRESENT)
+    sample_size += 4;
+  if (trun->flags & GST_TRUN_FLAGS_SAMPLE_FLAGS_PRESENT)
+    sample_size += 4;
+  if (trun->flags & GST_TRUN_FLAGS_SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT)
+    sample_size += 4;
+
+  /* check the size before allocating anything for the samples */
+  if (gst_byte_reader_get_remaining (reader) <
+      (guint64) trun->sample_count * sample_size)
+    return FALSE;
+
+  trun->samples =
+      g_array_sized_new (FALSE, FALSE, sizeof (GstTrunSample),
+      trun->sample_count);
+
+  for (i = 0; i < trun->sample_count; i++) {
+    GstTrunSample sample = { 0, };
+
+    if (trun->flags & GST_TRUN_FLAGS_SAMPLE_DURATION_PRESENT)
+      sample.sample_duration =
+          gst_byte_reader_get_uint32_be_unchecked (reader);
+
+    if (trun->flags & GST_TRUN_FLAGS_SAMPLE_SIZE_PRESENT)
+      sample.sample_size = gst_byte_reader_get_uint32_be_unchecked (reader);
+
+    if (trun->flags & GST_TRUN_FLAGS_SAMPLE_FLAGS_PRESENT)
+      sample.sample_flags = gst_byte_reader_get_uint32_be_unchecked (reader);
+
+    if (trun->flags & GST_TRUN_FLAGS_SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT)
+      sample.sample_composition_time_offset.u =
+          gst_byte_reader_get_uint32_be_unchecked (reader);
+
+    g_array_append_val (trun->samples, sample);
+  }
+
+  return TRUE;
+}
+
+static void
+gst_isoff_traf_box_clear (GstTrafBox * traf)
+{
+  if (traf->trun)
+    g_array_free (traf->trun, TRUE);
+  traf->trun = NULL;
+}
+
+static gboolean
+gst_isoff_traf_box_parse (GstTrafBox * traf, GstByteReader * reader)
+{
+  gboolean had_tfhd = FALSE;
+
+  traf->tfdt.decode_time = 0;
+  traf->trun = g_array_new (FALSE, FALSE, sizeof (GstTrunBox));
+  g_array_set_clear_func (traf->trun,
+      (GDestroyNotify) gst_isoff_trun_box_clear);
+
+  while (gst_byte_reader_get_remaining (reader) > 0) {
+    GstByteReader sub_reader;
+    guint32 fourcc;
+
+    if (!gst_isoff_next_child_box (reader, &fourcc, &sub_reader))
+      goto error;
+
+    switch (fourcc) {
+      case GST_ISOFF_FOURCC_TFHD:
+        if (!gst_isoff_tfhd_box_parse (&traf->tfhd, &sub_reader))
+          goto error;
+        had_tfhd = TRUE;
+        break;
+      case GST_ISOFF_FOURCC_TFDT:
+        if (!gst_isoff_tfdt_box_parse (&traf->tfdt, &sub_reader))
+          goto error;
+        break;
+      case GST_ISOFF_FOURCC_TRUN:{
+        GstTrunBox trun;
+
+        if (!gst_isoff_trun_box_parse (&trun, &sub_reader)) {
+          gst_isoff_trun_box_clear (&trun);
+          goto error;
+        }
+        g_array_append_val (traf->trun, trun);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  if (!had_tfhd)
+    goto error;
+
+  return TRUE;
+
+error:
+  gst_isoff_traf_box_clear (traf);
+  return FALSE;
+}
+
+/**
+ * gst_isoff_moof_box_parse:
+ * @reader: a #GstByteReader on the data of a moof box, without its header
+ *
+ * Parses the track fragments of a moof box. Unknown child boxes are skipped.
+ *
+ * Returns: a new #GstMoofBox, or %NULL if the box is not valid
+ */
+GstMoofBox *
+gst_isoff_moof_box_parse (GstByteReader * reader)
+{
+  GstMoofBox *moof;
+  gboolean had_mfhd = FALSE;
+
+  moof = g_new0 (GstMoofBox, 1);
+  moof->traf = g_array_new (FALSE, FALSE, sizeof (GstTrafBox));
+  g_array_set_clear_func (moof->traf,
+      (GDestroyNotify) gst_isoff_traf_box_clear);
+
+  while (gst_byte_reader_get_remaining (reader) > 0) {
+    GstByteReader sub_reader;
+    guint32 fourcc;
+
+    if (!gst_isoff_next_child_box (reader, &fourcc, &sub_reader))
+      goto error;
+
+    switch (fourcc) {
+      case GST_ISOFF_FOURCC_MFHD:
+        if (!gst_isoff_mfhd_box_parse (&moof->mfhd, &sub_reader))
+          goto error;
+        had_mfhd = TRUE;
+        break;
+      case GST_ISOFF_FOURCC_TRAF:{
+        GstTrafBox traf;
+
+        if (!gst_isoff_traf_box_parse (&traf, &sub_reader))
+          goto error;
+        g_array_append_val (moof->traf, traf);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  if (!had_mfhd)
+    goto error;
+
+  return moof;
+
+error:
+  gst_isoff_moof_box_free (moof);
+  return NULL;
+}
+
+void
+gst_isoff_moof_box_free (GstMoofBox * moof)
+{
+  g_array_free (moof->traf, TRUE);
+  g_free (moof);
+}
+
+/**
+ * gst_isoff_moof_box_get_sync_samples:
+ * @moof: a #GstMoofBox
+ *
+ * Lists the sync samples of all the track fragments of @moof, in the order
+ * they are stored. The offsets are relative to the first byte of the moof
+ * box, which is where the data of the fragments start unless they use an
+ * explicit base data offset.
+ *
+ * Returns: a #GArray of #GstIsoffSyncSample, or %NULL if the samples can't
+ * be located
+ */
+GArray *
+gst_isoff_moof_box_get_sync_samples (GstMoofBox * moof)
+{
+  GArray *samples;
+  guint64 traf_end = 0;
+  guint i, j, k;
+
+  samples = g_array_new (FALSE, FALSE, sizeof (GstIsoffSyncSample));
+
+  for (i = 0; i < moof->traf->len; i++) {
+    GstTrafBox *traf = &g_array_index (moof->traf, GstTrafBox, i);
+    GstTfhdBox *tfhd = &traf->tfhd;
+    guint64 base, offset, decode_time;
+
+    /* offsets from the start of the file can't be mapped to the moof */
+    if (tfhd->flags & GST_TFHD_FLAGS_BASE_DATA_OFFSET_PRESENT)
+      goto error;
+
+    /* without default-base-is-moof, the data of a track fragment follows
+     * the one of the previous track fragment */
+    if (tfhd->flags & GST_TFHD_FLAGS_DEFAULT_BASE_IS_MOOF)
+      base = 0;
+    else
+      base = traf_end;
+    offset = base;
+    decode_time = traf->tfdt.decode_time;
+
+    for (j = 0; j < traf->trun->len; j++) {
+      GstTrunBox *trun = &g_array_index (traf->trun, GstTrunBox, j);
+
+      if (trun->flags & GST_TRUN_FLAGS_DATA_OFFSET_PRESENT) {
+        if ((gint64) base + trun->data_offset < 0)
+          goto error;
+        offset = base + trun->data_offset;
+      }
+
+      for (k = 0; k < trun->samples->len; k++) {
+        GstTrunSample *sample = &g_array_index (trun->samples,
+            GstTrunSample, k);
+        guint32 size, duration, flags;
+
+        if (trun->flags & GST_TRUN_FLAGS_SAMPLE_SIZE_PRESENT)
+          size = sample->sample_size;
+        else if (tfhd->flags & GST_TFHD_FLAGS_DEFAULT_SAMPLE_SIZE_PRESENT)
+          size = tfhd->default_sample_size;
+        else
+          goto error;
+
+        if (trun->flags & GST_TRUN_FLAGS_SAMPLE_DURATION_PRESENT)
+          duration = sample->sample_duration;
+        else
+          duration = tfhd->default_sample_duration;
+
+        /* without any flags, the defaults of the trex box apply, which are
+         * not known here: consider the sample a sync sample */
+        if (k == 0 && (trun->flags & GST_TRUN_FLAGS_FIRST_SAMPLE_FLAGS_PRESENT))
+          flags = trun->first_sample_flags;
+        else if (trun->flags & GST_TRUN_FLAGS_SAMPLE_FLAGS_PRESENT)
+          flags = sample->sample_flags;
+        else if (tfhd->flags & GST_TFHD_FLAGS_DEFAULT_SAMPLE_FLAGS_PRESENT)
+          flags = tfhd->default_sample_flags;
+        else
+          flags = 0;
+
+        if (!GST_ISOFF_SAMPLE_FLAGS_SAMPLE_IS_NON_SYNC_SAMPLE (flags)) {
+          GstIsoffSyncSample sync_sample;
+
+          sync_sample.track_id = tfhd->track_id;
+          sync_sample.offset = offset;
+          sync_sample.size = size;
+          sync_sample.decode_time = decode_time;
+          g_array_append_val (samples, sync_sample);
+        }
+
+        offset += size;
+        decode_time += duration;
+      }
+    }
+
+    traf_end = offset;
+  }
+
+  return samples;
+
+error:
+  g_array_free (samples, TRUE);
+  return NULL;
+}
+
+/**
+ * gst_isoff_moof_box_keep_first_sample:
+ * @data: a complete moof box, including its header
+ * @size: the size of @data
+ *
+ * Rewrites @data in place so that the moof box only describes its first
+ * sample: the first non-empty track run keeps a single sample and the
+ * following runs are emptied. Their data offsets are not changed, so the
+ * first sample is still found at the same position after the moof.
+ *
+ * Returns: %TRUE if a sample was kept
+ */
+gboolean
+gst_isoff_moof_box_keep_first_sample (guint8 * data, gsize size)
+{
+  GstByteReader reader, moof_reader, traf_reader, trun_reader;
+  guint32 fourcc;
+  gboolean kept = FALSE;
+
+  gst_byte_reader_init (&reader, data, size);
+  if (!gst_isoff_next_child_box (&reader, &fourcc, &moof_reader)
+      || fourcc != GST_ISOFF_FOURCC_MOOF)
+    return FALSE;
+
+  while (gst_byte_reader_get_remaining (&moof_reader) > 0) {
+    if (!gst_isoff_next_child_box (&moof_reader, &fourcc, &traf_reader))
+      return FALSE;
+    if (fourcc != GST_ISOFF_FOURCC_TRAF)
+      continue;
+
+    while (gst_byte_reader_get_remaining (&traf_reader) > 0) {
+      guint8 *sample_count;
+
+      if (!gst_isoff_next_child_box (&traf_reader, &fourcc, &trun_reader))
+        return FALSE;
+      if (fourcc != GST_ISOFF_FOURCC_TRUN)
+        continue;
+      if (gst_byte_reader_get_remaining (&trun_reader) < 8)
+        return FALSE;
+
+      /* the readers point into data, skip the version and flags */
+      sample_count = data + (trun_reader.data - data) + 4;
+      if (kept) {
+        GST_WRITE_UINT32_BE (sample_count, 0);
+      } else if (GST_READ_UINT32_BE (sample_count) > 0) {
+        GST_WRITE_UINT32_BE (sample_count, 1);
+        kept = TRUE;
+      }
+    }
+  }
+
+  return kept;
+}
@@ -26,120 +26,153 @@
 
 #include <string.h>
 #include <libxml/parser.h>
-#include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 #include "gstmpdparser.h"
 #include "gstdash_debug.h"
 
 #define GST_CAT_DEFAULT gst_dash_demux_debug
 
 /* Property parsing */
-static gboolean gst_mpdparser_get_xml_prop_validated_string (xmlNode * a_node,
-    const gchar * property_name, gchar ** property_value,
+static gboolean gst_mpdparser_get_xml_prop_validated_string (xmlTextReaderPtr
+    reader, const gchar * property_name, gchar ** property_value,
     gboolean (*validator) (const char *));
-static gboolean gst_mpdparser_get_xml_prop_string (xmlNode * a_node,
+static gboolean gst_mpdparser_get_xml_prop_string (xmlTextReaderPtr reader,
     const gchar * property_name, gchar ** property_value);
-static gboolean gst_mpdparser_get_xml_ns_prop_string (xmlNode * a_node,
+static gboolean gst_mpdparser_get_xml_ns_prop_string (xmlTextReaderPtr reader,
     const gchar * ns_name, const gchar * property_name,
     gchar ** property_value);
-static gboolean gst_mpdparser_get_xml_prop_string_vector_type (xmlNode * a_node,
-    const gchar * property_name, gchar *** property_value);
-static gboolean gst_mpdparser_get_xml_prop_signed_integer (xmlNode * a_node,
-    const gchar * property_name, gint default_val, gint * property_value);
-static gboolean gst_mpdparser_get_xml_prop_unsigned_integer (xmlNode * a_node,
-    const gchar * property_name, guint default_val, guint * property_value);
-static gboolean gst_mpdparser_get_xml_prop_unsigned_integer_64 (xmlNode *
-    a_node, const gchar * property_name, guint64 default_val,
+static gboolean gst_mpdparser_get_xml_prop_interned_string (xmlTextReaderPtr
+    reader, const gchar * property_name, const gchar ** property_value);
+static gboolean gst_mpdparser_get_xml_prop_string_vector_type (xmlTextReaderPtr
+    reader, const gchar * property_name, gchar *** property_value);
+static gboolean gst_mpdparser_get_xml_prop_signed_integer (xmlTextReaderPtr
+    reader, const gchar * property_name, gint default_val,
+    gint * property_value);
+static gboolean gst_mpdparser_get_xml_prop_unsigned_integer (xmlTextReaderPtr
+    reader, const gchar * property_name, guint default_val,
+    guint * property_value);
+static gboolean gst_mpdparser_get_xml_prop_unsigned_integer_64 (xmlTextReaderPtr
+    reader, const gchar * property_name, guint64 default_val,
     guint64 * property_value);
-static gboolean gst_mpdparser_get_xml_prop_uint_vector_type (xmlNode * a_node,
-    const gchar * property_name, guint ** property_value, guint * value_size);
-static gboolean gst_mpdparser_get_xml_prop_double (xmlNode * a_node,
+static gboolean gst_mpdparser_get_xml_prop_uint_vector_type (xmlTextReaderPtr
+    reader, const gchar * property_name, guint ** property_value,
+    guint * value_size);
+static gboolean gst_mpdparser_get_xml_prop_double (xmlTextReaderPtr reader,
     const gchar * property_name, gdouble * property_value);
-static gboolean gst_mpdparser_get_xml_prop_boolean (xmlNode * a_node,
+static gboolean gst_mpdparser_get_xml_prop_boolean (xmlTextReaderPtr reader,
     const gchar * property_name, gboolean default_val,
     gboolean * property_value);
-static gboolean gst_mpdparser_get_xml_prop_type (xmlNode * a_node,
+static gboolean gst_mpdparser_get_xml_prop_type (xmlTextReaderPtr reader,
     const gchar * property_name, GstMPDFileType * property_value);
-static gboolean gst_mpdparser_get_xml_prop_SAP_type (xmlNode * a_node,
+static gboolean gst_mpdparser_get_xml_prop_SAP_type (xmlTextReaderPtr reader,
     const gchar * property_name, GstSAPType * property_value);
-static gboolean gst_mpdparser_get_xml_prop_range (xmlNode * a_node,
+static gboolean gst_mpdparser_get_xml_prop_range (xmlTextReaderPtr reader,
     const gchar * property_name, GstRange ** property_value);
-static gboolean gst_mpdparser_get_xml_prop_ratio (xmlNode * a_node,
+static gboolean gst_mpdparser_get_xml_prop_ratio (xmlTextReaderPtr reader,
     const gchar * property_name, GstRatio ** property_value);
-static gboolean gst_mpdparser_get_xml_prop_framerate (xmlNode * a_node,
+static gboolean gst_mpdparser_get_xml_prop_framerate (xmlTextReaderPtr reader,
     const gchar * property_name, GstFrameRate ** property_value);
-static gboolean gst_mpdparser_get_xml_prop_cond_uint (xmlNode * a_node,
+static gboolean gst_mpdparser_get_xml_prop_cond_uint (xmlTextReaderPtr reader,
     const gchar * property_name, GstConditionalUintType ** property_value);
-static gboolean gst_mpdparser_get_xml_prop_dateTime (xmlNode * a_node,
+static gboolean gst_mpdparser_get_xml_prop_dateTime (xmlTextReaderPtr reader,
     const gchar * property_name, GstDateTime ** property_value);
-static gboolean gst_mpdparser_get_xml_prop_duration (xmlNode * a_node,
+static gboolean gst_mpdparser_get_xml_prop_duration (xmlTextReaderPtr reader,
     const gchar * property_name, guint64 default_value,
     guint64 * property_value);
-static gboolean gst_mpdparser_get_xml_node_content (xmlNode * a_node,
+static gboolean gst_mpdparser_get_xml_node_content (xmlTextReaderPtr reader,
     gchar ** content);
-static gchar *gst_mpdparser_get_xml_node_namespace (xmlNode * a_node,
+static gchar *gst_mpdparser_get_xml_node_namespace (xmlTextReaderPtr reader,
     const gchar * prefix);
-static gboolean gst_mpdparser_get_xml_node_as_string (xmlNode * a_node,
+static gboolean gst_mpdparser_get_xml_node_as_string (xmlTextReaderPtr reader,
     gchar ** content);
 
 /* XML node parsing */
-static void gst_mpdparser_parse_baseURL_node (GList ** list, xmlNode * a_node);
+static xmlTextReaderPtr gst_mpdparser_new_reader (const gchar * data,
+    gint size, const gchar * root_name);
+static gboolean gst_mpdparser_read_to_end (xmlTextReaderPtr reader);
+static gboolean gst_mpdparser_read_child (xmlTextReaderPtr reader, gint depth);
+static void gst_mpdparser_parse_baseURL_node (GList ** list,
+    xmlTextReaderPtr reader);
 static void gst_mpdparser_parse_descriptor_type_node (GList ** list,
-    xmlNode * a_node);
+    xmlTextReaderPtr reader);
 static void gst_mpdparser_parse_content_component_node (GList ** list,
-    xmlNode * a_node);
-static void gst_mpdparser_parse_location_node (GList ** list, xmlNode * a_node);
+    xmlTextReaderPtr reader);
+static void gst_mpdparser_parse_location_node (GList ** list,
+    xmlTextReaderPtr reader);
 static void gst_mpdparser_parse_subrepresentation_node (GList ** list,
-    xmlNode * a_node);
-static void gst_mpdparser_parse_segment_url_node (GList ** list,
-    xmlNode * a_node);
+    xmlTextReaderPtr reader);
+static void gst_mpdparser_parse_segment_url_node (GArray * array,
+    xmlTextReaderPtr reader);
 static void gst_mpdparser_parse_url_type_node (GstURLType ** pointer,
-    xmlNode * a_node);
+    xmlTextReaderPtr reader);
 static void gst_mpdparser_parse_seg_base_type_ext (GstSegmentBaseType **
-    pointer, xmlNode * a_node, GstSegmentBaseType * parent);
-static void gst_mpdparser_parse_s_node (GQueue * queue, xmlNode * a_node);
+    pointer, xmlTextReaderPtr reader);
+static gboolean gst_mpdparser_parse_seg_base_type_child (GstSegmentBaseType *
+    seg_base_type, xmlTextReaderPtr reader);
+static void gst_mpdparser_parse_segment_base_node (GstSegmentBaseType **
+    pointer, xmlTextReaderPtr reader);
+static void gst_mpdparser_parse_s_node (GArray * array,
+    xmlTextReaderPtr reader);
 static void gst_mpdparser_parse_segment_timeline_node (GstSegmentTimelineNode **
-    pointer, xmlNode * a_node);
-static gboolean
+    pointer, xmlTextReaderPtr reader);
+static void
 gst_mpdparser_parse_mult_seg_base_type_ext (GstMultSegmentBaseType ** pointer,
-    xmlNode * a_node, GstMultSegmentBaseType * parent);
+    xmlTextReaderPtr reader);
+static gboolean
+gst_mpdparser_parse_mult_seg_base_type_child (GstMultSegmentBaseType *
+    mult_seg_base_type, xmlTextReaderPtr reader, gboolean * has_timeline);
 static gboolean gst_mpdparser_parse_segment_list_node (GstSegmentListNode **
-    pointer, xmlNode * a_node, GstSegmentListNode * parent);
+    pointer, xmlTextReaderPtr reader);
 static void
 gst_mpdparser_parse_representation_base_type (GstRepresentationBaseType **
-    pointer, xmlNode * a_node);
-static gboolean gst_mpdparser_parse_representation_node (GList ** list,
-    xmlNode * a_node, GstAdaptationSetNode * parent);
+    pointer, xmlTextReaderPtr reader);
+static gboolean
+gst_mpdparser_parse_representation_base_child (GstRepresentationBaseType *
+    representation_base, xmlTextReaderPtr reader);
+static gboolean gst_mpdparser_parse_representation_node (GArray * array,
+    xmlTextReaderPtr reader);
 static gboolean gst_mpdparser_parse_adaptation_set_node (GList ** list,
-    xmlNode * a_node, GstPeriodNode * parent);
-static void gst_mpdparser_parse_subset_node (GList ** list, xmlNode * a_node);
+    xmlTextReaderPtr reader, GstPeriodNode * parent);
+static void gst_mpdparser_parse_subset_node (GList ** list,
+    xmlTextReaderPtr reader);
 static gboolean
 gst_mpdparser_parse_segment_template_node (GstSegmentTemplateNode ** pointer,
-    xmlNode * a_node, GstSegmentTemplateNode * parent);
+    xmlTextReaderPtr reader);
+static void gst_mpdparser_inherit_seg_base_type (GstSegmentBaseType *
+    seg_base_type, GstSegmentBaseType * parent);
+static void gst_mpdparser_inherit_mult_seg_base_type (GstMultSegmentBaseType *
+    mult_seg_base_type, GstMultSegmentBaseType * parent);
+static void gst_mpdparser_inherit_segment_list (GstSegmentListNode *
+    segment_list, GstSegmentListNode * parent);
+static void gst_mpdparser_inherit_segment_template (GstSegmentTemplateNode *
+    segment_template, GstSegmentTemplateNode * parent);
+static void gst_mpdparser_inherit_adaptation_set (GstAdaptationSetNode *
+    adap_set, GstPeriodNode * parent);
 static gboolean gst_mpdparser_parse_period_node (GList ** list,
-    xmlNode * a_node);
+    xmlTextReaderPtr reader);
 static void gst_mpdparser_parse_program_info_node (GList ** list,
-    xmlNode * a_node);
+    xmlTextReaderPtr reader);
 static void gst_mpdparser_parse_metrics_range_node (GList ** list,
-    xmlNode * a_node);
-static void gst_mpdparser_parse_metrics_node (GList ** list, xmlNode * a_node);
+    xmlTextReaderPtr reader);
+static void gst_mpdparser_parse_metrics_node (GList ** list,
+    xmlTextReaderPtr reader);
 static gboolean gst_mpdparser_parse_root_node (GstMPDNode ** pointer,
-    xmlNode * a_node);
+    xmlTextReaderPtr reader);
 static void gst_mpdparser_parse_utctiming_node (GList ** list,
-    xmlNode * a_node);
+    xmlTextReaderPtr reader);
 
 /* Helper functions */
 static guint convert_to_millisecs (guint decimals, gint pos);
 static int strncmp_ext (const char *s1, const char *s2);
 static GstStreamPeriod *gst_mpdparser_get_stream_period (GstMpdClient * client);
-static GstSNode *gst_mpdparser_clone_s_node (GstSNode * pointer);
 static GstSegmentTimelineNode
     * gst_mpdparser_clone_segment_timeline (GstSegmentTimelineNode * pointer);
 static GstRange *gst_mpdparser_clone_range (GstRange * range);
 static GstURLType *gst_mpdparser_clone_URL (GstURLType * url);
 static gchar *gst_mpdparser_parse_baseURL (GstMpdClient * client,
     GstActiveStream * stream, gchar ** query);
-static GstSegmentURLNode *gst_mpdparser_clone_segment_url (GstSegmentURLNode *
-    seg_url);
+static void gst_mpdparser_copy_segment_url (GstSegmentURLNode * dest,
+    const GstSegmentURLNode * seg_url);
 static gchar *gst_mpdparser_get_mediaURL (GstActiveStream * stream,
     GstSegmentURLNode * segmentURL);
 static const gchar *gst_mpdparser_get_initializationURL (GstActiveStream *
@@ -157,13 +190,15 @@ static GstDateTime *gst_mpd_client_get_availability_start_time (GstMpdClient *
     client);
 
 /* Representation */
-static GstRepresentationNode *gst_mpdparser_get_lowest_representation (GList *
+static GstRepresentationNode *gst_mpdparser_get_lowest_representation (GArray *
     Representations);
+static gint gst_mpdparser_get_representation_index (GArray * Representations,
+    GstRepresentationNode * Representation);
 #if 0
-static GstRepresentationNode *gst_mpdparser_get_highest_representation (GList *
+static GstRepresentationNode *gst_mpdparser_get_highest_representation (GArray *
     Representations);
 static GstRepresentationNode
-    * gst_mpdparser_get_representation_with_max_bandwidth (GList *
+    * gst_mpdparser_get_representation_with_max_bandwidth (GArray *
     Representations, gint max_bandwidth);
 #endif
 static GstSegmentBaseType *gst_mpdparser_get_segment_base (GstPeriodNode *
@@ -172,6 +207,9 @@ static GstSegmentBaseType *gst_mpdparser_get_segment_base (GstPeriodNode *
 static GstSegmentListNode *gst_mpdparser_get_segment_list (GstMpdClient *
     client, GstPeriodNode * Period, GstAdaptationSetNode * AdaptationSet,
     GstRepresentationNode * Representation);
+static GstSegmentTemplateNode *gst_mpdparser_get_segment_template
+    (GstPeriodNode * Period, GstAdaptationSetNode * AdaptationSet,
+    GstRepresentationNode * Representation);
 
 /* Segments */
 static guint gst_mpd_client_get_segments_counts (GstMpdClient * client,
@@ -194,11 +232,10 @@ gst_mpdparser_free_representation_base_type (GstRepresentationBaseType *
     representation_base);
 static void gst_mpdparser_free_adaptation_set_node (GstAdaptationSetNode *
     adaptation_set_node);
-static void gst_mpdparser_free_representation_node (GstRepresentationNode *
+static void gst_mpdparser_clear_representation_node (GstRepresentationNode *
     representation_node);
 static void gst_mpdparser_free_subrepresentation_node (GstSubRepresentationNode
     * subrep_node);
-static void gst_mpdparser_free_s_node (GstSNode * s_node);
 static void gst_mpdparser_free_segment_timeline_node (GstSegmentTimelineNode *
     seg_timeline);
 static void gst_mpdparser_free_url_type_node (GstURLType * url_type_node);
@@ -208,7 +245,7 @@ static void gst_mpdparser_free_mult_seg_base_type_ext (GstMultSegmentBaseType *
     mult_seg_base_type);
 static void gst_mpdparser_free_segment_list_node (GstSegmentListNode *
     segment_list_node);
-static void gst_mpdparser_free_segment_url_node (GstSegmentURLNode *
+static void gst_mpdparser_clear_segment_url_node (GstSegmentURLNode *
     segment_url);
 static void gst_mpdparser_free_base_url_node (GstBaseURL * base_url_node);
 static void gst_mpdparser_free_descriptor_type_node (GstDescriptorType *
@@ -217,7 +254,6 @@ static void gst_mpdparser_free_content_component_node (GstContentComponentNode *
     content_component_node);
 static void gst_mpdparser_free_utctiming_node (GstUTCTimingNode * timing_type);
 static void gst_mpdparser_free_stream_period (GstStreamPeriod * stream_period);
-static void gst_mpdparser_free_media_segment (GstMediaSegment * media_segment);
 static void gst_mpdparser_free_active_stream (GstActiveStream * active_stream);
 
 static GstUri *combine_urls (GstUri * base, GList * list, gchar ** query,
@@ -261,14 +297,15 @@ static const struct GstMpdParserUtcTimingMethod
 
 /* functions to parse node namespaces, content and properties */
 static gboolean
-gst_mpdparser_get_xml_prop_validated_string (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_validated_string (xmlTextReaderPtr reader,
     const gchar * property_name, gchar ** property_value,
     gboolean (*validate) (const char *))
 {
   xmlChar *prop_string;
   gboolean exists = FALSE;
 
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     if (validate && !(*validate) ((const char *) prop_string)) {
       GST_WARNING ("Validation failure: %s", prop_string);
@@ -284,14 +321,14 @@ gst_mpdparser_get_xml_prop_validated_string (xmlNode * a_node,
 }
 
 static gboolean
-gst_mpdparser_get_xml_ns_prop_string (xmlNode * a_node,
+gst_mpdparser_get_xml_ns_prop_string (xmlTextReaderPtr reader,
     const gchar * ns_name, const gchar * property_name, gchar ** property_value)
 {
   xmlChar *prop_string;
   gboolean exists = FALSE;
 
   prop_string =
-      xmlGetNsProp (a_node, (const xmlChar *) property_name,
+      xmlTextReaderGetAttributeNs (reader, (const xmlChar *) property_name,
       (const xmlChar *) ns_name);
   if (prop_string) {
     *property_value = (gchar *) prop_string;
@@ -303,13 +340,32 @@ gst_mpdparser_get_xml_ns_prop_string (xmlNode * a_node,
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_string (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_string (xmlTextReaderPtr reader,
     const gchar * property_name, gchar ** property_value)
 {
-  return gst_mpdparser_get_xml_prop_validated_string (a_node, property_name,
+  return gst_mpdparser_get_xml_prop_validated_string (reader, property_name,
       property_value, NULL);
 }
 
+/* For the attributes that are repeated with the same few values on every
+ * Representation or SegmentTemplate of a manifest, like the mimeType or the
+ * media template. They are stored once for the whole process and must not
+ * be freed */
+static gboolean
+gst_mpdparser_get_xml_prop_interned_string (xmlTextReaderPtr reader,
+    const gchar * property_name, const gchar ** property_value)
+{
+  gchar *prop_string;
+
+  if (!gst_mpdparser_get_xml_prop_string (reader, property_name,
+          &prop_string))
+    return FALSE;
+
+  *property_value = g_intern_string (prop_string);
+  xmlFree (prop_string);
+  return TRUE;
+}
+
 static gboolean
 gst_mpdparser_validate_no_whitespace (const char *s)
 {
@@ -317,15 +373,15 @@ gst_mpdparser_validate_no_whitespace (const char *s)
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_string_no_whitespace (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_string_no_whitespace (xmlTextReaderPtr reader,
     const gchar * property_name, gchar ** property_value)
 {
-  return gst_mpdparser_get_xml_prop_validated_string (a_node, property_name,
+  return gst_mpdparser_get_xml_prop_validated_string (reader, property_name,
       property_value, gst_mpdparser_validate_no_whitespace);
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_string_vector_type (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_string_vector_type (xmlTextReaderPtr reader,
     const gchar * property_name, gchar *** property_value)
 {
   xmlChar *prop_string;
@@ -333,7 +389,8 @@ gst_mpdparser_get_xml_prop_string_vector_type (xmlNode * a_node,
   guint i = 0;
   gboolean exists = FALSE;
 
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     prop_string_vector = g_strsplit ((gchar *) prop_string, " ", -1);
     if (prop_string_vector) {
@@ -354,14 +411,15 @@ gst_mpdparser_get_xml_prop_string_vector_type (xmlNode * a_node,
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_signed_integer (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_signed_integer (xmlTextReaderPtr reader,
     const gchar * property_name, gint default_val, gint * property_value)
 {
   xmlChar *prop_string;
   gboolean exists = FALSE;
 
   *property_value = default_val;
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     if (sscanf ((const gchar *) prop_string, "%d", property_value) == 1) {
       exists = TRUE;
@@ -378,14 +436,15 @@ gst_mpdparser_get_xml_prop_signed_integer (xmlNode * a_node,
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_unsigned_integer (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_unsigned_integer (xmlTextReaderPtr reader,
     const gchar * property_name, guint default_val, guint * property_value)
 {
   xmlChar *prop_string;
   gboolean exists = FALSE;
 
   *property_value = default_val;
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     if (sscanf ((gchar *) prop_string, "%u", property_value) == 1 &&
         strstr ((gchar *) prop_string, "-") == NULL) {
@@ -405,14 +464,15 @@ gst_mpdparser_get_xml_prop_unsigned_integer (xmlNode * a_node,
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_unsigned_integer_64 (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_unsigned_integer_64 (xmlTextReaderPtr reader,
     const gchar * property_name, guint64 default_val, guint64 * property_value)
 {
   xmlChar *prop_string;
   gboolean exists = FALSE;
 
   *property_value = default_val;
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     if (sscanf ((gchar *) prop_string, "%" G_GUINT64_FORMAT,
             property_value) == 1 &&
@@ -433,7 +493,7 @@ gst_mpdparser_get_xml_prop_unsigned_integer_64 (xmlNode * a_node,
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_uint_vector_type (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_uint_vector_type (xmlTextReaderPtr reader,
     const gchar * property_name, guint ** property_value, guint * value_size)
 {
   xmlChar *prop_string;
@@ -441,7 +501,8 @@ gst_mpdparser_get_xml_prop_uint_vector_type (xmlNode * a_node,
   guint *prop_uint_vector = NULL, i;
   gboolean exists = FALSE;
 
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     str_vector = g_strsplit ((gchar *) prop_string, " ", -1);
     if (str_vector) {
@@ -483,13 +544,14 @@ gst_mpdparser_get_xml_prop_uint_vector_type (xmlNode * a_node,
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_double (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_double (xmlTextReaderPtr reader,
     const gchar * property_name, gdouble * property_value)
 {
   xmlChar *prop_string;
   gboolean exists = FALSE;
 
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     if (sscanf ((gchar *) prop_string, "%lf", property_value) == 1) {
       exists = TRUE;
@@ -505,7 +567,7 @@ gst_mpdparser_get_xml_prop_double (xmlNode * a_node,
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_boolean (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_boolean (xmlTextReaderPtr reader,
     const gchar * property_name, gboolean default_val,
     gboolean * property_value)
 {
@@ -513,7 +575,8 @@ gst_mpdparser_get_xml_prop_boolean (xmlNode * a_node,
   gboolean exists = FALSE;
 
   *property_value = default_val;
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     if (xmlStrcmp (prop_string, (xmlChar *) "false") == 0) {
       exists = TRUE;
@@ -534,14 +597,15 @@ gst_mpdparser_get_xml_prop_boolean (xmlNode * a_node,
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_type (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_type (xmlTextReaderPtr reader,
     const gchar * property_name, GstMPDFileType * property_value)
 {
   xmlChar *prop_string;
   gboolean exists = FALSE;
 
   *property_value = GST_MPD_FILE_TYPE_STATIC;   /* default */
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     if (xmlStrcmp (prop_string, (xmlChar *) "OnDemand") == 0
         || xmlStrcmp (prop_string, (xmlChar *) "static") == 0) {
@@ -564,14 +628,15 @@ gst_mpdparser_get_xml_prop_type (xmlNode * a_node,
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_SAP_type (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_SAP_type (xmlTextReaderPtr reader,
     const gchar * property_name, GstSAPType * property_value)
 {
   xmlChar *prop_string;
   guint prop_SAP_type = 0;
   gboolean exists = FALSE;
 
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     if (sscanf ((gchar *) prop_string, "%u", &prop_SAP_type) == 1
         && prop_SAP_type <= 6) {
@@ -590,8 +655,8 @@ gst_mpdparser_get_xml_prop_SAP_type (xmlNode * a_node,
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_range (xmlNode * a_node, const gchar * property_name,
-    GstRange ** property_value)
+gst_mpdparser_get_xml_prop_range (xmlTextReaderPtr reader,
+    const gchar * property_name, GstRange ** property_value)
 {
   xmlChar *prop_string;
   guint64 first_byte_pos = 0, last_byte_pos = -1;
@@ -599,7 +664,8 @@ gst_mpdparser_get_xml_prop_range (xmlNode * a_node, const gchar * property_name,
   gchar *str;
   gboolean exists = FALSE;
 
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     len = xmlStrlen (prop_string);
     str = (gchar *) prop_string;
@@ -655,7 +721,7 @@ error:
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_ratio (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_ratio (xmlTextReaderPtr reader,
     const gchar * property_name, GstRatio ** property_value)
 {
   xmlChar *prop_string;
@@ -664,7 +730,8 @@ gst_mpdparser_get_xml_prop_ratio (xmlNode * a_node,
   gchar *str;
   gboolean exists = FALSE;
 
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     len = xmlStrlen (prop_string);
     str = (gchar *) prop_string;
@@ -711,7 +778,7 @@ error:
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_framerate (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_framerate (xmlTextReaderPtr reader,
     const gchar * property_name, GstFrameRate ** property_value)
 {
   xmlChar *prop_string;
@@ -720,7 +787,8 @@ gst_mpdparser_get_xml_prop_framerate (xmlNode * a_node,
   gchar *str;
   gboolean exists = FALSE;
 
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     len = xmlStrlen (prop_string);
     str = (gchar *) prop_string;
@@ -767,7 +835,7 @@ error:
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_cond_uint (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_cond_uint (xmlTextReaderPtr reader,
     const gchar * property_name, GstConditionalUintType ** property_value)
 {
   xmlChar *prop_string;
@@ -776,7 +844,8 @@ gst_mpdparser_get_xml_prop_cond_uint (xmlNode * a_node,
   guint val;
   gboolean exists = FALSE;
 
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     str = (gchar *) prop_string;
     GST_TRACE ("conditional uint: %s", str);
@@ -830,7 +899,7 @@ error:
   Note: All components are required!
 */
 static gboolean
-gst_mpdparser_get_xml_prop_dateTime (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_dateTime (xmlTextReaderPtr reader,
     const gchar * property_name, GstDateTime ** property_value)
 {
   xmlChar *prop_string;
@@ -840,7 +909,8 @@ gst_mpdparser_get_xml_prop_dateTime (xmlNode * a_node,
   gdouble second;
   gboolean exists = FALSE;
 
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     str = (gchar *) prop_string;
     GST_TRACE ("dateTime: %s, len %d", str, xmlStrlen (prop_string));
@@ -1156,7 +1226,7 @@ error:
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_duration (xmlNode * a_node,
+gst_mpdparser_get_xml_prop_duration (xmlTextReaderPtr reader,
     const gchar * property_name, guint64 default_value,
     guint64 * property_value)
 {
@@ -1165,7 +1235,8 @@ gst_mpdparser_get_xml_prop_duration (xmlNode * a_node,
   gboolean exists = FALSE;
 
   *property_value = default_value;
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  prop_string =
+      xmlTextReaderGetAttribute (reader, (const xmlChar *) property_name);
   if (prop_string) {
     str = (gchar *) prop_string;
     if (!gst_mpdparser_parse_duration (str, property_value))
@@ -1182,27 +1253,37 @@ error:
 }
 
 static gboolean
-gst_mpdparser_get_xml_node_content (xmlNode * a_node, gchar ** content)
+gst_mpdparser_get_xml_node_content (xmlTextReaderPtr reader, gchar ** content)
 {
   xmlChar *node_content = NULL;
   gboolean exists = FALSE;
 
-  node_content = xmlNodeGetContent (a_node);
+  node_content = xmlTextReaderReadString (reader);
+  /* an element without any text reads as NULL, but has empty content */
+  if (node_content == NULL)
+    node_content = xmlStrdup ((const xmlChar *) "");
   if (node_content) {
     exists = TRUE;
     *content = (gchar *) node_content;
-    GST_LOG (" - %s: %s", a_node->name, *content);
+    GST_LOG (" - %s: %s", xmlTextReaderConstLocalName (reader), *content);
   }
 
   return exists;
 }
 
 static gboolean
-gst_mpdparser_get_xml_node_as_string (xmlNode * a_node, gchar ** content)
+gst_mpdparser_get_xml_node_as_string (xmlTextReaderPtr reader,
+    gchar ** content)
 {
   gboolean exists = FALSE;
   const char *txt_encoding;
   xmlOutputBufferPtr out_buf;
+  xmlNode *a_node;
+
+  /* only the subtree of the current node is built */
+  a_node = xmlTextReaderExpand (reader);
+  if (a_node == NULL)
+    return FALSE;
 
   txt_encoding = (const char *) a_node->doc->encoding;
   out_buf = xmlAllocOutputBuffer (NULL);
@@ -1236,36 +1317,105 @@ gst_mpdparser_get_xml_node_as_string (xmlNode * a_node, gchar ** content)
 }
 
 static gchar *
-gst_mpdparser_get_xml_node_namespace (xmlNode * a_node, const gchar * prefix)
+gst_mpdparser_get_xml_node_namespace (xmlTextReaderPtr reader,
+    const gchar * prefix)
 {
-  xmlNs *curr_ns;
-  gchar *namespace = NULL;
+  xmlChar *namespace = NULL;
 
   if (prefix == NULL) {
     /* return the default namespace */
-    if (a_node->ns) {
-      namespace = xmlMemStrdup ((const gchar *) a_node->ns->href);
-      if (namespace) {
-        GST_LOG (" - default namespace: %s", namespace);
-      }
+    namespace = xmlTextReaderNamespaceUri (reader);
+    if (namespace) {
+      GST_LOG (" - default namespace: %s", namespace);
     }
   } else {
-    /* look for the specified prefix in the namespace list */
-    for (curr_ns = a_node->ns; curr_ns; curr_ns = curr_ns->next) {
-      if (xmlStrcmp (curr_ns->prefix, (xmlChar *) prefix) == 0) {
-        namespace = xmlMemStrdup ((const gchar *) curr_ns->href);
-        if (namespace) {
-          GST_LOG (" - %s namespace: %s", curr_ns->prefix, curr_ns->href);
-        }
-      }
+    /* look for the specified prefix in the namespaces in scope */
+    namespace = xmlTextReaderLookupNamespace (reader, (const xmlChar *) prefix);
+    if (namespace) {
+      GST_LOG (" - %s namespace: %s", prefix, namespace);
     }
   }
 
-  return namespace;
+  return (gchar *) namespace;
+}
+
+/* Creates a reader for the XML document in @data and moves it to the root
+ * element, which must be called @root_name. The nodes are parsed while the
+ * reader walks the document, so no tree of the whole document is built */
+static xmlTextReaderPtr
+gst_mpdparser_new_reader (const gchar * data, gint size,
+    const gchar * root_name)
+{
+  xmlTextReaderPtr reader;
+  gint ret;
+
+  /* this initialize the library and check potential ABI mismatches
+   * between the version it was compiled for and the actual shared
+   * library used
+   */
+  LIBXML_TEST_VERSION;
+
+  reader = xmlReaderForMemory (data, size, "noname.xml", NULL,
+      XML_PARSE_NONET);
+  if (reader == NULL)
+    return NULL;
+
+  while ((ret = xmlTextReaderRead (reader)) == 1 &&
+      xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT);
+
+  if (ret != 1 || xmlStrcmp (xmlTextReaderConstLocalName (reader),
+          (xmlChar *) root_name) != 0) {
+    GST_ERROR ("can not find the root element %s", root_name);
+    xmlFreeTextReader (reader);
+    return NULL;
+  }
+
+  return reader;
+}
+
+/* Reads the rest of the document after the root element was parsed, as
+ * errors in the XML can only be detected once the reader reaches them */
+static gboolean
+gst_mpdparser_read_to_end (xmlTextReaderPtr reader)
+{
+  gint ret;
+
+  while ((ret = xmlTextReaderRead (reader)) == 1);
+
+  if (ret != 0) {
+    GST_ERROR ("failed to parse the XML document");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Moves the reader to the next child element of the element at @depth and
+ * returns TRUE, or returns FALSE once the end of that element is reached.
+ * Text, comments and whatever was left of the previous child are skipped */
+static gboolean
+gst_mpdparser_read_child (xmlTextReaderPtr reader, gint depth)
+{
+  gint cur_depth;
+
+  if (xmlTextReaderDepth (reader) == depth &&
+      xmlTextReaderIsEmptyElement (reader))
+    return FALSE;
+
+  while (xmlTextReaderRead (reader) == 1) {
+    cur_depth = xmlTextReaderDepth (reader);
+    if (cur_depth <= depth)
+      return FALSE;
+    if (cur_depth == depth + 1 &&
+        xmlTextReaderNodeType (reader) == XML_READER_TYPE_ELEMENT)
+      return TRUE;
+  }
+
+  return FALSE;
 }
 
 static void
-gst_mpdparser_parse_baseURL_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_baseURL_node (GList ** list, xmlTextReaderPtr reader)
 {
   GstBaseURL *new_base_url;
 
@@ -1273,139 +1423,148 @@ gst_mpdparser_parse_baseURL_node (GList ** list, xmlNode * a_node)
   *list = g_list_append (*list, new_base_url);
 
   GST_LOG ("content of BaseURL node:");
-  gst_mpdparser_get_xml_node_content (a_node, &new_base_url->baseURL);
+  gst_mpdparser_get_xml_node_content (reader, &new_base_url->baseURL);
 
   GST_LOG ("attributes of BaseURL node:");
-  gst_mpdparser_get_xml_prop_string (a_node, "serviceLocation",
+  gst_mpdparser_get_xml_prop_string (reader, "serviceLocation",
       &new_base_url->serviceLocation);
-  gst_mpdparser_get_xml_prop_string (a_node, "byteRange",
+  gst_mpdparser_get_xml_prop_string (reader, "byteRange",
       &new_base_url->byteRange);
 }
 
 static void
-gst_mpdparser_parse_descriptor_type_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_descriptor_type_node (GList ** list,
+    xmlTextReaderPtr reader)
 {
   GstDescriptorType *new_descriptor;
 
   new_descriptor = g_slice_new0 (GstDescriptorType);
   *list = g_list_append (*list, new_descriptor);
 
-  GST_LOG ("attributes of %s node:", a_node->name);
-  gst_mpdparser_get_xml_prop_string (a_node, "schemeIdUri",
+  GST_LOG ("attributes of %s node:", xmlTextReaderConstLocalName (reader));
+  gst_mpdparser_get_xml_prop_string (reader, "schemeIdUri",
       &new_descriptor->schemeIdUri);
-  if (!gst_mpdparser_get_xml_prop_string (a_node, "value",
+  if (!gst_mpdparser_get_xml_prop_string (reader, "value",
           &new_descriptor->value)) {
     /* if no value attribute, use XML string representation of the node */
-    gst_mpdparser_get_xml_node_as_string (a_node, &new_descriptor->value);
+    gst_mpdparser_get_xml_node_as_string (reader, &new_descriptor->value);
   }
 }
 
 static void
-gst_mpdparser_parse_content_component_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_content_component_node (GList ** list,
+    xmlTextReaderPtr reader)
 {
-  xmlNode *cur_node;
+  const xmlChar *name;
+  gint depth;
   GstContentComponentNode *new_content_component;
 
   new_content_component = g_slice_new0 (GstContentComponentNode);
   *list = g_list_append (*list, new_content_component);
 
   GST_LOG ("attributes of ContentComponent node:");
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "id", 0,
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "id", 0,
       &new_content_component->id);
-  gst_mpdparser_get_xml_prop_string (a_node, "lang",
+  gst_mpdparser_get_xml_prop_string (reader, "lang",
       &new_content_component->lang);
-  gst_mpdparser_get_xml_prop_string (a_node, "contentType",
+  gst_mpdparser_get_xml_prop_string (reader, "contentType",
       &new_content_component->contentType);
-  gst_mpdparser_get_xml_prop_ratio (a_node, "par", &new_content_component->par);
+  gst_mpdparser_get_xml_prop_ratio (reader, "par", &new_content_component->par);
 
   /* explore children nodes */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "Accessibility") == 0) {
-        gst_mpdparser_parse_descriptor_type_node
-            (&new_content_component->Accessibility, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Role") == 0) {
-        gst_mpdparser_parse_descriptor_type_node (&new_content_component->Role,
-            cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Rating") == 0) {
-        gst_mpdparser_parse_descriptor_type_node
-            (&new_content_component->Rating, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Viewpoint") == 0) {
-        gst_mpdparser_parse_descriptor_type_node
-            (&new_content_component->Viewpoint, cur_node);
-      }
+  depth = xmlTextReaderDepth (reader);
+  while (gst_mpdparser_read_child (reader, depth)) {
+    name = xmlTextReaderConstLocalName (reader);
+    if (xmlStrcmp (name, (xmlChar *) "Accessibility") == 0) {
+      gst_mpdparser_parse_descriptor_type_node
+          (&new_content_component->Accessibility, reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "Role") == 0) {
+      gst_mpdparser_parse_descriptor_type_node (&new_content_component->Role,
+          reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "Rating") == 0) {
+      gst_mpdparser_parse_descriptor_type_node
+          (&new_content_component->Rating, reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "Viewpoint") == 0) {
+      gst_mpdparser_parse_descriptor_type_node
+          (&new_content_component->Viewpoint, reader);
     }
   }
 }
 
 static void
-gst_mpdparser_parse_location_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_location_node (GList ** list, xmlTextReaderPtr reader)
 {
   gchar *location = NULL;
 
   GST_LOG ("content of Location node:");
-  if (gst_mpdparser_get_xml_node_content (a_node, &location))
+  if (gst_mpdparser_get_xml_node_content (reader, &location))
     *list = g_list_append (*list, location);
 }
 
 static void
-gst_mpdparser_parse_subrepresentation_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_subrepresentation_node (GList ** list,
+    xmlTextReaderPtr reader)
 {
+  gint depth;
   GstSubRepresentationNode *new_subrep;
 
   new_subrep = g_slice_new0 (GstSubRepresentationNode);
   *list = g_list_append (*list, new_subrep);
 
   GST_LOG ("attributes of SubRepresentation node:");
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "level", 0,
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "level", 0,
       &new_subrep->level);
-  gst_mpdparser_get_xml_prop_uint_vector_type (a_node, "dependencyLevel",
+  gst_mpdparser_get_xml_prop_uint_vector_type (reader, "dependencyLevel",
       &new_subrep->dependencyLevel, &new_subrep->size);
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "bandwidth", 0,
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "bandwidth", 0,
       &new_subrep->bandwidth);
-  gst_mpdparser_get_xml_prop_string_vector_type (a_node,
+  gst_mpdparser_get_xml_prop_string_vector_type (reader,
       "contentComponent", &new_subrep->contentComponent);
 
   /* RepresentationBase extension */
   gst_mpdparser_parse_representation_base_type (&new_subrep->RepresentationBase,
-      a_node);
-}
+      reader);
 
-static GstSegmentURLNode *
-gst_mpdparser_clone_segment_url (GstSegmentURLNode * seg_url)
-{
-  GstSegmentURLNode *clone = NULL;
-
-  if (seg_url) {
-    clone = g_slice_new0 (GstSegmentURLNode);
-    clone->media = xmlMemStrdup (seg_url->media);
-    clone->mediaRange = gst_mpdparser_clone_range (seg_url->mediaRange);
-    clone->index = xmlMemStrdup (seg_url->index);
-    clone->indexRange = gst_mpdparser_clone_range (seg_url->indexRange);
+  /* explore children nodes */
+  depth = xmlTextReaderDepth (reader);
+  while (gst_mpdparser_read_child (reader, depth)) {
+    gst_mpdparser_parse_representation_base_child
+        (new_subrep->RepresentationBase, reader);
   }
+}
 
-  return clone;
+static void
+gst_mpdparser_copy_segment_url (GstSegmentURLNode * dest,
+    const GstSegmentURLNode * seg_url)
+{
+  dest->media = xmlMemStrdup (seg_url->media);
+  dest->mediaRange = gst_mpdparser_clone_range (seg_url->mediaRange);
+  dest->index = xmlMemStrdup (seg_url->index);
+  dest->indexRange = gst_mpdparser_clone_range (seg_url->indexRange);
 }
 
+/* SegmentList elements can carry thousands of SegmentURL nodes, so they are
+ * stored next to each other in @array */
 static void
-gst_mpdparser_parse_segment_url_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_segment_url_node (GArray * array, xmlTextReaderPtr reader)
 {
   GstSegmentURLNode *new_segment_url;
 
-  new_segment_url = g_slice_new0 (GstSegmentURLNode);
-  *list = g_list_append (*list, new_segment_url);
+  g_array_set_size (array, array->len + 1);
+  new_segment_url = &g_array_index (array, GstSegmentURLNode, array->len - 1);
 
   GST_LOG ("attributes of SegmentURL node:");
-  gst_mpdparser_get_xml_prop_string (a_node, "media", &new_segment_url->media);
-  gst_mpdparser_get_xml_prop_range (a_node, "mediaRange",
+  gst_mpdparser_get_xml_prop_string (reader, "media", &new_segment_url->media);
+  gst_mpdparser_get_xml_prop_range (reader, "mediaRange",
       &new_segment_url->mediaRange);
-  gst_mpdparser_get_xml_prop_string (a_node, "index", &new_segment_url->index);
-  gst_mpdparser_get_xml_prop_range (a_node, "indexRange",
+  gst_mpdparser_get_xml_prop_string (reader, "index", &new_segment_url->index);
+  gst_mpdparser_get_xml_prop_range (reader, "indexRange",
       &new_segment_url->indexRange);
 }
 
 static void
-gst_mpdparser_parse_url_type_node (GstURLType ** pointer, xmlNode * a_node)
+gst_mpdparser_parse_url_type_node (GstURLType ** pointer,
+    xmlTextReaderPtr reader)
 {
   GstURLType *new_url_type;
 
@@ -1413,16 +1572,15 @@ gst_mpdparser_parse_url_type_node (GstURLType ** pointer, xmlNode * a_node)
   *pointer = new_url_type = g_slice_new0 (GstURLType);
 
   GST_LOG ("attributes of URLType node:");
-  gst_mpdparser_get_xml_prop_string (a_node, "sourceURL",
+  gst_mpdparser_get_xml_prop_string (reader, "sourceURL",
       &new_url_type->sourceURL);
-  gst_mpdparser_get_xml_prop_range (a_node, "range", &new_url_type->range);
+  gst_mpdparser_get_xml_prop_range (reader, "range", &new_url_type->range);
 }
 
 static void
 gst_mpdparser_parse_seg_base_type_ext (GstSegmentBaseType ** pointer,
-    xmlNode * a_node, GstSegmentBaseType * parent)
+    xmlTextReaderPtr reader)
 {
-  xmlNode *cur_node;
   GstSegmentBaseType *seg_base_type;
   guint intval;
   guint64 int64val;
@@ -1436,87 +1594,104 @@ gst_mpdparser_parse_seg_base_type_ext (GstSegmentBaseType ** pointer,
   seg_base_type->indexRangeExact = FALSE;
   seg_base_type->timescale = 1;
 
-  /* Inherit attribute values from parent */
-  if (parent) {
-    seg_base_type->timescale = parent->timescale;
-    seg_base_type->presentationTimeOffset = parent->presentationTimeOffset;
-    seg_base_type->indexRange = gst_mpdparser_clone_range (parent->indexRange);
-    seg_base_type->indexRangeExact = parent->indexRangeExact;
-    seg_base_type->Initialization =
-        gst_mpdparser_clone_URL (parent->Initialization);
-    seg_base_type->RepresentationIndex =
-        gst_mpdparser_clone_URL (parent->RepresentationIndex);
-  }
-
   /* We must retrieve each value first to see if it exists.  If it does not
-   * exist, we do not want to overwrite an inherited value */
+   * exist, the value is inherited from the parent once it was parsed */
   GST_LOG ("attributes of SegmentBaseType extension:");
-  if (gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "timescale", 1,
+  if (gst_mpdparser_get_xml_prop_unsigned_integer (reader, "timescale", 1,
           &intval)) {
     seg_base_type->timescale = intval;
+    seg_base_type->has_timescale = TRUE;
   }
-  if (gst_mpdparser_get_xml_prop_unsigned_integer_64 (a_node,
+  if (gst_mpdparser_get_xml_prop_unsigned_integer_64 (reader,
           "presentationTimeOffset", 0, &int64val)) {
     seg_base_type->presentationTimeOffset = int64val;
+    seg_base_type->has_presentation_time_offset = TRUE;
   }
-  if (gst_mpdparser_get_xml_prop_range (a_node, "indexRange", &rangeval)) {
-    if (seg_base_type->indexRange) {
-      g_slice_free (GstRange, seg_base_type->indexRange);
-    }
+  if (gst_mpdparser_get_xml_prop_range (reader, "indexRange", &rangeval)) {
     seg_base_type->indexRange = rangeval;
   }
-  if (gst_mpdparser_get_xml_prop_boolean (a_node, "indexRangeExact",
+  if (gst_mpdparser_get_xml_prop_boolean (reader, "indexRangeExact",
           FALSE, &boolval)) {
     seg_base_type->indexRangeExact = boolval;
-  }
-
-  /* explore children nodes */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "Initialization") == 0 ||
-          xmlStrcmp (cur_node->name, (xmlChar *) "Initialisation") == 0) {
-        /* parse will free the previous pointer to create a new one */
-        gst_mpdparser_parse_url_type_node (&seg_base_type->Initialization,
-            cur_node);
-      } else if (xmlStrcmp (cur_node->name,
-              (xmlChar *) "RepresentationIndex") == 0) {
-        /* parse will free the previous pointer to create a new one */
-        gst_mpdparser_parse_url_type_node (&seg_base_type->RepresentationIndex,
-            cur_node);
-      }
-    }
+    seg_base_type->has_index_range_exact = TRUE;
   }
 }
 
-static GstSNode *
-gst_mpdparser_clone_s_node (GstSNode * pointer)
+/* Inherits the attributes and elements that are not present in
+ * @seg_base_type from the same element on the higher level */
+static void
+gst_mpdparser_inherit_seg_base_type (GstSegmentBaseType * seg_base_type,
+    GstSegmentBaseType * parent)
 {
-  GstSNode *clone = NULL;
+  if (!seg_base_type || !parent)
+    return;
 
-  if (pointer) {
-    clone = g_slice_new0 (GstSNode);
-    clone->t = pointer->t;
-    clone->d = pointer->d;
-    clone->r = pointer->r;
+  if (!seg_base_type->has_timescale)
+    seg_base_type->timescale = parent->timescale;
+  if (!seg_base_type->has_presentation_time_offset)
+    seg_base_type->presentationTimeOffset = parent->presentationTimeOffset;
+  if (!seg_base_type->indexRange)
+    seg_base_type->indexRange = gst_mpdparser_clone_range (parent->indexRange);
+  if (!seg_base_type->has_index_range_exact)
+    seg_base_type->indexRangeExact = parent->indexRangeExact;
+  if (!seg_base_type->Initialization)
+    seg_base_type->Initialization =
+        gst_mpdparser_clone_URL (parent->Initialization);
+  if (!seg_base_type->RepresentationIndex)
+    seg_base_type->RepresentationIndex =
+        gst_mpdparser_clone_URL (parent->RepresentationIndex);
+}
+
+/* Parses the child element the reader is on if it belongs to the
+ * SegmentBaseType extension, returns FALSE if it is not one of them */
+static gboolean
+gst_mpdparser_parse_seg_base_type_child (GstSegmentBaseType * seg_base_type,
+    xmlTextReaderPtr reader)
+{
+  const xmlChar *name = xmlTextReaderConstLocalName (reader);
+
+  if (xmlStrcmp (name, (xmlChar *) "Initialization") == 0 ||
+      xmlStrcmp (name, (xmlChar *) "Initialisation") == 0) {
+    /* parse will free the previous pointer to create a new one */
+    gst_mpdparser_parse_url_type_node (&seg_base_type->Initialization, reader);
+  } else if (xmlStrcmp (name, (xmlChar *) "RepresentationIndex") == 0) {
+    /* parse will free the previous pointer to create a new one */
+    gst_mpdparser_parse_url_type_node (&seg_base_type->RepresentationIndex,
+        reader);
+  } else {
+    return FALSE;
   }
 
-  return clone;
+  return TRUE;
 }
 
 static void
-gst_mpdparser_parse_s_node (GQueue * queue, xmlNode * a_node)
+gst_mpdparser_parse_segment_base_node (GstSegmentBaseType ** pointer,
+    xmlTextReaderPtr reader)
 {
-  GstSNode *new_s_node;
+  gint depth;
 
-  new_s_node = g_slice_new0 (GstSNode);
-  g_queue_push_tail (queue, new_s_node);
+  gst_mpdparser_parse_seg_base_type_ext (pointer, reader);
+
+  /* explore children nodes */
+  depth = xmlTextReaderDepth (reader);
+  while (gst_mpdparser_read_child (reader, depth))
+    gst_mpdparser_parse_seg_base_type_child (*pointer, reader);
+}
+
+static void
+gst_mpdparser_parse_s_node (GArray * array, xmlTextReaderPtr reader)
+{
+  GstSNode new_s_node;
 
   GST_LOG ("attributes of S node:");
-  gst_mpdparser_get_xml_prop_unsigned_integer_64 (a_node, "t", 0,
-      &new_s_node->t);
-  gst_mpdparser_get_xml_prop_unsigned_integer_64 (a_node, "d", 0,
-      &new_s_node->d);
-  gst_mpdparser_get_xml_prop_signed_integer (a_node, "r", 0, &new_s_node->r);
+  gst_mpdparser_get_xml_prop_unsigned_integer_64 (reader, "t", 0,
+      &new_s_node.t);
+  gst_mpdparser_get_xml_prop_unsigned_integer_64 (reader, "d", 0,
+      &new_s_node.d);
+  gst_mpdparser_get_xml_prop_signed_integer (reader, "r", 0, &new_s_node.r);
+
+  g_array_append_val (array, new_s_node);
 }
 
 static GstSegmentTimelineNode *
@@ -1527,15 +1702,7 @@ gst_mpdparser_clone_segment_timeline (GstSegmentTimelineNode * pointer)
   if (pointer) {
     clone = gst_mpdparser_segment_timeline_node_new ();
     if (clone) {
-      GList *list;
-      for (list = g_queue_peek_head_link (&pointer->S); list;
-          list = g_list_next (list)) {
-        GstSNode *s_node;
-        s_node = (GstSNode *) list->data;
-        if (s_node) {
-          g_queue_push_tail (&clone->S, gst_mpdparser_clone_s_node (s_node));
-        }
-      }
+      g_array_append_vals (clone->S, pointer->S->data, pointer->S->len);
     } else {
       GST_WARNING ("Allocation of SegmentTimeline node failed!");
     }
@@ -1546,9 +1713,9 @@ gst_mpdparser_clone_segment_timeline (GstSegmentTimelineNode * pointer)
 
 static void
 gst_mpdparser_parse_segment_timeline_node (GstSegmentTimelineNode ** pointer,
-    xmlNode * a_node)
+    xmlTextReaderPtr reader)
 {
-  xmlNode *cur_node;
+  gint depth;
   GstSegmentTimelineNode *new_seg_timeline;
 
   gst_mpdparser_free_segment_timeline_node (*pointer);
@@ -1559,116 +1726,112 @@ gst_mpdparser_parse_segment_timeline_node (GstSegmentTimelineNode ** pointer,
   }
 
   /* explore children nodes */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "S") == 0) {
-        gst_mpdparser_parse_s_node (&new_seg_timeline->S, cur_node);
-      }
+  depth = xmlTextReaderDepth (reader);
+  while (gst_mpdparser_read_child (reader, depth)) {
+    if (xmlStrcmp (xmlTextReaderConstLocalName (reader),
+            (xmlChar *) "S") == 0) {
+      gst_mpdparser_parse_s_node (new_seg_timeline->S, reader);
     }
   }
 }
 
-static gboolean
+static void
 gst_mpdparser_parse_mult_seg_base_type_ext (GstMultSegmentBaseType ** pointer,
-    xmlNode * a_node, GstMultSegmentBaseType * parent)
+    xmlTextReaderPtr reader)
 {
-  xmlNode *cur_node;
   GstMultSegmentBaseType *mult_seg_base_type;
   guint intval;
-  gboolean has_timeline = FALSE, has_duration = FALSE;
 
   gst_mpdparser_free_mult_seg_base_type_ext (*pointer);
-  mult_seg_base_type = g_slice_new0 (GstMultSegmentBaseType);
+  *pointer = mult_seg_base_type = g_slice_new0 (GstMultSegmentBaseType);
 
   mult_seg_base_type->duration = 0;
   mult_seg_base_type->startNumber = 1;
 
-  /* Inherit attribute values from parent */
-  if (parent) {
-    mult_seg_base_type->duration = parent->duration;
-    mult_seg_base_type->startNumber = parent->startNumber;
-    mult_seg_base_type->SegmentTimeline =
-        gst_mpdparser_clone_segment_timeline (parent->SegmentTimeline);
-    mult_seg_base_type->BitstreamSwitching =
-        gst_mpdparser_clone_URL (parent->BitstreamSwitching);
-  }
-
   GST_LOG ("attributes of MultipleSegmentBaseType extension:");
-  if (gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "duration", 0,
+  if (gst_mpdparser_get_xml_prop_unsigned_integer (reader, "duration", 0,
           &intval)) {
     mult_seg_base_type->duration = intval;
-    has_duration = TRUE;
+    mult_seg_base_type->has_duration = TRUE;
   }
 
-  if (gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "startNumber", 1,
+  if (gst_mpdparser_get_xml_prop_unsigned_integer (reader, "startNumber", 1,
           &intval)) {
     mult_seg_base_type->startNumber = intval;
+    mult_seg_base_type->has_start_number = TRUE;
   }
 
   GST_LOG ("extension of MultipleSegmentBaseType extension:");
   gst_mpdparser_parse_seg_base_type_ext (&mult_seg_base_type->SegBaseType,
-      a_node, (parent ? parent->SegBaseType : NULL));
+      reader);
+}
 
-  /* explore children nodes */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "SegmentTimeline") == 0) {
-        /* parse frees the segmenttimeline if any */
-        gst_mpdparser_parse_segment_timeline_node
-            (&mult_seg_base_type->SegmentTimeline, cur_node);
-        has_timeline = TRUE;
-      } else if (xmlStrcmp (cur_node->name,
-              (xmlChar *) "BitstreamSwitching") == 0) {
-        /* parse frees the old url before setting the new one */
-        gst_mpdparser_parse_url_type_node
-            (&mult_seg_base_type->BitstreamSwitching, cur_node);
-      }
-    }
-  }
+static void
+gst_mpdparser_inherit_mult_seg_base_type (GstMultSegmentBaseType *
+    mult_seg_base_type, GstMultSegmentBaseType * parent)
+{
+  if (!mult_seg_base_type || !parent)
+    return;
 
-  if (!has_duration && !has_timeline) {
-    GST_ERROR ("segment has neither duration nor timeline");
-    goto error;
+  if (!mult_seg_base_type->has_duration)
+    mult_seg_base_type->duration = parent->duration;
+  if (!mult_seg_base_type->has_start_number)
+    mult_seg_base_type->startNumber = parent->startNumber;
+  if (!mult_seg_base_type->SegmentTimeline)
+    mult_seg_base_type->SegmentTimeline =
+        gst_mpdparser_clone_segment_timeline (parent->SegmentTimeline);
+  if (!mult_seg_base_type->BitstreamSwitching)
+    mult_seg_base_type->BitstreamSwitching =
+        gst_mpdparser_clone_URL (parent->BitstreamSwitching);
+  gst_mpdparser_inherit_seg_base_type (mult_seg_base_type->SegBaseType,
+      parent->SegBaseType);
+}
+
+/* Parses the child element the reader is on if it belongs to the
+ * MultipleSegmentBaseType extension, returns FALSE if it is not one of them */
+static gboolean
+gst_mpdparser_parse_mult_seg_base_type_child (GstMultSegmentBaseType *
+    mult_seg_base_type, xmlTextReaderPtr reader, gboolean * has_timeline)
+{
+  const xmlChar *name = xmlTextReaderConstLocalName (reader);
+
+  if (xmlStrcmp (name, (xmlChar *) "SegmentTimeline") == 0) {
+    /* parse frees the segmenttimeline if any */
+    gst_mpdparser_parse_segment_timeline_node
+        (&mult_seg_base_type->SegmentTimeline, reader);
+    *has_timeline = TRUE;
+  } else if (xmlStrcmp (name, (xmlChar *) "BitstreamSwitching") == 0) {
+    /* parse frees the old url before setting the new one */
+    gst_mpdparser_parse_url_type_node
+        (&mult_seg_base_type->BitstreamSwitching, reader);
+  } else {
+    return gst_mpdparser_parse_seg_base_type_child
+        (mult_seg_base_type->SegBaseType, reader);
   }
 
-  *pointer = mult_seg_base_type;
   return TRUE;
-
-error:
-  gst_mpdparser_free_mult_seg_base_type_ext (mult_seg_base_type);
-  return FALSE;
 }
 
 static gboolean
 gst_mpdparser_parse_segment_list_node (GstSegmentListNode ** pointer,
-    xmlNode * a_node, GstSegmentListNode * parent)
+    xmlTextReaderPtr reader)
 {
-  xmlNode *cur_node;
+  gint depth;
   GstSegmentListNode *new_segment_list;
   gchar *actuate;
-  gboolean segment_urls_inherited_from_parent = FALSE;
+  gboolean has_timeline = FALSE;
 
   gst_mpdparser_free_segment_list_node (*pointer);
   new_segment_list = g_slice_new0 (GstSegmentListNode);
-
-  /* Inherit attribute values from parent */
-  if (parent) {
-    GList *list;
-    GstSegmentURLNode *seg_url;
-    for (list = g_list_first (parent->SegmentURL); list;
-        list = g_list_next (list)) {
-      seg_url = (GstSegmentURLNode *) list->data;
-      new_segment_list->SegmentURL =
-          g_list_append (new_segment_list->SegmentURL,
-          gst_mpdparser_clone_segment_url (seg_url));
-      segment_urls_inherited_from_parent = TRUE;
-    }
-  }
+  new_segment_list->SegmentURL =
+      g_array_new (FALSE, TRUE, sizeof (GstSegmentURLNode));
+  g_array_set_clear_func (new_segment_list->SegmentURL,
+      (GDestroyNotify) gst_mpdparser_clear_segment_url_node);
 
   new_segment_list->actuate = GST_XLINK_ACTUATE_ON_REQUEST;
-  if (gst_mpdparser_get_xml_ns_prop_string (a_node,
+  if (gst_mpdparser_get_xml_ns_prop_string (reader,
           "http://www.w3.org/1999/xlink", "href", &new_segment_list->xlink_href)
-      && gst_mpdparser_get_xml_ns_prop_string (a_node,
+      && gst_mpdparser_get_xml_ns_prop_string (reader,
           "http://www.w3.org/1999/xlink", "actuate", &actuate)) {
     if (strcmp (actuate, "onLoad") == 0)
       new_segment_list->actuate = GST_XLINK_ACTUATE_ON_LOAD;
@@ -1676,38 +1839,27 @@ gst_mpdparser_parse_segment_list_node (GstSegmentListNode ** pointer,
   }
 
   GST_LOG ("extension of SegmentList node:");
-  if (!gst_mpdparser_parse_mult_seg_base_type_ext
-      (&new_segment_list->MultSegBaseType, a_node,
-          (parent ? parent->MultSegBaseType : NULL)))
-    goto error;
+  gst_mpdparser_parse_mult_seg_base_type_ext
+      (&new_segment_list->MultSegBaseType, reader);
 
   /* explore children nodes */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "SegmentURL") == 0) {
-        if (segment_urls_inherited_from_parent) {
-          /*
-           * SegmentBase, SegmentTemplate and SegmentList shall inherit
-           * attributes and elements from the same element on a higher level.
-           * If the same attribute or element is present on both levels,
-           * the one on the lower level shall take precedence over the one
-           * on the higher level.
-           */
-
-          /* Clear the list of inherited segment URLs */
-          g_list_free_full (new_segment_list->SegmentURL,
-              (GDestroyNotify) gst_mpdparser_free_segment_url_node);
-          new_segment_list->SegmentURL = NULL;
-
-          /* mark the fact that we cleared the list, so that it is not tried again */
-          segment_urls_inherited_from_parent = FALSE;
-        }
-        gst_mpdparser_parse_segment_url_node (&new_segment_list->SegmentURL,
-            cur_node);
-      }
+  depth = xmlTextReaderDepth (reader);
+  while (gst_mpdparser_read_child (reader, depth)) {
+    if (xmlStrcmp (xmlTextReaderConstLocalName (reader),
+            (xmlChar *) "SegmentURL") == 0) {
+      gst_mpdparser_parse_segment_url_node (new_segment_list->SegmentURL,
+          reader);
+    } else {
+      gst_mpdparser_parse_mult_seg_base_type_child
+          (new_segment_list->MultSegBaseType, reader, &has_timeline);
     }
   }
 
+  if (!new_segment_list->MultSegBaseType->has_duration && !has_timeline) {
+    GST_ERROR ("segment has neither duration nor timeline");
+    goto error;
+  }
+
   *pointer = new_segment_list;
   return TRUE;
 
@@ -1716,174 +1868,209 @@ error:
   return FALSE;
 }
 
+static void
+gst_mpdparser_inherit_segment_list (GstSegmentListNode * segment_list,
+    GstSegmentListNode * parent)
+{
+  guint i;
+
+  if (!segment_list || !parent)
+    return;
+
+  /* The segment URLs of the lower level replace the inherited ones */
+  if (segment_list->SegmentURL->len == 0) {
+    g_array_set_size (segment_list->SegmentURL, parent->SegmentURL->len);
+    for (i = 0; i < parent->SegmentURL->len; i++) {
+      gst_mpdparser_copy_segment_url (&g_array_index (segment_list->SegmentURL,
+              GstSegmentURLNode, i), &g_array_index (parent->SegmentURL,
+              GstSegmentURLNode, i));
+    }
+  }
+  gst_mpdparser_inherit_mult_seg_base_type (segment_list->MultSegBaseType,
+      parent->MultSegBaseType);
+}
+
 static void
 gst_mpdparser_parse_representation_base_type (GstRepresentationBaseType **
-    pointer, xmlNode * a_node)
+    pointer, xmlTextReaderPtr reader)
 {
-  xmlNode *cur_node;
   GstRepresentationBaseType *representation_base;
 
   gst_mpdparser_free_representation_base_type (*pointer);
   *pointer = representation_base = g_slice_new0 (GstRepresentationBaseType);
 
   GST_LOG ("attributes of RepresentationBaseType extension:");
-  gst_mpdparser_get_xml_prop_string (a_node, "profiles",
+  gst_mpdparser_get_xml_prop_string (reader, "profiles",
       &representation_base->profiles);
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "width", 0,
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "width", 0,
       &representation_base->width);
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "height", 0,
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "height", 0,
       &representation_base->height);
-  gst_mpdparser_get_xml_prop_ratio (a_node, "sar", &representation_base->sar);
-  gst_mpdparser_get_xml_prop_framerate (a_node, "frameRate",
+  gst_mpdparser_get_xml_prop_ratio (reader, "sar", &representation_base->sar);
+  gst_mpdparser_get_xml_prop_framerate (reader, "frameRate",
       &representation_base->frameRate);
-  gst_mpdparser_get_xml_prop_framerate (a_node, "minFrameRate",
+  gst_mpdparser_get_xml_prop_framerate (reader, "minFrameRate",
       &representation_base->minFrameRate);
-  gst_mpdparser_get_xml_prop_framerate (a_node, "maxFrameRate",
+  gst_mpdparser_get_xml_prop_framerate (reader, "maxFrameRate",
       &representation_base->maxFrameRate);
-  gst_mpdparser_get_xml_prop_string (a_node, "audioSamplingRate",
+  gst_mpdparser_get_xml_prop_string (reader, "audioSamplingRate",
       &representation_base->audioSamplingRate);
-  gst_mpdparser_get_xml_prop_string (a_node, "mimeType",
+  gst_mpdparser_get_xml_prop_interned_string (reader, "mimeType",
       &representation_base->mimeType);
-  gst_mpdparser_get_xml_prop_string (a_node, "segmentProfiles",
+  gst_mpdparser_get_xml_prop_string (reader, "segmentProfiles",
       &representation_base->segmentProfiles);
-  gst_mpdparser_get_xml_prop_string (a_node, "codecs",
+  gst_mpdparser_get_xml_prop_interned_string (reader, "codecs",
       &representation_base->codecs);
-  gst_mpdparser_get_xml_prop_double (a_node, "maximumSAPPeriod",
+  gst_mpdparser_get_xml_prop_double (reader, "maximumSAPPeriod",
       &representation_base->maximumSAPPeriod);
-  gst_mpdparser_get_xml_prop_SAP_type (a_node, "startWithSAP",
+  gst_mpdparser_get_xml_prop_SAP_type (reader, "startWithSAP",
       &representation_base->startWithSAP);
-  gst_mpdparser_get_xml_prop_double (a_node, "maxPlayoutRate",
+  gst_mpdparser_get_xml_prop_double (reader, "maxPlayoutRate",
       &representation_base->maxPlayoutRate);
-  gst_mpdparser_get_xml_prop_boolean (a_node, "codingDependency",
+  gst_mpdparser_get_xml_prop_boolean (reader, "codingDependency",
       FALSE, &representation_base->codingDependency);
-  gst_mpdparser_get_xml_prop_string (a_node, "scanType",
+  gst_mpdparser_get_xml_prop_string (reader, "scanType",
       &representation_base->scanType);
+}
 
-  /* explore children nodes */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "FramePacking") == 0) {
-        gst_mpdparser_parse_descriptor_type_node
-            (&representation_base->FramePacking, cur_node);
-      } else if (xmlStrcmp (cur_node->name,
-              (xmlChar *) "AudioChannelConfiguration") == 0) {
-        gst_mpdparser_parse_descriptor_type_node
-            (&representation_base->AudioChannelConfiguration, cur_node);
-      } else if (xmlStrcmp (cur_node->name,
-              (xmlChar *) "ContentProtection") == 0) {
-        gst_mpdparser_parse_descriptor_type_node
-            (&representation_base->ContentProtection, cur_node);
-      }
-    }
+/* Parses the child element the reader is on if it belongs to the
+ * RepresentationBaseType extension, returns FALSE if it is not one of them */
+static gboolean
+gst_mpdparser_parse_representation_base_child (GstRepresentationBaseType *
+    representation_base, xmlTextReaderPtr reader)
+{
+  const xmlChar *name = xmlTextReaderConstLocalName (reader);
+
+  if (xmlStrcmp (name, (xmlChar *) "FramePacking") == 0) {
+    gst_mpdparser_parse_descriptor_type_node
+        (&representation_base->FramePacking, reader);
+  } else if (xmlStrcmp (name, (xmlChar *) "AudioChannelConfiguration") == 0) {
+    gst_mpdparser_parse_descriptor_type_node
+        (&representation_base->AudioChannelConfiguration, reader);
+  } else if (xmlStrcmp (name, (xmlChar *) "ContentProtection") == 0) {
+    gst_mpdparser_parse_descriptor_type_node
+        (&representation_base->ContentProtection, reader);
+  } else {
+    return FALSE;
   }
+
+  return TRUE;
 }
 
+/* The Representations are stored next to each other in @array. No pointer
+ * to them is kept while the AdaptationSet is being parsed */
 static gboolean
-gst_mpdparser_parse_representation_node (GList ** list, xmlNode * a_node,
-    GstAdaptationSetNode * parent)
+gst_mpdparser_parse_representation_node (GArray * array,
+    xmlTextReaderPtr reader)
 {
-  xmlNode *cur_node;
+  const xmlChar *name;
+  gint depth;
   GstRepresentationNode *new_representation;
 
-  new_representation = g_slice_new0 (GstRepresentationNode);
+  g_array_set_size (array, array->len + 1);
+  new_representation =
+      &g_array_index (array, GstRepresentationNode, array->len - 1);
 
   GST_LOG ("attributes of Representation node:");
-  gst_mpdparser_get_xml_prop_string_no_whitespace (a_node, "id",
+  gst_mpdparser_get_xml_prop_string_no_whitespace (reader, "id",
       &new_representation->id);
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "bandwidth", 0,
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "bandwidth", 0,
       &new_representation->bandwidth);
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "qualityRanking", 0,
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "qualityRanking", 0,
       &new_representation->qualityRanking);
-  gst_mpdparser_get_xml_prop_string_vector_type (a_node, "dependencyId",
+  gst_mpdparser_get_xml_prop_string_vector_type (reader, "dependencyId",
       &new_representation->dependencyId);
-  gst_mpdparser_get_xml_prop_string_vector_type (a_node,
+  gst_mpdparser_get_xml_prop_string_vector_type (reader,
       "mediaStreamStructureId", &new_representation->mediaStreamStructureId);
 
   /* RepresentationBase extension */
   gst_mpdparser_parse_representation_base_type
-      (&new_representation->RepresentationBase, a_node);
+      (&new_representation->RepresentationBase, reader);
 
   /* explore children nodes */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "SegmentBase") == 0) {
-        gst_mpdparser_parse_seg_base_type_ext (&new_representation->SegmentBase,
-            cur_node, parent->SegmentBase);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "SegmentTemplate") == 0) {
-        if (!gst_mpdparser_parse_segment_template_node
-            (&new_representation->SegmentTemplate, cur_node,
-                parent->SegmentTemplate))
-          goto error;
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "SegmentList") == 0) {
-        if (!gst_mpdparser_parse_segment_list_node
-            (&new_representation->SegmentList, cur_node, parent->SegmentList))
-          goto error;
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "BaseURL") == 0) {
-        gst_mpdparser_parse_baseURL_node (&new_representation->BaseURLs,
-            cur_node);
-      } else if (xmlStrcmp (cur_node->name,
-              (xmlChar *) "SubRepresentation") == 0) {
-        gst_mpdparser_parse_subrepresentation_node
-            (&new_representation->SubRepresentations, cur_node);
-      }
+  depth = xmlTextReaderDepth (reader);
+  while (gst_mpdparser_read_child (reader, depth)) {
+    name = xmlTextReaderConstLocalName (reader);
+    if (xmlStrcmp (name, (xmlChar *) "SegmentBase") == 0) {
+      gst_mpdparser_parse_segment_base_node (&new_representation->SegmentBase,
+          reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "SegmentTemplate") == 0) {
+      if (!gst_mpdparser_parse_segment_template_node
+          (&new_representation->SegmentTemplate, reader))
+        goto error;
+    } else if (xmlStrcmp (name, (xmlChar *) "SegmentList") == 0) {
+      if (!gst_mpdparser_parse_segment_list_node
+          (&new_representation->SegmentList, reader))
+        goto error;
+    } else if (xmlStrcmp (name, (xmlChar *) "BaseURL") == 0) {
+      gst_mpdparser_parse_baseURL_node (&new_representation->BaseURLs, reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "SubRepresentation") == 0) {
+      gst_mpdparser_parse_subrepresentation_node
+          (&new_representation->SubRepresentations, reader);
+    } else {
+      gst_mpdparser_parse_representation_base_child
+          (new_representation->RepresentationBase, reader);
     }
   }
 
-  /* some sanity checking */
-
-  *list = g_list_append (*list, new_representation);
   return TRUE;
 
 error:
-  gst_mpdparser_free_representation_node (new_representation);
+  /* clears the new Representation */
+  g_array_set_size (array, array->len - 1);
   return FALSE;
 }
 
 static gboolean
-gst_mpdparser_parse_adaptation_set_node (GList ** list, xmlNode * a_node,
-    GstPeriodNode * parent)
+gst_mpdparser_parse_adaptation_set_node (GList ** list,
+    xmlTextReaderPtr reader, GstPeriodNode * parent)
 {
-  xmlNode *cur_node;
+  const xmlChar *name;
+  gint depth;
   GstAdaptationSetNode *new_adap_set;
   gchar *actuate;
 
   new_adap_set = g_slice_new0 (GstAdaptationSetNode);
+  new_adap_set->Representations =
+      g_array_new (FALSE, TRUE, sizeof (GstRepresentationNode));
+  g_array_set_clear_func (new_adap_set->Representations,
+      (GDestroyNotify) gst_mpdparser_clear_representation_node);
 
   GST_LOG ("attributes of AdaptationSet node:");
 
   new_adap_set->actuate = GST_XLINK_ACTUATE_ON_REQUEST;
-  if (gst_mpdparser_get_xml_ns_prop_string (a_node,
+  if (gst_mpdparser_get_xml_ns_prop_string (reader,
           "http://www.w3.org/1999/xlink", "href", &new_adap_set->xlink_href)
-      && gst_mpdparser_get_xml_ns_prop_string (a_node,
+      && gst_mpdparser_get_xml_ns_prop_string (reader,
           "http://www.w3.org/1999/xlink", "actuate", &actuate)) {
     if (strcmp (actuate, "onLoad") == 0)
       new_adap_set->actuate = GST_XLINK_ACTUATE_ON_LOAD;
     xmlFree (actuate);
   }
 
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "id", 0,
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "id", 0,
       &new_adap_set->id);
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "group", 0,
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "group", 0,
       &new_adap_set->group);
-  gst_mpdparser_get_xml_prop_string (a_node, "lang", &new_adap_set->lang);
-  gst_mpdparser_get_xml_prop_string (a_node, "contentType",
+  gst_mpdparser_get_xml_prop_string (reader, "lang", &new_adap_set->lang);
+  gst_mpdparser_get_xml_prop_string (reader, "contentType",
       &new_adap_set->contentType);
-  gst_mpdparser_get_xml_prop_ratio (a_node, "par", &new_adap_set->par);
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "minBandwidth", 0,
+  gst_mpdparser_get_xml_prop_ratio (reader, "par", &new_adap_set->par);
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "minBandwidth", 0,
       &new_adap_set->minBandwidth);
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "maxBandwidth", 0,
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "maxBandwidth", 0,
       &new_adap_set->maxBandwidth);
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "minWidth", 0,
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "minWidth", 0,
       &new_adap_set->minWidth);
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "maxWidth", 0,
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "maxWidth", 0,
       &new_adap_set->maxWidth);
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "minHeight", 0,
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "minHeight", 0,
       &new_adap_set->minHeight);
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "maxHeight", 0,
+  gst_mpdparser_get_xml_prop_unsigned_integer (reader, "maxHeight", 0,
       &new_adap_set->maxHeight);
-  gst_mpdparser_get_xml_prop_cond_uint (a_node, "segmentAlignment",
+  gst_mpdparser_get_xml_prop_cond_uint (reader, "segmentAlignment",
       &new_adap_set->segmentAlignment);
-  gst_mpdparser_get_xml_prop_boolean (a_node, "bitstreamSwitching",
+  gst_mpdparser_get_xml_prop_boolean (reader, "bitstreamSwitching",
       parent->bitstreamSwitching, &new_adap_set->bitstreamSwitching);
   if (parent->bitstreamSwitching && !new_adap_set->bitstreamSwitching) {
     /* according to the standard, if the Period's bitstreamSwitching attribute
@@ -1894,62 +2081,57 @@ gst_mpdparser_parse_adaptation_set_node (GList ** list, xmlNode * a_node,
      */
     new_adap_set->bitstreamSwitching = parent->bitstreamSwitching;
   }
-  gst_mpdparser_get_xml_prop_cond_uint (a_node, "subsegmentAlignment",
+  gst_mpdparser_get_xml_prop_cond_uint (reader, "subsegmentAlignment",
       &new_adap_set->subsegmentAlignment);
-  gst_mpdparser_get_xml_prop_SAP_type (a_node, "subsegmentStartsWithSAP",
+  gst_mpdparser_get_xml_prop_SAP_type (reader, "subsegmentStartsWithSAP",
       &new_adap_set->subsegmentStartsWithSAP);
 
   /* RepresentationBase extension */
   gst_mpdparser_parse_representation_base_type
-      (&new_adap_set->RepresentationBase, a_node);
+      (&new_adap_set->RepresentationBase, reader);
 
-  /* explore children nodes */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "Accessibility") == 0) {
-        gst_mpdparser_parse_descriptor_type_node (&new_adap_set->Accessibility,
-            cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Role") == 0) {
-        gst_mpdparser_parse_descriptor_type_node (&new_adap_set->Role,
-            cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Rating") == 0) {
-        gst_mpdparser_parse_descriptor_type_node (&new_adap_set->Rating,
-            cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Viewpoint") == 0) {
-        gst_mpdparser_parse_descriptor_type_node (&new_adap_set->Viewpoint,
-            cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "BaseURL") == 0) {
-        gst_mpdparser_parse_baseURL_node (&new_adap_set->BaseURLs, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "SegmentBase") == 0) {
-        gst_mpdparser_parse_seg_base_type_ext (&new_adap_set->SegmentBase,
-            cur_node, parent->SegmentBase);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "SegmentList") == 0) {
-        if (!gst_mpdparser_parse_segment_list_node (&new_adap_set->SegmentList,
-                cur_node, parent->SegmentList))
-          goto error;
-      } else if (xmlStrcmp (cur_node->name,
-              (xmlChar *) "ContentComponent") == 0) {
-        gst_mpdparser_parse_content_component_node
-            (&new_adap_set->ContentComponents, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "SegmentTemplate") == 0) {
-        if (!gst_mpdparser_parse_segment_template_node
-            (&new_adap_set->SegmentTemplate, cur_node, parent->SegmentTemplate))
-          goto error;
-      }
-    }
-  }
-
-  /* We must parse Representation after everything else in the AdaptationSet
-   * has been parsed because certain Representation child elements can inherit
-   * attributes specified by the same element in the AdaptationSet
+  /* explore children nodes.
+   * Certain Representation child elements inherit attributes specified by
+   * the same element in the AdaptationSet. They may come in any order, so
+   * this is resolved by the Period once all of them were parsed, see
+   * gst_mpdparser_inherit_adaptation_set().
    */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "Representation") == 0) {
-        if (!gst_mpdparser_parse_representation_node
-            (&new_adap_set->Representations, cur_node, new_adap_set))
-          goto error;
-      }
+  depth = xmlTextReaderDepth (reader);
+  while (gst_mpdparser_read_child (reader, depth)) {
+    name = xmlTextReaderConstLocalName (reader);
+    if (xmlStrcmp (name, (xmlChar *) "Accessibility") == 0) {
+      gst_mpdparser_parse_descriptor_type_node (&new_adap_set->Accessibility,
+          reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "Role") == 0) {
+      gst_mpdparser_parse_descriptor_type_node (&new_adap_set->Role, reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "Rating") == 0) {
+      gst_mpdparser_parse_descriptor_type_node (&new_adap_set->Rating, reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "Viewpoint") == 0) {
+      gst_mpdparser_parse_descriptor_type_node (&new_adap_set->Viewpoint,
+          reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "BaseURL") == 0) {
+      gst_mpdparser_parse_baseURL_node (&new_adap_set->BaseURLs, reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "SegmentBase") == 0) {
+      gst_mpdparser_parse_segment_base_node (&new_adap_set->SegmentBase,
+          reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "SegmentList") == 0) {
+      if (!gst_mpdparser_parse_segment_list_node (&new_adap_set->SegmentList,
+              reader))
+        goto error;
+    } else if (xmlStrcmp (name, (xmlChar *) "ContentComponent") == 0) {
+      gst_mpdparser_parse_content_component_node
+          (&new_adap_set->ContentComponents, reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "SegmentTemplate") == 0) {
+      if (!gst_mpdparser_parse_segment_template_node
+          (&new_adap_set->SegmentTemplate, reader))
+        goto error;
+    } else if (xmlStrcmp (name, (xmlChar *) "Representation") == 0) {
+      if (!gst_mpdparser_parse_representation_node
+          (new_adap_set->Representations, reader))
+        goto error;
+    } else {
+      gst_mpdparser_parse_representation_base_child
+          (new_adap_set->RepresentationBase, reader);
     }
   }
 
@@ -1961,8 +2143,45 @@ error:
   return FALSE;
 }
 
+/*
+ * SegmentBase, SegmentTemplate and SegmentList shall inherit
+ * attributes and elements from the same element on a higher level.
+ * If the same attribute or element is present on both levels,
+ * the one on the lower level shall take precedence over the one
+ * on the higher level.
+ *
+ * Must be called once @parent was completely parsed, and before the
+ * Representations of @adap_set are used.
+ */
+static void
+gst_mpdparser_inherit_adaptation_set (GstAdaptationSetNode * adap_set,
+    GstPeriodNode * parent)
+{
+  GstRepresentationNode *representation;
+  guint i;
+
+  gst_mpdparser_inherit_seg_base_type (adap_set->SegmentBase,
+      parent->SegmentBase);
+  gst_mpdparser_inherit_segment_list (adap_set->SegmentList,
+      parent->SegmentList);
+  gst_mpdparser_inherit_segment_template (adap_set->SegmentTemplate,
+      parent->SegmentTemplate);
+
+  for (i = 0; i < adap_set->Representations->len; i++) {
+    representation =
+        &g_array_index (adap_set->Representations, GstRepresentationNode, i);
+
+    gst_mpdparser_inherit_seg_base_type (representation->SegmentBase,
+        adap_set->SegmentBase);
+    gst_mpdparser_inherit_segment_list (representation->SegmentList,
+        adap_set->SegmentList);
+    gst_mpdparser_inherit_segment_template (representation->SegmentTemplate,
+        adap_set->SegmentTemplate);
+  }
+}
+
 static void
-gst_mpdparser_parse_subset_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_subset_node (GList ** list, xmlTextReaderPtr reader)
 {
   GstSubsetNode *new_subset;
 
@@ -1970,52 +2189,45 @@ gst_mpdparser_parse_subset_node (GList ** list, xmlNode * a_node)
   *list = g_list_append (*list, new_subset);
 
   GST_LOG ("attributes of Subset node:");
-  gst_mpdparser_get_xml_prop_uint_vector_type (a_node, "contains",
+  gst_mpdparser_get_xml_prop_uint_vector_type (reader, "contains",
       &new_subset->contains, &new_subset->size);
 }
 
 static gboolean
 gst_mpdparser_parse_segment_template_node (GstSegmentTemplateNode ** pointer,
-    xmlNode * a_node, GstSegmentTemplateNode * parent)
+    xmlTextReaderPtr reader)
 {
+  gint depth;
   GstSegmentTemplateNode *new_segment_template;
-  gchar *strval;
+  gboolean has_timeline = FALSE;
 
   gst_mpdparser_free_segment_template_node (*pointer);
   new_segment_template = g_slice_new0 (GstSegmentTemplateNode);
 
   GST_LOG ("extension of SegmentTemplate node:");
-  if (!gst_mpdparser_parse_mult_seg_base_type_ext
-      (&new_segment_template->MultSegBaseType, a_node,
-          (parent ? parent->MultSegBaseType : NULL)))
-    goto error;
+  gst_mpdparser_parse_mult_seg_base_type_ext
+      (&new_segment_template->MultSegBaseType, reader);
 
-  /* Inherit attribute values from parent when the value isn't found */
   GST_LOG ("attributes of SegmentTemplate node:");
-  if (gst_mpdparser_get_xml_prop_string (a_node, "media", &strval)) {
-    new_segment_template->media = strval;
-  } else if (parent) {
-    new_segment_template->media = xmlMemStrdup (parent->media);
-  }
+  gst_mpdparser_get_xml_prop_interned_string (reader, "media",
+      &new_segment_template->media);
+  gst_mpdparser_get_xml_prop_interned_string (reader, "index",
+      &new_segment_template->index);
+  gst_mpdparser_get_xml_prop_interned_string (reader, "initialization",
+      &new_segment_template->initialization);
+  gst_mpdparser_get_xml_prop_interned_string (reader, "bitstreamSwitching",
+      &new_segment_template->bitstreamSwitching);
 
-  if (gst_mpdparser_get_xml_prop_string (a_node, "index", &strval)) {
-    new_segment_template->index = strval;
-  } else if (parent) {
-    new_segment_template->index = xmlMemStrdup (parent->index);
-  }
-
-  if (gst_mpdparser_get_xml_prop_string (a_node, "initialization", &strval)) {
-    new_segment_template->initialization = strval;
-  } else if (parent) {
-    new_segment_template->initialization =
-        xmlMemStrdup (parent->initialization);
+  /* explore children nodes */
+  depth = xmlTextReaderDepth (reader);
+  while (gst_mpdparser_read_child (reader, depth)) {
+    gst_mpdparser_parse_mult_seg_base_type_child
+        (new_segment_template->MultSegBaseType, reader, &has_timeline);
   }
 
-  if (gst_mpdparser_get_xml_prop_string (a_node, "bitstreamSwitching", &strval)) {
-    new_segment_template->bitstreamSwitching = strval;
-  } else if (parent) {
-    new_segment_template->bitstreamSwitching =
-        xmlMemStrdup (parent->bitstreamSwitching);
+  if (!new_segment_template->MultSegBaseType->has_duration && !has_timeline) {
+    GST_ERROR ("segment has neither duration nor timeline");
+    goto error;
   }
 
   *pointer = new_segment_template;
@@ -2026,71 +2238,92 @@ error:
   return FALSE;
 }
 
+/* Inherits the attributes not present in @segment_template from the
+ * same element on the higher level */
+static void
+gst_mpdparser_inherit_segment_template (GstSegmentTemplateNode *
+    segment_template, GstSegmentTemplateNode * parent)
+{
+  if (!segment_template || !parent)
+    return;
+
+  /* the strings are interned, they can be shared */
+  if (!segment_template->media)
+    segment_template->media = parent->media;
+  if (!segment_template->index)
+    segment_template->index = parent->index;
+  if (!segment_template->initialization)
+    segment_template->initialization = parent->initialization;
+  if (!segment_template->bitstreamSwitching)
+    segment_template->bitstreamSwitching = parent->bitstreamSwitching;
+  gst_mpdparser_inherit_mult_seg_base_type
+      (segment_template->MultSegBaseType, parent->MultSegBaseType);
+}
+
 static gboolean
-gst_mpdparser_parse_period_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_period_node (GList ** list, xmlTextReaderPtr reader)
 {
-  xmlNode *cur_node;
+  const xmlChar *name;
+  gint depth;
   GstPeriodNode *new_period;
   gchar *actuate;
+  GList *iter;
 
   new_period = g_slice_new0 (GstPeriodNode);
 
   GST_LOG ("attributes of Period node:");
 
   new_period->actuate = GST_XLINK_ACTUATE_ON_REQUEST;
-  if (gst_mpdparser_get_xml_ns_prop_string (a_node,
+  if (gst_mpdparser_get_xml_ns_prop_string (reader,
           "http://www.w3.org/1999/xlink", "href", &new_period->xlink_href)
-      && gst_mpdparser_get_xml_ns_prop_string (a_node,
+      && gst_mpdparser_get_xml_ns_prop_string (reader,
           "http://www.w3.org/1999/xlink", "actuate", &actuate)) {
     if (strcmp (actuate, "onLoad") == 0)
       new_period->actuate = GST_XLINK_ACTUATE_ON_LOAD;
     xmlFree (actuate);
   }
 
-  gst_mpdparser_get_xml_prop_string (a_node, "id", &new_period->id);
-  gst_mpdparser_get_xml_prop_duration (a_node, "start", GST_MPD_DURATION_NONE,
+  gst_mpdparser_get_xml_prop_string (reader, "id", &new_period->id);
+  gst_mpdparser_get_xml_prop_duration (reader, "start", GST_MPD_DURATION_NONE,
       &new_period->start);
-  gst_mpdparser_get_xml_prop_duration (a_node, "duration",
+  gst_mpdparser_get_xml_prop_duration (reader, "duration",
       GST_MPD_DURATION_NONE, &new_period->duration);
-  gst_mpdparser_get_xml_prop_boolean (a_node, "bitstreamSwitching", FALSE,
+  gst_mpdparser_get_xml_prop_boolean (reader, "bitstreamSwitching", FALSE,
       &new_period->bitstreamSwitching);
 
-  /* explore children nodes */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "SegmentBase") == 0) {
-        gst_mpdparser_parse_seg_base_type_ext (&new_period->SegmentBase,
-            cur_node, NULL);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "SegmentList") == 0) {
-        if (!gst_mpdparser_parse_segment_list_node (&new_period->SegmentList,
-                cur_node, NULL))
-          goto error;
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "SegmentTemplate") == 0) {
-        if (!gst_mpdparser_parse_segment_template_node
-            (&new_period->SegmentTemplate, cur_node, NULL))
-          goto error;
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Subset") == 0) {
-        gst_mpdparser_parse_subset_node (&new_period->Subsets, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "BaseURL") == 0) {
-        gst_mpdparser_parse_baseURL_node (&new_period->BaseURLs, cur_node);
-      }
-    }
-  }
-
-  /* We must parse AdaptationSet after everything else in the Period has been
-   * parsed because certain AdaptationSet child elements can inherit attributes
-   * specified by the same element in the Period
+  /* explore children nodes.
+   * Certain AdaptationSet child elements inherit attributes specified by the
+   * same element in the Period. They may come in any order, so the
+   * inheritance is resolved once the Period element is closed.
    */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "AdaptationSet") == 0) {
-        if (!gst_mpdparser_parse_adaptation_set_node
-            (&new_period->AdaptationSets, cur_node, new_period))
-          goto error;
-      }
+  depth = xmlTextReaderDepth (reader);
+  while (gst_mpdparser_read_child (reader, depth)) {
+    name = xmlTextReaderConstLocalName (reader);
+    if (xmlStrcmp (name, (xmlChar *) "SegmentBase") == 0) {
+      gst_mpdparser_parse_segment_base_node (&new_period->SegmentBase,
+          reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "SegmentList") == 0) {
+      if (!gst_mpdparser_parse_segment_list_node (&new_period->SegmentList,
+              reader))
+        goto error;
+    } else if (xmlStrcmp (name, (xmlChar *) "SegmentTemplate") == 0) {
+      if (!gst_mpdparser_parse_segment_template_node
+          (&new_period->SegmentTemplate, reader))
+        goto error;
+    } else if (xmlStrcmp (name, (xmlChar *) "Subset") == 0) {
+      gst_mpdparser_parse_subset_node (&new_period->Subsets, reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "BaseURL") == 0) {
+      gst_mpdparser_parse_baseURL_node (&new_period->BaseURLs, reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "AdaptationSet") == 0) {
+      if (!gst_mpdparser_parse_adaptation_set_node
+          (&new_period->AdaptationSets, reader, new_period))
+        goto error;
     }
   }
 
+  for (iter = new_period->AdaptationSets; iter; iter = g_list_next (iter))
+    gst_mpdparser_inherit_adaptation_set (iter->data, new_period);
+
   *list = g_list_append (*list, new_period);
   return TRUE;
 
@@ -2100,37 +2333,37 @@ error:
 }
 
 static void
-gst_mpdparser_parse_program_info_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_program_info_node (GList ** list, xmlTextReaderPtr reader)
 {
-  xmlNode *cur_node;
+  const xmlChar *name;
+  gint depth;
   GstProgramInformationNode *new_prog_info;
 
   new_prog_info = g_slice_new0 (GstProgramInformationNode);
   *list = g_list_append (*list, new_prog_info);
 
   GST_LOG ("attributes of ProgramInformation node:");
-  gst_mpdparser_get_xml_prop_string (a_node, "lang", &new_prog_info->lang);
-  gst_mpdparser_get_xml_prop_string (a_node, "moreInformationURL",
+  gst_mpdparser_get_xml_prop_string (reader, "lang", &new_prog_info->lang);
+  gst_mpdparser_get_xml_prop_string (reader, "moreInformationURL",
       &new_prog_info->moreInformationURL);
 
   /* explore children nodes */
   GST_LOG ("children of ProgramInformation node:");
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "Title") == 0) {
-        gst_mpdparser_get_xml_node_content (cur_node, &new_prog_info->Title);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Source") == 0) {
-        gst_mpdparser_get_xml_node_content (cur_node, &new_prog_info->Source);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Copyright") == 0) {
-        gst_mpdparser_get_xml_node_content (cur_node,
-            &new_prog_info->Copyright);
-      }
+  depth = xmlTextReaderDepth (reader);
+  while (gst_mpdparser_read_child (reader, depth)) {
+    name = xmlTextReaderConstLocalName (reader);
+    if (xmlStrcmp (name, (xmlChar *) "Title") == 0) {
+      gst_mpdparser_get_xml_node_content (reader, &new_prog_info->Title);
+    } else if (xmlStrcmp (name, (xmlChar *) "Source") == 0) {
+      gst_mpdparser_get_xml_node_content (reader, &new_prog_info->Source);
+    } else if (xmlStrcmp (name, (xmlChar *) "Copyright") == 0) {
+      gst_mpdparser_get_xml_node_content (reader, &new_prog_info->Copyright);
     }
   }
 }
 
 static void
-gst_mpdparser_parse_metrics_range_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_metrics_range_node (GList ** list, xmlTextReaderPtr reader)
 {
   GstMetricsRangeNode *new_metrics_range;
 
@@ -2138,37 +2371,38 @@ gst_mpdparser_parse_metrics_range_node (GList ** list, xmlNode * a_node)
   *list = g_list_append (*list, new_metrics_range);
 
   GST_LOG ("attributes of Metrics Range node:");
-  gst_mpdparser_get_xml_prop_duration (a_node, "starttime",
+  gst_mpdparser_get_xml_prop_duration (reader, "starttime",
       GST_MPD_DURATION_NONE, &new_metrics_range->starttime);
-  gst_mpdparser_get_xml_prop_duration (a_node, "duration",
+  gst_mpdparser_get_xml_prop_duration (reader, "duration",
       GST_MPD_DURATION_NONE, &new_metrics_range->duration);
 }
 
 static void
-gst_mpdparser_parse_metrics_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_metrics_node (GList ** list, xmlTextReaderPtr reader)
 {
-  xmlNode *cur_node;
+  const xmlChar *name;
+  gint depth;
   GstMetricsNode *new_metrics;
 
   new_metrics = g_slice_new0 (GstMetricsNode);
   *list = g_list_append (*list, new_metrics);
 
   GST_LOG ("attributes of Metrics node:");
-  gst_mpdparser_get_xml_prop_string (a_node, "metrics", &new_metrics->metrics);
+  gst_mpdparser_get_xml_prop_string (reader, "metrics", &new_metrics->metrics);
 
   /* explore children nodes */
   GST_LOG ("children of Metrics node:");
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "Range") == 0) {
-        gst_mpdparser_parse_metrics_range_node (&new_metrics->MetricsRanges,
-            cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Reporting") == 0) {
-        /* No reporting scheme is specified in this part of ISO/IEC 23009.
-         * It is expected that external specifications may define formats
-         * and delivery for the reporting data. */
-        GST_LOG (" - Reporting node found (unknown structure)");
-      }
+  depth = xmlTextReaderDepth (reader);
+  while (gst_mpdparser_read_child (reader, depth)) {
+    name = xmlTextReaderConstLocalName (reader);
+    if (xmlStrcmp (name, (xmlChar *) "Range") == 0) {
+      gst_mpdparser_parse_metrics_range_node (&new_metrics->MetricsRanges,
+          reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "Reporting") == 0) {
+      /* No reporting scheme is specified in this part of ISO/IEC 23009.
+       * It is expected that external specifications may define formats
+       * and delivery for the reporting data. */
+      GST_LOG (" - Reporting node found (unknown structure)");
     }
   }
 }
@@ -2177,7 +2411,7 @@ gst_mpdparser_parse_metrics_node (GList ** list, xmlNode * a_node)
  * ISO/IEC 23009-1:2014/PDAM 1 "Information technology — Dynamic adaptive streaming over HTTP (DASH) — Part 1: Media presentation description and segment formats / Amendment 1: High Profile and Availability Time Synchronization"
  */
 static void
-gst_mpdparser_parse_utctiming_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_utctiming_node (GList ** list, xmlTextReaderPtr reader)
 {
   GstUTCTimingNode *new_timing;
   gchar *method = NULL;
@@ -2186,7 +2420,7 @@ gst_mpdparser_parse_utctiming_node (GList ** list, xmlNode * a_node)
   new_timing = g_slice_new0 (GstUTCTimingNode);
 
   GST_LOG ("attributes of UTCTiming node:");
-  if (gst_mpdparser_get_xml_prop_string (a_node, "schemeIdUri", &method)) {
+  if (gst_mpdparser_get_xml_prop_string (reader, "schemeIdUri", &method)) {
     for (int i = 0; gst_mpdparser_utc_timing_methods[i].name; ++i) {
       if (g_ascii_strncasecmp (gst_mpdparser_utc_timing_methods[i].name,
               method, strlen (gst_mpdparser_utc_timing_methods[i].name)) == 0) {
@@ -2197,7 +2431,7 @@ gst_mpdparser_parse_utctiming_node (GList ** list, xmlNode * a_node)
     xmlFree (method);
   }
 
-  if (gst_mpdparser_get_xml_prop_string (a_node, "value", &value)) {
+  if (gst_mpdparser_get_xml_prop_string (reader, "value", &value)) {
     int max_tokens = 0;
     if (GST_MPD_UTCTIMING_TYPE_DIRECT == new_timing->method) {
       /* The GST_MPD_UTCTIMING_TYPE_DIRECT method is a special case
@@ -2219,9 +2453,10 @@ gst_mpdparser_parse_utctiming_node (GList ** list, xmlNode * a_node)
 }
 
 static gboolean
-gst_mpdparser_parse_root_node (GstMPDNode ** pointer, xmlNode * a_node)
+gst_mpdparser_parse_root_node (GstMPDNode ** pointer, xmlTextReaderPtr reader)
 {
-  xmlNode *cur_node;
+  const xmlChar *name;
+  gint depth;
   GstMPDNode *new_mpd;
 
   gst_mpdparser_free_mpd_node (*pointer);
@@ -2230,53 +2465,52 @@ gst_mpdparser_parse_root_node (GstMPDNode ** pointer, xmlNode * a_node)
 
   GST_LOG ("namespaces of root MPD node:");
   new_mpd->default_namespace =
-      gst_mpdparser_get_xml_node_namespace (a_node, NULL);
-  new_mpd->namespace_xsi = gst_mpdparser_get_xml_node_namespace (a_node, "xsi");
-  new_mpd->namespace_ext = gst_mpdparser_get_xml_node_namespace (a_node, "ext");
+      gst_mpdparser_get_xml_node_namespace (reader, NULL);
+  new_mpd->namespace_xsi = gst_mpdparser_get_xml_node_namespace (reader, "xsi");
+  new_mpd->namespace_ext = gst_mpdparser_get_xml_node_namespace (reader, "ext");
 
   GST_LOG ("attributes of root MPD node:");
-  gst_mpdparser_get_xml_prop_string (a_node, "schemaLocation",
+  gst_mpdparser_get_xml_prop_string (reader, "schemaLocation",
       &new_mpd->schemaLocation);
-  gst_mpdparser_get_xml_prop_string (a_node, "id", &new_mpd->id);
-  gst_mpdparser_get_xml_prop_string (a_node, "profiles", &new_mpd->profiles);
-  gst_mpdparser_get_xml_prop_type (a_node, "type", &new_mpd->type);
-  gst_mpdparser_get_xml_prop_dateTime (a_node, "availabilityStartTime",
+  gst_mpdparser_get_xml_prop_string (reader, "id", &new_mpd->id);
+  gst_mpdparser_get_xml_prop_string (reader, "profiles", &new_mpd->profiles);
+  gst_mpdparser_get_xml_prop_type (reader, "type", &new_mpd->type);
+  gst_mpdparser_get_xml_prop_dateTime (reader, "availabilityStartTime",
       &new_mpd->availabilityStartTime);
-  gst_mpdparser_get_xml_prop_dateTime (a_node, "availabilityEndTime",
+  gst_mpdparser_get_xml_prop_dateTime (reader, "availabilityEndTime",
       &new_mpd->availabilityEndTime);
-  gst_mpdparser_get_xml_prop_duration (a_node, "mediaPresentationDuration",
+  gst_mpdparser_get_xml_prop_duration (reader, "mediaPresentationDuration",
       GST_MPD_DURATION_NONE, &new_mpd->mediaPresentationDuration);
-  gst_mpdparser_get_xml_prop_duration (a_node, "minimumUpdatePeriod",
+  gst_mpdparser_get_xml_prop_duration (reader, "minimumUpdatePeriod",
       GST_MPD_DURATION_NONE, &new_mpd->minimumUpdatePeriod);
-  gst_mpdparser_get_xml_prop_duration (a_node, "minBufferTime",
+  gst_mpdparser_get_xml_prop_duration (reader, "minBufferTime",
       GST_MPD_DURATION_NONE, &new_mpd->minBufferTime);
-  gst_mpdparser_get_xml_prop_duration (a_node, "timeShiftBufferDepth",
+  gst_mpdparser_get_xml_prop_duration (reader, "timeShiftBufferDepth",
       GST_MPD_DURATION_NONE, &new_mpd->timeShiftBufferDepth);
-  gst_mpdparser_get_xml_prop_duration (a_node, "suggestedPresentationDelay",
+  gst_mpdparser_get_xml_prop_duration (reader, "suggestedPresentationDelay",
       GST_MPD_DURATION_NONE, &new_mpd->suggestedPresentationDelay);
-  gst_mpdparser_get_xml_prop_duration (a_node, "maxSegmentDuration",
+  gst_mpdparser_get_xml_prop_duration (reader, "maxSegmentDuration",
       GST_MPD_DURATION_NONE, &new_mpd->maxSegmentDuration);
-  gst_mpdparser_get_xml_prop_duration (a_node, "maxSubsegmentDuration",
+  gst_mpdparser_get_xml_prop_duration (reader, "maxSubsegmentDuration",
       GST_MPD_DURATION_NONE, &new_mpd->maxSubsegmentDuration);
 
   /* explore children Period nodes */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "Period") == 0) {
-        if (!gst_mpdparser_parse_period_node (&new_mpd->Periods, cur_node))
-          goto error;
-      } else if (xmlStrcmp (cur_node->name,
-              (xmlChar *) "ProgramInformation") == 0) {
-        gst_mpdparser_parse_program_info_node (&new_mpd->ProgramInfo, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "BaseURL") == 0) {
-        gst_mpdparser_parse_baseURL_node (&new_mpd->BaseURLs, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Location") == 0) {
-        gst_mpdparser_parse_location_node (&new_mpd->Locations, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Metrics") == 0) {
-        gst_mpdparser_parse_metrics_node (&new_mpd->Metrics, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "UTCTiming") == 0) {
-        gst_mpdparser_parse_utctiming_node (&new_mpd->UTCTiming, cur_node);
-      }
+  depth = xmlTextReaderDepth (reader);
+  while (gst_mpdparser_read_child (reader, depth)) {
+    name = xmlTextReaderConstLocalName (reader);
+    if (xmlStrcmp (name, (xmlChar *) "Period") == 0) {
+      if (!gst_mpdparser_parse_period_node (&new_mpd->Periods, reader))
+        goto error;
+    } else if (xmlStrcmp (name, (xmlChar *) "ProgramInformation") == 0) {
+      gst_mpdparser_parse_program_info_node (&new_mpd->ProgramInfo, reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "BaseURL") == 0) {
+      gst_mpdparser_parse_baseURL_node (&new_mpd->BaseURLs, reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "Location") == 0) {
+      gst_mpdparser_parse_location_node (&new_mpd->Locations, reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "Metrics") == 0) {
+      gst_mpdparser_parse_metrics_node (&new_mpd->Metrics, reader);
+    } else if (xmlStrcmp (name, (xmlChar *) "UTCTiming") == 0) {
+      gst_mpdparser_parse_utctiming_node (&new_mpd->UTCTiming, reader);
     }
   }
 
@@ -2307,7 +2541,7 @@ static GstStreamMimeType
 gst_mpdparser_representation_get_mimetype (GstAdaptationSetNode * adapt_set,
     GstRepresentationNode * rep)
 {
-  gchar *mime = NULL;
+  const gchar *mime = NULL;
   if (rep->RepresentationBase)
     mime = rep->RepresentationBase->mimeType;
   if (mime == NULL && adapt_set->RepresentationBase) {
@@ -2325,55 +2559,59 @@ gst_mpdparser_representation_get_mimetype (GstAdaptationSetNode * adapt_set,
 }
 
 static GstRepresentationNode *
-gst_mpdparser_get_lowest_representation (GList * Representations)
+gst_mpdparser_get_lowest_representation (GArray * Representations)
 {
-  GList *list = NULL;
-  GstRepresentationNode *rep = NULL;
-  GstRepresentationNode *lowest = NULL;
+  gint idx;
 
-  if (Representations == NULL)
-    return NULL;
+  idx = gst_mpdparser_get_rep_idx_with_min_bandwidth (Representations);
 
-  for (list = g_list_first (Representations); list; list = g_list_next (list)) {
-    rep = (GstRepresentationNode *) list->data;
-    if (rep && (!lowest || rep->bandwidth < lowest->bandwidth)) {
-      lowest = rep;
-    }
+  return idx < 0 ? NULL :
+      &g_array_index (Representations, GstRepresentationNode, idx);
+}
+
+static gint
+gst_mpdparser_get_representation_index (GArray * Representations,
+    GstRepresentationNode * Representation)
+{
+  guint i;
+
+  for (i = 0; i < Representations->len; i++) {
+    if (&g_array_index (Representations, GstRepresentationNode, i) ==
+        Representation)
+      return i;
   }
 
-  return lowest;
+  return -1;
 }
 
 #if 0
 static GstRepresentationNode *
-gst_mpdparser_get_highest_representation (GList * Representations)
+gst_mpdparser_get_highest_representation (GArray * Representations)
 {
-  GList *list = NULL;
-
-  if (Representations == NULL)
+  if (Representations->len == 0)
     return NULL;
 
-  list = g_list_last (Representations);
-
-  return list ? (GstRepresentationNode *) list->data : NULL;
+  return &g_array_index (Representations, GstRepresentationNode,
+      Representations->len - 1);
 }
 
 static GstRepresentationNode *
-gst_mpdparser_get_representation_with_max_bandwidth (GList * Representations,
+gst_mpdparser_get_representation_with_max_bandwidth (GArray * Representations,
     gint max_bandwidth)
 {
-  GList *list = NULL;
   GstRepresentationNode *representation, *best_rep = NULL;
+  guint i;
 
-  if (Representations == NULL)
+  if (Representations->len == 0)
     return NULL;
 
   if (max_bandwidth <= 0)       /* 0 => get highest representation available */
     return gst_mpdparser_get_highest_representation (Representations);
 
-  for (list = g_list_first (Representations); list; list = g_list_next (list)) {
-    representation = (GstRepresentationNode *) list->data;
-    if (representation && representation->bandwidth <= max_bandwidth) {
+  for (i = 0; i < Representations->len; i++) {
+    representation =
+        &g_array_index (Representations, GstRepresentationNode, i);
+    if (representation->bandwidth <= max_bandwidth) {
       best_rep = representation;
     }
   }
@@ -2417,33 +2655,35 @@ gst_mpdparser_get_segment_base (GstPeriodNode * Period,
 }
 
 gint
-gst_mpdparser_get_rep_idx_with_min_bandwidth (GList * Representations)
+gst_mpdparser_get_rep_idx_with_min_bandwidth (GArray * Representations)
 {
-  GList *list = NULL, *lowest = NULL;
-  GstRepresentationNode *rep = NULL;
-  gint lowest_bandwidth = -1;
+  GstRepresentationNode *rep;
+  gint lowest = -1;
+  guint lowest_bandwidth = 0;
+  guint i;
 
   if (Representations == NULL)
     return -1;
 
-  for (list = g_list_first (Representations); list; list = g_list_next (list)) {
-    rep = (GstRepresentationNode *) list->data;
-    if (rep && (!lowest || rep->bandwidth < lowest_bandwidth)) {
-      lowest = list;
+  for (i = 0; i < Representations->len; i++) {
+    rep = &g_array_index (Representations, GstRepresentationNode, i);
+    if (lowest < 0 || rep->bandwidth < lowest_bandwidth) {
+      lowest = i;
       lowest_bandwidth = rep->bandwidth;
     }
   }
 
-  return lowest ? g_list_position (Representations, lowest) : -1;
+  return lowest;
 }
 
 gint
-gst_mpdparser_get_rep_idx_with_max_bandwidth (GList * Representations,
+gst_mpdparser_get_rep_idx_with_max_bandwidth (GArray * Representations,
     gint max_bandwidth)
 {
-  GList *list = NULL, *best = NULL;
   GstRepresentationNode *representation;
-  gint best_bandwidth = 0;
+  gint best = -1;
+  guint best_bandwidth = 0;
+  guint i;
 
   GST_DEBUG ("max_bandwidth = %i", max_bandwidth);
 
@@ -2453,16 +2693,17 @@ gst_mpdparser_get_rep_idx_with_max_bandwidth (GList * Representations,
   if (max_bandwidth <= 0)       /* 0 => get lowest representation available */
     return gst_mpdparser_get_rep_idx_with_min_bandwidth (Representations);
 
-  for (list = g_list_first (Representations); list; list = g_list_next (list)) {
-    representation = (GstRepresentationNode *) list->data;
-    if (representation && representation->bandwidth <= max_bandwidth &&
+  for (i = 0; i < Representations->len; i++) {
+    representation =
+        &g_array_index (Representations, GstRepresentationNode, i);
+    if (representation->bandwidth <= max_bandwidth &&
         representation->bandwidth > best_bandwidth) {
-      best = list;
+      best = i;
       best_bandwidth = representation->bandwidth;
     }
   }
 
-  return best ? g_list_position (Representations, best) : -1;
+  return best;
 }
 
 static GstSegmentListNode *
@@ -2477,7 +2718,7 @@ gst_mpd_client_fetch_external_segment_list (GstMpdClient * client,
   GstBuffer *segment_list_buffer;
   GstMapInfo map;
   GError *err = NULL;
-  xmlDocPtr doc;
+  xmlTextReaderPtr reader;
   GstUri *base_uri, *uri;
   gchar *query = NULL;
   gchar *uri_string;
@@ -2547,29 +2788,22 @@ gst_mpd_client_fetch_external_segment_list (GstMpdClient * client,
 
   gst_buffer_map (segment_list_buffer, &map, GST_MAP_READ);
 
-  doc =
-      xmlReadMemory ((const gchar *) map.data, map.size, "noname.xml", NULL,
-      XML_PARSE_NONET);
-  if (doc) {
-    xmlNode *root_element = xmlDocGetRootElement (doc);
-
-    if (root_element->type != XML_ELEMENT_NODE ||
-        xmlStrcmp (root_element->name, (xmlChar *) "SegmentList") != 0) {
-      xmlFreeDoc (doc);
-      gst_buffer_unmap (segment_list_buffer, &map);
-      gst_buffer_unref (segment_list_buffer);
+  reader =
+      gst_mpdparser_new_reader ((const gchar *) map.data, map.size,
+      "SegmentList");
+  if (reader) {
+    gst_mpdparser_parse_segment_list_node (&new_segment_list, reader);
+    if (!gst_mpdparser_read_to_end (reader)) {
+      gst_mpdparser_free_segment_list_node (new_segment_list);
+      new_segment_list = NULL;
       *error = TRUE;
-      return NULL;
+    } else {
+      gst_mpdparser_inherit_segment_list (new_segment_list, parent);
     }
-
-    gst_mpdparser_parse_segment_list_node (&new_segment_list, root_element,
-        parent);
+    xmlFreeTextReader (reader);
   } else {
-    GST_ERROR ("Failed to parse adaptation set node XML");
-    gst_buffer_unmap (segment_list_buffer, &map);
-    gst_buffer_unref (segment_list_buffer);
+    GST_ERROR ("Failed to parse segment list node XML");
     *error = TRUE;
-    return NULL;
   }
   gst_buffer_unmap (segment_list_buffer, &map);
   gst_buffer_unref (segment_list_buffer);
@@ -2614,6 +2848,18 @@ gst_mpdparser_get_segment_list (GstMpdClient * client, GstPeriodNode * Period,
   return *SegmentList;
 }
 
+static GstSegmentTemplateNode *
+gst_mpdparser_get_segment_template (GstPeriodNode * Period,
+    GstAdaptationSetNode * AdaptationSet,
+    GstRepresentationNode * Representation)
+{
+  if (Representation && Representation->SegmentTemplate)
+    return Representation->SegmentTemplate;
+  if (AdaptationSet && AdaptationSet->SegmentTemplate)
+    return AdaptationSet->SegmentTemplate;
+  return Period->SegmentTemplate;
+}
+
 /* memory management functions */
 static void
 gst_mpdparser_free_mpd_node (GstMPDNode * mpd_node)
@@ -2724,14 +2970,6 @@ gst_mpdparser_free_segment_template_node (GstSegmentTemplateNode *
     segment_template_node)
 {
   if (segment_template_node) {
-    if (segment_template_node->media)
-      xmlFree (segment_template_node->media);
-    if (segment_template_node->index)
-      xmlFree (segment_template_node->index);
-    if (segment_template_node->initialization)
-      xmlFree (segment_template_node->initialization);
-    if (segment_template_node->bitstreamSwitching)
-      xmlFree (segment_template_node->bitstreamSwitching);
     /* MultipleSegmentBaseType extension */
     gst_mpdparser_free_mult_seg_base_type_ext
         (segment_template_node->MultSegBaseType);
@@ -2752,12 +2990,8 @@ gst_mpdparser_free_representation_base_type (GstRepresentationBaseType *
     g_slice_free (GstFrameRate, representation_base->maxFrameRate);
     if (representation_base->audioSamplingRate)
       xmlFree (representation_base->audioSamplingRate);
-    if (representation_base->mimeType)
-      xmlFree (representation_base->mimeType);
     if (representation_base->segmentProfiles)
       xmlFree (representation_base->segmentProfiles);
-    if (representation_base->codecs)
-      xmlFree (representation_base->codecs);
     if (representation_base->scanType)
       xmlFree (representation_base->scanType);
     g_list_free_full (representation_base->FramePacking,
@@ -2800,8 +3034,8 @@ gst_mpdparser_free_adaptation_set_node (GstAdaptationSetNode *
         (adaptation_set_node->SegmentTemplate);
     g_list_free_full (adaptation_set_node->BaseURLs,
         (GDestroyNotify) gst_mpdparser_free_base_url_node);
-    g_list_free_full (adaptation_set_node->Representations,
-        (GDestroyNotify) gst_mpdparser_free_representation_node);
+    if (adaptation_set_node->Representations)
+      g_array_free (adaptation_set_node->Representations, TRUE);
     g_list_free_full (adaptation_set_node->ContentComponents,
         (GDestroyNotify) gst_mpdparser_free_content_component_node);
     if (adaptation_set_node->xlink_href)
@@ -2811,7 +3045,7 @@ gst_mpdparser_free_adaptation_set_node (GstAdaptationSetNode *
 }
 
 static void
-gst_mpdparser_free_representation_node (GstRepresentationNode *
+gst_mpdparser_clear_representation_node (GstRepresentationNode *
     representation_node)
 {
   if (representation_node) {
@@ -2829,7 +3063,6 @@ gst_mpdparser_free_representation_node (GstRepresentationNode *
     gst_mpdparser_free_segment_list_node (representation_node->SegmentList);
     g_list_free_full (representation_node->BaseURLs,
         (GDestroyNotify) gst_mpdparser_free_base_url_node);
-    g_slice_free (GstRepresentationNode, representation_node);
   }
 }
 
@@ -2847,20 +3080,12 @@ gst_mpdparser_free_subrepresentation_node (GstSubRepresentationNode *
   }
 }
 
-static void
-gst_mpdparser_free_s_node (GstSNode * s_node)
-{
-  if (s_node) {
-    g_slice_free (GstSNode, s_node);
-  }
-}
-
 static GstSegmentTimelineNode *
 gst_mpdparser_segment_timeline_node_new (void)
 {
   GstSegmentTimelineNode *node = g_slice_new0 (GstSegmentTimelineNode);
 
-  g_queue_init (&node->S);
+  node->S = g_array_new (FALSE, FALSE, sizeof (GstSNode));
 
   return node;
 }
@@ -2869,8 +3094,7 @@ static void
 gst_mpdparser_free_segment_timeline_node (GstSegmentTimelineNode * seg_timeline)
 {
   if (seg_timeline) {
-    g_queue_foreach (&seg_timeline->S, (GFunc) gst_mpdparser_free_s_node, NULL);
-    g_queue_clear (&seg_timeline->S);
+    g_array_free (seg_timeline->S, TRUE);
     g_slice_free (GstSegmentTimelineNode, seg_timeline);
   }
 }
@@ -2916,8 +3140,8 @@ static void
 gst_mpdparser_free_segment_list_node (GstSegmentListNode * segment_list_node)
 {
   if (segment_list_node) {
-    g_list_free_full (segment_list_node->SegmentURL,
-        (GDestroyNotify) gst_mpdparser_free_segment_url_node);
+    if (segment_list_node->SegmentURL)
+      g_array_free (segment_list_node->SegmentURL, TRUE);
     /* MultipleSegmentBaseType extension */
     gst_mpdparser_free_mult_seg_base_type_ext
         (segment_list_node->MultSegBaseType);
@@ -2928,7 +3152,7 @@ gst_mpdparser_free_segment_list_node (GstSegmentListNode * segment_list_node)
 }
 
 static void
-gst_mpdparser_free_segment_url_node (GstSegmentURLNode * segment_url)
+gst_mpdparser_clear_segment_url_node (GstSegmentURLNode * segment_url)
 {
   if (segment_url) {
     if (segment_url->media)
@@ -2937,7 +3161,6 @@ gst_mpdparser_free_segment_url_node (GstSegmentURLNode * segment_url)
     if (segment_url->index)
       xmlFree (segment_url->index);
     g_slice_free (GstRange, segment_url->indexRange);
-    g_slice_free (GstSegmentURLNode, segment_url);
   }
 }
 
@@ -3007,21 +3230,15 @@ gst_mpdparser_free_stream_period (GstStreamPeriod * stream_period)
   }
 }
 
+/* the segments are stored inline, one allocation for the whole list;
+ * reserved is the number of entries that are going to be added */
 static void
-gst_mpdparser_free_media_segment (GstMediaSegment * media_segment)
-{
-  if (media_segment) {
-    g_slice_free (GstMediaSegment, media_segment);
-  }
-}
-
-static void
-gst_mpdparser_init_active_stream_segments (GstActiveStream * stream)
+gst_mpdparser_init_active_stream_segments (GstActiveStream * stream,
+    guint reserved)
 {
   g_assert (stream->segments == NULL);
-  stream->segments = g_ptr_array_new ();
-  g_ptr_array_set_free_func (stream->segments,
-      (GDestroyNotify) gst_mpdparser_free_media_segment);
+  stream->segments =
+      g_array_sized_new (FALSE, FALSE, sizeof (GstMediaSegment), reserved);
 }
 
 static void
@@ -3033,7 +3250,7 @@ gst_mpdparser_free_active_stream (GstActiveStream * active_stream)
     g_free (active_stream->queryURL);
     active_stream->queryURL = NULL;
     if (active_stream->segments)
-      g_ptr_array_unref (active_stream->segments);
+      g_array_unref (active_stream->segments);
     g_slice_free (GstActiveStream, active_stream);
   }
 }
@@ -3613,7 +3830,7 @@ gst_mpd_client_fetch_on_load_external_resources (GstMpdClient * client)
 
     for (m = period->AdaptationSets; m; /* explicitly advanced below */ ) {
       GstAdaptationSetNode *adapt_set = m->data;
-      GList *n;
+      guint n;
 
       if (adapt_set->xlink_href
           && adapt_set->actuate == GST_XLINK_ACTUATE_ON_LOAD) {
@@ -3672,8 +3889,10 @@ gst_mpd_client_fetch_on_load_external_resources (GstMpdClient * client)
         adapt_set->SegmentList = new_segment_list;
       }
 
-      for (n = adapt_set->Representations; n; n = n->next) {
-        GstRepresentationNode *representation = n->data;
+      for (n = 0; n < adapt_set->Representations->len; n++) {
+        GstRepresentationNode *representation =
+            &g_array_index (adapt_set->Representations, GstRepresentationNode,
+            n);
 
         if (representation->SegmentList
             && representation->SegmentList->xlink_href
@@ -3716,39 +3935,25 @@ gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
   gboolean ret = FALSE;
 
   if (data) {
-    xmlDocPtr doc;
-    xmlNode *root_element = NULL;
+    xmlTextReaderPtr reader;
 
     GST_DEBUG ("MPD file fully buffered, start parsing...");
 
-    /* parse the complete MPD file into a tree (using the libxml2 default parser API) */
-
-    /* this initialize the library and check potential ABI mismatches
-     * between the version it was compiled for and the actual shared
-     * library used
-     */
-    LIBXML_TEST_VERSION;
-
-    /* parse "data" into a document (which is a libxml2 tree structure xmlDoc) */
-    doc = xmlReadMemory (data, size, "noname.xml", NULL, XML_PARSE_NONET);
-    if (doc == NULL) {
+    /* parse the MPD file while reading it (using the libxml2 xmlReader API),
+     * without building a tree of the whole document first */
+    reader = gst_mpdparser_new_reader (data, size, "MPD");
+    if (reader == NULL) {
       GST_ERROR ("failed to parse the MPD file");
       ret = FALSE;
     } else {
-      /* get the root element node */
-      root_element = xmlDocGetRootElement (doc);
-
-      if (root_element->type != XML_ELEMENT_NODE
-          || xmlStrcmp (root_element->name, (xmlChar *) "MPD") != 0) {
-        GST_ERROR
-            ("can not find the root element MPD, failed to parse the MPD file");
-        ret = FALSE;            /* used to return TRUE before, but this seems wrong */
-      } else {
-        /* now we can parse the MPD root node and all children nodes, recursively */
-        ret = gst_mpdparser_parse_root_node (&client->mpd_node, root_element);
+      /* now we can parse the MPD root node and all children nodes, recursively */
+      ret = gst_mpdparser_parse_root_node (&client->mpd_node, reader);
+      if (ret && !gst_mpdparser_read_to_end (reader)) {
+        gst_mpdparser_free_mpd_node (client->mpd_node);
+        client->mpd_node = NULL;
+        ret = FALSE;
       }
-      /* free the document */
-      xmlFreeDoc (doc);
+      xmlFreeTextReader (reader);
     }
 
     if (ret) {
@@ -3776,7 +3981,7 @@ gst_mpdparser_get_baseURL (GstMpdClient * client, guint indexStream)
 }
 
 static GstClockTime
-gst_mpdparser_get_segment_end_time (GstMpdClient * client, GPtrArray * segments,
+gst_mpdparser_get_segment_end_time (GstMpdClient * client, GArray * segments,
     const GstMediaSegment * segment, gint index)
 {
   const GstStreamPeriod *stream_period;
@@ -3787,7 +3992,7 @@ gst_mpdparser_get_segment_end_time (GstMpdClient * client, GPtrArray * segments,
 
   if (index < segments->len - 1) {
     const GstMediaSegment *next_segment =
-        g_ptr_array_index (segments, index + 1);
+        &g_array_index (segments, GstMediaSegment, index + 1);
     end = next_segment->start;
   } else {
     stream_period = gst_mpdparser_get_stream_period (client);
@@ -3802,21 +4007,19 @@ gst_mpd_client_add_media_segment (GstActiveStream * stream,
     guint64 scale_start, guint64 scale_duration,
     GstClockTime start, GstClockTime duration)
 {
-  GstMediaSegment *media_segment;
+  GstMediaSegment media_segment;
 
   g_return_val_if_fail (stream->segments != NULL, FALSE);
 
-  media_segment = g_slice_new0 (GstMediaSegment);
+  media_segment.SegmentURL = url_node;
+  media_segment.number = number;
+  media_segment.scale_start = scale_start;
+  media_segment.scale_duration = scale_duration;
+  media_segment.start = start;
+  media_segment.duration = duration;
+  media_segment.repeat = repeat;
 
-  media_segment->SegmentURL = url_node;
-  media_segment->number = number;
-  media_segment->scale_start = scale_start;
-  media_segment->scale_duration = scale_duration;
-  media_segment->start = start;
-  media_segment->duration = duration;
-  media_segment->repeat = repeat;
-
-  g_ptr_array_add (stream->segments, media_segment);
+  g_array_append_val (stream->segments, media_segment);
   GST_LOG ("Added new segment: number %d, repeat %d, "
       "ts: %" GST_TIME_FORMAT ", dur: %"
       GST_TIME_FORMAT, number, repeat,
@@ -3858,7 +4061,6 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
     GstActiveStream * stream, GstRepresentationNode * representation)
 {
   GstStreamPeriod *stream_period;
-  GList *rep_list;
   GstClockTime PeriodStart, PeriodEnd, start_time, duration;
   GstMediaSegment *last_media_segment;
   guint i;
@@ -3869,13 +4071,14 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
     return FALSE;
   }
 
-  rep_list = stream->cur_adapt_set->Representations;
   stream->cur_representation = representation;
-  stream->representation_idx = g_list_index (rep_list, representation);
+  stream->representation_idx =
+      gst_mpdparser_get_representation_index (stream->cur_adapt_set->
+      Representations, representation);
 
   /* clean the old segment list, if any */
   if (stream->segments) {
-    g_ptr_array_unref (stream->segments);
+    g_array_unref (stream->segments);
     stream->segments = NULL;
   }
 
@@ -3894,11 +4097,8 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
 
   if (representation->SegmentBase != NULL
       || representation->SegmentList != NULL) {
-    GList *SegmentURL;
-
-    /* We have a fixed list of segments for any of the cases here,
-     * init the segments list */
-    gst_mpdparser_init_active_stream_segments (stream);
+    GArray *SegmentURL;
+    guint n;
 
     /* get the first segment_base of the selected representation */
     if ((stream->cur_segment_base =
@@ -3912,15 +4112,18 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
             gst_mpdparser_get_segment_list (client, stream_period->period,
                 stream->cur_adapt_set, representation)) == NULL) {
       GST_DEBUG ("No useful SegmentList node for the current Representation");
+      gst_mpdparser_init_active_stream_segments (stream, 1);
       /* here we should have a single segment for each representation, whose URL is encoded in the baseURL element */
       if (!gst_mpd_client_add_media_segment (stream, NULL, 1, 0, 0,
               PeriodEnd - PeriodStart, 0, PeriodEnd - PeriodStart)) {
         return FALSE;
       }
     } else {
-      /* build the list of GstMediaSegment nodes from the SegmentList node */
+      /* build the list of GstMediaSegment nodes from the SegmentList node,
+       * there is at most one entry per SegmentURL */
       SegmentURL = stream->cur_segment_list->SegmentURL;
-      if (SegmentURL == NULL) {
+      gst_mpdparser_init_active_stream_segments (stream, SegmentURL->len);
+      if (SegmentURL->len == 0) {
         GST_WARNING
             ("No valid list of SegmentURL nodes in the MPD file, aborting...");
         return FALSE;
@@ -3935,14 +4138,12 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
       if (stream->cur_segment_list->MultSegBaseType->SegmentTimeline) {
         GstSegmentTimelineNode *timeline;
         GstSNode *S;
-        GList *list;
 
         timeline = stream->cur_segment_list->MultSegBaseType->SegmentTimeline;
-        for (list = g_queue_peek_head_link (&timeline->S); list;
-            list = g_list_next (list)) {
+        for (n = 0; n < timeline->S->len; n++) {
           guint timescale;
 
-          S = (GstSNode *) list->data;
+          S = &g_array_index (timeline->S, GstSNode, n);
           GST_LOG ("Processing S node: d=%" G_GUINT64_FORMAT " r=%d t=%"
               G_GUINT64_FORMAT, S->d, S->r, S->t);
           timescale =
@@ -3954,20 +4155,20 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
             start_time = gst_util_uint64_scale (S->t, GST_SECOND, timescale);
           }
 
-          if (!SegmentURL) {
+          if (n >= SegmentURL->len) {
             GST_WARNING
                 ("SegmentTimeline does not have a matching SegmentURL, aborting...");
             return FALSE;
           }
 
-          if (!gst_mpd_client_add_media_segment (stream, SegmentURL->data, i,
+          if (!gst_mpd_client_add_media_segment (stream,
+                  &g_array_index (SegmentURL, GstSegmentURLNode, n), i,
                   S->r, start, S->d, start_time, duration)) {
             return FALSE;
           }
           i += S->r + 1;
           start_time += duration * (S->r + 1);
           start += S->d * (S->r + 1);
-          SegmentURL = g_list_next (SegmentURL);
         }
       } else {
         guint64 scale_dur;
@@ -3977,15 +4178,15 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
         if (!GST_CLOCK_TIME_IS_VALID (duration))
           return FALSE;
 
-        while (SegmentURL) {
-          if (!gst_mpd_client_add_media_segment (stream, SegmentURL->data, i,
+        for (n = 0; n < SegmentURL->len; n++) {
+          if (!gst_mpd_client_add_media_segment (stream,
+                  &g_array_index (SegmentURL, GstSegmentURLNode, n), i,
                   0, start, scale_dur, start_time, duration)) {
             return FALSE;
           }
           i++;
           start += scale_dur;
           start_time += duration;
-          SegmentURL = g_list_next (SegmentURL);
         }
       }
     }
@@ -4001,7 +4202,7 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
     if (stream->cur_seg_template == NULL
         || stream->cur_seg_template->MultSegBaseType == NULL) {
 
-      gst_mpdparser_init_active_stream_segments (stream);
+      gst_mpdparser_init_active_stream_segments (stream, 1);
       /* here we should have a single segment for each representation, whose URL is encoded in the baseURL element */
       if (!gst_mpd_client_add_media_segment (stream, NULL, 1, 0, 0,
               PeriodEnd - PeriodStart, 0, PeriodEnd - PeriodStart)) {
@@ -4021,15 +4222,15 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
       if (mult_seg->SegmentTimeline) {
         GstSegmentTimelineNode *timeline;
         GstSNode *S;
-        GList *list;
+        guint n;
 
         timeline = mult_seg->SegmentTimeline;
-        gst_mpdparser_init_active_stream_segments (stream);
-        for (list = g_queue_peek_head_link (&timeline->S); list;
-            list = g_list_next (list)) {
+        /* one entry per S node, repetitions are not expanded */
+        gst_mpdparser_init_active_stream_segments (stream, timeline->S->len);
+        for (n = 0; n < timeline->S->len; n++) {
           guint timescale;
 
-          S = (GstSNode *) list->data;
+          S = &g_array_index (timeline->S, GstSNode, n);
           GST_LOG ("Processing S node: d=%" G_GUINT64_FORMAT " r=%u t=%"
               G_GUINT64_FORMAT, S->d, S->r, S->t);
           timescale = mult_seg->SegBaseType->timescale;
@@ -4056,7 +4257,8 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
 
   /* check duration of last segment */
   last_media_segment = (stream->segments && stream->segments->len) ?
-      g_ptr_array_index (stream->segments, stream->segments->len - 1) : NULL;
+      &g_array_index (stream->segments, GstMediaSegment,
+      stream->segments->len - 1) : NULL;
 
   if (last_media_segment && GST_CLOCK_TIME_IS_VALID (PeriodEnd)) {
     if (last_media_segment->start + last_media_segment->duration > PeriodEnd) {
@@ -4078,6 +4280,248 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
   return TRUE;
 }
 
+/* Finds the nodes of @client's current period that correspond to the ones
+ * used by @stream in @old_client. Only SegmentTemplate based streams are
+ * handled, and the representations of the AdaptationSet and the way their
+ * segments are addressed must not have changed */
+static gboolean
+gst_mpd_client_match_active_stream (GstMpdClient * client,
+    GstMpdClient * old_client, GstActiveStream * stream,
+    GstAdaptationSetNode ** adapt_set, GstSegmentTemplateNode ** seg_template)
+{
+  GstStreamPeriod *stream_period;
+  GstMultSegmentBaseType *mult_seg, *old_mult_seg;
+  GArray *reps, *old_reps;
+  gint idx;
+  guint i;
+
+  if (stream->cur_adapt_set == NULL || stream->cur_representation == NULL
+      || stream->cur_seg_template == NULL
+      || stream->cur_seg_template->MultSegBaseType == NULL
+      || stream->cur_segment_base != NULL || stream->cur_segment_list != NULL)
+    return FALSE;
+
+  idx = g_list_index (gst_mpd_client_get_adaptation_sets (old_client),
+      stream->cur_adapt_set);
+  if (idx < 0)
+    return FALSE;
+  *adapt_set = g_list_nth_data (gst_mpd_client_get_adaptation_sets (client),
+      idx);
+  if (*adapt_set == NULL || (*adapt_set)->id != stream->cur_adapt_set->id)
+    return FALSE;
+
+  /* representations are selected by index */
+  reps = (*adapt_set)->Representations;
+  old_reps = stream->cur_adapt_set->Representations;
+  if (reps->len != old_reps->len)
+    return FALSE;
+  for (i = 0; i < reps->len; i++) {
+    GstRepresentationNode *rep =
+        &g_array_index (reps, GstRepresentationNode, i);
+    GstRepresentationNode *old_rep =
+        &g_array_index (old_reps, GstRepresentationNode, i);
+
+    if (g_strcmp0 (rep->id, old_rep->id) != 0
+        || rep->bandwidth != old_rep->bandwidth)
+      return FALSE;
+  }
+
+  stream_period = gst_mpdparser_get_stream_period (client);
+  *seg_template = gst_mpdparser_get_segment_template (stream_period->period,
+      *adapt_set, &g_array_index (reps, GstRepresentationNode,
+          stream->representation_idx));
+  if (*seg_template == NULL || (*seg_template)->MultSegBaseType == NULL)
+    return FALSE;
+
+  mult_seg = (*seg_template)->MultSegBaseType;
+  old_mult_seg = stream->cur_seg_template->MultSegBaseType;
+  if (mult_seg->SegBaseType->timescale != old_mult_seg->SegBaseType->timescale
+      || (mult_seg->SegmentTimeline == NULL) !=
+      (old_mult_seg->SegmentTimeline == NULL))
+    return FALSE;
+
+  /* without a timeline the segments are computed from the template, their
+   * numbering must stay the same */
+  if (mult_seg->SegmentTimeline == NULL)
+    return mult_seg->startNumber == old_mult_seg->startNumber
+        && mult_seg->duration == old_mult_seg->duration;
+
+  return stream->segments != NULL && stream->segments->len > 0;
+}
+
+/* Appends to the segment list of @stream the entries of @mult_seg's
+ * SegmentTimeline that follow the last known one, and drops the entries that
+ * went out of the timeline and were already played. The timeline must
+ * continue the current segment numbering, which is only verified unless
+ * @apply is set */
+static gboolean
+gst_mpd_client_update_timeline_segments (GstActiveStream * stream,
+    GstMultSegmentBaseType * mult_seg, gboolean apply)
+{
+  GstMediaSegment *last;
+  GArray *timeline;
+  guint timescale;
+  guint64 start, end;
+  guint number, next_number;
+  guint i, n, expired;
+
+  timescale = mult_seg->SegBaseType->timescale;
+  last = &g_array_index (stream->segments, GstMediaSegment,
+      stream->segments->len - 1);
+  if (last->repeat < 0)
+    return FALSE;
+
+  end = last->scale_start + (last->repeat + 1) * last->scale_duration;
+  next_number = last->number + last->repeat + 1;
+
+  number = mult_seg->startNumber;
+  start = 0;
+  timeline = mult_seg->SegmentTimeline->S;
+  for (n = 0; n < timeline->len; n++) {
+    GstSNode *S = &g_array_index (timeline, GstSNode, n);
+    guint skip = 0;
+
+    if (S->t > 0)
+      start = S->t;
+    if (S->r < 0 || S->d == 0)
+      return FALSE;
+
+    if (start + S->d * (S->r + 1) > end) {
+      /* the S node starts within the last known segments, only its remaining
+       * repetitions are new */
+      if (start < end) {
+        if ((end - start) % S->d != 0)
+          return FALSE;
+        skip = (end - start) / S->d;
+      }
+      if (number + skip != next_number)
+        return FALSE;
+
+      if (apply) {
+        guint64 scale_start = start + skip * S->d;
+
+        if (scale_start == end && S->d == last->scale_duration) {
+          last->repeat += S->r + 1 - skip;
+        } else {
+          gst_mpd_client_add_media_segment (stream, NULL, number + skip,
+              S->r - skip, scale_start, S->d,
+              gst_util_uint64_scale (scale_start, GST_SECOND, timescale),
+              gst_util_uint64_scale (S->d, GST_SECOND, timescale));
+        }
+        last = &g_array_index (stream->segments, GstMediaSegment,
+            stream->segments->len - 1);
+      }
+      next_number = number + S->r + 1;
+      end = start + S->d * (S->r + 1);
+    }
+
+    number += S->r + 1;
+    start += S->d * (S->r + 1);
+  }
+
+  if (!apply)
+    return TRUE;
+
+  /* the segments that ended before the start of the new timeline can't be
+   * requested anymore */
+  start = timeline->len ? g_array_index (timeline, GstSNode, 0).t : 0;
+  for (expired = 0, i = 0; (gint) i < stream->segment_index; i++, expired++) {
+    GstMediaSegment *segment =
+        &g_array_index (stream->segments, GstMediaSegment, i);
+
+    if (segment->repeat < 0 || segment->scale_start +
+        (segment->repeat + 1) * segment->scale_duration > start)
+      break;
+  }
+  if (expired > 0) {
+    g_array_remove_range (stream->segments, 0, expired);
+    stream->segment_index -= expired;
+  }
+
+  GST_LOG ("Updated segment list: %u segments, %u expired",
+      stream->segments->len, expired);
+  return TRUE;
+}
+
+/**
+ * gst_mpd_client_update_active_streams:
+ * @client: a #GstMpdClient holding a refreshed version of the manifest,
+ *     with its current period already selected
+ * @old_client: the #GstMpdClient holding the active streams
+ *
+ * Moves the active streams of @old_client to @client when the structure of
+ * the manifest did not change, appending the new SegmentTimeline entries to
+ * them. The streams keep their representation and position.
+ *
+ * Returns: %TRUE if the streams were moved, %FALSE if they have to be setup
+ * again from @client, in which case nothing was changed.
+ */
+gboolean
+gst_mpd_client_update_active_streams (GstMpdClient * client,
+    GstMpdClient * old_client)
+{
+  GstStreamPeriod *stream_period, *old_stream_period;
+  GstAdaptationSetNode *adapt_set;
+  GstSegmentTemplateNode *seg_template;
+  GList *iter;
+
+  g_return_val_if_fail (client->active_streams == NULL, FALSE);
+
+  stream_period = gst_mpdparser_get_stream_period (client);
+  old_stream_period = gst_mpdparser_get_stream_period (old_client);
+  if (stream_period == NULL || old_stream_period == NULL
+      || old_client->active_streams == NULL)
+    return FALSE;
+
+  /* the last segment of a period with a known end has to be fixed up, which
+   * is only done when setting up the segment list */
+  if (GST_CLOCK_TIME_IS_VALID (stream_period->duration)
+      || stream_period->start != old_stream_period->start
+      || g_strcmp0 (stream_period->period->id,
+          old_stream_period->period->id) != 0)
+    return FALSE;
+
+  /* check all the streams before touching any of them */
+  for (iter = old_client->active_streams; iter; iter = g_list_next (iter)) {
+    GstActiveStream *stream = iter->data;
+
+    if (!gst_mpd_client_match_active_stream (client, old_client, stream,
+            &adapt_set, &seg_template))
+      return FALSE;
+    if (seg_template->MultSegBaseType->SegmentTimeline
+        && !gst_mpd_client_update_timeline_segments (stream,
+            seg_template->MultSegBaseType, FALSE))
+      return FALSE;
+  }
+
+  for (iter = old_client->active_streams; iter; iter = g_list_next (iter)) {
+    GstActiveStream *stream = iter->data;
+
+    gst_mpd_client_match_active_stream (client, old_client, stream,
+        &adapt_set, &seg_template);
+    if (seg_template->MultSegBaseType->SegmentTimeline)
+      gst_mpd_client_update_timeline_segments (stream,
+          seg_template->MultSegBaseType, TRUE);
+
+    stream->cur_adapt_set = adapt_set;
+    stream->cur_representation =
+        &g_array_index (adapt_set->Representations, GstRepresentationNode,
+        stream->representation_idx);
+    stream->cur_seg_template = seg_template;
+
+    g_free (stream->baseURL);
+    g_free (stream->queryURL);
+    stream->baseURL =
+        gst_mpdparser_parse_baseURL (client, stream, &stream->queryURL);
+    gst_mpd_client_stream_update_presentation_time_offset (client, stream);
+  }
+
+  client->active_streams = old_client->active_streams;
+  old_client->active_streams = NULL;
+
+  return TRUE;
+}
+
 static GList *
 gst_mpd_client_fetch_external_period (GstMpdClient * client,
     GstPeriodNode * period_node, gboolean * error)
@@ -4086,7 +4530,7 @@ gst_mpd_client_fetch_external_period (GstMpdClient * client,
   GstBuffer *period_buffer;
   GstMapInfo map;
   GError *err = NULL;
-  xmlDocPtr doc;
+  xmlTextReaderPtr reader;
   GstUri *base_uri, *uri;
   gchar *query = NULL;
   gchar *uri_string;
@@ -4142,27 +4586,20 @@ gst_mpd_client_fetch_external_period (GstMpdClient * client,
 
   gst_buffer_map (period_buffer, &map, GST_MAP_READ);
 
-  doc =
-      xmlReadMemory ((const gchar *) map.data, map.size, "noname.xml", NULL,
-      XML_PARSE_NONET);
-  if (doc) {
-    xmlNode *root_element = xmlDocGetRootElement (doc);
-    if (root_element->type != XML_ELEMENT_NODE ||
-        xmlStrcmp (root_element->name, (xmlChar *) "Period") != 0) {
-      xmlFreeDoc (doc);
-      gst_buffer_unmap (period_buffer, &map);
-      gst_buffer_unref (period_buffer);
+  reader =
+      gst_mpdparser_new_reader ((const gchar *) map.data, map.size, "Period");
+  if (reader) {
+    gst_mpdparser_parse_period_node (&new_periods, reader);
+    if (!gst_mpdparser_read_to_end (reader)) {
+      g_list_free_full (new_periods,
+          (GDestroyNotify) gst_mpdparser_free_period_node);
+      new_periods = NULL;
       *error = TRUE;
-      return NULL;
     }
-
-    gst_mpdparser_parse_period_node (&new_periods, root_element);
+    xmlFreeTextReader (reader);
   } else {
     GST_ERROR ("Failed to parse period node XML");
-    gst_buffer_unmap (period_buffer, &map);
-    gst_buffer_unref (period_buffer);
     *error = TRUE;
-    return NULL;
   }
   gst_buffer_unmap (period_buffer, &map);
   gst_buffer_unref (period_buffer);
@@ -4424,7 +4861,7 @@ gst_mpd_client_fetch_external_adaptation_set (GstMpdClient * client,
   GstBuffer *adapt_set_buffer;
   GstMapInfo map;
   GError *err = NULL;
-  xmlDocPtr doc;
+  xmlTextReaderPtr reader;
   GstUri *base_uri, *uri;
   gchar *query = NULL;
   gchar *uri_string;
@@ -4483,29 +4920,23 @@ gst_mpd_client_fetch_external_adaptation_set (GstMpdClient * client,
 
   gst_buffer_map (adapt_set_buffer, &map, GST_MAP_READ);
 
-  doc =
-      xmlReadMemory ((const gchar *) map.data, map.size, "noname.xml", NULL,
-      XML_PARSE_NONET);
-  if (doc) {
-    xmlNode *root_element = xmlDocGetRootElement (doc);
-
-    if (root_element->type != XML_ELEMENT_NODE ||
-        xmlStrcmp (root_element->name, (xmlChar *) "AdaptationSet") != 0) {
-      xmlFreeDoc (doc);
-      gst_buffer_unmap (adapt_set_buffer, &map);
-      gst_buffer_unref (adapt_set_buffer);
+  reader =
+      gst_mpdparser_new_reader ((const gchar *) map.data, map.size,
+      "AdaptationSet");
+  if (reader) {
+    gst_mpdparser_parse_adaptation_set_node (&new_adapt_sets, reader, period);
+    if (!gst_mpdparser_read_to_end (reader)) {
+      g_list_free_full (new_adapt_sets,
+          (GDestroyNotify) gst_mpdparser_free_adaptation_set_node);
+      new_adapt_sets = NULL;
       *error = TRUE;
-      return NULL;
+    } else if (new_adapt_sets) {
+      gst_mpdparser_inherit_adaptation_set (new_adapt_sets->data, period);
     }
-
-    gst_mpdparser_parse_adaptation_set_node (&new_adapt_sets, root_element,
-        period);
+    xmlFreeTextReader (reader);
   } else {
     GST_ERROR ("Failed to parse adaptation set node XML");
-    gst_buffer_unmap (adapt_set_buffer, &map);
-    gst_buffer_unref (adapt_set_buffer);
     *error = TRUE;
-    return NULL;
   }
   gst_buffer_unmap (adapt_set_buffer, &map);
   gst_buffer_unref (adapt_set_buffer);
@@ -4588,17 +5019,17 @@ gst_mpd_client_setup_streaming (GstMpdClient * client,
     GstAdaptationSetNode * adapt_set)
 {
   GstRepresentationNode *representation;
-  GList *rep_list = NULL;
+  GArray *rep_list = NULL;
   GstActiveStream *stream;
 
   rep_list = adapt_set->Representations;
-  if (!rep_list) {
+  if (rep_list->len == 0) {
     GST_WARNING ("Can not retrieve any representation, aborting...");
     return FALSE;
   }
 
   stream = g_slice_new0 (GstActiveStream);
-  gst_mpdparser_init_active_stream_segments (stream);
+  gst_mpdparser_init_active_stream_segments (stream, 0);
 
   stream->baseURL_idx = 0;
   stream->cur_adapt_set = adapt_set;
@@ -4663,56 +5094,65 @@ gst_mpd_client_stream_seek (GstMpdClient * client, GstActiveStream * stream,
   g_return_val_if_fail (stream != NULL, 0);
 
   if (stream->segments) {
-    for (index = 0; index < stream->segments->len; index++) {
-      GstMediaSegment *segment = g_ptr_array_index (stream->segments, index);
-
-      GST_DEBUG ("Looking at fragment sequence chunk %d / %d", index,
-          stream->segments->len);
-      in_segment = FALSE;
-      if (segment->start <= ts) {
-        GstClockTime end_time;
-
-        if (segment->repeat >= 0) {
-          end_time = segment->start + (segment->repeat + 1) * segment->duration;
-        } else {
-          end_time =
-              gst_mpdparser_get_segment_end_time (client, stream->segments,
-              segment, index);
-        }
-
-        /* avoid downloading another fragment just for 1ns in reverse mode */
-        if (forward)
-          in_segment = ts < end_time;
-        else
-          in_segment = ts <= end_time;
-
-        if (in_segment) {
-          selectedChunk = segment;
-          repeat_index = (ts - segment->start) / segment->duration;
+    guint lo = 0, hi = stream->segments->len;
+
+    /* the segments are sorted and do not overlap, so their end times are
+     * sorted too: look for the first segment ending after ts */
+    while (lo < hi) {
+      guint mid = lo + (hi - lo) / 2;
+      GstMediaSegment *segment =
+          &g_array_index (stream->segments, GstMediaSegment, mid);
+      GstClockTime end_time;
+
+      end_time = gst_mpdparser_get_segment_end_time (client, stream->segments,
+          segment, mid);
+
+      /* avoid downloading another fragment just for 1ns in reverse mode */
+      if (forward)
+        in_segment = ts < end_time;
+      else
+        in_segment = ts <= end_time;
 
-          /* At the end of a segment in reverse mode, start from the previous fragment */
-          if (!forward && repeat_index > 0
-              && ((ts - segment->start) % segment->duration == 0))
-            repeat_index--;
+      if (in_segment)
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+    index = lo;
 
-          if ((flags & GST_SEEK_FLAG_SNAP_NEAREST) ==
-              GST_SEEK_FLAG_SNAP_NEAREST) {
-            /* FIXME implement this */
-          } else if ((forward && flags & GST_SEEK_FLAG_SNAP_AFTER) ||
-              (!forward && flags & GST_SEEK_FLAG_SNAP_BEFORE)) {
+    GST_DEBUG ("Looking at fragment sequence chunk %d / %d", index,
+        stream->segments->len);
+    if (index < stream->segments->len) {
+      GstMediaSegment *segment =
+          &g_array_index (stream->segments, GstMediaSegment, index);
 
-            if (repeat_index + 1 < segment->repeat) {
-              repeat_index++;
+      if (segment->start <= ts) {
+        selectedChunk = segment;
+        repeat_index = (ts - segment->start) / segment->duration;
+
+        /* At the end of a segment in reverse mode, start from the previous
+         * fragment */
+        if (!forward && repeat_index > 0
+            && ((ts - segment->start) % segment->duration == 0))
+          repeat_index--;
+
+        if ((flags & GST_SEEK_FLAG_SNAP_NEAREST) ==
+            GST_SEEK_FLAG_SNAP_NEAREST) {
+          /* FIXME implement this */
+        } else if ((forward && flags & GST_SEEK_FLAG_SNAP_AFTER) ||
+            (!forward && flags & GST_SEEK_FLAG_SNAP_BEFORE)) {
+
+          if (repeat_index + 1 < segment->repeat) {
+            repeat_index++;
+          } else {
+            repeat_index = 0;
+            if (index + 1 >= stream->segments->len) {
+              selectedChunk = NULL;
             } else {
-              repeat_index = 0;
-              if (index + 1 >= stream->segments->len) {
-                selectedChunk = NULL;
-              } else {
-                selectedChunk = g_ptr_array_index (stream->segments, index + 1);
-              }
+              selectedChunk = &g_array_index (stream->segments,
+                  GstMediaSegment, index + 1);
             }
           }
-          break;
         }
       }
     }
@@ -4838,7 +5278,8 @@ gst_mpd_client_get_last_fragment_timestamp_end (GstMpdClient * client,
     *ts = stream_period->start + stream_period->duration;
   } else {
     segment_idx = gst_mpd_client_get_segments_counts (client, stream) - 1;
-    currentChunk = g_ptr_array_index (stream->segments, segment_idx);
+    currentChunk =
+        &g_array_index (stream->segments, GstMediaSegment, segment_idx);
 
     if (currentChunk->repeat >= 0) {
       *ts =
@@ -4873,7 +5314,8 @@ gst_mpd_client_get_next_fragment_timestamp (GstMpdClient * client,
         stream->segment_index, stream->segments->len);
     if (stream->segment_index >= stream->segments->len)
       return FALSE;
-    currentChunk = g_ptr_array_index (stream->segments, stream->segment_index);
+    currentChunk = &g_array_index (stream->segments, GstMediaSegment,
+        stream->segment_index);
 
     *ts =
         currentChunk->start +
@@ -4958,27 +5400,22 @@ gst_mpd_client_get_utc_timing_sources (GstMpdClient * client,
   return NULL;
 }
 
-gboolean
-gst_mpd_client_get_next_fragment (GstMpdClient * client,
-    guint indexStream, GstMediaFragmentInfo * fragment)
+/* Fills @fragment with the segment at @segment_index and @repeat_index of
+ * @stream, which do not need to be its current position */
+static gboolean
+gst_mpd_client_get_fragment_at (GstMpdClient * client,
+    GstActiveStream * stream, gint segment_index, guint repeat_index,
+    GstMediaFragmentInfo * fragment)
 {
-  GstActiveStream *stream = NULL;
   GstMediaSegment *currentChunk;
   gchar *mediaURL = NULL;
   gchar *indexURL = NULL;
   GstUri *base_url, *frag_url;
 
-  /* select stream */
-  g_return_val_if_fail (client != NULL, FALSE);
-  g_return_val_if_fail (client->active_streams != NULL, FALSE);
-  stream = g_list_nth_data (client->active_streams, indexStream);
-  g_return_val_if_fail (stream != NULL, FALSE);
-  g_return_val_if_fail (stream->cur_representation != NULL, FALSE);
-
   if (stream->segments) {
     GST_DEBUG ("Looking for fragment sequence chunk %d / %d",
-        stream->segment_index, stream->segments->len);
-    if (stream->segment_index >= stream->segments->len)
+        segment_index, stream->segments->len);
+    if (segment_index >= stream->segments->len)
       return FALSE;
   } else {
     GstClockTime duration = gst_mpd_client_get_segment_duration (client,
@@ -4988,7 +5425,7 @@ gst_mpd_client_get_next_fragment (GstMpdClient * client,
     g_return_val_if_fail (stream->cur_seg_template->
         MultSegBaseType->SegmentTimeline == NULL, FALSE);
     if (!GST_CLOCK_TIME_IS_VALID (duration) || (segments_count > 0
-            && stream->segment_index >= segments_count)) {
+            && segment_index >= segments_count)) {
       return FALSE;
     }
     fragment->duration = duration;
@@ -5003,7 +5440,8 @@ gst_mpd_client_get_next_fragment (GstMpdClient * client,
   fragment->index_range_end = -1;
 
   if (stream->segments) {
-    currentChunk = g_ptr_array_index (stream->segments, stream->segment_index);
+    currentChunk = &g_array_index (stream->segments, GstMediaSegment,
+        segment_index);
 
     GST_DEBUG ("currentChunk->SegmentURL = %p", currentChunk->SegmentURL);
     if (currentChunk->SegmentURL != NULL) {
@@ -5015,18 +5453,18 @@ gst_mpd_client_get_next_fragment (GstMpdClient * client,
       mediaURL =
           gst_mpdparser_build_URL_from_template (stream->
           cur_seg_template->media, stream->cur_representation->id,
-          currentChunk->number + stream->segment_repeat_index,
+          currentChunk->number + repeat_index,
           stream->cur_representation->bandwidth,
           currentChunk->scale_start +
-          stream->segment_repeat_index * currentChunk->scale_duration);
+          repeat_index * currentChunk->scale_duration);
       if (stream->cur_seg_template->index) {
         indexURL =
             gst_mpdparser_build_URL_from_template (stream->
             cur_seg_template->index, stream->cur_representation->id,
-            currentChunk->number + stream->segment_repeat_index,
+            currentChunk->number + repeat_index,
             stream->cur_representation->bandwidth,
             currentChunk->scale_start +
-            stream->segment_repeat_index * currentChunk->scale_duration);
+            repeat_index * currentChunk->scale_duration);
       }
     }
     GST_DEBUG ("mediaURL = %s", mediaURL);
@@ -5034,7 +5472,7 @@ gst_mpd_client_get_next_fragment (GstMpdClient * client,
 
     fragment->timestamp =
         currentChunk->start +
-        stream->segment_repeat_index * currentChunk->duration;
+        repeat_index * currentChunk->duration;
     fragment->duration = currentChunk->duration;
     if (currentChunk->SegmentURL) {
       if (currentChunk->SegmentURL->mediaRange) {
@@ -5055,18 +5493,18 @@ gst_mpd_client_get_next_fragment (GstMpdClient * client,
       mediaURL =
           gst_mpdparser_build_URL_from_template (stream->
           cur_seg_template->media, stream->cur_representation->id,
-          stream->segment_index +
+          segment_index +
           stream->cur_seg_template->MultSegBaseType->startNumber,
           stream->cur_representation->bandwidth,
-          stream->segment_index * fragment->duration);
+          segment_index * fragment->duration);
       if (stream->cur_seg_template->index) {
         indexURL =
             gst_mpdparser_build_URL_from_template (stream->
             cur_seg_template->index, stream->cur_representation->id,
-            stream->segment_index +
+            segment_index +
             stream->cur_seg_template->MultSegBaseType->startNumber,
             stream->cur_representation->bandwidth,
-            stream->segment_index * fragment->duration);
+            segment_index * fragment->duration);
       }
     } else {
       return FALSE;
@@ -5075,7 +5513,7 @@ gst_mpd_client_get_next_fragment (GstMpdClient * client,
     GST_DEBUG ("mediaURL = %s", mediaURL);
     GST_DEBUG ("indexURL = %s", indexURL);
 
-    fragment->timestamp = stream->segment_index * fragment->duration;
+    fragment->timestamp = segment_index * fragment->duration;
   }
 
   base_url = gst_uri_from_string (stream->baseURL);
@@ -5116,6 +5554,94 @@ gst_mpd_client_get_next_fragment (GstMpdClient * client,
   return TRUE;
 }
 
+gboolean
+gst_mpd_client_get_next_fragment (GstMpdClient * client,
+    guint indexStream, GstMediaFragmentInfo * fragment)
+{
+  GstActiveStream *stream = NULL;
+
+  /* select stream */
+  g_return_val_if_fail (client != NULL, FALSE);
+  g_return_val_if_fail (client->active_streams != NULL, FALSE);
+  stream = g_list_nth_data (client->active_streams, indexStream);
+  g_return_val_if_fail (stream != NULL, FALSE);
+  g_return_val_if_fail (stream->cur_representation != NULL, FALSE);
+
+  return gst_mpd_client_get_fragment_at (client, stream,
+      stream->segment_index, stream->segment_repeat_index, fragment);
+}
+
+/* Moves @segment_index and @repeat_index of @stream one segment forward,
+ * as gst_mpd_client_advance_segment() does for the current position */
+static GstFlowReturn
+gst_mpd_client_next_segment_position (GstMpdClient * client,
+    GstActiveStream * stream, gint * segment_index, guint * repeat_index)
+{
+  GstMediaSegment *segment;
+  guint segments_count = gst_mpd_client_get_segments_counts (client, stream);
+
+  if (segments_count > 0 && *segment_index >= segments_count)
+    return GST_FLOW_EOS;
+
+  if (stream->segments == NULL) {
+    if (*segment_index < 0) {
+      *segment_index = 0;
+    } else {
+      (*segment_index)++;
+      if (segments_count > 0 && *segment_index >= segments_count)
+        return GST_FLOW_EOS;
+    }
+    return GST_FLOW_OK;
+  }
+
+  /* special case for when playback direction is reverted right at *
+   * the end of the segment list */
+  if (*segment_index < 0) {
+    *segment_index = 0;
+    return GST_FLOW_OK;
+  }
+
+  segment = &g_array_index (stream->segments, GstMediaSegment, *segment_index);
+  if (segment->repeat >= 0 && *repeat_index >= segment->repeat) {
+    *repeat_index = 0;
+    (*segment_index)++;
+    if (segments_count > 0 && *segment_index >= segments_count)
+      return GST_FLOW_EOS;
+  } else {
+    (*repeat_index)++;
+  }
+
+  return GST_FLOW_OK;
+}
+
+/* Fills @fragment with the @n-th segment after the current one of the
+ * stream at @indexStream without moving its current position */
+gboolean
+gst_mpd_client_peek_fragment (GstMpdClient * client, guint indexStream,
+    guint n, GstMediaFragmentInfo * fragment)
+{
+  GstActiveStream *stream = NULL;
+  gint segment_index;
+  guint repeat_index;
+
+  g_return_val_if_fail (client != NULL, FALSE);
+  g_return_val_if_fail (client->active_streams != NULL, FALSE);
+  stream = g_list_nth_data (client->active_streams, indexStream);
+  g_return_val_if_fail (stream != NULL, FALSE);
+  g_return_val_if_fail (stream->cur_representation != NULL, FALSE);
+
+  segment_index = stream->segment_index;
+  repeat_index = stream->segment_repeat_index;
+  for (; n > 0; n--) {
+    if (gst_mpd_client_next_segment_position (client, stream, &segment_index,
+            &repeat_index) != GST_FLOW_OK)
+      return FALSE;
+  }
+
+  return gst_mpd_client_get_fragment_at (client, stream, segment_index,
+      repeat_index, fragment);
+}
+
 gboolean
 gst_mpd_client_has_next_segment (GstMpdClient * client,
     GstActiveStream * stream, gboolean forward)
@@ -5127,7 +5653,8 @@ gst_mpd_client_has_next_segment (GstMpdClient * client,
         && stream->segment_index + 1 == segments_count) {
       GstMediaSegment *segment;
 
-      segment = g_ptr_array_index (stream->segments, stream->segment_index);
+      segment = &g_array_index (stream->segments, GstMediaSegment,
+          stream->segment_index);
       if (segment->repeat >= 0
           && stream->segment_repeat_index >= segment->repeat)
         return FALSE;
@@ -5154,101 +5681,68 @@ gst_mpd_client_advance_segment (GstMpdClient * client, GstActiveStream * stream,
   GST_DEBUG ("Advancing segment. Current: %d / %d r:%d", stream->segment_index,
       segments_count, stream->segment_repeat_index);
 
-  /* handle special cases first */
   if (forward) {
-    if (segments_count > 0 && stream->segment_index >= segments_count) {
-      ret = GST_FLOW_EOS;
-      goto done;
-    }
+    ret = gst_mpd_client_next_segment_position (client, stream,
+        &stream->segment_index, &stream->segment_repeat_index);
+    goto done;
+  }
 
-    if (stream->segments == NULL) {
-      if (stream->segment_index < 0) {
-        stream->segment_index = 0;
-      } else {
-        stream->segment_index++;
-        if (segments_count > 0 && stream->segment_index >= segments_count) {
-          ret = GST_FLOW_EOS;
-        }
-      }
-      goto done;
+  /* handle special cases first */
+  if (stream->segments == NULL)
+    stream->segment_index--;
+  if (stream->segment_index < 0) {
+    stream->segment_index = -1;
+    ret = GST_FLOW_EOS;
+    goto done;
+  }
+  if (stream->segments == NULL)
+    goto done;
+
+  /* special case for when playback direction is reverted right at *
+   * the end of the segment list */
+  if (stream->segment_index >= segments_count) {
+    stream->segment_index = segments_count - 1;
+    segment = &g_array_index (stream->segments, GstMediaSegment,
+        stream->segment_index);
+    if (segment->repeat >= 0) {
+      stream->segment_repeat_index = segment->repeat;
+    } else {
+      GstClockTime start = segment->start;
+      GstClockTime end =
+          gst_mpdparser_get_segment_end_time (client, stream->segments,
+          segment,
+          stream->segment_index);
+      stream->segment_repeat_index =
+          (guint) (end - start) / segment->duration;
     }
+    goto done;
+  }
 
-    /* special case for when playback direction is reverted right at *
-     * the end of the segment list */
-    if (stream->segment_index < 0) {
-      stream->segment_index = 0;
-      goto done;
-    }
-  } else {
-    if (stream->segments == NULL)
-      stream->segment_index--;
+  if (stream->segment_repeat_index == 0) {
+    stream->segment_index--;
     if (stream->segment_index < 0) {
-      stream->segment_index = -1;
       ret = GST_FLOW_EOS;
       goto done;
     }
-    if (stream->segments == NULL)
-      goto done;
 
-    /* special case for when playback direction is reverted right at *
-     * the end of the segment list */
-    if (stream->segment_index >= segments_count) {
-      stream->segment_index = segments_count - 1;
-      segment = g_ptr_array_index (stream->segments, stream->segment_index);
-      if (segment->repeat >= 0) {
-        stream->segment_repeat_index = segment->repeat;
-      } else {
-        GstClockTime start = segment->start;
-        GstClockTime end =
-            gst_mpdparser_get_segment_end_time (client, stream->segments,
-            segment,
-            stream->segment_index);
-        stream->segment_repeat_index =
-            (guint) (end - start) / segment->duration;
-      }
-      goto done;
-    }
-  }
-
-  /* for the normal cases we can get the segment safely here */
-  segment = g_ptr_array_index (stream->segments, stream->segment_index);
-  if (forward) {
-    if (segment->repeat >= 0 && stream->segment_repeat_index >= segment->repeat) {
-      stream->segment_repeat_index = 0;
-      stream->segment_index++;
-      if (segments_count > 0 && stream->segment_index >= segments_count) {
-        ret = GST_FLOW_EOS;
-        goto done;
-      }
+    segment = &g_array_index (stream->segments, GstMediaSegment,
+        stream->segment_index);
+    /* negative repeats only seem to make sense at the end of a list,
+     * so this one will probably not be. Needs some sanity checking
+     * when loading the XML data. */
+    if (segment->repeat >= 0) {
+      stream->segment_repeat_index = segment->repeat;
     } else {
-      stream->segment_repeat_index++;
+      GstClockTime start = segment->start;
+      GstClockTime end =
+          gst_mpdparser_get_segment_end_time (client, stream->segments,
+          segment,
+          stream->segment_index);
+      stream->segment_repeat_index =
+          (guint) (end - start) / segment->duration;
     }
   } else {
-    if (stream->segment_repeat_index == 0) {
-      stream->segment_index--;
-      if (stream->segment_index < 0) {
-        ret = GST_FLOW_EOS;
-        goto done;
-      }
-
-      segment = g_ptr_array_index (stream->segments, stream->segment_index);
-      /* negative repeats only seem to make sense at the end of a list,
-       * so this one will probably not be. Needs some sanity checking
-       * when loading the XML data. */
-      if (segment->repeat >= 0) {
-        stream->segment_repeat_index = segment->repeat;
-      } else {
-        GstClockTime start = segment->start;
-        GstClockTime end =
-            gst_mpdparser_get_segment_end_time (client, stream->segments,
-            segment,
-            stream->segment_index);
-        stream->segment_repeat_index =
-            (guint) (end - start) / segment->duration;
-      }
-    } else {
-      stream->segment_repeat_index--;
-    }
+    stream->segment_repeat_index--;
   }
 
 done:
@@ -5354,7 +5848,8 @@ gst_mpd_client_get_next_fragment_duration (GstMpdClient * client,
 
   if (stream->segments) {
     if (seg_idx < stream->segments->len && seg_idx >= 0)
-      media_segment = g_ptr_array_index (stream->segments, seg_idx);
+      media_segment =
+          &g_array_index (stream->segments, GstMediaSegment, seg_idx);
 
     return media_segment == NULL ? 0 : media_segment->duration;
   } else {
@@ -5759,7 +6254,7 @@ gst_mpdparser_get_list_and_nb_of_audio_language (GstMpdClient * client,
   GstAdaptationSetNode *adapt_set;
   GList *adaptation_sets, *list;
   const gchar *this_mimeType = "audio";
-  gchar *mimeType = NULL;
+  const gchar *mimeType = NULL;
   guint nb_adaptation_set = 0;
 
   stream_period = gst_mpdparser_get_stream_period (client);
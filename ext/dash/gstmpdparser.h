@@ -152,8 +152,8 @@ struct _GstSNode
 
 struct _GstSegmentTimelineNode
 {
-  /* list of S nodes */
-  GQueue S;
+  /* array of GstSNode */
+  GArray *S;
 };
 
 struct _GstURLType
@@ -172,6 +172,10 @@ struct _GstSegmentBaseType
   GstURLType *Initialization;
   /* RepresentationIndex node */
   GstURLType *RepresentationIndex;
+  /* attributes present in the element, the others are inherited */
+  gboolean has_timescale;
+  gboolean has_presentation_time_offset;
+  gboolean has_index_range_exact;
 };
 
 struct _GstMultSegmentBaseType
@@ -184,14 +188,17 @@ struct _GstMultSegmentBaseType
   GstSegmentTimelineNode *SegmentTimeline;
   /* BitstreamSwitching node */
   GstURLType *BitstreamSwitching;
+  /* attributes present in the element, the others are inherited */
+  gboolean has_duration;
+  gboolean has_start_number;
 };
 
 struct _GstSegmentListNode
 {
   /* extension */
   GstMultSegmentBaseType *MultSegBaseType;
-  /* list of SegmentURL nodes */
-  GList *SegmentURL;
+  /* array of GstSegmentURLNode */
+  GArray *SegmentURL;
 
   gchar *xlink_href;
   GstXLinkActuate actuate;
@@ -201,10 +208,11 @@ struct _GstSegmentTemplateNode
 {
   /* extension */
   GstMultSegmentBaseType *MultSegBaseType;
-  gchar *media;
-  gchar *index;
-  gchar *initialization;
-  gchar *bitstreamSwitching;
+  /* interned strings */
+  const gchar *media;
+  const gchar *index;
+  const gchar *initialization;
+  const gchar *bitstreamSwitching;
 };
 
 struct _GstSegmentURLNode
@@ -225,9 +233,9 @@ struct _GstRepresentationBaseType
   GstFrameRate *maxFrameRate;
   GstFrameRate *frameRate;
   gchar *audioSamplingRate;
-  gchar *mimeType;
+  const gchar *mimeType;             /* interned */
   gchar *segmentProfiles;
-  gchar *codecs;
+  const gchar *codecs;               /* interned */
   gdouble maximumSAPPeriod;
   GstSAPType startWithSAP;
   gdouble maxPlayoutRate;
@@ -330,8 +338,8 @@ struct _GstAdaptationSetNode
   GstSegmentTemplateNode *SegmentTemplate;
   /* list of BaseURL nodes */
   GList *BaseURLs;
-  /* list of Representation nodes */
-  GList *Representations;
+  /* array of GstRepresentationNode */
+  GArray *Representations;
   /* list of ContentComponent nodes */
   GList *ContentComponents;
 
@@ -497,7 +505,7 @@ struct _GstActiveStream
   GstSegmentTemplateNode *cur_seg_template;   /* active segment template */
   gint segment_index;                         /* index of next sequence chunk */
   guint segment_repeat_index;                 /* index of the repeat count of a segment */
-  GPtrArray *segments;                        /* array of GstMediaSegment */
+  GArray *segments;                           /* array of GstMediaSegment, stored inline */
   GstClockTime presentationTimeOffset;        /* presentation time offset of the current segment */
 };
 
@@ -536,11 +544,13 @@ gboolean gst_mpd_parse (GstMpdClient *client, const gchar *data, gint size);
 gboolean gst_mpd_client_setup_media_presentation (GstMpdClient *client, GstClockTime time, gint period_index, const gchar *period_id);
 gboolean gst_mpd_client_setup_streaming (GstMpdClient * client, GstAdaptationSetNode * adapt_set);
 gboolean gst_mpd_client_setup_representation (GstMpdClient *client, GstActiveStream *stream, GstRepresentationNode *representation);
+gboolean gst_mpd_client_update_active_streams (GstMpdClient * client, GstMpdClient * old_client);
 GstClockTime gst_mpd_client_get_next_fragment_duration (GstMpdClient * client, GstActiveStream * stream);
 GstClockTime gst_mpd_client_get_media_presentation_duration (GstMpdClient *client);
 gboolean gst_mpd_client_get_last_fragment_timestamp_end (GstMpdClient * client, guint stream_idx, GstClockTime * ts);
 gboolean gst_mpd_client_get_next_fragment_timestamp (GstMpdClient * client, guint stream_idx, GstClockTime * ts);
 gboolean gst_mpd_client_get_next_fragment (GstMpdClient *client, guint indexStream, GstMediaFragmentInfo * fragment);
+gboolean gst_mpd_client_peek_fragment (GstMpdClient *client, guint indexStream, guint n, GstMediaFragmentInfo * fragment);
 gboolean gst_mpd_client_get_next_header (GstMpdClient *client, gchar **uri, guint stream_idx, gint64 * range_start, gint64 * range_end);
 gboolean gst_mpd_client_get_next_header_index (GstMpdClient *client, gchar **uri, guint stream_idx, gint64 * range_start, gint64 * range_end);
 gboolean gst_mpd_client_is_live (GstMpdClient * client);
@@ -560,8 +570,8 @@ gboolean gst_mpd_client_has_next_period (GstMpdClient *client);
 gboolean gst_mpd_client_has_previous_period (GstMpdClient * client);
 
 /* Representation selection */
-gint gst_mpdparser_get_rep_idx_with_max_bandwidth (GList *Representations, gint max_bandwidth);
-gint gst_mpdparser_get_rep_idx_with_min_bandwidth (GList * Representations);
+gint gst_mpdparser_get_rep_idx_with_max_bandwidth (GArray *Representations, gint max_bandwidth);
+gint gst_mpdparser_get_rep_idx_with_min_bandwidth (GArray * Representations);
 
 /* URL management */
 const gchar *gst_mpdparser_get_baseURL (GstMpdClient *client, guint indexStream);
@@ -99,8 +99,11 @@ static GstFlowReturn gst_hls_demux_advance_fragment (GstAdaptiveDemuxStream *
     stream);
 static GstFlowReturn gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream
     * stream);
+static GstFlowReturn gst_hls_demux_peek_fragment_info (GstAdaptiveDemuxStream
+    * stream, guint n, GstAdaptiveDemuxStreamFragment * fragment);
 static gboolean gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate);
+static GArray *gst_hls_demux_get_bitrates (GstAdaptiveDemuxStream * stream);
 static void gst_hls_demux_reset (GstAdaptiveDemux * demux);
 static gboolean gst_hls_demux_get_live_seek_range (GstAdaptiveDemux * demux,
     gint64 * start, gint64 * stop);
@@ -115,6 +118,7 @@ gst_hls_demux_finalize (GObject * obj)
 
   gst_hls_demux_reset (GST_ADAPTIVE_DEMUX_CAST (demux));
   gst_m3u8_client_free (demux->client);
+  g_hash_table_unref (demux->keys);
 
   G_OBJECT_CLASS (parent_class)->finalize (obj);
 }
@@ -161,7 +165,10 @@ gst_hls_demux_class_init (GstHLSDemuxClass * klass)
   adaptivedemux_class->stream_advance_fragment = gst_hls_demux_advance_fragment;
   adaptivedemux_class->stream_update_fragment_info =
       gst_hls_demux_update_fragment_info;
+  adaptivedemux_class->stream_peek_fragment_info =
+      gst_hls_demux_peek_fragment_info;
   adaptivedemux_class->stream_select_bitrate = gst_hls_demux_select_bitrate;
+  adaptivedemux_class->stream_get_bitrates = gst_hls_demux_get_bitrates;
 
   adaptivedemux_class->start_fragment = gst_hls_demux_start_fragment;
   adaptivedemux_class->finish_fragment = gst_hls_demux_finish_fragment;
@@ -175,6 +182,9 @@ static void
 gst_hls_demux_init (GstHLSDemux * demux)
 {
   demux->do_typefind = TRUE;
+  demux->keys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) gst_buffer_unref);
+  g_queue_init (&demux->keys_lru);
 }
 
 static GstStateChangeReturn
@@ -239,13 +249,14 @@ gst_hls_demux_seek (GstAdaptiveDemux * demux, GstEvent * seek)
   GstSeekType start_type, stop_type;
   gint64 start, stop;
   gdouble rate;
-  GList *walk, *current_file = NULL;
+  GstM3U8 *m3u8;
+  gint idx;
   GstClockTime current_pos, target_pos;
   gint64 current_sequence;
   GstM3U8MediaFile *file;
   guint64 bitrate;
   gboolean snap_before, snap_after, snap_nearest, keyunit;
-  gboolean reverse;
+  gboolean reverse, use_iframes, on_iframes;
 
   gst_event_parse_seek (seek, &rate, &format, &flags, &start_type, &start,
       &stop_type, &stop);
@@ -257,9 +268,16 @@ gst_hls_demux_seek (GstAdaptiveDemux * demux, GstEvent * seek)
     gst_hls_demux_decrypt_end (hlsdemux);
   }
 
-  /* Use I-frame variants for trick modes */
-  if (hlsdemux->client->main->iframe_lists && rate < -1.0
-      && demux->segment.rate >= -1.0 && demux->segment.rate <= 1.0) {
+  /* Use I-frame variants for key unit trick modes and fast reverse playback,
+   * their entries are byte ranges covering a single I-frame each */
+  GST_M3U8_CLIENT_LOCK (hlsdemux->client);
+  use_iframes = hlsdemux->client->main->iframe_lists
+      && ((flags & GST_SEEK_FLAG_TRICKMODE_KEY_UNITS) || rate < -1.0);
+  on_iframes = hlsdemux->client->main->current_variant
+      && GST_M3U8 (hlsdemux->client->main->current_variant->data)->iframe;
+  GST_M3U8_CLIENT_UNLOCK (hlsdemux->client);
+
+  if (use_iframes && !on_iframes) {
     GError *err = NULL;
 
     GST_M3U8_CLIENT_LOCK (hlsdemux->client);
@@ -278,8 +296,7 @@ gst_hls_demux_seek (GstAdaptiveDemux * demux, GstEvent * seek)
     hlsdemux->do_typefind = TRUE;
 
     gst_hls_demux_change_playlist (hlsdemux, bitrate / ABS (rate), NULL);
-  } else if (rate > -1.0 && rate <= 1.0 && (demux->segment.rate < -1.0
-          || demux->segment.rate > 1.0)) {
+  } else if (!use_iframes && on_iframes) {
     GError *err = NULL;
     GST_M3U8_CLIENT_LOCK (hlsdemux->client);
     /* Switch to normal variant */
@@ -299,9 +316,7 @@ gst_hls_demux_seek (GstAdaptiveDemux * demux, GstEvent * seek)
   }
 
   GST_M3U8_CLIENT_LOCK (hlsdemux->client);
-  file = GST_M3U8_MEDIA_FILE (hlsdemux->client->current->files->data);
-  current_sequence = file->sequence;
-  current_pos = 0;
+  m3u8 = hlsdemux->client->current;
   reverse = rate < 0;
   target_pos = reverse ? stop : start;
 
@@ -313,41 +328,41 @@ gst_hls_demux_seek (GstAdaptiveDemux * demux, GstEvent * seek)
   snap_after = ! !(flags & GST_SEEK_FLAG_SNAP_AFTER);
 
   /* FIXME: Here we need proper discont handling */
-  for (walk = hlsdemux->client->current->files; walk; walk = walk->next) {
-    file = walk->data;
-
-    current_sequence = file->sequence;
-    current_file = walk;
-    if ((!reverse && snap_after) || snap_nearest) {
-      if (current_pos >= target_pos)
-        break;
-      if (snap_nearest && target_pos - current_pos < file->duration / 2)
-        break;
-    } else if (reverse && snap_after) {
-      /* check if the next fragment is our target, in this case we want to
-       * start from the previous fragment */
-      GstClockTime next_pos = current_pos + file->duration;
-
-      if (next_pos <= target_pos && target_pos < next_pos + file->duration) {
-        break;
-      }
-    } else if (current_pos <= target_pos
-        && target_pos < current_pos + file->duration) {
-      break;
+  idx = gst_m3u8_find_file_by_position (m3u8, target_pos);
+  if ((!reverse && snap_after) || snap_nearest) {
+    /* the first fragment starting at or after the target, or the one
+     * containing it if its start is the nearest boundary */
+    if (idx < m3u8->files->len) {
+      file = GST_M3U8_FILE_AT (m3u8, idx);
+      if (file->start < target_pos && !(snap_nearest
+              && target_pos - file->start < file->duration / 2))
+        idx++;
     }
-    current_pos += file->duration;
+  } else if (reverse && snap_after) {
+    /* start from the fragment before the target one */
+    file = idx > 0 ? GST_M3U8_FILE_AT (m3u8, idx - 1) : NULL;
+    if (file && target_pos < file->start + 2 * file->duration)
+      idx--;
+    else
+      idx = m3u8->files->len;
   }
 
-  if (walk == NULL) {
+  if (idx < m3u8->files->len) {
+    file = GST_M3U8_FILE_AT (m3u8, idx);
+    current_sequence = file->sequence;
+    current_pos = file->start;
+  } else {
     GST_DEBUG_OBJECT (demux, "seeking further than track duration");
-    current_sequence++;
+    file = GST_M3U8_FILE_AT (m3u8, m3u8->files->len - 1);
+    current_sequence = file->sequence + 1;
+    current_pos = file->start + file->duration;
+    idx = m3u8->files->len - 1;
   }
 
   GST_DEBUG_OBJECT (demux, "seeking to sequence %u", (guint) current_sequence);
   hlsdemux->reset_pts = TRUE;
   hlsdemux->client->sequence = current_sequence;
-  hlsdemux->client->current_file =
-      current_file ? current_file : hlsdemux->client->current->files;
+  hlsdemux->client->current_file = idx;
   hlsdemux->client->sequence_position = current_pos;
   GST_M3U8_CLIENT_UNLOCK (hlsdemux->client);
 
@@ -465,51 +480,115 @@ gst_hls_demux_is_live (GstAdaptiveDemux * demux)
   return gst_m3u8_client_is_live (hlsdemux->client);
 }
 
+/* Keys usually change every few fragments at most, only keep the most
+ * recently used ones around */
+#define MAX_CACHED_KEYS 16
+
+/* must be called with manifest_lock taken */
+static GstBuffer *
+gst_hls_demux_lookup_key (GstHLSDemux * hlsdemux, const gchar * key_url)
+{
+  gpointer cached_url, key_buffer;
+  GList *link;
+
+  if (!g_hash_table_lookup_extended (hlsdemux->keys, key_url, &cached_url,
+          &key_buffer))
+    return NULL;
+
+  link = g_queue_find (&hlsdemux->keys_lru, cached_url);
+  g_queue_unlink (&hlsdemux->keys_lru, link);
+  g_queue_push_tail_link (&hlsdemux->keys_lru, link);
+
+  return gst_buffer_ref (key_buffer);
+}
+
+/* must be called with manifest_lock taken */
+static void
+gst_hls_demux_cache_key (GstHLSDemux * hlsdemux, const gchar * key_url,
+    GstBuffer * key_buffer)
+{
+  gchar *cached_url;
+
+  if (g_queue_get_length (&hlsdemux->keys_lru) >= MAX_CACHED_KEYS) {
+    cached_url = g_queue_pop_head (&hlsdemux->keys_lru);
+    GST_DEBUG_OBJECT (hlsdemux, "Evicting key %s", cached_url);
+    g_hash_table_remove (hlsdemux->keys, cached_url);
+  }
+
+  cached_url = g_strdup (key_url);
+  g_hash_table_insert (hlsdemux->keys, cached_url,
+      gst_buffer_ref (key_buffer));
+  g_queue_push_tail (&hlsdemux->keys_lru, cached_url);
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock.
+ * The key is usually cached or was downloaded by the prefetch task while
+ * the previous fragment was downloading, otherwise it is downloaded now */
+static GstBuffer *
+gst_hls_demux_get_key (GstHLSDemux * hlsdemux, GstAdaptiveDemuxStream * stream,
+    const gchar * key_url, GError ** err)
+{
+  GstAdaptiveDemux *demux = GST_ADAPTIVE_DEMUX_CAST (hlsdemux);
+  GstFragment *key_fragment;
+  GstBuffer *key_buffer;
+
+  key_buffer = gst_hls_demux_lookup_key (hlsdemux, key_url);
+  if (key_buffer)
+    return key_buffer;
+
+  key_buffer = gst_adaptive_demux_stream_take_prefetched_key (stream, key_url);
+  if (key_buffer == NULL) {
+    GST_INFO_OBJECT (demux, "Fetching key %s", key_url);
+    key_fragment =
+        gst_uri_downloader_fetch_uri (demux->downloader, key_url,
+        hlsdemux->client->main ? hlsdemux->client->main->uri : NULL, FALSE,
+        FALSE, hlsdemux->client->current ? hlsdemux->client->current->
+        allowcache : TRUE, err);
+    if (key_fragment == NULL)
+      return NULL;
+
+    key_buffer = gst_fragment_get_buffer (key_fragment);
+    g_object_unref (key_fragment);
+  }
+
+  /* An empty download has no buffer, AES-128 keys are always 16 bytes */
+  if (key_buffer == NULL || gst_buffer_get_size (key_buffer) != 16) {
+    g_set_error (err, GST_STREAM_ERROR, GST_STREAM_ERROR_DECRYPT,
+        "Invalid key of %" G_GSIZE_FORMAT " bytes at %s",
+        key_buffer ? gst_buffer_get_size (key_buffer) : 0, key_url);
+    if (key_buffer)
+      gst_buffer_unref (key_buffer);
+    return NULL;
+  }
+
+  gst_hls_demux_cache_key (hlsdemux, key_url, key_buffer);
+
+  return key_buffer;
+}
+
 static gboolean
 gst_hls_demux_start_fragment (GstAdaptiveDemux * demux,
     GstAdaptiveDemuxStream * stream)
 {
   GstHLSDemux *hlsdemux = GST_HLS_DEMUX_CAST (demux);
+  GError *err = NULL;
 
   if (hlsdemux->current_key) {
-    GError *err = NULL;
-    GstFragment *key_fragment;
     GstBuffer *key_buffer;
     GstMapInfo key_info;
 
-    /* new key? */
-    if (hlsdemux->key_url
-        && strcmp (hlsdemux->key_url, hlsdemux->current_key) == 0) {
-      key_fragment = g_object_ref (hlsdemux->key_fragment);
-    } else {
-      g_free (hlsdemux->key_url);
-      hlsdemux->key_url = NULL;
-
-      if (hlsdemux->key_fragment)
-        g_object_unref (hlsdemux->key_fragment);
-      hlsdemux->key_fragment = NULL;
-
-      GST_INFO_OBJECT (demux, "Fetching key %s", hlsdemux->current_key);
-      key_fragment =
-          gst_uri_downloader_fetch_uri (demux->downloader,
-          hlsdemux->current_key, hlsdemux->client->main ?
-          hlsdemux->client->main->uri : NULL, FALSE, FALSE,
-          hlsdemux->client->current ? hlsdemux->client->current->
-          allowcache : TRUE, &err);
-      if (key_fragment == NULL)
-        goto key_failed;
-      hlsdemux->key_url = g_strdup (hlsdemux->current_key);
-      hlsdemux->key_fragment = g_object_ref (key_fragment);
-    }
+    key_buffer = gst_hls_demux_get_key (hlsdemux, stream,
+        hlsdemux->current_key, &err);
+    if (key_buffer == NULL)
+      goto key_failed;
 
-    key_buffer = gst_fragment_get_buffer (key_fragment);
     gst_buffer_map (key_buffer, &key_info, GST_MAP_READ);
 
     gst_hls_demux_decrypt_start (hlsdemux, key_info.data, hlsdemux->current_iv);
 
     gst_buffer_unmap (key_buffer, &key_info);
     gst_buffer_unref (key_buffer);
-    g_object_unref (key_fragment);
   }
 
   return TRUE;
@@ -517,8 +596,10 @@ gst_hls_demux_start_fragment (GstAdaptiveDemux * demux,
 key_failed:
   {
     GST_ELEMENT_ERROR (demux, STREAM, DEMUX,
-        ("Couldn't retrieve key for decryption"), (NULL));
+        ("Couldn't retrieve key for decryption"), ("%s",
+            err ? err->message : "unknown error"));
     GST_WARNING_OBJECT (demux, "Failed to decrypt data");
+    g_clear_error (&err);
     return FALSE;
   }
 }
@@ -637,7 +718,7 @@ gst_hls_demux_data_received (GstAdaptiveDemux * demux,
   /* Is it encrypted? */
   if (hlsdemux->current_key) {
     GError *err = NULL;
-    GstBuffer *tmp_buffer;
+    gsize size;
 
     /* must be a multiple of 16 */
     available = available & (~0xF);
@@ -655,9 +736,20 @@ gst_hls_demux_data_received (GstAdaptiveDemux * demux,
       return GST_FLOW_ERROR;
     }
 
-    tmp_buffer = hlsdemux->pending_buffer;
-    hlsdemux->pending_buffer = buffer;
-    buffer = tmp_buffer;
+    if (hlsdemux->pending_buffer)
+      buffer = gst_buffer_append (hlsdemux->pending_buffer, buffer);
+
+    /* the padding is in the last block of the fragment, hold back only that
+     * block until EOS */
+    size = gst_buffer_get_size (buffer);
+    hlsdemux->pending_buffer =
+        gst_buffer_copy_region (buffer, GST_BUFFER_COPY_ALL, size - 16, 16);
+    if (size > 16) {
+      gst_buffer_resize (buffer, 0, size - 16);
+    } else {
+      gst_buffer_unref (buffer);
+      buffer = NULL;
+    }
   } else {
     buffer = gst_adapter_take_buffer (stream->adapter, available);
     if (hlsdemux->pending_buffer) {
@@ -678,13 +770,61 @@ gst_hls_demux_stream_has_next_fragment (GstAdaptiveDemuxStream * stream)
       stream->demux->segment.rate > 0);
 }
 
+/* On I-frame playlists, the next I-frame is needed once the current one has
+ * been displayed for its duration divided by the rate. Returns how many
+ * entries to skip so that downloading keeps up with that at the current
+ * download rate, or at connection-speed if it is set
+ *
+ * must be called with manifest_lock taken */
+static guint
+gst_hls_demux_get_iframe_skip (GstHLSDemux * hlsdemux,
+    GstAdaptiveDemuxStream * stream)
+{
+  GstClockTime display_time, download_time;
+  gboolean iframe;
+  guint64 rate;
+  gint64 size;
+
+  GST_M3U8_CLIENT_LOCK (hlsdemux->client);
+  iframe = hlsdemux->client->current && hlsdemux->client->current->iframe;
+  GST_M3U8_CLIENT_UNLOCK (hlsdemux->client);
+
+  rate = stream->demux->connection_speed ? stream->demux->connection_speed :
+      stream->current_download_rate;
+
+  if (!iframe || rate == 0
+      || !GST_CLOCK_TIME_IS_VALID (stream->fragment.duration)
+      || stream->fragment.range_end < stream->fragment.range_start)
+    return 0;
+
+  display_time = stream->fragment.duration / ABS (stream->demux->segment.rate);
+  if (display_time == 0)
+    return 0;
+
+  size = stream->fragment.range_end - stream->fragment.range_start + 1;
+  download_time = gst_util_uint64_scale (size, 8 * GST_SECOND, rate);
+
+  return MIN (download_time / display_time, G_MAXUINT);
+}
+
 static GstFlowReturn
 gst_hls_demux_advance_fragment (GstAdaptiveDemuxStream * stream)
 {
   GstHLSDemux *hlsdemux = GST_HLS_DEMUX_CAST (stream->demux);
+  gboolean forward = stream->demux->segment.rate > 0;
+  guint skip;
 
-  gst_m3u8_client_advance_fragment (hlsdemux->client,
-      stream->demux->segment.rate > 0);
+  skip = gst_hls_demux_get_iframe_skip (hlsdemux, stream);
+  if (skip > 0) {
+    GST_DEBUG_OBJECT (hlsdemux, "Skipping %u I-frames to keep up with rate %f",
+        skip, stream->demux->segment.rate);
+    stream->discont = TRUE;
+  }
+
+  do {
+    gst_m3u8_client_advance_fragment (hlsdemux->client, forward);
+  } while (skip-- > 0 && gst_m3u8_client_has_next_fragment (hlsdemux->client,
+          forward));
   hlsdemux->reset_pts = FALSE;
   return GST_FLOW_OK;
 }
@@ -722,6 +862,7 @@ gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream * stream)
   hlsdemux->current_key = key;
   g_free (hlsdemux->current_iv);
   hlsdemux->current_iv = iv;
+
   g_free (stream->fragment.uri);
   stream->fragment.uri = next_fragment_uri;
   stream->fragment.range_start = range_start;
@@ -733,6 +874,27 @@ gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream * stream)
   return GST_FLOW_OK;
 }
 
+static GstFlowReturn
+gst_hls_demux_peek_fragment_info (GstAdaptiveDemuxStream * stream, guint n,
+    GstAdaptiveDemuxStreamFragment * fragment)
+{
+  GstHLSDemux *hlsdemux = GST_HLS_DEMUX_CAST (stream->demux);
+  gchar *key = NULL;
+
+  /* only called for forward playback */
+  if (!gst_m3u8_client_peek_fragment (hlsdemux->client, n, &fragment->uri,
+          &fragment->range_start, &fragment->range_end, &key, TRUE))
+    return GST_FLOW_EOS;
+
+  /* have the key downloaded along with the fragment unless it is cached */
+  if (key && !g_hash_table_contains (hlsdemux->keys, key))
+    fragment->key_uri = key;
+  else
+    g_free (key);
+
+  return GST_FLOW_OK;
+}
+
 static gboolean
 gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream, guint64 bitrate)
 {
@@ -759,6 +921,28 @@ gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream, guint64 bitrate)
   return changed;
 }
 
+static GArray *
+gst_hls_demux_get_bitrates (GstAdaptiveDemuxStream * stream)
+{
+  GstHLSDemux *hlsdemux = GST_HLS_DEMUX_CAST (stream->demux);
+  GArray *bitrates = NULL;
+  GList *iter;
+
+  GST_M3U8_CLIENT_LOCK (hlsdemux->client);
+  if (hlsdemux->client->main->lists) {
+    bitrates = g_array_new (FALSE, FALSE, sizeof (guint64));
+    for (iter = hlsdemux->client->main->lists; iter; iter = iter->next) {
+      GstM3U8 *m3u8 = iter->data;
+      guint64 bitrate = m3u8->bandwidth;
+
+      g_array_append_val (bitrates, bitrate);
+    }
+  }
+  GST_M3U8_CLIENT_UNLOCK (hlsdemux->client);
+
+  return bitrates;
+}
+
 static void
 gst_hls_demux_reset (GstAdaptiveDemux * ademux)
 {
@@ -767,12 +951,8 @@ gst_hls_demux_reset (GstAdaptiveDemux * ademux)
   demux->do_typefind = TRUE;
   demux->reset_pts = TRUE;
 
-  g_free (demux->key_url);
-  demux->key_url = NULL;
-
-  if (demux->key_fragment)
-    g_object_unref (demux->key_fragment);
-  demux->key_fragment = NULL;
+  g_hash_table_remove_all (demux->keys);
+  g_queue_clear (&demux->keys_lru);
 
   if (demux->client) {
     gst_m3u8_client_free (demux->client);
@@ -939,14 +1119,13 @@ retry:
    * three fragments before the end of the list */
   if (update == FALSE && demux->client->current &&
       gst_m3u8_client_is_live (demux->client)) {
+    GstM3U8 *m3u8;
     gint64 last_sequence, first_sequence;
 
     GST_M3U8_CLIENT_LOCK (demux->client);
-    last_sequence =
-        GST_M3U8_MEDIA_FILE (g_list_last (demux->client->current->
-            files)->data)->sequence;
-    first_sequence =
-        GST_M3U8_MEDIA_FILE (demux->client->current->files->data)->sequence;
+    m3u8 = demux->client->current;
+    last_sequence = GST_M3U8_FILE_AT (m3u8, m3u8->files->len - 1)->sequence;
+    first_sequence = GST_M3U8_FILE_AT (m3u8, 0)->sequence;
 
     GST_DEBUG_OBJECT (demux,
         "sequence:%" G_GINT64_FORMAT " , first_sequence:%" G_GINT64_FORMAT
@@ -964,7 +1143,9 @@ retry:
   } else if (demux->client->current && !gst_m3u8_client_is_live (demux->client)) {
     GstClockTime current_pos, target_pos;
     guint sequence = 0;
-    GList *walk;
+    GstM3U8 *m3u8;
+    GstM3U8MediaFile *file;
+    gint idx;
 
     /* Sequence numbers are not guaranteed to be the same in different
      * playlists, so get the correct fragment here based on the current
@@ -987,20 +1168,20 @@ retry:
     GST_LOG_OBJECT (demux, "Looking for sequence position %"
         GST_TIME_FORMAT " in updated playlist", GST_TIME_ARGS (target_pos));
 
-    current_pos = 0;
-    for (walk = demux->client->current->files; walk; walk = walk->next) {
-      GstM3U8MediaFile *file = walk->data;
-
+    m3u8 = demux->client->current;
+    idx = gst_m3u8_find_file_by_position (m3u8, target_pos);
+    if (idx < m3u8->files->len) {
+      file = GST_M3U8_FILE_AT (m3u8, idx);
       sequence = file->sequence;
-      if (current_pos <= target_pos
-          && target_pos < current_pos + file->duration) {
-        break;
-      }
-      current_pos += file->duration;
+      current_pos = file->start;
+    } else if (idx > 0) {
+      /* End of playlist */
+      file = GST_M3U8_FILE_AT (m3u8, idx - 1);
+      sequence = file->sequence + 1;
+      current_pos = file->start + file->duration;
+    } else {
+      current_pos = 0;
     }
-    /* End of playlist */
-    if (!walk)
-      sequence++;
     demux->client->sequence = sequence;
     demux->client->sequence_position = current_pos;
     GST_M3U8_CLIENT_UNLOCK (demux->client);
@@ -1196,8 +1377,13 @@ decrypt_fragment (GstHLSDemux * demux, gsize length,
 {
   gcry_error_t err = 0;
 
-  err = gcry_cipher_decrypt (demux->aes_ctx, decrypted_data, length,
-      encrypted_data, length);
+  /* gcrypt decrypts in place when no separate input is given */
+  if (decrypted_data == encrypted_data)
+    err = gcry_cipher_decrypt (demux->aes_ctx, decrypted_data, length, NULL,
+        0);
+  else
+    err = gcry_cipher_decrypt (demux->aes_ctx, decrypted_data, length,
+        encrypted_data, length);
 
   return err == 0;
 }
@@ -1212,42 +1398,32 @@ gst_hls_demux_decrypt_end (GstHLSDemux * demux)
 }
 #endif
 
+/* Decrypts @buffer in place, its memory is only copied if it is shared */
 static GstBuffer *
-gst_hls_demux_decrypt_fragment (GstHLSDemux * demux,
-    GstBuffer * encrypted_buffer, GError ** err)
+gst_hls_demux_decrypt_fragment (GstHLSDemux * demux, GstBuffer * buffer,
+    GError ** err)
 {
-  GstBuffer *decrypted_buffer = NULL;
-  GstMapInfo encrypted_info, decrypted_info;
-
-  decrypted_buffer =
-      gst_buffer_new_allocate (NULL, gst_buffer_get_size (encrypted_buffer),
-      NULL);
+  GstMapInfo info;
 
-  gst_buffer_map (encrypted_buffer, &encrypted_info, GST_MAP_READ);
-  gst_buffer_map (decrypted_buffer, &decrypted_info, GST_MAP_WRITE);
+  buffer = gst_buffer_make_writable (buffer);
+  if (!gst_buffer_map (buffer, &info, GST_MAP_READWRITE))
+    goto map_error;
 
-  if (!decrypt_fragment (demux, encrypted_info.size,
-          encrypted_info.data, decrypted_info.data))
+  if (!decrypt_fragment (demux, info.size, info.data, info.data))
     goto decrypt_error;
 
+  gst_buffer_unmap (buffer, &info);
 
-  gst_buffer_unmap (decrypted_buffer, &decrypted_info);
-  gst_buffer_unmap (encrypted_buffer, &encrypted_info);
-
-  gst_buffer_unref (encrypted_buffer);
-
-  return decrypted_buffer;
+  return buffer;
 
 decrypt_error:
+  gst_buffer_unmap (buffer, &info);
+map_error:
   GST_ERROR_OBJECT (demux, "Failed to decrypt fragment");
   g_set_error (err, GST_STREAM_ERROR, GST_STREAM_ERROR_DECRYPT,
       "Failed to decrypt fragment");
 
-  gst_buffer_unmap (decrypted_buffer, &decrypted_info);
-  gst_buffer_unmap (encrypted_buffer, &encrypted_info);
-
-  gst_buffer_unref (encrypted_buffer);
-  gst_buffer_unref (decrypted_buffer);
+  gst_buffer_unref (buffer);
 
   return NULL;
 }
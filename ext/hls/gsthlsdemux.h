@@ -70,9 +70,10 @@ struct _GstHLSDemux
   GstM3U8Client *client;        /* M3U8 client */
   gboolean do_typefind;         /* Whether we need to typefind the next buffer */
 
-  /* Cache for the last key */
-  gchar *key_url;
-  GstFragment *key_fragment;
+  /* Cache of the decryption keys, key URI -> GstBuffer */
+  GHashTable *keys;
+  GQueue keys_lru;              /* URIs of the cached keys, most recently
+                                 * used last. Owned by the hash table */
 
   /* decryption tooling */
 #if defined(HAVE_OPENSSL)
@@ -27,6 +27,29 @@
  * |[
  * gst-launch-1.0 videotestsrc is-live=true ! x264enc ! mpegtsmux ! hlssink max-files=5
  * ]|
+ * Setting #GstHlsSink:part-duration enables low latency output: the segments
+ * are split in partial segments that are added to the playlist as soon as
+ * they are written.
+ * |[
+ * gst-launch-1.0 videotestsrc is-live=true ! x264enc ! mpegtsmux ! hlssink target-duration=2 part-duration=500
+ * ]|
+ * The playlist is rewritten after each partial segment, and an element
+ * message named "GstHlsSinkPlaylist" tells how far it goes with its
+ * "media-sequence" and "parts" fields. A server answering the blocking
+ * playlist reloads of the clients can wait for these messages, in which case
+ * #GstHlsSink:can-block-reload advertises it in the playlist.
+ * Fragmented MP4 (CMAF) input is written as is: the initialization segment
+ * goes to #GstHlsSink:init-location and is referenced with EXT-X-MAP, and the
+ * segments are split on fragment boundaries. MP4 input is only handled that
+ * way once a moof box follows the header, or when its caps have the
+ * "iso-fragmented" variant. The segments are numbered like the media sequence
+ * starting from 0, so a DASH SegmentTemplate using
+ * <literal>startNumber="0"</literal> can point to the same files. hlssink
+ * only writes the HLS playlist: the DASH manifest, with its SegmentTimeline
+ * if the segments don't have the same duration, is left to the application.
+ * |[
+ * gst-launch-1.0 videotestsrc is-live=true ! x264enc ! mp4mux fragment-duration=1000 streamable=true ! hlssink location=segment%05d.m4s
+ * ]|
  * </refsect2>
  */
 #ifdef HAVE_CONFIG_H
@@ -38,6 +61,8 @@
 #include <gst/video/video.h>
 #include <glib/gstdio.h>
 #include <memory.h>
+#include <string.h>
+#include <errno.h>
 
 
 GST_DEBUG_CATEGORY_STATIC (gst_hls_sink_debug);
@@ -49,9 +74,17 @@ GST_DEBUG_CATEGORY_STATIC (gst_hls_sink_debug);
 #define DEFAULT_MAX_FILES 10
 #define DEFAULT_TARGET_DURATION 15
 #define DEFAULT_PLAYLIST_LENGTH 5
+#define DEFAULT_PART_DURATION 0
+#define DEFAULT_PART_LOCATION "part%05d.ts"
+#define DEFAULT_INIT_LOCATION "init.mp4"
+#define DEFAULT_CAN_BLOCK_RELOAD FALSE
 
 #define GST_M3U8_PLAYLIST_VERSION 3
 
+#define MOOF_FOURCC GST_MAKE_FOURCC ('m', 'o', 'o', 'f')
+#define STYP_FOURCC GST_MAKE_FOURCC ('s', 't', 'y', 'p')
+#define MDAT_FOURCC GST_MAKE_FOURCC ('m', 'd', 'a', 't')
+
 enum
 {
   PROP_0,
@@ -60,7 +93,11 @@ enum
   PROP_PLAYLIST_ROOT,
   PROP_MAX_FILES,
   PROP_TARGET_DURATION,
-  PROP_PLAYLIST_LENGTH
+  PROP_PLAYLIST_LENGTH,
+  PROP_PART_DURATION,
+  PROP_PART_LOCATION,
+  PROP_INIT_LOCATION,
+  PROP_CAN_BLOCK_RELOAD
 };
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
@@ -103,6 +140,8 @@ gst_hls_sink_finalize (GObject * object)
   g_free (sink->location);
   g_free (sink->playlist_location);
   g_free (sink->playlist_root);
+  g_free (sink->part_location);
+  g_free (sink->init_location);
   if (sink->playlist)
     gst_m3u8_playlist_free (sink->playlist);
 
@@ -168,6 +207,26 @@ gst_hls_sink_class_init (GstHlsSinkClass * klass)
           "the playlist will be infinite.",
           0, G_MAXUINT, DEFAULT_PLAYLIST_LENGTH,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PART_DURATION,
+      g_param_spec_uint ("part-duration", "Part duration",
+          "The target duration in milliseconds of the partial segments "
+          "written for low latency playback (0 - disabled)",
+          0, G_MAXUINT, DEFAULT_PART_DURATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PART_LOCATION,
+      g_param_spec_string ("part-location", "Part Location",
+          "Location of the partial segment files to write",
+          DEFAULT_PART_LOCATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_INIT_LOCATION,
+      g_param_spec_string ("init-location", "Init Location",
+          "Location of the initialization segment of fragmented MP4 input",
+          DEFAULT_INIT_LOCATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_CAN_BLOCK_RELOAD,
+      g_param_spec_boolean ("can-block-reload", "Can block reload",
+          "Advertise that the server holds back playlist requests for "
+          "partial segments that aren't written yet",
+          DEFAULT_CAN_BLOCK_RELOAD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -189,6 +248,10 @@ gst_hls_sink_init (GstHlsSink * sink)
   sink->playlist_length = DEFAULT_PLAYLIST_LENGTH;
   sink->max_files = DEFAULT_MAX_FILES;
   sink->target_duration = DEFAULT_TARGET_DURATION;
+  sink->part_duration = DEFAULT_PART_DURATION;
+  sink->part_location = g_strdup (DEFAULT_PART_LOCATION);
+  sink->init_location = g_strdup (DEFAULT_INIT_LOCATION);
+  sink->can_block_reload = DEFAULT_CAN_BLOCK_RELOAD;
 
   /* haven't added a sink yet, make it is detected as a sink meanwhile */
   GST_OBJECT_FLAG_SET (sink, GST_ELEMENT_FLAG_SINK);
@@ -207,11 +270,50 @@ gst_hls_sink_reset (GstHlsSink * sink)
   gst_event_replace (&sink->force_key_unit_event, NULL);
   gst_segment_init (&sink->segment, GST_FORMAT_UNDEFINED);
 
+  sink->last_part_running_time = 0;
+  sink->splitting_part = FALSE;
+  sink->part_independent = TRUE;
+  sink->part_splits = 0;
+  sink->segment_index = 0;
+  if (sink->segment_file) {
+    fclose (sink->segment_file);
+    sink->segment_file = NULL;
+  }
+  g_free (sink->segment_filename);
+  sink->segment_filename = NULL;
+
+  sink->fragmented = FALSE;
+  sink->last_buffer_end = GST_CLOCK_TIME_NONE;
+  if (sink->init_data) {
+    g_byte_array_unref (sink->init_data);
+    sink->init_data = NULL;
+  }
+
   if (sink->playlist)
     gst_m3u8_playlist_free (sink->playlist);
   sink->playlist =
       gst_m3u8_playlist_new (GST_M3U8_PLAYLIST_VERSION, sink->playlist_length,
       FALSE);
+  sink->playlist->part_target = sink->part_duration * GST_MSECOND;
+  sink->playlist->can_block_reload = sink->can_block_reload;
+}
+
+static void
+gst_hls_sink_configure_multifilesink (GstHlsSink * sink)
+{
+  const gchar *location = sink->location;
+  guint max_files = sink->max_files;
+
+  if (sink->part_duration > 0) {
+    /* multifilesink writes the partial segments, keep about as many
+     * segments worth of them as full segments */
+    location = sink->part_location;
+    if (sink->target_duration > 0)
+      max_files *= sink->target_duration * 1000 / sink->part_duration + 1;
+  }
+
+  g_object_set (sink->multifilesink, "location", location,
+      "next-file", 3, "post-messages", TRUE, "max-files", max_files, NULL);
 }
 
 static gboolean
@@ -228,9 +330,7 @@ gst_hls_sink_create_elements (GstHlsSink * sink)
   if (sink->multifilesink == NULL)
     goto missing_element;
 
-  g_object_set (sink->multifilesink, "location", sink->location,
-      "next-file", 3, "post-messages", TRUE, "max-files", sink->max_files,
-      NULL);
+  gst_hls_sink_configure_multifilesink (sink);
 
   gst_bin_add (GST_BIN_CAST (sink), sink->multifilesink);
 
@@ -254,20 +354,164 @@ missing_element:
 static void
 gst_hls_sink_write_playlist (GstHlsSink * sink)
 {
-  char *playlist_content;
-  GError *error = NULL;
+  gchar *playlist_content;
+  gchar *tmp_location;
+  FILE *file;
+  gboolean ret;
 
   playlist_content = gst_m3u8_playlist_render (sink->playlist);
-  if (!g_file_set_contents (sink->playlist_location,
-          playlist_content, -1, &error)) {
-    GST_ERROR ("Failed to write playlist: %s", error->message);
+
+  /* Write a temporary file and rename it over the playlist so that clients
+   * never see a partially written playlist. Unlike g_file_set_contents()
+   * this doesn't fsync, which would block the streaming thread for every
+   * partial segment */
+  tmp_location = g_strdup_printf ("%s.tmp", sink->playlist_location);
+  file = g_fopen (tmp_location, "wb");
+  ret = file != NULL;
+  if (ret) {
+    ret = fwrite (playlist_content, strlen (playlist_content), 1, file) == 1;
+    ret = fclose (file) == 0 && ret;
+  }
+  if (ret)
+    ret = g_rename (tmp_location, sink->playlist_location) == 0;
+
+  if (!ret) {
+    GST_ERROR_OBJECT (sink, "Failed to write playlist: %s",
+        g_strerror (errno));
     GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
-        (("Failed to write playlist '%s'."), error->message), (NULL));
-    g_error_free (error);
-    error = NULL;
+        (("Failed to write playlist '%s'."), sink->playlist_location),
+        GST_ERROR_SYSTEM);
+    g_remove (tmp_location);
   }
+  g_free (tmp_location);
   g_free (playlist_content);
+}
+
+static gchar *
+gst_hls_sink_get_entry_location (GstHlsSink * sink, const gchar * filename)
+{
+  gchar *name, *entry_location;
+
+  name = g_path_get_basename (filename);
+  if (sink->playlist_root == NULL)
+    return name;
+
+  entry_location = g_build_filename (sink->playlist_root, name, NULL);
+  g_free (name);
+  return entry_location;
+}
+
+static void
+gst_hls_sink_open_segment (GstHlsSink * sink)
+{
+  sink->segment_filename =
+      g_strdup_printf (sink->location, sink->segment_index);
+  sink->segment_file = g_fopen (sink->segment_filename, "wb");
+  if (sink->segment_file == NULL) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
+        (("Could not open file \"%s\" for writing."),
+            sink->segment_filename), GST_ERROR_SYSTEM);
+  }
+}
+
+/* In low latency mode, the data is written to the segment as it goes to
+ * the partial segment, for the clients without support for partial
+ * segments */
+static void
+gst_hls_sink_write_segment_data (GstHlsSink * sink, GstBuffer * buf)
+{
+  GstMapInfo map;
+
+  if (sink->segment_filename == NULL)
+    gst_hls_sink_open_segment (sink);
+  if (sink->segment_file == NULL)
+    return;
 
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  if (map.size > 0 && fwrite (map.data, map.size, 1, sink->segment_file) != 1) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+        (("Error while writing to file \"%s\"."), sink->segment_filename),
+        GST_ERROR_SYSTEM);
+  }
+  gst_buffer_unmap (buf, &map);
+}
+
+/* Called for each partial segment closed by multifilesink. The next one is
+ * announced as soon as this one is listed */
+static void
+gst_hls_sink_add_part (GstHlsSink * sink, const gchar * filename,
+    GstClockTime running_time)
+{
+  GstClockTime duration;
+  gchar *entry_location, *next_filename;
+  gint index;
+
+  duration = running_time - sink->last_part_running_time;
+  sink->last_part_running_time = running_time;
+
+  /* a segment without data still needs a file */
+  if (sink->segment_filename == NULL)
+    gst_hls_sink_open_segment (sink);
+
+  entry_location = gst_hls_sink_get_entry_location (sink, filename);
+  gst_m3u8_playlist_add_part (sink->playlist, entry_location, duration,
+      sink->part_independent);
+  g_free (entry_location);
+
+  /* the index of multifilesink is the one of the next file, unless it is
+   * only incremented when that one is opened */
+  g_object_get (sink->multifilesink, "index", &index, NULL);
+  next_filename = g_strdup_printf (sink->part_location, index);
+  if (strcmp (next_filename, filename) == 0) {
+    g_free (next_filename);
+    next_filename = g_strdup_printf (sink->part_location, index + 1);
+  }
+  entry_location = gst_hls_sink_get_entry_location (sink, next_filename);
+  gst_m3u8_playlist_set_preload_hint (sink->playlist, entry_location);
+  g_free (entry_location);
+  g_free (next_filename);
+
+  /* unless we cut this part ourselves, the next one starts a new segment
+   * and so with a key unit */
+  sink->part_independent = !sink->splitting_part;
+}
+
+/* Tells a server answering blocking playlist reloads which partial
+ * segments the playlist lists now: the first @parts ones of the segment
+ * with @media-sequence, and all of the segments before */
+static void
+gst_hls_sink_post_playlist_message (GstHlsSink * sink)
+{
+  GstStructure *s;
+
+  s = gst_structure_new ("GstHlsSinkPlaylist",
+      "location", G_TYPE_STRING, sink->playlist_location,
+      "media-sequence", G_TYPE_UINT, sink->playlist->sequence_number,
+      "parts", G_TYPE_UINT, sink->playlist->n_parts, NULL);
+  gst_element_post_message (GST_ELEMENT_CAST (sink),
+      gst_message_new_element (GST_OBJECT_CAST (sink), s));
+}
+
+static void
+gst_hls_sink_finish_segment (GstHlsSink * sink)
+{
+  if (sink->segment_file) {
+    fclose (sink->segment_file);
+    sink->segment_file = NULL;
+  }
+  g_free (sink->segment_filename);
+  sink->segment_filename = NULL;
+
+  /* multifilesink only takes care of the partial segments */
+  if (sink->max_files > 0 && sink->segment_index >= sink->max_files) {
+    gchar *old_filename;
+
+    old_filename = g_strdup_printf (sink->location,
+        sink->segment_index - sink->max_files);
+    g_remove (old_filename);
+    g_free (old_filename);
+  }
+  sink->segment_index++;
 }
 
 static void
@@ -290,23 +534,42 @@ gst_hls_sink_handle_message (GstBin * bin, GstMessage * message)
 
       filename = gst_structure_get_string (structure, "filename");
       gst_structure_get_clock_time (structure, "running-time", &running_time);
+
+      if (sink->part_duration > 0) {
+        gst_hls_sink_add_part (sink, filename, running_time);
+        if (sink->splitting_part) {
+          /* only a partial segment, the segment goes on */
+          gst_hls_sink_write_playlist (sink);
+          gst_hls_sink_post_playlist_message (sink);
+          GST_DEBUG_OBJECT (bin, "dropping message %" GST_PTR_FORMAT,
+              message);
+          gst_message_unref (message);
+          message = NULL;
+          break;
+        }
+        filename = sink->segment_filename;
+      }
+
       duration = running_time - sink->last_running_time;
       sink->last_running_time = running_time;
 
       GST_INFO_OBJECT (sink, "COUNT %d", sink->index);
-      if (sink->playlist_root == NULL)
-        entry_location = g_path_get_basename (filename);
-      else {
-        gchar *name = g_path_get_basename (filename);
-        entry_location = g_build_filename (sink->playlist_root, name, NULL);
-        g_free (name);
-      }
+      entry_location = gst_hls_sink_get_entry_location (sink, filename);
 
       gst_m3u8_playlist_add_entry (sink->playlist, entry_location,
           NULL, duration, sink->index, discont);
       g_free (entry_location);
 
+      if (sink->part_duration > 0)
+        gst_hls_sink_finish_segment (sink);
+
+      /* we split fragmented MP4 ourselves, see the event probe */
+      if (sink->fragmented && sink->target_duration > 0)
+        sink->index++;
+
       gst_hls_sink_write_playlist (sink);
+      if (sink->part_duration > 0)
+        gst_hls_sink_post_playlist_message (sink);
 
       /* multifilesink is starting a new file. It means that upstream sent a key
        * unit and we can schedule the next key unit now.
@@ -381,7 +644,7 @@ gst_hls_sink_set_property (GObject * object, guint prop_id,
       g_free (sink->location);
       sink->location = g_value_dup_string (value);
       if (sink->multifilesink)
-        g_object_set (sink->multifilesink, "location", sink->location, NULL);
+        gst_hls_sink_configure_multifilesink (sink);
       break;
     case PROP_PLAYLIST_LOCATION:
       g_free (sink->playlist_location);
@@ -393,19 +656,38 @@ gst_hls_sink_set_property (GObject * object, guint prop_id,
       break;
     case PROP_MAX_FILES:
       sink->max_files = g_value_get_uint (value);
-      if (sink->multifilesink) {
-        g_object_set (sink->multifilesink, "location", sink->location,
-            "next-file", 3, "post-messages", TRUE, "max-files", sink->max_files,
-            NULL);
-      }
+      if (sink->multifilesink)
+        gst_hls_sink_configure_multifilesink (sink);
       break;
     case PROP_TARGET_DURATION:
       sink->target_duration = g_value_get_uint (value);
+      if (sink->multifilesink)
+        gst_hls_sink_configure_multifilesink (sink);
       break;
     case PROP_PLAYLIST_LENGTH:
       sink->playlist_length = g_value_get_uint (value);
       sink->playlist->window_size = sink->playlist_length;
       break;
+    case PROP_PART_DURATION:
+      sink->part_duration = g_value_get_uint (value);
+      sink->playlist->part_target = sink->part_duration * GST_MSECOND;
+      if (sink->multifilesink)
+        gst_hls_sink_configure_multifilesink (sink);
+      break;
+    case PROP_PART_LOCATION:
+      g_free (sink->part_location);
+      sink->part_location = g_value_dup_string (value);
+      if (sink->multifilesink)
+        gst_hls_sink_configure_multifilesink (sink);
+      break;
+    case PROP_INIT_LOCATION:
+      g_free (sink->init_location);
+      sink->init_location = g_value_dup_string (value);
+      break;
+    case PROP_CAN_BLOCK_RELOAD:
+      sink->can_block_reload = g_value_get_boolean (value);
+      sink->playlist->can_block_reload = sink->can_block_reload;
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -437,6 +719,18 @@ gst_hls_sink_get_property (GObject * object, guint prop_id,
     case PROP_PLAYLIST_LENGTH:
       g_value_set_uint (value, sink->playlist_length);
       break;
+    case PROP_PART_DURATION:
+      g_value_set_uint (value, sink->part_duration);
+      break;
+    case PROP_PART_LOCATION:
+      g_value_set_string (value, sink->part_location);
+      break;
+    case PROP_INIT_LOCATION:
+      g_value_set_string (value, sink->init_location);
+      break;
+    case PROP_CAN_BLOCK_RELOAD:
+      g_value_set_boolean (value, sink->can_block_reload);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -459,6 +753,27 @@ gst_hls_sink_ghost_event_probe (GstPad * pad, GstPadProbeInfo * info,
     case GST_EVENT_FLUSH_STOP:
       gst_segment_init (&sink->segment, GST_FORMAT_UNDEFINED);
       break;
+    case GST_EVENT_CAPS:
+    {
+      GstCaps *caps;
+      GstStructure *s;
+
+      gst_event_parse_caps (event, &caps);
+      s = gst_caps_get_structure (caps, 0);
+      if (sink->fragmented || sink->init_data ||
+          !gst_structure_has_name (s, "video/quicktime"))
+        break;
+
+      /* mp4mux doesn't tell whether it fragments, in which case the boxes
+       * are held back until the first moof or mdat box shows it */
+      if (!g_strcmp0 (gst_structure_get_string (s, "variant"),
+              "iso-fragmented")) {
+        GST_INFO_OBJECT (sink, "fragmented MP4 input");
+        sink->fragmented = TRUE;
+      }
+      sink->init_data = g_byte_array_new ();
+      break;
+    }
     case GST_EVENT_CUSTOM_DOWNSTREAM:
     {
       GstClockTime timestamp;
@@ -469,6 +784,11 @@ gst_hls_sink_ghost_event_probe (GstPad * pad, GstPadProbeInfo * info,
       if (!gst_video_event_is_force_key_unit (event))
         break;
 
+      /* key units don't necessarily start a fragment, multifilesink must
+       * only split on the moof boxes */
+      if (sink->fragmented && sink->target_duration > 0)
+        return GST_PAD_PROBE_DROP;
+
       gst_event_replace (&sink->force_key_unit_event, event);
       gst_video_event_parse_downstream_force_key_unit (event,
           &timestamp, &stream_time, &running_time, &all_headers, &count);
@@ -515,6 +835,18 @@ out:
   return res;
 }
 
+static GstClockTime
+gst_hls_sink_get_running_time (GstHlsSink * sink, GstClockTime timestamp)
+{
+  /* muxers like mp4mux output a BYTES segment with buffers timestamped in
+   * running time already */
+  if (sink->segment.format != GST_FORMAT_TIME)
+    return timestamp;
+
+  return gst_segment_to_running_time (&sink->segment, GST_FORMAT_TIME,
+      timestamp);
+}
+
 static void
 gst_hls_sink_check_schedule_next_key_unit (GstHlsSink * sink, GstBuffer * buf)
 {
@@ -524,11 +856,177 @@ gst_hls_sink_check_schedule_next_key_unit (GstHlsSink * sink, GstBuffer * buf)
   if (!GST_CLOCK_TIME_IS_VALID (timestamp))
     return;
 
-  sink->last_running_time = gst_segment_to_running_time (&sink->segment,
-      GST_FORMAT_TIME, timestamp);
+  sink->last_running_time = gst_hls_sink_get_running_time (sink, timestamp);
   schedule_next_key_unit (sink);
 }
 
+static gboolean
+gst_hls_sink_buffer_starts_box (GstBuffer * buf, guint32 fourcc)
+{
+  guint8 header[8];
+
+  if (gst_buffer_extract (buf, 0, header, 8) != 8)
+    return FALSE;
+
+  return GST_READ_UINT32_LE (header + 4) == fourcc;
+}
+
+/* The samples of regular MP4 input come before any fragment, the boxes held
+ * back so far are written in front of them like the rest of the file, to the
+ * segment as well in low latency mode */
+static void
+gst_hls_sink_release_init_data (GstHlsSink * sink)
+{
+  GstBuffer *buf;
+  GstPad *pad;
+  guint size = sink->init_data->len;
+
+  GST_INFO_OBJECT (sink, "MP4 input is not fragmented");
+
+  if (size == 0) {
+    g_byte_array_unref (sink->init_data);
+    sink->init_data = NULL;
+    return;
+  }
+
+  buf = gst_buffer_new_wrapped (g_byte_array_free (sink->init_data, FALSE),
+      size);
+  sink->init_data = NULL;
+
+  if (sink->part_duration > 0)
+    gst_hls_sink_write_segment_data (sink, buf);
+
+  pad = gst_element_get_static_pad (sink->multifilesink, "sink");
+  if (gst_pad_chain (pad, buf) != GST_FLOW_OK)
+    GST_WARNING_OBJECT (sink, "Failed to write the held back boxes");
+  gst_object_unref (pad);
+}
+
+/* Collects the boxes preceding the first fragment of fragmented MP4 input.
+ * Returns FALSE while @buf belongs to the init segment */
+static gboolean
+gst_hls_sink_collect_init_segment (GstHlsSink * sink, GstBuffer * buf)
+{
+  GstMapInfo map;
+  GError *error = NULL;
+  gchar *entry_location;
+
+  if (!sink->fragmented && gst_hls_sink_buffer_starts_box (buf, MDAT_FOURCC)) {
+    gst_hls_sink_release_init_data (sink);
+    return TRUE;
+  }
+
+  if (!gst_hls_sink_buffer_starts_box (buf, MOOF_FOURCC) &&
+      !gst_hls_sink_buffer_starts_box (buf, STYP_FOURCC)) {
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    g_byte_array_append (sink->init_data, map.data, map.size);
+    gst_buffer_unmap (buf, &map);
+    return FALSE;
+  }
+
+  if (!sink->fragmented) {
+    GST_INFO_OBJECT (sink, "fragmented MP4 input");
+    sink->fragmented = TRUE;
+  }
+
+  GST_INFO_OBJECT (sink, "writing init segment of %u bytes",
+      sink->init_data->len);
+
+  if (!g_file_set_contents (sink->init_location,
+          (const gchar *) sink->init_data->data, sink->init_data->len,
+          &error)) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
+        (("Failed to write init segment '%s'."), sink->init_location),
+        ("%s", error->message));
+    g_error_free (error);
+  }
+  g_byte_array_unref (sink->init_data);
+  sink->init_data = NULL;
+
+  entry_location = gst_hls_sink_get_entry_location (sink, sink->init_location);
+  gst_m3u8_playlist_set_map (sink->playlist, entry_location);
+  g_free (entry_location);
+
+  return TRUE;
+}
+
+/* Closes the current file before @buf once the partial segment or, for
+ * fragmented MP4, the segment is long enough. The force-key-unit event is
+ * sent to multifilesink directly, so it doesn't go through the ghost pad
+ * probe nor change the segment index */
+static void
+gst_hls_sink_check_split (GstHlsSink * sink, GstBuffer * buf)
+{
+  GstClockTime timestamp, running_time, stream_time;
+  gboolean split_segment = FALSE;
+  guint count;
+  GstPad *pad;
+
+  timestamp = GST_BUFFER_TIMESTAMP (buf);
+  running_time = gst_hls_sink_get_running_time (sink, timestamp);
+
+  if (sink->fragmented) {
+    GstClockTime previous_end = sink->last_buffer_end;
+
+    if (GST_CLOCK_TIME_IS_VALID (running_time)) {
+      sink->last_buffer_end = running_time;
+      if (GST_BUFFER_DURATION_IS_VALID (buf))
+        sink->last_buffer_end += GST_BUFFER_DURATION (buf);
+    }
+
+    if (!gst_hls_sink_buffer_starts_box (buf, MOOF_FOURCC))
+      return;
+
+    /* moof boxes usually have no timestamp, they start where the samples of
+     * the previous fragment ended */
+    if (!GST_CLOCK_TIME_IS_VALID (running_time))
+      running_time = previous_end;
+
+    if (GST_CLOCK_TIME_IS_VALID (running_time) && sink->target_duration > 0 &&
+        running_time >= sink->last_running_time +
+        sink->target_duration * GST_SECOND)
+      split_segment = TRUE;
+  }
+
+  if (!GST_CLOCK_TIME_IS_VALID (running_time))
+    return;
+
+  if (!split_segment && (sink->part_duration == 0 ||
+          running_time < sink->last_part_running_time +
+          sink->part_duration * GST_MSECOND))
+    return;
+
+  if (sink->segment.format == GST_FORMAT_TIME)
+    stream_time = gst_segment_to_stream_time (&sink->segment,
+        GST_FORMAT_TIME, timestamp);
+  else
+    stream_time = timestamp;
+
+  GST_DEBUG_OBJECT (sink, "closing %s at %" GST_TIME_FORMAT,
+      split_segment ? "segment" : "partial segment",
+      GST_TIME_ARGS (running_time));
+
+  /* multifilesink ignores a force-key-unit event with the same count as the
+   * previous one, partial segments count down from G_MAXUINT so that they
+   * differ from each other and from the counts of the segments */
+  if (split_segment)
+    count = sink->index;
+  else
+    count = G_MAXUINT - sink->part_splits++;
+
+  pad = gst_element_get_static_pad (sink->multifilesink, "sink");
+  sink->splitting_part = !split_segment;
+  gst_pad_send_event (pad,
+      gst_video_event_new_downstream_force_key_unit (timestamp, stream_time,
+          running_time, FALSE, count));
+  sink->splitting_part = FALSE;
+  gst_object_unref (pad);
+
+  /* multifilesink has no file open if nothing was written since the last
+   * split, don't try again for every buffer then */
+  sink->last_part_running_time = running_time;
+}
+
 static GstPadProbeReturn
 gst_hls_sink_ghost_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
     gpointer data)
@@ -536,6 +1034,15 @@ gst_hls_sink_ghost_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
   GstHlsSink *sink = GST_HLS_SINK_CAST (data);
   GstBuffer *buffer = gst_pad_probe_info_get_buffer (info);
 
+  if (sink->init_data && !gst_hls_sink_collect_init_segment (sink, buffer))
+    return GST_PAD_PROBE_DROP;
+
+  if (sink->part_duration > 0 || sink->fragmented)
+    gst_hls_sink_check_split (sink, buffer);
+
+  if (sink->part_duration > 0)
+    gst_hls_sink_write_segment_data (sink, buffer);
+
   if (sink->target_duration == 0 || sink->waiting_fku)
     return GST_PAD_PROBE_OK;
 
@@ -551,7 +1058,10 @@ gst_hls_sink_chain_list (GstPad * pad, GstObject * parent, GstBufferList * list)
   GstFlowReturn ret;
   GstHlsSink *sink = GST_HLS_SINK_CAST (parent);
 
-  if (sink->target_duration == 0 || sink->waiting_fku)
+  /* partial segments and fragments are split on buffers, which the probe
+   * needs to see */
+  if ((sink->target_duration == 0 || sink->waiting_fku) &&
+      sink->part_duration == 0 && !sink->fragmented)
     return gst_proxy_pad_chain_list_default (pad, parent, list);
 
   GST_DEBUG_OBJECT (pad, "chaining each group in list as a merged buffer");
@@ -562,7 +1072,7 @@ gst_hls_sink_chain_list (GstPad * pad, GstObject * parent, GstBufferList * list)
   for (i = 0; i < len; i++) {
     buffer = gst_buffer_list_get (list, i);
 
-    if (!sink->waiting_fku)
+    if (sink->target_duration != 0 && !sink->waiting_fku)
       gst_hls_sink_check_schedule_next_key_unit (sink, buffer);
 
     ret = gst_pad_chain (pad, gst_buffer_ref (buffer));
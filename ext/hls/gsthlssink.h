@@ -21,6 +21,7 @@
 
 #include "gstm3u8playlist.h"
 #include <gst/gst.h>
+#include <stdio.h>
 
 G_BEGIN_DECLS
 
@@ -56,6 +57,26 @@ struct _GstHlsSink
   GstSegment segment;
   gboolean waiting_fku;
   GstClockTime last_running_time;
+
+  /* low latency mode: multifilesink writes the partial segments and the
+   * segments are assembled from them */
+  guint part_duration;
+  gchar *part_location;
+  GstClockTime last_part_running_time;
+  gboolean splitting_part;
+  gboolean part_independent;
+  guint segment_index;
+  gchar *segment_filename;
+  FILE *segment_file;
+  guint part_splits;
+  gboolean can_block_reload;
+
+  /* fragmented MP4 input: the init segment is written once and the
+   * segments are split on moof boxes */
+  gchar *init_location;
+  gboolean fragmented;
+  GByteArray *init_data;        /* init segment being collected */
+  GstClockTime last_buffer_end;
 };
 
 struct _GstHlsSinkClass
@@ -32,6 +32,11 @@ enum
   GST_M3U8_PLAYLIST_TYPE_VOD,
 };
 
+/* Number of segments at the end of the playlist that keep their partial
+ * segments listed. The draft asks to remove the parts that are more than
+ * three target durations away from the end of the playlist */
+#define GST_M3U8_PLAYLIST_PARTS_WINDOW 3
+
 typedef struct _GstM3U8Entry GstM3U8Entry;
 
 struct _GstM3U8Entry
@@ -40,6 +45,9 @@ struct _GstM3U8Entry
   gchar *title;
   gchar *url;
   gboolean discontinuous;
+  gchar *parts;                 /* EXT-X-PART lines of this segment, or NULL */
+  gchar *text;                  /* rendered EXTINF and URI lines */
+  gsize text_len;
 };
 
 static GstM3U8Entry *
@@ -65,9 +73,40 @@ gst_m3u8_entry_free (GstM3U8Entry * entry)
 
   g_free (entry->url);
   g_free (entry->title);
+  g_free (entry->parts);
+  g_free (entry->text);
   g_free (entry);
 }
 
+/* Entries never change once added, so they are rendered only once */
+static void
+gst_m3u8_entry_render (GstM3U8Entry * entry, guint version)
+{
+  GString *str;
+
+  str = g_string_new (NULL);
+
+  if (entry->discontinuous)
+    g_string_append (str, "#EXT-X-DISCONTINUITY\n");
+
+  if (version < 3) {
+    g_string_append_printf (str, "#EXTINF:%d,%s\n",
+        (gint) ((entry->duration + 500 * GST_MSECOND) / GST_SECOND),
+        entry->title ? entry->title : "");
+  } else {
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_string_append_printf (str, "#EXTINF:%s,%s\n",
+        g_ascii_dtostr (buf, sizeof (buf), entry->duration / GST_SECOND),
+        entry->title ? entry->title : "");
+  }
+
+  g_string_append_printf (str, "%s\n", entry->url);
+
+  entry->text_len = str->len;
+  entry->text = g_string_free (str, FALSE);
+}
+
 GstM3U8Playlist *
 gst_m3u8_playlist_new (guint version, guint window_size, gboolean allow_cache)
 {
@@ -80,6 +119,8 @@ gst_m3u8_playlist_new (guint version, guint window_size, gboolean allow_cache)
   playlist->type = GST_M3U8_PLAYLIST_TYPE_EVENT;
   playlist->end_list = FALSE;
   playlist->entries = g_queue_new ();
+  playlist->body = g_string_new (NULL);
+  playlist->parts = g_string_new (NULL);
 
   return playlist;
 }
@@ -91,9 +132,26 @@ gst_m3u8_playlist_free (GstM3U8Playlist * playlist)
 
   g_queue_foreach (playlist->entries, (GFunc) gst_m3u8_entry_free, NULL);
   g_queue_free (playlist->entries);
+  g_string_free (playlist->body, TRUE);
+  g_string_free (playlist->parts, TRUE);
+  g_free (playlist->map_uri);
+  g_free (playlist->preload_hint);
   g_free (playlist);
 }
 
+static void
+gst_m3u8_playlist_update_max_duration (GstM3U8Playlist * playlist)
+{
+  GList *l;
+
+  playlist->max_duration = 0;
+  for (l = playlist->entries->head; l != NULL; l = l->next) {
+    GstM3U8Entry *entry = l->data;
+
+    if (entry->duration > playlist->max_duration)
+      playlist->max_duration = entry->duration;
+  }
+}
 
 gboolean
 gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
@@ -101,6 +159,7 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
     gfloat duration, guint index, gboolean discontinuous)
 {
   GstM3U8Entry *entry;
+  gboolean removed_max = FALSE;
 
   g_return_val_if_fail (playlist != NULL, FALSE);
   g_return_val_if_fail (url != NULL, FALSE);
@@ -109,6 +168,14 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
     return FALSE;
 
   entry = gst_m3u8_entry_new (url, title, duration, discontinuous);
+  gst_m3u8_entry_render (entry, playlist->version);
+
+  /* the parts written so far make up this segment */
+  if (playlist->parts->len > 0) {
+    entry->parts = g_strndup (playlist->parts->str, playlist->parts->len);
+    g_string_truncate (playlist->parts, 0);
+    playlist->n_parts = 0;
+  }
 
   if (playlist->window_size > 0) {
     /* Delete old entries from the playlist */
@@ -116,6 +183,12 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
       GstM3U8Entry *old_entry;
 
       old_entry = g_queue_pop_head (playlist->entries);
+      if (playlist->n_serialized > 0) {
+        g_string_erase (playlist->body, 0, old_entry->text_len);
+        playlist->n_serialized--;
+      }
+      if (old_entry->duration >= playlist->max_duration)
+        removed_max = TRUE;
       gst_m3u8_entry_free (old_entry);
     }
   }
@@ -123,37 +196,88 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
   playlist->sequence_number = index + 1;
   g_queue_push_tail (playlist->entries, entry);
 
+  /* Entries that no longer list their parts are appended to the serialized
+   * body, so rendering only has to copy it */
+  while (playlist->entries->length - playlist->n_serialized >
+      GST_M3U8_PLAYLIST_PARTS_WINDOW) {
+    GstM3U8Entry *old_entry;
+
+    old_entry = g_queue_peek_nth (playlist->entries, playlist->n_serialized);
+    g_string_append_len (playlist->body, old_entry->text,
+        old_entry->text_len);
+    playlist->n_serialized++;
+  }
+
+  if (removed_max)
+    gst_m3u8_playlist_update_max_duration (playlist);
+  else if (duration > playlist->max_duration)
+    playlist->max_duration = duration;
+
   return TRUE;
 }
 
-static guint
-gst_m3u8_playlist_target_duration (GstM3U8Playlist * playlist)
+gboolean
+gst_m3u8_playlist_add_part (GstM3U8Playlist * playlist, const gchar * url,
+    gfloat duration, gboolean independent)
 {
-  guint64 target_duration = 0;
-  GList *l;
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
 
-  for (l = playlist->entries->head; l != NULL; l = l->next) {
-    GstM3U8Entry *entry = l->data;
+  g_return_val_if_fail (playlist != NULL, FALSE);
+  g_return_val_if_fail (url != NULL, FALSE);
 
-    if (entry->duration > target_duration)
-      target_duration = entry->duration;
-  }
+  if (playlist->type == GST_M3U8_PLAYLIST_TYPE_VOD)
+    return FALSE;
+
+  g_string_append_printf (playlist->parts, "#EXT-X-PART:DURATION=%s,"
+      "URI=\"%s\"%s\n", g_ascii_dtostr (buf, sizeof (buf),
+          duration / GST_SECOND), url, independent ? ",INDEPENDENT=YES" : "");
+  playlist->n_parts++;
+
+  return TRUE;
+}
+
+void
+gst_m3u8_playlist_set_map (GstM3U8Playlist * playlist, const gchar * uri)
+{
+  g_return_if_fail (playlist != NULL);
+
+  g_free (playlist->map_uri);
+  playlist->map_uri = g_strdup (uri);
 
-  return (guint) ((target_duration + 500 * GST_MSECOND) / GST_SECOND);
+  /* EXT-X-MAP requires version 6 in playlists that aren't I-frames only */
+  if (uri && playlist->version < 6)
+    playlist->version = 6;
+}
+
+/* The partial segment that is written next, announced so that clients can
+ * request it before it is complete */
+void
+gst_m3u8_playlist_set_preload_hint (GstM3U8Playlist * playlist,
+    const gchar * uri)
+{
+  g_return_if_fail (playlist != NULL);
+
+  g_free (playlist->preload_hint);
+  playlist->preload_hint = g_strdup (uri);
 }
 
 gchar *
 gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
 {
   GString *playlist_str;
+  guint version;
   GList *l;
 
   g_return_val_if_fail (playlist != NULL, NULL);
 
-  playlist_str = g_string_new ("#EXTM3U\n");
+  playlist_str = g_string_sized_new (playlist->body->len + 1024);
+  g_string_append (playlist_str, "#EXTM3U\n");
 
-  g_string_append_printf (playlist_str, "#EXT-X-VERSION:%d\n",
-      playlist->version);
+  /* low latency playlists are at least version 6 */
+  version = playlist->version;
+  if (playlist->part_target > 0 && version < 6)
+    version = 6;
+  g_string_append_printf (playlist_str, "#EXT-X-VERSION:%d\n", version);
 
   g_string_append_printf (playlist_str, "#EXT-X-ALLOW-CACHE:%s\n",
       playlist->allow_cache ? "YES" : "NO");
@@ -162,32 +286,46 @@ gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
       playlist->sequence_number - playlist->entries->length);
 
   g_string_append_printf (playlist_str, "#EXT-X-TARGETDURATION:%u\n",
-      gst_m3u8_playlist_target_duration (playlist));
+      (guint) ((playlist->max_duration + 500 * GST_MSECOND) / GST_SECOND));
+
+  if (playlist->part_target > 0) {
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_string_append_printf (playlist_str, "#EXT-X-PART-INF:PART-TARGET=%s\n",
+        g_ascii_dtostr (buf, sizeof (buf), playlist->part_target / GST_SECOND));
+    /* clients must stay at least 3 part targets behind the live edge */
+    g_string_append_printf (playlist_str,
+        "#EXT-X-SERVER-CONTROL:%sPART-HOLD-BACK=%s\n",
+        playlist->can_block_reload ? "CAN-BLOCK-RELOAD=YES," : "",
+        g_ascii_dtostr (buf, sizeof (buf),
+            3 * playlist->part_target / GST_SECOND));
+  }
+
+  if (playlist->map_uri)
+    g_string_append_printf (playlist_str, "#EXT-X-MAP:URI=\"%s\"\n",
+        playlist->map_uri);
   g_string_append (playlist_str, "\n");
 
   /* Entries */
-  for (l = playlist->entries->head; l != NULL; l = l->next) {
-    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
-    GstM3U8Entry *entry = l->data;
+  g_string_append_len (playlist_str, playlist->body->str, playlist->body->len);
 
-    if (entry->discontinuous)
-      g_string_append (playlist_str, "#EXT-X-DISCONTINUITY\n");
-
-    if (playlist->version < 3) {
-      g_string_append_printf (playlist_str, "#EXTINF:%d,%s\n",
-          (gint) ((entry->duration + 500 * GST_MSECOND) / GST_SECOND),
-          entry->title ? entry->title : "");
-    } else {
-      g_string_append_printf (playlist_str, "#EXTINF:%s,%s\n",
-          g_ascii_dtostr (buf, sizeof (buf), entry->duration / GST_SECOND),
-          entry->title ? entry->title : "");
-    }
+  l = g_queue_peek_nth_link (playlist->entries, playlist->n_serialized);
+  for (; l != NULL; l = l->next) {
+    GstM3U8Entry *entry = l->data;
 
-    g_string_append_printf (playlist_str, "%s\n", entry->url);
+    if (entry->parts)
+      g_string_append (playlist_str, entry->parts);
+    g_string_append_len (playlist_str, entry->text, entry->text_len);
   }
 
+  g_string_append_len (playlist_str, playlist->parts->str,
+      playlist->parts->len);
+
   if (playlist->end_list)
     g_string_append (playlist_str, "#EXT-X-ENDLIST");
+  else if (playlist->preload_hint)
+    g_string_append_printf (playlist_str,
+        "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%s\"\n", playlist->preload_hint);
 
   return g_string_free (playlist_str, FALSE);
 }
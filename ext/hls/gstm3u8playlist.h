@@ -36,9 +36,18 @@ struct _GstM3U8Playlist
   gint type;
   gboolean end_list;
   guint sequence_number;
+  gfloat part_target;           /* 0 if there are no partial segments */
+  gchar *map_uri;               /* media initialization section, or NULL */
+  gboolean can_block_reload;    /* the server supports blocking reloads */
+  gchar *preload_hint;          /* URI of the next partial segment, or NULL */
+  guint n_parts;                /* parts of the segment being written */
 
   /*< Private >*/
   GQueue *entries;
+  GString *body;                /* text of the first n_serialized entries */
+  guint n_serialized;
+  GString *parts;               /* parts of the segment being written */
+  gfloat max_duration;
 };
 
 
@@ -55,6 +64,17 @@ gboolean          gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
                                                guint             index,
                                                gboolean          discontinuous);
 
+gboolean          gst_m3u8_playlist_add_part (GstM3U8Playlist * playlist,
+                                              const gchar     * url,
+                                              gfloat            duration,
+                                              gboolean          independent);
+
+void              gst_m3u8_playlist_set_map (GstM3U8Playlist * playlist,
+                                             const gchar     * uri);
+
+void              gst_m3u8_playlist_set_preload_hint (GstM3U8Playlist * playlist,
+                                                      const gchar     * uri);
+
 gchar *           gst_m3u8_playlist_render (GstM3U8Playlist * playlist);
 
 G_END_DECLS
@@ -39,12 +39,25 @@ static GstM3U8MediaFile *gst_m3u8_media_file_new (gchar * uri,
 static void gst_m3u8_media_file_free (GstM3U8MediaFile * self);
 gchar *uri_join (const gchar * uri, const gchar * path);
 
+static void
+gst_m3u8_parse_state_clear (GstM3U8ParseState * state)
+{
+  g_free (state->title);
+  g_free (state->current_key);
+  memset (state, 0, sizeof (GstM3U8ParseState));
+  state->size = state->offset = -1;
+}
+
 static GstM3U8 *
 gst_m3u8_new (void)
 {
   GstM3U8 *m3u8;
 
   m3u8 = g_new0 (GstM3U8, 1);
+  m3u8->files =
+      g_ptr_array_new_with_free_func ((GDestroyNotify)
+      gst_m3u8_media_file_free);
+  gst_m3u8_parse_state_clear (&m3u8->state);
 
   return m3u8;
 }
@@ -74,8 +87,8 @@ gst_m3u8_free (GstM3U8 * self)
   g_free (self->name);
   g_free (self->codecs);
 
-  g_list_foreach (self->files, (GFunc) gst_m3u8_media_file_free, NULL);
-  g_list_free (self->files);
+  g_ptr_array_unref (self->files);
+  gst_m3u8_parse_state_clear (&self->state);
 
   g_free (self->last_data);
   g_list_foreach (self->lists, (GFunc) gst_m3u8_free, NULL);
@@ -112,6 +125,82 @@ gst_m3u8_media_file_free (GstM3U8MediaFile * self)
   g_free (self);
 }
 
+/* Returns the index of the first file with a sequence number not below
+ * @sequence, or the number of files if there is none */
+static guint
+gst_m3u8_lower_bound (GstM3U8 * self, gint64 sequence)
+{
+  guint lo = 0, hi = self->files->len;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (GST_M3U8_FILE_AT (self, mid)->sequence < sequence)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+/* Returns the index of the file with the media sequence number @sequence,
+ * or -1 if the playlist doesn't contain it */
+gint
+gst_m3u8_find_file_by_sequence (GstM3U8 * self, gint64 sequence)
+{
+  gint64 idx;
+
+  g_return_val_if_fail (self != NULL, -1);
+
+  if (self->files->len == 0)
+    return -1;
+
+  /* sequence numbers are usually consecutive, try the direct guess first */
+  idx = sequence - GST_M3U8_FILE_AT (self, 0)->sequence;
+  if (idx < 0 || idx >= self->files->len)
+    return -1;
+  if (GST_M3U8_FILE_AT (self, idx)->sequence != sequence) {
+    idx = gst_m3u8_lower_bound (self, sequence);
+    if (idx == self->files->len
+        || GST_M3U8_FILE_AT (self, idx)->sequence != sequence)
+      return -1;
+  }
+
+  return idx;
+}
+
+/* Returns the index of the file that contains @position, counted from the
+ * start of the first file, or the number of files if @position is after
+ * the end of the playlist */
+gint
+gst_m3u8_find_file_by_position (GstM3U8 * self, GstClockTime position)
+{
+  guint lo = 0, hi = self->files->len;
+  GstM3U8MediaFile *last;
+
+  g_return_val_if_fail (self != NULL, -1);
+
+  if (hi == 0)
+    return 0;
+
+  last = GST_M3U8_FILE_AT (self, hi - 1);
+  if (position >= last->start + last->duration)
+    return hi;
+
+  /* look for the last file starting before or at @position */
+  while (hi - lo > 1) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (GST_M3U8_FILE_AT (self, mid)->start <= position)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
 static gboolean
 int_from_string (gchar * ptr, gchar ** endptr, gint * val)
 {
@@ -271,66 +360,17 @@ gst_m3u8_compare_playlist_by_bitrate (gconstpointer a, gconstpointer b)
   return ((GstM3U8 *) (a))->bandwidth - ((GstM3U8 *) (b))->bandwidth;
 }
 
-/*
- * @data: a m3u8 playlist text data, taking ownership
- */
-static gboolean
-gst_m3u8_update (GstM3U8Client * client, GstM3U8 * self, gchar * data,
-    gboolean * updated)
+/* Parses the lines of @data, a writable copy of the playlist text from
+ * @data_offset on, appending the media files to @files */
+static void
+gst_m3u8_parse_lines (GstM3U8 * self, GstM3U8ParseState * state,
+    GPtrArray * files, gchar * data, gsize data_offset)
 {
   gint val;
-  GstClockTime duration;
-  gchar *title, *end;
-  gboolean discontinuity = FALSE;
-  GstM3U8 *list;
-  gchar *current_key = NULL;
-  gboolean have_iv = FALSE;
-  guint8 iv[16] = { 0, };
-  gint64 size = -1, offset = -1;
-  gint64 mediasequence;
+  gchar *base = data, *end;
+  gsize len = strlen (data);
+  GstM3U8 *list = NULL;
 
-  g_return_val_if_fail (self != NULL, FALSE);
-  g_return_val_if_fail (data != NULL, FALSE);
-  g_return_val_if_fail (updated != NULL, FALSE);
-
-  *updated = TRUE;
-
-  /* check if the data changed since last update */
-  if (self->last_data && g_str_equal (self->last_data, data)) {
-    GST_DEBUG ("Playlist is the same as previous one");
-    *updated = FALSE;
-    g_free (data);
-    return TRUE;
-  }
-
-  if (!g_str_has_prefix (data, "#EXTM3U")) {
-    GST_WARNING ("Data doesn't start with #EXTM3U");
-    *updated = FALSE;
-    g_free (data);
-    return FALSE;
-  }
-
-  GST_TRACE ("data:\n%s", data);
-
-  g_free (self->last_data);
-  self->last_data = data;
-
-  client->current_file = NULL;
-  if (self->files) {
-    g_list_foreach (self->files, (GFunc) gst_m3u8_media_file_free, NULL);
-    g_list_free (self->files);
-    self->files = NULL;
-  }
-  client->duration = GST_CLOCK_TIME_NONE;
-  mediasequence = 0;
-
-  /* By default, allow caching */
-  self->allowcache = TRUE;
-
-  list = NULL;
-  duration = 0;
-  title = NULL;
-  data += 7;
   while (TRUE) {
     gchar *r;
 
@@ -344,7 +384,7 @@ gst_m3u8_update (GstM3U8Client * client, GstM3U8 * self, gchar * data,
 
     if (data[0] != '#' && data[0] != '\0') {
       gchar *name = data;
-      if (duration <= 0 && list == NULL) {
+      if (state->duration <= 0 && list == NULL) {
         GST_LOG ("%s: got line without EXTINF or EXTSTREAMINF, dropping", data);
         goto next_line;
       }
@@ -365,46 +405,48 @@ gst_m3u8_update (GstM3U8Client * client, GstM3U8 * self, gchar * data,
         }
         list = NULL;
       } else {
-        GstM3U8MediaFile *file;
-        file = gst_m3u8_media_file_new (data, title, duration, mediasequence++);
+        GstM3U8MediaFile *file, *prev;
+
+        prev = files->len ? g_ptr_array_index (files, files->len - 1) : NULL;
+        file = gst_m3u8_media_file_new (data, state->title, state->duration,
+            state->mediasequence++);
+        file->start = prev ? prev->start + prev->duration : 0;
 
         /* set encryption params */
-        file->key = current_key ? g_strdup (current_key) : NULL;
+        file->key = state->current_key ? g_strdup (state->current_key) : NULL;
         if (file->key) {
-          if (have_iv) {
-            memcpy (file->iv, iv, sizeof (iv));
+          if (state->have_iv) {
+            memcpy (file->iv, state->iv, sizeof (state->iv));
           } else {
-            guint8 *iv = file->iv + 12;
-            GST_WRITE_UINT32_BE (iv, file->sequence);
+            GST_WRITE_UINT32_BE (file->iv + 12, file->sequence);
           }
         }
 
-        if (size != -1) {
-          file->size = size;
-          if (offset != -1) {
-            file->offset = offset;
+        if (state->size != -1) {
+          file->size = state->size;
+          if (state->offset != -1) {
+            file->offset = state->offset;
           } else {
-            GstM3U8MediaFile *prev = self->files ? self->files->data : NULL;
-
             if (!prev) {
-              offset = 0;
+              state->offset = 0;
             } else {
-              offset = prev->offset + prev->size;
+              state->offset = prev->offset + prev->size;
             }
-            file->offset = offset;
+            file->offset = state->offset;
           }
         } else {
           file->size = -1;
           file->offset = 0;
         }
 
-        file->discont = discontinuity;
+        file->discont = state->discontinuity;
 
-        duration = 0;
-        title = NULL;
-        discontinuity = FALSE;
-        size = offset = -1;
-        self->files = g_list_prepend (self->files, file);
+        state->duration = 0;
+        state->title = NULL;
+        state->discontinuity = FALSE;
+        state->size = state->offset = -1;
+        file->data_end = data_offset + (end ? end + 1 - base : len);
+        g_ptr_array_add (files, file);
       }
 
     } else if (g_str_has_prefix (data, "#EXTINF:")) {
@@ -413,18 +455,19 @@ gst_m3u8_update (GstM3U8Client * client, GstM3U8 * self, gchar * data,
         GST_WARNING ("Can't read EXTINF duration");
         goto next_line;
       }
-      duration = fval * (gdouble) GST_SECOND;
-      if (self->targetduration > 0 && duration > self->targetduration) {
+      state->duration = fval * (gdouble) GST_SECOND;
+      if (self->targetduration > 0 && state->duration > self->targetduration) {
         GST_WARNING ("EXTINF duration (%" GST_TIME_FORMAT
             ") > TARGETDURATION (%" GST_TIME_FORMAT ")",
-            GST_TIME_ARGS (duration), GST_TIME_ARGS (self->targetduration));
+            GST_TIME_ARGS (state->duration),
+            GST_TIME_ARGS (self->targetduration));
       }
       if (!data || *data != ',')
         goto next_line;
       data = g_utf8_next_char (data);
       if (data != end) {
-        g_free (title);
-        title = g_strdup (data);
+        g_free (state->title);
+        state->title = g_strdup (data);
       }
     } else if (g_str_has_prefix (data, "#EXT-X-")) {
       gchar *data_ext_x = data + 7;
@@ -496,9 +539,9 @@ gst_m3u8_update (GstM3U8Client * client, GstM3U8 * self, gchar * data,
           self->targetduration = val * GST_SECOND;
       } else if (g_str_has_prefix (data_ext_x, "MEDIA-SEQUENCE:")) {
         if (int_from_string (data + 22, &data, &val))
-          mediasequence = val;
+          state->mediasequence = val;
       } else if (g_str_has_prefix (data_ext_x, "DISCONTINUITY")) {
-        discontinuity = TRUE;
+        state->discontinuity = TRUE;
       } else if (g_str_has_prefix (data_ext_x, "PROGRAM-DATE-TIME:")) {
         /* <YYYY-MM-DDThh:mm:ssZ> */
         GST_DEBUG ("FIXME parse date");
@@ -510,12 +553,12 @@ gst_m3u8_update (GstM3U8Client * client, GstM3U8 * self, gchar * data,
         data = data + 11;
 
         /* IV and KEY are only valid until the next #EXT-X-KEY */
-        have_iv = FALSE;
-        g_free (current_key);
-        current_key = NULL;
+        state->have_iv = FALSE;
+        g_free (state->current_key);
+        state->current_key = NULL;
         while (data && parse_attributes (&data, &a, &v)) {
           if (g_str_equal (a, "URI")) {
-            current_key =
+            state->current_key =
                 uri_join (self->base_uri ? self->base_uri : self->uri, v);
           } else if (g_str_equal (a, "IV")) {
             gchar *ivp = v;
@@ -539,14 +582,14 @@ gst_m3u8_update (GstM3U8Client * client, GstM3U8 * self, gchar * data,
                 i = -1;
                 break;
               }
-              iv[i] = (h << 4) | l;
+              state->iv[i] = (h << 4) | l;
             }
 
             if (i == -1) {
               GST_WARNING ("Can't read IV");
               continue;
             }
-            have_iv = TRUE;
+            state->have_iv = TRUE;
           } else if (g_str_equal (a, "METHOD")) {
             if (!g_str_equal (v, "AES-128")) {
               GST_WARNING ("Encryption method %s not supported", v);
@@ -557,8 +600,8 @@ gst_m3u8_update (GstM3U8Client * client, GstM3U8 * self, gchar * data,
       } else if (g_str_has_prefix (data_ext_x, "BYTERANGE:")) {
         gchar *v = data + 17;
 
-        if (int64_from_string (v, &v, &size)) {
-          if (*v == '@' && !int64_from_string (v + 1, &v, &offset))
+        if (int64_from_string (v, &v, &state->size)) {
+          if (*v == '@' && !int64_from_string (v + 1, &v, &state->offset))
             goto next_line;
         } else {
           goto next_line;
@@ -576,10 +619,168 @@ gst_m3u8_update (GstM3U8Client * client, GstM3U8 * self, gchar * data,
     data = g_utf8_next_char (end);      /* skip \n */
   }
 
-  g_free (current_key);
-  current_key = NULL;
+  if (list != NULL) {
+    GST_WARNING ("Found a list without a uri..., dropping");
+    gst_m3u8_free (list);
+  }
+}
 
-  self->files = g_list_reverse (self->files);
+/* Updates the media files of @self without parsing all of @data again if
+ * it is the previous playlist with expired fragments removed from the start
+ * and new ones appended. Returns FALSE if @data has to be parsed fully */
+static gboolean
+gst_m3u8_update_incremental (GstM3U8 * self, const gchar * data)
+{
+  GstM3U8 *head;
+  GstM3U8ParseState state = { 0, };
+  GstM3U8MediaFile *file, *old;
+  GstClockTime start;
+  const gchar *p, *rest;
+  gsize len, old_len, old_end, head_len, tail_len;
+  gboolean ret = FALSE;
+  gchar *text;
+  gint64 k;
+  guint i;
+
+  if (!self->last_data || !self->files->len || self->lists
+      || self->iframe_lists || self->endlist)
+    return FALSE;
+
+  /* the head is made of the tags and the first fragment, until the end of
+   * the first uri line */
+  p = strchr (data, '\n');
+  while (p) {
+    const gchar *line = p + 1;
+
+    p = strchr (line, '\n');
+    if (line[0] != '#' && line[0] != '\n' && line[0] != '\r'
+        && line[0] != '\0')
+      break;
+  }
+  len = strlen (data);
+  head_len = p ? p + 1 - data : len;
+
+  head = gst_m3u8_new ();
+  gst_m3u8_set_uri (head, g_strdup (self->uri), g_strdup (self->base_uri),
+      NULL);
+  head->allowcache = TRUE;
+  gst_m3u8_parse_state_clear (&state);
+  text = g_strndup (data + 7, head_len - 7);
+  gst_m3u8_parse_lines (head, &state, head->files, text, 7);
+  g_free (text);
+
+  /* an explicit IV would apply to the following fragments too, and it's
+   * not known if the previous parse had one */
+  if (head->files->len != 1 || head->lists || head->iframe_lists
+      || (state.current_key && state.have_iv))
+    goto out;
+
+  /* the first fragment must be one we already have */
+  file = GST_M3U8_FILE_AT (head, 0);
+  k = file->sequence - GST_M3U8_FILE_AT (self, 0)->sequence;
+  if (k < 0 || k >= self->files->len)
+    goto out;
+  old = GST_M3U8_FILE_AT (self, k);
+  if (old->sequence != file->sequence || old->duration != file->duration
+      || g_strcmp0 (old->uri, file->uri) || g_strcmp0 (old->key, file->key)
+      || memcmp (old->iv, file->iv, sizeof (old->iv))
+      || old->offset != file->offset || old->size != file->size
+      || old->discont != file->discont)
+    goto out;
+
+  /* followed by the rest of the previous playlist, unchanged */
+  old_len = strlen (self->last_data);
+  old_end = old->data_end;
+  tail_len = old_len - old_end;
+  if (head_len + tail_len > len
+      || memcmp (data + head_len, self->last_data + old_end, tail_len))
+    goto out;
+  rest = data + head_len + tail_len;
+  if (rest[-1] != '\n' && *rest != '\0' && *rest != '\n' && *rest != '\r')
+    goto out;
+
+  GST_DEBUG ("Dropping %" G_GINT64_FORMAT " expired fragments, parsing %"
+      G_GSIZE_FORMAT " new bytes", k, len - (rest - data));
+
+  if (head->targetduration)
+    self->targetduration = head->targetduration;
+  if (head->version)
+    self->version = head->version;
+  self->allowcache = head->allowcache;
+
+  g_ptr_array_remove_range (self->files, 0, k);
+  start = old->start;
+  for (i = 0; i < self->files->len; i++) {
+    file = GST_M3U8_FILE_AT (self, i);
+    file->start -= start;
+    file->data_end = file->data_end - old_end + head_len;
+  }
+
+  if (*rest) {
+    text = g_strdup (rest);
+    gst_m3u8_parse_lines (self, &self->state, self->files, text, rest - data);
+    g_free (text);
+  }
+  ret = TRUE;
+
+out:
+  gst_m3u8_parse_state_clear (&state);
+  gst_m3u8_free (head);
+  return ret;
+}
+
+/*
+ * @data: a m3u8 playlist text data, taking ownership
+ */
+static gboolean
+gst_m3u8_update (GstM3U8Client * client, GstM3U8 * self, gchar * data,
+    gboolean * updated)
+{
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (data != NULL, FALSE);
+  g_return_val_if_fail (updated != NULL, FALSE);
+
+  *updated = TRUE;
+
+  /* check if the data changed since last update */
+  if (self->last_data && g_str_equal (self->last_data, data)) {
+    GST_DEBUG ("Playlist is the same as previous one");
+    *updated = FALSE;
+    g_free (data);
+    return TRUE;
+  }
+
+  if (!g_str_has_prefix (data, "#EXTM3U")) {
+    GST_WARNING ("Data doesn't start with #EXTM3U");
+    *updated = FALSE;
+    g_free (data);
+    return FALSE;
+  }
+
+  GST_TRACE ("data:\n%s", data);
+
+  client->current_file = -1;
+  client->duration = GST_CLOCK_TIME_NONE;
+
+  /* live playlists mostly get fragments appended, only parse those. The
+   * text is parsed from a copy so that it can be compared on the next
+   * update */
+  if (!gst_m3u8_update_incremental (self, data)) {
+    gchar *text;
+
+    g_ptr_array_set_size (self->files, 0);
+    gst_m3u8_parse_state_clear (&self->state);
+
+    /* By default, allow caching */
+    self->allowcache = TRUE;
+
+    text = g_strdup (data + 7);
+    gst_m3u8_parse_lines (self, &self->state, self->files, text, 7);
+    g_free (text);
+  }
+
+  g_free (self->last_data);
+  self->last_data = data;
 
   /* reorder playlists by bitrate */
   if (self->lists) {
@@ -610,28 +811,31 @@ gst_m3u8_update (GstM3U8Client * client, GstM3U8 * self, gchar * data,
           (GCompareFunc) _m3u8_compare_uri);
   }
   /* calculate the start and end times of this media playlist. */
-  if (self->files) {
-    GList *walk;
+  if (self->files->len) {
     GstM3U8MediaFile *file;
-    GstClockTime duration = 0;
-
-    for (walk = self->files; walk; walk = walk->next) {
-      file = walk->data;
-      duration += file->duration;
-      if (file->sequence > client->highest_sequence_number) {
-        if (client->highest_sequence_number >= 0) {
-          /* if an update of the media playlist has been missed, there
-             will be a gap between self->highest_sequence_number and the
-             first sequence number in this media playlist. In this situation
-             assume that the missing fragments had a duration of
-             targetduration each */
-          client->last_file_end +=
-              (file->sequence - client->highest_sequence_number -
-              1) * self->targetduration;
-        }
-        client->last_file_end += file->duration;
-        client->highest_sequence_number = file->sequence;
+    GstClockTime duration;
+    guint i;
+
+    file = GST_M3U8_FILE_AT (self, self->files->len - 1);
+    duration = file->start + file->duration;
+
+    /* only the files after the highest sequence seen so far extend the
+     * range */
+    for (i = gst_m3u8_lower_bound (self, client->highest_sequence_number + 1);
+        i < self->files->len; i++) {
+      file = GST_M3U8_FILE_AT (self, i);
+      if (client->highest_sequence_number >= 0) {
+        /* if an update of the media playlist has been missed, there
+           will be a gap between self->highest_sequence_number and the
+           first sequence number in this media playlist. In this situation
+           assume that the missing fragments had a duration of
+           targetduration each */
+        client->last_file_end +=
+            (file->sequence - client->highest_sequence_number -
+            1) * self->targetduration;
       }
+      client->last_file_end += file->duration;
+      client->highest_sequence_number = file->sequence;
     }
     if (GST_M3U8_CLIENT_IS_LIVE (client)) {
       client->first_file_start = client->last_file_end - duration;
@@ -655,7 +859,7 @@ gst_m3u8_client_new (const gchar * uri, const gchar * base_uri)
   client = g_new0 (GstM3U8Client, 1);
   client->main = gst_m3u8_new ();
   client->current = NULL;
-  client->current_file = NULL;
+  client->current_file = -1;
   client->current_file_duration = GST_CLOCK_TIME_NONE;
   client->sequence = -1;
   client->sequence_position = 0;
@@ -686,7 +890,7 @@ gst_m3u8_client_set_current (GstM3U8Client * self, GstM3U8 * m3u8)
   if (m3u8 != self->current) {
     self->current = m3u8;
     self->duration = GST_CLOCK_TIME_NONE;
-    self->current_file = NULL;
+    self->current_file = -1;
   }
   GST_M3U8_CLIENT_UNLOCK (self);
 }
@@ -706,10 +910,13 @@ gst_m3u8_client_update (GstM3U8Client * self, gchar * data)
   if (!gst_m3u8_update (self, m3u8, data, &updated))
     goto out;
 
-  if (!updated)
+  if (!updated) {
+    /* nothing changed since the last update */
+    ret = TRUE;
     goto out;
+  }
 
-  if (self->current && !self->current->files) {
+  if (self->current && !self->current->files->len) {
     GST_ERROR ("Invalid media playlist, it does not contain any media files");
     goto out;
   }
@@ -723,17 +930,16 @@ gst_m3u8_client_update (GstM3U8Client * self, gchar * data)
     }
   }
 
-  if (m3u8->files && self->sequence == -1) {
+  if (m3u8->files->len && self->sequence == -1) {
     if (GST_M3U8_CLIENT_IS_LIVE (self)) {
       /* for live streams, start GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE from
          the end of the playlist. See section 6.3.3 of HLS draft */
-      gint pos =
-          g_list_length (m3u8->files) - GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
-      self->current_file = g_list_nth (m3u8->files, pos >= 0 ? pos : 0);
+      gint pos = m3u8->files->len - GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
+      self->current_file = pos >= 0 ? pos : 0;
     } else {
-      self->current_file = g_list_first (m3u8->files);
+      self->current_file = 0;
     }
-    self->sequence = GST_M3U8_MEDIA_FILE (self->current_file->data)->sequence;
+    self->sequence = GST_M3U8_FILE_AT (m3u8, self->current_file)->sequence;
     self->sequence_position = 0;
     GST_DEBUG ("Setting first sequence at %u", (guint) self->sequence);
   }
@@ -833,46 +1039,29 @@ gst_m3u8_client_update_variant_playlist (GstM3U8Client * self, gchar * data,
   return ret;
 }
 
-static GList *
-find_next_fragment (GstM3U8Client * client, GList * l, gboolean forward)
+/* Returns the index of the first file at or after the client sequence in
+ * playback direction, or -1 */
+static gint
+find_next_fragment (GstM3U8Client * client, GstM3U8 * m3u8, gboolean forward)
 {
-  GstM3U8MediaFile *file;
+  guint idx;
 
   if (forward) {
-    while (l) {
-      file = l->data;
-
-      if (file->sequence >= client->sequence)
-        break;
-
-      l = l->next;
-    }
-  } else {
-    l = g_list_last (l);
-
-    while (l) {
-      file = l->data;
-
-      if (file->sequence <= client->sequence)
-        break;
-
-      l = l->prev;
-    }
+    idx = gst_m3u8_lower_bound (m3u8, client->sequence);
+    return idx < m3u8->files->len ? idx : -1;
   }
 
-  return l;
+  idx = gst_m3u8_lower_bound (m3u8, client->sequence + 1);
+  return (gint) idx - 1;
 }
 
 static gboolean
-has_next_fragment (GstM3U8Client * client, GList * l, gboolean forward)
+has_next_fragment (GstM3U8Client * client, gint idx, gboolean forward)
 {
-  l = find_next_fragment (client, l, forward);
-
-  if (l) {
-    return (forward && l->next) || (!forward && l->prev);
-  }
+  if (idx < 0)
+    return FALSE;
 
-  return FALSE;
+  return forward ? idx + 1 < client->current->files->len : idx > 0;
 }
 
 gboolean
@@ -892,17 +1081,17 @@ gst_m3u8_client_get_next_fragment (GstM3U8Client * client,
     GST_M3U8_CLIENT_UNLOCK (client);
     return FALSE;
   }
-  if (!client->current_file) {
+  if (client->current_file < 0) {
     client->current_file =
-        find_next_fragment (client, client->current->files, forward);
+        find_next_fragment (client, client->current, forward);
   }
 
-  if (!client->current_file) {
+  if (client->current_file < 0) {
     GST_M3U8_CLIENT_UNLOCK (client);
     return FALSE;
   }
 
-  file = GST_M3U8_MEDIA_FILE (client->current_file->data);
+  file = GST_M3U8_FILE_AT (client->current, client->current_file);
   GST_DEBUG ("Got fragment with sequence %u (client sequence %u)",
       (guint) file->sequence, (guint) client->sequence);
 
@@ -944,23 +1133,62 @@ gst_m3u8_client_has_next_fragment (GstM3U8Client * client, gboolean forward)
   GST_M3U8_CLIENT_LOCK (client);
   GST_DEBUG ("Checking if has next fragment %" G_GINT64_FORMAT,
       client->sequence + (forward ? 1 : -1));
-  if (client->current_file) {
-    ret =
-        (forward ? client->current_file->next : client->current_file->prev) !=
-        NULL;
+  if (client->current_file >= 0) {
+    ret = has_next_fragment (client, client->current_file, forward);
   } else {
-    ret = has_next_fragment (client, client->current->files, forward);
+    ret = has_next_fragment (client,
+        find_next_fragment (client, client->current, forward), forward);
   }
   GST_M3U8_CLIENT_UNLOCK (client);
   return ret;
 }
 
+/* Gets the @n-th fragment after the current one without advancing */
+gboolean
+gst_m3u8_client_peek_fragment (GstM3U8Client * client, guint n,
+    gchar ** uri, gint64 * range_start, gint64 * range_end, gchar ** key,
+    gboolean forward)
+{
+  GstM3U8MediaFile *file;
+  gint64 idx;
+
+  g_return_val_if_fail (client != NULL, FALSE);
+  g_return_val_if_fail (client->current != NULL, FALSE);
+
+  GST_M3U8_CLIENT_LOCK (client);
+  if (client->sequence < 0) {
+    GST_M3U8_CLIENT_UNLOCK (client);
+    return FALSE;
+  }
+
+  idx = client->current_file;
+  if (idx < 0)
+    idx = find_next_fragment (client, client->current, forward);
+
+  if (idx >= 0)
+    idx = forward ? idx + n : idx - (gint64) n;
+
+  if (idx < 0 || idx >= client->current->files->len) {
+    GST_M3U8_CLIENT_UNLOCK (client);
+    return FALSE;
+  }
+
+  file = GST_M3U8_FILE_AT (client->current, idx);
+  *uri = g_strdup (file->uri);
+  *range_start = file->offset;
+  *range_end = file->size != -1 ? file->offset + file->size - 1 : -1;
+  if (key)
+    *key = g_strdup (file->key);
+
+  GST_M3U8_CLIENT_UNLOCK (client);
+  return TRUE;
+}
+
 static void
 alternate_advance (GstM3U8Client * client, gboolean forward)
 {
   gint targetnum = client->sequence;
-  GList *tmp;
-  GstM3U8MediaFile *mf;
+  gint idx;
 
   /* figure out the target seqnum */
   if (forward)
@@ -968,19 +1196,15 @@ alternate_advance (GstM3U8Client * client, gboolean forward)
   else
     targetnum -= 1;
 
-  for (tmp = client->current->files; tmp; tmp = tmp->next) {
-    mf = (GstM3U8MediaFile *) tmp->data;
-    if (mf->sequence == targetnum)
-      break;
-  }
-  if (tmp == NULL) {
+  idx = gst_m3u8_find_file_by_sequence (client->current, targetnum);
+  if (idx < 0) {
     GST_WARNING ("Can't find next fragment");
     return;
   }
-  client->current_file = tmp;
+  client->current_file = idx;
   client->sequence = targetnum;
   client->current_file_duration =
-      GST_M3U8_MEDIA_FILE (client->current_file->data)->duration;
+      GST_M3U8_FILE_AT (client->current, idx)->duration;
 }
 
 void
@@ -1006,32 +1230,25 @@ gst_m3u8_client_advance_fragment (GstM3U8Client * client, gboolean forward)
     GST_DEBUG ("Sequence position now %" GST_TIME_FORMAT,
         GST_TIME_ARGS (client->sequence_position));
   }
-  if (!client->current_file) {
-    GList *l;
-
+  if (client->current_file < 0) {
     GST_DEBUG ("Looking for fragment %" G_GINT64_FORMAT, client->sequence);
-    for (l = client->current->files; l != NULL; l = l->next) {
-      if (GST_M3U8_MEDIA_FILE (l->data)->sequence == client->sequence) {
-        client->current_file = l;
-        break;
-      }
-    }
-    if (client->current_file == NULL) {
+    client->current_file =
+        gst_m3u8_find_file_by_sequence (client->current, client->sequence);
+    if (client->current_file < 0) {
       GST_DEBUG
           ("Could not find current fragment, trying next fragment directly");
       alternate_advance (client, forward);
 
       /* Resync sequence number if the above has failed for live streams */
-      if (client->current_file == NULL && GST_M3U8_CLIENT_IS_LIVE (client)) {
+      if (client->current_file < 0 && GST_M3U8_CLIENT_IS_LIVE (client)) {
         /* for live streams, start GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE from
            the end of the playlist. See section 6.3.3 of HLS draft */
         gint pos =
-            g_list_length (client->current->files) -
-            GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
-        client->current_file =
-            g_list_nth (client->current->files, pos >= 0 ? pos : 0);
+            client->current->files->len - GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
+        client->current_file = pos >= 0 ? pos : 0;
         client->current_file_duration =
-            GST_M3U8_MEDIA_FILE (client->current_file->data)->duration;
+            GST_M3U8_FILE_AT (client->current,
+            client->current_file)->duration;
 
         GST_WARNING ("Resyncing live playlist");
       }
@@ -1040,40 +1257,35 @@ gst_m3u8_client_advance_fragment (GstM3U8Client * client, gboolean forward)
     }
   }
 
-  file = GST_M3U8_MEDIA_FILE (client->current_file->data);
+  file = GST_M3U8_FILE_AT (client->current, client->current_file);
   GST_DEBUG ("Advancing from sequence %u", (guint) file->sequence);
   if (forward) {
-    client->current_file = client->current_file->next;
-    if (client->current_file) {
+    client->current_file++;
+    if (client->current_file < client->current->files->len) {
       client->sequence =
-          GST_M3U8_MEDIA_FILE (client->current_file->data)->sequence;
+          GST_M3U8_FILE_AT (client->current, client->current_file)->sequence;
     } else {
+      client->current_file = -1;
       client->sequence = file->sequence + 1;
     }
   } else {
-    client->current_file = client->current_file->prev;
-    if (client->current_file) {
+    client->current_file--;
+    if (client->current_file >= 0) {
       client->sequence =
-          GST_M3U8_MEDIA_FILE (client->current_file->data)->sequence;
+          GST_M3U8_FILE_AT (client->current, client->current_file)->sequence;
     } else {
       client->sequence = file->sequence - 1;
     }
   }
-  if (client->current_file) {
+  if (client->current_file >= 0) {
     /* Store duration of the fragment we're using to update the position 
      * the next time we advance */
     client->current_file_duration =
-        GST_M3U8_MEDIA_FILE (client->current_file->data)->duration;
+        GST_M3U8_FILE_AT (client->current, client->current_file)->duration;
   }
   GST_M3U8_CLIENT_UNLOCK (client);
 }
 
-static void
-_sum_duration (GstM3U8MediaFile * self, GstClockTime * duration)
-{
-  *duration += self->duration;
-}
-
 GstClockTime
 gst_m3u8_client_get_duration (GstM3U8Client * client)
 {
@@ -1088,10 +1300,13 @@ gst_m3u8_client_get_duration (GstM3U8Client * client)
     return GST_CLOCK_TIME_NONE;
   }
 
-  if (!GST_CLOCK_TIME_IS_VALID (client->duration) && client->current->files) {
-    client->duration = 0;
-    g_list_foreach (client->current->files, (GFunc) _sum_duration,
-        &client->duration);
+  if (!GST_CLOCK_TIME_IS_VALID (client->duration)
+      && client->current->files->len) {
+    GstM3U8MediaFile *last;
+
+    last = GST_M3U8_FILE_AT (client->current,
+        client->current->files->len - 1);
+    client->duration = last->start + last->duration;
   }
   duration = client->duration;
   GST_M3U8_CLIENT_UNLOCK (client);
@@ -1252,16 +1467,15 @@ gst_m3u8_client_get_seek_range (GstM3U8Client * client, gint64 * start,
     gint64 * stop)
 {
   GstClockTime duration = 0;
-  GList *walk;
   GstM3U8MediaFile *file;
-  guint count;
+  gint last;
   guint min_distance = 0;
 
   g_return_val_if_fail (client != NULL, FALSE);
 
   GST_M3U8_CLIENT_LOCK (client);
 
-  if (client->current == NULL || client->current->files == NULL) {
+  if (client->current == NULL || client->current->files->len == 0) {
     GST_M3U8_CLIENT_UNLOCK (client);
     return FALSE;
   }
@@ -1272,13 +1486,11 @@ gst_m3u8_client_get_seek_range (GstM3U8Client * client, gint64 * start,
        playlist - see 6.3.3. "Playing the Playlist file" of the HLS draft */
     min_distance = GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
   }
-  count = g_list_length (client->current->files);
-
-  for (walk = client->current->files;
-      walk && count >= min_distance; walk = walk->next) {
-    file = walk->data;
-    --count;
-    duration += file->duration;
+  last = MIN ((gint) client->current->files->len - (gint) min_distance,
+      (gint) client->current->files->len - 1);
+  if (last >= 0) {
+    file = GST_M3U8_FILE_AT (client->current, last);
+    duration = file->start + file->duration;
   }
 
   if (duration <= 0) {
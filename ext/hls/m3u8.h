@@ -34,6 +34,9 @@ typedef struct _GstM3U8Client GstM3U8Client;
 #define GST_M3U8(m) ((GstM3U8*)m)
 #define GST_M3U8_MEDIA_FILE(f) ((GstM3U8MediaFile*)f)
 
+/* The @i-th media file of the playlist @m */
+#define GST_M3U8_FILE_AT(m,i) GST_M3U8_MEDIA_FILE (g_ptr_array_index ((m)->files, (i)))
+
 #define GST_M3U8_CLIENT_LOCK(c) g_mutex_lock (&c->lock);
 #define GST_M3U8_CLIENT_UNLOCK(c) g_mutex_unlock (&c->lock);
 
@@ -45,6 +48,20 @@ typedef struct _GstM3U8Client GstM3U8Client;
    value is three fragments */
 #define GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE 3
 
+/* The state of the playlist parser between two lines, kept to resume
+ * parsing when fragments are appended to a live playlist */
+typedef struct _GstM3U8ParseState
+{
+  GstClockTime duration;
+  gchar *title;
+  gint64 mediasequence;
+  gboolean discontinuity;
+  gchar *current_key;
+  gboolean have_iv;
+  guint8 iv[16];
+  gint64 size, offset;
+} GstM3U8ParseState;
+
 struct _GstM3U8
 {
   gchar *uri;                   /* actually downloaded URI */
@@ -64,10 +81,11 @@ struct _GstM3U8
   gint width;
   gint height;
   gboolean iframe;
-  GList *files;
+  GPtrArray *files;             /* GstM3U8MediaFile, sorted by sequence */
 
   /*< private > */
   gchar *last_data;
+  GstM3U8ParseState state;      /* parser state at the end of last_data */
   GList *lists;                 /* list of GstM3U8 from the main playlist */
   GList *iframe_lists;          /* I-frame lists from the main playlist */
   GList *current_variant;       /* Current variant playlist used */
@@ -77,19 +95,21 @@ struct _GstM3U8MediaFile
 {
   gchar *title;
   GstClockTime duration;
+  GstClockTime start;           /* sum of the durations of the previous files */
   gchar *uri;
   gint64 sequence;               /* the sequence nb of this file */
   gboolean discont;             /* this file marks a discontinuity */
   gchar *key;
   guint8 iv[16];
   gint64 offset, size;
+  gsize data_end;               /* offset after the uri line in last_data */
 };
 
 struct _GstM3U8Client
 {
   GstM3U8 *main;                /* main playlist */
   GstM3U8 *current;
-  GList *current_file;
+  gint current_file;            /* index in current->files, -1 if unknown */
   GstClockTime current_file_duration; /* Duration of current fragment */
   gint64 sequence;              /* the next sequence for this client */
   GstClockTime sequence_position; /* position of this sequence */
@@ -101,6 +121,10 @@ struct _GstM3U8Client
 };
 
 
+gint            gst_m3u8_find_file_by_sequence (GstM3U8 * m3u8, gint64 sequence);
+
+gint            gst_m3u8_find_file_by_position (GstM3U8 * m3u8, GstClockTime position);
+
 GstM3U8Client * gst_m3u8_client_new (const gchar * uri, const gchar * base_uri);
 
 void            gst_m3u8_client_free (GstM3U8Client * client);
@@ -129,6 +153,14 @@ gboolean        gst_m3u8_client_get_next_fragment   (GstM3U8Client * client,
 gboolean        gst_m3u8_client_has_next_fragment   (GstM3U8Client * client,
                                                      gboolean        forward);
 
+gboolean        gst_m3u8_client_peek_fragment       (GstM3U8Client * client,
+                                                     guint           n,
+                                                     gchar        ** uri,
+                                                     gint64        * range_start,
+                                                     gint64        * range_end,
+                                                     gchar        ** key,
+                                                     gboolean        forward);
+
 void            gst_m3u8_client_advance_fragment    (GstM3U8Client * client,
                                                      gboolean        forward);
 
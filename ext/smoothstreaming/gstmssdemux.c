@@ -130,8 +130,13 @@ static GstFlowReturn
 gst_mss_demux_stream_advance_fragment (GstAdaptiveDemuxStream * stream);
 static gboolean gst_mss_demux_stream_select_bitrate (GstAdaptiveDemuxStream *
     stream, guint64 bitrate);
+static GArray *gst_mss_demux_stream_get_bitrates (GstAdaptiveDemuxStream *
+    stream);
 static GstFlowReturn
 gst_mss_demux_stream_update_fragment_info (GstAdaptiveDemuxStream * stream);
+static GstFlowReturn
+gst_mss_demux_stream_peek_fragment_info (GstAdaptiveDemuxStream * stream,
+    guint n, GstAdaptiveDemuxStreamFragment * fragment);
 static gboolean gst_mss_demux_seek (GstAdaptiveDemux * demux, GstEvent * seek);
 static gint64
 gst_mss_demux_get_manifest_update_interval (GstAdaptiveDemux * demux);
@@ -188,8 +193,12 @@ gst_mss_demux_class_init (GstMssDemuxClass * klass)
       gst_mss_demux_stream_has_next_fragment;
   gstadaptivedemux_class->stream_select_bitrate =
       gst_mss_demux_stream_select_bitrate;
+  gstadaptivedemux_class->stream_get_bitrates =
+      gst_mss_demux_stream_get_bitrates;
   gstadaptivedemux_class->stream_update_fragment_info =
       gst_mss_demux_stream_update_fragment_info;
+  gstadaptivedemux_class->stream_peek_fragment_info =
+      gst_mss_demux_stream_peek_fragment_info;
   gstadaptivedemux_class->update_manifest_data =
       gst_mss_demux_update_manifest_data;
 
@@ -304,6 +313,26 @@ gst_mss_demux_stream_update_fragment_info (GstAdaptiveDemuxStream * stream)
   return ret;
 }
 
+static GstFlowReturn
+gst_mss_demux_stream_peek_fragment_info (GstAdaptiveDemuxStream * stream,
+    guint n, GstAdaptiveDemuxStreamFragment * fragment)
+{
+  GstMssDemuxStream *mssstream = (GstMssDemuxStream *) stream;
+  GstMssDemux *mssdemux = GST_MSS_DEMUX_CAST (stream->demux);
+  GstFlowReturn ret;
+  gchar *path = NULL;
+
+  ret = gst_mss_stream_peek_fragment_url (mssstream->manifest_stream, n, &path);
+  if (ret == GST_FLOW_OK) {
+    fragment->uri = g_strdup_printf ("%s/%s", mssdemux->base_url, path);
+    fragment->range_start = 0;
+    fragment->range_end = -1;
+  }
+  g_free (path);
+
+  return ret;
+}
+
 static GstFlowReturn
 gst_mss_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
     GstSeekFlags flags, GstClockTime ts, GstClockTime * final_ts)
@@ -533,6 +562,14 @@ gst_mss_demux_process_manifest (GstAdaptiveDemux * demux, GstBuffer * buf)
   return gst_mss_demux_setup_streams (demux);
 }
 
+static GArray *
+gst_mss_demux_stream_get_bitrates (GstAdaptiveDemuxStream * stream)
+{
+  GstMssDemuxStream *mssstream = (GstMssDemuxStream *) stream;
+
+  return gst_mss_stream_get_bitrates (mssstream->manifest_stream);
+}
+
 static gboolean
 gst_mss_demux_stream_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate)
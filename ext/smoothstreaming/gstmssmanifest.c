@@ -50,6 +50,7 @@ GST_DEBUG_CATEGORY_EXTERN (mssdemux_debug);
 #define MSS_PROP_TIMESCALE            "TimeScale"
 #define MSS_PROP_URL                  "Url"
 
+/* A run of @repetitions fragments of the same @duration starting at @time */
 typedef struct _GstMssStreamFragment
 {
   guint number;
@@ -58,6 +59,8 @@ typedef struct _GstMssStreamFragment
   guint repetitions;
 } GstMssStreamFragment;
 
+#define FRAGMENT_END(f) ((f)->time + (f)->duration * (f)->repetitions)
+
 typedef struct _GstMssStreamQuality
 {
   xmlNodePtr xmlnode;
@@ -73,14 +76,15 @@ struct _GstMssStream
   gboolean active;              /* if the stream is currently being used */
   gint selectedQualityIndex;
 
-  GList *fragments;
+  GArray *fragments;            /* GstMssStreamFragment, sorted by time */
   GList *qualities;
 
   gchar *url;
   gchar *lang;
+  guint64 timescale;
 
   guint fragment_repetition_index;
-  GList *current_fragment;
+  guint current_fragment;       /* index in fragments, len if there is none */
   GList *current_quality;
 
   /* TODO move this to somewhere static */
@@ -104,9 +108,9 @@ struct _GstMssManifest
 /* For parsing and building a fragments list */
 typedef struct _GstMssFragmentListBuilder
 {
-  GList *fragments;
+  GArray *fragments;
 
-  GstMssStreamFragment *previous_fragment;
+  gint previous_fragment;       /* waiting for its duration, or -1 */
   guint fragment_number;
   guint64 fragment_time_accum;
 } GstMssFragmentListBuilder;
@@ -114,8 +118,9 @@ typedef struct _GstMssFragmentListBuilder
 static void
 gst_mss_fragment_list_builder_init (GstMssFragmentListBuilder * builder)
 {
-  builder->fragments = NULL;
-  builder->previous_fragment = NULL;
+  builder->fragments =
+      g_array_new (FALSE, TRUE, sizeof (GstMssStreamFragment));
+  builder->previous_fragment = -1;
   builder->fragment_time_accum = 0;
   builder->fragment_number = 0;
 }
@@ -128,7 +133,8 @@ gst_mss_fragment_list_builder_add (GstMssFragmentListBuilder * builder,
   gchar *time_str;
   gchar *seqnum_str;
   gchar *repetition_str;
-  GstMssStreamFragment *fragment = g_new (GstMssStreamFragment, 1);
+  GstMssStreamFragment fragment_data = { 0, };
+  GstMssStreamFragment *fragment = &fragment_data;
 
   duration_str = (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_DURATION);
   time_str = (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_TIME);
@@ -163,25 +169,26 @@ gst_mss_fragment_list_builder_add (GstMssFragmentListBuilder * builder,
   }
 
   /* if we have a previous fragment, means we need to set its duration */
-  if (builder->previous_fragment)
-    builder->previous_fragment->duration =
-        (fragment->time -
-        builder->previous_fragment->time) /
-        builder->previous_fragment->repetitions;
+  if (builder->previous_fragment >= 0) {
+    GstMssStreamFragment *previous = &g_array_index (builder->fragments,
+        GstMssStreamFragment, builder->previous_fragment);
+
+    previous->duration =
+        (fragment->time - previous->time) / previous->repetitions;
+  }
 
   if (duration_str) {
     fragment->duration = g_ascii_strtoull (duration_str, NULL, 10);
 
-    builder->previous_fragment = NULL;
+    builder->previous_fragment = -1;
     builder->fragment_time_accum += fragment->duration * fragment->repetitions;
     xmlFree (duration_str);
   } else {
     /* store to set the duration at the next iteration */
-    builder->previous_fragment = fragment;
+    builder->previous_fragment = builder->fragments->len;
   }
 
-  /* we reverse it later */
-  builder->fragments = g_list_prepend (builder->fragments, fragment);
+  g_array_append_val (builder->fragments, *fragment);
   GST_LOG ("Adding fragment number: %u, time: %" G_GUINT64_FORMAT
       ", duration: %" G_GUINT64_FORMAT ", repetitions: %u",
       fragment->number, fragment->time, fragment->duration,
@@ -232,6 +239,25 @@ compare_bitrate (GstMssStreamQuality * a, GstMssStreamQuality * b)
 
 }
 
+static guint64
+_gst_mss_stream_parse_timescale (xmlNodePtr node)
+{
+  gchar *timescale;
+  guint64 ts = DEFAULT_TIMESCALE;
+
+  timescale = (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_TIMESCALE);
+  if (!timescale) {
+    timescale =
+        (gchar *) xmlGetProp (node->parent, (xmlChar *) MSS_PROP_TIMESCALE);
+  }
+
+  if (timescale) {
+    ts = g_ascii_strtoull (timescale, NULL, 10);
+    xmlFree (timescale);
+  }
+  return ts;
+}
+
 static void
 _gst_mss_stream_init (GstMssStream * stream, xmlNodePtr node)
 {
@@ -245,6 +271,7 @@ _gst_mss_stream_init (GstMssStream * stream, xmlNodePtr node)
   /* get the base url path generator */
   stream->url = (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_URL);
   stream->lang = (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_LANGUAGE);
+  stream->timescale = _gst_mss_stream_parse_timescale (node);
 
   for (iter = node->children; iter; iter = iter->next) {
     if (node_has_type (iter, MSS_NODE_STREAM_FRAGMENT)) {
@@ -257,13 +284,13 @@ _gst_mss_stream_init (GstMssStream * stream, xmlNodePtr node)
     }
   }
 
-  stream->fragments = g_list_reverse (builder.fragments);
+  stream->fragments = builder.fragments;
 
   /* order them from smaller to bigger based on bitrates */
   stream->qualities =
       g_list_sort (stream->qualities, (GCompareFunc) compare_bitrate);
 
-  stream->current_fragment = stream->fragments;
+  stream->current_fragment = 0;
   stream->current_quality = stream->qualities;
 
   stream->regex_bitrate = g_regex_new ("\\{[Bb]itrate\\}", 0, 0, NULL);
@@ -353,7 +380,7 @@ gst_mss_manifest_new (GstBuffer * data)
 static void
 gst_mss_stream_free (GstMssStream * stream)
 {
-  g_list_free_full (stream->fragments, g_free);
+  g_array_free (stream->fragments, TRUE);
   g_list_free_full (stream->qualities,
       (GDestroyNotify) gst_mss_stream_quality_free);
   xmlFree (stream->url);
@@ -825,22 +852,7 @@ gst_mss_stream_set_active (GstMssStream * stream, gboolean active)
 guint64
 gst_mss_stream_get_timescale (GstMssStream * stream)
 {
-  gchar *timescale;
-  guint64 ts = DEFAULT_TIMESCALE;
-
-  timescale =
-      (gchar *) xmlGetProp (stream->xmlnode, (xmlChar *) MSS_PROP_TIMESCALE);
-  if (!timescale) {
-    timescale =
-        (gchar *) xmlGetProp (stream->xmlnode->parent,
-        (xmlChar *) MSS_PROP_TIMESCALE);
-  }
-
-  if (timescale) {
-    ts = g_ascii_strtoull (timescale, NULL, 10);
-    xmlFree (timescale);
-  }
-  return ts;
+  return stream->timescale;
 }
 
 guint64
@@ -935,34 +947,88 @@ gst_mss_stream_get_caps (GstMssStream * stream)
   return caps;
 }
 
-GstFlowReturn
-gst_mss_stream_get_fragment_url (GstMssStream * stream, gchar ** url)
+static gchar *
+gst_mss_stream_build_fragment_url (GstMssStream * stream,
+    GstMssStreamFragment * fragment, guint repetition)
 {
-  gchar *tmp;
+  gchar *tmp, *url;
   gchar *start_time_str;
   guint64 time;
-  GstMssStreamFragment *fragment;
   GstMssStreamQuality *quality = stream->current_quality->data;
 
-  g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
-
-  if (stream->current_fragment == NULL) /* stream is over */
-    return GST_FLOW_EOS;
-
-  fragment = stream->current_fragment->data;
-
-  time =
-      fragment->time + fragment->duration * stream->fragment_repetition_index;
+  time = fragment->time + fragment->duration * repetition;
   start_time_str = g_strdup_printf ("%" G_GUINT64_FORMAT, time);
 
   tmp = g_regex_replace_literal (stream->regex_bitrate, stream->url,
       strlen (stream->url), 0, quality->bitrate_str, 0, NULL);
-  *url = g_regex_replace_literal (stream->regex_position, tmp,
+  url = g_regex_replace_literal (stream->regex_position, tmp,
       strlen (tmp), 0, start_time_str, 0, NULL);
 
   g_free (tmp);
   g_free (start_time_str);
 
+  return url;
+}
+
+static GstMssStreamFragment *
+gst_mss_stream_get_current_fragment (GstMssStream * stream)
+{
+  if (stream->current_fragment >= stream->fragments->len)
+    return NULL;
+
+  return &g_array_index (stream->fragments, GstMssStreamFragment,
+      stream->current_fragment);
+}
+
+GstFlowReturn
+gst_mss_stream_get_fragment_url (GstMssStream * stream, gchar ** url)
+{
+  GstMssStreamFragment *fragment;
+
+  g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
+
+  fragment = gst_mss_stream_get_current_fragment (stream);
+  if (fragment == NULL)         /* stream is over */
+    return GST_FLOW_EOS;
+
+  *url = gst_mss_stream_build_fragment_url (stream, fragment,
+      stream->fragment_repetition_index);
+
+  if (*url == NULL)
+    return GST_FLOW_ERROR;
+
+  return GST_FLOW_OK;
+}
+
+/* Gets the url of the @n-th fragment after the current one without
+ * advancing */
+GstFlowReturn
+gst_mss_stream_peek_fragment_url (GstMssStream * stream, guint n,
+    gchar ** url)
+{
+  GstMssStreamFragment *fragment;
+  guint index;
+  guint repetition;
+
+  g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
+
+  index = stream->current_fragment;
+  repetition = stream->fragment_repetition_index;
+  while (index < stream->fragments->len && n > 0) {
+    fragment = &g_array_index (stream->fragments, GstMssStreamFragment, index);
+    if (++repetition >= fragment->repetitions) {
+      repetition = 0;
+      index++;
+    }
+    n--;
+  }
+
+  if (index >= stream->fragments->len)
+    return GST_FLOW_EOS;
+
+  fragment = &g_array_index (stream->fragments, GstMssStreamFragment, index);
+  *url = gst_mss_stream_build_fragment_url (stream, fragment, repetition);
+
   if (*url == NULL)
     return GST_FLOW_ERROR;
 
@@ -973,48 +1039,41 @@ GstClockTime
 gst_mss_stream_get_fragment_gst_timestamp (GstMssStream * stream)
 {
   guint64 time;
-  guint64 timescale;
   GstMssStreamFragment *fragment;
 
   g_return_val_if_fail (stream->active, GST_CLOCK_TIME_NONE);
 
-  if (!stream->current_fragment) {
-    GList *last = g_list_last (stream->fragments);
-    if (last == NULL)
+  fragment = gst_mss_stream_get_current_fragment (stream);
+  if (!fragment) {
+    if (stream->fragments->len == 0)
       return GST_CLOCK_TIME_NONE;
 
-    fragment = last->data;
-    time = fragment->time + (fragment->duration * fragment->repetitions);
+    fragment = &g_array_index (stream->fragments, GstMssStreamFragment,
+        stream->fragments->len - 1);
+    time = FRAGMENT_END (fragment);
   } else {
-    fragment = stream->current_fragment->data;
     time =
         fragment->time +
         (fragment->duration * stream->fragment_repetition_index);
   }
 
-  timescale = gst_mss_stream_get_timescale (stream);
   return (GstClockTime) gst_util_uint64_scale_round (time, GST_SECOND,
-      timescale);
+      stream->timescale);
 }
 
 GstClockTime
 gst_mss_stream_get_fragment_gst_duration (GstMssStream * stream)
 {
-  guint64 dur;
-  guint64 timescale;
   GstMssStreamFragment *fragment;
 
   g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
 
-  if (!stream->current_fragment)
+  fragment = gst_mss_stream_get_current_fragment (stream);
+  if (!fragment)
     return GST_CLOCK_TIME_NONE;
 
-  fragment = stream->current_fragment->data;
-
-  dur = fragment->duration;
-  timescale = gst_mss_stream_get_timescale (stream);
-  return (GstClockTime) gst_util_uint64_scale_round (dur, GST_SECOND,
-      timescale);
+  return (GstClockTime) gst_util_uint64_scale_round (fragment->duration,
+      GST_SECOND, stream->timescale);
 }
 
 gboolean
@@ -1022,10 +1081,7 @@ gst_mss_stream_has_next_fragment (GstMssStream * stream)
 {
   g_return_val_if_fail (stream->active, FALSE);
 
-  if (stream->current_fragment == NULL)
-    return FALSE;
-
-  return TRUE;
+  return gst_mss_stream_get_current_fragment (stream) != NULL;
 }
 
 GstFlowReturn
@@ -1034,18 +1090,18 @@ gst_mss_stream_advance_fragment (GstMssStream * stream)
   GstMssStreamFragment *fragment;
   g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
 
-  if (stream->current_fragment == NULL)
+  fragment = gst_mss_stream_get_current_fragment (stream);
+  if (fragment == NULL)
     return GST_FLOW_EOS;
 
-  fragment = stream->current_fragment->data;
   stream->fragment_repetition_index++;
   if (stream->fragment_repetition_index < fragment->repetitions) {
     return GST_FLOW_OK;
   }
 
   stream->fragment_repetition_index = 0;
-  stream->current_fragment = g_list_next (stream->current_fragment);
-  if (stream->current_fragment == NULL)
+  stream->current_fragment++;
+  if (stream->current_fragment >= stream->fragments->len)
     return GST_FLOW_EOS;
   return GST_FLOW_OK;
 }
@@ -1056,15 +1112,16 @@ gst_mss_stream_regress_fragment (GstMssStream * stream)
   GstMssStreamFragment *fragment;
   g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
 
-  if (stream->current_fragment == NULL)
+  if (gst_mss_stream_get_current_fragment (stream) == NULL)
     return GST_FLOW_EOS;
 
-  fragment = stream->current_fragment->data;
   if (stream->fragment_repetition_index == 0) {
-    stream->current_fragment = g_list_previous (stream->current_fragment);
-    if (stream->current_fragment == NULL)
+    if (stream->current_fragment == 0) {
+      stream->current_fragment = stream->fragments->len;
       return GST_FLOW_EOS;
-    fragment = stream->current_fragment->data;
+    }
+    stream->current_fragment--;
+    fragment = gst_mss_stream_get_current_fragment (stream);
     stream->fragment_repetition_index = fragment->repetitions - 1;
   } else {
     stream->fragment_repetition_index--;
@@ -1107,6 +1164,27 @@ gst_mss_manifest_seek (GstMssManifest * manifest, gboolean forward,
     ((forward && (flags & GST_SEEK_FLAG_SNAP_AFTER)) || \
     (!forward && (flags & GST_SEEK_FLAG_SNAP_BEFORE)))
 
+/* Index of the first fragment run ending after @time, fragments->len if
+ * there is none */
+static guint
+gst_mss_stream_find_fragment (GstMssStream * stream, guint64 time)
+{
+  guint lower = 0, upper = stream->fragments->len;
+
+  while (lower < upper) {
+    guint middle = lower + (upper - lower) / 2;
+    GstMssStreamFragment *fragment = &g_array_index (stream->fragments,
+        GstMssStreamFragment, middle);
+
+    if (FRAGMENT_END (fragment) > time)
+      upper = middle;
+    else
+      lower = middle + 1;
+  }
+
+  return lower;
+}
+
 /**
  * Seeks this stream to the fragment that contains the sample at time
  *
@@ -1116,50 +1194,54 @@ void
 gst_mss_stream_seek (GstMssStream * stream, gboolean forward,
     GstSeekFlags flags, guint64 time, guint64 * final_time)
 {
-  GList *iter;
+  guint index;
   guint64 timescale;
   GstMssStreamFragment *fragment = NULL;
 
-  timescale = gst_mss_stream_get_timescale (stream);
+  timescale = stream->timescale;
   time = gst_util_uint64_scale_round (time, timescale, GST_SECOND);
 
   GST_DEBUG ("Stream %s seeking to %" G_GUINT64_FORMAT, stream->url, time);
-  for (iter = stream->fragments; iter; iter = g_list_next (iter)) {
-    fragment = iter->data;
-    if (fragment->time + fragment->repetitions * fragment->duration > time) {
-      stream->current_fragment = iter;
-      stream->fragment_repetition_index =
-          (time - fragment->time) / fragment->duration;
-      if (((time - fragment->time) % fragment->duration) == 0) {
+  index = gst_mss_stream_find_fragment (stream, time);
+  stream->current_fragment = index;
+  stream->fragment_repetition_index = 0;
+
+  if (index < stream->fragments->len) {
+    fragment = &g_array_index (stream->fragments, GstMssStreamFragment, index);
 
-        /* for reverse playback, start from the previous fragment when we are
-         * exactly at a limit */
-        if (!forward)
-          stream->fragment_repetition_index--;
-      } else if (SNAP_AFTER (forward, flags))
-        stream->fragment_repetition_index++;
+    /* before the first fragment, e.g. after the live window moved, or on
+     * the newest fragment whose duration isn't known yet */
+    if (time < fragment->time || fragment->duration == 0)
+      time = fragment->time;
 
-      if (stream->fragment_repetition_index == fragment->repetitions) {
-        /* move to the next one */
+    if (fragment->duration > 0)
+      stream->fragment_repetition_index =
+          (time - fragment->time) / fragment->duration;
+    if (time == fragment->time ||
+        ((time - fragment->time) % fragment->duration) == 0) {
+
+      /* for reverse playback, start from the previous fragment when we are
+       * exactly at a limit */
+      if (!forward)
+        stream->fragment_repetition_index--;
+    } else if (SNAP_AFTER (forward, flags))
+      stream->fragment_repetition_index++;
+
+    if (stream->fragment_repetition_index == fragment->repetitions) {
+      /* move to the next one */
+      stream->fragment_repetition_index = 0;
+      stream->current_fragment = index + 1;
+      fragment = gst_mss_stream_get_current_fragment (stream);
+
+    } else if (stream->fragment_repetition_index == -1) {
+      if (index > 0) {
+        stream->current_fragment = index - 1;
+        fragment = gst_mss_stream_get_current_fragment (stream);
+        stream->fragment_repetition_index = fragment->repetitions - 1;
+      } else {
         stream->fragment_repetition_index = 0;
-        stream->current_fragment = g_list_next (iter);
-        fragment =
-            stream->current_fragment ? stream->current_fragment->data : NULL;
-
-      } else if (stream->fragment_repetition_index == -1) {
-        if (g_list_previous (iter)) {
-          stream->current_fragment = g_list_previous (iter);
-          fragment =
-              stream->current_fragment ? stream->current_fragment->data : NULL;
-          stream->fragment_repetition_index = fragment->repetitions - 1;
-        } else {
-          stream->fragment_repetition_index = 0;
-        }
       }
-
-      break;
     }
-
   }
 
   GST_DEBUG ("Stream %s seeked to fragment time %" G_GUINT64_FORMAT
@@ -1171,10 +1253,10 @@ gst_mss_stream_seek (GstMssStream * stream, gboolean forward,
       *final_time = gst_util_uint64_scale_round (fragment->time +
           stream->fragment_repetition_index * fragment->duration,
           GST_SECOND, timescale);
-    } else {
-      GstMssStreamFragment *last_fragment = g_list_last (iter)->data;
-      *final_time = gst_util_uint64_scale_round (last_fragment->time +
-          last_fragment->repetitions * last_fragment->duration,
+    } else if (stream->fragments->len > 0) {
+      GstMssStreamFragment *last_fragment = &g_array_index (stream->fragments,
+          GstMssStreamFragment, stream->fragments->len - 1);
+      *final_time = gst_util_uint64_scale_round (FRAGMENT_END (last_fragment),
           GST_SECOND, timescale);
     }
   }
@@ -1205,18 +1287,116 @@ gst_mss_manifest_is_live (GstMssManifest * manifest)
   return manifest->is_live;
 }
 
+/* Appends the fragments of @fragments that are after the known ones and
+ * drops the known ones that went out of the live window. The position in
+ * the stream is kept as is, unless the timestamps restarted */
+static void
+gst_mss_stream_merge_fragments (GstMssStream * stream, GArray * fragments)
+{
+  GstMssStreamFragment *last;
+  guint64 end;
+  guint i, drop;
+
+  if (stream->fragments->len > 0) {
+    last = &g_array_index (stream->fragments, GstMssStreamFragment,
+        stream->fragments->len - 1);
+    /* its duration was unknown, the new manifest has the full fragment */
+    if (last->duration == 0)
+      g_array_set_size (stream->fragments, stream->fragments->len - 1);
+  }
+
+  if (stream->fragments->len == 0) {
+    g_array_append_vals (stream->fragments, fragments->data, fragments->len);
+    return;
+  }
+
+  /* the new runs all end before the known ones start, the timestamps
+   * restarted (e.g. with the encoder) and nothing can be merged */
+  if (fragments->len > 0 &&
+      FRAGMENT_END (&g_array_index (fragments, GstMssStreamFragment,
+              fragments->len - 1)) <
+      g_array_index (stream->fragments, GstMssStreamFragment, 0).time) {
+    GST_DEBUG ("Fragment timestamps restarted, replacing the fragments");
+    g_array_set_size (stream->fragments, 0);
+    g_array_append_vals (stream->fragments, fragments->data, fragments->len);
+    stream->current_fragment = 0;
+    stream->fragment_repetition_index = 0;
+    return;
+  }
+
+  last = &g_array_index (stream->fragments, GstMssStreamFragment,
+      stream->fragments->len - 1);
+  end = FRAGMENT_END (last);
+
+  for (i = 0; i < fragments->len; i++) {
+    GstMssStreamFragment fragment =
+        g_array_index (fragments, GstMssStreamFragment, i);
+
+    if (fragment.duration == 0) {
+      /* the newest fragment, its duration is only known with the next one */
+      if (fragment.time < end)
+        continue;
+    } else if (FRAGMENT_END (&fragment) <= end) {
+      continue;
+    }
+
+    if (fragment.time < end) {
+      /* a run whose repetition count grew since the last update */
+      guint known = (end - fragment.time + fragment.duration - 1) /
+          fragment.duration;
+
+      fragment.time += known * fragment.duration;
+      fragment.number += known;
+      fragment.repetitions -= known;
+      if (fragment.repetitions == 0)
+        continue;
+
+      if (fragment.time == end && fragment.duration == last->duration) {
+        last->repetitions += fragment.repetitions;
+        end = FRAGMENT_END (last);
+        continue;
+      }
+    }
+
+    GST_LOG ("Adding fragment number: %u, time: %" G_GUINT64_FORMAT
+        ", duration: %" G_GUINT64_FORMAT ", repetitions: %u",
+        fragment.number, fragment.time, fragment.duration,
+        fragment.repetitions);
+    g_array_append_val (stream->fragments, fragment);
+    last = &g_array_index (stream->fragments, GstMssStreamFragment,
+        stream->fragments->len - 1);
+    end = FRAGMENT_END (last);
+  }
+
+  /* the old fragments before the current one can go once the server
+   * dropped them too, to keep the list as long as the live window */
+  if (fragments->len > 0) {
+    guint64 first_time =
+        g_array_index (fragments, GstMssStreamFragment, 0).time;
+
+    for (drop = 0; drop < stream->current_fragment; drop++) {
+      GstMssStreamFragment *fragment = &g_array_index (stream->fragments,
+          GstMssStreamFragment, drop);
+
+      if (FRAGMENT_END (fragment) > first_time)
+        break;
+    }
+    if (drop > 0) {
+      GST_DEBUG ("Dropping %u fragments out of the live window", drop);
+      g_array_remove_range (stream->fragments, 0, drop);
+      stream->current_fragment -= drop;
+    }
+  }
+}
+
 static void
 gst_mss_stream_reload_fragments (GstMssStream * stream, xmlNodePtr streamIndex)
 {
   xmlNodePtr iter;
-  guint64 current_gst_time = gst_mss_stream_get_fragment_gst_timestamp (stream);
   GstMssFragmentListBuilder builder;
 
   gst_mss_fragment_list_builder_init (&builder);
 
-  GST_DEBUG ("Current position: %" GST_TIME_FORMAT,
-      GST_TIME_ARGS (current_gst_time));
-
   for (iter = streamIndex->children; iter; iter = iter->next) {
     if (node_has_type (iter, MSS_NODE_STREAM_FRAGMENT)) {
       gst_mss_fragment_list_builder_add (&builder, iter);
@@ -1225,15 +1405,11 @@ gst_mss_stream_reload_fragments (GstMssStream * stream, xmlNodePtr streamIndex)
     }
   }
 
-  /* store the new fragments list */
-  if (builder.fragments) {
-    g_list_free_full (stream->fragments, g_free);
-    stream->fragments = g_list_reverse (builder.fragments);
-    stream->current_fragment = stream->fragments;
-    /* TODO Verify how repositioning here works for reverse
-     * playback - it might start from the wrong fragment */
-    gst_mss_stream_seek (stream, TRUE, 0, current_gst_time, NULL);
-  }
+  gst_mss_stream_merge_fragments (stream, builder.fragments);
+  g_array_free (builder.fragments, TRUE);
+
+  GST_DEBUG ("Stream %s has %u fragment runs, current %u", stream->url,
+      stream->fragments->len, stream->current_fragment);
 }
 
 static void
@@ -1297,7 +1473,7 @@ gst_mss_stream_select_bitrate (GstMssStream * stream, guint64 bitrate)
     next = g_list_next (iter);
     if (next) {
       next_q = next->data;
-      if (next_q->bitrate < bitrate) {
+      if (next_q->bitrate <= bitrate) {
         iter = next;
         q = iter->data;
       } else {
@@ -1314,6 +1490,22 @@ gst_mss_stream_select_bitrate (GstMssStream * stream, guint64 bitrate)
   return TRUE;
 }
 
+GArray *
+gst_mss_stream_get_bitrates (GstMssStream * stream)
+{
+  GArray *bitrates;
+  GList *iter;
+
+  bitrates = g_array_new (FALSE, FALSE, sizeof (guint64));
+  for (iter = stream->qualities; iter; iter = g_list_next (iter)) {
+    GstMssStreamQuality *q = iter->data;
+
+    g_array_append_val (bitrates, q->bitrate);
+  }
+
+  return bitrates;
+}
+
 guint64
 gst_mss_stream_get_current_bitrate (GstMssStream * stream)
 {
@@ -58,10 +58,12 @@ const gchar * gst_mss_manifest_get_protection_data (GstMssManifest * manifest);
 GstMssStreamType gst_mss_stream_get_type (GstMssStream *stream);
 GstCaps * gst_mss_stream_get_caps (GstMssStream * stream);
 gboolean gst_mss_stream_select_bitrate (GstMssStream * stream, guint64 bitrate);
+GArray * gst_mss_stream_get_bitrates (GstMssStream * stream);
 guint64 gst_mss_stream_get_current_bitrate (GstMssStream * stream);
 void gst_mss_stream_set_active (GstMssStream * stream, gboolean active);
 guint64 gst_mss_stream_get_timescale (GstMssStream * stream);
 GstFlowReturn gst_mss_stream_get_fragment_url (GstMssStream * stream, gchar ** url);
+GstFlowReturn gst_mss_stream_peek_fragment_url (GstMssStream * stream, guint n, gchar ** url);
 GstClockTime gst_mss_stream_get_fragment_gst_timestamp (GstMssStream * stream);
 GstClockTime gst_mss_stream_get_fragment_gst_duration (GstMssStream * stream);
 gboolean gst_mss_stream_has_next_fragment (GstMssStream * stream);
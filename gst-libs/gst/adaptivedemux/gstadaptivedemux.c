@@ -60,6 +60,25 @@
  *                       interrupted to save network bandwidth. When they are
  *                       relinked a reconfigure event is received and the
  *                       stream is restarted.
+ * - Prefetching: If the subclass implements stream_peek_fragment_info, up to
+ *                prefetch-depth of the following fragments are downloaded
+ *                in a separate thread into a bounded memory cache while the
+ *                current fragment is downloaded and pushed. This hides the
+ *                request round trip between fragments. Ranges of the same
+ *                file are fetched with one request and large fragments
+ *                with several parallel ones.
+ * - Bitrate adaptation: The algorithm selected with the abr-algorithm
+ *                       property decides the bitrate passed to
+ *                       stream_select_bitrate. The default one uses the
+ *                       average input rate of the stream's queue, the
+ *                       others the timing statistics of every downloaded
+ *                       fragment.
+ * - Connection sharing: The source elements of the streams and of the
+ *                       manifest and prefetch downloads are taken from a
+ *                       #GstUriSourcePool shared through a #GstContext, so
+ *                       that connections are kept alive and reused between
+ *                       them and the number of concurrent connections to a
+ *                       server is limited.
  *
  * Subclasses:
  * While GstAdaptiveDemux is responsible for the workflow, it knows nothing
@@ -135,6 +154,14 @@ GST_DEBUG_CATEGORY (adaptivedemux_debug);
 #define DEFAULT_CONNECTION_SPEED 0
 #define DEFAULT_BITRATE_LIMIT 0.8
 #define SRC_QUEUE_MAX_BYTES 20 * 1024 * 1024    /* For safety. Large enough to hold a segment. */
+#define DEFAULT_PREFETCH_DEPTH 0
+#define PREFETCH_MAX_BYTES SRC_QUEUE_MAX_BYTES  /* per stream */
+#define PREFETCH_RETRY_INTERVAL G_USEC_PER_SEC
+#define PREFETCH_PARALLEL_REQUESTS 4    /* for large fragments */
+#define DEFAULT_ABR_ALGORITHM GST_ADAPTIVE_DEMUX_ABR_THROUGHPUT
+#define DEFAULT_ABR_BUFFER_TARGET (10 * GST_SECOND)
+#define DEFAULT_STATISTICS_HISTORY 16
+#define DEFAULT_POST_STATISTICS TRUE
 
 #define GST_MANIFEST_GET_LOCK(d) (&(GST_ADAPTIVE_DEMUX_CAST(d)->priv->manifest_lock))
 #define GST_MANIFEST_LOCK(d) g_rec_mutex_lock (GST_MANIFEST_GET_LOCK (d));
@@ -153,6 +180,12 @@ enum
   PROP_0,
   PROP_CONNECTION_SPEED,
   PROP_BITRATE_LIMIT,
+  PROP_PREFETCH_DEPTH,
+  PROP_ABR_ALGORITHM,
+  PROP_ABR_BUFFER_TARGET,
+  PROP_STATISTICS_HISTORY,
+  PROP_POST_STATISTICS,
+  PROP_STATISTICS,
   PROP_LAST
 };
 
@@ -198,8 +231,45 @@ struct _GstAdaptiveDemuxPrivate
    * without needing to stop tasks when they just want to
    * update the segment boundaries */
   GMutex segment_lock;
+
+  /* measures the download times. This is the system clock, which tests
+   * replace to simulate downloads */
+  GstClock *realtime_clock;
+
+  /* source elements shared with the other elements of the pipeline,
+   * protected by the object lock */
+  GstUriSourcePool *source_pool;
+
+  /* statistics of the last downloaded fragments, kept in a ring of
+   * stats_size entries so that applications can poll them. Protected by
+   * stats_lock, which is never held while taking another lock */
+  GMutex stats_lock;
+  GstStructure **stats;
+  guint stats_size;
+  guint stats_len;
+  guint stats_next;             /* index of the next entry to write */
+
+  /* set and read by the properties and read when advancing a fragment, all
+   * with manifest_lock taken */
+  gboolean post_statistics;
 };
 
+/* A fragment, header or index downloaded ahead of time */
+typedef struct _GstAdaptiveDemuxPrefetch
+{
+  gchar *uri;
+  gint64 range_start;
+  gint64 range_end;
+
+  /* the buffers as they were received, they are pushed one by one */
+  GstBufferList *buffers;
+  gsize size;                   /* expected size while downloading */
+  gboolean is_fragment;         /* not a header or index */
+  gboolean downloading;
+  gboolean failed;
+  gint64 download_time;         /* in microseconds */
+} GstAdaptiveDemuxPrefetch;
+
 static GstBinClass *parent_class = NULL;
 static void gst_adaptive_demux_class_init (GstAdaptiveDemuxClass * klass);
 static void gst_adaptive_demux_init (GstAdaptiveDemux * dec,
@@ -207,6 +277,8 @@ static void gst_adaptive_demux_init (GstAdaptiveDemux * dec,
 static void gst_adaptive_demux_finalize (GObject * object);
 static GstStateChangeReturn gst_adaptive_demux_change_state (GstElement *
     element, GstStateChange transition);
+static void gst_adaptive_demux_set_context (GstElement * element,
+    GstContext * context);
 
 static void gst_adaptive_demux_handle_message (GstBin * bin, GstMessage * msg);
 
@@ -225,6 +297,10 @@ gst_adaptive_demux_push_src_event (GstAdaptiveDemux * demux, GstEvent * event);
 static void gst_adaptive_demux_updates_loop (GstAdaptiveDemux * demux);
 static void gst_adaptive_demux_stream_download_loop (GstAdaptiveDemuxStream *
     stream);
+static void gst_adaptive_demux_stream_prefetch_loop (GstAdaptiveDemuxStream *
+    stream);
+static void gst_adaptive_demux_stream_clear_prefetched (GstAdaptiveDemuxStream
+    * stream);
 static void gst_adaptive_demux_reset (GstAdaptiveDemux * demux);
 static gboolean gst_adaptive_demux_expose_streams (GstAdaptiveDemux * demux,
     gboolean first_and_live);
@@ -250,6 +326,8 @@ static gboolean gst_adaptive_demux_has_next_period (GstAdaptiveDemux * demux);
 static void gst_adaptive_demux_advance_period (GstAdaptiveDemux * demux);
 
 static void gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream);
+static void gst_adaptive_demux_stream_release_source (GstAdaptiveDemuxStream *
+    stream);
 static GstFlowReturn
 gst_adaptive_demux_stream_push_event (GstAdaptiveDemuxStream * stream,
     GstEvent * event);
@@ -270,6 +348,7 @@ gst_adaptive_demux_stream_finish_fragment_default (GstAdaptiveDemux * demux,
 static GstFlowReturn
 gst_adaptive_demux_stream_advance_fragment_unlocked (GstAdaptiveDemux * demux,
     GstAdaptiveDemuxStream * stream, GstClockTime duration);
+static gint64 gst_adaptive_demux_get_monotonic_time (GstAdaptiveDemux * demux);
 
 
 /* we can't use G_DEFINE_ABSTRACT_TYPE because we need the klass in the _init
@@ -300,6 +379,110 @@ gst_adaptive_demux_get_type (void)
   return type;
 }
 
+/* Resizes the statistics history, keeping the most recent entries */
+static void
+gst_adaptive_demux_set_statistics_history (GstAdaptiveDemux * demux,
+    guint size)
+{
+  GstAdaptiveDemuxPrivate *priv = demux->priv;
+  GstStructure **stats;
+  guint i, len;
+
+  g_mutex_lock (&priv->stats_lock);
+  if (size == priv->stats_size) {
+    g_mutex_unlock (&priv->stats_lock);
+    return;
+  }
+
+  stats = size ? g_new0 (GstStructure *, size) : NULL;
+  len = MIN (size, priv->stats_len);
+  for (i = 0; i < priv->stats_len; i++) {
+    guint index = (priv->stats_next + priv->stats_size - priv->stats_len + i)
+        % priv->stats_size;
+
+    if (i < priv->stats_len - len)
+      gst_structure_free (priv->stats[index]);
+    else
+      stats[i - (priv->stats_len - len)] = priv->stats[index];
+  }
+  g_free (priv->stats);
+
+  priv->stats = stats;
+  priv->stats_size = size;
+  priv->stats_len = len;
+  priv->stats_next = size ? len % size : 0;
+  g_mutex_unlock (&priv->stats_lock);
+}
+
+static void
+gst_adaptive_demux_clear_statistics (GstAdaptiveDemux * demux)
+{
+  GstAdaptiveDemuxPrivate *priv = demux->priv;
+
+  g_mutex_lock (&priv->stats_lock);
+  for (; priv->stats_len > 0; priv->stats_len--) {
+    priv->stats_next = (priv->stats_next + priv->stats_size - 1)
+        % priv->stats_size;
+    gst_structure_free (priv->stats[priv->stats_next]);
+    priv->stats[priv->stats_next] = NULL;
+  }
+  priv->stats_next = 0;
+  g_mutex_unlock (&priv->stats_lock);
+}
+
+/* Stores a copy of @stats, replacing the oldest entry if the history is
+ * full */
+static void
+gst_adaptive_demux_add_statistics (GstAdaptiveDemux * demux,
+    const GstStructure * stats)
+{
+  GstAdaptiveDemuxPrivate *priv = demux->priv;
+
+  g_mutex_lock (&priv->stats_lock);
+  if (priv->stats_size == 0) {
+    g_mutex_unlock (&priv->stats_lock);
+    return;
+  }
+
+  if (priv->stats_len == priv->stats_size)
+    gst_structure_free (priv->stats[priv->stats_next]);
+  else
+    priv->stats_len++;
+  priv->stats[priv->stats_next] = gst_structure_copy (stats);
+  priv->stats_next = (priv->stats_next + 1) % priv->stats_size;
+  g_mutex_unlock (&priv->stats_lock);
+}
+
+/* Returns the statistics history, oldest fragment first */
+static GstStructure *
+gst_adaptive_demux_get_statistics (GstAdaptiveDemux * demux)
+{
+  GstAdaptiveDemuxPrivate *priv = demux->priv;
+  GValue fragments = G_VALUE_INIT;
+  GValue item = G_VALUE_INIT;
+  GstStructure *s;
+  guint i;
+
+  g_value_init (&fragments, GST_TYPE_ARRAY);
+  g_value_init (&item, GST_TYPE_STRUCTURE);
+
+  g_mutex_lock (&priv->stats_lock);
+  for (i = 0; i < priv->stats_len; i++) {
+    guint index = (priv->stats_next + priv->stats_size - priv->stats_len + i)
+        % priv->stats_size;
+
+    gst_value_set_structure (&item, priv->stats[index]);
+    gst_value_array_append_value (&fragments, &item);
+  }
+  g_mutex_unlock (&priv->stats_lock);
+
+  s = gst_structure_new_empty (GST_ADAPTIVE_DEMUX_STATISTICS_MESSAGE_NAME);
+  gst_structure_take_value (s, "fragments", &fragments);
+  g_value_unset (&item);
+
+  return s;
+}
+
 static void
 gst_adaptive_demux_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -318,6 +501,23 @@ gst_adaptive_demux_set_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       demux->bitrate_limit = g_value_get_float (value);
       break;
+    case PROP_PREFETCH_DEPTH:
+      demux->prefetch_depth = g_value_get_uint (value);
+      break;
+    case PROP_ABR_ALGORITHM:
+      /* applied by the streams before selecting their next bitrate */
+      demux->abr_algorithm = g_value_get_enum (value);
+      break;
+    case PROP_ABR_BUFFER_TARGET:
+      demux->abr_buffer_target = g_value_get_uint64 (value);
+      break;
+    case PROP_STATISTICS_HISTORY:
+      gst_adaptive_demux_set_statistics_history (demux,
+          g_value_get_uint (value));
+      break;
+    case PROP_POST_STATISTICS:
+      demux->priv->post_statistics = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -342,6 +542,26 @@ gst_adaptive_demux_get_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       g_value_set_float (value, demux->bitrate_limit);
       break;
+    case PROP_PREFETCH_DEPTH:
+      g_value_set_uint (value, demux->prefetch_depth);
+      break;
+    case PROP_ABR_ALGORITHM:
+      g_value_set_enum (value, demux->abr_algorithm);
+      break;
+    case PROP_ABR_BUFFER_TARGET:
+      g_value_set_uint64 (value, demux->abr_buffer_target);
+      break;
+    case PROP_STATISTICS_HISTORY:
+      g_mutex_lock (&demux->priv->stats_lock);
+      g_value_set_uint (value, demux->priv->stats_size);
+      g_mutex_unlock (&demux->priv->stats_lock);
+      break;
+    case PROP_POST_STATISTICS:
+      g_value_set_boolean (value, demux->priv->post_statistics);
+      break;
+    case PROP_STATISTICS:
+      g_value_take_boxed (value, gst_adaptive_demux_get_statistics (demux));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -385,7 +605,54 @@ gst_adaptive_demux_class_init (GstAdaptiveDemuxClass * klass)
           0, 1, DEFAULT_BITRATE_LIMIT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_PREFETCH_DEPTH,
+      g_param_spec_uint ("prefetch-depth", "Prefetch depth",
+          "Number of fragments to download ahead while the current one "
+          "is streamed (0 = disabled). Takes effect when the streams are "
+          "(re)started", 0, 16, DEFAULT_PREFETCH_DEPTH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_ABR_ALGORITHM,
+      g_param_spec_enum ("abr-algorithm", "ABR algorithm",
+          "Algorithm used to select the bitrate of the next fragment",
+          GST_TYPE_ADAPTIVE_DEMUX_ABR_ALGORITHM, DEFAULT_ABR_ALGORITHM,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_ABR_BUFFER_TARGET,
+      g_param_spec_uint64 ("abr-buffer-target", "ABR buffer target",
+          "Amount of media downstream can buffer, used by the buffer based "
+          "ABR algorithms (in nanoseconds)", 0, G_MAXUINT64,
+          DEFAULT_ABR_BUFFER_TARGET,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STATISTICS_HISTORY,
+      g_param_spec_uint ("statistics-history", "Statistics history",
+          "Number of downloaded fragments whose statistics are kept in the "
+          "statistics property (0 = disabled)", 0, 1024,
+          DEFAULT_STATISTICS_HISTORY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_POST_STATISTICS,
+      g_param_spec_boolean ("post-statistics", "Post statistics",
+          "Post an element message with the statistics of each downloaded "
+          "fragment", DEFAULT_POST_STATISTICS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAdaptiveDemux:statistics:
+   *
+   * The statistics of the last downloaded fragments, as a structure whose
+   * "fragments" field is an array of the structures described in
+   * #GST_ADAPTIVE_DEMUX_STATISTICS_MESSAGE_NAME, oldest first. Polling it
+   * is an alternative to the element messages.
+   */
+  g_object_class_install_property (gobject_class, PROP_STATISTICS,
+      g_param_spec_boxed ("statistics", "Statistics",
+          "Statistics of the last downloaded fragments", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = gst_adaptive_demux_change_state;
+  gstelement_class->set_context = gst_adaptive_demux_set_context;
 
   gstbin_class->handle_message = gst_adaptive_demux_handle_message;
 
@@ -427,6 +694,9 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   g_rec_mutex_init (&demux->priv->manifest_lock);
   g_mutex_init (&demux->priv->api_lock);
   g_mutex_init (&demux->priv->segment_lock);
+  g_mutex_init (&demux->priv->stats_lock);
+
+  demux->priv->realtime_clock = gst_system_clock_obtain ();
 
   pad_template =
       gst_element_class_get_pad_template (GST_ELEMENT_CLASS (klass), "sink");
@@ -441,6 +711,12 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   /* Properties */
   demux->bitrate_limit = DEFAULT_BITRATE_LIMIT;
   demux->connection_speed = DEFAULT_CONNECTION_SPEED;
+  demux->prefetch_depth = DEFAULT_PREFETCH_DEPTH;
+  demux->abr_algorithm = DEFAULT_ABR_ALGORITHM;
+  demux->abr_buffer_target = DEFAULT_ABR_BUFFER_TARGET;
+  demux->priv->post_statistics = DEFAULT_POST_STATISTICS;
+  gst_adaptive_demux_set_statistics_history (demux,
+      DEFAULT_STATISTICS_HISTORY);
 
   gst_element_add_pad (GST_ELEMENT (demux), demux->sinkpad);
 }
@@ -465,10 +741,76 @@ gst_adaptive_demux_finalize (GObject * object)
   g_rec_mutex_clear (&demux->priv->manifest_lock);
   g_mutex_clear (&demux->priv->api_lock);
   g_mutex_clear (&demux->priv->segment_lock);
+  gst_adaptive_demux_set_statistics_history (demux, 0);
+  g_mutex_clear (&priv->stats_lock);
+  gst_object_unref (priv->realtime_clock);
+  if (priv->source_pool)
+    gst_object_unref (priv->source_pool);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gst_adaptive_demux_set_context (GstElement * element, GstContext * context)
+{
+  GstAdaptiveDemux *demux = GST_ADAPTIVE_DEMUX_CAST (element);
+  GstUriSourcePool *pool = NULL;
+
+  if (gst_context_has_context_type (context, GST_URI_SOURCE_POOL_CONTEXT_TYPE)
+      && gst_context_get_uri_source_pool (context, &pool)) {
+    GST_DEBUG_OBJECT (demux, "Using source pool %" GST_PTR_FORMAT, pool);
+
+    GST_OBJECT_LOCK (demux);
+    gst_object_replace ((GstObject **) & demux->priv->source_pool,
+        (GstObject *) pool);
+    GST_OBJECT_UNLOCK (demux);
+
+    /* streams keep the pool they were created with */
+    gst_uri_downloader_set_source_pool (demux->downloader, pool);
+    gst_object_unref (pool);
+  }
+
+  GST_ELEMENT_CLASS (parent_class)->set_context (element, context);
+}
+
+/* Shares the source elements, and so the connections, with the other
+ * elements of the pipeline. Uses the pool of the application or of another
+ * element if there is one, otherwise creates it and announces it */
+static void
+gst_adaptive_demux_ensure_source_pool (GstAdaptiveDemux * demux)
+{
+  GstUriSourcePool *pool;
+  GstContext *context;
+  gboolean found;
+
+  GST_OBJECT_LOCK (demux);
+  found = demux->priv->source_pool != NULL;
+  GST_OBJECT_UNLOCK (demux);
+  if (found)
+    return;
+
+  gst_element_post_message (GST_ELEMENT_CAST (demux),
+      gst_message_new_need_context (GST_OBJECT_CAST (demux),
+          GST_URI_SOURCE_POOL_CONTEXT_TYPE));
+
+  GST_OBJECT_LOCK (demux);
+  found = demux->priv->source_pool != NULL;
+  GST_OBJECT_UNLOCK (demux);
+  if (found)
+    return;
+
+  pool = gst_uri_source_pool_new ();
+  context = gst_context_new (GST_URI_SOURCE_POOL_CONTEXT_TYPE, TRUE);
+  gst_context_set_uri_source_pool (context, pool);
+  gst_object_unref (pool);
+
+  gst_element_set_context (GST_ELEMENT_CAST (demux), context);
+
+  GST_DEBUG_OBJECT (demux, "Posting have-context message with a new pool");
+  gst_element_post_message (GST_ELEMENT_CAST (demux),
+      gst_message_new_have_context (GST_OBJECT_CAST (demux), context));
+}
+
 static GstStateChangeReturn
 gst_adaptive_demux_change_state (GstElement * element,
     GstStateChange transition)
@@ -479,6 +821,9 @@ gst_adaptive_demux_change_state (GstElement * element,
   GST_API_LOCK (demux);
 
   switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      gst_adaptive_demux_ensure_source_pool (demux);
+      break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       GST_MANIFEST_LOCK (demux);
       gst_adaptive_demux_reset (demux);
@@ -723,6 +1068,8 @@ gst_adaptive_demux_reset (GstAdaptiveDemux * demux)
   demux->have_group_id = FALSE;
   demux->group_id = G_MAXUINT;
   demux->priv->segment_seqnum = gst_util_seqnum_next ();
+
+  gst_adaptive_demux_clear_statistics (demux);
 }
 
 static void
@@ -1032,6 +1379,8 @@ gst_adaptive_demux_expose_streams (GstAdaptiveDemux * demux,
       stream->cancelled = TRUE;
       g_cond_signal (&stream->fragment_download_cond);
       g_mutex_unlock (&stream->fragment_download_lock);
+      if (stream->source_pool)
+        gst_uri_source_pool_cancel (stream->source_pool, stream);
     }
     gst_event_unref (eos);
 
@@ -1059,6 +1408,23 @@ gst_adaptive_demux_stream_new (GstAdaptiveDemux * demux, GstPad * pad)
       stream, NULL);
   gst_task_set_lock (stream->download_task, &stream->download_lock);
 
+  /* Prefetching task, only started if enabled */
+  g_rec_mutex_init (&stream->prefetch_task_lock);
+  stream->prefetch_task =
+      gst_task_new ((GstTaskFunction) gst_adaptive_demux_stream_prefetch_loop,
+      stream, NULL);
+  gst_task_set_lock (stream->prefetch_task, &stream->prefetch_task_lock);
+  stream->prefetch_downloader = gst_uri_downloader_new ();
+  GST_OBJECT_LOCK (demux);
+  if (demux->priv->source_pool)
+    stream->source_pool = gst_object_ref (demux->priv->source_pool);
+  GST_OBJECT_UNLOCK (demux);
+  gst_uri_downloader_set_source_pool (stream->prefetch_downloader,
+      stream->source_pool);
+  g_mutex_init (&stream->prefetch_lock);
+  g_cond_init (&stream->prefetch_cond);
+  g_queue_init (&stream->prefetch_queue);
+
   stream->pad = pad;
   stream->demux = demux;
   gst_pad_set_element_private (pad, stream);
@@ -1069,9 +1435,13 @@ gst_adaptive_demux_stream_new (GstAdaptiveDemux * demux, GstPad * pad)
       GST_DEBUG_FUNCPTR (gst_adaptive_demux_src_event));
 
   gst_segment_init (&stream->segment, GST_FORMAT_TIME);
+  stream->download_request_latency = -1;
   g_cond_init (&stream->fragment_download_cond);
   g_mutex_init (&stream->fragment_download_lock);
   stream->adapter = gst_adapter_new ();
+  stream->abr =
+      gst_adaptive_demux_abr_new (gst_adaptive_demux_abr_algorithm_get_funcs
+      (demux->abr_algorithm));
 
   demux->next_streams = g_list_append (demux->next_streams, stream);
 
@@ -1120,6 +1490,8 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
       stream->cancelled = TRUE;
       g_cond_signal (&stream->fragment_download_cond);
       g_mutex_unlock (&stream->fragment_download_lock);
+      if (stream->source_pool)
+        gst_uri_source_pool_cancel (stream->source_pool, stream);
     }
     GST_LOG_OBJECT (demux, "Waiting for task to finish");
 
@@ -1136,6 +1508,31 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
     stream->download_task = NULL;
   }
 
+  if (stream->prefetch_task) {
+    g_mutex_lock (&stream->prefetch_lock);
+    stream->prefetch_cancelled = TRUE;
+    gst_task_stop (stream->prefetch_task);
+    g_cond_broadcast (&stream->prefetch_cond);
+    g_mutex_unlock (&stream->prefetch_lock);
+    gst_uri_downloader_cancel (stream->prefetch_downloader);
+
+    /* temporarily drop the manifest lock to join the task */
+    GST_MANIFEST_UNLOCK (demux);
+
+    gst_task_join (stream->prefetch_task);
+
+    GST_MANIFEST_LOCK (demux);
+
+    gst_object_unref (stream->prefetch_task);
+    g_rec_mutex_clear (&stream->prefetch_task_lock);
+    stream->prefetch_task = NULL;
+  }
+  gst_adaptive_demux_stream_clear_prefetched (stream);
+  g_object_unref (stream->prefetch_downloader);
+  gst_adaptive_demux_abr_free (stream->abr);
+  g_mutex_clear (&stream->prefetch_lock);
+  g_cond_clear (&stream->prefetch_cond);
+
   gst_adaptive_demux_stream_fragment_clear (&stream->fragment);
 
   if (stream->pending_segment) {
@@ -1159,10 +1556,17 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
 
   if (stream->src) {
     gst_element_set_state (stream->src, GST_STATE_NULL);
+    if (stream->source_pool && stream->uri_handler)
+      gst_adaptive_demux_stream_release_source (stream);
     gst_bin_remove (GST_BIN_CAST (demux), stream->src);
     stream->src = NULL;
   }
 
+  if (stream->source_pool) {
+    gst_uri_source_pool_reset (stream->source_pool, stream);
+    gst_object_unref (stream->source_pool);
+  }
+
   g_cond_clear (&stream->fragment_download_cond);
   g_mutex_clear (&stream->fragment_download_lock);
 
@@ -1577,9 +1981,21 @@ gst_adaptive_demux_start_tasks (GstAdaptiveDemux * demux)
     g_mutex_lock (&stream->fragment_download_lock);
     stream->cancelled = FALSE;
     g_mutex_unlock (&stream->fragment_download_lock);
+    if (stream->source_pool)
+      gst_uri_source_pool_reset (stream->source_pool, stream);
 
     stream->last_ret = GST_FLOW_OK;
     gst_task_start (stream->download_task);
+
+    if (demux->prefetch_depth > 0
+        && GST_ADAPTIVE_DEMUX_GET_CLASS (demux)->stream_peek_fragment_info) {
+      g_mutex_lock (&stream->prefetch_lock);
+      stream->prefetch_cancelled = FALSE;
+      g_mutex_unlock (&stream->prefetch_lock);
+
+      gst_uri_downloader_reset (stream->prefetch_downloader);
+      gst_task_start (stream->prefetch_task);
+    }
   }
 }
 
@@ -1611,6 +2027,15 @@ gst_adaptive_demux_stop_tasks (GstAdaptiveDemux * demux)
     gst_task_stop (stream->download_task);
     g_cond_signal (&stream->fragment_download_cond);
     g_mutex_unlock (&stream->fragment_download_lock);
+    if (stream->source_pool)
+      gst_uri_source_pool_cancel (stream->source_pool, stream);
+
+    g_mutex_lock (&stream->prefetch_lock);
+    stream->prefetch_cancelled = TRUE;
+    gst_task_stop (stream->prefetch_task);
+    g_cond_broadcast (&stream->prefetch_cond);
+    g_mutex_unlock (&stream->prefetch_lock);
+    gst_uri_downloader_cancel (stream->prefetch_downloader);
   }
 
   g_mutex_lock (&demux->priv->manifest_update_lock);
@@ -1636,6 +2061,7 @@ gst_adaptive_demux_stop_tasks (GstAdaptiveDemux * demux)
      * outside critical section
      */
     gst_task_join (stream->download_task);
+    gst_task_join (stream->prefetch_task);
 
     GST_MANIFEST_LOCK (demux);
   }
@@ -1655,6 +2081,7 @@ gst_adaptive_demux_stop_tasks (GstAdaptiveDemux * demux)
     stream->download_error_count = 0;
     stream->need_header = TRUE;
     gst_adapter_clear (stream->adapter);
+    gst_adaptive_demux_stream_clear_prefetched (stream);
   }
 }
 
@@ -1706,24 +2133,112 @@ gst_adaptive_demux_stream_queue_event (GstAdaptiveDemuxStream * stream,
   stream->pending_events = g_list_append (stream->pending_events, event);
 }
 
+/* Time in microseconds used for the download statistics */
+static gint64
+gst_adaptive_demux_get_monotonic_time (GstAdaptiveDemux * demux)
+{
+  return GST_TIME_AS_USECONDS (gst_clock_get_time (demux->priv->realtime_clock));
+}
+
+/* Returns how much of the media pushed by the stream is not played yet
+ *
+ * must be called with manifest_lock taken */
+static GstClockTime
+gst_adaptive_demux_stream_get_buffer_level (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream)
+{
+  GstElement *element = GST_ELEMENT_CAST (demux);
+  GstClockTime pushed, running_time = 0;
+  GstClock *clock = NULL;
+
+  GST_ADAPTIVE_DEMUX_SEGMENT_LOCK (demux);
+  pushed = gst_segment_to_running_time (&stream->segment, GST_FORMAT_TIME,
+      stream->segment.position);
+  GST_ADAPTIVE_DEMUX_SEGMENT_UNLOCK (demux);
+
+  if (!GST_CLOCK_TIME_IS_VALID (pushed))
+    return 0;
+
+  GST_OBJECT_LOCK (demux);
+  if (GST_STATE (element) == GST_STATE_PLAYING && element->clock) {
+    clock = gst_object_ref (element->clock);
+    running_time = element->base_time;
+  } else if (GST_CLOCK_TIME_IS_VALID (GST_ELEMENT_START_TIME (element))) {
+    /* paused, the running time doesn't advance */
+    running_time = GST_ELEMENT_START_TIME (element);
+  }
+  GST_OBJECT_UNLOCK (demux);
+
+  if (clock) {
+    GstClockTime now = gst_clock_get_time (clock);
+
+    running_time = now > running_time ? now - running_time : 0;
+    gst_object_unref (clock);
+  }
+
+  return pushed > running_time ? pushed - running_time : 0;
+}
+
+static gint
+gst_adaptive_demux_compare_bitrate (const guint64 * a, const guint64 * b)
+{
+  if (*a < *b)
+    return -1;
+  return *a > *b ? 1 : 0;
+}
+
 /* must be called with manifest_lock taken */
 static guint64
 gst_adaptive_demux_stream_update_current_bitrate (GstAdaptiveDemux * demux,
     GstAdaptiveDemuxStream * stream)
 {
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  const GstAdaptiveDemuxAbrFuncs *funcs =
+      gst_adaptive_demux_abr_algorithm_get_funcs (demux->abr_algorithm);
+  GstAdaptiveDemuxAbrInput input = { NULL, };
+  GArray *bitrates = NULL;
   guint64 bitrate;
 
+  /* the abr-algorithm property was changed */
+  if (stream->abr->funcs != funcs) {
+    GST_DEBUG_OBJECT (stream->pad, "Switching to the %s ABR algorithm",
+        funcs->name);
+    gst_adaptive_demux_abr_free (stream->abr);
+    stream->abr = gst_adaptive_demux_abr_new (funcs);
+  }
+
   if (demux->connection_speed) {
+    stream->current_download_rate = stream->abr->estimate;
     GST_LOG_OBJECT (demux, "Connection-speed is set to %u kbps, using it",
         demux->connection_speed / 1000);
     return demux->connection_speed;
   }
 
-  g_object_get (stream->queue, "avg-in-rate", &bitrate, NULL);
-  bitrate *= 8;
-  GST_DEBUG_OBJECT (demux, "Download bitrate is : %" G_GUINT64_FORMAT " bps",
-      bitrate);
-  stream->current_download_rate = bitrate;
+  if (klass->stream_get_bitrates)
+    bitrates = klass->stream_get_bitrates (stream);
+  if (bitrates) {
+    g_array_sort (bitrates, (GCompareFunc) gst_adaptive_demux_compare_bitrate);
+    input.bitrates = (const guint64 *) bitrates->data;
+    input.n_bitrates = bitrates->len;
+  }
+  input.buffer_level =
+      gst_adaptive_demux_stream_get_buffer_level (demux, stream);
+  input.buffer_target = demux->abr_buffer_target;
+  input.bitrate_limit = demux->bitrate_limit;
+  g_object_get (stream->queue, "avg-in-rate", &input.input_rate, NULL);
+  input.input_rate *= 8;
+
+  bitrate = gst_adaptive_demux_abr_get_bitrate (stream->abr, &input);
+  stream->current_download_rate = stream->abr->estimate;
+
+  GST_DEBUG_OBJECT (stream->pad, "Download bitrate is %" G_GUINT64_FORMAT
+      " bps, buffered %" GST_TIME_FORMAT ", %s selects %" G_GUINT64_FORMAT
+      " bps", stream->current_download_rate,
+      GST_TIME_ARGS (input.buffer_level), stream->abr->funcs->name, bitrate);
+
+  if (bitrates)
+    g_array_unref (bitrates);
+
   return bitrate;
 }
 
@@ -1926,31 +2441,16 @@ gst_adaptive_demux_stream_data_received_default (GstAdaptiveDemux * demux,
   return gst_adaptive_demux_stream_push_buffer (stream, buffer);
 }
 
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock
+ */
 static GstFlowReturn
-_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+gst_adaptive_demux_stream_chain_buffer (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, GstBuffer * buffer)
 {
-  GstAdaptiveDemuxStream *stream;
-  GstAdaptiveDemux *demux;
-  GstAdaptiveDemuxClass *klass;
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
   GstFlowReturn ret = GST_FLOW_OK;
 
-  demux = GST_ADAPTIVE_DEMUX_CAST (parent);
-  stream = gst_pad_get_element_private (pad);
-  klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
-
-  GST_MANIFEST_LOCK (demux);
-
-  /* do not make any changes if the stream is cancelled */
-  g_mutex_lock (&stream->fragment_download_lock);
-  if (G_UNLIKELY (stream->cancelled)) {
-    g_mutex_unlock (&stream->fragment_download_lock);
-    gst_buffer_unref (buffer);
-    ret = stream->last_ret = GST_FLOW_FLUSHING;
-    GST_MANIFEST_UNLOCK (demux);
-    return ret;
-  }
-  g_mutex_unlock (&stream->fragment_download_lock);
-
   if (stream->starting_fragment) {
     GstClockTime offset =
         gst_adaptive_demux_stream_get_presentation_offset (demux, stream);
@@ -1960,8 +2460,8 @@ _src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     stream->starting_fragment = FALSE;
     if (klass->start_fragment) {
       if (!klass->start_fragment (demux, stream)) {
-        ret = GST_FLOW_ERROR;
-        goto error;
+        gst_buffer_unref (buffer);
+        return GST_FLOW_ERROR;
       }
     }
 
@@ -1994,11 +2494,16 @@ _src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     stream->downloading_first_buffer = FALSE;
 
     if (!stream->downloading_header && !stream->downloading_index) {
+      if (stream->download_request_latency < 0)
+        stream->download_request_latency =
+            gst_adaptive_demux_get_monotonic_time (demux) -
+            stream->download_start_time;
+
       /* If this is the first buffer of a fragment (not the headers or index)
        * and we don't have a birate from the sub-class, then see if we
        * can work it out from the fragment size and duration */
       if (stream->fragment.bitrate == 0 &&
-          stream->fragment.duration != 0 &&
+          stream->fragment.duration != 0 && stream->uri_handler &&
           gst_element_query_duration (stream->uri_handler, GST_FORMAT_BYTES,
               &chunk_size)) {
         guint bitrate = MIN (G_MAXUINT, gst_util_uint64_scale (chunk_size,
@@ -2017,8 +2522,8 @@ _src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     }
   }
 
-  stream->download_total_time +=
-      g_get_monotonic_time () - stream->download_chunk_start_time;
+  stream->download_total_time += gst_adaptive_demux_get_monotonic_time (demux)
+      - stream->download_chunk_start_time;
   stream->download_total_bytes += gst_buffer_get_size (buffer);
 
   gst_adapter_push (stream->adapter, buffer);
@@ -2033,13 +2538,12 @@ _src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     g_mutex_lock (&stream->fragment_download_lock);
     if (G_UNLIKELY (stream->cancelled)) {
       g_mutex_unlock (&stream->fragment_download_lock);
-      GST_MANIFEST_UNLOCK (demux);
       return ret;
     }
     g_mutex_unlock (&stream->fragment_download_lock);
   }
 
-  stream->download_chunk_start_time = g_get_monotonic_time ();
+  stream->download_chunk_start_time = gst_adaptive_demux_get_monotonic_time (demux);
 
   if (ret != GST_FLOW_OK) {
     if (ret < GST_FLOW_EOS) {
@@ -2054,11 +2558,37 @@ _src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     }
 
     gst_adaptive_demux_stream_fragment_download_finish (stream, ret, NULL);
-    if (ret == (GstFlowReturn) GST_ADAPTIVE_DEMUX_FLOW_SWITCH)
-      ret = GST_FLOW_EOS;       /* return EOS to make the source stop */
   }
 
-error:
+  return ret;
+}
+
+static GstFlowReturn
+_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstAdaptiveDemuxStream *stream;
+  GstAdaptiveDemux *demux;
+  GstFlowReturn ret;
+
+  demux = GST_ADAPTIVE_DEMUX_CAST (parent);
+  stream = gst_pad_get_element_private (pad);
+
+  GST_MANIFEST_LOCK (demux);
+
+  /* do not make any changes if the stream is cancelled */
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    gst_buffer_unref (buffer);
+    ret = stream->last_ret = GST_FLOW_FLUSHING;
+    GST_MANIFEST_UNLOCK (demux);
+    return ret;
+  }
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  ret = gst_adaptive_demux_stream_chain_buffer (demux, stream, buffer);
+  if (ret == (GstFlowReturn) GST_ADAPTIVE_DEMUX_FLOW_SWITCH)
+    ret = GST_FLOW_EOS;         /* return EOS to make the source stop */
 
   GST_MANIFEST_UNLOCK (demux);
 
@@ -2201,7 +2731,66 @@ gst_adaptive_demux_stream_queue_overrun (GstElement * queue, gpointer user_data)
       "Queue overrun! The fragment to download is too big according to the current queue size limit");
 }
 
-/* must be called with manifest_lock taken */
+/* Links @uri_handler to the queue of the source bin */
+static gboolean
+gst_adaptive_demux_stream_plug_source (GstAdaptiveDemuxStream * stream,
+    GstElement * uri_handler)
+{
+  GstPad *uri_handler_src;
+  GstPad *queue_sink;
+  GstPadLinkReturn pad_link_ret;
+
+  gst_bin_add (GST_BIN_CAST (stream->src), uri_handler);
+
+  uri_handler_src = gst_element_get_static_pad (uri_handler, "src");
+  queue_sink = gst_element_get_static_pad (stream->queue, "sink");
+
+  pad_link_ret =
+      gst_pad_link_full (uri_handler_src, queue_sink,
+      GST_PAD_LINK_CHECK_NOTHING);
+  if (GST_PAD_LINK_FAILED (pad_link_ret)) {
+    GST_WARNING_OBJECT (stream->demux,
+        "Could not link pads %s:%s to %s:%s for reason %d",
+        GST_DEBUG_PAD_NAME (uri_handler_src), GST_DEBUG_PAD_NAME (queue_sink),
+        pad_link_ret);
+    g_object_unref (queue_sink);
+    g_object_unref (uri_handler_src);
+    return FALSE;
+  }
+
+  g_object_unref (queue_sink);
+  g_object_unref (uri_handler_src);
+  stream->uri_handler = uri_handler;
+
+  return TRUE;
+}
+
+/* Gives the uri_handler back to the source pool, so that the next download
+ * from the same server can reuse its connection. It must not be running */
+static void
+gst_adaptive_demux_stream_release_source (GstAdaptiveDemuxStream * stream)
+{
+  GstElement *uri_handler = stream->uri_handler;
+  GstPad *uri_handler_src, *peer;
+
+  stream->uri_handler = NULL;
+
+  uri_handler_src = gst_element_get_static_pad (uri_handler, "src");
+  peer = gst_pad_get_peer (uri_handler_src);
+  if (peer) {
+    gst_pad_unlink (uri_handler_src, peer);
+    gst_object_unref (peer);
+  }
+  gst_object_unref (uri_handler_src);
+
+  gst_object_ref (uri_handler);
+  gst_bin_remove (GST_BIN_CAST (stream->src), uri_handler);
+  gst_uri_source_pool_release (stream->source_pool, uri_handler);
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock while waiting for a source element
+ * from the pool */
 static gboolean
 gst_adaptive_demux_stream_update_source (GstAdaptiveDemuxStream * stream,
     const gchar * uri, const gchar * referer, gboolean refresh,
@@ -2214,7 +2803,11 @@ gst_adaptive_demux_stream_update_source (GstAdaptiveDemuxStream * stream,
     return FALSE;
   }
 
-  if (stream->src != NULL) {
+  /* the pool gives us an element for the right server */
+  if (stream->source_pool && stream->uri_handler)
+    gst_adaptive_demux_stream_release_source (stream);
+
+  if (stream->src != NULL && stream->uri_handler != NULL) {
     gchar *old_protocol, *new_protocol;
     gchar *old_uri;
 
@@ -2228,6 +2821,7 @@ gst_adaptive_demux_stream_update_source (GstAdaptiveDemuxStream * stream,
       gst_bin_remove (GST_BIN_CAST (demux), stream->src);
       stream->src = NULL;
       stream->src_srcpad = NULL;
+      stream->uri_handler = NULL;
       GST_DEBUG_OBJECT (demux, "Can't re-use old source element");
     } else {
       GError *err = NULL;
@@ -2243,6 +2837,7 @@ gst_adaptive_demux_stream_update_source (GstAdaptiveDemuxStream * stream,
         gst_bin_remove (GST_BIN_CAST (demux), stream->src);
         stream->src = NULL;
         stream->src_srcpad = NULL;
+        stream->uri_handler = NULL;
       }
     }
     g_free (old_uri);
@@ -2251,13 +2846,8 @@ gst_adaptive_demux_stream_update_source (GstAdaptiveDemuxStream * stream,
   }
 
   if (stream->src == NULL) {
-    GstPad *uri_handler_src;
-    GstPad *queue_sink;
     GstPad *queue_src;
-    GstElement *uri_handler;
     GstElement *queue;
-    GstPadLinkReturn pad_link_ret;
-    GObjectClass *gobject_class;
     gchar *internal_name, *bin_name;
 
     /* Our src consists of a bin containing uri_handler -> queue2 . The
@@ -2275,11 +2865,71 @@ gst_adaptive_demux_stream_update_source (GstAdaptiveDemuxStream * stream,
     g_signal_connect (queue, "overrun",
         G_CALLBACK (gst_adaptive_demux_stream_queue_overrun), stream);
 
-    uri_handler = gst_element_make_from_uri (GST_URI_SRC, uri, NULL, NULL);
+    /* Source bin creation */
+    bin_name = g_strdup_printf ("srcbin-%s", GST_PAD_NAME (stream->pad));
+    stream->src = gst_bin_new (bin_name);
+    g_free (bin_name);
+    if (stream->src == NULL) {
+      gst_object_unref (queue);
+      return FALSE;
+    }
+
+    gst_bin_add (GST_BIN_CAST (stream->src), queue);
+    stream->queue = queue;
+
+    queue_src = gst_element_get_static_pad (queue, "src");
+    stream->src_srcpad = gst_ghost_pad_new ("src", queue_src);
+    g_object_unref (queue_src);
+    gst_element_add_pad (stream->src, stream->src_srcpad);
+
+    gst_element_set_locked_state (stream->src, TRUE);
+    gst_bin_add (GST_BIN_CAST (demux), stream->src);
+    stream->src_srcpad = gst_element_get_static_pad (stream->src, "src");
+
+    /* set up our internal floating pad to drop all events from
+     * the http src we don't care about. On the chain function
+     * we just push the buffer forward */
+    internal_name = g_strdup_printf ("internal-%s", GST_PAD_NAME (stream->pad));
+    stream->internal_pad = gst_pad_new (internal_name, GST_PAD_SINK);
+    g_free (internal_name);
+    gst_object_set_parent (GST_OBJECT_CAST (stream->internal_pad),
+        GST_OBJECT_CAST (demux));
+    GST_OBJECT_FLAG_SET (stream->internal_pad, GST_PAD_FLAG_NEED_PARENT);
+    gst_pad_set_element_private (stream->internal_pad, stream);
+    gst_pad_set_active (stream->internal_pad, TRUE);
+    gst_pad_set_chain_function (stream->internal_pad, _src_chain);
+    gst_pad_set_event_function (stream->internal_pad, _src_event);
+    gst_pad_set_query_function (stream->internal_pad, _src_query);
+
+    if (gst_pad_link_full (stream->src_srcpad, stream->internal_pad,
+            GST_PAD_LINK_CHECK_NOTHING) != GST_PAD_LINK_OK) {
+      GST_ERROR_OBJECT (stream->pad, "Failed to link internal pad");
+      return FALSE;
+    }
+  }
+
+  if (stream->uri_handler == NULL) {
+    GstElement *uri_handler;
+    GObjectClass *gobject_class;
+
+    if (stream->source_pool) {
+      /* don't block the other streams while waiting for a free element */
+      GST_MANIFEST_UNLOCK (demux);
+      uri_handler = gst_uri_source_pool_acquire (stream->source_pool, uri,
+          stream);
+      GST_MANIFEST_LOCK (demux);
+
+      if (uri_handler == NULL) {
+        GST_DEBUG_OBJECT (stream->pad, "Didn't get a source element for %s",
+            uri);
+        return FALSE;
+      }
+    } else {
+      uri_handler = gst_element_make_from_uri (GST_URI_SRC, uri, NULL, NULL);
+    }
     if (uri_handler == NULL) {
       GST_ELEMENT_ERROR (demux, CORE, MISSING_PLUGIN,
           ("Missing plugin to handle URI: '%s'", uri), (NULL));
-      gst_object_unref (queue);
       return FALSE;
     }
 
@@ -2312,75 +2962,552 @@ gst_adaptive_demux_stream_update_source (GstAdaptiveDemuxStream * stream,
       }
     }
 
-    /* Source bin creation */
-    bin_name = g_strdup_printf ("srcbin-%s", GST_PAD_NAME (stream->pad));
-    stream->src = gst_bin_new (bin_name);
-    g_free (bin_name);
-    if (stream->src == NULL) {
-      gst_object_unref (queue);
-      gst_object_unref (uri_handler);
+    if (!gst_adaptive_demux_stream_plug_source (stream, uri_handler)) {
+      gst_bin_remove (GST_BIN_CAST (stream->src), uri_handler);
+      if (stream->source_pool)
+        gst_uri_source_pool_release (stream->source_pool, uri_handler);
       return FALSE;
     }
+    /* the bin holds a reference to it now */
+    if (stream->source_pool)
+      gst_object_unref (uri_handler);
+  }
+  return TRUE;
+}
 
-    gst_bin_add (GST_BIN_CAST (stream->src), queue);
-    gst_bin_add (GST_BIN_CAST (stream->src), uri_handler);
-
-    uri_handler_src = gst_element_get_static_pad (uri_handler, "src");
-    queue_sink = gst_element_get_static_pad (queue, "sink");
-
-    pad_link_ret =
-        gst_pad_link_full (uri_handler_src, queue_sink,
-        GST_PAD_LINK_CHECK_NOTHING);
-    if (GST_PAD_LINK_FAILED (pad_link_ret)) {
-      GST_WARNING_OBJECT (demux,
-          "Could not link pads %s:%s to %s:%s for reason %d",
-          GST_DEBUG_PAD_NAME (uri_handler_src), GST_DEBUG_PAD_NAME (queue_sink),
-          pad_link_ret);
-      g_object_unref (queue_sink);
-      g_object_unref (uri_handler_src);
-      gst_object_unref (stream->src);
-      stream->src = NULL;
-      return FALSE;
-    }
+static void
+gst_adaptive_demux_prefetch_free (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  g_free (prefetch->uri);
+  if (prefetch->buffers)
+    gst_buffer_list_unref (prefetch->buffers);
+  g_free (prefetch);
+}
 
-    g_object_unref (queue_sink);
-    g_object_unref (uri_handler_src);
-    queue_src = gst_element_get_static_pad (queue, "src");
-    stream->src_srcpad = gst_ghost_pad_new ("src", queue_src);
-    g_object_unref (queue_src);
-    gst_element_add_pad (stream->src, stream->src_srcpad);
+/* must be called with prefetch_lock taken */
+static GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_stream_find_prefetched (GstAdaptiveDemuxStream * stream,
+    const gchar * uri, gint64 range_start, gint64 range_end)
+{
+  GList *iter;
 
-    gst_element_set_locked_state (stream->src, TRUE);
-    gst_bin_add (GST_BIN_CAST (demux), stream->src);
-    stream->src_srcpad = gst_element_get_static_pad (stream->src, "src");
+  for (iter = stream->prefetch_queue.head; iter; iter = iter->next) {
+    GstAdaptiveDemuxPrefetch *prefetch = iter->data;
 
-    /* set up our internal floating pad to drop all events from
-     * the http src we don't care about. On the chain function
-     * we just push the buffer forward */
-    internal_name = g_strdup_printf ("internal-%s", GST_PAD_NAME (stream->pad));
-    stream->internal_pad = gst_pad_new (internal_name, GST_PAD_SINK);
-    g_free (internal_name);
-    gst_object_set_parent (GST_OBJECT_CAST (stream->internal_pad),
-        GST_OBJECT_CAST (demux));
-    GST_OBJECT_FLAG_SET (stream->internal_pad, GST_PAD_FLAG_NEED_PARENT);
-    gst_pad_set_element_private (stream->internal_pad, stream);
-    gst_pad_set_active (stream->internal_pad, TRUE);
-    gst_pad_set_chain_function (stream->internal_pad, _src_chain);
-    gst_pad_set_event_function (stream->internal_pad, _src_event);
-    gst_pad_set_query_function (stream->internal_pad, _src_query);
+    if (prefetch->range_start == range_start
+        && prefetch->range_end == range_end && g_str_equal (prefetch->uri, uri))
+      return prefetch;
+  }
 
-    if (gst_pad_link_full (stream->src_srcpad, stream->internal_pad,
-            GST_PAD_LINK_CHECK_NOTHING) != GST_PAD_LINK_OK) {
-      GST_ERROR_OBJECT (stream->pad, "Failed to link internal pad");
-      return FALSE;
+  return NULL;
+}
+
+/* Must only be called while the prefetch task is not running */
+static void
+gst_adaptive_demux_stream_clear_prefetched (GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  g_mutex_lock (&stream->prefetch_lock);
+  while ((prefetch = g_queue_pop_head (&stream->prefetch_queue)))
+    gst_adaptive_demux_prefetch_free (prefetch);
+  stream->prefetch_bytes = 0;
+  g_mutex_unlock (&stream->prefetch_lock);
+}
+
+/* wakes up the prefetch task to check for new fragments to download */
+static void
+gst_adaptive_demux_stream_wake_prefetch (GstAdaptiveDemuxStream * stream)
+{
+  g_mutex_lock (&stream->prefetch_lock);
+  g_cond_broadcast (&stream->prefetch_cond);
+  g_mutex_unlock (&stream->prefetch_lock);
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock.
+ * Returns the data of @uri if it was downloaded ahead of time, waiting for
+ * a prefetch that is still in progress, or NULL if it has to be downloaded
+ */
+static GstBufferList *
+gst_adaptive_demux_stream_take_prefetched (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, const gchar * uri, gint64 range_start,
+    gint64 range_end, gint64 * download_time)
+{
+  GstAdaptiveDemuxPrefetch *prefetch;
+  GstBufferList *buffers = NULL;
+
+  g_mutex_lock (&stream->prefetch_lock);
+  prefetch = gst_adaptive_demux_stream_find_prefetched (stream, uri,
+      range_start, range_end);
+  if (prefetch == NULL) {
+    g_mutex_unlock (&stream->prefetch_lock);
+    return NULL;
+  }
+
+  if (prefetch->downloading) {
+    GST_DEBUG_OBJECT (stream->pad, "Waiting for prefetch of %s", uri);
+
+    GST_MANIFEST_UNLOCK (demux);
+    while (prefetch->downloading && !stream->prefetch_cancelled)
+      g_cond_wait (&stream->prefetch_cond, &stream->prefetch_lock);
+    g_mutex_unlock (&stream->prefetch_lock);
+
+    GST_MANIFEST_LOCK (demux);
+    g_mutex_lock (&stream->prefetch_lock);
+    prefetch = gst_adaptive_demux_stream_find_prefetched (stream, uri,
+        range_start, range_end);
+    if (stream->prefetch_cancelled || prefetch == NULL) {
+      g_mutex_unlock (&stream->prefetch_lock);
+      return NULL;
     }
+  }
 
-    stream->uri_handler = uri_handler;
-    stream->queue = queue;
+  g_queue_remove (&stream->prefetch_queue, prefetch);
+  stream->prefetch_bytes -= prefetch->size;
+  if (prefetch->buffers) {
+    buffers = prefetch->buffers;
+    prefetch->buffers = NULL;
+    *download_time = prefetch->download_time;
+  }
+  g_cond_broadcast (&stream->prefetch_cond);
+  g_mutex_unlock (&stream->prefetch_lock);
+
+  GST_DEBUG_OBJECT (stream->pad, "Prefetch of %s %s", uri,
+      buffers ? "available" : "failed");
+  gst_adaptive_demux_prefetch_free (prefetch);
+
+  return buffers;
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock.
+ * Returns the key at @key_uri if the prefetch task downloaded it while the
+ * previous fragments were downloading, or NULL if the subclass has to
+ * download it itself */
+GstBuffer *
+gst_adaptive_demux_stream_take_prefetched_key (GstAdaptiveDemuxStream * stream,
+    const gchar * key_uri)
+{
+  GstBufferList *buffers;
+  GstBuffer *buffer;
+  gint64 download_time;
+  guint i;
+
+  buffers = gst_adaptive_demux_stream_take_prefetched (stream->demux, stream,
+      key_uri, 0, -1, &download_time);
+  if (buffers == NULL)
+    return NULL;
+
+  /* Keys are tiny, a single buffer is more convenient for the caller */
+  buffer = gst_buffer_new ();
+  for (i = 0; i < gst_buffer_list_length (buffers); i++)
+    gst_buffer_copy_into (buffer, gst_buffer_list_get (buffers, i),
+        GST_BUFFER_COPY_MEMORY, 0, -1);
+  gst_buffer_list_unref (buffers);
+
+  return buffer;
+}
+
+static gsize
+gst_adaptive_demux_buffer_list_get_size (GstBufferList * buffers)
+{
+  gsize size = 0;
+  guint i;
+
+  for (i = 0; i < gst_buffer_list_length (buffers); i++)
+    size += gst_buffer_get_size (gst_buffer_list_get (buffers, i));
+
+  return size;
+}
+
+typedef struct
+{
+  GstAdaptiveDemux *demux;
+  GstAdaptiveDemuxStream *stream;
+  GstFlowReturn ret;
+} GstAdaptiveDemuxPrefetchPush;
+
+static gboolean
+gst_adaptive_demux_stream_push_prefetched_buffer (GstBuffer ** buffer,
+    guint idx, gpointer user_data)
+{
+  GstAdaptiveDemuxPrefetchPush *push = user_data;
+
+  /* Hand the reference of the list over, the first buffer gets the
+   * timestamp of the fragment */
+  push->ret = gst_adaptive_demux_stream_chain_buffer (push->demux,
+      push->stream, *buffer);
+  *buffer = NULL;
+
+  return push->ret == GST_FLOW_OK;
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock.
+ * Pushes a prefetched fragment, header or index as if it was downloaded
+ * by the source element now */
+static GstFlowReturn
+gst_adaptive_demux_stream_push_prefetched (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, GstBufferList * buffers,
+    gint64 download_time)
+{
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  GstAdaptiveDemuxPrefetchPush push = { demux, stream, GST_FLOW_OK };
+  GstFlowReturn ret;
+
+  /* Account for the time it actually took to download the data */
+  stream->download_start_time =
+      gst_adaptive_demux_get_monotonic_time (demux) - download_time;
+  stream->download_chunk_start_time = stream->download_start_time;
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  stream->download_finished = FALSE;
+  stream->downloading_first_buffer = TRUE;
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  if (!stream->downloading_header && !stream->downloading_index
+      && stream->fragment.bitrate == 0 && stream->fragment.duration != 0) {
+    gsize size = gst_adaptive_demux_buffer_list_get_size (buffers);
+
+    stream->fragment.bitrate =
+        MIN (G_MAXUINT, gst_util_uint64_scale (size, 8 * GST_SECOND,
+            stream->fragment.duration));
+  }
+
+  /* Push the buffers as they were received, like the source element would
+   * have, instead of merging them into one */
+  buffers = gst_buffer_list_make_writable (buffers);
+  gst_buffer_list_foreach (buffers,
+      gst_adaptive_demux_stream_push_prefetched_buffer, &push);
+  gst_buffer_list_unref (buffers);
+  ret = push.ret;
+
+  /* The request was done by the prefetch task, its latency is unknown */
+  stream->download_request_latency = -1;
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    ret = stream->last_ret = GST_FLOW_FLUSHING;
+    g_mutex_unlock (&stream->fragment_download_lock);
+    return ret;
+  }
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  /* Errors have already finished the download, otherwise finish like
+   * on EOS from the source */
+  if (ret == GST_FLOW_OK) {
+    ret = klass->finish_fragment (demux, stream);
+    gst_adaptive_demux_stream_fragment_download_finish (stream, ret, NULL);
   }
+
+  return stream->last_ret;
+}
+
+/* must be called with manifest_lock and prefetch_lock taken.
+ * Returns how many bytes downloading @uri is expected to add to the cache.
+ * Fragments without a byte range are estimated from the bitrate of the
+ * current one or the size of the last prefetched one, headers and indexes
+ * without a range are small enough to be ignored */
+static gsize
+gst_adaptive_demux_stream_expected_size (GstAdaptiveDemuxStream * stream,
+    gint64 range_start, gint64 range_end, gboolean is_fragment)
+{
+  if (range_end != -1 && range_end >= range_start)
+    return range_end - range_start + 1;
+
+  if (!is_fragment)
+    return 0;
+
+  if (stream->fragment.bitrate != 0
+      && GST_CLOCK_TIME_IS_VALID (stream->fragment.duration))
+    return gst_util_uint64_scale (stream->fragment.duration,
+        stream->fragment.bitrate, 8 * GST_SECOND);
+
+  return stream->prefetch_last_size;
+}
+
+/* must be called with manifest_lock taken.
+ * Queues the first of @uri and its range that was not downloaded ahead
+ * yet, returns TRUE if a new prefetch was queued or the cache is full.
+ * The expected size of the download is accounted for right away so that
+ * the cache does not grow beyond its limit by the downloads in flight */
+static gboolean
+gst_adaptive_demux_stream_queue_prefetch (GstAdaptiveDemuxStream * stream,
+    const gchar * uri, gint64 range_start, gint64 range_end,
+    gboolean is_fragment, GstAdaptiveDemuxPrefetch ** queued)
+{
+  GstAdaptiveDemuxPrefetch *prefetch;
+  gsize expected_size;
+
+  if (uri == NULL)
+    return FALSE;
+
+  g_mutex_lock (&stream->prefetch_lock);
+  if (gst_adaptive_demux_stream_find_prefetched (stream, uri, range_start,
+          range_end)) {
+    g_mutex_unlock (&stream->prefetch_lock);
+    return FALSE;
+  }
+
+  expected_size = gst_adaptive_demux_stream_expected_size (stream,
+      range_start, range_end, is_fragment);
+
+  if (stream->prefetch_bytes + expected_size <= PREFETCH_MAX_BYTES) {
+    prefetch = g_new0 (GstAdaptiveDemuxPrefetch, 1);
+    prefetch->uri = g_strdup (uri);
+    prefetch->range_start = range_start;
+    prefetch->range_end = range_end;
+    prefetch->size = expected_size;
+    prefetch->is_fragment = is_fragment;
+    prefetch->downloading = TRUE;
+    stream->prefetch_bytes += expected_size;
+    g_queue_push_tail (&stream->prefetch_queue, prefetch);
+    *queued = prefetch;
+  }
+  g_mutex_unlock (&stream->prefetch_lock);
+
   return TRUE;
 }
 
+/* must be called with manifest_lock and prefetch_lock taken.
+ * Drops what is not within the current and next prefetch-depth fragments
+ * anymore, e.g. after a bitrate switch */
+static void
+gst_adaptive_demux_stream_prune_prefetched (GstAdaptiveDemuxStream * stream,
+    GList * wanted)
+{
+  GList *iter, *next;
+
+  for (iter = stream->prefetch_queue.head; iter; iter = next) {
+    GstAdaptiveDemuxPrefetch *prefetch = iter->data;
+    GList *w;
+
+    next = iter->next;
+    if (prefetch->downloading)
+      continue;
+
+    for (w = wanted; w; w = w->next) {
+      GstAdaptiveDemuxStreamFragment *f = w->data;
+
+      if ((f->uri && g_str_equal (f->uri, prefetch->uri)
+              && f->range_start == prefetch->range_start
+              && f->range_end == prefetch->range_end)
+          || (f->header_uri && g_str_equal (f->header_uri, prefetch->uri)
+              && f->header_range_start == prefetch->range_start
+              && f->header_range_end == prefetch->range_end)
+          || (f->index_uri && g_str_equal (f->index_uri, prefetch->uri)
+              && f->index_range_start == prefetch->range_start
+              && f->index_range_end == prefetch->range_end)
+          || (f->key_uri && g_str_equal (f->key_uri, prefetch->uri)
+              && prefetch->range_start == 0 && prefetch->range_end == -1))
+        break;
+    }
+
+    if (w == NULL) {
+      GST_DEBUG_OBJECT (stream->pad, "Dropping prefetch of %s", prefetch->uri);
+      stream->prefetch_bytes -= prefetch->size;
+      g_queue_delete_link (&stream->prefetch_queue, iter);
+      gst_adaptive_demux_prefetch_free (prefetch);
+    }
+  }
+}
+
+static void
+gst_adaptive_demux_stream_fragment_free (GstAdaptiveDemuxStreamFragment * f)
+{
+  gst_adaptive_demux_stream_fragment_clear (f);
+  g_free (f);
+}
+
+/* Downloads the keys, headers, index and data of the next prefetch-depth
+ * fragments one after another with a separate downloader, which keeps its
+ * connection open between the requests. The header, index and data of a
+ * fragment that are ranges of the same file, like with a DASH SegmentBase,
+ * are fetched with a single request. Large fragments of known size are
+ * split over parallel requests.
+ *
+ * this function will take the manifest_lock only to look up the following
+ * fragments and will release it while downloading
+ */
+static void
+gst_adaptive_demux_stream_prefetch_loop (GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemux *demux = stream->demux;
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  GstAdaptiveDemuxPrefetch *prefetch = NULL;
+  GstAdaptiveDemuxPrefetch *batch[3];
+  GstUriDownloaderRange ranges[3] = { {0} };
+  GList *wanted = NULL;
+  GError *err = NULL;
+  gchar *uri;
+  gint64 start_time, download_time;
+  gboolean done = FALSE;
+  gdouble rate;
+  guint n, n_batch = 0;
+
+  GST_MANIFEST_LOCK (demux);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    GST_MANIFEST_UNLOCK (demux);
+    return;
+  }
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  GST_ADAPTIVE_DEMUX_SEGMENT_LOCK (demux);
+  rate = demux->segment.rate;
+  GST_ADAPTIVE_DEMUX_SEGMENT_UNLOCK (demux);
+
+  /* Only plain forward playback is downloaded ahead. The current fragment
+   * is looked up too to not drop it before the download task took it */
+  if (rate == 1.0) {
+    for (n = 0; n <= demux->prefetch_depth; n++) {
+      GstAdaptiveDemuxStreamFragment *f =
+          g_new0 (GstAdaptiveDemuxStreamFragment, 1);
+
+      gst_adaptive_demux_stream_fragment_clear (f);
+      if (klass->stream_peek_fragment_info (stream, n, f) != GST_FLOW_OK) {
+        gst_adaptive_demux_stream_fragment_free (f);
+        break;
+      }
+      wanted = g_list_append (wanted, f);
+    }
+  }
+
+  g_mutex_lock (&stream->prefetch_lock);
+  gst_adaptive_demux_stream_prune_prefetched (stream, wanted);
+  g_mutex_unlock (&stream->prefetch_lock);
+
+  {
+    GList *iter;
+
+    /* the current fragment is downloaded by the download task */
+    for (iter = wanted ? wanted->next : NULL; iter && !done;
+        iter = iter->next) {
+      GstAdaptiveDemuxStreamFragment *f = iter->data;
+      struct
+      {
+        const gchar *uri;
+        gint64 range_start, range_end;
+      } parts[] = {
+        {f->header_uri, f->header_range_start, f->header_range_end},
+        {f->index_uri, f->index_range_start, f->index_range_end},
+        {f->uri, f->range_start, f->range_end}
+      };
+      guint i;
+
+      done = gst_adaptive_demux_stream_queue_prefetch (stream, f->key_uri,
+          0, -1, FALSE, &prefetch);
+      for (i = 0; i < G_N_ELEMENTS (parts) && !done; i++)
+        done = gst_adaptive_demux_stream_queue_prefetch (stream,
+            parts[i].uri, parts[i].range_start, parts[i].range_end,
+            i == G_N_ELEMENTS (parts) - 1, &prefetch);
+      if (prefetch == NULL)
+        continue;
+
+      /* the following parts in the same file go with the same request */
+      batch[n_batch++] = prefetch;
+      for (; i > 0 && i < G_N_ELEMENTS (parts); i++) {
+        GstAdaptiveDemuxPrefetch *next = NULL;
+
+        if (prefetch->range_end == -1 || parts[i].uri == NULL
+            || parts[i].range_end == -1
+            || !g_str_equal (parts[i].uri, prefetch->uri)
+            || !gst_adaptive_demux_stream_queue_prefetch (stream,
+                parts[i].uri, parts[i].range_start, parts[i].range_end,
+                i == G_N_ELEMENTS (parts) - 1, &next) || next == NULL)
+          break;
+        batch[n_batch++] = next;
+      }
+    }
+  }
+  g_list_free_full (wanted,
+      (GDestroyNotify) gst_adaptive_demux_stream_fragment_free);
+
+  GST_MANIFEST_UNLOCK (demux);
+
+  if (prefetch == NULL) {
+    gint64 end_time = g_get_monotonic_time () + PREFETCH_RETRY_INTERVAL;
+
+    /* Nothing to do until the stream advanced, the cache has space again
+     * or the manifest was updated */
+    g_mutex_lock (&stream->prefetch_lock);
+    if (!stream->prefetch_cancelled)
+      g_cond_wait_until (&stream->prefetch_cond, &stream->prefetch_lock,
+          end_time);
+    g_mutex_unlock (&stream->prefetch_lock);
+    return;
+  }
+
+  /* the prefetches are only freed by us or after this task was joined */
+  uri = prefetch->uri;
+  for (n = 0; n < n_batch; n++) {
+    ranges[n].range_start = batch[n]->range_start;
+    ranges[n].range_end = batch[n]->range_end;
+  }
+
+  GST_DEBUG_OBJECT (stream->pad, "Prefetching %s %" G_GINT64_FORMAT "-%"
+      G_GINT64_FORMAT " in %u parts", uri, ranges[0].range_start,
+      ranges[n_batch - 1].range_end, n_batch);
+
+  start_time = gst_adaptive_demux_get_monotonic_time (demux);
+  if (n_batch > 1) {
+    gst_uri_downloader_fetch_uri_ranges (stream->prefetch_downloader, uri,
+        NULL, FALSE, FALSE, TRUE, ranges, n_batch, &err);
+  } else if (prefetch->is_fragment) {
+    ranges[0].fragment = gst_uri_downloader_fetch_uri_parallel
+        (stream->prefetch_downloader, uri, NULL, FALSE, FALSE, TRUE,
+        ranges[0].range_start, ranges[0].range_end,
+        PREFETCH_PARALLEL_REQUESTS, &err);
+  } else {
+    ranges[0].fragment = gst_uri_downloader_fetch_uri_with_range
+        (stream->prefetch_downloader, uri, NULL, FALSE, FALSE, TRUE,
+        ranges[0].range_start, ranges[0].range_end, &err);
+  }
+  download_time = gst_adaptive_demux_get_monotonic_time (demux) - start_time;
+
+  g_mutex_lock (&stream->prefetch_lock);
+  for (n = 0; n < n_batch; n++) {
+    GstFragment *download = ranges[n].fragment;
+
+    prefetch = batch[n];
+    prefetch->downloading = FALSE;
+    stream->prefetch_bytes -= prefetch->size;
+    prefetch->size = 0;
+    if (download) {
+      /* Keep the buffers as received, merging them would copy the whole
+       * fragment */
+      prefetch->buffers = gst_fragment_get_buffer_list (download);
+      prefetch->download_time = download_time;
+      if (prefetch->buffers
+          && gst_buffer_list_length (prefetch->buffers) == 0) {
+        gst_buffer_list_unref (prefetch->buffers);
+        prefetch->buffers = NULL;
+      }
+      if (prefetch->buffers) {
+        prefetch->size =
+            gst_adaptive_demux_buffer_list_get_size (prefetch->buffers);
+        stream->prefetch_bytes += prefetch->size;
+        if (prefetch->is_fragment)
+          stream->prefetch_last_size = prefetch->size;
+      }
+      g_object_unref (download);
+    }
+    if (prefetch->buffers == NULL) {
+      /* Will be downloaded again by the download task */
+      GST_DEBUG_OBJECT (stream->pad, "Failed to prefetch %s: %s", uri,
+          err ? err->message : "no data");
+      prefetch->failed = TRUE;
+    }
+  }
+  g_cond_broadcast (&stream->prefetch_cond);
+  g_mutex_unlock (&stream->prefetch_lock);
+
+  g_clear_error (&err);
+}
+
 /* must be called with manifest_lock taken.
  * Can temporarily release manifest_lock
  */
@@ -2390,11 +3517,39 @@ gst_adaptive_demux_stream_download_uri (GstAdaptiveDemux * demux,
     gint64 end)
 {
   GstFlowReturn ret = GST_FLOW_OK;
+  GstBufferList *prefetched;
+  gint64 download_time = 0;
+
   GST_DEBUG_OBJECT (stream->pad, "Downloading uri: %s, range:%" G_GINT64_FORMAT
       " - %" G_GINT64_FORMAT, uri, start, end);
 
+  prefetched = gst_adaptive_demux_stream_take_prefetched (demux, stream, uri,
+      start, end, &download_time);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    if (prefetched)
+      gst_buffer_list_unref (prefetched);
+    ret = stream->last_ret = GST_FLOW_FLUSHING;
+    return ret;
+  }
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  if (prefetched) {
+    GST_DEBUG_OBJECT (stream->pad, "Using prefetched data for %s", uri);
+    return gst_adaptive_demux_stream_push_prefetched (demux, stream,
+        prefetched, download_time);
+  }
+
   if (!gst_adaptive_demux_stream_update_source (stream, uri, NULL, FALSE, TRUE)) {
-    ret = stream->last_ret = GST_FLOW_ERROR;
+    /* might have been cancelled while waiting for a source element */
+    g_mutex_lock (&stream->fragment_download_lock);
+    if (G_UNLIKELY (stream->cancelled))
+      ret = stream->last_ret = GST_FLOW_FLUSHING;
+    else
+      ret = stream->last_ret = GST_FLOW_ERROR;
+    g_mutex_unlock (&stream->fragment_download_lock);
     return ret;
   }
 
@@ -2421,8 +3576,9 @@ gst_adaptive_demux_stream_download_uri (GstAdaptiveDemux * demux,
     }
 
     if (G_LIKELY (stream->last_ret == GST_FLOW_OK)) {
-      stream->download_start_time = g_get_monotonic_time ();
-      stream->download_chunk_start_time = g_get_monotonic_time ();
+      stream->download_start_time =
+          gst_adaptive_demux_get_monotonic_time (demux);
+      stream->download_chunk_start_time = stream->download_start_time;
 
       /* src element is in state READY. Before we start it, we reset
        * download_finished
@@ -2486,6 +3642,9 @@ gst_adaptive_demux_stream_download_uri (GstAdaptiveDemux * demux,
   gst_element_set_state (stream->src, GST_STATE_READY);
 
   GST_MANIFEST_LOCK (demux);
+  if (stream->source_pool && stream->uri_handler)
+    gst_adaptive_demux_stream_release_source (stream);
+
   g_mutex_lock (&stream->fragment_download_lock);
   if (G_UNLIKELY (stream->cancelled)) {
     ret = stream->last_ret = GST_FLOW_FLUSHING;
@@ -3152,6 +4311,7 @@ gst_adaptive_demux_stream_advance_fragment_unlocked (GstAdaptiveDemux * demux,
 {
   GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
   GstFlowReturn ret;
+  GstStructure *stats;
 
   g_return_val_if_fail (klass->stream_advance_fragment != NULL, GST_FLOW_ERROR);
 
@@ -3159,18 +4319,44 @@ gst_adaptive_demux_stream_advance_fragment_unlocked (GstAdaptiveDemux * demux,
   g_clear_error (&stream->last_error);
 
   /* FIXME - url has no indication of byte ranges for subsegments */
-  gst_element_post_message (GST_ELEMENT_CAST (demux),
-      gst_message_new_element (GST_OBJECT_CAST (demux),
-          gst_structure_new (GST_ADAPTIVE_DEMUX_STATISTICS_MESSAGE_NAME,
-              "manifest-uri", G_TYPE_STRING,
-              demux->manifest_uri, "uri", G_TYPE_STRING,
-              stream->fragment.uri, "fragment-start-time",
-              GST_TYPE_CLOCK_TIME, stream->download_start_time,
-              "fragment-stop-time", GST_TYPE_CLOCK_TIME,
-              gst_util_get_timestamp (), "fragment-size", G_TYPE_UINT64,
-              stream->download_total_bytes, "fragment-download-time",
-              GST_TYPE_CLOCK_TIME,
-              stream->download_total_time * GST_USECOND, NULL)));
+  stats = gst_structure_new (GST_ADAPTIVE_DEMUX_STATISTICS_MESSAGE_NAME,
+      "manifest-uri", G_TYPE_STRING,
+      demux->manifest_uri, "uri", G_TYPE_STRING,
+      stream->fragment.uri, "fragment-start-time",
+      GST_TYPE_CLOCK_TIME, stream->download_start_time,
+      "fragment-stop-time", GST_TYPE_CLOCK_TIME,
+      gst_util_get_timestamp (), "fragment-size", G_TYPE_UINT64,
+      stream->download_total_bytes, "fragment-download-time",
+      GST_TYPE_CLOCK_TIME,
+      stream->download_total_time * GST_USECOND,
+      "stream", G_TYPE_STRING, GST_PAD_NAME (stream->pad),
+      "fragment-request-latency", GST_TYPE_CLOCK_TIME,
+      stream->download_request_latency >= 0 ?
+      stream->download_request_latency * GST_USECOND : GST_CLOCK_TIME_NONE,
+      "fragment-bitrate", G_TYPE_UINT, stream->fragment.bitrate,
+      "download-rate", G_TYPE_UINT64, stream->current_download_rate,
+      "buffer-level", GST_TYPE_CLOCK_TIME,
+      gst_adaptive_demux_stream_get_buffer_level (demux, stream), NULL);
+  gst_adaptive_demux_add_statistics (demux, stats);
+  if (demux->priv->post_statistics) {
+    gst_element_post_message (GST_ELEMENT_CAST (demux),
+        gst_message_new_element (GST_OBJECT_CAST (demux), stats));
+  } else {
+    gst_structure_free (stats);
+  }
+
+  if (stream->download_total_bytes > 0) {
+    GstAdaptiveDemuxAbrFragment stats;
+
+    stats.size = stream->download_total_bytes;
+    stats.download_time = stream->download_total_time * GST_USECOND;
+    stats.duration = duration;
+    stats.bitrate = stream->fragment.bitrate;
+    gst_adaptive_demux_abr_fragment_downloaded (stream->abr, &stats);
+  }
+  stream->download_total_bytes = 0;
+  stream->download_total_time = 0;
+  stream->download_request_latency = -1;
 
   /* Don't update to the end of the segment if in reverse playback */
   GST_ADAPTIVE_DEMUX_SEGMENT_LOCK (demux);
@@ -3199,7 +4385,10 @@ gst_adaptive_demux_stream_advance_fragment_unlocked (GstAdaptiveDemux * demux,
   }
 
   stream->download_start_time = stream->download_chunk_start_time =
-      g_get_monotonic_time ();
+      gst_adaptive_demux_get_monotonic_time (demux);
+
+  /* the following fragments changed, check what to download ahead */
+  gst_adaptive_demux_stream_wake_prefetch (stream);
 
   if (ret == GST_FLOW_OK) {
     if (gst_adaptive_demux_stream_select_bitrate (demux, stream,
@@ -3351,6 +4540,9 @@ gst_adaptive_demux_stream_fragment_clear (GstAdaptiveDemuxStreamFragment * f)
   f->index_uri = NULL;
   f->index_range_start = 0;
   f->index_range_end = -1;
+
+  g_free (f->key_uri);
+  f->key_uri = NULL;
 }
 
 /* must be called with manifest_lock taken */
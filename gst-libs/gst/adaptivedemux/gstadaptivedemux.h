@@ -25,6 +25,7 @@
 #include <gst/gst.h>
 #include <gst/base/gstadapter.h>
 #include <gst/uridownloader/gsturidownloader.h>
+#include <gst/adaptivedemux/gstadaptivedemuxabr.h>
 
 G_BEGIN_DECLS
 
@@ -68,6 +69,16 @@ G_BEGIN_DECLS
  *
  * Name of the ELEMENT type messages posted by dashdemux with statistics.
  *
+ * One message is posted after each fragment is downloaded, with the
+ * "manifest-uri", "uri", "fragment-start-time", "fragment-stop-time",
+ * "fragment-size" and "fragment-download-time" fields. They also carry the
+ * name of the source pad of the stream in "stream", the time between the
+ * request and the first byte of the fragment in "fragment-request-latency"
+ * (#GST_CLOCK_TIME_NONE when not measured, e.g. for prefetched fragments),
+ * the bitrate of the fragment in "fragment-bitrate", the estimated download
+ * rate in "download-rate" and the amount of data queued downstream in
+ * "buffer-level". The same structures are kept in the "statistics" property.
+ *
  * Since: 1.6
  */
 #define GST_ADAPTIVE_DEMUX_STATISTICS_MESSAGE_NAME "adaptive-streaming-statistics"
@@ -106,6 +117,10 @@ struct _GstAdaptiveDemuxStreamFragment
   gint64 index_range_start;
   gint64 index_range_end;
 
+  /* when a decryption key has to be downloaded, only set by
+   * stream_peek_fragment_info() so that the key is prefetched */
+  gchar *key_uri;
+
   /* Nominal bitrate as provided by
    * sub-class or calculated by base-class */
   guint bitrate;
@@ -148,6 +163,8 @@ struct _GstAdaptiveDemuxStream
   GstPad *src_srcpad;
   GstElement *uri_handler;
   GstElement *queue;
+  /* uri_handler is acquired from this pool for each download, if set */
+  GstUriSourcePool *source_pool;
   GMutex fragment_download_lock;
   GCond fragment_download_cond;
   gboolean download_finished;   /* protected by fragment_download_lock */
@@ -158,12 +175,30 @@ struct _GstAdaptiveDemuxStream
   gint64 download_chunk_start_time;
   gint64 download_total_time;
   gint64 download_total_bytes;
+  /* time until the first byte of the fragment, -1 if not measured */
+  gint64 download_request_latency;
   guint64 current_download_rate;
 
+  /* bitrate adaptation state, fed with the statistics of every fragment */
+  GstAdaptiveDemuxAbr *abr;
+
   GstAdaptiveDemuxStreamFragment fragment;
 
   guint download_error_count;
 
+  /* prefetching of the following fragments while the current one is
+   * downloaded and pushed */
+  GstTask *prefetch_task;
+  GRecMutex prefetch_task_lock;
+  GstUriDownloader *prefetch_downloader;
+  GMutex prefetch_lock;
+  GCond prefetch_cond;
+  GQueue prefetch_queue;        /* protected by prefetch_lock */
+  gsize prefetch_bytes;         /* protected by prefetch_lock, includes the
+                                 * expected size of downloads in flight */
+  gsize prefetch_last_size;     /* protected by prefetch_lock */
+  gboolean prefetch_cancelled;  /* protected by prefetch_lock */
+
   /* TODO check if used */
   gboolean eos;
 };
@@ -196,6 +231,9 @@ struct _GstAdaptiveDemux
   /* Properties */
   gfloat bitrate_limit;         /* limit of the available bitrate to use */
   guint connection_speed;
+  guint prefetch_depth;         /* number of fragments to download ahead */
+  GstAdaptiveDemuxAbrAlgorithm abr_algorithm;
+  GstClockTime abr_buffer_target;
 
   gboolean have_group_id;
   guint group_id;
@@ -338,6 +376,17 @@ struct _GstAdaptiveDemuxClass
    * Returns: #TRUE if the stream changed bitrate, #FALSE otherwise
    */
   gboolean      (*stream_select_bitrate) (GstAdaptiveDemuxStream * stream, guint64 bitrate);
+  /**
+   * stream_get_bitrates:
+   * @stream: #GstAdaptiveDemuxStream
+   *
+   * Optional. Requests the nominal bitrates of the alternates the stream can
+   * switch between. Needed by the buffer based bitrate adaptation algorithms.
+   *
+   * Returns: (transfer full): a #GArray of #guint64 bitrates in bits per
+   *          second, or %NULL if unknown
+   */
+  GArray *      (*stream_get_bitrates) (GstAdaptiveDemuxStream * stream);
   /**
    * stream_get_fragment_waiting_time:
    * @stream: #GstAdaptiveDemuxStream
@@ -420,6 +469,23 @@ struct _GstAdaptiveDemuxClass
    * selected period.
    */
   GstClockTime (*get_period_start_time) (GstAdaptiveDemux *demux);
+
+  /**
+   * stream_peek_fragment_info:
+   * @stream: #GstAdaptiveDemuxStream
+   * @n: how many fragments after the current one to look ahead
+   * @fragment: the #GstAdaptiveDemuxStreamFragment to fill
+   *
+   * Sets the information about the @n-th fragment after the current one to
+   * @fragment without advancing the stream, 0 being the current fragment.
+   * Used to download fragments ahead of time, optional. Only called during
+   * forward playback at normal rate, with the manifest lock taken. Must not
+   * modify the stream.
+   *
+   * Returns: #GST_FLOW_OK in success, #GST_FLOW_EOS if there is no such
+   *          fragment (yet).
+   */
+  GstFlowReturn (*stream_peek_fragment_info) (GstAdaptiveDemuxStream * stream, guint n, GstAdaptiveDemuxStreamFragment * fragment);
 };
 
 GType    gst_adaptive_demux_get_type (void);
@@ -444,6 +510,8 @@ gst_adaptive_demux_stream_advance_fragment (GstAdaptiveDemux * demux,
     GstAdaptiveDemuxStream * stream, GstClockTime duration);
 void gst_adaptive_demux_stream_queue_event (GstAdaptiveDemuxStream * stream,
     GstEvent * event);
+GstBuffer * gst_adaptive_demux_stream_take_prefetched_key (GstAdaptiveDemuxStream * stream,
+    const gchar * key_uri);
 
 G_END_DECLS
 
@@ -0,0 +1,395 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:gstadaptivedemuxabr
+ * @short_description: Bitrate adaptation algorithms for GstAdaptiveDemux
+ *
+ * A bitrate adaptation algorithm is a #GstAdaptiveDemuxAbrFuncs vtable.
+ * #GstAdaptiveDemux keeps one instance per stream, feeds it with the
+ * timing statistics of every downloaded fragment and asks it for the
+ * maximum bitrate of the next fragment. The subclass then selects the
+ * highest alternate below that bitrate.
+ *
+ * The provided algorithms are:
+ * - throughput: the average input rate measured by the queue of the
+ *               stream, unscaled. This is the estimation the base class
+ *               always used and stays the default.
+ * - ewma: the minimum of a fast and a slow exponentially weighted moving
+ *         average of the throughput, weighted by the download time and
+ *         scaled by the bitrate limit. Reacts quickly to drops of the
+ *         bandwidth and slowly to increases.
+ * - bola: selects the alternate from the amount of buffered media, using
+ *         the BOLA utility function. Falls back to the ewma estimation
+ *         while the buffer is filled initially and if no alternates are
+ *         known, and doesn't switch up to alternates above that
+ *         estimation to avoid oscillations.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "gstadaptivedemuxabr.h"
+
+/* half lives of the moving averages, in seconds of downloading */
+#define EWMA_FAST_HALF_LIFE 2.0
+#define EWMA_SLOW_HALF_LIFE 5.0
+/* fragments smaller than this don't give a meaningful throughput */
+#define EWMA_MIN_SAMPLE_BYTES 16000
+
+GType
+gst_adaptive_demux_abr_algorithm_get_type (void)
+{
+  static volatile gsize type = 0;
+  static const GEnumValue values[] = {
+    {GST_ADAPTIVE_DEMUX_ABR_THROUGHPUT, "Throughput of the last fragment",
+        "throughput"},
+    {GST_ADAPTIVE_DEMUX_ABR_EWMA, "Moving average of the throughput", "ewma"},
+    {GST_ADAPTIVE_DEMUX_ABR_BOLA, "Buffer occupancy based (BOLA)", "bola"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType _type =
+        g_enum_register_static ("GstAdaptiveDemuxAbrAlgorithm", values);
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
+
+static guint64
+gst_adaptive_demux_abr_fragment_throughput (const GstAdaptiveDemuxAbrFragment
+    * fragment)
+{
+  if (fragment->download_time == 0)
+    return 0;
+
+  return gst_util_uint64_scale (fragment->size, 8 * GST_SECOND,
+      fragment->download_time);
+}
+
+/* Returns the index of the highest bitrate not above @bitrate, or 0 */
+static guint
+gst_adaptive_demux_abr_find_index (const GstAdaptiveDemuxAbrInput * input,
+    guint64 bitrate)
+{
+  guint i;
+
+  for (i = input->n_bitrates; i > 1; i--) {
+    if (input->bitrates[i - 1] <= bitrate)
+      return i - 1;
+  }
+  return 0;
+}
+
+/* throughput */
+
+static guint64
+throughput_get_bitrate (GstAdaptiveDemuxAbr * abr,
+    const GstAdaptiveDemuxAbrInput * input)
+{
+  abr->estimate = input->input_rate;
+  return abr->estimate;
+}
+
+static const GstAdaptiveDemuxAbrFuncs throughput_funcs = {
+  "throughput",
+  sizeof (GstAdaptiveDemuxAbr),
+  NULL,
+  NULL,
+  throughput_get_bitrate
+};
+
+/* ewma */
+
+typedef struct
+{
+  gdouble alpha;
+  gdouble estimate;
+  gdouble total_weight;
+} EwmaAverage;
+
+typedef struct
+{
+  GstAdaptiveDemuxAbr abr;
+
+  EwmaAverage fast;
+  EwmaAverage slow;
+  gboolean have_sample;
+} EwmaAbr;
+
+static void
+ewma_average_init (EwmaAverage * average, gdouble half_life)
+{
+  average->alpha = exp (log (0.5) / half_life);
+  average->estimate = 0;
+  average->total_weight = 0;
+}
+
+static void
+ewma_average_sample (EwmaAverage * average, gdouble weight, gdouble value)
+{
+  gdouble adj_alpha = pow (average->alpha, weight);
+
+  average->estimate = value * (1 - adj_alpha) + adj_alpha * average->estimate;
+  average->total_weight += weight;
+}
+
+static gdouble
+ewma_average_get (EwmaAverage * average)
+{
+  /* compensate for the estimate starting at 0 */
+  return average->estimate / (1 - pow (average->alpha, average->total_weight));
+}
+
+static void
+ewma_reset (GstAdaptiveDemuxAbr * abr)
+{
+  EwmaAbr *ewma = (EwmaAbr *) abr;
+
+  ewma_average_init (&ewma->fast, EWMA_FAST_HALF_LIFE);
+  ewma_average_init (&ewma->slow, EWMA_SLOW_HALF_LIFE);
+  ewma->have_sample = FALSE;
+}
+
+static void
+ewma_fragment_downloaded (GstAdaptiveDemuxAbr * abr,
+    const GstAdaptiveDemuxAbrFragment * fragment)
+{
+  EwmaAbr *ewma = (EwmaAbr *) abr;
+  guint64 throughput = gst_adaptive_demux_abr_fragment_throughput (fragment);
+  gdouble weight;
+
+  if (throughput == 0)
+    return;
+
+  if (fragment->size < EWMA_MIN_SAMPLE_BYTES) {
+    /* better than nothing until there are real samples */
+    if (!ewma->have_sample)
+      abr->estimate = throughput;
+    return;
+  }
+
+  weight = (gdouble) fragment->download_time / GST_SECOND;
+  ewma_average_sample (&ewma->fast, weight, throughput);
+  ewma_average_sample (&ewma->slow, weight, throughput);
+  ewma->have_sample = TRUE;
+
+  abr->estimate =
+      MIN (ewma_average_get (&ewma->fast), ewma_average_get (&ewma->slow));
+}
+
+static guint64
+ewma_get_bitrate (GstAdaptiveDemuxAbr * abr,
+    const GstAdaptiveDemuxAbrInput * input)
+{
+  return abr->estimate * input->bitrate_limit;
+}
+
+static const GstAdaptiveDemuxAbrFuncs ewma_funcs = {
+  "ewma",
+  sizeof (EwmaAbr),
+  ewma_reset,
+  ewma_fragment_downloaded,
+  ewma_get_bitrate
+};
+
+/* bola
+ *
+ * The utility of alternate i with bitrate S_i is v_i = ln (S_i / S_0) + 1.
+ * For a buffer level Q the alternate maximizing
+ * (V * (v_i + gp) - Q) / S_i is selected, where V and gp are chosen so
+ * that the lowest alternate is used below the minimum buffer level of a
+ * third of the buffer target and the highest one at the buffer target.
+ */
+
+typedef struct
+{
+  EwmaAbr ewma;
+
+  gboolean steady;
+  guint64 last_bitrate;
+} BolaAbr;
+
+static void
+bola_reset (GstAdaptiveDemuxAbr * abr)
+{
+  BolaAbr *bola = (BolaAbr *) abr;
+
+  ewma_reset (abr);
+  bola->steady = FALSE;
+  bola->last_bitrate = 0;
+}
+
+static guint64
+bola_get_bitrate (GstAdaptiveDemuxAbr * abr,
+    const GstAdaptiveDemuxAbrInput * input)
+{
+  BolaAbr *bola = (BolaAbr *) abr;
+  guint64 safe_bitrate = ewma_get_bitrate (abr, input);
+  gdouble level, min_level, target, lowest, utility, gp, vp, score;
+  gdouble best_score = -G_MAXDOUBLE;
+  guint i, best = 0, safe, last;
+
+  if (input->n_bitrates == 0 || input->buffer_target == 0)
+    return safe_bitrate;
+
+  safe = gst_adaptive_demux_abr_find_index (input, safe_bitrate);
+  level = (gdouble) input->buffer_level / GST_SECOND;
+  target = (gdouble) input->buffer_target / GST_SECOND;
+  min_level = target / 3;
+
+  /* the buffer level says nothing until the buffer was filled once */
+  if (!bola->steady && level < min_level) {
+    bola->last_bitrate = input->bitrates[safe];
+    return bola->last_bitrate;
+  }
+  bola->steady = TRUE;
+
+  lowest = MAX (input->bitrates[0], 1);
+  utility = log (MAX (input->bitrates[input->n_bitrates - 1], 1) / lowest) + 1;
+  gp = (utility - 1) / (target / min_level - 1);
+  if (gp <= 0)
+    return input->bitrates[input->n_bitrates - 1];
+  vp = min_level / gp;
+
+  for (i = 0; i < input->n_bitrates; i++) {
+    gdouble bitrate = MAX (input->bitrates[i], 1);
+
+    utility = log (bitrate / lowest) + 1;
+    score = (vp * (utility + gp) - level) / bitrate;
+    if (score >= best_score) {
+      best_score = score;
+      best = i;
+    }
+  }
+
+  /* Don't switch up beyond what the bandwidth allows, this would most
+   * likely switch down again soon */
+  if (bola->last_bitrate) {
+    last = gst_adaptive_demux_abr_find_index (input, bola->last_bitrate);
+    if (best > last && best > safe)
+      best = MAX (safe, last);
+  }
+
+  bola->last_bitrate = input->bitrates[best];
+  return bola->last_bitrate;
+}
+
+static const GstAdaptiveDemuxAbrFuncs bola_funcs = {
+  "bola",
+  sizeof (BolaAbr),
+  bola_reset,
+  ewma_fragment_downloaded,
+  bola_get_bitrate
+};
+
+/**
+ * gst_adaptive_demux_abr_algorithm_get_funcs:
+ * @algorithm: a #GstAdaptiveDemuxAbrAlgorithm
+ *
+ * Returns: the vtable of @algorithm
+ */
+const GstAdaptiveDemuxAbrFuncs *
+gst_adaptive_demux_abr_algorithm_get_funcs (GstAdaptiveDemuxAbrAlgorithm
+    algorithm)
+{
+  switch (algorithm) {
+    case GST_ADAPTIVE_DEMUX_ABR_THROUGHPUT:
+      return &throughput_funcs;
+    case GST_ADAPTIVE_DEMUX_ABR_EWMA:
+      return &ewma_funcs;
+    case GST_ADAPTIVE_DEMUX_ABR_BOLA:
+      return &bola_funcs;
+    default:
+      g_return_val_if_reached (NULL);
+  }
+}
+
+/**
+ * gst_adaptive_demux_abr_new:
+ * @funcs: the algorithm to use
+ *
+ * Returns: (transfer full): a new #GstAdaptiveDemuxAbr running @funcs
+ */
+GstAdaptiveDemuxAbr *
+gst_adaptive_demux_abr_new (const GstAdaptiveDemuxAbrFuncs * funcs)
+{
+  GstAdaptiveDemuxAbr *abr;
+
+  g_return_val_if_fail (funcs != NULL, NULL);
+  g_return_val_if_fail (funcs->size >= sizeof (GstAdaptiveDemuxAbr), NULL);
+  g_return_val_if_fail (funcs->get_bitrate != NULL, NULL);
+
+  abr = g_malloc0 (funcs->size);
+  abr->funcs = funcs;
+  if (funcs->reset)
+    funcs->reset (abr);
+
+  return abr;
+}
+
+void
+gst_adaptive_demux_abr_free (GstAdaptiveDemuxAbr * abr)
+{
+  g_free (abr);
+}
+
+/**
+ * gst_adaptive_demux_abr_reset:
+ * @abr: a #GstAdaptiveDemuxAbr
+ *
+ * Forgets everything that was learned from the downloaded fragments.
+ */
+void
+gst_adaptive_demux_abr_reset (GstAdaptiveDemuxAbr * abr)
+{
+  const GstAdaptiveDemuxAbrFuncs *funcs = abr->funcs;
+
+  memset (abr, 0, funcs->size);
+  abr->funcs = funcs;
+  if (funcs->reset)
+    funcs->reset (abr);
+}
+
+void
+gst_adaptive_demux_abr_fragment_downloaded (GstAdaptiveDemuxAbr * abr,
+    const GstAdaptiveDemuxAbrFragment * fragment)
+{
+  if (abr->funcs->fragment_downloaded)
+    abr->funcs->fragment_downloaded (abr, fragment);
+}
+
+/**
+ * gst_adaptive_demux_abr_get_bitrate:
+ * @abr: a #GstAdaptiveDemuxAbr
+ * @input: the current state of the stream
+ *
+ * Returns: the maximum bitrate to use for the next fragment, 0 to use the
+ * lowest alternate
+ */
+guint64
+gst_adaptive_demux_abr_get_bitrate (GstAdaptiveDemuxAbr * abr,
+    const GstAdaptiveDemuxAbrInput * input)
+{
+  return abr->funcs->get_bitrate (abr, input);
+}
@@ -0,0 +1,143 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_ADAPTIVE_DEMUX_ABR_H_
+#define _GST_ADAPTIVE_DEMUX_ABR_H_
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_ADAPTIVE_DEMUX_ABR_ALGORITHM \
+  (gst_adaptive_demux_abr_algorithm_get_type())
+
+/**
+ * GstAdaptiveDemuxAbrAlgorithm:
+ * @GST_ADAPTIVE_DEMUX_ABR_THROUGHPUT: average input rate of the stream
+ * @GST_ADAPTIVE_DEMUX_ABR_EWMA: exponentially weighted moving average of
+ *     the throughput
+ * @GST_ADAPTIVE_DEMUX_ABR_BOLA: buffer occupancy based (BOLA)
+ *
+ * The bitrate adaptation algorithms provided by the base class.
+ */
+typedef enum
+{
+  GST_ADAPTIVE_DEMUX_ABR_THROUGHPUT,
+  GST_ADAPTIVE_DEMUX_ABR_EWMA,
+  GST_ADAPTIVE_DEMUX_ABR_BOLA
+} GstAdaptiveDemuxAbrAlgorithm;
+
+typedef struct _GstAdaptiveDemuxAbr GstAdaptiveDemuxAbr;
+typedef struct _GstAdaptiveDemuxAbrFuncs GstAdaptiveDemuxAbrFuncs;
+typedef struct _GstAdaptiveDemuxAbrFragment GstAdaptiveDemuxAbrFragment;
+typedef struct _GstAdaptiveDemuxAbrInput GstAdaptiveDemuxAbrInput;
+
+/**
+ * GstAdaptiveDemuxAbrFragment:
+ * @size: the number of bytes downloaded
+ * @download_time: the time it took to download them
+ * @duration: the media duration of the fragment
+ * @bitrate: the nominal bitrate of the fragment, 0 if unknown
+ *
+ * The timing statistics of a downloaded fragment.
+ */
+struct _GstAdaptiveDemuxAbrFragment
+{
+  guint64 size;
+  GstClockTime download_time;
+  GstClockTime duration;
+  guint64 bitrate;
+};
+
+/**
+ * GstAdaptiveDemuxAbrInput:
+ * @bitrates: the nominal bitrates the stream can switch between, sorted
+ *     in ascending order, or %NULL if unknown
+ * @n_bitrates: the number of entries in @bitrates
+ * @buffer_level: the amount of media that was output but not played yet
+ * @buffer_target: the amount of media that should be kept buffered
+ * @bitrate_limit: the fraction of the estimated bandwidth to use
+ * @input_rate: the average input rate of the stream's queue in bits per
+ *     second
+ *
+ * The state of a stream used to decide the bitrate of the next fragment.
+ */
+struct _GstAdaptiveDemuxAbrInput
+{
+  const guint64 *bitrates;
+  guint n_bitrates;
+  GstClockTime buffer_level;
+  GstClockTime buffer_target;
+  gdouble bitrate_limit;
+  guint64 input_rate;
+};
+
+/**
+ * GstAdaptiveDemuxAbrFuncs:
+ * @name: the name of the algorithm
+ * @size: the size of the instance structure, which must start with a
+ *     #GstAdaptiveDemuxAbr
+ * @reset: resets the state, the instance is zero-filled before
+ * @fragment_downloaded: updates the state with the statistics of a
+ *     downloaded fragment
+ * @get_bitrate: returns the maximum bitrate to use for the next fragment
+ *
+ * The virtual functions of a bitrate adaptation algorithm.
+ */
+struct _GstAdaptiveDemuxAbrFuncs
+{
+  const gchar *name;
+  gsize size;
+
+  void          (*reset) (GstAdaptiveDemuxAbr * abr);
+  void          (*fragment_downloaded) (GstAdaptiveDemuxAbr * abr,
+                                        const GstAdaptiveDemuxAbrFragment * fragment);
+  guint64       (*get_bitrate) (GstAdaptiveDemuxAbr * abr,
+                                const GstAdaptiveDemuxAbrInput * input);
+};
+
+/**
+ * GstAdaptiveDemuxAbr:
+ * @funcs: the algorithm
+ * @estimate: the current bandwidth estimation in bits per second, 0 if
+ *     nothing was downloaded yet
+ *
+ * The per stream state of a bitrate adaptation algorithm.
+ */
+struct _GstAdaptiveDemuxAbr
+{
+  const GstAdaptiveDemuxAbrFuncs *funcs;
+  guint64 estimate;
+};
+
+GType gst_adaptive_demux_abr_algorithm_get_type (void);
+
+const GstAdaptiveDemuxAbrFuncs *
+gst_adaptive_demux_abr_algorithm_get_funcs (GstAdaptiveDemuxAbrAlgorithm algorithm);
+
+GstAdaptiveDemuxAbr * gst_adaptive_demux_abr_new (const GstAdaptiveDemuxAbrFuncs * funcs);
+void gst_adaptive_demux_abr_free (GstAdaptiveDemuxAbr * abr);
+void gst_adaptive_demux_abr_reset (GstAdaptiveDemuxAbr * abr);
+void gst_adaptive_demux_abr_fragment_downloaded (GstAdaptiveDemuxAbr * abr,
+    const GstAdaptiveDemuxAbrFragment * fragment);
+guint64 gst_adaptive_demux_abr_get_bitrate (GstAdaptiveDemuxAbr * abr,
+    const GstAdaptiveDemuxAbrInput * input);
+
+G_END_DECLS
+
+#endif /* _GST_ADAPTIVE_DEMUX_ABR_H_ */
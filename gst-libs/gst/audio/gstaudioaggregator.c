@@ -143,6 +143,16 @@ struct _GstAudioAggregatorPrivate
   /* Protected by srcpad stream clock */
   /* Buffer starting at offset containing block_size frames */
   GstBuffer *current_buffer;
+  /* Nothing was aggregated into current_buffer yet */
+  gboolean current_buffer_empty;
+
+  /* Output buffer allocation, negotiated from the srcpad streaming thread
+   * with the aagg lock */
+  GstBufferPool *pool;
+  gsize pool_size;
+  GstAllocator *allocator;
+  GstAllocationParams allocation_params;
+  gboolean need_allocation;
 
   /* counters to keep track of timestamps */
   /* Readable with object lock, writable with both aag lock and object lock */
@@ -283,10 +293,33 @@ gst_audio_aggregator_init (GstAudioAggregator * aagg)
   aagg->current_caps = NULL;
   gst_audio_info_init (&aagg->info);
 
+  aagg->priv->pool = NULL;
+  aagg->priv->pool_size = 0;
+  aagg->priv->allocator = NULL;
+  gst_allocation_params_init (&aagg->priv->allocation_params);
+
   gst_aggregator_set_latency (GST_AGGREGATOR (aagg),
       aagg->priv->output_buffer_duration, aagg->priv->output_buffer_duration);
 }
 
+/* Must hold the aagg lock or be the only user */
+static void
+gst_audio_aggregator_clear_allocation (GstAudioAggregator * aagg)
+{
+  if (aagg->priv->pool) {
+    gst_buffer_pool_set_active (aagg->priv->pool, FALSE);
+    gst_object_unref (aagg->priv->pool);
+    aagg->priv->pool = NULL;
+  }
+  aagg->priv->pool_size = 0;
+
+  if (aagg->priv->allocator) {
+    gst_object_unref (aagg->priv->allocator);
+    aagg->priv->allocator = NULL;
+  }
+  gst_allocation_params_init (&aagg->priv->allocation_params);
+}
+
 static void
 gst_audio_aggregator_dispose (GObject * object)
 {
@@ -294,6 +327,8 @@ gst_audio_aggregator_dispose (GObject * object)
 
   gst_caps_replace (&aagg->current_caps, NULL);
 
+  gst_audio_aggregator_clear_allocation (aagg);
+
   g_mutex_clear (&aagg->priv->mutex);
 
   G_OBJECT_CLASS (gst_audio_aggregator_parent_class)->dispose (object);
@@ -690,6 +725,7 @@ gst_audio_aggregator_reset (GstAudioAggregator * aagg)
   gst_caps_replace (&aagg->current_caps, NULL);
   gst_buffer_replace (&aagg->priv->current_buffer, NULL);
   GST_OBJECT_UNLOCK (aagg);
+  gst_audio_aggregator_clear_allocation (aagg);
   GST_AUDIO_AGGREGATOR_UNLOCK (aagg);
 }
 
@@ -987,6 +1023,7 @@ gst_audio_aggregator_mix_buffer (GstAudioAggregator * aagg,
     return FALSE;
   }
 
+  aagg->priv->current_buffer_empty = FALSE;
   filled = GST_AUDIO_AGGREGATOR_GET_CLASS (aagg)->aggregate_one_buffer (aagg,
       pad, inbuf, pad->priv->position, outbuf, out_start, overlap);
 
@@ -1006,14 +1043,96 @@ gst_audio_aggregator_mix_buffer (GstAudioAggregator * aagg,
   return TRUE;
 }
 
+/* Called from the srcpad streaming thread with the aagg lock held.
+ *
+ * Uses the pool and allocator downstream proposes for the output buffers,
+ * or a pool of our own if there is none. At small output buffer durations
+ * this saves a fresh allocation for every output buffer */
+static void
+gst_audio_aggregator_decide_allocation (GstAudioAggregator * aagg,
+    GstCaps * caps, gsize size)
+{
+  GstAggregator *agg = GST_AGGREGATOR (aagg);
+  GstBufferPool *pool = NULL;
+  GstAllocator *allocator = NULL;
+  GstAllocationParams params;
+  GstStructure *config;
+  GstQuery *query;
+  guint min = 0, max = 0;
+
+  gst_audio_aggregator_clear_allocation (aagg);
+
+  query = gst_query_new_allocation (caps, TRUE);
+  if (!gst_pad_peer_query (agg->srcpad, query))
+    GST_DEBUG_OBJECT (aagg, "Peer allocation query failed");
+
+  if (gst_query_get_n_allocation_params (query) > 0)
+    gst_query_parse_nth_allocation_param (query, 0, &allocator, &params);
+  else
+    gst_allocation_params_init (&params);
+
+  if (gst_query_get_n_allocation_pools (query) > 0)
+    gst_query_parse_nth_allocation_pool (query, 0, &pool, NULL, &min, &max);
+  gst_query_unref (query);
+
+  if (pool == NULL)
+    pool = gst_buffer_pool_new ();
+
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, caps, size, min, max);
+  gst_buffer_pool_config_set_allocator (config, allocator, &params);
+
+  if (!gst_buffer_pool_set_config (pool, config)) {
+    /* Downstream's pool might not handle our buffer size, try our own */
+    gst_object_unref (pool);
+    pool = gst_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (pool);
+    gst_buffer_pool_config_set_params (config, caps, size, min, max);
+    gst_buffer_pool_config_set_allocator (config, allocator, &params);
+    if (!gst_buffer_pool_set_config (pool, config)) {
+      gst_object_unref (pool);
+      pool = NULL;
+    }
+  }
+
+  if (pool && !gst_buffer_pool_set_active (pool, TRUE)) {
+    gst_object_unref (pool);
+    pool = NULL;
+  }
+
+  if (pool == NULL)
+    GST_WARNING_OBJECT (aagg, "Failed to set up buffer pool, allocating "
+        "every output buffer");
+  else
+    GST_DEBUG_OBJECT (aagg, "Using buffer pool %" GST_PTR_FORMAT
+        " for buffers of %" G_GSIZE_FORMAT " bytes", pool, size);
+
+  aagg->priv->pool = pool;
+  aagg->priv->pool_size = size;
+  aagg->priv->allocator = allocator;
+  aagg->priv->allocation_params = params;
+}
+
 static GstBuffer *
 gst_audio_aggregator_create_output_buffer (GstAudioAggregator * aagg,
     guint num_frames)
 {
-  GstBuffer *outbuf = gst_buffer_new_allocate (NULL, num_frames *
-      GST_AUDIO_INFO_BPF (&aagg->info), NULL);
+  gsize size = num_frames * GST_AUDIO_INFO_BPF (&aagg->info);
+  GstBuffer *outbuf = NULL;
   GstMapInfo outmap;
 
+  if (aagg->priv->pool && aagg->priv->pool_size == size) {
+    if (gst_buffer_pool_acquire_buffer (aagg->priv->pool, &outbuf,
+            NULL) != GST_FLOW_OK) {
+      GST_DEBUG_OBJECT (aagg, "Could not acquire buffer from pool");
+      outbuf = NULL;
+    }
+  }
+
+  if (outbuf == NULL)
+    outbuf = gst_buffer_new_allocate (aagg->priv->allocator, size,
+        &aagg->priv->allocation_params);
+
   gst_buffer_map (outbuf, &outmap, GST_MAP_WRITE);
   gst_audio_format_fill_silence (aagg->info.finfo, outmap.data, outmap.size);
   gst_buffer_unmap (outbuf, &outmap);
@@ -1044,6 +1163,95 @@ sync_pad_values (GstAudioAggregator * aagg, GstAudioAggregatorPad * pad)
   return TRUE;
 }
 
+/* Called with the object lock for both the element and pad held,
+ * as well as the aagg lock.
+ *
+ * If the pad's input buffer covers exactly the current output buffer, is
+ * the first one to be aggregated into it and is aligned as negotiated with
+ * downstream, it is used as output buffer instead, if the subclass allows
+ * it. Saves the copy for the first pad */
+static gboolean
+gst_audio_aggregator_reuse_input_buffer (GstAudioAggregator * aagg,
+    GstAudioAggregatorPad * pad, guint blocksize)
+{
+  GstAudioAggregatorClass *klass = GST_AUDIO_AGGREGATOR_GET_CLASS (aagg);
+  GstBuffer *inbuf = pad->priv->buffer;
+
+  if (klass->can_reuse_input_buffer == NULL
+      || !aagg->priv->current_buffer_empty)
+    return FALSE;
+
+  if (pad->priv->output_offset != aagg->priv->offset
+      || pad->priv->position != 0 || pad->priv->size != blocksize
+      || GST_AUDIO_INFO_BPF (&pad->info) != GST_AUDIO_INFO_BPF (&aagg->info))
+    return FALSE;
+
+  /* Only the aggregator pad and we may hold a reference, otherwise
+   * the buffer would have to be copied anyway. A single memory can
+   * be mapped without merging */
+  if (GST_MINI_OBJECT_REFCOUNT_VALUE (inbuf) > 2
+      || gst_buffer_n_memory (inbuf) != 1
+      || !gst_buffer_is_all_memory_writable (inbuf)
+      || GST_BUFFER_FLAG_IS_SET (inbuf, GST_BUFFER_FLAG_GAP))
+    return FALSE;
+
+  /* Downstream gets buffers with the alignment it asked for */
+  if (aagg->priv->allocation_params.align != 0) {
+    GstMapInfo map;
+    gboolean aligned;
+
+    if (!gst_buffer_map (inbuf, &map, GST_MAP_READ))
+      return FALSE;
+    aligned = ((guintptr) map.data & aagg->priv->allocation_params.align) == 0;
+    gst_buffer_unmap (inbuf, &map);
+
+    if (!aligned)
+      return FALSE;
+  }
+
+  if (!klass->can_reuse_input_buffer (aagg, pad, inbuf))
+    return FALSE;
+
+  GST_LOG_OBJECT (pad, "Using input buffer %" GST_PTR_FORMAT
+      " as output buffer", inbuf);
+
+  gst_buffer_replace (&aagg->priv->current_buffer, inbuf);
+  aagg->priv->current_buffer_empty = FALSE;
+
+  pad->priv->position = pad->priv->size;
+  pad->priv->output_offset += pad->priv->size;
+  gst_buffer_replace (&pad->priv->buffer, NULL);
+
+  return TRUE;
+}
+
+static gboolean
+gst_audio_aggregator_remove_meta (GstBuffer * buffer, GstMeta ** meta,
+    gpointer user_data)
+{
+  /* Locked metas belong to the buffer's pool */
+  if (!GST_META_FLAG_IS_SET (*meta, GST_META_FLAG_LOCKED))
+    *meta = NULL;
+
+  return TRUE;
+}
+
+/* Makes a reused input buffer look like one from create_output_buffer()
+ * with data mixed into it: no metas and no buffer flags. The timestamps
+ * and offsets are set like for any other output buffer before pushing */
+static void
+gst_audio_aggregator_reset_reused_buffer (GstBuffer * outbuf)
+{
+  gst_buffer_foreach_meta (outbuf, gst_audio_aggregator_remove_meta, NULL);
+  GST_MINI_OBJECT_FLAGS (outbuf) &= GST_MINI_OBJECT_FLAG_LAST - 1;
+
+  GST_BUFFER_PTS (outbuf) = GST_CLOCK_TIME_NONE;
+  GST_BUFFER_DTS (outbuf) = GST_CLOCK_TIME_NONE;
+  GST_BUFFER_DURATION (outbuf) = GST_CLOCK_TIME_NONE;
+  GST_BUFFER_OFFSET (outbuf) = GST_BUFFER_OFFSET_NONE;
+  GST_BUFFER_OFFSET_END (outbuf) = GST_BUFFER_OFFSET_NONE;
+}
+
 static GstFlowReturn
 gst_audio_aggregator_aggregate (GstAggregator * agg, gboolean timeout)
 {
@@ -1079,6 +1287,7 @@ gst_audio_aggregator_aggregate (GstAggregator * agg, gboolean timeout)
   GstAudioAggregator *aagg;
   GList *iter;
   GstFlowReturn ret;
+  GstFlowReturn output_ret = GST_FLOW_OK;
   GstBuffer *outbuf = NULL;
   gint64 next_offset;
   gint64 next_timestamp;
@@ -1134,6 +1343,7 @@ gst_audio_aggregator_aggregate (GstAggregator * agg, gboolean timeout)
     GST_OBJECT_LOCK (agg);
 
     aagg->priv->send_caps = FALSE;
+    aagg->priv->need_allocation = TRUE;
   }
 
   rate = GST_AUDIO_INFO_RATE (&aagg->info);
@@ -1166,13 +1376,24 @@ gst_audio_aggregator_aggregate (GstAggregator * agg, gboolean timeout)
       rate);
 
   if (aagg->priv->current_buffer == NULL) {
+    GstCaps *caps = gst_caps_ref (aagg->current_caps);
+
     GST_OBJECT_UNLOCK (agg);
+    if (aagg->priv->need_allocation
+        || aagg->priv->pool_size != blocksize * bpf
+        || gst_pad_check_reconfigure (agg->srcpad)) {
+      gst_audio_aggregator_decide_allocation (aagg, caps, blocksize * bpf);
+      aagg->priv->need_allocation = FALSE;
+    }
+    gst_caps_unref (caps);
+
     aagg->priv->current_buffer =
         GST_AUDIO_AGGREGATOR_GET_CLASS (aagg)->create_output_buffer (aagg,
         blocksize);
     /* Be careful, some things could have changed ? */
     GST_OBJECT_LOCK (agg);
     GST_BUFFER_FLAG_SET (aagg->priv->current_buffer, GST_BUFFER_FLAG_GAP);
+    aagg->priv->current_buffer_empty = TRUE;
   }
   outbuf = aagg->priv->current_buffer;
 
@@ -1186,6 +1407,7 @@ gst_audio_aggregator_aggregate (GstAggregator * agg, gboolean timeout)
     GstAudioAggregatorPad *pad = (GstAudioAggregatorPad *) iter->data;
     GstAggregatorPad *aggpad = (GstAggregatorPad *) iter->data;
     gboolean drop_buf = FALSE;
+    gboolean reused = FALSE;
     gboolean pad_eos = gst_aggregator_pad_is_eos (aggpad);
 
     if (!pad_eos)
@@ -1263,8 +1485,13 @@ gst_audio_aggregator_aggregate (GstAggregator * agg, gboolean timeout)
         && pad->priv->output_offset <
         aagg->priv->offset + blocksize && pad->priv->buffer) {
       GST_LOG_OBJECT (aggpad, "Mixing buffer for current offset");
-      drop_buf = !gst_audio_aggregator_mix_buffer (aagg, pad, pad->priv->buffer,
-          outbuf);
+      if (gst_audio_aggregator_reuse_input_buffer (aagg, pad, blocksize)) {
+        reused = TRUE;
+        drop_buf = TRUE;
+      } else {
+        drop_buf = !gst_audio_aggregator_mix_buffer (aagg, pad,
+            pad->priv->buffer, outbuf);
+      }
       if (pad->priv->output_offset >= next_offset) {
         GST_LOG_OBJECT (pad,
             "Pad is at or after current offset: %" G_GUINT64_FORMAT " >= %"
@@ -1278,6 +1505,14 @@ gst_audio_aggregator_aggregate (GstAggregator * agg, gboolean timeout)
     if (drop_buf)
       gst_aggregator_pad_drop_buffer (aggpad);
 
+    if (reused) {
+      /* The aggregator pad released its reference, so this is only a
+       * copy if upstream took a new reference in the meantime */
+      aagg->priv->current_buffer =
+          gst_buffer_make_writable (aagg->priv->current_buffer);
+      outbuf = aagg->priv->current_buffer;
+      gst_audio_aggregator_reset_reused_buffer (outbuf);
+    }
   }
   GST_OBJECT_UNLOCK (agg);
 
@@ -1354,9 +1589,16 @@ gst_audio_aggregator_aggregate (GstAggregator * agg, gboolean timeout)
 
   GST_AUDIO_AGGREGATOR_UNLOCK (aagg);
 
+  if (GST_AUDIO_AGGREGATOR_GET_CLASS (aagg)->output_buffer)
+    output_ret =
+        GST_AUDIO_AGGREGATOR_GET_CLASS (aagg)->output_buffer (aagg, outbuf);
+
   ret = gst_aggregator_finish_buffer (agg, aagg->priv->current_buffer);
   aagg->priv->current_buffer = NULL;
 
+  if (ret == GST_FLOW_OK)
+    ret = output_ret;
+
   GST_LOG_OBJECT (aagg, "pushed outbuf, result = %s", gst_flow_get_name (ret));
 
   GST_AUDIO_AGGREGATOR_LOCK (aagg);
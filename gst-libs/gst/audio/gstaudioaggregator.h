@@ -138,6 +138,15 @@ struct _GstAudioAggregator
  *  buffer.  The in_offset and out_offset are in "frames", which is
  *  the size of a sample times the number of channels. Returns TRUE if
  *  any non-silence was added to the buffer
+ * @output_buffer: Optional. Called without any lock held once all pads
+ *  were aggregated into outbuf and right before outbuf is pushed
+ *  downstream. outbuf is timestamped, its size and metadata must not be
+ *  changed anymore.
+ * @can_reuse_input_buffer: Optional. Called with the object lock and the
+ *  pad object lock held if inbuf covers exactly the next output buffer and
+ *  no other pad was aggregated into it yet. Return TRUE if aggregating
+ *  inbuf into silence would result in inbuf unchanged, inbuf is then used
+ *  as output buffer instead of being aggregated.
  */
 struct _GstAudioAggregatorClass {
   GstAggregatorClass   parent_class;
@@ -147,6 +156,10 @@ struct _GstAudioAggregatorClass {
   gboolean (* aggregate_one_buffer) (GstAudioAggregator * aagg,
       GstAudioAggregatorPad * pad, GstBuffer * inbuf, guint in_offset,
       GstBuffer * outbuf, guint out_offset, guint num_frames);
+  GstFlowReturn (* output_buffer) (GstAudioAggregator * aagg,
+      GstBuffer * outbuf);
+  gboolean (* can_reuse_input_buffer) (GstAudioAggregator * aagg,
+      GstAudioAggregatorPad * pad, GstBuffer * inbuf);
 
   /*< private >*/
   gpointer          _gst_reserved[GST_PADDING];
@@ -60,6 +60,15 @@
  *    flag these buffers with GST_BUFFER_FLAG_GAP and GST_BUFFER_FLAG_DROPPABLE
  *    to ease their identification and subsequent processing.
  *  </para></listitem>
+ *  <listitem><para>
+ *    In live pipelines the #GstAggregator:latency property is the time to
+ *    wait for late buffers before a pad is considered unresponsive. With
+ *    #GstAggregator:adaptive-latency enabled, the arrival jitter of every
+ *    pad is measured and the waiting time is shrunk or grown between
+ *    #GstAggregator:adaptive-latency-min and #GstAggregator:latency to
+ *    what the inputs actually need. The measurements are posted as
+ *    "GstAggregatorLatency" element messages.
+ *  </para></listitem>
  * </itemizedlist>
  */
 
@@ -227,6 +236,15 @@ struct _GstAggregatorPadPrivate
 
   gboolean eos;
 
+  /* arrival statistics for the adaptive latency. The peak is the
+   * decaying maximum time buffers arrive after their running time
+   * beyond the upstream latency, the jitter the smoothed variation of
+   * the arrival times */
+  gboolean have_arrival;
+  GstClockTimeDiff last_arrival;
+  GstClockTime arrival_peak;
+  GstClockTime arrival_jitter;
+
   GMutex lock;
   GCond event_cond;
   /* This lock prevents a flush start processing happening while
@@ -253,6 +271,9 @@ gst_aggregator_pad_flush (GstAggregatorPad * aggpad, GstAggregator * agg)
   aggpad->priv->head_time = GST_CLOCK_TIME_NONE;
   aggpad->priv->tail_time = GST_CLOCK_TIME_NONE;
   aggpad->priv->time_level = 0;
+  aggpad->priv->have_arrival = FALSE;
+  aggpad->priv->arrival_peak = 0;
+  aggpad->priv->arrival_jitter = 0;
   PAD_UNLOCK (aggpad);
 
   if (klass->flush)
@@ -306,6 +327,14 @@ struct _GstAggregatorPrivate
 
   /* properties */
   gint64 latency;               /* protected by both src_lock and all pad locks */
+  gboolean adaptive_latency;    /* protected by src_lock */
+  gint64 adaptive_latency_min;  /* protected by src_lock */
+
+  /* adaptive latency state, protected by src_lock */
+  GstClockTime current_latency;
+  GstClockTime shrink_since;
+  GstClockTime last_adaptive_update;
+  GstClockTime last_stats;
 };
 
 typedef struct
@@ -321,6 +350,15 @@ typedef struct
 #define DEFAULT_LATENCY              0
 #define DEFAULT_START_TIME_SELECTION GST_AGGREGATOR_START_TIME_SELECTION_ZERO
 #define DEFAULT_START_TIME           (-1)
+#define DEFAULT_ADAPTIVE_LATENCY     FALSE
+#define DEFAULT_ADAPTIVE_LATENCY_MIN 0
+
+/* How often the adaptive latency is re-evaluated, how long a lower latency
+ * has to be sufficient before shrinking to it, and how often the arrival
+ * statistics are posted */
+#define ADAPTIVE_LATENCY_INTERVAL    (100 * GST_MSECOND)
+#define ADAPTIVE_LATENCY_SHRINK_HOLD (2 * GST_SECOND)
+#define ADAPTIVE_LATENCY_STATS       (1 * GST_SECOND)
 
 enum
 {
@@ -328,6 +366,8 @@ enum
   PROP_LATENCY,
   PROP_START_TIME_SELECTION,
   PROP_START_TIME,
+  PROP_ADAPTIVE_LATENCY,
+  PROP_ADAPTIVE_LATENCY_MIN,
   PROP_LAST
 };
 
@@ -613,6 +653,27 @@ gst_aggregator_get_next_time (GstAggregator * self)
   return GST_CLOCK_TIME_NONE;
 }
 
+/* Must be called with the SRC_LOCK held */
+static GstClockTime
+gst_aggregator_get_own_latency_unlocked (GstAggregator * self)
+{
+  if (self->priv->adaptive_latency)
+    return self->priv->current_latency;
+
+  return self->priv->latency;
+}
+
+/* Must be called with the SRC_LOCK held. Starts again from the configured
+ * latency, the safe upper bound */
+static void
+gst_aggregator_reset_adaptive_latency (GstAggregator * self)
+{
+  self->priv->current_latency = self->priv->latency;
+  self->priv->shrink_since = GST_CLOCK_TIME_NONE;
+  self->priv->last_adaptive_update = GST_CLOCK_TIME_NONE;
+  self->priv->last_stats = GST_CLOCK_TIME_NONE;
+}
+
 static gboolean
 gst_aggregator_wait_and_check (GstAggregator * self, gboolean * timeout)
 {
@@ -786,6 +847,140 @@ gst_aggregator_pad_set_flushing (GstAggregatorPad * aggpad,
   PAD_UNLOCK (aggpad);
 }
 
+/* Must be called with the SRC_LOCK and PAD_LOCK held */
+static void
+gst_aggregator_pad_update_arrival (GstAggregator * self,
+    GstAggregatorPad * aggpad, GstClockTimeDiff arrival)
+{
+  GstAggregatorPadPrivate *priv = aggpad->priv;
+  GstClockTimeDiff excess, delta, jitter;
+
+  /* Only what arrives later than upstream announced has to be covered
+   * by our own latency */
+  excess = arrival - (GstClockTimeDiff) self->priv->peer_latency_min;
+  if (excess < 0)
+    excess = 0;
+
+  /* Grow the peak immediately, let it decay slowly */
+  if ((GstClockTime) excess > priv->arrival_peak)
+    priv->arrival_peak = excess;
+  else
+    priv->arrival_peak -= (priv->arrival_peak - excess) / 64;
+
+  /* Interarrival jitter as in RFC 3550 */
+  if (priv->have_arrival) {
+    delta = ABS (arrival - priv->last_arrival);
+    jitter = priv->arrival_jitter;
+    jitter += (delta - jitter) / 16;
+    priv->arrival_jitter = jitter;
+  }
+  priv->last_arrival = arrival;
+  priv->have_arrival = TRUE;
+}
+
+/* Re-evaluates the adaptive latency from the arrival statistics of all
+ * pads. The latency grows immediately when a pad needs more, and only
+ * shrinks after the lower value was sufficient for a while */
+static void
+gst_aggregator_update_adaptive_latency (GstAggregator * self)
+{
+  GstAggregatorPrivate *priv = self->priv;
+  GstMessage *stats = NULL;
+  GstClockTime now, target, min_latency, max_latency;
+  gboolean changed = FALSE;
+  GValue pads = G_VALUE_INIT;
+  GList *item;
+
+  now = g_get_monotonic_time () * GST_USECOND;
+
+  SRC_LOCK (self);
+  if (!priv->adaptive_latency || !priv->peer_latency_live
+      || (GST_CLOCK_TIME_IS_VALID (priv->last_adaptive_update)
+          && now - priv->last_adaptive_update < ADAPTIVE_LATENCY_INTERVAL)) {
+    SRC_UNLOCK (self);
+    return;
+  }
+  priv->last_adaptive_update = now;
+
+  g_value_init (&pads, GST_TYPE_ARRAY);
+
+  target = 0;
+  GST_OBJECT_LOCK (self);
+  for (item = GST_ELEMENT_CAST (self)->sinkpads; item; item = item->next) {
+    GstAggregatorPad *aggpad = GST_AGGREGATOR_PAD (item->data);
+    GValue pad_stats = G_VALUE_INIT;
+    GstClockTime needed;
+
+    PAD_LOCK (aggpad);
+    /* Leave twice the jitter as headroom on top of the peak */
+    needed = aggpad->priv->arrival_peak + 2 * aggpad->priv->arrival_jitter;
+    target = MAX (target, needed);
+
+    g_value_init (&pad_stats, GST_TYPE_STRUCTURE);
+    g_value_take_boxed (&pad_stats,
+        gst_structure_new ("GstAggregatorPadLatency",
+            "pad", G_TYPE_STRING, GST_OBJECT_NAME (aggpad),
+            "lateness", G_TYPE_UINT64, aggpad->priv->arrival_peak,
+            "jitter", G_TYPE_UINT64, aggpad->priv->arrival_jitter, NULL));
+    gst_value_array_append_and_take_value (&pads, &pad_stats);
+    PAD_UNLOCK (aggpad);
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  /* Round up to full milliseconds to not reconfigure the pipeline for
+   * every small variation */
+  target = gst_util_uint64_scale_ceil (target, 1, GST_MSECOND) * GST_MSECOND;
+
+  max_latency = priv->latency;
+  min_latency = MIN (priv->adaptive_latency_min, max_latency);
+  target = CLAMP (target, min_latency, max_latency);
+
+  if (target > priv->current_latency) {
+    priv->current_latency = target;
+    priv->shrink_since = GST_CLOCK_TIME_NONE;
+    changed = TRUE;
+  } else if (target < priv->current_latency) {
+    if (!GST_CLOCK_TIME_IS_VALID (priv->shrink_since)) {
+      priv->shrink_since = now;
+    } else if (now - priv->shrink_since >= ADAPTIVE_LATENCY_SHRINK_HOLD) {
+      priv->current_latency = target;
+      priv->shrink_since = GST_CLOCK_TIME_NONE;
+      changed = TRUE;
+    }
+  } else {
+    priv->shrink_since = GST_CLOCK_TIME_NONE;
+  }
+
+  if (changed) {
+    GST_DEBUG_OBJECT (self, "adaptive latency now %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (priv->current_latency));
+    SRC_BROADCAST (self);
+  }
+
+  if (changed || !GST_CLOCK_TIME_IS_VALID (priv->last_stats)
+      || now - priv->last_stats >= ADAPTIVE_LATENCY_STATS) {
+    GstStructure *s;
+
+    s = gst_structure_new ("GstAggregatorLatency",
+        "latency", G_TYPE_UINT64, priv->current_latency,
+        "min-latency", G_TYPE_UINT64, min_latency,
+        "max-latency", G_TYPE_UINT64, max_latency, NULL);
+    gst_structure_take_value (s, "pads", &pads);
+    stats = gst_message_new_element (GST_OBJECT_CAST (self), s);
+    priv->last_stats = now;
+  } else {
+    g_value_unset (&pads);
+  }
+  SRC_UNLOCK (self);
+
+  if (stats)
+    gst_element_post_message (GST_ELEMENT_CAST (self), stats);
+
+  if (changed)
+    gst_element_post_message (GST_ELEMENT_CAST (self),
+        gst_message_new_latency (GST_OBJECT_CAST (self)));
+}
+
 static void
 gst_aggregator_aggregate_func (GstAggregator * self)
 {
@@ -815,6 +1010,8 @@ gst_aggregator_aggregate_func (GstAggregator * self)
     GST_TRACE_OBJECT (self, "Actually aggregating!");
     flow_return = klass->aggregate (self, timeout);
 
+    gst_aggregator_update_adaptive_latency (self);
+
     GST_OBJECT_LOCK (self);
     if (flow_return == GST_FLOW_FLUSHING && priv->flush_seeking) {
       /* We don't want to set the pads to flushing, but we want to
@@ -1234,6 +1431,10 @@ gst_aggregator_stop (GstAggregator * agg)
   agg->priv->peer_latency_live = FALSE;
   agg->priv->peer_latency_min = agg->priv->peer_latency_max = FALSE;
 
+  SRC_LOCK (agg);
+  gst_aggregator_reset_adaptive_latency (agg);
+  SRC_UNLOCK (agg);
+
   if (agg->priv->tags)
     gst_tag_list_unref (agg->priv->tags);
   agg->priv->tags = NULL;
@@ -1394,7 +1595,7 @@ gst_aggregator_query_latency_unlocked (GstAggregator * self, GstQuery * query)
 
   gst_query_parse_latency (query, &live, &min, &max);
 
-  our_latency = self->priv->latency;
+  our_latency = gst_aggregator_get_own_latency_unlocked (self);
 
   if (G_UNLIKELY (!GST_CLOCK_TIME_IS_VALID (min))) {
     GST_ERROR_OBJECT (self, "Invalid minimum latency %" GST_TIME_FORMAT
@@ -1463,7 +1664,7 @@ gst_aggregator_get_latency_unlocked (GstAggregator * self)
   latency = self->priv->peer_latency_min;
 
   /* add our own */
-  latency += self->priv->latency;
+  latency += gst_aggregator_get_own_latency_unlocked (self);
   latency += self->priv->sub_latency_min;
 
   return latency;
@@ -1846,6 +2047,7 @@ gst_aggregator_set_latency_property (GstAggregator * self, gint64 latency)
     }
 
     self->priv->latency = latency;
+    gst_aggregator_reset_adaptive_latency (self);
 
     SRC_BROADCAST (self);
 
@@ -1890,6 +2092,28 @@ gst_aggregator_get_latency_property (GstAggregator * agg)
   return res;
 }
 
+static void
+gst_aggregator_set_adaptive_latency (GstAggregator * self, gboolean adaptive,
+    gint64 min_latency)
+{
+  gboolean changed;
+
+  SRC_LOCK (self);
+  changed = (self->priv->adaptive_latency != adaptive
+      || self->priv->adaptive_latency_min != min_latency);
+  if (changed) {
+    self->priv->adaptive_latency = adaptive;
+    self->priv->adaptive_latency_min = min_latency;
+    gst_aggregator_reset_adaptive_latency (self);
+    SRC_BROADCAST (self);
+  }
+  SRC_UNLOCK (self);
+
+  if (changed)
+    gst_element_post_message (GST_ELEMENT_CAST (self),
+        gst_message_new_latency (GST_OBJECT_CAST (self)));
+}
+
 static void
 gst_aggregator_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -1906,6 +2130,14 @@ gst_aggregator_set_property (GObject * object, guint prop_id,
     case PROP_START_TIME:
       agg->priv->start_time = g_value_get_uint64 (value);
       break;
+    case PROP_ADAPTIVE_LATENCY:
+      gst_aggregator_set_adaptive_latency (agg, g_value_get_boolean (value),
+          agg->priv->adaptive_latency_min);
+      break;
+    case PROP_ADAPTIVE_LATENCY_MIN:
+      gst_aggregator_set_adaptive_latency (agg, agg->priv->adaptive_latency,
+          g_value_get_int64 (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1928,6 +2160,16 @@ gst_aggregator_get_property (GObject * object, guint prop_id,
     case PROP_START_TIME:
       g_value_set_uint64 (value, agg->priv->start_time);
       break;
+    case PROP_ADAPTIVE_LATENCY:
+      SRC_LOCK (agg);
+      g_value_set_boolean (value, agg->priv->adaptive_latency);
+      SRC_UNLOCK (agg);
+      break;
+    case PROP_ADAPTIVE_LATENCY_MIN:
+      SRC_LOCK (agg);
+      g_value_set_int64 (value, agg->priv->adaptive_latency_min);
+      SRC_UNLOCK (agg);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1990,6 +2232,35 @@ gst_aggregator_class_init (GstAggregatorClass * klass)
           G_MAXUINT64,
           DEFAULT_START_TIME, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAggregator:adaptive-latency:
+   *
+   * Measure the arrival jitter of all pads in live mode and only wait as
+   * long for late buffers as the inputs actually need, bounded by
+   * #GstAggregator:adaptive-latency-min and #GstAggregator:latency. The
+   * measurements are posted as "GstAggregatorLatency" element messages.
+   */
+  g_object_class_install_property (gobject_class, PROP_ADAPTIVE_LATENCY,
+      g_param_spec_boolean ("adaptive-latency", "Adaptive Latency",
+          "Adapt the latency in live mode to the observed arrival jitter "
+          "of the inputs, up to the configured latency",
+          DEFAULT_ADAPTIVE_LATENCY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAggregator:adaptive-latency-min:
+   *
+   * Lower bound of the latency if #GstAggregator:adaptive-latency is
+   * enabled (in nanoseconds).
+   */
+  g_object_class_install_property (gobject_class, PROP_ADAPTIVE_LATENCY_MIN,
+      g_param_spec_int64 ("adaptive-latency-min", "Adaptive Latency Minimum",
+          "Minimum latency in live mode if adaptive-latency is enabled "
+          "(in nanoseconds)", 0,
+          (G_MAXLONG == G_MAXINT64) ? G_MAXINT64 : (G_MAXLONG * GST_SECOND - 1),
+          DEFAULT_ADAPTIVE_LATENCY_MIN,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   GST_DEBUG_REGISTER_FUNCPTR (gst_aggregator_stop_pad);
 }
 
@@ -2034,6 +2305,9 @@ gst_aggregator_init (GstAggregator * self, GstAggregatorClass * klass)
   self->priv->latency = DEFAULT_LATENCY;
   self->priv->start_time_selection = DEFAULT_START_TIME_SELECTION;
   self->priv->start_time = DEFAULT_START_TIME;
+  self->priv->adaptive_latency = DEFAULT_ADAPTIVE_LATENCY;
+  self->priv->adaptive_latency_min = DEFAULT_ADAPTIVE_LATENCY_MIN;
+  gst_aggregator_reset_adaptive_latency (self);
 
   g_mutex_init (&self->priv->src_lock);
   g_cond_init (&self->priv->src_cond);
@@ -2126,6 +2400,7 @@ gst_aggregator_pad_chain_internal (GstAggregator * self,
   GstAggregatorClass *aggclass = GST_AGGREGATOR_GET_CLASS (self);
   GstFlowReturn flow_return;
   GstClockTime buf_pts;
+  gboolean measured = FALSE;
 
   GST_DEBUG_OBJECT (aggpad, "Start chaining a buffer %" GST_PTR_FORMAT, buffer);
 
@@ -2162,6 +2437,30 @@ gst_aggregator_pad_chain_internal (GstAggregator * self,
     SRC_LOCK (self);
     GST_OBJECT_LOCK (self);
     PAD_LOCK (aggpad);
+
+    /* Remember how late the buffer arrived compared to its running time,
+     * before possibly waiting for space in the queue */
+    if (self->priv->adaptive_latency && head && !measured
+        && self->priv->peer_latency_live && GST_CLOCK_TIME_IS_VALID (buf_pts)
+        && GST_ELEMENT_CLOCK (self)) {
+      GstClockTime running_time = GST_CLOCK_TIME_NONE;
+
+      GST_OBJECT_LOCK (aggpad);
+      if (aggpad->clip_segment.format == GST_FORMAT_TIME)
+        running_time = gst_segment_to_running_time (&aggpad->clip_segment,
+            GST_FORMAT_TIME, buf_pts);
+      GST_OBJECT_UNLOCK (aggpad);
+
+      if (GST_CLOCK_TIME_IS_VALID (running_time)) {
+        GstClockTime now = gst_clock_get_time (GST_ELEMENT_CLOCK (self));
+
+        gst_aggregator_pad_update_arrival (self, aggpad,
+            GST_CLOCK_DIFF (GST_ELEMENT_CAST (self)->base_time + running_time,
+                now));
+      }
+      measured = TRUE;
+    }
+
     if (gst_aggregator_pad_has_space (self, aggpad)
         && aggpad->priv->flow_return == GST_FLOW_OK) {
       if (head)
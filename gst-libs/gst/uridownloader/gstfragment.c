@@ -43,7 +43,9 @@ enum
 
 struct _GstFragmentPrivate
 {
-  GstBuffer *buffer;
+  /* the received buffers, only merged when contiguous data is needed */
+  GstBufferList *buffers;
+  gsize size;
   GstCaps *caps;
   GMutex lock;
 };
@@ -159,7 +161,8 @@ gst_fragment_init (GstFragment * fragment)
   fragment->priv = priv = GST_FRAGMENT_GET_PRIVATE (fragment);
 
   g_mutex_init (&fragment->priv->lock);
-  priv->buffer = NULL;
+  priv->buffers = NULL;
+  priv->size = 0;
   fragment->download_start_time = gst_util_get_timestamp ();
   fragment->start_time = 0;
   fragment->stop_time = 0;
@@ -196,9 +199,9 @@ gst_fragment_dispose (GObject * object)
 {
   GstFragmentPrivate *priv = GST_FRAGMENT (object)->priv;
 
-  if (priv->buffer != NULL) {
-    gst_buffer_unref (priv->buffer);
-    priv->buffer = NULL;
+  if (priv->buffers != NULL) {
+    gst_buffer_list_unref (priv->buffers);
+    priv->buffers = NULL;
   }
 
   if (priv->caps != NULL) {
@@ -209,18 +212,123 @@ gst_fragment_dispose (GObject * object)
   G_OBJECT_CLASS (gst_fragment_parent_class)->dispose (object);
 }
 
+/* must be called with the lock taken.
+ * Copies the received buffers into a single one the first time contiguous
+ * data is needed and keeps it instead of them. Returns it without a new
+ * reference, or NULL if nothing was received */
+static GstBuffer *
+gst_fragment_merge_buffers_unlocked (GstFragment * fragment)
+{
+  GstFragmentPrivate *priv = fragment->priv;
+  GstBuffer *first, *merged;
+  GstMapInfo info;
+  gsize offset = 0;
+  guint i, len;
+
+  if (priv->buffers == NULL)
+    return NULL;
+
+  first = gst_buffer_list_get (priv->buffers, 0);
+  len = gst_buffer_list_length (priv->buffers);
+  if (len == 1)
+    return first;
+
+  GST_DEBUG ("Merging %u buffers of %" G_GSIZE_FORMAT " bytes", len,
+      priv->size);
+  merged = gst_buffer_new_allocate (NULL, priv->size, NULL);
+  gst_buffer_copy_into (merged, first, GST_BUFFER_COPY_METADATA, 0, -1);
+  gst_buffer_map (merged, &info, GST_MAP_WRITE);
+  for (i = 0; i < len; i++) {
+    GstBuffer *buffer = gst_buffer_list_get (priv->buffers, i);
+
+    offset += gst_buffer_extract (buffer, 0, info.data + offset,
+        priv->size - offset);
+  }
+  gst_buffer_unmap (merged, &info);
+
+  /* lists handed out by gst_fragment_get_buffer_list() stay untouched */
+  gst_buffer_list_unref (priv->buffers);
+  priv->buffers = gst_buffer_list_new_sized (1);
+  gst_buffer_list_add (priv->buffers, merged);
+
+  return merged;
+}
+
+/**
+ * gst_fragment_get_buffer:
+ * @fragment: a #GstFragment
+ *
+ * Returns the data of a completed @fragment as a single buffer with
+ * contiguous memory. The received buffers are copied into it the first
+ * time this is called, gst_fragment_get_buffer_list() avoids that copy
+ * when contiguous data isn't needed.
+ *
+ * Returns: (transfer full): the data of @fragment, or %NULL
+ */
 GstBuffer *
 gst_fragment_get_buffer (GstFragment * fragment)
 {
+  GstBuffer *buffer;
+
   g_return_val_if_fail (fragment != NULL, NULL);
 
   if (!fragment->completed)
     return NULL;
-  if (!fragment->priv->buffer)
+
+  g_mutex_lock (&fragment->priv->lock);
+  buffer = gst_fragment_merge_buffers_unlocked (fragment);
+  if (buffer)
+    gst_buffer_ref (buffer);
+  g_mutex_unlock (&fragment->priv->lock);
+
+  return buffer;
+}
+
+/**
+ * gst_fragment_get_buffer_list:
+ * @fragment: a #GstFragment
+ *
+ * Returns the data of a completed @fragment as the buffers it was received
+ * in, without copying them.
+ *
+ * Returns: (transfer full): the data of @fragment, or %NULL
+ */
+GstBufferList *
+gst_fragment_get_buffer_list (GstFragment * fragment)
+{
+  GstBufferList *buffers = NULL;
+
+  g_return_val_if_fail (fragment != NULL, NULL);
+
+  if (!fragment->completed)
     return NULL;
 
-  gst_buffer_ref (fragment->priv->buffer);
-  return fragment->priv->buffer;
+  g_mutex_lock (&fragment->priv->lock);
+  if (fragment->priv->buffers)
+    buffers = gst_buffer_list_ref (fragment->priv->buffers);
+  g_mutex_unlock (&fragment->priv->lock);
+
+  return buffers;
+}
+
+/**
+ * gst_fragment_get_size:
+ * @fragment: a #GstFragment
+ *
+ * Returns: the number of bytes received for @fragment so far
+ */
+gsize
+gst_fragment_get_size (GstFragment * fragment)
+{
+  gsize size;
+
+  g_return_val_if_fail (fragment != NULL, 0);
+
+  g_mutex_lock (&fragment->priv->lock);
+  size = fragment->priv->size;
+  g_mutex_unlock (&fragment->priv->lock);
+
+  return size;
 }
 
 void
@@ -243,19 +351,20 @@ gst_fragment_get_caps (GstFragment * fragment)
 
   g_mutex_lock (&fragment->priv->lock);
   if (fragment->priv->caps == NULL) {
+    GstBuffer *buffer = gst_fragment_merge_buffers_unlocked (fragment);
     guint64 offset, offset_end;
 
     /* FIXME: This is currently necessary as typefinding only
      * works with 0 offsets... need to find a better way to
      * do that */
-    offset = GST_BUFFER_OFFSET (fragment->priv->buffer);
-    offset_end = GST_BUFFER_OFFSET_END (fragment->priv->buffer);
-    GST_BUFFER_OFFSET (fragment->priv->buffer) = GST_BUFFER_OFFSET_NONE;
-    GST_BUFFER_OFFSET_END (fragment->priv->buffer) = GST_BUFFER_OFFSET_NONE;
+    offset = GST_BUFFER_OFFSET (buffer);
+    offset_end = GST_BUFFER_OFFSET_END (buffer);
+    GST_BUFFER_OFFSET (buffer) = GST_BUFFER_OFFSET_NONE;
+    GST_BUFFER_OFFSET_END (buffer) = GST_BUFFER_OFFSET_NONE;
     fragment->priv->caps =
-        gst_type_find_helper_for_buffer (NULL, fragment->priv->buffer, NULL);
-    GST_BUFFER_OFFSET (fragment->priv->buffer) = offset;
-    GST_BUFFER_OFFSET_END (fragment->priv->buffer) = offset_end;
+        gst_type_find_helper_for_buffer (NULL, buffer, NULL);
+    GST_BUFFER_OFFSET (buffer) = offset;
+    GST_BUFFER_OFFSET_END (buffer) = offset_end;
   }
   gst_caps_ref (fragment->priv->caps);
   g_mutex_unlock (&fragment->priv->lock);
@@ -275,10 +384,14 @@ gst_fragment_add_buffer (GstFragment * fragment, GstBuffer * buffer)
   }
 
   GST_DEBUG ("Adding new buffer to the fragment");
-  /* We steal the buffers you pass in */
-  if (fragment->priv->buffer == NULL)
-    fragment->priv->buffer = buffer;
-  else
-    fragment->priv->buffer = gst_buffer_append (fragment->priv->buffer, buffer);
+  /* We steal the buffers you pass in. They are kept as they are, appending
+   * them to each other would copy the data again every time the buffer
+   * runs out of memory slots */
+  g_mutex_lock (&fragment->priv->lock);
+  if (fragment->priv->buffers == NULL)
+    fragment->priv->buffers = gst_buffer_list_new ();
+  fragment->priv->size += gst_buffer_get_size (buffer);
+  gst_buffer_list_add (fragment->priv->buffers, buffer);
+  g_mutex_unlock (&fragment->priv->lock);
   return TRUE;
 }
@@ -31,6 +31,11 @@ GST_DEBUG_CATEGORY (uridownloader_debug);
    (G_TYPE_INSTANCE_GET_PRIVATE ((obj), \
     GST_TYPE_URI_DOWNLOADER, GstUriDownloaderPrivate))
 
+/* smallest part of a range downloaded with its own request */
+#define MIN_PARALLEL_CHUNK_SIZE (256 * 1024)
+/* largest hole between two ranges that are still fetched with one request */
+#define MAX_COALESCE_GAP (16 * 1024)
+
 struct _GstUriDownloaderPrivate
 {
   /* Fragments fetcher */
@@ -46,10 +51,35 @@ struct _GstUriDownloaderPrivate
 
   GCond cond;
   gboolean cancelled;
+
+  /* shared source elements, and the pool urisrc was acquired from */
+  GstUriSourcePool *pool;
+  GstUriSourcePool *urisrc_pool;
+
+  /* downloaders fetching the other parts of a range split over
+   * parallel requests, protected by the object lock */
+  GPtrArray *helpers;
 };
 
+/* A part of a range downloaded by its own downloader */
+typedef struct _GstUriDownloaderChunk
+{
+  GstUriDownloader *downloader;
+  const gchar *uri;
+  const gchar *referer;
+  gboolean compress;
+  gboolean refresh;
+  gboolean allow_cache;
+  gint64 range_start;
+  gint64 range_end;
+
+  GstFragment *download;
+  GError *err;
+} GstUriDownloaderChunk;
+
 static void gst_uri_downloader_finalize (GObject * object);
 static void gst_uri_downloader_dispose (GObject * object);
+static void gst_uri_downloader_drop_source (GstUriDownloader * downloader);
 
 static GstFlowReturn gst_uri_downloader_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buf);
@@ -105,6 +135,9 @@ gst_uri_downloader_init (GstUriDownloader * downloader)
 
   g_mutex_init (&downloader->priv->download_lock);
   g_cond_init (&downloader->priv->cond);
+
+  downloader->priv->helpers =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) gst_object_unref);
 }
 
 static void
@@ -112,10 +145,13 @@ gst_uri_downloader_dispose (GObject * object)
 {
   GstUriDownloader *downloader = GST_URI_DOWNLOADER (object);
 
-  if (downloader->priv->urisrc != NULL) {
-    gst_element_set_state (downloader->priv->urisrc, GST_STATE_NULL);
-    gst_object_unref (downloader->priv->urisrc);
-    downloader->priv->urisrc = NULL;
+  if (downloader->priv->urisrc != NULL)
+    gst_uri_downloader_drop_source (downloader);
+
+  if (downloader->priv->pool != NULL) {
+    gst_uri_source_pool_reset (downloader->priv->pool, downloader);
+    gst_object_unref (downloader->priv->pool);
+    downloader->priv->pool = NULL;
   }
 
   if (downloader->priv->bus != NULL) {
@@ -133,6 +169,11 @@ gst_uri_downloader_dispose (GObject * object)
     downloader->priv->download = NULL;
   }
 
+  if (downloader->priv->helpers) {
+    g_ptr_array_unref (downloader->priv->helpers);
+    downloader->priv->helpers = NULL;
+  }
+
   G_OBJECT_CLASS (gst_uri_downloader_parent_class)->dispose (object);
 }
 
@@ -153,6 +194,48 @@ gst_uri_downloader_new (void)
   return g_object_new (GST_TYPE_URI_DOWNLOADER, NULL);
 }
 
+/**
+ * gst_uri_downloader_set_source_pool:
+ * @downloader: a #GstUriDownloader
+ * @pool: (allow-none): a #GstUriSourcePool
+ *
+ * Makes the following downloads use a source element from @pool, so that
+ * connections are shared with the other users of @pool. If @pool is %NULL,
+ * the downloader uses its own source element.
+ */
+void
+gst_uri_downloader_set_source_pool (GstUriDownloader * downloader,
+    GstUriSourcePool * pool)
+{
+  g_return_if_fail (GST_IS_URI_DOWNLOADER (downloader));
+
+  GST_OBJECT_LOCK (downloader);
+  if (downloader->priv->pool)
+    gst_uri_source_pool_reset (downloader->priv->pool, downloader);
+  gst_object_replace ((GstObject **) & downloader->priv->pool,
+      (GstObject *) pool);
+  g_ptr_array_foreach (downloader->priv->helpers,
+      (GFunc) gst_uri_downloader_set_source_pool, pool);
+  GST_OBJECT_UNLOCK (downloader);
+}
+
+/* Gets rid of urisrc, giving it back to the pool it was acquired from */
+static void
+gst_uri_downloader_drop_source (GstUriDownloader * downloader)
+{
+  GstElement *urisrc = downloader->priv->urisrc;
+
+  downloader->priv->urisrc = NULL;
+  if (downloader->priv->urisrc_pool) {
+    gst_uri_source_pool_release (downloader->priv->urisrc_pool, urisrc);
+    gst_object_unref (downloader->priv->urisrc_pool);
+    downloader->priv->urisrc_pool = NULL;
+  } else {
+    gst_element_set_state (urisrc, GST_STATE_NULL);
+    gst_object_unref (urisrc);
+  }
+}
+
 static gboolean
 gst_uri_downloader_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event)
@@ -302,6 +385,10 @@ gst_uri_downloader_reset (GstUriDownloader * downloader)
 
   GST_OBJECT_LOCK (downloader);
   downloader->priv->cancelled = FALSE;
+  if (downloader->priv->pool)
+    gst_uri_source_pool_reset (downloader->priv->pool, downloader);
+  g_ptr_array_foreach (downloader->priv->helpers,
+      (GFunc) gst_uri_downloader_reset, NULL);
   GST_OBJECT_UNLOCK (downloader);
 }
 
@@ -325,6 +412,11 @@ gst_uri_downloader_cancel (GstUriDownloader * downloader)
       GST_DEBUG_OBJECT (downloader,
           "Trying to cancel a download that was alredy cancelled");
   }
+  /* we might be waiting for a source element */
+  if (downloader->priv->pool)
+    gst_uri_source_pool_cancel (downloader->priv->pool, downloader);
+  g_ptr_array_foreach (downloader->priv->helpers,
+      (GFunc) gst_uri_downloader_cancel, NULL);
   GST_OBJECT_UNLOCK (downloader);
 }
 
@@ -367,9 +459,7 @@ gst_uri_downloader_set_uri (GstUriDownloader * downloader, const gchar * uri,
     new_protocol = gst_uri_get_protocol (uri);
 
     if (!g_str_equal (old_protocol, new_protocol)) {
-      gst_element_set_state (downloader->priv->urisrc, GST_STATE_NULL);
-      gst_object_unref (downloader->priv->urisrc);
-      downloader->priv->urisrc = NULL;
+      gst_uri_downloader_drop_source (downloader);
       GST_DEBUG_OBJECT (downloader, "Can't re-use old source element");
     } else {
       GError *err = NULL;
@@ -380,9 +470,7 @@ gst_uri_downloader_set_uri (GstUriDownloader * downloader, const gchar * uri,
         GST_DEBUG_OBJECT (downloader, "Failed to re-use old source element: %s",
             err->message);
         g_clear_error (&err);
-        gst_element_set_state (downloader->priv->urisrc, GST_STATE_NULL);
-        gst_object_unref (downloader->priv->urisrc);
-        downloader->priv->urisrc = NULL;
+        gst_uri_downloader_drop_source (downloader);
       }
     }
     g_free (old_uri);
@@ -468,27 +556,18 @@ gst_uri_downloader_fetch_uri (GstUriDownloader * downloader,
       referer, compress, refresh, allow_cache, 0, -1, err);
 }
 
-/**
- * gst_uri_downloader_fetch_uri_with_range:
- * @downloader: the #GstUriDownloader
- * @uri: the uri
- * @range_start: the starting byte index
- * @range_end: the final byte index, use -1 for unspecified
- *
- * Returns the downloaded #GstFragment
- */
-GstFragment *
-gst_uri_downloader_fetch_uri_with_range (GstUriDownloader *
-    downloader, const gchar * uri, const gchar * referer, gboolean compress,
-    gboolean refresh, gboolean allow_cache,
-    gint64 range_start, gint64 range_end, GError ** err)
+/* must be called with download_lock taken */
+static GstFragment *
+gst_uri_downloader_fetch_range_unlocked (GstUriDownloader * downloader,
+    const gchar * uri, const gchar * referer, gboolean compress,
+    gboolean refresh, gboolean allow_cache, gint64 range_start,
+    gint64 range_end, GError ** err)
 {
   GstStateChangeReturn ret;
   GstFragment *download = NULL;
 
   GST_DEBUG_OBJECT (downloader, "Fetching URI %s", uri);
 
-  g_mutex_lock (&downloader->priv->download_lock);
   downloader->priv->err = NULL;
   downloader->priv->got_buffer = FALSE;
 
@@ -498,6 +577,23 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader *
     goto quit;
   }
 
+  if (downloader->priv->pool && !downloader->priv->urisrc) {
+    GstUriSourcePool *pool = gst_object_ref (downloader->priv->pool);
+    GstElement *urisrc;
+
+    /* waiting for a free source element must not block cancellation */
+    GST_OBJECT_UNLOCK (downloader);
+    urisrc = gst_uri_source_pool_acquire (pool, uri, downloader);
+    GST_OBJECT_LOCK (downloader);
+    if (urisrc == NULL) {
+      GST_WARNING_OBJECT (downloader, "Failed to get a source element");
+      gst_object_unref (pool);
+      goto quit;
+    }
+    downloader->priv->urisrc = urisrc;
+    downloader->priv->urisrc_pool = pool;
+  }
+
   if (!gst_uri_downloader_set_uri (downloader, uri, referer, compress, refresh,
           allow_cache)) {
     GST_WARNING_OBJECT (downloader, "Failed to set URI");
@@ -627,6 +723,10 @@ quit:
         gst_pad_unlink (pad, downloader->priv->pad);
         gst_object_unref (pad);
       }
+
+      /* let the next download from this server use it */
+      if (downloader->priv->urisrc_pool)
+        gst_uri_downloader_drop_source (downloader);
     }
     GST_OBJECT_UNLOCK (downloader);
 
@@ -640,9 +740,344 @@ quit:
       }
     }
 
+    GST_OBJECT_LOCK (downloader);
     downloader->priv->cancelled = FALSE;
+    if (downloader->priv->pool)
+      gst_uri_source_pool_reset (downloader->priv->pool, downloader);
+    GST_OBJECT_UNLOCK (downloader);
+
+    return download;
+  }
+}
+
+/**
+ * gst_uri_downloader_fetch_uri_with_range:
+ * @downloader: the #GstUriDownloader
+ * @uri: the uri
+ * @range_start: the starting byte index
+ * @range_end: the final byte index, use -1 for unspecified
+ *
+ * Returns the downloaded #GstFragment
+ */
+GstFragment *
+gst_uri_downloader_fetch_uri_with_range (GstUriDownloader *
+    downloader, const gchar * uri, const gchar * referer, gboolean compress,
+    gboolean refresh, gboolean allow_cache,
+    gint64 range_start, gint64 range_end, GError ** err)
+{
+  GstFragment *download;
+
+  g_mutex_lock (&downloader->priv->download_lock);
+  download = gst_uri_downloader_fetch_range_unlocked (downloader, uri, referer,
+      compress, refresh, allow_cache, range_start, range_end, err);
+  g_mutex_unlock (&downloader->priv->download_lock);
+
+  return download;
+}
+
+static gpointer
+gst_uri_downloader_fetch_chunk (GstUriDownloaderChunk * chunk)
+{
+  chunk->download =
+      gst_uri_downloader_fetch_uri_with_range (chunk->downloader, chunk->uri,
+      chunk->referer, chunk->compress, chunk->refresh, chunk->allow_cache,
+      chunk->range_start, chunk->range_end, &chunk->err);
+
+  return NULL;
+}
 
+/* Returns a new fragment with the response information of @download, to
+ * be filled with gst_uri_downloader_add_region() */
+static GstFragment *
+gst_uri_downloader_new_fragment (GstFragment * download, gint64 range_start,
+    gint64 range_end)
+{
+  GstFragment *fragment = gst_fragment_new ();
+
+  fragment->uri = g_strdup (download->uri);
+  fragment->redirect_uri = g_strdup (download->redirect_uri);
+  fragment->redirect_permanent = download->redirect_permanent;
+  fragment->range_start = range_start;
+  fragment->range_end = range_end;
+  fragment->download_start_time = download->download_start_time;
+  fragment->download_stop_time = download->download_stop_time;
+  if (download->headers)
+    fragment->headers = gst_structure_copy (download->headers);
+
+  return fragment;
+}
+
+/* Adds @size bytes of the data of @download from @offset to @fragment,
+ * sharing the memory of the received buffers */
+static void
+gst_uri_downloader_add_region (GstFragment * fragment, GstFragment * download,
+    gsize offset, gsize size)
+{
+  GstBufferList *buffers = gst_fragment_get_buffer_list (download);
+  gsize pos = 0;
+  guint i, len;
+
+  len = buffers ? gst_buffer_list_length (buffers) : 0;
+  for (i = 0; i < len && size > 0; i++) {
+    GstBuffer *buffer = gst_buffer_list_get (buffers, i);
+    gsize buffer_size = gst_buffer_get_size (buffer);
+
+    if (pos + buffer_size > offset) {
+      gsize skip = offset - pos;
+      gsize n = MIN (buffer_size - skip, size);
+
+      if (skip == 0 && n == buffer_size)
+        gst_fragment_add_buffer (fragment, gst_buffer_ref (buffer));
+      else
+        gst_fragment_add_buffer (fragment,
+            gst_buffer_copy_region (buffer, GST_BUFFER_COPY_ALL, skip, n));
+      offset += n;
+      size -= n;
+    }
+    pos += buffer_size;
+  }
+
+  if (buffers)
+    gst_buffer_list_unref (buffers);
+}
+
+/**
+ * gst_uri_downloader_fetch_uri_parallel:
+ * @downloader: the #GstUriDownloader
+ * @uri: the uri
+ * @range_start: the starting byte index
+ * @range_end: the final byte index, use -1 for unspecified
+ * @n_requests: the maximum number of concurrent requests
+ *
+ * Like gst_uri_downloader_fetch_uri_with_range(), but a range of known size
+ * is split in up to @n_requests parts that are downloaded concurrently and
+ * joined in order. This hides the latency of the link when a single request
+ * can't use all of its bandwidth. The parts share the #GstUriSourcePool of
+ * @downloader, if any, and are subject to its connection limits.
+ *
+ * Returns the downloaded #GstFragment
+ */
+GstFragment *
+gst_uri_downloader_fetch_uri_parallel (GstUriDownloader * downloader,
+    const gchar * uri, const gchar * referer, gboolean compress,
+    gboolean refresh, gboolean allow_cache, gint64 range_start,
+    gint64 range_end, guint n_requests, GError ** err)
+{
+  GstUriDownloaderChunk *chunks;
+  GThread **threads;
+  GstFragment *download = NULL;
+  gboolean retry = FALSE;
+  gint64 size = 0;
+  guint i, n = 1;
+
+  if (range_start >= 0 && range_end >= range_start) {
+    size = range_end - range_start + 1;
+    n = MIN (n_requests, size / MIN_PARALLEL_CHUNK_SIZE);
+  }
+
+  g_mutex_lock (&downloader->priv->download_lock);
+
+  GST_OBJECT_LOCK (downloader);
+  if (n <= 1 || downloader->priv->cancelled) {
+    GST_OBJECT_UNLOCK (downloader);
+    download = gst_uri_downloader_fetch_range_unlocked (downloader, uri,
+        referer, compress, refresh, allow_cache, range_start, range_end, err);
     g_mutex_unlock (&downloader->priv->download_lock);
     return download;
   }
+
+  GST_DEBUG_OBJECT (downloader, "Fetching URI %s with %u requests", uri, n);
+
+  chunks = g_new0 (GstUriDownloaderChunk, n);
+  threads = g_new0 (GThread *, n);
+  while (downloader->priv->helpers->len < n - 1) {
+    GstUriDownloader *helper = gst_uri_downloader_new ();
+
+    gst_uri_downloader_set_source_pool (helper, downloader->priv->pool);
+    g_ptr_array_add (downloader->priv->helpers, helper);
+  }
+  for (i = 0; i < n; i++) {
+    GstUriDownloaderChunk *chunk = &chunks[i];
+
+    chunk->downloader = i ? g_ptr_array_index (downloader->priv->helpers,
+        i - 1) : downloader;
+    chunk->uri = uri;
+    chunk->referer = referer;
+    chunk->compress = compress;
+    chunk->refresh = refresh;
+    chunk->allow_cache = allow_cache;
+    chunk->range_start = range_start + i * (size / n);
+    chunk->range_end =
+        i == n - 1 ? range_end : chunk->range_start + size / n - 1;
+  }
+  GST_OBJECT_UNLOCK (downloader);
+
+  /* the first part is downloaded from this thread */
+  for (i = 1; i < n; i++)
+    threads[i] = g_thread_new ("uridownloader",
+        (GThreadFunc) gst_uri_downloader_fetch_chunk, &chunks[i]);
+  chunks[0].download = gst_uri_downloader_fetch_range_unlocked (downloader,
+      uri, referer, compress, refresh, allow_cache, chunks[0].range_start,
+      chunks[0].range_end, &chunks[0].err);
+  for (i = 1; i < n; i++)
+    g_thread_join (threads[i]);
+
+  for (i = 0; i < n; i++) {
+    GstUriDownloaderChunk *chunk = &chunks[i];
+    gsize chunk_size = chunk->range_end - chunk->range_start + 1;
+
+    if (chunk->download == NULL) {
+      if (chunk->err == NULL)
+        g_set_error (&chunk->err, GST_RESOURCE_ERROR,
+            GST_RESOURCE_ERROR_OPEN_READ, "Failed to download '%s'", uri);
+      g_propagate_error (err, chunk->err);
+      chunk->err = NULL;
+      break;
+    }
+    if (gst_fragment_get_size (chunk->download) != chunk_size) {
+      /* most likely a server ignoring the range of the requests */
+      GST_WARNING_OBJECT (downloader, "Got %" G_GSIZE_FORMAT " bytes instead "
+          "of %" G_GSIZE_FORMAT, gst_fragment_get_size (chunk->download),
+          chunk_size);
+      retry = TRUE;
+      break;
+    }
+  }
+
+  if (i == n) {
+    download = gst_uri_downloader_new_fragment (chunks[0].download,
+        range_start, range_end);
+    for (i = 0; i < n; i++) {
+      gst_uri_downloader_add_region (download, chunks[i].download, 0,
+          gst_fragment_get_size (chunks[i].download));
+      download->download_start_time = MIN (download->download_start_time,
+          chunks[i].download->download_start_time);
+      download->download_stop_time = MAX (download->download_stop_time,
+          chunks[i].download->download_stop_time);
+    }
+    download->completed = TRUE;
+  } else {
+    if (retry) {
+      GST_DEBUG_OBJECT (downloader, "Fetching URI %s with one request", uri);
+      download = gst_uri_downloader_fetch_range_unlocked (downloader, uri,
+          referer, compress, refresh, allow_cache, range_start, range_end,
+          err);
+    }
+  }
+
+  for (i = 0; i < n; i++) {
+    if (chunks[i].download)
+      g_object_unref (chunks[i].download);
+    g_clear_error (&chunks[i].err);
+  }
+  g_free (chunks);
+  g_free (threads);
+
+  g_mutex_unlock (&downloader->priv->download_lock);
+
+  return download;
+}
+
+/**
+ * gst_uri_downloader_fetch_uri_ranges:
+ * @downloader: the #GstUriDownloader
+ * @uri: the uri
+ * @ranges: (array length=n_ranges): the ranges to download, sorted by their
+ *     starting byte index
+ * @n_ranges: the number of ranges
+ *
+ * Downloads several ranges of @uri, like the initialization, index and
+ * first media segment of a DASH representation. Ranges that are adjacent
+ * or separated by a small gap are coalesced and fetched with a single
+ * request, saving the round trips of the following ones. On success, the
+ * fragment field of every range is set to a new #GstFragment.
+ *
+ * Returns: %TRUE if all the ranges were downloaded
+ */
+gboolean
+gst_uri_downloader_fetch_uri_ranges (GstUriDownloader * downloader,
+    const gchar * uri, const gchar * referer, gboolean compress,
+    gboolean refresh, gboolean allow_cache, GstUriDownloaderRange * ranges,
+    guint n_ranges, GError ** err)
+{
+  guint i, j, k;
+
+  g_return_val_if_fail (ranges != NULL || n_ranges == 0, FALSE);
+
+  for (i = 0; i < n_ranges; i++) {
+    g_return_val_if_fail (ranges[i].range_start >= 0, FALSE);
+    ranges[i].fragment = NULL;
+  }
+
+  g_mutex_lock (&downloader->priv->download_lock);
+
+  for (i = 0; i < n_ranges; i = j) {
+    gint64 start = ranges[i].range_start;
+    gint64 end = ranges[i].range_end;
+    GstFragment *download;
+    gsize download_size;
+
+    /* extend the request over the following ranges starting in it or
+     * shortly after it, the bytes in between are dropped */
+    for (j = i + 1; j < n_ranges && end >= 0; j++) {
+      if (ranges[j].range_start < start
+          || ranges[j].range_start > end + 1 + MAX_COALESCE_GAP)
+        break;
+      end = ranges[j].range_end < 0 ? -1 : MAX (end, ranges[j].range_end);
+    }
+
+    GST_DEBUG_OBJECT (downloader, "Fetching %u ranges of %s with one request "
+        "%" G_GINT64_FORMAT "-%" G_GINT64_FORMAT, j - i, uri, start, end);
+
+    download = gst_uri_downloader_fetch_range_unlocked (downloader, uri,
+        referer, compress, refresh, allow_cache, start, end, err);
+    if (download == NULL)
+      goto error;
+
+    if (j == i + 1) {
+      ranges[i].fragment = download;
+      continue;
+    }
+
+    download_size = gst_fragment_get_size (download);
+    for (k = i; k < j; k++) {
+      gsize offset = ranges[k].range_start - start;
+      gsize size = 0;
+
+      if (ranges[k].range_end >= 0)
+        size = ranges[k].range_end - ranges[k].range_start + 1;
+      else if (download_size > offset)
+        size = download_size - offset;
+      if (size == 0 || offset + size > download_size)
+        break;
+
+      ranges[k].fragment = gst_uri_downloader_new_fragment (download,
+          ranges[k].range_start, ranges[k].range_end);
+      gst_uri_downloader_add_region (ranges[k].fragment, download, offset,
+          size);
+      ranges[k].fragment->completed = TRUE;
+    }
+    g_object_unref (download);
+
+    if (k < j) {
+      g_set_error (err, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ,
+          "Short read of '%s'", uri);
+      goto error;
+    }
+  }
+
+  g_mutex_unlock (&downloader->priv->download_lock);
+
+  return TRUE;
+
+error:
+  for (i = 0; i < n_ranges; i++) {
+    if (ranges[i].fragment) {
+      g_object_unref (ranges[i].fragment);
+      ranges[i].fragment = NULL;
+    }
+  }
+  g_mutex_unlock (&downloader->priv->download_lock);
+
+  return FALSE;
 }
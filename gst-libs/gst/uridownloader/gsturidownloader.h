@@ -30,6 +30,7 @@
 #include <glib-object.h>
 #include <gst/gst.h>
 #include "gstfragment.h"
+#include "gsturisourcepool.h"
 
 G_BEGIN_DECLS
 
@@ -42,6 +43,7 @@ G_BEGIN_DECLS
 typedef struct _GstUriDownloader GstUriDownloader;
 typedef struct _GstUriDownloaderPrivate GstUriDownloaderPrivate;
 typedef struct _GstUriDownloaderClass GstUriDownloaderClass;
+typedef struct _GstUriDownloaderRange GstUriDownloaderRange;
 
 struct _GstUriDownloader
 {
@@ -58,14 +60,31 @@ struct _GstUriDownloaderClass
   gpointer _gst_reserved[GST_PADDING];
 };
 
+/**
+ * GstUriDownloaderRange:
+ * @range_start: the starting byte index
+ * @range_end: the final byte index, -1 for the end of the resource
+ * @fragment: the downloaded data of the range, set by
+ *     gst_uri_downloader_fetch_uri_ranges()
+ */
+struct _GstUriDownloaderRange
+{
+  gint64 range_start;
+  gint64 range_end;
+  GstFragment *fragment;
+};
+
 GType gst_uri_downloader_get_type (void);
 
 GstUriDownloader * gst_uri_downloader_new (void);
 GstFragment * gst_uri_downloader_fetch_uri (GstUriDownloader * downloader, const gchar * uri, const gchar * referer, gboolean compress, gboolean refresh, gboolean allow_cache, GError ** err);
 GstFragment * gst_uri_downloader_fetch_uri_with_range (GstUriDownloader * downloader, const gchar * uri, const gchar * referer, gboolean compress, gboolean refresh, gboolean allow_cache, gint64 range_start, gint64 range_end, GError ** err);
+GstFragment * gst_uri_downloader_fetch_uri_parallel (GstUriDownloader * downloader, const gchar * uri, const gchar * referer, gboolean compress, gboolean refresh, gboolean allow_cache, gint64 range_start, gint64 range_end, guint n_requests, GError ** err);
+gboolean gst_uri_downloader_fetch_uri_ranges (GstUriDownloader * downloader, const gchar * uri, const gchar * referer, gboolean compress, gboolean refresh, gboolean allow_cache, GstUriDownloaderRange * ranges, guint n_ranges, GError ** err);
 void gst_uri_downloader_reset (GstUriDownloader *downloader);
 void gst_uri_downloader_cancel (GstUriDownloader *downloader);
 void gst_uri_downloader_free (GstUriDownloader *downloader);
+void gst_uri_downloader_set_source_pool (GstUriDownloader *downloader, GstUriSourcePool *pool);
 
 G_END_DECLS
 #endif /* __GSTURIDOWNLOADER_H__ */
@@ -0,0 +1,511 @@
+/* GStreamer
+ *
+ * gsturisourcepool.c:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:gsturisourcepool
+ * @short_description: Pool of URI source elements shared between downloads
+ * @see_also: #GstUriDownloader, #GstContext
+ *
+ * A #GstUriSourcePool keeps the source elements used for downloads once
+ * they are released, grouped by scheme, host and port. Elements are kept
+ * in the READY state, so that sources supporting persistent connections
+ * (e.g. souphttpsrc with keep-alive) can reuse their connection for the
+ * next download to the same server, whoever does it.
+ *
+ * The pool also limits the number of source elements that can be in use at
+ * the same time for each server. gst_uri_source_pool_acquire() blocks until
+ * one is released or the wait is cancelled with
+ * gst_uri_source_pool_cancel().
+ *
+ * Pools are shared between the elements of a pipeline with a #GstContext of
+ * type #GST_URI_SOURCE_POOL_CONTEXT_TYPE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gsturisourcepool.h"
+
+#include <string.h>
+
+GST_DEBUG_CATEGORY_STATIC (urisourcepool_debug);
+#define GST_CAT_DEFAULT urisourcepool_debug
+
+#define GST_URI_SOURCE_POOL_GET_PRIVATE(obj)  \
+   (G_TYPE_INSTANCE_GET_PRIVATE ((obj), \
+    GST_TYPE_URI_SOURCE_POOL, GstUriSourcePoolPrivate))
+
+#define DEFAULT_MAX_CONNECTIONS_PER_HOST 6
+
+enum
+{
+  PROP_0,
+  PROP_MAX_CONNECTIONS_PER_HOST
+};
+
+typedef struct _GstUriSourcePoolHost
+{
+  gchar *key;
+  /* released elements, most recently used first */
+  GQueue idle;
+  /* number of acquired elements */
+  guint active;
+} GstUriSourcePoolHost;
+
+struct _GstUriSourcePoolPrivate
+{
+  GMutex lock;
+  GCond cond;
+
+  /* gchar * key -> GstUriSourcePoolHost */
+  GHashTable *hosts;
+  /* acquired GstElement -> GstUriSourcePoolHost */
+  GHashTable *sources;
+  /* owners whose acquire calls must fail */
+  GHashTable *cancelled;
+
+  guint max_per_host;
+};
+
+static void gst_uri_source_pool_finalize (GObject * object);
+static void gst_uri_source_pool_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_uri_source_pool_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+
+#define _do_init \
+{ \
+  GST_DEBUG_CATEGORY_INIT (urisourcepool_debug, "urisourcepool", 0, "URI source pool"); \
+}
+
+G_DEFINE_TYPE_WITH_CODE (GstUriSourcePool, gst_uri_source_pool,
+    GST_TYPE_OBJECT, _do_init);
+
+static void
+gst_uri_source_pool_host_free (GstUriSourcePoolHost * host)
+{
+  GstElement *source;
+
+  while ((source = g_queue_pop_head (&host->idle))) {
+    gst_element_set_state (source, GST_STATE_NULL);
+    gst_object_unref (source);
+  }
+  g_free (host->key);
+  g_slice_free (GstUriSourcePoolHost, host);
+}
+
+static void
+gst_uri_source_pool_class_init (GstUriSourcePoolClass * klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = (GObjectClass *) klass;
+
+  g_type_class_add_private (klass, sizeof (GstUriSourcePoolPrivate));
+
+  gobject_class->set_property = gst_uri_source_pool_set_property;
+  gobject_class->get_property = gst_uri_source_pool_get_property;
+  gobject_class->finalize = gst_uri_source_pool_finalize;
+
+  g_object_class_install_property (gobject_class, PROP_MAX_CONNECTIONS_PER_HOST,
+      g_param_spec_uint ("max-connections-per-host",
+          "Max connections per host",
+          "Maximum number of source elements downloading from the same server "
+          "at the same time", 1, G_MAXUINT, DEFAULT_MAX_CONNECTIONS_PER_HOST,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_uri_source_pool_init (GstUriSourcePool * pool)
+{
+  pool->priv = GST_URI_SOURCE_POOL_GET_PRIVATE (pool);
+
+  g_mutex_init (&pool->priv->lock);
+  g_cond_init (&pool->priv->cond);
+  pool->priv->hosts = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+      (GDestroyNotify) gst_uri_source_pool_host_free);
+  pool->priv->sources = g_hash_table_new (NULL, NULL);
+  pool->priv->cancelled = g_hash_table_new (NULL, NULL);
+  pool->priv->max_per_host = DEFAULT_MAX_CONNECTIONS_PER_HOST;
+}
+
+static void
+gst_uri_source_pool_finalize (GObject * object)
+{
+  GstUriSourcePool *pool = GST_URI_SOURCE_POOL (object);
+
+  if (g_hash_table_size (pool->priv->sources) > 0)
+    GST_WARNING_OBJECT (pool, "%u source elements were not released",
+        g_hash_table_size (pool->priv->sources));
+
+  g_hash_table_unref (pool->priv->sources);
+  g_hash_table_unref (pool->priv->hosts);
+  g_hash_table_unref (pool->priv->cancelled);
+  g_mutex_clear (&pool->priv->lock);
+  g_cond_clear (&pool->priv->cond);
+
+  G_OBJECT_CLASS (gst_uri_source_pool_parent_class)->finalize (object);
+}
+
+static void
+gst_uri_source_pool_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstUriSourcePool *pool = GST_URI_SOURCE_POOL (object);
+
+  switch (prop_id) {
+    case PROP_MAX_CONNECTIONS_PER_HOST:
+      g_mutex_lock (&pool->priv->lock);
+      pool->priv->max_per_host = g_value_get_uint (value);
+      g_cond_broadcast (&pool->priv->cond);
+      g_mutex_unlock (&pool->priv->lock);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_uri_source_pool_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstUriSourcePool *pool = GST_URI_SOURCE_POOL (object);
+
+  switch (prop_id) {
+    case PROP_MAX_CONNECTIONS_PER_HOST:
+      g_mutex_lock (&pool->priv->lock);
+      g_value_set_uint (value, pool->priv->max_per_host);
+      g_mutex_unlock (&pool->priv->lock);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/**
+ * gst_uri_source_pool_new:
+ *
+ * Returns: (transfer full): a new #GstUriSourcePool
+ */
+GstUriSourcePool *
+gst_uri_source_pool_new (void)
+{
+  GstUriSourcePool *pool;
+
+  pool = g_object_new (GST_TYPE_URI_SOURCE_POOL, NULL);
+  gst_object_ref_sink (pool);
+
+  return pool;
+}
+
+/* Elements can only share connections to the same scheme, host and port */
+static gchar *
+gst_uri_source_pool_get_key (const gchar * uri)
+{
+  GstUri *gst_uri;
+  gchar *key;
+
+  gst_uri = gst_uri_from_string (uri);
+  if (gst_uri == NULL || gst_uri_get_host (gst_uri) == NULL) {
+    key = gst_uri_get_protocol (uri);
+  } else {
+    key = g_strdup_printf ("%s://%s:%u", gst_uri_get_scheme (gst_uri),
+        gst_uri_get_host (gst_uri), gst_uri_get_port (gst_uri));
+  }
+  if (gst_uri)
+    gst_uri_unref (gst_uri);
+
+  return key;
+}
+
+/* must be called with the lock taken */
+static GstUriSourcePoolHost *
+gst_uri_source_pool_get_host (GstUriSourcePool * pool, const gchar * uri)
+{
+  GstUriSourcePoolHost *host;
+  gchar *key;
+
+  key = gst_uri_source_pool_get_key (uri);
+  host = g_hash_table_lookup (pool->priv->hosts, key);
+  if (host == NULL) {
+    host = g_slice_new0 (GstUriSourcePoolHost);
+    host->key = key;
+    g_queue_init (&host->idle);
+    g_hash_table_insert (pool->priv->hosts, host->key, host);
+  } else {
+    g_free (key);
+  }
+
+  return host;
+}
+
+/**
+ * gst_uri_source_pool_acquire:
+ * @pool: a #GstUriSourcePool
+ * @uri: the URI to download
+ * @owner: (allow-none): identifies the caller for gst_uri_source_pool_cancel()
+ *
+ * Gets a source element for @uri, preferably one that downloaded from the
+ * same server before. If the maximum number of elements for that server
+ * are in use, waits until one is released.
+ *
+ * The element must be given back with gst_uri_source_pool_release() once
+ * the download is done, without a parent and in the READY or NULL state.
+ *
+ * Returns: (transfer full): a source element with @uri set, or %NULL if
+ * @uri can't be handled or the wait of @owner was cancelled
+ */
+GstElement *
+gst_uri_source_pool_acquire (GstUriSourcePool * pool, const gchar * uri,
+    gpointer owner)
+{
+  GstUriSourcePoolHost *host;
+  GstElement *source = NULL;
+  GError *err = NULL;
+
+  g_return_val_if_fail (GST_IS_URI_SOURCE_POOL (pool), NULL);
+  g_return_val_if_fail (uri != NULL, NULL);
+
+  g_mutex_lock (&pool->priv->lock);
+  host = gst_uri_source_pool_get_host (pool, uri);
+  while (TRUE) {
+    if (owner && g_hash_table_contains (pool->priv->cancelled, owner)) {
+      GST_DEBUG_OBJECT (pool, "Cancelled, not acquiring a source for %s", uri);
+      g_mutex_unlock (&pool->priv->lock);
+      return NULL;
+    }
+    if (!g_queue_is_empty (&host->idle)) {
+      source = g_queue_pop_head (&host->idle);
+      break;
+    }
+    if (host->active < pool->priv->max_per_host)
+      break;
+
+    GST_DEBUG_OBJECT (pool, "%u sources in use for %s, waiting", host->active,
+        host->key);
+    g_cond_wait (&pool->priv->cond, &pool->priv->lock);
+  }
+  host->active++;
+  g_mutex_unlock (&pool->priv->lock);
+
+  if (source) {
+    GST_DEBUG_OBJECT (pool, "Re-using source element %s for %s",
+        GST_ELEMENT_NAME (source), uri);
+    if (!gst_uri_handler_set_uri (GST_URI_HANDLER (source), uri, &err)) {
+      GST_WARNING_OBJECT (pool, "Failed to re-use source element: %s",
+          err->message);
+      g_clear_error (&err);
+      gst_element_set_state (source, GST_STATE_NULL);
+      gst_object_unref (source);
+      source = NULL;
+    }
+  } else {
+    GST_DEBUG_OBJECT (pool, "Creating source element for %s", uri);
+    source = gst_element_make_from_uri (GST_URI_SRC, uri, NULL, NULL);
+    if (source) {
+      gst_object_ref_sink (source);
+      if (g_object_class_find_property (G_OBJECT_GET_CLASS (source),
+              "keep-alive"))
+        g_object_set (source, "keep-alive", TRUE, NULL);
+    }
+  }
+
+  g_mutex_lock (&pool->priv->lock);
+  if (source) {
+    g_hash_table_insert (pool->priv->sources, source, host);
+  } else {
+    host->active--;
+    g_cond_broadcast (&pool->priv->cond);
+  }
+  g_mutex_unlock (&pool->priv->lock);
+
+  return source;
+}
+
+/* Puts the properties set for a download back to their defaults so that
+ * they don't leak into the next one. keep-alive is the pool's own setting,
+ * the location is replaced when the source is acquired again and the proxy
+ * comes from the environment */
+static void
+gst_uri_source_pool_reset_properties (GstElement * source)
+{
+  GParamSpec **pspecs;
+  guint i, n_pspecs;
+
+  pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (source),
+      &n_pspecs);
+  for (i = 0; i < n_pspecs; i++) {
+    GParamSpec *pspec = pspecs[i];
+    GValue value = G_VALUE_INIT;
+
+    if ((pspec->flags & G_PARAM_WRITABLE) == 0 ||
+        (pspec->flags & (G_PARAM_CONSTRUCT_ONLY | G_PARAM_DEPRECATED)) != 0)
+      continue;
+    if (pspec->owner_type == GST_TYPE_OBJECT ||
+        !strcmp (pspec->name, "keep-alive") ||
+        !strcmp (pspec->name, "location") || !strcmp (pspec->name, "uri") ||
+        !strcmp (pspec->name, "proxy"))
+      continue;
+
+    g_value_init (&value, G_PARAM_SPEC_VALUE_TYPE (pspec));
+    if ((pspec->flags & G_PARAM_READABLE) != 0) {
+      g_object_get_property (G_OBJECT (source), pspec->name, &value);
+      if (g_param_value_defaults (pspec, &value)) {
+        g_value_unset (&value);
+        continue;
+      }
+    }
+    g_param_value_set_default (pspec, &value);
+    g_object_set_property (G_OBJECT (source), pspec->name, &value);
+    g_value_unset (&value);
+  }
+  g_free (pspecs);
+}
+
+/**
+ * gst_uri_source_pool_release:
+ * @pool: a #GstUriSourcePool
+ * @source: (transfer full): a source element acquired from @pool
+ *
+ * Gives back a source element so that it can be used by the next download
+ * from the same server.
+ */
+void
+gst_uri_source_pool_release (GstUriSourcePool * pool, GstElement * source)
+{
+  GstUriSourcePoolHost *host;
+  gboolean keep;
+
+  g_return_if_fail (GST_IS_URI_SOURCE_POOL (pool));
+  g_return_if_fail (GST_IS_ELEMENT (source));
+  g_return_if_fail (GST_OBJECT_PARENT (source) == NULL);
+
+  gst_uri_source_pool_reset_properties (source);
+
+  g_mutex_lock (&pool->priv->lock);
+  host = g_hash_table_lookup (pool->priv->sources, source);
+  if (host == NULL) {
+    g_mutex_unlock (&pool->priv->lock);
+    GST_WARNING_OBJECT (pool, "Source element %s is not from this pool",
+        GST_ELEMENT_NAME (source));
+    gst_element_set_state (source, GST_STATE_NULL);
+    gst_object_unref (source);
+    return;
+  }
+  g_hash_table_remove (pool->priv->sources, source);
+  host->active--;
+
+  /* the limit might have been lowered in the meantime */
+  keep = host->active + g_queue_get_length (&host->idle) <
+      pool->priv->max_per_host;
+  if (keep)
+    g_queue_push_head (&host->idle, source);
+  g_cond_broadcast (&pool->priv->cond);
+  g_mutex_unlock (&pool->priv->lock);
+
+  if (!keep) {
+    gst_element_set_state (source, GST_STATE_NULL);
+    gst_object_unref (source);
+  }
+}
+
+/**
+ * gst_uri_source_pool_cancel:
+ * @pool: a #GstUriSourcePool
+ * @owner: the owner passed to gst_uri_source_pool_acquire()
+ *
+ * Wakes up gst_uri_source_pool_acquire() calls of @owner waiting for a
+ * source element and makes the following ones fail, until
+ * gst_uri_source_pool_reset() is called.
+ */
+void
+gst_uri_source_pool_cancel (GstUriSourcePool * pool, gpointer owner)
+{
+  g_return_if_fail (GST_IS_URI_SOURCE_POOL (pool));
+  g_return_if_fail (owner != NULL);
+
+  g_mutex_lock (&pool->priv->lock);
+  g_hash_table_add (pool->priv->cancelled, owner);
+  g_cond_broadcast (&pool->priv->cond);
+  g_mutex_unlock (&pool->priv->lock);
+}
+
+/**
+ * gst_uri_source_pool_reset:
+ * @pool: a #GstUriSourcePool
+ * @owner: the owner passed to gst_uri_source_pool_acquire()
+ *
+ * Allows @owner to acquire source elements again after
+ * gst_uri_source_pool_cancel(). Must also be called before @owner is
+ * freed if it was ever cancelled.
+ */
+void
+gst_uri_source_pool_reset (GstUriSourcePool * pool, gpointer owner)
+{
+  g_return_if_fail (GST_IS_URI_SOURCE_POOL (pool));
+  g_return_if_fail (owner != NULL);
+
+  g_mutex_lock (&pool->priv->lock);
+  g_hash_table_remove (pool->priv->cancelled, owner);
+  g_mutex_unlock (&pool->priv->lock);
+}
+
+/**
+ * gst_context_set_uri_source_pool:
+ * @context: a #GstContext
+ * @pool: a #GstUriSourcePool
+ *
+ * Sets @pool on @context
+ */
+void
+gst_context_set_uri_source_pool (GstContext * context, GstUriSourcePool * pool)
+{
+  GstStructure *s;
+
+  g_return_if_fail (context != NULL);
+
+  s = gst_context_writable_structure (context);
+  gst_structure_set (s, GST_URI_SOURCE_POOL_CONTEXT_TYPE,
+      GST_TYPE_URI_SOURCE_POOL, pool, NULL);
+}
+
+/**
+ * gst_context_get_uri_source_pool:
+ * @context: a #GstContext
+ * @pool: (out) (transfer full): resulting #GstUriSourcePool
+ *
+ * Returns: Whether @pool was in @context
+ */
+gboolean
+gst_context_get_uri_source_pool (GstContext * context,
+    GstUriSourcePool ** pool)
+{
+  const GstStructure *s;
+
+  g_return_val_if_fail (context != NULL, FALSE);
+  g_return_val_if_fail (pool != NULL, FALSE);
+
+  s = gst_context_get_structure (context);
+  return gst_structure_get (s, GST_URI_SOURCE_POOL_CONTEXT_TYPE,
+      GST_TYPE_URI_SOURCE_POOL, pool, NULL);
+}
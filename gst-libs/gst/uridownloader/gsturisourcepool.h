@@ -0,0 +1,78 @@
+/* GStreamer
+ *
+ * gsturisourcepool.h:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_URI_SOURCE_POOL_H__
+#define __GST_URI_SOURCE_POOL_H__
+
+#ifndef GST_USE_UNSTABLE_API
+#warning "The UriDownloaded library from gst-plugins-bad is unstable API and may change in future."
+#warning "You can define GST_USE_UNSTABLE_API to avoid this warning."
+#endif
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_URI_SOURCE_POOL (gst_uri_source_pool_get_type())
+#define GST_URI_SOURCE_POOL(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_URI_SOURCE_POOL,GstUriSourcePool))
+#define GST_URI_SOURCE_POOL_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_URI_SOURCE_POOL,GstUriSourcePoolClass))
+#define GST_IS_URI_SOURCE_POOL(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_URI_SOURCE_POOL))
+#define GST_IS_URI_SOURCE_POOL_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_URI_SOURCE_POOL))
+
+/**
+ * GST_URI_SOURCE_POOL_CONTEXT_TYPE:
+ *
+ * The type of the #GstContext used to share a #GstUriSourcePool between
+ * the elements of a pipeline.
+ */
+#define GST_URI_SOURCE_POOL_CONTEXT_TYPE "gst.uri-source-pool"
+
+typedef struct _GstUriSourcePool GstUriSourcePool;
+typedef struct _GstUriSourcePoolPrivate GstUriSourcePoolPrivate;
+typedef struct _GstUriSourcePoolClass GstUriSourcePoolClass;
+
+struct _GstUriSourcePool
+{
+  GstObject parent;
+
+  GstUriSourcePoolPrivate *priv;
+};
+
+struct _GstUriSourcePoolClass
+{
+  GstObjectClass parent_class;
+
+  /*< private >*/
+  gpointer _gst_reserved[GST_PADDING];
+};
+
+GType gst_uri_source_pool_get_type (void);
+
+GstUriSourcePool * gst_uri_source_pool_new (void);
+GstElement * gst_uri_source_pool_acquire (GstUriSourcePool * pool, const gchar * uri, gpointer owner);
+void gst_uri_source_pool_release (GstUriSourcePool * pool, GstElement * source);
+void gst_uri_source_pool_cancel (GstUriSourcePool * pool, gpointer owner);
+void gst_uri_source_pool_reset (GstUriSourcePool * pool, gpointer owner);
+
+void gst_context_set_uri_source_pool (GstContext * context, GstUriSourcePool * pool);
+gboolean gst_context_get_uri_source_pool (GstContext * context, GstUriSourcePool ** pool);
+
+G_END_DECLS
+#endif /* __GST_URI_SOURCE_POOL_H__ */
@@ -28,7 +28,15 @@
 /**
  * SECTION:element-audiointerleave
  *
+ * Interleaves a number of mono streams into one multi-channel stream.
  *
+ * The inputs of adjacent output channels are interleaved together in one
+ * pass over the output buffer, which keeps this cheap even for a large
+ * number of channels.
+ *
+ * If #GstAudioInterleave:non-interleaved is set and downstream accepts it,
+ * the channels are output as planar (non-interleaved) audio instead, which
+ * only needs a plain copy of every input.
  */
 
 /* FIXME 0.11: suppress warnings for deprecated API such as GValueArray
@@ -97,9 +105,23 @@ enum
 {
   PROP_0,
   PROP_CHANNEL_POSITIONS,
-  PROP_CHANNEL_POSITIONS_FROM_INPUT
+  PROP_CHANNEL_POSITIONS_FROM_INPUT,
+  PROP_NON_INTERLEAVED
 };
 
+#define DEFAULT_NON_INTERLEAVED FALSE
+
+/* One input for the current output buffer, the actual interleaving happens
+ * once all of them are known */
+typedef struct
+{
+  GstBuffer *inbuf;
+  guint in_offset;
+  guint out_offset;
+  guint num_frames;
+  guint column;
+} GstAudioInterleaveInput;
+
 /* elementfactory information */
 
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
@@ -131,7 +153,7 @@ GST_STATIC_PAD_TEMPLATE ("src",
         "rate = (int) [ 1, MAX ], "
         "channels = (int) [ 1, MAX ], "
         "format = (string) " GST_AUDIO_FORMATS_ALL ", "
-        "layout = (string) interleaved")
+        "layout = (string) { interleaved, non-interleaved }")
     );
 
 static void gst_audio_interleave_child_proxy_init (gpointer g_iface,
@@ -156,6 +178,9 @@ static void gst_audio_interleave_release_pad (GstElement * element,
     GstPad * pad);
 
 static gboolean gst_audio_interleave_stop (GstAggregator * agg);
+static GstFlowReturn gst_audio_interleave_flush (GstAggregator * agg);
+static GstFlowReturn gst_audio_interleave_output_buffer (GstAudioAggregator *
+    aagg, GstBuffer * outbuf);
 
 static gboolean
 gst_audio_interleave_aggregate_one_buffer (GstAudioAggregator * aagg,
@@ -375,25 +400,67 @@ interleave_24 (guint8 * out, guint8 * in, guint stride, guint nframes)
   }
 }
 
+/* Transposes n planar inputs into n adjacent channels of the output. The
+ * channel count is a compile time constant so that the inner loop can be
+ * unrolled and vectorized, and every output frame is only touched once for
+ * all n channels instead of once per channel */
+#define MAKE_BLOCK_FUNC(type, n) \
+static void interleave_##type##_##n (guint##type *out, guint##type **in, \
+    guint stride, guint nframes) \
+{ \
+  gint i, j; \
+  \
+  for (i = 0; i < nframes; i++) { \
+    for (j = 0; j < n; j++) \
+      out[j] = in[j][i]; \
+    out += stride; \
+  } \
+}
+
+#define MAKE_BLOCK_FUNCS(type) \
+MAKE_BLOCK_FUNC (type, 2); \
+MAKE_BLOCK_FUNC (type, 4); \
+MAKE_BLOCK_FUNC (type, 8); \
+MAKE_BLOCK_FUNC (type, 16);
+
+MAKE_BLOCK_FUNCS (8);
+MAKE_BLOCK_FUNCS (16);
+MAKE_BLOCK_FUNCS (32);
+MAKE_BLOCK_FUNCS (64);
+
+#define SET_BLOCK_FUNCS(self, type) G_STMT_START { \
+  (self)->block_funcs[0] = (GstInterleaveBlockFunc) interleave_##type##_2; \
+  (self)->block_funcs[1] = (GstInterleaveBlockFunc) interleave_##type##_4; \
+  (self)->block_funcs[2] = (GstInterleaveBlockFunc) interleave_##type##_8; \
+  (self)->block_funcs[3] = (GstInterleaveBlockFunc) interleave_##type##_16; \
+} G_STMT_END
+
 static void
 gst_audio_interleave_set_process_function (GstAudioInterleave * self,
     GstAudioInfo * info)
 {
+  memset (self->block_funcs, 0, sizeof (self->block_funcs));
+
   switch (GST_AUDIO_INFO_WIDTH (info)) {
     case 8:
       self->func = (GstInterleaveFunc) interleave_8;
+      SET_BLOCK_FUNCS (self, 8);
       break;
     case 16:
       self->func = (GstInterleaveFunc) interleave_16;
+      SET_BLOCK_FUNCS (self, 16);
       break;
     case 24:
+      /* no block functions, every channel is handled on its own */
       self->func = (GstInterleaveFunc) interleave_24;
       break;
     case 32:
       self->func = (GstInterleaveFunc) interleave_32;
+      SET_BLOCK_FUNCS (self, 32);
       break;
     case 64:
       self->func = (GstInterleaveFunc) interleave_64;
+      SET_BLOCK_FUNCS (self, 64);
       break;
     default:
       g_assert_not_reached ();
@@ -512,6 +579,7 @@ gst_audio_interleave_aggregate (GstAggregator * aggregator, gboolean timeout)
   if (self->new_caps) {
     GstCaps *srccaps;
     GstStructure *s;
+    gboolean non_interleaved;
     gboolean ret;
 
     if (self->sinkcaps == NULL || self->channels == 0) {
@@ -522,12 +590,22 @@ gst_audio_interleave_aggregate (GstAggregator * aggregator, gboolean timeout)
     srccaps = gst_caps_copy (self->sinkcaps);
     s = gst_caps_get_structure (srccaps, 0);
 
+    non_interleaved = self->non_interleaved;
     gst_structure_set (s, "channels", G_TYPE_INT, self->channels, "layout",
-        G_TYPE_STRING, "interleaved", "channel-mask", GST_TYPE_BITMASK,
+        G_TYPE_STRING, non_interleaved ? "non-interleaved" : "interleaved",
+        "channel-mask", GST_TYPE_BITMASK,
         gst_audio_interleave_get_channel_mask (self), NULL);
 
 
     GST_OBJECT_UNLOCK (aggregator);
+
+    if (non_interleaved
+        && !gst_pad_peer_query_accept_caps (aggregator->srcpad, srccaps)) {
+      GST_DEBUG_OBJECT (self, "downstream does not accept non-interleaved "
+          "audio, interleaving");
+      gst_structure_set (s, "layout", G_TYPE_STRING, "interleaved", NULL);
+    }
+
     ret = gst_audio_aggregator_set_src_caps (aagg, srccaps);
     gst_caps_unref (srccaps);
 
@@ -586,9 +664,11 @@ gst_audio_interleave_class_init (GstAudioInterleaveClass * klass)
   agg_class->sink_query = GST_DEBUG_FUNCPTR (gst_audio_interleave_sink_query);
   agg_class->sink_event = GST_DEBUG_FUNCPTR (gst_audio_interleave_sink_event);
   agg_class->stop = gst_audio_interleave_stop;
+  agg_class->flush = gst_audio_interleave_flush;
   agg_class->aggregate = gst_audio_interleave_aggregate;
 
   aagg_class->aggregate_one_buffer = gst_audio_interleave_aggregate_one_buffer;
+  aagg_class->output_buffer = gst_audio_interleave_output_buffer;
 
 
   /**
@@ -630,6 +710,20 @@ gst_audio_interleave_class_init (GstAudioInterleaveClass * klass)
           "Channel positions from input",
           "Take channel positions from the input", TRUE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstInterleave:non-interleaved
+   *
+   * Non-interleaved: If this property is set to %TRUE and downstream accepts
+   * it, the output is non-interleaved, that is, one plane per channel. This
+   * is cheaper than interleaving for elements that handle planar audio
+   * anyway. Otherwise interleaved audio is output.
+   *
+   */
+  g_object_class_install_property (gobject_class, PROP_NON_INTERLEAVED,
+      g_param_spec_boolean ("non-interleaved", "Non-interleaved",
+          "Output non-interleaved audio if downstream accepts it",
+          DEFAULT_NON_INTERLEAVED, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -638,6 +732,23 @@ gst_audio_interleave_init (GstAudioInterleave * self)
   self->input_channel_positions = g_value_array_new (0);
   self->channel_positions_from_input = TRUE;
   self->channel_positions = self->input_channel_positions;
+  self->non_interleaved = DEFAULT_NON_INTERLEAVED;
+  self->inputs = g_array_new (FALSE, FALSE, sizeof (GstAudioInterleaveInput));
+}
+
+/* Must be called with the object lock held */
+static void
+gst_audio_interleave_clear_inputs (GstAudioInterleave * self)
+{
+  guint i;
+
+  for (i = 0; i < self->inputs->len; i++) {
+    GstAudioInterleaveInput *input =
+        &g_array_index (self->inputs, GstAudioInterleaveInput, i);
+
+    gst_buffer_unref (input->inbuf);
+  }
+  g_array_set_size (self->inputs, 0);
 }
 
 static void
@@ -656,6 +767,12 @@ gst_audio_interleave_finalize (GObject * object)
     self->input_channel_positions = NULL;
   }
 
+  if (self->inputs) {
+    gst_audio_interleave_clear_inputs (self);
+    g_array_free (self->inputs, TRUE);
+    self->inputs = NULL;
+  }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -687,6 +804,12 @@ gst_audio_interleave_set_property (GObject * object, guint prop_id,
         self->channel_positions = self->input_channel_positions;
       }
       break;
+    case PROP_NON_INTERLEAVED:
+      GST_OBJECT_LOCK (self);
+      self->non_interleaved = g_value_get_boolean (value);
+      self->new_caps = TRUE;
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -706,6 +829,11 @@ gst_audio_interleave_get_property (GObject * object, guint prop_id,
     case PROP_CHANNEL_POSITIONS_FROM_INPUT:
       g_value_set_boolean (value, self->channel_positions_from_input);
       break;
+    case PROP_NON_INTERLEAVED:
+      GST_OBJECT_LOCK (self);
+      g_value_set_boolean (value, self->non_interleaved);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -720,12 +848,27 @@ gst_audio_interleave_stop (GstAggregator * agg)
   if (!GST_AGGREGATOR_CLASS (parent_class)->stop (agg))
     return FALSE;
 
+  GST_OBJECT_LOCK (self);
   self->new_caps = FALSE;
   gst_caps_replace (&self->sinkcaps, NULL);
+  gst_audio_interleave_clear_inputs (self);
+  GST_OBJECT_UNLOCK (self);
 
   return TRUE;
 }
 
+static GstFlowReturn
+gst_audio_interleave_flush (GstAggregator * agg)
+{
+  GstAudioInterleave *self = GST_AUDIO_INTERLEAVE (agg);
+
+  GST_OBJECT_LOCK (self);
+  gst_audio_interleave_clear_inputs (self);
+  GST_OBJECT_UNLOCK (self);
+
+  return GST_AGGREGATOR_CLASS (parent_class)->flush (agg);
+}
+
 static GstPad *
 gst_audio_interleave_request_new_pad (GstElement * element,
     GstPadTemplate * templ, const gchar * req_name, const GstCaps * caps)
@@ -825,34 +968,179 @@ gst_audio_interleave_aggregate_one_buffer (GstAudioAggregator * aagg,
 {
   GstAudioInterleave *self = GST_AUDIO_INTERLEAVE (aagg);
   GstAudioInterleavePad *pad = GST_AUDIO_INTERLEAVE_PAD (aaggpad);
-  GstMapInfo inmap;
-  GstMapInfo outmap;
-  gint out_width, in_bpf, out_bpf, out_channels;
-  guint8 *outdata;
+  GstAudioInterleaveInput input;
 
-  out_width = GST_AUDIO_INFO_WIDTH (&aagg->info) / 8;
-  in_bpf = GST_AUDIO_INFO_BPF (&aaggpad->info);
-  out_bpf = GST_AUDIO_INFO_BPF (&aagg->info);
-  out_channels = GST_AUDIO_INFO_CHANNELS (&aagg->info);
+  GST_LOG_OBJECT (pad, "queueing %u frames for channel %d/%d at offset %u"
+      " from offset %u", num_frames, pad->channel,
+      GST_AUDIO_INFO_CHANNELS (&aagg->info), out_offset, in_offset);
 
-  gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE);
-  gst_buffer_map (inbuf, &inmap, GST_MAP_READ);
-  GST_LOG_OBJECT (pad, "interleaves %u frames on channel %d/%d at offset %u"
-      " from offset %u", num_frames, pad->channel, out_channels,
-      out_offset * out_bpf, in_offset * in_bpf);
+  /* Only remember the input here, all inputs are interleaved together
+   * once the output buffer is complete */
+  input.inbuf = gst_buffer_ref (inbuf);
+  input.in_offset = in_offset;
+  input.out_offset = out_offset;
+  input.num_frames = num_frames;
+  input.column = self->default_channels_ordering_map[pad->channel];
+  g_array_append_val (self->inputs, input);
+
+  return TRUE;
+}
+
+static gint
+compare_inputs (gconstpointer a, gconstpointer b)
+{
+  const GstAudioInterleaveInput *ia = a;
+  const GstAudioInterleaveInput *ib = b;
+
+  if (ia->out_offset != ib->out_offset)
+    return ia->out_offset < ib->out_offset ? -1 : 1;
+  if (ia->num_frames != ib->num_frames)
+    return ia->num_frames < ib->num_frames ? -1 : 1;
+  if (ia->column != ib->column)
+    return ia->column < ib->column ? -1 : 1;
+  return 0;
+}
+
+/* Returns the number of inputs starting at @first that cover the same
+ * frames of adjacent output channels */
+static guint
+gst_audio_interleave_get_run_length (GArray * inputs, guint first)
+{
+  GstAudioInterleaveInput *start, *input;
+  guint n = 1;
+
+  start = &g_array_index (inputs, GstAudioInterleaveInput, first);
+  while (first + n < inputs->len) {
+    input = &g_array_index (inputs, GstAudioInterleaveInput, first + n);
+    if (input->out_offset != start->out_offset
+        || input->num_frames != start->num_frames
+        || input->column != start->column + n)
+      break;
+    n++;
+  }
+
+  return n;
+}
 
-  outdata = outmap.data + (out_offset * out_bpf) +
-      (out_width * self->default_channels_ordering_map[pad->channel]);
+/* Must be called with the object lock held */
+static void
+gst_audio_interleave_interleave_inputs (GstAudioInterleave * self,
+    GstAudioInfo * info, GstMapInfo * outmap)
+{
+  GstAudioInterleaveInput *inputs;
+  GstMapInfo inmaps[16];
+  gpointer in[16];
+  guint8 *out;
+  guint i, j, n, block, out_frames, num_frames;
+  gint width, channels, bpf;
+
+  width = GST_AUDIO_INFO_WIDTH (info) / 8;
+  channels = GST_AUDIO_INFO_CHANNELS (info);
+  bpf = GST_AUDIO_INFO_BPF (info);
+  out_frames = outmap->size / bpf;
+
+  g_array_sort (self->inputs, compare_inputs);
+  inputs = (GstAudioInterleaveInput *) self->inputs->data;
+
+  for (i = 0; i < self->inputs->len; i += n) {
+    n = gst_audio_interleave_get_run_length (self->inputs, i);
+
+    /* The output buffer might have been shortened at EOS */
+    if (inputs[i].out_offset >= out_frames)
+      continue;
+    num_frames = MIN (inputs[i].num_frames, out_frames - inputs[i].out_offset);
+
+    /* Split the run into blocks of 16, 8, 4, 2 and single channels */
+    for (j = 0; j < n; j += block) {
+      GstInterleaveBlockFunc block_func = NULL;
+      guint k;
+
+      for (k = G_N_ELEMENTS (self->block_funcs); k > 0; k--) {
+        block = 1 << k;
+        block_func = self->block_funcs[k - 1];
+        if (n - j >= block && block_func)
+          break;
+      }
+      if (k == 0) {
+        block = 1;
+        block_func = NULL;
+      }
 
+      for (k = 0; k < block; k++) {
+        GstAudioInterleaveInput *input = &inputs[i + j + k];
 
-  self->func (outdata, inmap.data + (in_offset * in_bpf), out_channels,
-      num_frames);
+        gst_buffer_map (input->inbuf, &inmaps[k], GST_MAP_READ);
+        in[k] = inmaps[k].data + input->in_offset * width;
+      }
 
+      out = outmap->data + inputs[i].out_offset * bpf +
+          inputs[i + j].column * width;
+      if (block == 1)
+        self->func (out, in[0], channels, num_frames);
+      else
+        block_func (out, in, channels, num_frames);
 
-  gst_buffer_unmap (inbuf, &inmap);
+      for (k = 0; k < block; k++)
+        gst_buffer_unmap (inputs[i + j + k].inbuf, &inmaps[k]);
+    }
+  }
+}
+
+/* Must be called with the object lock held */
+static void
+gst_audio_interleave_copy_inputs (GstAudioInterleave * self,
+    GstAudioInfo * info, GstMapInfo * outmap)
+{
+  guint i, out_frames, num_frames;
+  gint width;
+
+  width = GST_AUDIO_INFO_WIDTH (info) / 8;
+  out_frames = outmap->size / GST_AUDIO_INFO_BPF (info);
+
+  /* One plane of out_frames samples per channel */
+  for (i = 0; i < self->inputs->len; i++) {
+    GstAudioInterleaveInput *input =
+        &g_array_index (self->inputs, GstAudioInterleaveInput, i);
+    GstMapInfo inmap;
+
+    if (input->out_offset >= out_frames)
+      continue;
+    num_frames = MIN (input->num_frames, out_frames - input->out_offset);
+
+    gst_buffer_map (input->inbuf, &inmap, GST_MAP_READ);
+    memcpy (outmap->data + (input->column * out_frames +
+            input->out_offset) * width, inmap.data + input->in_offset * width,
+        num_frames * width);
+    gst_buffer_unmap (input->inbuf, &inmap);
+  }
+}
+
+static GstFlowReturn
+gst_audio_interleave_output_buffer (GstAudioAggregator * aagg,
+    GstBuffer * outbuf)
+{
+  GstAudioInterleave *self = GST_AUDIO_INTERLEAVE (aagg);
+  GstMapInfo outmap;
+
+  GST_OBJECT_LOCK (self);
+  if (self->inputs->len == 0) {
+    GST_OBJECT_UNLOCK (self);
+    return GST_FLOW_OK;
+  }
+
+  GST_LOG_OBJECT (self, "interleaving %u inputs", self->inputs->len);
+
+  gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE);
+  if (aagg->info.layout == GST_AUDIO_LAYOUT_NON_INTERLEAVED)
+    gst_audio_interleave_copy_inputs (self, &aagg->info, &outmap);
+  else
+    gst_audio_interleave_interleave_inputs (self, &aagg->info, &outmap);
   gst_buffer_unmap (outbuf, &outmap);
 
-  return TRUE;
+  gst_audio_interleave_clear_inputs (self);
+  GST_OBJECT_UNLOCK (self);
+
+  return GST_FLOW_OK;
 }
 
 
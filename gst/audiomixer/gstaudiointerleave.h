@@ -46,6 +46,8 @@ typedef struct _GstAudioInterleavePadClass GstAudioInterleavePadClass;
 
 typedef void (*GstInterleaveFunc) (gpointer out, gpointer in, guint stride,
     guint nframes);
+typedef void (*GstInterleaveBlockFunc) (gpointer out, gpointer * in,
+    guint stride, guint nframes);
 
 /**
  * GstAudioInterleave:
@@ -68,6 +70,14 @@ struct _GstAudioInterleave {
   gint default_channels_ordering_map[64];
 
   GstInterleaveFunc func;
+  /* interleave 2, 4, 8 and 16 adjacent channels in one pass */
+  GstInterleaveBlockFunc block_funcs[4];
+
+  /* output planar audio if downstream accepts it */
+  gboolean non_interleaved;
+
+  /* inputs for the current output buffer, protected by the object lock */
+  GArray *inputs;
 };
 
 struct _GstAudioInterleaveClass {
@@ -41,6 +41,20 @@
  * </listitem>
  * </itemizedlist>
  *
+ * For S16, S32, F32 and F64 samples, changes of the volume and mute
+ * properties (including changes done by a control binding) are applied as
+ * a linear gain ramp over one output buffer to avoid zipper noise.
+ *
+ * If the "mix-minus" property is set, every requested sink pad "sink_N" gets
+ * a corresponding "src_N" pad, which outputs the mix of all the other sink
+ * pads (N-1 mix). The complete mix is only calculated once and each pad's
+ * own contribution is subtracted from it again, so the cost stays linear
+ * in the number of pads. Only signed integer and float formats are
+ * supported in this mode. If the complete mix clips, the mix-minus outputs
+ * of integer formats will not be exact.
+ * The "src_N" pads drop all upstream events, seeks have to be sent to the
+ * "src" pad. Flushing seeks and EOS are forwarded to all of them.
+ *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
@@ -57,6 +71,7 @@
 #include "gstaudiomixer.h"
 #include <gst/audio/audio.h>
 #include <string.h>             /* strcmp */
+#include <stdio.h>              /* sscanf */
 #include "gstaudiomixerorc.h"
 
 #include "gstaudiointerleave.h"
@@ -66,6 +81,7 @@ GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
 #define DEFAULT_PAD_VOLUME (1.0)
 #define DEFAULT_PAD_MUTE (FALSE)
+#define DEFAULT_MIX_MINUS (FALSE)
 
 /* some defines for audio processing */
 /* the volume factor is a range from 0.0 to (arbitrary) VOLUME_MAX_DOUBLE = 10.0
@@ -90,6 +106,21 @@ enum
 G_DEFINE_TYPE (GstAudioMixerPad, gst_audiomixer_pad,
     GST_TYPE_AUDIO_AGGREGATOR_PAD);
 
+static void
+gst_audiomixer_pad_finalize (GObject * object)
+{
+  GstAudioMixerPad *pad = GST_AUDIO_MIXER_PAD (object);
+
+  g_free (pad->ramp_gains);
+  pad->ramp_gains = NULL;
+  pad->ramp_gains_size = 0;
+
+  gst_buffer_replace (&pad->contribution, NULL);
+  gst_object_replace ((GstObject **) & pad->minus_srcpad, NULL);
+
+  G_OBJECT_CLASS (gst_audiomixer_pad_parent_class)->finalize (object);
+}
+
 static void
 gst_audiomixer_pad_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec)
@@ -142,6 +173,7 @@ gst_audiomixer_pad_class_init (GstAudioMixerPadClass * klass)
 
   gobject_class->set_property = gst_audiomixer_pad_set_property;
   gobject_class->get_property = gst_audiomixer_pad_get_property;
+  gobject_class->finalize = gst_audiomixer_pad_finalize;
 
   g_object_class_install_property (gobject_class, PROP_PAD_VOLUME,
       g_param_spec_double ("volume", "Volume", "Volume of this pad",
@@ -158,12 +190,24 @@ gst_audiomixer_pad_init (GstAudioMixerPad * pad)
 {
   pad->volume = DEFAULT_PAD_VOLUME;
   pad->mute = DEFAULT_PAD_MUTE;
+
+  pad->ramp_primed = FALSE;
+  pad->ramp_start = pad->ramp_end = DEFAULT_PAD_VOLUME;
+  pad->ramp_length = pad->ramp_position = 0;
+  pad->ramp_gains = NULL;
+  pad->ramp_gains_size = 0;
+
+  pad->minus_srcpad = NULL;
+  pad->minus_need_segment = FALSE;
+  pad->contribution = NULL;
+  pad->contribution_used = FALSE;
 }
 
 enum
 {
   PROP_0,
-  PROP_FILTER_CAPS
+  PROP_FILTER_CAPS,
+  PROP_MIX_MINUS
 };
 
 /* elementfactory information */
@@ -192,6 +236,28 @@ GST_STATIC_PAD_TEMPLATE ("sink_%u",
     GST_STATIC_CAPS (CAPS)
     );
 
+static GstStaticPadTemplate gst_audiomixer_minus_src_template =
+GST_STATIC_PAD_TEMPLATE ("src_%u",
+    GST_PAD_SRC,
+    GST_PAD_SOMETIMES,
+    GST_STATIC_CAPS (CAPS)
+    );
+
+/* mix-minus needs to subtract samples again, which the unsigned
+ * formats can't do */
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define MIX_MINUS_CAPS \
+  GST_AUDIO_CAPS_MAKE ("{ S32LE, S16LE, S8, F32LE, F64LE }") \
+  ", layout = (string) { interleaved, non-interleaved }"
+#else
+#define MIX_MINUS_CAPS \
+  GST_AUDIO_CAPS_MAKE ("{ S32BE, S16BE, S8, F32BE, F64BE }") \
+  ", layout = (string) { interleaved, non-interleaved }"
+#endif
+
+static GstStaticCaps gst_audiomixer_mix_minus_caps =
+GST_STATIC_CAPS (MIX_MINUS_CAPS);
+
 static void gst_audiomixer_child_proxy_init (gpointer g_iface,
     gpointer iface_data);
 
@@ -216,6 +282,15 @@ static gboolean
 gst_audiomixer_aggregate_one_buffer (GstAudioAggregator * aagg,
     GstAudioAggregatorPad * aaggpad, GstBuffer * inbuf, guint in_offset,
     GstBuffer * outbuf, guint out_offset, guint num_samples);
+static gboolean gst_audiomixer_can_reuse_input_buffer (GstAudioAggregator *
+    aagg, GstAudioAggregatorPad * aaggpad, GstBuffer * inbuf);
+static GstFlowReturn gst_audiomixer_output_buffer (GstAudioAggregator * aagg,
+    GstBuffer * outbuf);
+static GstFlowReturn gst_audiomixer_aggregate (GstAggregator * agg,
+    gboolean timeout);
+static gboolean gst_audiomixer_src_event (GstAggregator * agg,
+    GstEvent * event);
+static GstFlowReturn gst_audiomixer_flush (GstAggregator * agg);
 
 
 /* we can only accept caps that we and downstream can handle.
@@ -306,6 +381,18 @@ gst_audiomixer_sink_getcaps (GstAggregator * agg, GstPad * pad,
     gst_structure_free (sref);
   }
 
+  if (audiomixer->mix_minus) {
+    GstCaps *mix_minus_caps =
+        gst_static_caps_get (&gst_audiomixer_mix_minus_caps);
+    GstCaps *tmp;
+
+    tmp = gst_caps_intersect_full (result, mix_minus_caps,
+        GST_CAPS_INTERSECT_FIRST);
+    gst_caps_unref (mix_minus_caps);
+    gst_caps_unref (result);
+    result = tmp;
+  }
+
   if (filter_caps)
     gst_caps_unref (filter_caps);
 
@@ -485,10 +572,18 @@ gst_audiomixer_class_init (GstAudioMixerClass * klass)
           "Setting this property takes a reference to the supplied GstCaps "
           "object", GST_TYPE_CAPS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_MIX_MINUS,
+      g_param_spec_boolean ("mix-minus", "Mix minus",
+          "Add a src pad for every sink pad that outputs the mix of all "
+          "other sink pads. Only affects sink pads requested afterwards",
+          DEFAULT_MIX_MINUS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&gst_audiomixer_src_template));
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&gst_audiomixer_sink_template));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&gst_audiomixer_minus_src_template));
   gst_element_class_set_static_metadata (gstelement_class, "AudioMixer",
       "Generic/Audio",
       "Mixes multiple audio streams",
@@ -503,14 +598,21 @@ gst_audiomixer_class_init (GstAudioMixerClass * klass)
 
   agg_class->sink_query = GST_DEBUG_FUNCPTR (gst_audiomixer_sink_query);
   agg_class->sink_event = GST_DEBUG_FUNCPTR (gst_audiomixer_sink_event);
+  agg_class->src_event = GST_DEBUG_FUNCPTR (gst_audiomixer_src_event);
+  agg_class->aggregate = GST_DEBUG_FUNCPTR (gst_audiomixer_aggregate);
+  agg_class->flush = GST_DEBUG_FUNCPTR (gst_audiomixer_flush);
 
   aagg_class->aggregate_one_buffer = gst_audiomixer_aggregate_one_buffer;
+  aagg_class->output_buffer = GST_DEBUG_FUNCPTR (gst_audiomixer_output_buffer);
+  aagg_class->can_reuse_input_buffer =
+      GST_DEBUG_FUNCPTR (gst_audiomixer_can_reuse_input_buffer);
 }
 
 static void
 gst_audiomixer_init (GstAudioMixer * audiomixer)
 {
   audiomixer->filter_caps = NULL;
+  audiomixer->mix_minus = DEFAULT_MIX_MINUS;
 }
 
 static void
@@ -551,6 +653,11 @@ gst_audiomixer_set_property (GObject * object, guint prop_id,
       GST_DEBUG_OBJECT (audiomixer, "set new caps %" GST_PTR_FORMAT, new_caps);
       break;
     }
+    case PROP_MIX_MINUS:
+      GST_OBJECT_LOCK (audiomixer);
+      audiomixer->mix_minus = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (audiomixer);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -569,17 +676,136 @@ gst_audiomixer_get_property (GObject * object, guint prop_id, GValue * value,
       gst_value_set_caps (value, audiomixer->filter_caps);
       GST_OBJECT_UNLOCK (audiomixer);
       break;
+    case PROP_MIX_MINUS:
+      GST_OBJECT_LOCK (audiomixer);
+      g_value_set_boolean (value, audiomixer->mix_minus);
+      GST_OBJECT_UNLOCK (audiomixer);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static gboolean
+gst_audiomixer_minus_src_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstAudioAggregator *aagg = GST_AUDIO_AGGREGATOR (parent);
+  gboolean res;
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CAPS:
+    {
+      GstCaps *filter, *caps;
+
+      gst_query_parse_caps (query, &filter);
+
+      GST_OBJECT_LOCK (aagg);
+      if (aagg->current_caps)
+        caps = gst_caps_ref (aagg->current_caps);
+      else
+        caps = gst_pad_get_pad_template_caps (pad);
+      GST_OBJECT_UNLOCK (aagg);
+
+      if (filter) {
+        GstCaps *tmp = gst_caps_intersect_full (filter, caps,
+            GST_CAPS_INTERSECT_FIRST);
+        gst_caps_unref (caps);
+        caps = tmp;
+      }
+
+      gst_query_set_caps_result (query, caps);
+      gst_caps_unref (caps);
+      res = TRUE;
+      break;
+    }
+    default:
+      res = gst_pad_query_default (pad, parent, query);
+      break;
+  }
+
+  return res;
+}
+
+static gboolean
+gst_audiomixer_minus_src_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  /* Seeking or anything else upstream would also affect the other
+   * outputs, so don't handle anything here */
+  GST_DEBUG_OBJECT (pad, "Dropping %s event on mix-minus pad",
+      GST_EVENT_TYPE_NAME (event));
+  gst_event_unref (event);
+
+  return FALSE;
+}
+
+static void
+gst_audiomixer_add_minus_pad (GstAudioMixer * audiomixer,
+    GstAudioMixerPad * pad)
+{
+  GstPadTemplate *templ;
+  GstPad *srcpad;
+  guint index = 0;
+  gchar *name;
+
+  templ =
+      gst_element_class_get_pad_template (GST_ELEMENT_GET_CLASS (audiomixer),
+      "src_%u");
+
+  /* name it after the sink pad, sink_N gets src_N */
+  sscanf (GST_OBJECT_NAME (pad), "sink_%u", &index);
+  name = g_strdup_printf ("src_%u", index);
+  srcpad = gst_pad_new_from_template (templ, name);
+  g_free (name);
+
+  gst_pad_set_query_function (srcpad,
+      GST_DEBUG_FUNCPTR (gst_audiomixer_minus_src_query));
+  gst_pad_set_event_function (srcpad,
+      GST_DEBUG_FUNCPTR (gst_audiomixer_minus_src_event));
+  gst_pad_use_fixed_caps (srcpad);
+
+  GST_OBJECT_LOCK (pad);
+  pad->minus_srcpad = gst_object_ref (srcpad);
+  pad->minus_need_segment = TRUE;
+  GST_OBJECT_UNLOCK (pad);
+
+  GST_DEBUG_OBJECT (audiomixer, "adding mix-minus pad %s:%s for %s:%s",
+      GST_DEBUG_PAD_NAME (srcpad), GST_DEBUG_PAD_NAME (pad));
+
+  gst_element_add_pad (GST_ELEMENT_CAST (audiomixer), srcpad);
+}
+
+static void
+gst_audiomixer_remove_minus_pad (GstAudioMixer * audiomixer,
+    GstAudioMixerPad * pad)
+{
+  GstPad *srcpad;
+
+  GST_OBJECT_LOCK (pad);
+  srcpad = pad->minus_srcpad;
+  pad->minus_srcpad = NULL;
+  gst_buffer_replace (&pad->contribution, NULL);
+  pad->contribution_used = FALSE;
+  GST_OBJECT_UNLOCK (pad);
+
+  if (srcpad) {
+    GST_DEBUG_OBJECT (audiomixer, "removing mix-minus pad %s:%s",
+        GST_DEBUG_PAD_NAME (srcpad));
+    gst_pad_push_event (srcpad, gst_event_new_eos ());
+    gst_element_remove_pad (GST_ELEMENT_CAST (audiomixer), srcpad);
+    gst_object_unref (srcpad);
+  }
+}
+
 static GstPad *
 gst_audiomixer_request_new_pad (GstElement * element, GstPadTemplate * templ,
     const gchar * req_name, const GstCaps * caps)
 {
+  GstAudioMixer *audiomixer = GST_AUDIO_MIXER (element);
   GstAudioMixerPad *newpad;
+  gboolean mix_minus;
 
   newpad = (GstAudioMixerPad *)
       GST_ELEMENT_CLASS (parent_class)->request_new_pad (element,
@@ -588,6 +814,13 @@ gst_audiomixer_request_new_pad (GstElement * element, GstPadTemplate * templ,
   if (newpad == NULL)
     goto could_not_create;
 
+  GST_OBJECT_LOCK (audiomixer);
+  mix_minus = audiomixer->mix_minus;
+  GST_OBJECT_UNLOCK (audiomixer);
+
+  if (mix_minus)
+    gst_audiomixer_add_minus_pad (audiomixer, newpad);
+
   gst_child_proxy_child_added (GST_CHILD_PROXY (element), G_OBJECT (newpad),
       GST_OBJECT_NAME (newpad));
 
@@ -612,120 +845,275 @@ gst_audiomixer_release_pad (GstElement * element, GstPad * pad)
   gst_child_proxy_child_removed (GST_CHILD_PROXY (audiomixer), G_OBJECT (pad),
       GST_OBJECT_NAME (pad));
 
+  gst_audiomixer_remove_minus_pad (audiomixer, GST_AUDIO_MIXER_PAD (pad));
+
   GST_ELEMENT_CLASS (parent_class)->release_pad (element, pad);
 }
 
 
-/* Called with object lock and pad object lock held */
-static gboolean
-gst_audiomixer_aggregate_one_buffer (GstAudioAggregator * aagg,
-    GstAudioAggregatorPad * aaggpad, GstBuffer * inbuf, guint in_offset,
-    GstBuffer * outbuf, guint out_offset, guint num_frames)
+/* Called with pad object lock held.
+ *
+ * Starts a new ramp towards the current target volume if it changed since
+ * the last call. The ramp spans one output buffer, so that it stays
+ * sample-accurate even if the input buffers are smaller than that */
+static void
+gst_audiomixer_pad_update_ramp (GstAudioMixerPad * pad, GstAudioFormat format,
+    guint out_frames)
 {
-  GstAudioMixerPad *pad = GST_AUDIO_MIXER_PAD (aaggpad);
-  GstMapInfo inmap;
-  GstMapInfo outmap;
-  gint bpf;
+  gdouble target = pad->mute ? 0.0 : pad->volume;
+  gdouble current;
+
+  if (!pad->ramp_primed) {
+    /* Nothing mixed yet, start at the target right away */
+    pad->ramp_start = pad->ramp_end = target;
+    pad->ramp_length = pad->ramp_position = 0;
+    pad->ramp_primed = TRUE;
+    return;
+  }
 
-  if (pad->mute || pad->volume < G_MINDOUBLE) {
-    GST_DEBUG_OBJECT (pad, "Skipping muted pad");
-    return FALSE;
+  if (target == pad->ramp_end)
+    return;
+
+  switch (format) {
+    case GST_AUDIO_FORMAT_S16:
+    case GST_AUDIO_FORMAT_S32:
+    case GST_AUDIO_FORMAT_F32:
+    case GST_AUDIO_FORMAT_F64:
+      break;
+    default:
+      /* No ramp kernels for the other formats, just step */
+      pad->ramp_start = pad->ramp_end = target;
+      pad->ramp_length = pad->ramp_position = 0;
+      return;
   }
 
-  bpf = GST_AUDIO_INFO_BPF (&aagg->info);
+  if (pad->ramp_position < pad->ramp_length)
+    current = pad->ramp_start + (pad->ramp_end - pad->ramp_start) *
+        pad->ramp_position / pad->ramp_length;
+  else
+    current = pad->ramp_end;
 
-  gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE);
-  gst_buffer_map (inbuf, &inmap, GST_MAP_READ);
-  GST_LOG_OBJECT (pad, "mixing %u bytes at offset %u from offset %u",
-      num_frames * bpf, out_offset * bpf, in_offset * bpf);
+  GST_LOG_OBJECT (pad, "ramping volume from %f to %f over %u frames",
+      current, target, out_frames);
 
-  /* further buffers, need to add them */
-  if (pad->volume == 1.0) {
-    switch (aagg->info.finfo->format) {
-      case GST_AUDIO_FORMAT_U8:
-        audiomixer_orc_add_u8 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
-        break;
-      case GST_AUDIO_FORMAT_S8:
-        audiomixer_orc_add_s8 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
-        break;
-      case GST_AUDIO_FORMAT_U16:
-        audiomixer_orc_add_u16 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
-        break;
+  pad->ramp_start = current;
+  pad->ramp_end = target;
+  pad->ramp_length = out_frames;
+  pad->ramp_position = 0;
+}
+
+/* Called with pad object lock held.
+ *
+ * Fills the scratch memory with num_frames * channels gains continuing
+ * the current ramp and advances the ramp position */
+static gpointer
+gst_audiomixer_pad_fill_ramp (GstAudioMixerPad * pad, GstAudioFormat format,
+    gint channels, guint num_frames)
+{
+  gdouble gain, step;
+  gsize size;
+  guint i;
+  gint c;
+
+  /* big enough for gains of any of the ramped formats */
+  size = (gsize) num_frames * channels * sizeof (gdouble);
+  if (pad->ramp_gains_size < size) {
+    g_free (pad->ramp_gains);
+    pad->ramp_gains = g_malloc (size);
+    pad->ramp_gains_size = size;
+  }
+
+  step = (pad->ramp_end - pad->ramp_start) / pad->ramp_length;
+  gain = pad->ramp_start + step * pad->ramp_position;
+
+  switch (format) {
+    case GST_AUDIO_FORMAT_S16:{
+      gint16 *gains = pad->ramp_gains;
+
+      for (i = 0; i < num_frames; i++, gain += step)
+        for (c = 0; c < channels; c++)
+          *gains++ = gain * VOLUME_UNITY_INT16;
+      break;
+    }
+    case GST_AUDIO_FORMAT_S32:{
+      gint32 *gains = pad->ramp_gains;
+
+      for (i = 0; i < num_frames; i++, gain += step)
+        for (c = 0; c < channels; c++)
+          *gains++ = gain * VOLUME_UNITY_INT32;
+      break;
+    }
+    case GST_AUDIO_FORMAT_F32:{
+      gfloat *gains = pad->ramp_gains;
+
+      for (i = 0; i < num_frames; i++, gain += step)
+        for (c = 0; c < channels; c++)
+          *gains++ = gain;
+      break;
+    }
+    case GST_AUDIO_FORMAT_F64:{
+      gdouble *gains = pad->ramp_gains;
+
+      for (i = 0; i < num_frames; i++, gain += step)
+        for (c = 0; c < channels; c++)
+          *gains++ = gain;
+      break;
+    }
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+
+  pad->ramp_position += num_frames;
+
+  return pad->ramp_gains;
+}
+
+/* Adds num_samples samples from in to out */
+static void
+gst_audiomixer_add (GstAudioFormat format, gpointer out, gpointer in,
+    guint num_samples)
+{
+  switch (format) {
+    case GST_AUDIO_FORMAT_U8:
+      audiomixer_orc_add_u8 (out, in, num_samples);
+      break;
+    case GST_AUDIO_FORMAT_S8:
+      audiomixer_orc_add_s8 (out, in, num_samples);
+      break;
+    case GST_AUDIO_FORMAT_U16:
+      audiomixer_orc_add_u16 (out, in, num_samples);
+      break;
+    case GST_AUDIO_FORMAT_S16:
+      audiomixer_orc_add_s16 (out, in, num_samples);
+      break;
+    case GST_AUDIO_FORMAT_U32:
+      audiomixer_orc_add_u32 (out, in, num_samples);
+      break;
+    case GST_AUDIO_FORMAT_S32:
+      audiomixer_orc_add_s32 (out, in, num_samples);
+      break;
+    case GST_AUDIO_FORMAT_F32:
+      audiomixer_orc_add_f32 (out, in, num_samples);
+      break;
+    case GST_AUDIO_FORMAT_F64:
+      audiomixer_orc_add_f64 (out, in, num_samples);
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+}
+
+/* Subtracts num_samples samples in from out, by adding them with the
+ * negated unity volume. Only possible for signed and float formats */
+static void
+gst_audiomixer_subtract (GstAudioFormat format, gpointer out, gpointer in,
+    guint num_samples)
+{
+  switch (format) {
+    case GST_AUDIO_FORMAT_S8:
+      audiomixer_orc_add_volume_s8 (out, in, -VOLUME_UNITY_INT8, num_samples);
+      break;
+    case GST_AUDIO_FORMAT_S16:
+      audiomixer_orc_add_volume_s16 (out, in, -VOLUME_UNITY_INT16,
+          num_samples);
+      break;
+    case GST_AUDIO_FORMAT_S32:
+      audiomixer_orc_add_volume_s32 (out, in, -VOLUME_UNITY_INT32,
+          num_samples);
+      break;
+    case GST_AUDIO_FORMAT_F32:
+      audiomixer_orc_add_volume_f32 (out, in, -1.0, num_samples);
+      break;
+    case GST_AUDIO_FORMAT_F64:
+      audiomixer_orc_add_volume_f64 (out, in, -1.0, num_samples);
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+}
+
+/* Called with pad object lock held */
+static void
+gst_audiomixer_mix_frames (GstAudioAggregator * aagg, GstAudioMixerPad * pad,
+    guint8 * out, guint8 * in, guint num_frames, guint ramp_frames)
+{
+  GstAudioFormat format = GST_AUDIO_INFO_FORMAT (&aagg->info);
+  gint bpf = GST_AUDIO_INFO_BPF (&aagg->info);
+
+  /* ramp the volume over the first frames if it changed, and mix the
+   * remaining frames with the constant volume below */
+  if (ramp_frames > 0) {
+    gpointer gains = gst_audiomixer_pad_fill_ramp (pad, format,
+        aagg->info.channels, ramp_frames);
+
+    switch (format) {
       case GST_AUDIO_FORMAT_S16:
-        audiomixer_orc_add_s16 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
-        break;
-      case GST_AUDIO_FORMAT_U32:
-        audiomixer_orc_add_u32 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_ramp_s16 ((gpointer) out, (gpointer) in,
+            gains, ramp_frames * aagg->info.channels);
         break;
       case GST_AUDIO_FORMAT_S32:
-        audiomixer_orc_add_s32 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_ramp_s32 ((gpointer) out, (gpointer) in,
+            gains, ramp_frames * aagg->info.channels);
         break;
       case GST_AUDIO_FORMAT_F32:
-        audiomixer_orc_add_f32 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_ramp_f32 ((gpointer) out, (gpointer) in,
+            gains, ramp_frames * aagg->info.channels);
         break;
       case GST_AUDIO_FORMAT_F64:
-        audiomixer_orc_add_f64 ((gpointer) (outmap.data + out_offset * bpf),
-            (gpointer) (inmap.data + in_offset * bpf),
-            num_frames * aagg->info.channels);
+        audiomixer_orc_add_volume_ramp_f64 ((gpointer) out, (gpointer) in,
+            gains, ramp_frames * aagg->info.channels);
         break;
       default:
         g_assert_not_reached ();
         break;
     }
+
+    out += ramp_frames * bpf;
+    in += ramp_frames * bpf;
+    num_frames -= ramp_frames;
+
+    /* muted at the end of the ramp, nothing else to add */
+    if (num_frames == 0 || pad->ramp_end < G_MINDOUBLE)
+      return;
+  }
+
+  if (pad->volume == 1.0) {
+    gst_audiomixer_add (format, out, in, num_frames * aagg->info.channels);
   } else {
-    switch (aagg->info.finfo->format) {
+    switch (format) {
       case GST_AUDIO_FORMAT_U8:
-        audiomixer_orc_add_volume_u8 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
+        audiomixer_orc_add_volume_u8 ((gpointer) out, (gpointer) in,
             pad->volume_i8, num_frames * aagg->info.channels);
         break;
       case GST_AUDIO_FORMAT_S8:
-        audiomixer_orc_add_volume_s8 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
+        audiomixer_orc_add_volume_s8 ((gpointer) out, (gpointer) in,
             pad->volume_i8, num_frames * aagg->info.channels);
         break;
       case GST_AUDIO_FORMAT_U16:
-        audiomixer_orc_add_volume_u16 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
+        audiomixer_orc_add_volume_u16 ((gpointer) out, (gpointer) in,
             pad->volume_i16, num_frames * aagg->info.channels);
         break;
       case GST_AUDIO_FORMAT_S16:
-        audiomixer_orc_add_volume_s16 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
+        audiomixer_orc_add_volume_s16 ((gpointer) out, (gpointer) in,
             pad->volume_i16, num_frames * aagg->info.channels);
         break;
       case GST_AUDIO_FORMAT_U32:
-        audiomixer_orc_add_volume_u32 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
+        audiomixer_orc_add_volume_u32 ((gpointer) out, (gpointer) in,
             pad->volume_i32, num_frames * aagg->info.channels);
         break;
       case GST_AUDIO_FORMAT_S32:
-        audiomixer_orc_add_volume_s32 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
+        audiomixer_orc_add_volume_s32 ((gpointer) out, (gpointer) in,
             pad->volume_i32, num_frames * aagg->info.channels);
         break;
       case GST_AUDIO_FORMAT_F32:
-        audiomixer_orc_add_volume_f32 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
+        audiomixer_orc_add_volume_f32 ((gpointer) out, (gpointer) in,
             pad->volume, num_frames * aagg->info.channels);
         break;
       case GST_AUDIO_FORMAT_F64:
-        audiomixer_orc_add_volume_f64 ((gpointer) (outmap.data +
-                out_offset * bpf), (gpointer) (inmap.data + in_offset * bpf),
+        audiomixer_orc_add_volume_f64 ((gpointer) out, (gpointer) in,
             pad->volume, num_frames * aagg->info.channels);
         break;
       default:
@@ -733,12 +1121,359 @@ gst_audiomixer_aggregate_one_buffer (GstAudioAggregator * aagg,
         break;
     }
   }
+}
+
+/* Called with object lock and pad object lock held.
+ *
+ * Makes sure the pad has a contribution buffer of the given size, which
+ * is silent unless the pad already contributed to the current output
+ * buffer */
+static void
+gst_audiomixer_pad_prepare_contribution (GstAudioAggregator * aagg,
+    GstAudioMixerPad * pad, gsize size)
+{
+  GstMapInfo map;
+
+  if (pad->contribution && gst_buffer_get_size (pad->contribution) == size)
+    return;
+
+  gst_buffer_replace (&pad->contribution, NULL);
+  pad->contribution = gst_buffer_new_allocate (NULL, size, NULL);
+
+  gst_buffer_map (pad->contribution, &map, GST_MAP_WRITE);
+  gst_audio_format_fill_silence (aagg->info.finfo, map.data, map.size);
+  gst_buffer_unmap (pad->contribution, &map);
+  pad->contribution_used = FALSE;
+}
+
+/* Called with object lock and pad object lock held.
+ *
+ * Mixing into silence at unity gain is a plain copy, in which case the
+ * input buffer can be used as output buffer directly */
+static gboolean
+gst_audiomixer_can_reuse_input_buffer (GstAudioAggregator * aagg,
+    GstAudioAggregatorPad * aaggpad, GstBuffer * inbuf)
+{
+  GstAudioMixer *audiomixer = GST_AUDIO_MIXER (aagg);
+  GstAudioMixerPad *pad = GST_AUDIO_MIXER_PAD (aaggpad);
+
+  /* The contribution has to be recorded for the mix-minus output */
+  if (audiomixer->mix_minus && pad->minus_srcpad)
+    return FALSE;
+
+  /* Volume and ramp state are only updated when actually mixing */
+  if (!pad->ramp_primed || pad->ramp_position < pad->ramp_length)
+    return FALSE;
+
+  return !pad->mute && pad->volume == 1.0 && pad->ramp_end == 1.0;
+}
+
+/* Called with object lock and pad object lock held */
+static gboolean
+gst_audiomixer_aggregate_one_buffer (GstAudioAggregator * aagg,
+    GstAudioAggregatorPad * aaggpad, GstBuffer * inbuf, guint in_offset,
+    GstBuffer * outbuf, guint out_offset, guint num_frames)
+{
+  GstAudioMixer *audiomixer = GST_AUDIO_MIXER (aagg);
+  GstAudioMixerPad *pad = GST_AUDIO_MIXER_PAD (aaggpad);
+  GstAudioFormat format = GST_AUDIO_INFO_FORMAT (&aagg->info);
+  GstMapInfo inmap;
+  GstMapInfo outmap;
+  GstMapInfo contribmap;
+  guint8 *out, *in;
+  guint ramp_frames = 0;
+  gint bpf;
+
+  bpf = GST_AUDIO_INFO_BPF (&aagg->info);
+
+  gst_audiomixer_pad_update_ramp (pad, format,
+      gst_buffer_get_size (outbuf) / bpf);
+
+  if (pad->ramp_position < pad->ramp_length)
+    ramp_frames = MIN (num_frames, pad->ramp_length - pad->ramp_position);
+
+  if (ramp_frames == 0 && pad->ramp_end < G_MINDOUBLE) {
+    GST_DEBUG_OBJECT (pad, "Skipping muted pad");
+    return FALSE;
+  }
+
+  gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE);
+  gst_buffer_map (inbuf, &inmap, GST_MAP_READ);
+  GST_LOG_OBJECT (pad, "mixing %u bytes at offset %u from offset %u",
+      num_frames * bpf, out_offset * bpf, in_offset * bpf);
+
+  out = outmap.data + out_offset * bpf;
+  in = inmap.data + in_offset * bpf;
+
+  if (audiomixer->mix_minus && pad->minus_srcpad) {
+    /* Remember what this pad adds, so that it can be subtracted
+     * from the complete mix again for its mix-minus output */
+    gst_audiomixer_pad_prepare_contribution (aagg, pad,
+        gst_buffer_get_size (outbuf));
+    gst_buffer_map (pad->contribution, &contribmap, GST_MAP_READWRITE);
+
+    gst_audiomixer_mix_frames (aagg, pad, contribmap.data + out_offset * bpf,
+        in, num_frames, ramp_frames);
+    gst_audiomixer_add (format, out, contribmap.data + out_offset * bpf,
+        num_frames * aagg->info.channels);
+
+    gst_buffer_unmap (pad->contribution, &contribmap);
+    pad->contribution_used = TRUE;
+  } else {
+    gst_audiomixer_mix_frames (aagg, pad, out, in, num_frames, ramp_frames);
+  }
+
   gst_buffer_unmap (inbuf, &inmap);
   gst_buffer_unmap (outbuf, &outmap);
 
   return TRUE;
 }
 
+typedef struct
+{
+  GstPad *srcpad;
+  GstBuffer *buffer;
+  gboolean need_segment;
+} GstAudioMixerMinusOutput;
+
+static void
+gst_audiomixer_minus_pad_push_events (GstAudioMixer * audiomixer,
+    GstPad * srcpad, GstCaps * caps, const GstSegment * segment,
+    gboolean need_segment)
+{
+  GstCaps *current_caps;
+  GstEvent *event;
+
+  event = gst_pad_get_sticky_event (srcpad, GST_EVENT_STREAM_START, 0);
+  if (event) {
+    gst_event_unref (event);
+  } else {
+    gchar *stream_id;
+
+    stream_id = gst_pad_create_stream_id (srcpad,
+        GST_ELEMENT_CAST (audiomixer), GST_PAD_NAME (srcpad));
+    gst_pad_push_event (srcpad, gst_event_new_stream_start (stream_id));
+    g_free (stream_id);
+  }
+
+  current_caps = gst_pad_get_current_caps (srcpad);
+  if (caps && (!current_caps || !gst_caps_is_equal (caps, current_caps)))
+    gst_pad_push_event (srcpad, gst_event_new_caps (caps));
+  if (current_caps)
+    gst_caps_unref (current_caps);
+
+  if (need_segment)
+    gst_pad_push_event (srcpad, gst_event_new_segment (segment));
+}
+
+/* Calculates the mix-minus output of every pad from the complete mix
+ * and pushes them downstream */
+static GstFlowReturn
+gst_audiomixer_output_buffer (GstAudioAggregator * aagg, GstBuffer * outbuf)
+{
+  GstAudioMixer *audiomixer = GST_AUDIO_MIXER (aagg);
+  GstAggregator *agg = GST_AGGREGATOR (aagg);
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstAudioFormat format;
+  GstSegment segment;
+  GstCaps *caps;
+  GstMapInfo summap;
+  GList *outputs = NULL, *l;
+  gint bps;
+
+  GST_OBJECT_LOCK (audiomixer);
+  if (!audiomixer->mix_minus) {
+    GST_OBJECT_UNLOCK (audiomixer);
+    return GST_FLOW_OK;
+  }
+
+  caps = aagg->current_caps ? gst_caps_ref (aagg->current_caps) : NULL;
+  gst_segment_copy_into (&agg->segment, &segment);
+  format = GST_AUDIO_INFO_FORMAT (&aagg->info);
+  bps = GST_AUDIO_INFO_BPS (&aagg->info);
+
+  gst_buffer_map (outbuf, &summap, GST_MAP_READ);
+
+  for (l = GST_ELEMENT_CAST (audiomixer)->sinkpads; l; l = l->next) {
+    GstAudioMixerPad *pad = l->data;
+    GstAudioMixerMinusOutput *output;
+    GstMapInfo map;
+
+    GST_OBJECT_LOCK (pad);
+    if (!pad->minus_srcpad) {
+      GST_OBJECT_UNLOCK (pad);
+      continue;
+    }
+
+    output = g_slice_new (GstAudioMixerMinusOutput);
+    output->srcpad = gst_object_ref (pad->minus_srcpad);
+    output->need_segment = pad->minus_need_segment;
+    pad->minus_need_segment = FALSE;
+
+    output->buffer = gst_buffer_new_allocate (NULL, summap.size, NULL);
+    gst_buffer_copy_into (output->buffer, outbuf, GST_BUFFER_COPY_METADATA, 0,
+        -1);
+
+    gst_buffer_map (output->buffer, &map, GST_MAP_WRITE);
+    memcpy (map.data, summap.data, summap.size);
+    if (pad->contribution_used) {
+      GstMapInfo contribmap;
+
+      gst_buffer_map (pad->contribution, &contribmap, GST_MAP_READWRITE);
+      gst_audiomixer_subtract (format, map.data, contribmap.data,
+          MIN (map.size, contribmap.size) / bps);
+      gst_audio_format_fill_silence (aagg->info.finfo, contribmap.data,
+          contribmap.size);
+      gst_buffer_unmap (pad->contribution, &contribmap);
+      pad->contribution_used = FALSE;
+    }
+    gst_buffer_unmap (output->buffer, &map);
+    GST_OBJECT_UNLOCK (pad);
+
+    outputs = g_list_prepend (outputs, output);
+  }
+
+  gst_buffer_unmap (outbuf, &summap);
+  GST_OBJECT_UNLOCK (audiomixer);
+
+  outputs = g_list_reverse (outputs);
+  for (l = outputs; l; l = l->next) {
+    GstAudioMixerMinusOutput *output = l->data;
+    GstFlowReturn push_ret;
+
+    gst_audiomixer_minus_pad_push_events (audiomixer, output->srcpad, caps,
+        &segment, output->need_segment);
+
+    /* An unlinked mix-minus pad must not stop the complete mix, and one
+     * is flushed before the sink pads when seeking */
+    push_ret = gst_pad_push (output->srcpad, output->buffer);
+    if (push_ret != GST_FLOW_OK && push_ret != GST_FLOW_NOT_LINKED &&
+        push_ret != GST_FLOW_FLUSHING) {
+      GST_DEBUG_OBJECT (output->srcpad, "Pushing mix-minus buffer failed: %s",
+          gst_flow_get_name (push_ret));
+      if (ret == GST_FLOW_OK)
+        ret = push_ret;
+    }
+
+    gst_object_unref (output->srcpad);
+    g_slice_free (GstAudioMixerMinusOutput, output);
+  }
+  g_list_free (outputs);
+
+  if (caps)
+    gst_caps_unref (caps);
+
+  return ret;
+}
+
+static GList *
+gst_audiomixer_get_minus_pads (GstAudioMixer * audiomixer)
+{
+  GList *srcpads = NULL, *l;
+
+  GST_OBJECT_LOCK (audiomixer);
+  for (l = GST_ELEMENT_CAST (audiomixer)->sinkpads; l; l = l->next) {
+    GstAudioMixerPad *pad = l->data;
+
+    GST_OBJECT_LOCK (pad);
+    if (pad->minus_srcpad)
+      srcpads = g_list_prepend (srcpads, gst_object_ref (pad->minus_srcpad));
+    GST_OBJECT_UNLOCK (pad);
+  }
+  GST_OBJECT_UNLOCK (audiomixer);
+
+  return srcpads;
+}
+
+/* Takes ownership of @event */
+static void
+gst_audiomixer_push_minus_event (GstAudioMixer * audiomixer, GstEvent * event)
+{
+  GList *srcpads, *l;
+
+  srcpads = gst_audiomixer_get_minus_pads (audiomixer);
+  for (l = srcpads; l; l = l->next)
+    gst_pad_push_event (GST_PAD_CAST (l->data), gst_event_ref (event));
+  g_list_free_full (srcpads, gst_object_unref);
+  gst_event_unref (event);
+}
+
+static gboolean
+gst_audiomixer_src_event (GstAggregator * agg, GstEvent * event)
+{
+  GstAudioMixer *audiomixer = GST_AUDIO_MIXER (agg);
+  GstSeekFlags flags = 0;
+  guint32 seqnum;
+  gboolean res;
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_SEEK)
+    gst_event_parse_seek (event, NULL, NULL, &flags, NULL, NULL, NULL, NULL);
+  seqnum = gst_event_get_seqnum (event);
+
+  /* The base class only flushes the always src pad, and waits for the
+   * streaming thread, which can be blocked downstream of a mix-minus pad.
+   * Flush them before the seek goes upstream, the flush-stop is sent from
+   * flush() once the sink pads are flushed. */
+  if (flags & GST_SEEK_FLAG_FLUSH) {
+    GstEvent *flush_start = gst_event_new_flush_start ();
+
+    gst_event_set_seqnum (flush_start, seqnum);
+    gst_audiomixer_push_minus_event (audiomixer, flush_start);
+  }
+
+  res = GST_AGGREGATOR_CLASS (parent_class)->src_event (agg, event);
+
+  if ((flags & GST_SEEK_FLAG_FLUSH) && !res) {
+    GstEvent *flush_stop = gst_event_new_flush_stop (TRUE);
+
+    gst_event_set_seqnum (flush_stop, seqnum);
+    gst_audiomixer_push_minus_event (audiomixer, flush_stop);
+  }
+
+  return res;
+}
+
+static GstFlowReturn
+gst_audiomixer_aggregate (GstAggregator * agg, gboolean timeout)
+{
+  GstFlowReturn ret;
+
+  ret = GST_AGGREGATOR_CLASS (parent_class)->aggregate (agg, timeout);
+
+  /* The base class only forwards EOS on the always src pad, which it
+   * also does after an error */
+  if (ret == GST_FLOW_EOS || ret == GST_FLOW_ERROR)
+    gst_audiomixer_push_minus_event (GST_AUDIO_MIXER (agg),
+        gst_event_new_eos ());
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_audiomixer_flush (GstAggregator * agg)
+{
+  GList *l;
+
+  GST_OBJECT_LOCK (agg);
+  for (l = GST_ELEMENT_CAST (agg)->sinkpads; l; l = l->next) {
+    GstAudioMixerPad *pad = l->data;
+
+    GST_OBJECT_LOCK (pad);
+    gst_buffer_replace (&pad->contribution, NULL);
+    pad->contribution_used = FALSE;
+    if (pad->minus_srcpad)
+      pad->minus_need_segment = TRUE;
+    GST_OBJECT_UNLOCK (pad);
+  }
+  GST_OBJECT_UNLOCK (agg);
+
+  /* Only called when a flushing seek is done, right before the always src
+   * pad gets its flush-stop */
+  gst_audiomixer_push_minus_event (GST_AUDIO_MIXER (agg),
+      gst_event_new_flush_stop (TRUE));
+
+  return GST_AGGREGATOR_CLASS (parent_class)->flush (agg);
+}
 
 /* GstChildProxy implementation */
 static GObject *
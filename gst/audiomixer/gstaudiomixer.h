@@ -53,6 +53,9 @@ struct _GstAudioMixer {
 
   /* target caps (set via property) */
   GstCaps *filter_caps;
+
+  /* output one mix-minus src pad per sink pad */
+  gboolean mix_minus;
 };
 
 struct _GstAudioMixerClass {
@@ -76,6 +79,27 @@ struct _GstAudioMixerPad {
   gint volume_i16;
   gint volume_i8;
   gboolean mute;
+
+  /* volume ramp state, protected by the pad object lock.
+   * Volume and mute changes are applied as a linear gain ramp over
+   * one output buffer instead of a step */
+  gboolean ramp_primed;
+  gdouble ramp_start;
+  gdouble ramp_end;
+  guint ramp_length;            /* in frames */
+  guint ramp_position;          /* in frames */
+
+  /* scratch memory holding the per-sample gains of a ramp */
+  gpointer ramp_gains;
+  gsize ramp_gains_size;
+
+  /* mix-minus mode, protected by the pad object lock: the src pad
+   * outputting the mix of all other pads, and what this pad added to the
+   * current output buffer */
+  GstPad *minus_srcpad;
+  gboolean minus_need_segment;
+  GstBuffer *contribution;
+  gboolean contribution_used;
 };
 
 struct _GstAudioMixerPadClass {
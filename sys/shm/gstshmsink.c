@@ -56,17 +56,23 @@ enum
   PROP_PERMS,
   PROP_SHM_SIZE,
   PROP_WAIT_FOR_CONNECTION,
-  PROP_BUFFER_TIME
+  PROP_BUFFER_TIME,
+  PROP_USE_RINGS,
+  PROP_FRAGMENTATION
 };
 
 struct GstShmClient
 {
   ShmClient *client;
   GstPollFD pollfd;
+  GstPollFD notifypollfd;
+  /* the dropped buffers already warned about */
+  guint dropped;
 };
 
 #define DEFAULT_SIZE ( 64 * 1024 * 1024 )
 #define DEFAULT_WAIT_FOR_CONNECTION (TRUE)
+#define DEFAULT_USE_RINGS (FALSE)
 /* Default is user read/write, group read */
 #define DEFAULT_PERMS ( S_IRUSR | S_IWUSR | S_IRGRP )
 
@@ -348,6 +354,7 @@ gst_shm_sink_init (GstShmSink * self)
   g_cond_init (&self->cond);
   self->size = DEFAULT_SIZE;
   self->wait_for_connection = DEFAULT_WAIT_FOR_CONNECTION;
+  self->use_rings = DEFAULT_USE_RINGS;
   self->perms = DEFAULT_PERMS;
 
   gst_allocation_params_init (&self->params);
@@ -411,6 +418,22 @@ gst_shm_sink_class_init (GstShmSinkClass * klass)
           -1, G_MAXINT64, -1,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_USE_RINGS,
+      g_param_spec_boolean ("use-rings",
+          "Use shared memory rings",
+          "Pass buffers to the clients that connect afterwards through "
+          "lock-free rings in shared memory instead of the control socket, "
+          "saving a few system calls per buffer and client. The clients "
+          "must support it. Only available on Linux",
+          DEFAULT_USE_RINGS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FRAGMENTATION,
+      g_param_spec_uint ("fragmentation",
+          "Fragmentation of the shared memory area",
+          "Percentage of the free space of the shared memory area that is "
+          "not in its largest free block",
+          0, 100, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   signals[SIGNAL_CLIENT_CONNECTED] = g_signal_new ("client-connected",
       GST_TYPE_SHM_SINK, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
       g_cclosure_marshal_VOID__INT, G_TYPE_NONE, 1, G_TYPE_INT);
@@ -500,6 +523,15 @@ gst_shm_sink_set_property (GObject * object, guint prop_id,
       GST_OBJECT_UNLOCK (object);
       g_cond_broadcast (&self->cond);
       break;
+    case PROP_USE_RINGS:
+      GST_OBJECT_LOCK (object);
+      self->use_rings = g_value_get_boolean (value);
+      if (self->pipe)
+        ret = !sp_writer_set_use_rings (self->pipe, self->use_rings);
+      GST_OBJECT_UNLOCK (object);
+      if (ret)
+        GST_WARNING_OBJECT (object, "Shared memory rings are not supported");
+      break;
     default:
       break;
   }
@@ -529,6 +561,13 @@ gst_shm_sink_get_property (GObject * object, guint prop_id,
     case PROP_BUFFER_TIME:
       g_value_set_int64 (value, self->buffer_time);
       break;
+    case PROP_USE_RINGS:
+      g_value_set_boolean (value, self->use_rings);
+      break;
+    case PROP_FRAGMENTATION:
+      g_value_set_uint (value,
+          self->pipe ? sp_writer_get_fragmentation (self->pipe) : 0);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -565,6 +604,8 @@ gst_shm_sink_start (GstBaseSink * bsink)
   }
 
   sp_set_data (self->pipe, self);
+  if (!sp_writer_set_use_rings (self->pipe, self->use_rings))
+    GST_WARNING_OBJECT (self, "Shared memory rings are not supported");
   g_free (self->socket_path);
   self->socket_path = g_strdup (sp_writer_get_path (self->pipe));
 
@@ -663,6 +704,7 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   GstFlowReturn ret = GST_FLOW_OK;
   GstMemory *memory = NULL;
   GstBuffer *sendbuf = NULL;
+  GList *item;
 
   GST_OBJECT_LOCK (self);
   while (self->wait_for_connection && !self->clients) {
@@ -742,6 +784,17 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
 
   gst_buffer_unmap (sendbuf, &map);
 
+  for (item = self->clients; item; item = item->next) {
+    struct GstShmClient *gclient = item->data;
+    guint dropped = sp_writer_get_client_dropped (gclient->client);
+
+    if (dropped != gclient->dropped) {
+      GST_WARNING_OBJECT (self, "Could not send %u buffers to client %d",
+          dropped - gclient->dropped, gclient->pollfd.fd);
+      gclient->dropped = dropped;
+    }
+  }
+
   GST_OBJECT_UNLOCK (self);
 
   if (rv == 0) {
@@ -822,7 +875,17 @@ pollthread_func (gpointer data)
       gclient->pollfd.fd = sp_writer_get_client_fd (client);
       gst_poll_add_fd (self->poll, &gclient->pollfd);
       gst_poll_fd_ctl_read (self->poll, &gclient->pollfd, TRUE);
+      /* the client acks the buffers through the ring */
+      gst_poll_fd_init (&gclient->notifypollfd);
+      gclient->notifypollfd.fd = sp_writer_get_client_notify_fd (client);
+      if (gclient->notifypollfd.fd >= 0) {
+        gst_poll_add_fd (self->poll, &gclient->notifypollfd);
+        gst_poll_fd_ctl_read (self->poll, &gclient->notifypollfd, TRUE);
+      }
+      gclient->dropped = 0;
+      GST_OBJECT_LOCK (self);
       self->clients = g_list_prepend (self->clients, gclient);
+      GST_OBJECT_UNLOCK (self);
       g_signal_emit (self, signals[SIGNAL_CLIENT_CONNECTED], 0,
           gclient->pollfd.fd);
       /* we need to call gst_poll_wait before calling gst_poll_* status
@@ -866,6 +929,24 @@ pollthread_func (gpointer data)
         if (rv == 0)
           gst_buffer_unref (tag);
       }
+
+      if (gclient->notifypollfd.fd >= 0 &&
+          gst_poll_fd_can_read (self->poll, &gclient->notifypollfd)) {
+        GSList *list = NULL;
+        int rv;
+
+        GST_OBJECT_LOCK (self);
+        rv = sp_writer_recv_releases (self->pipe, gclient->client,
+            (sp_buffer_free_callback) free_buffer_locked, (void **) &list);
+        GST_OBJECT_UNLOCK (self);
+        g_slist_free_full (list, (GDestroyNotify) gst_buffer_unref);
+
+        if (rv < 0) {
+          GST_WARNING_OBJECT (self, "One client has corrupted its ring,"
+              " closing (retval: %d)", rv);
+          goto close_client;
+        }
+      }
       continue;
     close_client:
       {
@@ -873,12 +954,14 @@ pollthread_func (gpointer data)
         GST_OBJECT_LOCK (self);
         sp_writer_close_client (self->pipe, gclient->client,
             (sp_buffer_free_callback) free_buffer_locked, (void **) &list);
+        self->clients = g_list_remove (self->clients, gclient);
         GST_OBJECT_UNLOCK (self);
         g_slist_free_full (list, (GDestroyNotify) gst_buffer_unref);
       }
 
       gst_poll_remove_fd (self->poll, &gclient->pollfd);
-      self->clients = g_list_remove (self->clients, gclient);
+      if (gclient->notifypollfd.fd >= 0)
+        gst_poll_remove_fd (self->poll, &gclient->notifypollfd);
 
       g_signal_emit (self, signals[SIGNAL_CLIENT_DISCONNECTED], 0,
           gclient->pollfd.fd);
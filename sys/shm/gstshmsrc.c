@@ -155,6 +155,7 @@ gst_shm_src_init (GstShmSrc * self)
 {
   self->poll = gst_poll_new (TRUE);
   gst_poll_fd_init (&self->pollfd);
+  gst_poll_fd_init (&self->notifypollfd);
 }
 
 static void
@@ -278,6 +279,10 @@ gst_shm_src_stop_reading (GstShmSrc * self)
   gst_poll_remove_fd (self->poll, &self->pollfd);
   gst_poll_fd_init (&self->pollfd);
 
+  if (self->notifypollfd.fd >= 0)
+    gst_poll_remove_fd (self->poll, &self->notifypollfd);
+  gst_poll_fd_init (&self->notifypollfd);
+
   gst_poll_set_flushing (self->poll, TRUE);
 }
 
@@ -327,6 +332,21 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   struct GstShmBuffer *gsb;
 
   do {
+    /* With the rings, new buffers only wake us up if the pipe has seen the
+     * ring empty, so look there before sleeping */
+    if (self->notifypollfd.fd >= 0) {
+      GST_OBJECT_LOCK (self);
+      rv = sp_client_recv (self->pipe->pipe, &buf);
+      GST_OBJECT_UNLOCK (self);
+      if (rv < 0) {
+        GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
+            ("Error reading control data: %d", rv));
+        return GST_FLOW_ERROR;
+      }
+      if (buf)
+        break;
+    }
+
     if (gst_poll_wait (self->poll, GST_CLOCK_TIME_NONE) < 0) {
       if (errno == EBUSY)
         return GST_FLOW_FLUSHING;
@@ -350,7 +370,9 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
       return GST_FLOW_ERROR;
     }
 
-    if (gst_poll_fd_can_read (self->poll, &self->pollfd)) {
+    if (gst_poll_fd_can_read (self->poll, &self->pollfd) ||
+        (self->notifypollfd.fd >= 0 &&
+            gst_poll_fd_can_read (self->poll, &self->notifypollfd))) {
       buf = NULL;
       GST_LOG_OBJECT (self, "Reading from pipe");
       GST_OBJECT_LOCK (self);
@@ -362,6 +384,14 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
         return GST_FLOW_ERROR;
       }
     }
+
+    /* The sink has switched the pipe to the rings */
+    if (self->notifypollfd.fd < 0 &&
+        sp_client_get_notify_fd (self->pipe->pipe) >= 0) {
+      self->notifypollfd.fd = sp_client_get_notify_fd (self->pipe->pipe);
+      gst_poll_add_fd (self->poll, &self->notifypollfd);
+      gst_poll_fd_ctl_read (self->poll, &self->notifypollfd, TRUE);
+    }
   } while (buf == NULL);
 
   GST_LOG_OBJECT (self, "Got buffer %p of size %d", buf, rv);
@@ -52,6 +52,7 @@ struct _GstShmSrc
   GstShmPipe *pipe;
   GstPoll *poll;
   GstPollFD pollfd;
+  GstPollFD notifypollfd;
 
 
   GstFlowReturn flow_return;
@@ -33,19 +33,44 @@
 #include <string.h>
 #include <assert.h>
 
+/*
+ * The free blocks are kept in segregated lists as in TLSF: the first level
+ * index is the power of two just below the size of the block, the second
+ * level splits each power of two into SL_COUNT ranges of the same width.
+ * Two bitmaps tell which lists are not empty, so finding a big enough
+ * block takes constant time. The used blocks are kept in a treap ordered
+ * by offset to find them from an address in logarithmic time, and all the
+ * blocks are chained in offset order to merge free neighbours when a block
+ * is freed.
+ */
+#define SL_SHIFT 3
+#define SL_COUNT (1 << SL_SHIFT)
+#define FL_COUNT ((int) sizeof (unsigned long) * 8)
+
 /* This is the allocated space to hold multiple blocks */
 struct _ShmAllocSpace
 {
   /* The total size of this space */
   size_t size;
 
-  /* chained list of the blocks contained in this space */
+  /* chained list of all the blocks, used or free, in offset order */
   ShmAllocBlock *blocks;
+
+  /* tree of the used blocks */
+  ShmAllocBlock *used;
+  unsigned int seed;
+
+  /* the free blocks, by size class */
+  unsigned long free_size;
+  unsigned long fl_bitmap;
+  unsigned int sl_bitmap[FL_COUNT];
+  ShmAllocBlock *free_lists[FL_COUNT][SL_COUNT];
 };
 
 /* A single block of data */
 struct _ShmAllocBlock
 {
+  /* 0 if the block is free */
   int use_count;
 
   /* Pointer back to the AllocSpace where this block is */
@@ -56,19 +81,219 @@ struct _ShmAllocBlock
   /* The size of the block */
   unsigned long size;
 
-  /* Pointer to the next block in the chain */
+  /* The neighbours of this block in the space */
+  ShmAllocBlock *prev;
   ShmAllocBlock *next;
+
+  /* The neighbours in the free list of a free block, or the children in
+   * the tree of a used block */
+  ShmAllocBlock *left;
+  ShmAllocBlock *right;
+  unsigned int priority;
 };
 
+static int
+fls_ulong (unsigned long x)
+{
+  int i = -1;
+
+  while (x) {
+    x >>= 1;
+    i++;
+  }
+
+  return i;
+}
+
+static int
+ffs_ulong (unsigned long x)
+{
+  int i = 0;
+
+  assert (x);
+  while (!(x & 1)) {
+    x >>= 1;
+    i++;
+  }
+
+  return i;
+}
+
+static void
+mapping (unsigned long size, int *fl, int *sl)
+{
+  int f;
+
+  if (size < SL_COUNT) {
+    *fl = 0;
+    *sl = size;
+  } else {
+    f = fls_ulong (size);
+    *fl = f - SL_SHIFT + 1;
+    *sl = (size >> (f - SL_SHIFT)) ^ SL_COUNT;
+  }
+}
+
+static void
+insert_free_block (ShmAllocSpace * self, ShmAllocBlock * block)
+{
+  int fl, sl;
+
+  mapping (block->size, &fl, &sl);
+
+  block->left = NULL;
+  block->right = self->free_lists[fl][sl];
+  if (block->right)
+    block->right->left = block;
+  self->free_lists[fl][sl] = block;
+
+  self->fl_bitmap |= 1UL << fl;
+  self->sl_bitmap[fl] |= 1U << sl;
+  self->free_size += block->size;
+}
+
+static void
+remove_free_block (ShmAllocSpace * self, ShmAllocBlock * block)
+{
+  int fl, sl;
+
+  mapping (block->size, &fl, &sl);
+
+  if (block->left)
+    block->left->right = block->right;
+  else
+    self->free_lists[fl][sl] = block->right;
+  if (block->right)
+    block->right->left = block->left;
+
+  if (!self->free_lists[fl][sl]) {
+    self->sl_bitmap[fl] &= ~(1U << sl);
+    if (!self->sl_bitmap[fl])
+      self->fl_bitmap &= ~(1UL << fl);
+  }
+  self->free_size -= block->size;
+}
+
+/* Returns a free block of at least @size bytes, or NULL */
+static ShmAllocBlock *
+find_free_block (ShmAllocSpace * self, unsigned long size)
+{
+  ShmAllocBlock *block;
+  unsigned long rounded = size;
+  unsigned long fl_map;
+  unsigned int sl_map;
+  int fl, sl;
+
+  /* Look in the lists whose blocks are all big enough first */
+  if (size >= SL_COUNT)
+    rounded += (1UL << (fls_ulong (size) - SL_SHIFT)) - 1;
+
+  if (rounded >= size) {
+    mapping (rounded, &fl, &sl);
+    sl_map = self->sl_bitmap[fl] & (~0U << sl);
+    if (!sl_map && fl + 1 < FL_COUNT) {
+      fl_map = self->fl_bitmap & (~0UL << (fl + 1));
+      if (fl_map) {
+        fl = ffs_ulong (fl_map);
+        sl_map = self->sl_bitmap[fl];
+      }
+    }
+    if (sl_map)
+      return self->free_lists[fl][ffs_ulong (sl_map)];
+  }
+
+  /* Otherwise only some blocks of the list of @size may be big enough */
+  mapping (size, &fl, &sl);
+  for (block = self->free_lists[fl][sl]; block; block = block->right) {
+    if (block->size >= size)
+      return block;
+  }
+
+  return NULL;
+}
+
+static ShmAllocBlock *
+rotate_right (ShmAllocBlock * node)
+{
+  ShmAllocBlock *left = node->left;
+
+  node->left = left->right;
+  left->right = node;
+  return left;
+}
+
+static ShmAllocBlock *
+rotate_left (ShmAllocBlock * node)
+{
+  ShmAllocBlock *right = node->right;
+
+  node->right = right->left;
+  right->left = node;
+  return right;
+}
+
+static ShmAllocBlock *
+tree_insert (ShmAllocBlock * root, ShmAllocBlock * block)
+{
+  if (!root)
+    return block;
+
+  if (block->offset < root->offset) {
+    root->left = tree_insert (root->left, block);
+    if (root->left->priority > root->priority)
+      root = rotate_right (root);
+  } else {
+    root->right = tree_insert (root->right, block);
+    if (root->right->priority > root->priority)
+      root = rotate_left (root);
+  }
+
+  return root;
+}
+
+static ShmAllocBlock *
+tree_remove (ShmAllocBlock * root, ShmAllocBlock * block)
+{
+  assert (root);
+
+  if (block->offset < root->offset) {
+    root->left = tree_remove (root->left, block);
+  } else if (block->offset > root->offset) {
+    root->right = tree_remove (root->right, block);
+  } else if (!root->left) {
+    return root->right;
+  } else if (!root->right) {
+    return root->left;
+  } else if (root->left->priority > root->right->priority) {
+    root = rotate_right (root);
+    root->right = tree_remove (root->right, block);
+  } else {
+    root = rotate_left (root);
+    root->left = tree_remove (root->left, block);
+  }
+
+  return root;
+}
 
 ShmAllocSpace *
 shm_alloc_space_new (size_t size)
 {
   ShmAllocSpace *self = spalloc_new (ShmAllocSpace);
+  ShmAllocBlock *block;
 
   memset (self, 0, sizeof (ShmAllocSpace));
 
   self->size = size;
+  self->seed = 2463534242U;
+
+  if (size > 0) {
+    block = spalloc_new (ShmAllocBlock);
+    memset (block, 0, sizeof (ShmAllocBlock));
+    block->space = self;
+    block->size = size;
+    self->blocks = block;
+    insert_free_block (self, block);
+  }
 
   return self;
 }
@@ -76,7 +301,15 @@ shm_alloc_space_new (size_t size)
 void
 shm_alloc_space_free (ShmAllocSpace * self)
 {
-  assert (self && self->blocks == NULL);
+  ShmAllocBlock *block;
+
+  assert (self && self->used == NULL);
+
+  while ((block = self->blocks)) {
+    self->blocks = block->next;
+    spalloc_free (ShmAllocBlock, block);
+  }
+
   spalloc_free (ShmAllocSpace, self);
 }
 
@@ -85,42 +318,46 @@ ShmAllocBlock *
 shm_alloc_space_alloc_block (ShmAllocSpace * self, unsigned long size)
 {
   ShmAllocBlock *block;
-  ShmAllocBlock *item = NULL;
-  ShmAllocBlock *prev_item = NULL;
-  unsigned long prev_end_offset = 0;
+  ShmAllocBlock *rest;
 
+  /* Every block needs an address of its own */
+  if (size == 0)
+    size = 1;
 
-  for (item = self->blocks; item; item = item->next) {
-    unsigned long max_size = 0;
-
-    max_size = item->offset - prev_end_offset;
+  if (size > self->free_size)
+    return NULL;
 
-    if (max_size >= size)
-      break;
+  block = find_free_block (self, size);
+  if (!block)
+    return NULL;
 
-    prev_end_offset = item->offset + item->size;
-    prev_item = item;
+  remove_free_block (self, block);
+
+  /* Give the end of the block back */
+  if (block->size > size) {
+    rest = spalloc_new (ShmAllocBlock);
+    memset (rest, 0, sizeof (ShmAllocBlock));
+    rest->space = self;
+    rest->offset = block->offset + size;
+    rest->size = block->size - size;
+    rest->prev = block;
+    rest->next = block->next;
+    if (rest->next)
+      rest->next->prev = rest;
+    block->next = rest;
+    block->size = size;
+    insert_free_block (self, rest);
   }
 
-  /* Return NULL if there is no big enough space, otherwise, there is space
-   * at the end */
-  assert (prev_end_offset <= self->size);
-  if (!item && self->size - prev_end_offset < size)
-    return NULL;
+  /* xorshift, only to keep the tree balanced */
+  self->seed ^= self->seed << 13;
+  self->seed ^= self->seed >> 17;
+  self->seed ^= self->seed << 5;
 
-  block = spalloc_new (ShmAllocBlock);
-  memset (block, 0, sizeof (ShmAllocBlock));
-  block->offset = prev_end_offset;
-  block->size = size;
   block->use_count = 1;
-  block->space = self;
-
-  if (prev_item)
-    prev_item->next = block;
-  else
-    self->blocks = block;
-
-  block->next = item;
+  block->priority = self->seed;
+  block->left = block->right = NULL;
+  self->used = tree_insert (self->used, block);
 
   return block;
 }
@@ -131,34 +368,52 @@ shm_alloc_space_alloc_block_get_offset (ShmAllocBlock * block)
   return block->offset;
 }
 
+/* Merges @next into @block, which must both be free */
+static void
+merge_blocks (ShmAllocBlock * block, ShmAllocBlock * next)
+{
+  block->size += next->size;
+  block->next = next->next;
+  if (block->next)
+    block->next->prev = block;
+  spalloc_free (ShmAllocBlock, next);
+}
+
 static void
 shm_alloc_space_free_block (ShmAllocBlock * block)
 {
-  ShmAllocBlock *item = NULL;
-  ShmAllocBlock *prev_item = NULL;
   ShmAllocSpace *self = block->space;
+  ShmAllocBlock *prev = block->prev;
+  ShmAllocBlock *next = block->next;
 
-  for (item = self->blocks; item; item = item->next) {
-    if (item == block) {
-      if (prev_item)
-        prev_item->next = item->next;
-      else
-        self->blocks = item->next;
-      break;
-    }
-    prev_item = item;
+  self->used = tree_remove (self->used, block);
+  block->use_count = 0;
+
+  if (next && next->use_count == 0) {
+    remove_free_block (self, next);
+    merge_blocks (block, next);
+  }
+
+  if (prev && prev->use_count == 0) {
+    remove_free_block (self, prev);
+    merge_blocks (prev, block);
+    block = prev;
   }
 
-  spalloc_free (ShmAllocBlock, block);
+  insert_free_block (self, block);
 }
 
 ShmAllocBlock *
 shm_alloc_space_block_get (ShmAllocSpace * self, unsigned long offset)
 {
-  ShmAllocBlock *block = NULL;
-
-  for (block = self->blocks; block; block = block->next) {
-    if (block->offset <= offset && (block->offset + block->size) > offset)
+  ShmAllocBlock *block = self->used;
+
+  while (block) {
+    if (offset < block->offset)
+      block = block->left;
+    else if (offset >= block->offset + block->size)
+      block = block->right;
+    else
       return block;
   }
 
@@ -180,3 +435,30 @@ shm_alloc_space_block_dec (ShmAllocBlock * block)
   if (block->use_count <= 0)
     shm_alloc_space_free_block (block);
 }
+
+unsigned long
+shm_alloc_space_get_free_size (ShmAllocSpace * self)
+{
+  return self->free_size;
+}
+
+unsigned long
+shm_alloc_space_get_largest_free_block (ShmAllocSpace * self)
+{
+  ShmAllocBlock *block;
+  unsigned long largest = 0;
+  int fl, sl;
+
+  if (!self->fl_bitmap)
+    return 0;
+
+  /* The largest block is in the highest non-empty list */
+  fl = fls_ulong (self->fl_bitmap);
+  sl = fls_ulong (self->sl_bitmap[fl]);
+  for (block = self->free_lists[fl][sl]; block; block = block->right) {
+    if (block->size > largest)
+      largest = block->size;
+  }
+
+  return largest;
+}
@@ -66,6 +66,9 @@ void shm_alloc_space_block_dec (ShmAllocBlock * block);
 ShmAllocBlock * shm_alloc_space_block_get (ShmAllocSpace * space,
     unsigned long offset);
 
+unsigned long shm_alloc_space_get_free_size (ShmAllocSpace * self);
+unsigned long shm_alloc_space_get_largest_free_block (ShmAllocSpace * self);
+
 
 #ifdef __cplusplus
 }
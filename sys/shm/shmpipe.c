@@ -47,6 +47,10 @@
 #include <sys/mman.h>
 #include <assert.h>
 
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+
 #include "shmalloc.h"
 
 /*
@@ -67,9 +71,20 @@
  * type 4: ack buffer
  * offset
  *
+ * type 5: new ring
+ * Size of the ring area
+ * Carries the fds of the ring area and of the two eventfds
+ *
  * Type 4 goes from the client to the server
  * The rest are from the server to the client
  * The client should never write in the SHM
+ *
+ * If the writer enables the rings, it sends a type 5 packet to each new
+ * client and then passes the buffers and their acks through a pair of
+ * single producer, single consumer rings in a separate area shared with
+ * that client only, instead of sending type 3 and 4 packets. A side only
+ * writes to the eventfd of the other side if it has announced that it is
+ * going to sleep, so a busy reader costs no syscall at all.
  */
 
 
@@ -80,11 +95,52 @@ enum
   COMMAND_NEW_SHM_AREA = 1,
   COMMAND_CLOSE_SHM_AREA = 2,
   COMMAND_NEW_BUFFER = 3,
-  COMMAND_ACK_BUFFER = 4
+  COMMAND_ACK_BUFFER = 4,
+  COMMAND_NEW_RING = 5
 };
 
+/* Must be a power of two */
+#define SHM_RING_SIZE 256
+/* The ring area, the buffer eventfd and the release eventfd */
+#define SHM_RING_N_FDS 3
+
 typedef struct _ShmArea ShmArea;
 
+typedef struct _ShmRingEntry
+{
+  uint32_t area_id;
+  uint32_t reserved;
+  uint64_t offset;
+  uint64_t size;
+} ShmRingEntry;
+
+typedef struct _ShmRing
+{
+  /* Only written by the producer */
+  uint32_t head;
+  char padding1[60];
+  /* Only written by the consumer */
+  uint32_t tail;
+  /* Set by the consumer before it sleeps, cleared by the producer when it
+   * wakes it up */
+  uint32_t waiting;
+  char padding2[56];
+  ShmRingEntry entries[SHM_RING_SIZE];
+} ShmRing;
+
+typedef struct _ShmRingArea
+{
+  ShmRing buffers;              /* from the writer to the reader */
+  ShmRing releases;             /* from the reader to the writer */
+} ShmRingArea;
+
+typedef struct _ShmRingLink
+{
+  ShmRingArea *area;
+  int buffer_fd;                /* signaled when the buffers ring fills */
+  int release_fd;               /* signaled when the releases ring fills */
+} ShmRingLink;
+
 struct _ShmArea
 {
   int id;
@@ -141,12 +197,24 @@ struct _ShmPipe
   ShmClient *clients;
 
   mode_t perms;
+
+  int use_rings;
+  ShmRingLink ring;             /* on the reader side only */
 };
 
 struct _ShmClient
 {
   int fd;
 
+  ShmRingLink ring;
+  /* buffers sent to a ring client and not acked yet */
+  int in_flight;
+  /* the ring was full, buffers go through the socket until the client has
+   * acked all of them */
+  int use_socket;
+  /* buffers that could not be sent to the client */
+  unsigned int dropped;
+
   ShmClient *next;
 };
 
@@ -179,6 +247,10 @@ struct CommandBuffer
     {
       unsigned long offset;
     } ack_buffer;
+    struct
+    {
+      unsigned long size;
+    } new_ring;
   } payload;
 };
 
@@ -187,6 +259,7 @@ static void sp_close_shm (ShmArea * area);
 static int sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf,
     ShmBuffer * prev_buf, ShmClient * client, void **tag);
 static void sp_shm_area_dec (ShmPipe * self, ShmArea * area);
+static void sp_ring_link_clear (ShmRingLink * link);
 
 
 
@@ -208,6 +281,8 @@ sp_writer_create (const char *path, size_t size, mode_t perms)
 
   self->main_socket = socket (PF_UNIX, SOCK_STREAM, 0);
   self->use_count = 1;
+  self->ring.buffer_fd = -1;
+  self->ring.release_fd = -1;
 
   if (self->main_socket < 0)
     RETURN_ERROR ("Could not create socket (%d): %s\n", errno,
@@ -446,6 +521,8 @@ sp_writer_close (ShmPipe * self, sp_buffer_free_callback callback,
   while (self->clients)
     sp_writer_close_client (self, self->clients, callback, user_data);
 
+  sp_ring_link_clear (&self->ring);
+
   sp_dec (self);
 }
 
@@ -485,6 +562,196 @@ send_command (int fd, struct CommandBuffer *cb, unsigned short int type,
   return 1;
 }
 
+#ifdef HAVE_SYS_EVENTFD_H
+static int
+send_command_with_fds (int fd, struct CommandBuffer *cb,
+    unsigned short int type, int area_id, int *fds)
+{
+  char control[CMSG_SPACE (sizeof (int) * SHM_RING_N_FDS)];
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+
+  cb->type = type;
+  cb->area_id = area_id;
+
+  memset (&msg, 0, sizeof (msg));
+  memset (control, 0, sizeof (control));
+  iov.iov_base = cb;
+  iov.iov_len = sizeof (struct CommandBuffer);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof (control);
+
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (int) * SHM_RING_N_FDS);
+  memcpy (CMSG_DATA (cmsg), fds, sizeof (int) * SHM_RING_N_FDS);
+
+  if (sendmsg (fd, &msg, MSG_NOSIGNAL) != sizeof (struct CommandBuffer))
+    return 0;
+
+  return 1;
+}
+#endif
+
+static void
+sp_ring_link_clear (ShmRingLink * link)
+{
+  if (link->area)
+    munmap (link->area, sizeof (ShmRingArea));
+  link->area = NULL;
+
+  if (link->buffer_fd >= 0)
+    close (link->buffer_fd);
+  link->buffer_fd = -1;
+
+  if (link->release_fd >= 0)
+    close (link->release_fd);
+  link->release_fd = -1;
+}
+
+/* Returns 0 if the ring is full */
+static int
+sp_ring_push (ShmRing * ring, int notify_fd, ShmRingEntry * entry)
+{
+  uint32_t head = ring->head;
+  uint64_t one = 1;
+
+  if (head - __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE) >= SHM_RING_SIZE)
+    return 0;
+
+  ring->entries[head % SHM_RING_SIZE] = *entry;
+  __atomic_store_n (&ring->head, head + 1, __ATOMIC_SEQ_CST);
+
+  /* Pairs with the store to waiting in sp_ring_prepare_wait(), either the
+   * consumer sees the new head or we see that it is waiting */
+  if (__atomic_load_n (&ring->waiting, __ATOMIC_SEQ_CST) &&
+      __atomic_exchange_n (&ring->waiting, 0, __ATOMIC_SEQ_CST)) {
+    if (write (notify_fd, &one, sizeof (one)) < 0) {
+      /* Only fails if the counter overflows, it is readable then anyway */
+    }
+  }
+
+  return 1;
+}
+
+/* Returns the number of entries in the ring, or -1 if the other side
+ * corrupted it */
+static int
+sp_ring_peek (ShmRing * ring, ShmRingEntry * entry)
+{
+  uint32_t tail = ring->tail;
+  uint32_t len = __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE) - tail;
+
+  if (len > SHM_RING_SIZE)
+    return -1;
+
+  if (len > 0)
+    *entry = ring->entries[tail % SHM_RING_SIZE];
+
+  return len;
+}
+
+static void
+sp_ring_pop (ShmRing * ring)
+{
+  __atomic_store_n (&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+}
+
+/* Returns 1 if the ring is still empty and the caller can sleep on the
+ * eventfd until the producer pushes something */
+static int
+sp_ring_prepare_wait (ShmRing * ring, int notify_fd)
+{
+  uint64_t count;
+
+  /* Reset the eventfd, it may still hold stale wakeups */
+  if (read (notify_fd, &count, sizeof (count)) < 0) {
+    /* EAGAIN, there were none */
+  }
+
+  __atomic_store_n (&ring->waiting, 1, __ATOMIC_SEQ_CST);
+
+  return __atomic_load_n (&ring->head, __ATOMIC_SEQ_CST) == ring->tail;
+}
+
+int
+sp_writer_set_use_rings (ShmPipe * self, int use_rings)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+  self->use_rings = use_rings;
+  return 1;
+#else
+  return !use_rings;
+#endif
+}
+
+#ifdef HAVE_SYS_EVENTFD_H
+static int
+sp_writer_open_client_ring (ShmPipe * self, ShmClient * client)
+{
+  struct CommandBuffer cb = { 0 };
+  int fds[SHM_RING_N_FDS];
+  char tmppath[40];
+  void *area;
+  int ring_fd;
+  int i = 0;
+  int err;
+
+  do {
+    snprintf (tmppath, sizeof (tmppath), "/shmpipe-ring.%5d.%5d", getpid (),
+        i++);
+    ring_fd = shm_open (tmppath, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+  } while (ring_fd < 0 && errno == EEXIST);
+
+  if (ring_fd < 0)
+    return 0;
+
+  /* The client gets the fd over the socket, it doesn't need the name */
+  shm_unlink (tmppath);
+
+  if (ftruncate (ring_fd, sizeof (ShmRingArea)))
+    goto error;
+
+  area = mmap (NULL, sizeof (ShmRingArea), PROT_READ | PROT_WRITE,
+      MAP_SHARED, ring_fd, 0);
+  if (area == MAP_FAILED)
+    goto error;
+  client->ring.area = area;
+
+  /* Both sides start asleep, the first entry of each ring wakes them up */
+  client->ring.area->buffers.waiting = 1;
+  client->ring.area->releases.waiting = 1;
+
+  client->ring.buffer_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  client->ring.release_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (client->ring.buffer_fd < 0 || client->ring.release_fd < 0)
+    goto error;
+
+  fds[0] = ring_fd;
+  fds[1] = client->ring.buffer_fd;
+  fds[2] = client->ring.release_fd;
+  cb.payload.new_ring.size = sizeof (ShmRingArea);
+  if (!send_command_with_fds (client->fd, &cb, COMMAND_NEW_RING,
+          self->shm_area->id, fds))
+    goto error;
+
+  close (ring_fd);
+  return 1;
+
+error:
+  /* keep the errno of the failure for the caller */
+  err = errno;
+  close (ring_fd);
+  sp_ring_link_clear (&client->ring);
+  errno = err;
+  return 0;
+}
+#endif
+
 int
 sp_writer_resize (ShmPipe * self, size_t size)
 {
@@ -584,6 +851,7 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   ShmBuffer *sb;
   ShmClient *client = NULL;
   ShmAllocBlock *ablock = NULL;
+  ShmRingEntry entry = { 0 };
   int i = 0;
   int c = 0;
 
@@ -613,12 +881,44 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   sb->ablock = ablock;
   sb->tag = tag;
 
+  entry.area_id = area->id;
+  entry.offset = offset;
+  entry.size = size;
+
   for (client = self->clients; client; client = client->next) {
     struct CommandBuffer cb = { 0 };
+
+    if (client->ring.area) {
+      if (client->use_socket && client->in_flight == 0)
+        client->use_socket = 0;
+
+      /* Bounding the buffers in the ring also guarantees that the client
+       * always has room in the releases ring to ack them */
+      if (!client->use_socket && client->in_flight < SHM_RING_SIZE &&
+          sp_ring_push (&client->ring.area->buffers, client->ring.buffer_fd,
+              &entry)) {
+        client->in_flight++;
+        sb->clients[i++] = client->fd;
+        c++;
+        continue;
+      }
+
+      /* The ring is full, send the buffer on the socket like to the other
+       * clients. The reader empties its ring before it reads the socket,
+       * so the next buffers also go there until it has acked everything,
+       * or they would overtake this one. */
+      client->use_socket = 1;
+    }
+
     cb.payload.buffer.offset = offset;
     cb.payload.buffer.size = bsize;
-    if (!send_command (client->fd, &cb, COMMAND_NEW_BUFFER, self->shm_area->id))
+    if (!send_command (client->fd, &cb, COMMAND_NEW_BUFFER,
+            self->shm_area->id)) {
+      client->dropped++;
       continue;
+    }
+    if (client->ring.area)
+      client->in_flight++;
     sb->clients[i++] = client->fd;
     c++;
   }
@@ -639,12 +939,54 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   return c;
 }
 
+/* If @fds is not NULL, it receives the SHM_RING_N_FDS fds passed along with
+ * the command, or -1. Unexpected fds are closed. */
 static int
-recv_command (int fd, struct CommandBuffer *cb)
+recv_command (int fd, struct CommandBuffer *cb, int *fds)
 {
+  char control[CMSG_SPACE (sizeof (int) * SHM_RING_N_FDS)];
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  int received[SHM_RING_N_FDS];
+  int n_fds = 0;
   int retval;
+  int i;
+
+  memset (&msg, 0, sizeof (msg));
+  iov.iov_base = cb;
+  iov.iov_len = sizeof (struct CommandBuffer);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof (control);
+
+  retval = recvmsg (fd, &msg, MSG_DONTWAIT);
+
+  if (retval > 0) {
+    for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        continue;
+      n_fds = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+      if (n_fds > SHM_RING_N_FDS)
+        n_fds = SHM_RING_N_FDS;
+      memcpy (received, CMSG_DATA (cmsg), sizeof (int) * n_fds);
+    }
+  }
+
+  if (fds && n_fds == SHM_RING_N_FDS &&
+      retval == sizeof (struct CommandBuffer)) {
+    memcpy (fds, received, sizeof (received));
+    return 1;
+  }
+
+  for (i = 0; i < n_fds; i++)
+    close (received[i]);
+  if (fds) {
+    for (i = 0; i < SHM_RING_N_FDS; i++)
+      fds[i] = -1;
+  }
 
-  retval = recv (fd, cb, sizeof (struct CommandBuffer), MSG_DONTWAIT);
   if (retval == sizeof (struct CommandBuffer)) {
     return 1;
   } else {
@@ -652,18 +994,27 @@ recv_command (int fd, struct CommandBuffer *cb)
   }
 }
 
-long int
-sp_client_recv (ShmPipe * self, char **buf)
+static long int
+sp_client_recv_command (ShmPipe * self, char **buf)
 {
   char *area_name = NULL;
   ShmArea *newarea;
   ShmArea *area;
   struct CommandBuffer cb;
+  int fds[SHM_RING_N_FDS];
+  void *ring_area;
   int retval;
+  int i;
 
-  if (!recv_command (self->main_socket, &cb))
+  if (!recv_command (self->main_socket, &cb, fds))
     return -1;
 
+  if (cb.type != COMMAND_NEW_RING) {
+    for (i = 0; i < SHM_RING_N_FDS; i++)
+      if (fds[i] >= 0)
+        close (fds[i]);
+  }
+
   switch (cb.type) {
     case COMMAND_NEW_SHM_AREA:
       assert (cb.payload.new_shm_area.path_size > 0);
@@ -709,6 +1060,27 @@ sp_client_recv (ShmPipe * self, char **buf)
       }
       return -23;
 
+    case COMMAND_NEW_RING:
+      if (self->ring.area || fds[0] < 0 ||
+          cb.payload.new_ring.size != sizeof (ShmRingArea)) {
+        for (i = 0; i < SHM_RING_N_FDS; i++)
+          if (fds[i] >= 0)
+            close (fds[i]);
+        return -5;
+      }
+
+      ring_area = mmap (NULL, sizeof (ShmRingArea), PROT_READ | PROT_WRITE,
+          MAP_SHARED, fds[0], 0);
+      close (fds[0]);
+      self->ring.buffer_fd = fds[1];
+      self->ring.release_fd = fds[2];
+      if (ring_area == MAP_FAILED) {
+        sp_ring_link_clear (&self->ring);
+        return -6;
+      }
+      self->ring.area = ring_area;
+      break;
+
     default:
       return -99;
   }
@@ -716,13 +1088,84 @@ sp_client_recv (ShmPipe * self, char **buf)
   return 0;
 }
 
+static int
+sp_socket_has_data (int fd)
+{
+  char c;
+
+  return !(recv (fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) < 0 &&
+      (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+static long int
+sp_client_recv_ring (ShmPipe * self, char **buf)
+{
+  ShmRingEntry entry;
+  ShmArea *area;
+  long int retval;
+  int len;
+
+  while ((len = sp_ring_peek (&self->ring.area->buffers, &entry)) == 0) {
+    if (sp_ring_prepare_wait (&self->ring.area->buffers, self->ring.buffer_fd))
+      return 0;
+  }
+
+  if (len < 0)
+    return -24;
+
+  for (;;) {
+    for (area = self->shm_area; area; area = area->next) {
+      if (area->id == entry.area_id)
+        break;
+    }
+    if (area)
+      break;
+
+    /* The writer announces new areas on the socket before it puts buffers
+     * from them in the ring */
+    if (!sp_socket_has_data (self->main_socket))
+      return -23;
+    retval = sp_client_recv_command (self, NULL);
+    if (retval < 0)
+      return retval;
+  }
+
+  if (entry.offset + entry.size > area->shm_area_len)
+    return -25;
+
+  sp_ring_pop (&self->ring.area->buffers);
+
+  *buf = area->shm_area_buf + entry.offset;
+  sp_shm_area_inc (area);
+  return entry.size;
+}
+
+long int
+sp_client_recv (ShmPipe * self, char **buf)
+{
+  long int retval;
+
+  if (self->ring.area) {
+    retval = sp_client_recv_ring (self, buf);
+    if (retval != 0)
+      return retval;
+
+    /* The ring is empty, the writer can still send commands, or close the
+     * socket, which the caller must be told about */
+    if (!sp_socket_has_data (self->main_socket))
+      return 0;
+  }
+
+  return sp_client_recv_command (self, buf);
+}
+
 int
 sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
 {
   ShmBuffer *buf = NULL, *prev_buf = NULL;
   struct CommandBuffer cb;
 
-  if (!recv_command (client->fd, &cb))
+  if (!recv_command (client->fd, &cb, NULL))
     return -1;
 
   switch (cb.type) {
@@ -731,6 +1174,9 @@ sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
       for (buf = self->buffers; buf; buf = buf->next) {
         if (buf->shm_area->id == cb.area_id &&
             buf->offset == cb.payload.ack_buffer.offset) {
+          /* A ring client acks here if its releases ring is full */
+          if (client->ring.area)
+            client->in_flight--;
           return sp_shmbuf_dec (self, buf, prev_buf, client, tag);
         }
         prev_buf = buf;
@@ -744,6 +1190,52 @@ sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
   return 0;
 }
 
+int
+sp_writer_recv_releases (ShmPipe * self, ShmClient * client,
+    sp_buffer_free_callback callback, void *user_data)
+{
+  ShmBuffer *buf, *prev_buf;
+  ShmRingEntry entry;
+  void *tag;
+  int released = 0;
+  int len;
+
+  if (!client->ring.area)
+    return 0;
+
+  for (;;) {
+    len = sp_ring_peek (&client->ring.area->releases, &entry);
+    if (len < 0)
+      return -1;
+
+    if (len == 0) {
+      if (sp_ring_prepare_wait (&client->ring.area->releases,
+              client->ring.release_fd))
+        return released;
+      continue;
+    }
+
+    sp_ring_pop (&client->ring.area->releases);
+
+    prev_buf = NULL;
+    for (buf = self->buffers; buf; buf = buf->next) {
+      if (buf->shm_area->id == entry.area_id && buf->offset == entry.offset)
+        break;
+      prev_buf = buf;
+    }
+
+    if (!buf)
+      return -2;
+
+    client->in_flight--;
+    released++;
+
+    tag = NULL;
+    if (sp_shmbuf_dec (self, buf, prev_buf, client, &tag) == 0 && callback)
+      callback (tag, user_data);
+  }
+}
+
 int
 sp_client_recv_finish (ShmPipe * self, char *buf)
 {
@@ -761,7 +1253,22 @@ sp_client_recv_finish (ShmPipe * self, char *buf)
 
   offset = buf - shm_area->shm_area_buf;
 
-  sp_shm_area_dec (self, shm_area);
+  if (self->ring.area) {
+    ShmRingEntry entry = { 0 };
+
+    entry.area_id = shm_area->id;
+    entry.offset = offset;
+    sp_shm_area_dec (self, shm_area);
+
+    /* The releases ring fills up if the writer also sent buffers on the
+     * socket because the buffers ring was full, fall back to the socket
+     * rather than losing the ack */
+    if (sp_ring_push (&self->ring.area->releases, self->ring.release_fd,
+            &entry))
+      return 1;
+  } else {
+    sp_shm_area_dec (self, shm_area);
+  }
 
   cb.payload.ack_buffer.offset = offset;
   return send_command (self->main_socket, &cb, COMMAND_ACK_BUFFER,
@@ -779,6 +1286,8 @@ sp_client_open (const char *path)
 
   self->main_socket = socket (PF_UNIX, SOCK_STREAM, 0);
   self->use_count = 1;
+  self->ring.buffer_fd = -1;
+  self->ring.release_fd = -1;
 
   if (self->main_socket < 0)
     goto error;
@@ -835,7 +1344,16 @@ sp_writer_accept_client (ShmPipe * self)
   }
 
   client = spalloc_new (ShmClient);
+  memset (client, 0, sizeof (ShmClient));
   client->fd = fd;
+  client->ring.buffer_fd = -1;
+  client->ring.release_fd = -1;
+
+#ifdef HAVE_SYS_EVENTFD_H
+  if (self->use_rings && !sp_writer_open_client_ring (self, client))
+    fprintf (stderr, "Could not set up the rings, using the socket (%d): %s\n",
+        errno, strerror (errno));
+#endif
 
   /* Prepend ot linked list */
   client->next = self->clients;
@@ -933,6 +1451,7 @@ again:
 
   self->num_clients--;
 
+  sp_ring_link_clear (&client->ring);
   spalloc_free (ShmClient, client);
 }
 
@@ -957,6 +1476,24 @@ sp_writer_get_client_fd (ShmClient * client)
   return client->fd;
 }
 
+int
+sp_writer_get_client_notify_fd (ShmClient * client)
+{
+  return client->ring.area ? client->ring.release_fd : -1;
+}
+
+unsigned int
+sp_writer_get_client_dropped (ShmClient * client)
+{
+  return client->dropped;
+}
+
+int
+sp_client_get_notify_fd (ShmPipe * self)
+{
+  return self->ring.area ? self->ring.buffer_fd : -1;
+}
+
 int
 sp_writer_pending_writes (ShmPipe * self)
 {
@@ -995,3 +1532,24 @@ sp_writer_get_max_buf_size (ShmPipe * self)
 
   return self->shm_area->shm_area_len;
 }
+
+/* Percentage of the free space of the current area that is not in its
+ * largest free block */
+int
+sp_writer_get_fragmentation (ShmPipe * self)
+{
+  unsigned long free_size;
+  unsigned long largest;
+
+  if (self->shm_area == NULL)
+    return 0;
+
+  free_size = shm_alloc_space_get_free_size (self->shm_area->allocspace);
+  if (free_size == 0)
+    return 0;
+
+  largest =
+      shm_alloc_space_get_largest_free_block (self->shm_area->allocspace);
+
+  return (unsigned long long) (free_size - largest) * 100 / free_size;
+}
@@ -56,6 +56,19 @@
  * buffers are no longer valid. If was valid buffer was received, the
  * client must release it with sp_client_recv_finish() when it is done
  * reading from it.
+ *
+ * If the writer calls sp_writer_set_use_rings(), the buffers and their
+ * releases are passed through rings in shared memory instead of the
+ * socket to the clients that connect afterwards. The writer must then
+ * also select() on sp_writer_get_client_notify_fd() and call
+ * sp_writer_recv_releases() when it is readable. Once
+ * sp_client_get_notify_fd() returns a valid fd, the reader must also
+ * select() on it, and call sp_client_recv() until it returns 0 before
+ * each select(), as new buffers only make the fd readable while the
+ * reader is waiting. When a client does not release the buffers and its
+ * ring is full, the writer sends the next buffers to it on the socket.
+ * sp_writer_get_client_dropped() counts the buffers that could not be
+ * sent to a client at all.
  */
 
 
@@ -100,12 +113,19 @@ int sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void * tag);
 char *sp_writer_block_get_buf (ShmBlock *block);
 ShmPipe *sp_writer_block_get_pipe (ShmBlock *block);
 size_t sp_writer_get_max_buf_size (ShmPipe * self);
+int sp_writer_get_fragmentation (ShmPipe * self);
 
 ShmClient * sp_writer_accept_client (ShmPipe * self);
 void sp_writer_close_client (ShmPipe *self, ShmClient * client,
     sp_buffer_free_callback callback, void * user_data);
 int sp_writer_recv (ShmPipe * self, ShmClient * client, void ** tag);
 
+int sp_writer_set_use_rings (ShmPipe * self, int use_rings);
+int sp_writer_get_client_notify_fd (ShmClient * client);
+int sp_writer_recv_releases (ShmPipe * self, ShmClient * client,
+    sp_buffer_free_callback callback, void * user_data);
+unsigned int sp_writer_get_client_dropped (ShmClient * client);
+
 int sp_writer_pending_writes (ShmPipe * self);
 
 ShmBuffer *sp_writer_get_pending_buffers (ShmPipe * self);
@@ -115,6 +135,7 @@ void *sp_writer_buf_get_tag (ShmBuffer * buffer);
 ShmPipe *sp_client_open (const char *path);
 long int sp_client_recv (ShmPipe * self, char **buf);
 int sp_client_recv_finish (ShmPipe * self, char *buf);
+int sp_client_get_notify_fd (ShmPipe * self);
 void sp_client_close (ShmPipe * self);
 
 #ifdef __cplusplus
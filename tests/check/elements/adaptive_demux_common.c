@@ -79,6 +79,10 @@ gst_adaptive_demux_test_case_clear (GstAdaptiveDemuxTestCase * testData)
   testData->threshold_for_seek = 0;
   gst_event_replace (&testData->seek_event, NULL);
   testData->signal_context = NULL;
+  if (testData->demux_properties) {
+    gst_structure_free (testData->demux_properties);
+    testData->demux_properties = NULL;
+  }
 }
 
 
@@ -416,6 +420,15 @@ testSeekOnStateChanged (GstBus * bus, GstMessage * msg, gpointer user_data)
   }
 }
 
+static gboolean
+testSetDemuxProperty (GQuark field_id, const GValue * value,
+    gpointer user_data)
+{
+  g_object_set_property (G_OBJECT (user_data), g_quark_to_string (field_id),
+      value);
+  return TRUE;
+}
+
 /*
  * Issue a seek request after media segment has started to be downloaded
  * on the first pad listed in GstAdaptiveDemuxTestOutputStreamData and the
@@ -428,6 +441,10 @@ testSeekPreTestCallback (GstAdaptiveDemuxTestEngine * engine,
   GstAdaptiveDemuxTestCase *testData = GST_ADAPTIVE_DEMUX_TEST_CASE (user_data);
   GstBus *bus;
 
+  if (testData->demux_properties)
+    gst_structure_foreach (testData->demux_properties, testSetDemuxProperty,
+        engine->demux);
+
   /* register a callback to listen for state change events */
   bus = gst_pipeline_get_bus (GST_PIPELINE (engine->pipeline));
   gst_bus_add_signal_watch (bus);
@@ -492,6 +509,399 @@ gst_adaptive_demux_test_seek (const gchar * element_name,
   /* the call to g_object_unref of testData will clean up the seek task */
 }
 
+void
+gst_adaptive_demux_test_network_request (GstAdaptiveDemuxTestNetwork * network)
+{
+  g_mutex_lock (&network->lock);
+  network->request_time = gst_clock_get_time (network->clock);
+  gst_test_clock_advance_time (GST_TEST_CLOCK (network->clock),
+      network->latency);
+  g_mutex_unlock (&network->lock);
+}
+
+void
+gst_adaptive_demux_test_network_transfer (GstAdaptiveDemuxTestNetwork *
+    network, guint64 size)
+{
+  GstClockTime now, interval_end, needed;
+  guint64 bits = size * 8, rate;
+  guint i, trace_len;
+
+  for (trace_len = 0; network->trace[trace_len]; trace_len++);
+  fail_unless (trace_len > 0);
+
+  g_mutex_lock (&network->lock);
+  network->bytes += size;
+  now = gst_clock_get_time (network->clock);
+  while (bits > 0) {
+    i = MIN (now / network->trace_interval, trace_len - 1);
+    rate = network->trace[i] * 1000;
+    needed = gst_util_uint64_scale_ceil (bits, GST_SECOND, rate);
+    interval_end = (i + 1) * network->trace_interval;
+
+    if (i < trace_len - 1 && now + needed > interval_end) {
+      /* the bandwidth changes during the transfer */
+      bits -= gst_util_uint64_scale (interval_end - now, rate, GST_SECOND);
+      now = interval_end;
+    } else {
+      now += needed;
+      bits = 0;
+    }
+  }
+  gst_test_clock_set_time (GST_TEST_CLOCK (network->clock), now);
+  g_mutex_unlock (&network->lock);
+}
+
+void
+gst_adaptive_demux_test_network_fragment_done (GstAdaptiveDemuxTestNetwork *
+    network, guint64 bitrate)
+{
+  GstClockTime now, due;
+
+  g_mutex_lock (&network->lock);
+  now = gst_clock_get_time (network->clock);
+  if (network->fragments == 0) {
+    /* playback starts, the pipeline goes to PLAYING now */
+    network->play_start = network->startup_time = now;
+  } else {
+    due = network->play_start + network->stall_time +
+        network->fragments * network->fragment_duration;
+    if (now > due) {
+      GST_DEBUG ("Stalled for %" GST_TIME_FORMAT " waiting for fragment %u",
+          GST_TIME_ARGS (now - due), network->fragments);
+      network->stalls++;
+      network->stall_time += now - due;
+      /* playback was paused in the meantime, the running time didn't
+       * advance */
+      gst_element_set_base_time (network->demux,
+          network->play_start + network->stall_time);
+    }
+
+    if (bitrate != network->last_bitrate) {
+      network->switches++;
+      if (bitrate < network->last_bitrate
+          && GST_CLOCK_TIME_IS_VALID (network->congestion_start)) {
+        network->switch_delay += now - network->congestion_start;
+        network->congestion_start = GST_CLOCK_TIME_NONE;
+      }
+    }
+  }
+
+  /* the bandwidth doesn't sustain this bitrate anymore */
+  if (now - network->request_time <= network->fragment_duration)
+    network->congestion_start = GST_CLOCK_TIME_NONE;
+  else if (!GST_CLOCK_TIME_IS_VALID (network->congestion_start))
+    network->congestion_start = now;
+
+  network->fragments++;
+  network->bitrate_sum += bitrate;
+  network->last_bitrate = bitrate;
+  g_mutex_unlock (&network->lock);
+}
+
+static void
+testSimulatePreTestCallback (GstAdaptiveDemuxTestEngine * engine,
+    gpointer user_data)
+{
+  GstAdaptiveDemuxTestNetwork *network = user_data;
+
+  network->demux = engine->demux;
+  gst_util_set_object_arg (G_OBJECT (engine->demux), "abr-algorithm",
+      network->abr_algorithm);
+  g_object_set (engine->demux, "abr-buffer-target", network->max_buffer,
+      NULL);
+}
+
+/* downstream blocks while its buffer is full */
+static gboolean
+testSimulateDemuxSendsData (GstAdaptiveDemuxTestEngine * engine,
+    GstAdaptiveDemuxTestOutputStream * stream,
+    GstBuffer * buffer, gpointer user_data)
+{
+  GstAdaptiveDemuxTestNetwork *network = user_data;
+  GstClockTime now, buffered;
+
+  g_mutex_lock (&network->lock);
+  now = gst_clock_get_time (network->clock);
+  buffered = network->play_start + network->stall_time +
+      network->fragments * network->fragment_duration;
+  if (network->fragments > 0 && buffered > now + network->max_buffer)
+    gst_test_clock_set_time (GST_TEST_CLOCK (network->clock),
+        buffered - network->max_buffer);
+  g_mutex_unlock (&network->lock);
+
+  return TRUE;
+}
+
+static void
+testSimulateAppSinkEos (GstAdaptiveDemuxTestEngine * engine,
+    GstAdaptiveDemuxTestOutputStream * stream, gpointer user_data)
+{
+  g_main_loop_quit (engine->loop);
+}
+
+void
+gst_adaptive_demux_test_simulate (const gchar * element_name,
+    const gchar * manifest_uri, const gchar * abr_algorithm,
+    GstAdaptiveDemuxTestNetwork * network)
+{
+  GstAdaptiveDemuxTestCallbacks cb = { 0 };
+  gint64 start_time;
+  guint64 mbits;
+
+  network->abr_algorithm = abr_algorithm;
+  network->fragments = 0;
+  network->bitrate_sum = 0;
+  network->startup_time = 0;
+  network->stalls = 0;
+  network->stall_time = 0;
+  network->switches = 0;
+  network->switch_delay = 0;
+  network->bytes = 0;
+  network->play_start = 0;
+  network->request_time = 0;
+  network->congestion_start = GST_CLOCK_TIME_NONE;
+  network->last_bitrate = 0;
+  g_mutex_init (&network->lock);
+
+  /* the demuxer measures the downloads with the system clock and the
+   * pipeline uses it for the running time */
+  network->clock = gst_test_clock_new ();
+  gst_system_clock_set_default (network->clock);
+
+  cb.pre_test = testSimulatePreTestCallback;
+  cb.demux_sent_data = testSimulateDemuxSendsData;
+  cb.appsink_eos = testSimulateAppSinkEos;
+
+  start_time = g_get_monotonic_time ();
+  gst_adaptive_demux_test_run (element_name, manifest_uri, &cb, network);
+  network->processing_time =
+      (g_get_monotonic_time () - start_time) * GST_USECOND;
+
+  gst_system_clock_set_default (NULL);
+  gst_object_unref (network->clock);
+  network->clock = NULL;
+  network->demux = NULL;
+  g_mutex_clear (&network->lock);
+
+  GST_INFO ("%s with %s: %u fragments, average bitrate %" G_GUINT64_FORMAT
+      ", startup %" GST_TIME_FORMAT ", %u stalls for %" GST_TIME_FORMAT
+      ", %u switches, switch delay %" GST_TIME_FORMAT, element_name,
+      abr_algorithm, network->fragments,
+      network->fragments ? network->bitrate_sum / network->fragments : 0,
+      GST_TIME_ARGS (network->startup_time), network->stalls,
+      GST_TIME_ARGS (network->stall_time), network->switches,
+      GST_TIME_ARGS (network->switch_delay));
+
+  if (g_getenv ("GST_ADAPTIVE_DEMUX_BENCHMARK")) {
+    mbits = MAX (network->bytes * 8 / 1000000, 1);
+    g_print ("%s %s: average bitrate %" G_GUINT64_FORMAT " kbps, startup "
+        "%.3fs, %u stalls %.3fs, %u switches, switch delay %.3fs, "
+        "%" G_GUINT64_FORMAT " us per Mbit\n", element_name, abr_algorithm,
+        network->fragments ?
+        network->bitrate_sum / network->fragments / 1000 : 0,
+        (gdouble) network->startup_time / GST_SECOND, network->stalls,
+        (gdouble) network->stall_time / GST_SECOND, network->switches,
+        (gdouble) network->switch_delay / GST_SECOND,
+        network->processing_time / GST_USECOND / mbits);
+  }
+}
+
+#define ABR_SIMULATION_FRAGMENTS 30
+#define ABR_SIMULATION_LEVELS 3
+
+typedef struct _GstAdaptiveDemuxTestAbrResource
+{
+  const guint8 *payload;
+  guint64 size;
+  /* nominal bitrate of media fragments, 0 for manifests */
+  guint64 bitrate;
+} GstAdaptiveDemuxTestAbrResource;
+
+typedef struct _GstAdaptiveDemuxTestAbrSimulation
+{
+  GstAdaptiveDemuxTestNetwork network;
+  GstAdaptiveDemuxTestAbrManifestFunc manifest_func;
+  GstAdaptiveDemuxTestAbrMatchFunc match_func;
+  const guint8 *fragment_payload;
+  gsize payload_size;
+  GstAdaptiveDemuxTestAbrResource fragments[ABR_SIMULATION_LEVELS];
+  /* protects manifests */
+  GMutex lock;
+  /* URI -> GstAdaptiveDemuxTestAbrResource of the manifests served */
+  GHashTable *manifests;
+} GstAdaptiveDemuxTestAbrSimulation;
+
+static const guint64 abr_simulation_bitrates[ABR_SIMULATION_LEVELS] = {
+  500000, 1500000, 3000000
+};
+
+static void
+gst_adaptive_demux_test_abr_resource_free (GstAdaptiveDemuxTestAbrResource *
+    resource)
+{
+  g_free ((gchar *) resource->payload);
+  g_slice_free (GstAdaptiveDemuxTestAbrResource, resource);
+}
+
+static gboolean
+gst_adaptive_demux_test_abr_src_start (GstTestHTTPSrc * src,
+    const gchar * uri, GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  GstAdaptiveDemuxTestAbrSimulation *sim = user_data;
+  GstAdaptiveDemuxTestAbrResource *resource = NULL;
+  guint64 bitrate;
+  gchar *manifest;
+  guint i;
+
+  bitrate = sim->match_func (uri, ABR_SIMULATION_FRAGMENTS);
+  if (bitrate) {
+    for (i = 0; i < ABR_SIMULATION_LEVELS; i++) {
+      if (sim->fragments[i].bitrate == bitrate)
+        resource = &sim->fragments[i];
+    }
+  } else {
+    g_mutex_lock (&sim->lock);
+    resource = g_hash_table_lookup (sim->manifests, uri);
+    if (resource == NULL) {
+      manifest = sim->manifest_func (uri, abr_simulation_bitrates,
+          ABR_SIMULATION_LEVELS, ABR_SIMULATION_FRAGMENTS);
+      if (manifest) {
+        resource = g_slice_new0 (GstAdaptiveDemuxTestAbrResource);
+        resource->payload = (const guint8 *) manifest;
+        resource->size = strlen (manifest);
+        g_hash_table_insert (sim->manifests, g_strdup (uri), resource);
+      }
+    }
+    g_mutex_unlock (&sim->lock);
+  }
+  if (resource == NULL)
+    return FALSE;
+
+  gst_adaptive_demux_test_network_request (&sim->network);
+  input_data->context = resource;
+  input_data->size = resource->size;
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_adaptive_demux_test_abr_src_create (GstTestHTTPSrc * src,
+    guint64 offset,
+    guint length, GstBuffer ** retbuf, gpointer context, gpointer user_data)
+{
+  GstAdaptiveDemuxTestAbrSimulation *sim = user_data;
+  GstAdaptiveDemuxTestAbrResource *resource = context;
+  guint64 pos, n;
+  GstBuffer *buf;
+
+  gst_adaptive_demux_test_network_transfer (&sim->network, length);
+
+  buf = gst_buffer_new_allocate (NULL, length, NULL);
+  fail_if (buf == NULL, "Not enough memory to allocate buffer");
+  if (resource->bitrate == 0) {
+    gst_buffer_fill (buf, 0, resource->payload + offset, length);
+  } else if (sim->fragment_payload == NULL) {
+    gst_buffer_memset (buf, 0, 0, length);
+  } else {
+    for (pos = 0; pos < length; pos += n) {
+      n = MIN (length - pos,
+          sim->payload_size - (offset + pos) % sim->payload_size);
+      gst_buffer_fill (buf, pos,
+          sim->fragment_payload + (offset + pos) % sim->payload_size, n);
+    }
+  }
+  *retbuf = buf;
+
+  if (resource->bitrate && offset + length == resource->size)
+    gst_adaptive_demux_test_network_fragment_done (&sim->network,
+        resource->bitrate);
+  return GST_FLOW_OK;
+}
+
+void
+gst_adaptive_demux_test_abr_simulation (const gchar * element_name,
+    const gchar * manifest_uri,
+    GstAdaptiveDemuxTestAbrManifestFunc manifest_func,
+    GstAdaptiveDemuxTestAbrMatchFunc match_func,
+    const guint8 * fragment_payload, gsize payload_size)
+{
+  /* bandwidth in kbps every 2 seconds */
+  static const guint trace[] = {
+    4200, 3900, 4100, 3800, 2500, 1200, 800, 650, 700, 900, 600, 750,
+    1500, 2600, 3400, 4000, 4200, 3900, 4100, 4300, 0
+  };
+  static const gchar *algorithms[] = { "throughput", "ewma", "bola" };
+  GstTestHTTPSrcCallbacks http_src_callbacks = { 0 };
+  GstAdaptiveDemuxTestAbrSimulation sim = { {0} };
+  guint64 max_size = 0, size;
+  guint i, run;
+
+  sim.manifest_func = manifest_func;
+  sim.match_func = match_func;
+  sim.fragment_payload = fragment_payload;
+  sim.payload_size = payload_size;
+  g_mutex_init (&sim.lock);
+  sim.manifests = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) gst_adaptive_demux_test_abr_resource_free);
+  for (i = 0; i < ABR_SIMULATION_LEVELS; i++) {
+    size = abr_simulation_bitrates[i] * 2 / 8;
+    if (fragment_payload)
+      size -= size % payload_size;
+    sim.fragments[i].size = size;
+    sim.fragments[i].bitrate = abr_simulation_bitrates[i];
+    max_size = MAX (max_size, size);
+  }
+
+  sim.network.trace = trace;
+  sim.network.trace_interval = 2 * GST_SECOND;
+  sim.network.latency = 50 * GST_MSECOND;
+  sim.network.fragment_duration = 2 * GST_SECOND;
+  sim.network.max_buffer = 12 * GST_SECOND;
+
+  http_src_callbacks.src_start = gst_adaptive_demux_test_abr_src_start;
+  http_src_callbacks.src_create = gst_adaptive_demux_test_abr_src_create;
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &sim);
+  gst_test_http_src_set_default_blocksize (max_size);
+
+  for (i = 0; i < G_N_ELEMENTS (algorithms); i++) {
+    GstAdaptiveDemuxTestNetwork first = { 0 };
+
+    for (run = 0; run < 2; run++) {
+      gst_adaptive_demux_test_simulate (element_name, manifest_uri,
+          algorithms[i], &sim.network);
+
+      fail_unless_equals_int (sim.network.fragments,
+          ABR_SIMULATION_FRAGMENTS);
+      fail_unless (sim.network.bitrate_sum >=
+          ABR_SIMULATION_FRAGMENTS * abr_simulation_bitrates[0]);
+      fail_unless (sim.network.bitrate_sum <=
+          ABR_SIMULATION_FRAGMENTS *
+          abr_simulation_bitrates[ABR_SIMULATION_LEVELS - 1]);
+
+      if (run == 0) {
+        first = sim.network;
+      } else if (strcmp (algorithms[i], "throughput") != 0) {
+        /* the simulation doesn't depend on the real time, except for the
+         * input rate of the queue used by the throughput algorithm */
+        fail_unless_equals_uint64 (sim.network.bitrate_sum,
+            first.bitrate_sum);
+        fail_unless_equals_uint64 (sim.network.startup_time,
+            first.startup_time);
+        fail_unless_equals_int (sim.network.stalls, first.stalls);
+        fail_unless_equals_uint64 (sim.network.stall_time, first.stall_time);
+        fail_unless_equals_int (sim.network.switches, first.switches);
+        fail_unless_equals_uint64 (sim.network.switch_delay,
+            first.switch_delay);
+      }
+    }
+  }
+
+  gst_test_http_src_install_callbacks (NULL, NULL);
+  gst_test_http_src_set_default_blocksize (0);
+  g_hash_table_unref (sim.manifests);
+  g_mutex_clear (&sim.lock);
+}
+
 void
 gst_adaptive_demux_test_setup (void)
 {
@@ -23,6 +23,7 @@
 #define __GST_ADAPTIVE_DEMUX_COMMON_TEST_H__
 
 #include <gst/gst.h>
+#include <gst/check/gsttestclock.h>
 #include "adaptive_demux_engine.h"
 
 G_BEGIN_DECLS
@@ -110,6 +111,10 @@ typedef struct _GstAdaptiveDemuxTestCase
   guint64 threshold_for_seek;
   GstEvent *seek_event;
 
+  /* properties set on the demux element before the pipeline is started
+   * by gst_adaptive_demux_test_seek(), can be NULL */
+  GstStructure *demux_properties;
+
   gpointer signal_context;
 } GstAdaptiveDemuxTestCase;
 
@@ -208,5 +213,151 @@ GstAdaptiveDemuxTestExpectedOutput * gst_adaptive_demux_test_find_test_data_by_s
     GstAdaptiveDemuxTestOutputStream * stream,
     guint * index);
 
+/**
+ * GstAdaptiveDemuxTestNetwork:
+ * Simulates the downloads of a single stream over a network with a
+ * recorded bandwidth trace, and the playback of the downloaded fragments.
+ * The time only advances while data is transferred, using a #GstTestClock
+ * that replaces the system clock, so a simulation is deterministic and
+ * doesn't take real time.
+ * The fields up to max_buffer are set by the testcase function prior to
+ * starting the simulation, the following ones contain the results.
+ */
+typedef struct _GstAdaptiveDemuxTestNetwork
+{
+  /* bandwidth in kbps during each trace_interval, terminated by 0. The last
+   * value is used once the trace is over */
+  const guint *trace;
+  GstClockTime trace_interval;
+  /* time between a request and the first byte of the response */
+  GstClockTime latency;
+  /* media duration of each fragment */
+  GstClockTime fragment_duration;
+  /* downstream blocks when more media than this is buffered */
+  GstClockTime max_buffer;
+
+  /* number of fragments downloaded and the sum of their bitrates */
+  guint fragments;
+  guint64 bitrate_sum;
+  /* time until the first fragment was downloaded */
+  GstClockTime startup_time;
+  /* number and total duration of playback interruptions */
+  guint stalls;
+  GstClockTime stall_time;
+  /* number of bitrate switches, and total time from the end of the first
+   * fragment downloaded slower than real time to the end of the first
+   * fragment of a lower bitrate */
+  guint switches;
+  GstClockTime switch_delay;
+  /* bytes transferred, and the real time the simulation took to process
+   * them */
+  guint64 bytes;
+  GstClockTime processing_time;
+
+  /* < private > */
+  GMutex lock;
+  GstClock *clock;
+  GstElement *demux;
+  const gchar *abr_algorithm;
+  GstClockTime play_start;
+  GstClockTime request_time;
+  GstClockTime congestion_start;
+  guint64 last_bitrate;
+} GstAdaptiveDemuxTestNetwork;
+
+/**
+ * gst_adaptive_demux_test_network_request:
+ * @network: the #GstAdaptiveDemuxTestNetwork
+ *
+ * To be called from the src_start callback, simulates the request latency.
+ */
+void gst_adaptive_demux_test_network_request (
+    GstAdaptiveDemuxTestNetwork * network);
+
+/**
+ * gst_adaptive_demux_test_network_transfer:
+ * @network: the #GstAdaptiveDemuxTestNetwork
+ * @size: the number of bytes transferred
+ *
+ * To be called from the src_create callback, simulates the transfer time
+ * of @size bytes with the bandwidth of the trace.
+ */
+void gst_adaptive_demux_test_network_transfer (
+    GstAdaptiveDemuxTestNetwork * network, guint64 size);
+
+/**
+ * gst_adaptive_demux_test_network_fragment_done:
+ * @network: the #GstAdaptiveDemuxTestNetwork
+ * @bitrate: the nominal bitrate of the fragment
+ *
+ * To be called from the src_create callback when the last byte of a media
+ * fragment was transferred, updates the playback statistics.
+ */
+void gst_adaptive_demux_test_network_fragment_done (
+    GstAdaptiveDemuxTestNetwork * network, guint64 bitrate);
+
+/**
+ * gst_adaptive_demux_test_simulate:
+ * @element_name: The name of the demux element (e.g. "dashdemux")
+ * @manifest_uri: The URI of the manifest to load
+ * @abr_algorithm: the nick of the abr-algorithm to use
+ * @network: the #GstAdaptiveDemuxTestNetwork the test http src callbacks
+ * report to
+ *
+ * Plays the manifest until EOS with a simulated network and clock. The
+ * playback statistics are stored in @network. The test http src callbacks
+ * must be installed with a single media stream and a blocksize of at least
+ * the biggest fragment.
+ * If the GST_ADAPTIVE_DEMUX_BENCHMARK environment variable is set, the
+ * statistics are also printed on stdout.
+ */
+void gst_adaptive_demux_test_simulate (const gchar * element_name,
+    const gchar * manifest_uri, const gchar * abr_algorithm,
+    GstAdaptiveDemuxTestNetwork * network);
+
+/**
+ * GstAdaptiveDemuxTestAbrManifestFunc:
+ * @uri: the requested URI
+ * @bitrates: the nominal bitrates of the quality levels, lowest first
+ * @n_bitrates: the number of quality levels
+ * @n_fragments: the number of fragments of 2 seconds of each quality level
+ * Returns: (transfer full): the manifest or playlist served at @uri, or
+ * %NULL if there is none
+ */
+typedef gchar *(*GstAdaptiveDemuxTestAbrManifestFunc) (const gchar * uri,
+    const guint64 * bitrates, guint n_bitrates, guint n_fragments);
+
+/**
+ * GstAdaptiveDemuxTestAbrMatchFunc:
+ * @uri: the requested URI
+ * @n_fragments: the number of fragments of each quality level
+ * Returns: the nominal bitrate of the media fragment at @uri, or 0 if @uri
+ * is not a media fragment of the manifest
+ */
+typedef guint64 (*GstAdaptiveDemuxTestAbrMatchFunc) (const gchar * uri,
+    guint n_fragments);
+
+/**
+ * gst_adaptive_demux_test_abr_simulation:
+ * @element_name: The name of the demux element (e.g. "dashdemux")
+ * @manifest_uri: The URI of the manifest to load
+ * @manifest_func: returns the manifests and playlists of the stream
+ * @match_func: matches the URIs of the media fragments
+ * @fragment_payload: (allow none) the data media fragments repeat, or
+ * %NULL for zeroes
+ * @payload_size: the size of @fragment_payload
+ *
+ * Plays a stream with three quality levels with every abr-algorithm over
+ * a simulated network whose bandwidth drops below the lowest level and
+ * recovers. Checks that every algorithm plays all fragments, and the same
+ * way twice when based on the download statistics. The size of the media
+ * fragments is rounded down to a multiple of @payload_size.
+ */
+void gst_adaptive_demux_test_abr_simulation (const gchar * element_name,
+    const gchar * manifest_uri,
+    GstAdaptiveDemuxTestAbrManifestFunc manifest_func,
+    GstAdaptiveDemuxTestAbrMatchFunc match_func,
+    const guint8 * fragment_payload, gsize payload_size);
+
 G_END_DECLS
 #endif /* __GST_ADAPTIVE_DEMUX_COMMON_TEST_H__ */
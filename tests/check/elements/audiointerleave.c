@@ -1104,6 +1104,126 @@ GST_START_TEST (test_audiointerleave_2ch_smallbuf)
 
 GST_END_TEST;
 
+static void
+push_float32_buffer (GstHarness * h, gfloat value, guint num_samples)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  gfloat *data;
+  guint i;
+
+  buffer = gst_buffer_new_and_alloc (num_samples * sizeof (gfloat));
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  data = (gfloat *) map.data;
+  for (i = 0; i < num_samples; i++)
+    data[i] = value;
+  gst_buffer_unmap (buffer, &map);
+
+  GST_BUFFER_PTS (buffer) = 0;
+  GST_BUFFER_DURATION (buffer) =
+      gst_util_uint64_scale (num_samples, GST_SECOND, 1000);
+  fail_unless_equals_int (gst_harness_push (h, buffer), GST_FLOW_OK);
+}
+
+#define CAPS_MONO_1KHZ \
+        "audio/x-raw, " \
+        "format = (string) " GST_AUDIO_NE (F32) ", " \
+        "channels = (int) 1, layout = (string) interleaved, " \
+        "rate = (int) 1000"
+
+GST_START_TEST (test_audiointerleave_16ch)
+{
+  GstElement *audiointerleave;
+  GstHarness *h[16];
+  GstBuffer *buffer;
+  GstMapInfo map;
+  gfloat *data;
+  gint i, j;
+
+  audiointerleave = gst_element_factory_make ("audiointerleave", NULL);
+  g_object_set (audiointerleave, "output-buffer-duration",
+      100 * GST_MSECOND, NULL);
+
+  /* 16 adjacent channels are interleaved in one block */
+  for (i = 0; i < 16; i++) {
+    gchar *name = g_strdup_printf ("sink_%d", i);
+
+    h[i] = gst_harness_new_with_element (audiointerleave, name,
+        i == 0 ? "src" : NULL);
+    g_free (name);
+    gst_harness_set_src_caps_str (h[i], CAPS_MONO_1KHZ);
+  }
+
+  for (i = 0; i < 16; i++)
+    push_float32_buffer (h[i], i, 100);
+
+  buffer = gst_harness_pull (h[0]);
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  fail_unless_equals_int (map.size, 100 * 16 * sizeof (gfloat));
+  data = (gfloat *) map.data;
+  for (i = 0; i < 100; i++)
+    for (j = 0; j < 16; j++)
+      fail_unless_equals_float (data[i * 16 + j], j);
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+
+  for (i = 15; i >= 0; i--)
+    gst_harness_teardown (h[i]);
+  gst_object_unref (audiointerleave);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_audiointerleave_2ch_non_interleaved_output)
+{
+  GstElement *audiointerleave;
+  GstHarness *h, *h2;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  GstMapInfo map;
+  gfloat *data;
+  gint i;
+
+  audiointerleave = gst_element_factory_make ("audiointerleave", NULL);
+  g_object_set (audiointerleave, "output-buffer-duration",
+      100 * GST_MSECOND, "non-interleaved", TRUE, NULL);
+
+  h = gst_harness_new_with_element (audiointerleave, "sink_0", "src");
+  /* downstream accepts both layouts, the property decides */
+  gst_harness_set_sink_caps_str (h, "audio/x-raw");
+  gst_harness_set_src_caps_str (h, CAPS_MONO_1KHZ);
+
+  h2 = gst_harness_new_with_element (audiointerleave, "sink_1", NULL);
+  gst_harness_set_src_caps_str (h2, CAPS_MONO_1KHZ);
+
+  push_float32_buffer (h, 1.0, 100);
+  push_float32_buffer (h2, 2.0, 100);
+
+  buffer = gst_harness_pull (h);
+
+  caps = gst_pad_get_current_caps (h->sinkpad);
+  fail_unless_equals_string (gst_structure_get_string (gst_caps_get_structure
+          (caps, 0), "layout"), "non-interleaved");
+  gst_caps_unref (caps);
+
+  /* one plane per channel */
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  fail_unless_equals_int (map.size, 200 * sizeof (gfloat));
+  data = (gfloat *) map.data;
+  for (i = 0; i < 100; i++) {
+    fail_unless_equals_float (data[i], 1.0);
+    fail_unless_equals_float (data[100 + i], 2.0);
+  }
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+
+  gst_harness_teardown (h2);
+  gst_harness_teardown (h);
+  gst_object_unref (audiointerleave);
+}
+
+GST_END_TEST;
+
 static Suite *
 audiointerleave_suite (void)
 {
@@ -1123,6 +1243,8 @@ audiointerleave_suite (void)
   tcase_add_test (tc_chain, test_audiointerleave_2ch_pipeline_custom_chanpos);
   tcase_add_test (tc_chain, test_audiointerleave_2ch_pipeline_no_chanpos);
   tcase_add_test (tc_chain, test_audiointerleave_2ch_smallbuf);
+  tcase_add_test (tc_chain, test_audiointerleave_16ch);
+  tcase_add_test (tc_chain, test_audiointerleave_2ch_non_interleaved_output);
 
   return s;
 }
@@ -33,6 +33,7 @@
 
 #include <gst/check/gstcheck.h>
 #include <gst/check/gstconsistencychecker.h>
+#include <gst/check/gstharness.h>
 #include <gst/audio/audio.h>
 #include <gst/base/gstbasesrc.h>
 #include <gst/controller/gstdirectcontrolbinding.h>
@@ -1910,6 +1911,541 @@ GST_START_TEST (test_sinkpad_property_controller)
 
 GST_END_TEST;
 
+GST_START_TEST (test_sinkpad_volume_ramp)
+{
+  GstSegment segment;
+  GstElement *bin, *audiomixer, *queue, *sink;
+  GstBus *bus;
+  GstPad *sinkpad, *queue_sinkpad, *pad;
+  GstStateChangeReturn state_res;
+  GstBuffer *buffer;
+  GstFlowReturn ret;
+  GstMapInfo map;
+  GstCaps *caps;
+  GList *received_buffers = NULL, *l;
+  gfloat *data, last = -1.0;
+  gint i, n_samples = 0;
+
+  main_loop = g_main_loop_new (NULL, FALSE);
+
+  bin = gst_pipeline_new ("pipeline");
+  bus = gst_element_get_bus (bin);
+  gst_bus_add_signal_watch_full (bus, G_PRIORITY_HIGH);
+
+  g_signal_connect (bus, "message::error", (GCallback) message_received, bin);
+  g_signal_connect (bus, "message::warning", (GCallback) message_received, bin);
+  g_signal_connect (bus, "message::eos", (GCallback) message_received, bin);
+
+  queue = gst_element_factory_make ("queue", "queue");
+  audiomixer = gst_element_factory_make ("audiomixer", "audiomixer");
+  g_object_set (audiomixer, "output-buffer-duration", 100 * GST_MSECOND, NULL);
+  sink = gst_element_factory_make ("fakesink", "sink");
+  g_object_set (sink, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", (GCallback) handoff_buffer_collect_cb,
+      &received_buffers);
+  gst_bin_add_many (GST_BIN (bin), queue, audiomixer, sink, NULL);
+  fail_unless (gst_element_link (audiomixer, sink));
+
+  state_res = gst_element_set_state (bin, GST_STATE_PAUSED);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+
+  sinkpad = gst_element_get_request_pad (audiomixer, "sink_%u");
+  fail_if (sinkpad == NULL, NULL);
+  /* fade out linearly over one second, the controller only updates the
+   * volume once per output buffer */
+  set_pad_volume_fade (sinkpad, 0, 1.0, 1 * GST_SECOND, 0.0);
+
+  queue_sinkpad = gst_element_get_static_pad (queue, "sink");
+  pad = gst_element_get_static_pad (queue, "src");
+  fail_unless (gst_pad_link (pad, sinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+
+  gst_pad_send_event (queue_sinkpad, gst_event_new_stream_start ("test"));
+
+  caps = gst_caps_new_simple ("audio/x-raw",
+      "format", G_TYPE_STRING, GST_AUDIO_NE (F32),
+      "layout", G_TYPE_STRING, "interleaved",
+      "rate", G_TYPE_INT, 1000, "channels", G_TYPE_INT, 1, NULL);
+  gst_pad_set_caps (queue_sinkpad, caps);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_send_event (queue_sinkpad, gst_event_new_segment (&segment));
+
+  /* 10 buffers of 100 samples with a constant value of 1.0 */
+  for (i = 0; i < 10; i++) {
+    gint j;
+
+    buffer = gst_buffer_new_and_alloc (100 * sizeof (gfloat));
+    gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+    data = (gfloat *) map.data;
+    for (j = 0; j < 100; j++)
+      data[j] = 1.0;
+    gst_buffer_unmap (buffer, &map);
+    GST_BUFFER_TIMESTAMP (buffer) = i * 100 * GST_MSECOND;
+    GST_BUFFER_DURATION (buffer) = 100 * GST_MSECOND;
+    ret = gst_pad_chain (queue_sinkpad, buffer);
+    ck_assert_int_eq (ret, GST_FLOW_OK);
+  }
+  gst_pad_send_event (queue_sinkpad, gst_event_new_eos ());
+
+  g_idle_add ((GSourceFunc) set_playing, bin);
+  g_main_loop_run (main_loop);
+
+  /* without ramps the volume would step by 0.1 at each buffer boundary,
+   * with ramps no two consecutive samples differ by more than a bit */
+  for (l = received_buffers; l; l = l->next) {
+    buffer = l->data;
+
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    data = (gfloat *) map.data;
+    for (i = 0; i < map.size / sizeof (gfloat); i++) {
+      if (last >= 0.0)
+        fail_unless (ABS (data[i] - last) < 0.01,
+            "step from %f to %f at sample %d", last, data[i], n_samples);
+      last = data[i];
+      n_samples++;
+    }
+    gst_buffer_unmap (buffer, &map);
+  }
+  fail_unless_equals_int (n_samples, 1000);
+  fail_unless (last < 0.5);
+
+  g_list_free_full (received_buffers, (GDestroyNotify) gst_buffer_unref);
+
+  gst_element_release_request_pad (audiomixer, sinkpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (queue_sinkpad);
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_bus_remove_signal_watch (bus);
+  gst_object_unref (bus);
+  gst_object_unref (bin);
+  g_main_loop_unref (main_loop);
+}
+
+GST_END_TEST;
+
+static void
+link_mix_minus_pad (GstElement * audiomixer, GstPad * sinkpad,
+    GstElement * sink)
+{
+  gchar *name;
+
+  /* sink_N gets the mix of all other sink pads on src_N */
+  name =
+      g_strdup_printf ("src_%s", GST_OBJECT_NAME (sinkpad) + strlen ("sink_"));
+  fail_unless (gst_element_link_pads (audiomixer, name, sink, "sink"));
+  g_free (name);
+}
+
+static void
+send_buffer_mix_minus (GstPad * pad, guint8 value)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  GstFlowReturn ret;
+
+  buffer = gst_buffer_new_and_alloc (2000);
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  memset (map.data, value, map.size);
+  gst_buffer_unmap (buffer, &map);
+  GST_BUFFER_TIMESTAMP (buffer) = 0;
+  GST_BUFFER_DURATION (buffer) = 1 * GST_SECOND;
+  ret = gst_pad_chain (pad, buffer);
+  ck_assert_int_eq (ret, GST_FLOW_OK);
+
+  gst_pad_send_event (pad, gst_event_new_eos ());
+}
+
+static void
+check_buffers_mix_minus (GList * received_buffers, guint8 expected)
+{
+  GList *l;
+  gsize size = 0;
+
+  for (l = received_buffers; l; l = l->next) {
+    GstBuffer *buffer = l->data;
+    GstMapInfo map;
+    gsize i;
+
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    for (i = 0; i < map.size; i++)
+      fail_unless_equals_int (map.data[i], expected);
+    size += map.size;
+    gst_buffer_unmap (buffer, &map);
+  }
+  fail_unless_equals_int (size, 2000);
+}
+
+GST_START_TEST (test_mix_minus)
+{
+  GstSegment segment;
+  GstElement *bin, *audiomixer, *queue1, *queue2, *sink, *sink1, *sink2;
+  GstBus *bus;
+  GstPad *sinkpad1, *sinkpad2, *queue1_sinkpad, *queue2_sinkpad, *pad;
+  GstStateChangeReturn state_res;
+  GstEvent *event;
+  GstCaps *caps;
+  GList *received_buffers = NULL, *received_buffers1 = NULL;
+  GList *received_buffers2 = NULL;
+
+  main_loop = g_main_loop_new (NULL, FALSE);
+
+  bin = gst_pipeline_new ("pipeline");
+  bus = gst_element_get_bus (bin);
+  gst_bus_add_signal_watch_full (bus, G_PRIORITY_HIGH);
+
+  g_signal_connect (bus, "message::error", (GCallback) message_received, bin);
+  g_signal_connect (bus, "message::warning", (GCallback) message_received, bin);
+  g_signal_connect (bus, "message::eos", (GCallback) message_received, bin);
+
+  queue1 = gst_element_factory_make ("queue", "queue1");
+  queue2 = gst_element_factory_make ("queue", "queue2");
+  audiomixer = gst_element_factory_make ("audiomixer", "audiomixer");
+  g_object_set (audiomixer, "output-buffer-duration", 500 * GST_MSECOND,
+      "mix-minus", TRUE, NULL);
+  sink = gst_element_factory_make ("fakesink", "sink");
+  g_object_set (sink, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", (GCallback) handoff_buffer_collect_cb,
+      &received_buffers);
+  sink1 = gst_element_factory_make ("fakesink", "sink1");
+  g_object_set (sink1, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink1, "handoff", (GCallback) handoff_buffer_collect_cb,
+      &received_buffers1);
+  sink2 = gst_element_factory_make ("fakesink", "sink2");
+  g_object_set (sink2, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink2, "handoff", (GCallback) handoff_buffer_collect_cb,
+      &received_buffers2);
+  gst_bin_add_many (GST_BIN (bin), queue1, queue2, audiomixer, sink, sink1,
+      sink2, NULL);
+  fail_unless (gst_element_link (audiomixer, sink));
+
+  state_res = gst_element_set_state (bin, GST_STATE_PAUSED);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+
+  sinkpad1 = gst_element_get_request_pad (audiomixer, "sink_%u");
+  fail_if (sinkpad1 == NULL, NULL);
+  link_mix_minus_pad (audiomixer, sinkpad1, sink1);
+
+  queue1_sinkpad = gst_element_get_static_pad (queue1, "sink");
+  pad = gst_element_get_static_pad (queue1, "src");
+  fail_unless (gst_pad_link (pad, sinkpad1) == GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+
+  sinkpad2 = gst_element_get_request_pad (audiomixer, "sink_%u");
+  fail_if (sinkpad2 == NULL, NULL);
+  link_mix_minus_pad (audiomixer, sinkpad2, sink2);
+
+  queue2_sinkpad = gst_element_get_static_pad (queue2, "sink");
+  pad = gst_element_get_static_pad (queue2, "src");
+  fail_unless (gst_pad_link (pad, sinkpad2) == GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+
+  gst_pad_send_event (queue1_sinkpad, gst_event_new_stream_start ("test"));
+  gst_pad_send_event (queue2_sinkpad, gst_event_new_stream_start ("test"));
+
+  caps = gst_caps_new_simple ("audio/x-raw",
+      "format", G_TYPE_STRING, GST_AUDIO_NE (S16),
+      "layout", G_TYPE_STRING, "interleaved",
+      "rate", G_TYPE_INT, 1000, "channels", G_TYPE_INT, 1, NULL);
+  gst_pad_set_caps (queue1_sinkpad, caps);
+  gst_pad_set_caps (queue2_sinkpad, caps);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  event = gst_event_new_segment (&segment);
+  gst_pad_send_event (queue1_sinkpad, gst_event_ref (event));
+  gst_pad_send_event (queue2_sinkpad, event);
+
+  /* 0x0101 on the first and 0x0202 on the second pad for one second */
+  send_buffer_mix_minus (queue1_sinkpad, 1);
+  send_buffer_mix_minus (queue2_sinkpad, 2);
+
+  g_idle_add ((GSourceFunc) set_playing, bin);
+  g_main_loop_run (main_loop);
+
+  /* the complete mix, and each pad's mix without its own input */
+  check_buffers_mix_minus (received_buffers, 3);
+  check_buffers_mix_minus (received_buffers1, 2);
+  check_buffers_mix_minus (received_buffers2, 1);
+
+  g_list_free_full (received_buffers, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (received_buffers1, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (received_buffers2, (GDestroyNotify) gst_buffer_unref);
+
+  gst_element_release_request_pad (audiomixer, sinkpad1);
+  gst_object_unref (sinkpad1);
+  gst_object_unref (queue1_sinkpad);
+  gst_element_release_request_pad (audiomixer, sinkpad2);
+  gst_object_unref (sinkpad2);
+  gst_object_unref (queue2_sinkpad);
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_bus_remove_signal_watch (bus);
+  gst_object_unref (bus);
+  gst_object_unref (bin);
+  g_main_loop_unref (main_loop);
+}
+
+GST_END_TEST;
+
+static GMutex minus_blocked_lock;
+static GCond minus_blocked_cond;
+static gboolean minus_blocked;
+
+static GstPadProbeReturn
+minus_pad_blocked_cb (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  g_mutex_lock (&minus_blocked_lock);
+  minus_blocked = TRUE;
+  g_cond_signal (&minus_blocked_cond);
+  g_mutex_unlock (&minus_blocked_lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* the streaming thread is stuck on a mix-minus pad, a flushing seek on
+ * the src pad must unblock it instead of waiting for it forever */
+GST_START_TEST (test_mix_minus_flushing_seek)
+{
+  GstElement *bin, *src1, *src2, *audiomixer, *sink, *sink1, *sink2;
+  GstPad *sinkpad1, *sinkpad2, *srcpad, *minus_srcpad;
+  GstStateChangeReturn state_res;
+  gulong probe_id;
+  gboolean res;
+
+  bin = gst_pipeline_new ("pipeline");
+  src1 = gst_element_factory_make ("audiotestsrc", "src1");
+  g_object_set (src1, "wave", 4, NULL); /* silence */
+  src2 = gst_element_factory_make ("audiotestsrc", "src2");
+  g_object_set (src2, "wave", 4, NULL); /* silence */
+  audiomixer = gst_element_factory_make ("audiomixer", "audiomixer");
+  g_object_set (audiomixer, "mix-minus", TRUE, NULL);
+  sink = gst_element_factory_make ("fakesink", "sink");
+  sink1 = gst_element_factory_make ("fakesink", "sink1");
+  sink2 = gst_element_factory_make ("fakesink", "sink2");
+  gst_bin_add_many (GST_BIN (bin), src1, src2, audiomixer, sink, sink1,
+      sink2, NULL);
+  fail_unless (gst_element_link (audiomixer, sink));
+
+  sinkpad1 = gst_element_get_request_pad (audiomixer, "sink_%u");
+  fail_if (sinkpad1 == NULL, NULL);
+  fail_unless (gst_element_link_pads (src1, "src", audiomixer,
+          GST_OBJECT_NAME (sinkpad1)));
+  link_mix_minus_pad (audiomixer, sinkpad1, sink1);
+
+  sinkpad2 = gst_element_get_request_pad (audiomixer, "sink_%u");
+  fail_if (sinkpad2 == NULL, NULL);
+  fail_unless (gst_element_link_pads (src2, "src", audiomixer,
+          GST_OBJECT_NAME (sinkpad2)));
+  link_mix_minus_pad (audiomixer, sinkpad2, sink2);
+
+  /* the mix-minus outputs are pushed first, block on the first one */
+  minus_blocked = FALSE;
+  minus_srcpad = gst_element_get_static_pad (audiomixer, "src_0");
+  fail_unless (minus_srcpad != NULL);
+  probe_id = gst_pad_add_probe (minus_srcpad,
+      GST_PAD_PROBE_TYPE_BLOCK | GST_PAD_PROBE_TYPE_BUFFER,
+      minus_pad_blocked_cb, NULL, NULL);
+
+  state_res = gst_element_set_state (bin, GST_STATE_PAUSED);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+
+  g_mutex_lock (&minus_blocked_lock);
+  while (!minus_blocked)
+    g_cond_wait (&minus_blocked_cond, &minus_blocked_lock);
+  g_mutex_unlock (&minus_blocked_lock);
+
+  srcpad = gst_element_get_static_pad (audiomixer, "src");
+  res = gst_pad_send_event (srcpad, gst_event_new_seek (1.0, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH, GST_SEEK_TYPE_SET, 0, GST_SEEK_TYPE_NONE, -1));
+  fail_unless (res == TRUE);
+  gst_object_unref (srcpad);
+
+  gst_pad_remove_probe (minus_srcpad, probe_id);
+  gst_object_unref (minus_srcpad);
+
+  state_res = gst_element_set_state (bin, GST_STATE_NULL);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+
+  gst_element_release_request_pad (audiomixer, sinkpad1);
+  gst_object_unref (sinkpad1);
+  gst_element_release_request_pad (audiomixer, sinkpad2);
+  gst_object_unref (sinkpad2);
+  gst_object_unref (bin);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_reuse_input_buffer)
+{
+  GstHarness *h;
+  GstBuffer *buffer, *outbuf;
+  GstMemory *mem;
+  GstMapInfo map;
+  gint i, j;
+
+  h = gst_harness_new_with_padnames ("audiomixer", "sink_0", "src");
+  g_object_set (h->element, "output-buffer-duration", 10 * GST_MSECOND, NULL);
+  gst_harness_set_src_caps_str (h, "audio/x-raw, "
+      "format = (string) " GST_AUDIO_NE (S16) ", "
+      "layout = (string) interleaved, rate = (int) 1000, channels = (int) 1");
+
+  for (i = 0; i < 2; i++) {
+    buffer = gst_buffer_new_and_alloc (10 * sizeof (gint16));
+    gst_buffer_memset (buffer, 0, i + 1, 10 * sizeof (gint16));
+    GST_BUFFER_PTS (buffer) = i * 10 * GST_MSECOND;
+    GST_BUFFER_DURATION (buffer) = 10 * GST_MSECOND;
+    mem = gst_buffer_peek_memory (buffer, 0);
+    fail_unless_equals_int (gst_harness_push (h, buffer), GST_FLOW_OK);
+
+    outbuf = gst_harness_pull (h);
+
+    /* The first buffer is mixed, after that the input buffers exactly
+     * cover the output buffers and are output as they are */
+    if (i > 0)
+      fail_unless (gst_buffer_peek_memory (outbuf, 0) == mem);
+
+    gst_buffer_map (outbuf, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, 10 * sizeof (gint16));
+    for (j = 0; j < map.size; j++)
+      fail_unless_equals_int (map.data[j], i + 1);
+    gst_buffer_unmap (outbuf, &map);
+    gst_buffer_unref (outbuf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static guint
+count_metas (GstBuffer * buffer)
+{
+  gpointer state = NULL;
+  guint n = 0;
+
+  while (gst_buffer_iterate_meta (buffer, &state))
+    n++;
+
+  return n;
+}
+
+/* A reused input buffer must look like a newly allocated output buffer,
+ * a GAP input is not reused and gives silence */
+GST_START_TEST (test_reuse_input_buffer_clean)
+{
+  GstHarness *h;
+  GstBuffer *buffer, *outbuf, *parent;
+  GstMemory *mem;
+  GstMapInfo map;
+  gint i, j;
+
+  h = gst_harness_new_with_padnames ("audiomixer", "sink_0", "src");
+  g_object_set (h->element, "output-buffer-duration", 10 * GST_MSECOND, NULL);
+  gst_harness_set_src_caps_str (h, "audio/x-raw, "
+      "format = (string) " GST_AUDIO_NE (S16) ", "
+      "layout = (string) interleaved, rate = (int) 1000, channels = (int) 1");
+  parent = gst_buffer_new ();
+
+  for (i = 0; i < 3; i++) {
+    buffer = gst_buffer_new_and_alloc (10 * sizeof (gint16));
+    gst_buffer_memset (buffer, 0, i + 1, 10 * sizeof (gint16));
+    GST_BUFFER_PTS (buffer) = i * 10 * GST_MSECOND;
+    GST_BUFFER_DTS (buffer) = i * 10 * GST_MSECOND;
+    GST_BUFFER_DURATION (buffer) = 10 * GST_MSECOND;
+    GST_BUFFER_OFFSET (buffer) = 1000;
+    GST_BUFFER_OFFSET_END (buffer) = 1010;
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DROPPABLE);
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_HEADER);
+    if (i == 2)
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_GAP);
+    gst_buffer_add_parent_buffer_meta (buffer, parent);
+    mem = gst_buffer_peek_memory (buffer, 0);
+    fail_unless_equals_int (gst_harness_push (h, buffer), GST_FLOW_OK);
+
+    outbuf = gst_harness_pull (h);
+
+    /* the second buffer is output as it is, the GAP one is not */
+    if (i == 1)
+      fail_unless (gst_buffer_peek_memory (outbuf, 0) == mem);
+    else
+      fail_if (gst_buffer_peek_memory (outbuf, 0) == mem);
+
+    fail_unless_equals_int (count_metas (outbuf), 0);
+    fail_if (GST_BUFFER_FLAG_IS_SET (outbuf, GST_BUFFER_FLAG_DELTA_UNIT));
+    fail_if (GST_BUFFER_FLAG_IS_SET (outbuf, GST_BUFFER_FLAG_DROPPABLE));
+    fail_if (GST_BUFFER_FLAG_IS_SET (outbuf, GST_BUFFER_FLAG_HEADER));
+    fail_unless_equals_int (GST_BUFFER_FLAG_IS_SET (outbuf,
+            GST_BUFFER_FLAG_GAP), i == 2);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (outbuf), i * 10 * GST_MSECOND);
+    fail_unless_equals_uint64 (GST_BUFFER_DTS (outbuf), GST_CLOCK_TIME_NONE);
+    fail_unless_equals_uint64 (GST_BUFFER_OFFSET (outbuf), i * 10);
+    fail_unless_equals_uint64 (GST_BUFFER_OFFSET_END (outbuf), i * 10 + 10);
+
+    gst_buffer_map (outbuf, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, 10 * sizeof (gint16));
+    for (j = 0; j < map.size; j++)
+      fail_unless_equals_int (map.data[j], i == 2 ? 0 : i + 1);
+    gst_buffer_unmap (outbuf, &map);
+    gst_buffer_unref (outbuf);
+  }
+
+  gst_buffer_unref (parent);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_reuse_input_buffer_unaligned)
+{
+  GstHarness *h;
+  GstBuffer *buffer, *outbuf;
+  GstAllocationParams params;
+  GstMemory *mem;
+  GstMapInfo map;
+  gint i, j;
+
+  h = gst_harness_new_with_padnames ("audiomixer", "sink_0", "src");
+  g_object_set (h->element, "output-buffer-duration", 10 * GST_MSECOND, NULL);
+
+  /* downstream wants buffers aligned on 16 bytes */
+  gst_allocation_params_init (&params);
+  params.align = 15;
+  gst_harness_set_propose_allocator (h, NULL, &params);
+
+  gst_harness_set_src_caps_str (h, "audio/x-raw, "
+      "format = (string) " GST_AUDIO_NE (S16) ", "
+      "layout = (string) interleaved, rate = (int) 1000, channels = (int) 1");
+
+  for (i = 0; i < 2; i++) {
+    /* 2 bytes after an aligned address */
+    buffer = gst_buffer_new_allocate (NULL, 12 * sizeof (gint16), &params);
+    gst_buffer_resize (buffer, sizeof (gint16), 10 * sizeof (gint16));
+    gst_buffer_memset (buffer, 0, i + 1, 10 * sizeof (gint16));
+    GST_BUFFER_PTS (buffer) = i * 10 * GST_MSECOND;
+    GST_BUFFER_DURATION (buffer) = 10 * GST_MSECOND;
+    mem = gst_buffer_peek_memory (buffer, 0);
+    fail_unless_equals_int (gst_harness_push (h, buffer), GST_FLOW_OK);
+
+    /* the input buffers are copied into aligned output buffers */
+    outbuf = gst_harness_pull (h);
+    fail_if (gst_buffer_peek_memory (outbuf, 0) == mem);
+
+    gst_buffer_map (outbuf, &map, GST_MAP_READ);
+    fail_unless (((guintptr) map.data & 15) == 0);
+    fail_unless_equals_int (map.size, 10 * sizeof (gint16));
+    for (j = 0; j < map.size; j++)
+      fail_unless_equals_int (map.data[j], i + 1);
+    gst_buffer_unmap (outbuf, &map);
+    gst_buffer_unref (outbuf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 static Suite *
 audiomixer_suite (void)
 {
@@ -1935,6 +2471,12 @@ audiomixer_suite (void)
   tcase_add_test (tc_chain, test_sync_unaligned);
   tcase_add_test (tc_chain, test_segment_base_handling);
   tcase_add_test (tc_chain, test_sinkpad_property_controller);
+  tcase_add_test (tc_chain, test_sinkpad_volume_ramp);
+  tcase_add_test (tc_chain, test_mix_minus);
+  tcase_add_test (tc_chain, test_mix_minus_flushing_seek);
+  tcase_add_test (tc_chain, test_reuse_input_buffer);
+  tcase_add_test (tc_chain, test_reuse_input_buffer_unaligned);
+  tcase_add_test (tc_chain, test_reuse_input_buffer_clean);
 
   /* Use a longer timeout */
 #ifdef HAVE_VALGRIND
@@ -19,6 +19,9 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <gst/uridownloader/gsturidownloader.h>
+#include <gst/uridownloader/gsturisourcepool.h>
+#include <gst/adaptivedemux/gstadaptivedemuxabr.h>
 #include "adaptive_demux_common.h"
 
 #define DEMUX_ELEMENT_NAME "dashdemux"
@@ -975,6 +978,309 @@ GST_START_TEST (testFragmentDownloadError)
 
 GST_END_TEST;
 
+static void
+testSourcePoolPreTestCallback (GstAdaptiveDemuxTestEngine * engine,
+    gpointer user_data)
+{
+  GstUriSourcePool *pool = user_data;
+  GstContext *context;
+
+  /* like an application answering the need-context message */
+  context = gst_context_new (GST_URI_SOURCE_POOL_CONTEXT_TYPE, TRUE);
+  gst_context_set_uri_source_pool (context, pool);
+  gst_element_set_context (engine->pipeline, context);
+  gst_context_unref (context);
+}
+
+/*
+ * Test an mpd with an audio and a video stream sharing a single connection
+ * from an application provided source pool
+ *
+ */
+GST_START_TEST (testSharedSourcePool)
+{
+  const gchar *mpd =
+      "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+      "<MPD xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\""
+      "     xmlns=\"urn:mpeg:DASH:schema:MPD:2011\""
+      "     xsi:schemaLocation=\"urn:mpeg:DASH:schema:MPD:2011 DASH-MPD.xsd\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-on-demand:2011\""
+      "     type=\"static\""
+      "     minBufferTime=\"PT1.500S\""
+      "     mediaPresentationDuration=\"PT135.743S\">"
+      "  <Period>"
+      "    <AdaptationSet mimeType=\"audio/webm\""
+      "                   subsegmentAlignment=\"true\">"
+      "      <Representation id=\"171\""
+      "                      codecs=\"vorbis\""
+      "                      audioSamplingRate=\"44100\""
+      "                      startWithSAP=\"1\""
+      "                      bandwidth=\"129553\">"
+      "        <BaseURL>audio.webm</BaseURL>"
+      "        <SegmentBase indexRange=\"4452-4686\""
+      "                     indexRangeExact=\"true\">"
+      "          <Initialization range=\"0-4451\" />"
+      "        </SegmentBase>"
+      "      </Representation>"
+      "    </AdaptationSet>"
+      "    <AdaptationSet mimeType=\"video/webm\""
+      "                   subsegmentAlignment=\"true\">"
+      "      <Representation id=\"242\""
+      "                      codecs=\"vp9\""
+      "                      width=\"426\""
+      "                      height=\"240\""
+      "                      startWithSAP=\"1\""
+      "                      bandwidth=\"490208\">"
+      "        <BaseURL>video.webm</BaseURL>"
+      "        <SegmentBase indexRange=\"234-682\""
+      "                     indexRangeExact=\"true\">"
+      "          <Initialization range=\"0-233\" />"
+      "        </SegmentBase>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+  GstDashDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/test.mpd", (guint8 *) mpd, 0},
+    {"http://unit.test/audio.webm", NULL, 5000},
+    {"http://unit.test/video.webm", NULL, 9000},
+    {NULL, NULL, 0},
+  };
+  GstTestHTTPSrcCallbacks http_src_callbacks = { 0 };
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"audio_00", 5000, NULL},
+    {"video_00", 9000, NULL}
+  };
+  GstAdaptiveDemuxTestCallbacks test_callbacks = { 0 };
+  GstAdaptiveDemuxTestCase *testData;
+  GstUriSourcePool *pool;
+  GstElement *source;
+
+  pool = gst_uri_source_pool_new ();
+  g_object_set (pool, "max-connections-per-host", 1, NULL);
+
+  testData = gst_adaptive_demux_test_case_new ();
+  http_src_callbacks.src_start = gst_dashdemux_http_src_start;
+  http_src_callbacks.src_create = gst_dashdemux_http_src_create;
+  gst_test_http_src_install_callbacks (&http_src_callbacks, inputTestData);
+
+  COPY_OUTPUT_TEST_DATA (outputTestData, testData);
+  test_callbacks.pre_test = testSourcePoolPreTestCallback;
+  test_callbacks.appsink_received_data =
+      gst_adaptive_demux_test_check_received_data;
+  test_callbacks.appsink_eos =
+      gst_adaptive_demux_test_check_size_of_received_data;
+
+  /* both streams take turns with the only source element */
+  gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME, "http://unit.test/test.mpd",
+      &test_callbacks, pool);
+  g_object_unref (testData);
+
+  /* it was given back once the pipeline stopped */
+  source = gst_uri_source_pool_acquire (pool, "http://unit.test/test.mpd",
+      NULL);
+  fail_unless (source != NULL);
+  gst_element_set_state (source, GST_STATE_NULL);
+  gst_uri_source_pool_release (pool, source);
+  gst_object_unref (pool);
+}
+
+GST_END_TEST;
+
+/* checks that @fragment holds the bytes of the generated payload that start
+ * at the 4 bytes aligned @offset */
+static void
+check_pattern_fragment (GstFragment * fragment, guint64 offset, gsize size)
+{
+  GstBuffer *buffer;
+  GstMapInfo info;
+  gsize i;
+
+  buffer = gst_fragment_get_buffer (fragment);
+  fail_unless (buffer != NULL);
+  assert_equals_uint64 (gst_buffer_get_size (buffer), size);
+
+  gst_buffer_map (buffer, &info, GST_MAP_READ);
+  for (i = 0; i + 4 <= size; i += 4)
+    assert_equals_uint64 (GST_READ_UINT32_LE (info.data + i), offset + i);
+  gst_buffer_unmap (buffer, &info);
+  gst_buffer_unref (buffer);
+}
+
+/*
+ * Test downloading several ranges of a resource, the adjacent ones being
+ * coalesced, and splitting a large range over parallel requests
+ */
+GST_START_TEST (testUriDownloaderRanges)
+{
+  GstDashDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/video.mp4", NULL, 1024 * 1024},
+    {NULL, NULL, 0},
+  };
+  GstTestHTTPSrcCallbacks http_src_callbacks = { 0 };
+  GstUriDownloaderRange ranges[] = {
+    {0, 1023, NULL},
+    {1024, 4095, NULL},
+    {4096, -1, NULL},
+  };
+  GstUriDownloader *downloader;
+  GstFragment *download;
+  GstBufferList *buffers;
+  GError *err = NULL;
+
+  http_src_callbacks.src_start = gst_dashdemux_http_src_start;
+  http_src_callbacks.src_create = gst_dashdemux_http_src_create;
+  gst_test_http_src_install_callbacks (&http_src_callbacks, inputTestData);
+
+  downloader = gst_uri_downloader_new ();
+
+  fail_unless (gst_uri_downloader_fetch_uri_ranges (downloader,
+          "http://unit.test/video.mp4", NULL, FALSE, FALSE, TRUE, ranges,
+          G_N_ELEMENTS (ranges), &err));
+  fail_unless (err == NULL);
+  check_pattern_fragment (ranges[0].fragment, 0, 1024);
+  check_pattern_fragment (ranges[1].fragment, 1024, 3072);
+  check_pattern_fragment (ranges[2].fragment, 4096, 1024 * 1024 - 4096);
+  assert_equals_int64 (ranges[1].fragment->range_start, 1024);
+  assert_equals_int64 (ranges[1].fragment->range_end, 4095);
+  g_object_unref (ranges[0].fragment);
+  g_object_unref (ranges[1].fragment);
+  g_object_unref (ranges[2].fragment);
+
+  /* the resource is large enough to be split in 4 requests */
+  download = gst_uri_downloader_fetch_uri_parallel (downloader,
+      "http://unit.test/video.mp4", NULL, FALSE, FALSE, TRUE, 4,
+      1024 * 1024 - 1, 4, &err);
+  fail_unless (download != NULL);
+  fail_unless (err == NULL);
+  assert_equals_uint64 (gst_fragment_get_size (download), 1024 * 1024 - 4);
+  buffers = gst_fragment_get_buffer_list (download);
+  fail_unless (buffers != NULL);
+  fail_unless (gst_buffer_list_length (buffers) >= 4);
+  gst_buffer_list_unref (buffers);
+  check_pattern_fragment (download, 4, 1024 * 1024 - 4);
+  assert_equals_int64 (download->range_start, 4);
+  assert_equals_int64 (download->range_end, 1024 * 1024 - 1);
+  g_object_unref (download);
+
+  /* a range past the end of the resource fails */
+  download = gst_uri_downloader_fetch_uri_parallel (downloader,
+      "http://unit.test/video.mp4", NULL, FALSE, FALSE, TRUE, 0,
+      2 * 1024 * 1024 - 1, 4, &err);
+  fail_unless (download == NULL);
+  fail_unless (err != NULL);
+  g_clear_error (&err);
+
+  gst_object_unref (downloader);
+}
+
+GST_END_TEST;
+
+static gchar *
+gst_dashdemux_simulation_mpd (const gchar * uri,
+    const guint64 * bitrates, guint n_bitrates, guint n_fragments)
+{
+  GString *mpd;
+  guint i;
+
+  if (strcmp (uri, "http://unit.test/test.mpd") != 0)
+    return NULL;
+
+  mpd = g_string_new ("<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+      "<MPD xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\""
+      "     xmlns=\"urn:mpeg:DASH:schema:MPD:2011\""
+      "     xsi:schemaLocation=\"urn:mpeg:DASH:schema:MPD:2011 DASH-MPD.xsd\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"static\"" "     minBufferTime=\"PT2.000S\"");
+  g_string_append_printf (mpd, "     mediaPresentationDuration=\"PT%uS\">"
+      "  <Period>"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <SegmentTemplate media=\"$RepresentationID$/$Number$.m4s\""
+      "                       timescale=\"1\" duration=\"2\""
+      "                       startNumber=\"1\" />", n_fragments * 2);
+  for (i = 0; i < n_bitrates; i++) {
+    g_string_append_printf (mpd,
+        "      <Representation id=\"%" G_GUINT64_FORMAT "\""
+        "                      codecs=\"avc1.42001f\""
+        "                      bandwidth=\"%" G_GUINT64_FORMAT "\" />",
+        bitrates[i] / 1000, bitrates[i]);
+  }
+  g_string_append (mpd, "    </AdaptationSet></Period></MPD>");
+  return g_string_free (mpd, FALSE);
+}
+
+static guint64
+gst_dashdemux_simulation_match_uri (const gchar * uri, guint n_fragments)
+{
+  guint kbps, number;
+
+  if (sscanf (uri, "http://unit.test/%u/%u.m4s", &kbps, &number) == 2
+      && number >= 1 && number <= n_fragments)
+    return kbps * (guint64) 1000;
+  return 0;
+}
+
+/*
+ * Test the bitrate adaptation algorithms
+ * Plays an mpd with three representations over a simulated network whose
+ * bandwidth drops below the lowest representation and recovers, and
+ * checks that every algorithm plays it completely, and reproducibly when
+ * based on the download statistics.
+ */
+GST_START_TEST (testAbrSimulation)
+{
+  gst_adaptive_demux_test_abr_simulation (DEMUX_ELEMENT_NAME,
+      "http://unit.test/test.mpd", gst_dashdemux_simulation_mpd,
+      gst_dashdemux_simulation_match_uri, NULL, 0);
+}
+
+GST_END_TEST;
+
+/*
+ * Test the default bitrate adaptation
+ * It uses the average input rate of the queue as is, like the base class
+ * always did: the download statistics and bitrate-limit are ignored.
+ */
+GST_START_TEST (testAbrThroughput)
+{
+  static const guint64 bitrates[] = { 500000, 1500000, 3000000 };
+  GstAdaptiveDemuxAbrInput input = { bitrates, G_N_ELEMENTS (bitrates), };
+  GstAdaptiveDemuxAbrFragment fragment = { 0, };
+  GstAdaptiveDemuxAbr *abr;
+  GstElement *demux;
+  gint algorithm;
+
+  demux = gst_element_factory_make (DEMUX_ELEMENT_NAME, NULL);
+  fail_unless (demux != NULL);
+  g_object_get (demux, "abr-algorithm", &algorithm, NULL);
+  assert_equals_int (algorithm, GST_ADAPTIVE_DEMUX_ABR_THROUGHPUT);
+  gst_object_unref (demux);
+
+  abr = gst_adaptive_demux_abr_new (gst_adaptive_demux_abr_algorithm_get_funcs
+      (GST_ADAPTIVE_DEMUX_ABR_THROUGHPUT));
+  fail_unless (abr != NULL);
+
+  input.buffer_target = 10 * GST_SECOND;
+  input.bitrate_limit = 0.8;
+  input.input_rate = 2000000;
+  assert_equals_uint64 (gst_adaptive_demux_abr_get_bitrate (abr, &input),
+      2000000);
+  assert_equals_uint64 (abr->estimate, 2000000);
+
+  /* a fragment downloaded at 8 Mbps doesn't change the estimation */
+  fragment.size = 1000000;
+  fragment.download_time = GST_SECOND;
+  fragment.duration = 2 * GST_SECOND;
+  fragment.bitrate = bitrates[1];
+  gst_adaptive_demux_abr_fragment_downloaded (abr, &fragment);
+  assert_equals_uint64 (gst_adaptive_demux_abr_get_bitrate (abr, &input),
+      2000000);
+
+  input.input_rate = 0;
+  assert_equals_uint64 (gst_adaptive_demux_abr_get_bitrate (abr, &input), 0);
+
+  gst_adaptive_demux_abr_free (abr);
+}
+
+GST_END_TEST;
+
 static Suite *
 dash_demux_suite (void)
 {
@@ -995,6 +1301,10 @@ dash_demux_suite (void)
   tcase_add_test (tc_basicTest, testDownloadError);
   tcase_add_test (tc_basicTest, testFragmentDownloadError);
   tcase_add_test (tc_basicTest, testQuery);
+  tcase_add_test (tc_basicTest, testSharedSourcePool);
+  tcase_add_test (tc_basicTest, testUriDownloaderRanges);
+  tcase_add_test (tc_basicTest, testAbrSimulation);
+  tcase_add_test (tc_basicTest, testAbrThroughput);
 
   tcase_add_unchecked_fixture (tc_basicTest, gst_adaptive_demux_test_setup,
       gst_adaptive_demux_test_teardown);
@@ -0,0 +1,222 @@
+/* GStreamer unit test for the ISOBMFF parsing of dashdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "../../ext/dash/gstisoff.c"
+#undef GST_CAT_DEFAULT
+
+#include <gst/check/gstcheck.h>
+
+/* a moof box with a single track fragment: default-base-is-moof, non-sync
+ * samples by default, a decode time of 1000 and a track run of 4 samples
+ * whose first one is a sync sample. The data offset points right after the
+ * header of the following mdat box */
+static const guint8 moof_data[] = {
+  0x00, 0x00, 0x00, 0x80, 'm', 'o', 'o', 'f',
+  /* mfhd */
+  0x00, 0x00, 0x00, 0x10, 'm', 'f', 'h', 'd',
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+  /* traf */
+  0x00, 0x00, 0x00, 0x68, 't', 'r', 'a', 'f',
+  /* tfhd: default-base-is-moof, default sample flags */
+  0x00, 0x00, 0x00, 0x14, 't', 'f', 'h', 'd',
+  0x00, 0x02, 0x00, 0x20, 0x00, 0x00, 0x00, 0x01,
+  0x00, 0x01, 0x00, 0x00,
+  /* tfdt version 1 */
+  0x00, 0x00, 0x00, 0x14, 't', 'f', 'd', 't',
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x03, 0xe8,
+  /* trun: data offset, first sample flags, sample durations and sizes */
+  0x00, 0x00, 0x00, 0x38, 't', 'r', 'u', 'n',
+  0x00, 0x00, 0x03, 0x05, 0x00, 0x00, 0x00, 0x04,
+  0x00, 0x00, 0x00, 0x88, 0x02, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x64, 0x00, 0x00, 0x03, 0xe8,
+  0x00, 0x00, 0x00, 0x64, 0x00, 0x00, 0x00, 0xc8,
+  0x00, 0x00, 0x00, 0x64, 0x00, 0x00, 0x01, 0x2c,
+  0x00, 0x00, 0x00, 0x64, 0x00, 0x00, 0x01, 0x90
+};
+
+GST_START_TEST (dash_isoff_box_header)
+{
+  static const guint8 large_size[] = {
+    0x00, 0x00, 0x00, 0x01, 'm', 'd', 'a', 't',
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x10
+  };
+  GstByteReader reader;
+  guint32 type;
+  guint header_size;
+  guint64 size;
+
+  gst_byte_reader_init (&reader, moof_data, sizeof (moof_data));
+  fail_unless (gst_isoff_parse_box_header (&reader, &type, NULL, &header_size,
+          &size));
+  assert_equals_int (type, GST_ISOFF_FOURCC_MOOF);
+  assert_equals_int (header_size, 8);
+  assert_equals_uint64 (size, sizeof (moof_data));
+  assert_equals_int (gst_byte_reader_get_pos (&reader), 8);
+
+  gst_byte_reader_init (&reader, large_size, sizeof (large_size));
+  fail_unless (gst_isoff_parse_box_header (&reader, &type, NULL, &header_size,
+          &size));
+  assert_equals_int (type, GST_ISOFF_FOURCC_MDAT);
+  assert_equals_int (header_size, 16);
+  assert_equals_uint64 (size, G_GUINT64_CONSTANT (0x100000010));
+
+  /* a truncated header leaves the reader untouched */
+  gst_byte_reader_init (&reader, large_size, 12);
+  fail_if (gst_isoff_parse_box_header (&reader, &type, NULL, &header_size,
+          &size));
+  assert_equals_int (gst_byte_reader_get_pos (&reader), 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (dash_isoff_moof_parse)
+{
+  GstByteReader reader;
+  GstMoofBox *moof;
+  GstTrafBox *traf;
+  GstTrunBox *trun;
+  GstTrunSample *sample;
+
+  gst_byte_reader_init (&reader, moof_data + 8, sizeof (moof_data) - 8);
+  moof = gst_isoff_moof_box_parse (&reader);
+  fail_unless (moof != NULL);
+
+  assert_equals_int (moof->mfhd.sequence_number, 1);
+  assert_equals_int (moof->traf->len, 1);
+
+  traf = &g_array_index (moof->traf, GstTrafBox, 0);
+  assert_equals_int (traf->tfhd.track_id, 1);
+  assert_equals_int (traf->tfhd.flags,
+      GST_TFHD_FLAGS_DEFAULT_BASE_IS_MOOF |
+      GST_TFHD_FLAGS_DEFAULT_SAMPLE_FLAGS_PRESENT);
+  assert_equals_int (traf->tfhd.default_sample_flags, 0x00010000);
+  assert_equals_uint64 (traf->tfdt.decode_time, 1000);
+  assert_equals_int (traf->trun->len, 1);
+
+  trun = &g_array_index (traf->trun, GstTrunBox, 0);
+  assert_equals_int (trun->sample_count, 4);
+  assert_equals_int (trun->data_offset, sizeof (moof_data) + 8);
+  assert_equals_int (trun->first_sample_flags, 0x02000000);
+  assert_equals_int (trun->samples->len, 4);
+
+  sample = &g_array_index (trun->samples, GstTrunSample, 0);
+  assert_equals_int (sample->sample_duration, 100);
+  assert_equals_int (sample->sample_size, 1000);
+  sample = &g_array_index (trun->samples, GstTrunSample, 3);
+  assert_equals_int (sample->sample_duration, 100);
+  assert_equals_int (sample->sample_size, 400);
+
+  gst_isoff_moof_box_free (moof);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (dash_isoff_moof_sync_samples)
+{
+  GstByteReader reader;
+  GstMoofBox *moof;
+  GArray *sync_samples;
+  GstIsoffSyncSample *sync_sample;
+
+  gst_byte_reader_init (&reader, moof_data + 8, sizeof (moof_data) - 8);
+  moof = gst_isoff_moof_box_parse (&reader);
+  fail_unless (moof != NULL);
+
+  /* only the first sample overrides the default non-sync flags */
+  sync_samples = gst_isoff_moof_box_get_sync_samples (moof);
+  fail_unless (sync_samples != NULL);
+  assert_equals_int (sync_samples->len, 1);
+  sync_sample = &g_array_index (sync_samples, GstIsoffSyncSample, 0);
+  assert_equals_int (sync_sample->track_id, 1);
+  assert_equals_uint64 (sync_sample->offset, sizeof (moof_data) + 8);
+  assert_equals_int (sync_sample->size, 1000);
+  assert_equals_uint64 (sync_sample->decode_time, 1000);
+
+  g_array_free (sync_samples, TRUE);
+  gst_isoff_moof_box_free (moof);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (dash_isoff_moof_keep_first_sample)
+{
+  GstByteReader reader;
+  GstMoofBox *moof;
+  GstTrunBox *trun;
+  guint8 *data;
+
+  data = g_memdup (moof_data, sizeof (moof_data));
+  fail_unless (gst_isoff_moof_box_keep_first_sample (data,
+          sizeof (moof_data)));
+
+  gst_byte_reader_init (&reader, data + 8, sizeof (moof_data) - 8);
+  moof = gst_isoff_moof_box_parse (&reader);
+  fail_unless (moof != NULL);
+  trun = &g_array_index (g_array_index (moof->traf, GstTrafBox, 0).trun,
+      GstTrunBox, 0);
+  assert_equals_int (trun->sample_count, 1);
+  assert_equals_int (trun->data_offset, sizeof (moof_data) + 8);
+  assert_equals_int (trun->samples->len, 1);
+  gst_isoff_moof_box_free (moof);
+
+  /* not a moof box */
+  fail_if (gst_isoff_moof_box_keep_first_sample (data + 8, 16));
+
+  g_free (data);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (dash_isoff_moof_invalid)
+{
+  GstByteReader reader;
+  guint8 *data;
+
+  /* truncated in the middle of the track run */
+  gst_byte_reader_init (&reader, moof_data + 8, sizeof (moof_data) - 16);
+  fail_unless (gst_isoff_moof_box_parse (&reader) == NULL);
+
+  /* more samples than the track run has room for */
+  data = g_memdup (moof_data, sizeof (moof_data));
+  GST_WRITE_UINT32_BE (data + 84, 0x10000000);
+  gst_byte_reader_init (&reader, data + 8, sizeof (moof_data) - 8);
+  fail_unless (gst_isoff_moof_box_parse (&reader) == NULL);
+  g_free (data);
+}
+
+GST_END_TEST;
+
+static Suite *
+dash_isoff_suite (void)
+{
+  Suite *s = suite_create ("dash-isoff");
+  TCase *tc_isoff = tcase_create ("isoff");
+
+  tcase_add_test (tc_isoff, dash_isoff_box_header);
+  tcase_add_test (tc_isoff, dash_isoff_moof_parse);
+  tcase_add_test (tc_isoff, dash_isoff_moof_sync_samples);
+  tcase_add_test (tc_isoff, dash_isoff_moof_keep_first_sample);
+  tcase_add_test (tc_isoff, dash_isoff_moof_invalid);
+
+  suite_add_tcase (s, tc_isoff);
+
+  return s;
+}
+
+GST_CHECK_MAIN (dash_isoff);
@@ -699,7 +699,7 @@ GST_START_TEST
   segmentList = periodNode->SegmentList;
   multSegBaseType = segmentList->MultSegBaseType;
   segmentTimeline = multSegBaseType->SegmentTimeline;
-  sNode = (GstSNode *) g_queue_peek_head (&segmentTimeline->S);
+  sNode = &g_array_index (segmentTimeline->S, GstSNode, 0);
   assert_equals_uint64 (sNode->t, 1);
   assert_equals_uint64 (sNode->d, 2);
   assert_equals_uint64 (sNode->r, 3);
@@ -778,7 +778,7 @@ GST_START_TEST (dash_mpdparser_period_segmentList_segmentURL)
 
   periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
   segmentList = periodNode->SegmentList;
-  segmentURL = (GstSegmentURLNode *) segmentList->SegmentURL->data;
+  segmentURL = &g_array_index (segmentList->SegmentURL, GstSegmentURLNode, 0);
   assert_equals_string (segmentURL->media, "TestMedia");
   assert_equals_uint64 (segmentURL->mediaRange->first_byte_pos, 100);
   assert_equals_uint64 (segmentURL->mediaRange->last_byte_pos, 200);
@@ -978,7 +978,7 @@ GST_START_TEST
   segmentTemplate = periodNode->SegmentTemplate;
   multSegBaseType = segmentTemplate->MultSegBaseType;
   segmentTimeline = (GstSegmentTimelineNode *) multSegBaseType->SegmentTimeline;
-  sNode = (GstSNode *) g_queue_peek_head (&segmentTimeline->S);
+  sNode = &g_array_index (segmentTimeline->S, GstSNode, 0);
   assert_equals_uint64 (sNode->t, 1);
   assert_equals_uint64 (sNode->d, 2);
   assert_equals_uint64 (sNode->r, 3);
@@ -2013,6 +2013,77 @@ GST_START_TEST (dash_mpdparser_period_adaptationSet_segmentTemplate_inherit)
 
 GST_END_TEST;
 
+/*
+ * Test SegmentTemplate inheritance when the Representation and the
+ * AdaptationSet come before the SegmentTemplate of their parent
+ */
+GST_START_TEST (dash_mpdparser_segmentTemplate_inherit_document_order)
+{
+  GstPeriodNode *periodNode;
+  GstAdaptationSetNode *adaptationSet;
+  GstRepresentationNode *representation;
+  GstSegmentTemplateNode *segmentTemplate;
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-main:2011\">"
+      "  <Period>"
+      "    <AdaptationSet>"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"RepresentationMedia\""
+      "                         startNumber=\"1\">"
+      "          <SegmentTimeline>"
+      "            <S t=\"0\" d=\"2\" r=\"3\"/>"
+      "          </SegmentTimeline>"
+      "        </SegmentTemplate>"
+      "      </Representation>"
+      "      <SegmentTemplate index=\"AdaptationSetIndex\" duration=\"2\""
+      "                       startNumber=\"5\">"
+      "      </SegmentTemplate>"
+      "    </AdaptationSet>"
+      "    <SegmentTemplate media=\"PeriodMedia\" duration=\"1\""
+      "                     timescale=\"1000\""
+      "                     initialization=\"PeriodInitialization\">"
+      "    </SegmentTemplate></Period></MPD>";
+
+  gboolean ret;
+  GstMpdClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
+  adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
+  representation = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
+
+  segmentTemplate = adaptationSet->SegmentTemplate;
+  assert_equals_string (segmentTemplate->media, "PeriodMedia");
+  assert_equals_string (segmentTemplate->index, "AdaptationSetIndex");
+  assert_equals_string (segmentTemplate->initialization,
+      "PeriodInitialization");
+  assert_equals_uint64 (segmentTemplate->MultSegBaseType->duration, 2);
+  assert_equals_uint64 (segmentTemplate->MultSegBaseType->startNumber, 5);
+  assert_equals_uint64
+      (segmentTemplate->MultSegBaseType->SegBaseType->timescale, 1000);
+
+  segmentTemplate = representation->SegmentTemplate;
+  assert_equals_string (segmentTemplate->media, "RepresentationMedia");
+  assert_equals_string (segmentTemplate->index, "AdaptationSetIndex");
+  assert_equals_string (segmentTemplate->initialization,
+      "PeriodInitialization");
+  assert_equals_uint64 (segmentTemplate->MultSegBaseType->duration, 2);
+  /* present on the lower level with its default value */
+  assert_equals_uint64 (segmentTemplate->MultSegBaseType->startNumber, 1);
+  assert_equals_uint64
+      (segmentTemplate->MultSegBaseType->SegBaseType->timescale, 1000);
+  fail_unless (segmentTemplate->MultSegBaseType->SegmentTimeline != NULL);
+
+  gst_mpd_client_free (mpdclient);
+}
+
+GST_END_TEST;
+
 /*
  * Test parsing Period AdaptationSet Representation attributes
  *
@@ -2043,8 +2114,8 @@ GST_START_TEST (dash_mpdparser_period_adaptationSet_representation)
 
   periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
   adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
-  representation = (GstRepresentationNode *)
-      adaptationSet->Representations->data;
+  representation = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
   assert_equals_string (representation->id, "Test_Id");
   assert_equals_uint64 (representation->bandwidth, 100);
   assert_equals_uint64 (representation->qualityRanking, 200);
@@ -2086,8 +2157,8 @@ GST_START_TEST
 
   periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
   adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
-  representation = (GstRepresentationNode *)
-      adaptationSet->Representations->data;
+  representation = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
   representationBase = (GstRepresentationBaseType *)
       representation->RepresentationBase;
   fail_if (representationBase == NULL);
@@ -2126,8 +2197,8 @@ GST_START_TEST (dash_mpdparser_period_adaptationSet_representation_baseURL)
 
   periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
   adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
-  representation = (GstRepresentationNode *)
-      adaptationSet->Representations->data;
+  representation = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
   baseURL = (GstBaseURL *) representation->BaseURLs->data;
   assert_equals_string (baseURL->baseURL, "TestBaseURL");
   assert_equals_string (baseURL->serviceLocation, "TestServiceLocation");
@@ -2170,8 +2241,8 @@ GST_START_TEST
 
   periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
   adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
-  representation = (GstRepresentationNode *)
-      adaptationSet->Representations->data;
+  representation = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
   subRepresentation = (GstSubRepresentationNode *)
       representation->SubRepresentations->data;
   assert_equals_uint64 (subRepresentation->level, 100);
@@ -2220,8 +2291,8 @@ GST_START_TEST
 
   periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
   adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
-  representation = (GstRepresentationNode *)
-      adaptationSet->Representations->data;
+  representation = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
   subRepresentation = (GstSubRepresentationNode *)
       representation->SubRepresentations->data;
   representationBase = (GstRepresentationBaseType *)
@@ -2262,8 +2333,8 @@ GST_START_TEST (dash_mpdparser_period_adaptationSet_representation_segmentBase)
 
   periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
   adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
-  representation = (GstRepresentationNode *)
-      adaptationSet->Representations->data;
+  representation = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
   segmentBase = representation->SegmentBase;
   fail_if (segmentBase == NULL);
 
@@ -2301,8 +2372,8 @@ GST_START_TEST (dash_mpdparser_period_adaptationSet_representation_segmentList)
 
   periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
   adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
-  representation = (GstRepresentationNode *)
-      adaptationSet->Representations->data;
+  representation = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
   segmentList = representation->SegmentList;
   fail_if (segmentList == NULL);
 
@@ -2340,8 +2411,8 @@ GST_START_TEST
 
   periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
   adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
-  representation = (GstRepresentationNode *)
-      adaptationSet->Representations->data;
+  representation = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
   segmentTemplate = representation->SegmentTemplate;
   fail_if (segmentTemplate == NULL);
 
@@ -3114,7 +3185,7 @@ GST_START_TEST (dash_mpdparser_representation_selection)
 {
   GList *adaptationSets;
   GstAdaptationSetNode *adaptationSetNode;
-  GList *representations;
+  GArray *representations;
   gint represendationIndex;
 
   const gchar *xml =
@@ -3682,8 +3753,8 @@ GST_START_TEST (dash_mpdparser_get_baseURL5)
   gstBaseURL = g_list_nth_data (adaptationSet->BaseURLs, 3);
   assert_equals_string (gstBaseURL->baseURL, "adaptation_base_url4/");
 
-  representation = (GstRepresentationNode *)
-      adaptationSet->Representations->data;
+  representation = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
   assert_equals_int (g_list_length (representation->BaseURLs), 5);
   gstBaseURL = g_list_nth_data (representation->BaseURLs, 0);
   assert_equals_string (gstBaseURL->baseURL, "representation_base_url1/");
@@ -4218,8 +4289,8 @@ GST_START_TEST (dash_mpdparser_inherited_segmentBase)
 
   periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
   adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
-  representation = (GstRepresentationNode *)
-      adaptationSet->Representations->data;
+  representation = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
 
   /* test segment base from adaptation set */
   segmentBase = adaptationSet->SegmentBase;
@@ -4594,6 +4665,24 @@ GST_START_TEST (dash_mpdparser_segment_timeline)
   assert_equals_uint64 (fragment.timestamp, expectedTimestamp * GST_MSECOND);
   gst_media_fragment_info_clear (&fragment);
 
+  /* look at the following segments without advancing */
+  ret = gst_mpd_client_peek_fragment (mpdclient, 0, 1, &fragment);
+  assert_equals_int (ret, TRUE);
+  assert_equals_string (fragment.uri, "/TestMedia0");
+  assert_equals_uint64 (fragment.timestamp,
+      duration_to_ms (0, 0, 0, 0, 0, 5, 0) * GST_MSECOND);
+  gst_media_fragment_info_clear (&fragment);
+  ret = gst_mpd_client_peek_fragment (mpdclient, 0, 2, &fragment);
+  assert_equals_int (ret, TRUE);
+  assert_equals_string (fragment.uri, "/TestMedia1");
+  assert_equals_uint64 (fragment.timestamp,
+      duration_to_ms (0, 0, 0, 0, 0, 10, 0) * GST_MSECOND);
+  gst_media_fragment_info_clear (&fragment);
+  ret = gst_mpd_client_peek_fragment (mpdclient, 0, 3, &fragment);
+  assert_equals_int (ret, FALSE);
+  assert_equals_int (activeStream->segment_index, 0);
+  assert_equals_int (activeStream->segment_repeat_index, 0);
+
   /* advance to next segment */
   flow = gst_mpd_client_advance_segment (mpdclient, activeStream, TRUE);
   assert_equals_int (flow, GST_FLOW_OK);
@@ -4634,6 +4723,250 @@ GST_START_TEST (dash_mpdparser_segment_timeline)
 
 GST_END_TEST;
 
+/*
+ * Test seeking in a SegmentTimeline with repeated segments and gaps
+ *
+ */
+GST_START_TEST (dash_mpdparser_segment_timeline_seek)
+{
+  GList *adaptationSets;
+  GstAdaptationSetNode *adapt_set;
+  GstActiveStream *activeStream;
+  GstClockTime final_ts;
+
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-main:2011\""
+      "     availabilityStartTime=\"2015-03-24T0:0:0\""
+      "     mediaPresentationDuration=\"P0Y0M0DT0H0M30S\">"
+      "  <Period>"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"TestMedia$Number$\">"
+      "          <SegmentTimeline>"
+      "            <S t=\"0\" d=\"2\" r=\"2\"></S>"
+      "            <S d=\"3\"></S>"
+      "            <S t=\"12\" d=\"1\" r=\"3\"></S>"
+      "          </SegmentTimeline>"
+      "        </SegmentTemplate>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  gboolean ret;
+  GstMpdClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  /* process the xml data */
+  ret =
+      gst_mpd_client_setup_media_presentation (mpdclient, GST_CLOCK_TIME_NONE,
+      -1, NULL);
+  assert_equals_int (ret, TRUE);
+
+  adaptationSets = gst_mpd_client_get_adaptation_sets (mpdclient);
+  fail_if (adaptationSets == NULL);
+  adapt_set = (GstAdaptationSetNode *) g_list_nth_data (adaptationSets, 0);
+  fail_if (adapt_set == NULL);
+  ret = gst_mpd_client_setup_streaming (mpdclient, adapt_set);
+  assert_equals_int (ret, TRUE);
+
+  activeStream = gst_mpdparser_get_active_stream_by_index (mpdclient, 0);
+  fail_if (activeStream == NULL);
+
+  /* the timeline is kept as one entry per S node */
+  assert_equals_int (activeStream->segments->len, 3);
+
+  /* inside a repeated segment */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      5 * GST_SECOND, &final_ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 0);
+  assert_equals_int (activeStream->segment_repeat_index, 2);
+  assert_equals_uint64 (final_ts, 4 * GST_SECOND);
+
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      6 * GST_SECOND, &final_ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 1);
+  assert_equals_int (activeStream->segment_repeat_index, 0);
+  assert_equals_uint64 (final_ts, 6 * GST_SECOND);
+
+  /* in reverse mode, the end of a segment belongs to that segment */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, FALSE, 0,
+      6 * GST_SECOND, &final_ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 0);
+  assert_equals_int (activeStream->segment_repeat_index, 2);
+  assert_equals_uint64 (final_ts, 4 * GST_SECOND);
+
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      14 * GST_SECOND + 500 * GST_MSECOND, &final_ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (activeStream->segment_index, 2);
+  assert_equals_int (activeStream->segment_repeat_index, 2);
+  assert_equals_uint64 (final_ts, 14 * GST_SECOND);
+
+  /* in the gap between the second and the third S nodes */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      10 * GST_SECOND, &final_ts);
+  assert_equals_int (ret, FALSE);
+  assert_equals_int (activeStream->segment_index, 3);
+
+  /* after the last segment */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      20 * GST_SECOND, &final_ts);
+  assert_equals_int (ret, FALSE);
+  assert_equals_int (activeStream->segment_index, 3);
+
+  gst_mpd_client_free (mpdclient);
+}
+
+GST_END_TEST;
+
+/*
+ * Test updating the active streams from a refreshed live manifest
+ *
+ */
+GST_START_TEST (dash_mpdparser_update_active_streams)
+{
+  GList *adaptationSets;
+  GstAdaptationSetNode *adapt_set;
+  GstActiveStream *activeStream;
+  GstMediaSegment *segment;
+  GstMediaFragmentInfo fragment;
+  GstFlowReturn flow;
+  GstMpdClient *newclient;
+
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"dynamic\""
+      "     availabilityStartTime=\"2015-03-24T0:0:0\">"
+      "  <Period>"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"TestMedia$Number$\">"
+      "          <SegmentTimeline>"
+      "            <S t=\"0\" d=\"2\" r=\"1\"></S>"
+      "            <S d=\"3\"></S>"
+      "          </SegmentTimeline>"
+      "        </SegmentTemplate>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  /* the first two segments left the timeline and three were added */
+  const gchar *xml_update =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"dynamic\""
+      "     availabilityStartTime=\"2015-03-24T0:0:0\">"
+      "  <Period>"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"TestMedia$Number$\""
+      "                         startNumber=\"3\">"
+      "          <SegmentTimeline>"
+      "            <S t=\"4\" d=\"3\" r=\"2\"></S>"
+      "            <S d=\"1\"></S>"
+      "          </SegmentTimeline>"
+      "        </SegmentTemplate>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  /* the representation changed */
+  const gchar *xml_changed =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"dynamic\""
+      "     availabilityStartTime=\"2015-03-24T0:0:0\">"
+      "  <Period>"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"2\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"TestMedia$Number$\">"
+      "          <SegmentTimeline>"
+      "            <S t=\"0\" d=\"2\" r=\"1\"></S>"
+      "            <S d=\"3\" r=\"1\"></S>"
+      "          </SegmentTimeline>"
+      "        </SegmentTemplate>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  gboolean ret;
+  GstMpdClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+  ret =
+      gst_mpd_client_setup_media_presentation (mpdclient, GST_CLOCK_TIME_NONE,
+      -1, NULL);
+  assert_equals_int (ret, TRUE);
+  adaptationSets = gst_mpd_client_get_adaptation_sets (mpdclient);
+  adapt_set = (GstAdaptationSetNode *) g_list_nth_data (adaptationSets, 0);
+  fail_if (adapt_set == NULL);
+  ret = gst_mpd_client_setup_streaming (mpdclient, adapt_set);
+  assert_equals_int (ret, TRUE);
+  activeStream = gst_mpdparser_get_active_stream_by_index (mpdclient, 0);
+  fail_if (activeStream == NULL);
+
+  /* move to the third segment */
+  flow = gst_mpd_client_advance_segment (mpdclient, activeStream, TRUE);
+  assert_equals_int (flow, GST_FLOW_OK);
+  flow = gst_mpd_client_advance_segment (mpdclient, activeStream, TRUE);
+  assert_equals_int (flow, GST_FLOW_OK);
+  assert_equals_int (activeStream->segment_index, 1);
+
+  /* a manifest with a different structure can't be used to update */
+  newclient = gst_mpd_client_new ();
+  ret = gst_mpd_parse (newclient, xml_changed, (gint) strlen (xml_changed));
+  assert_equals_int (ret, TRUE);
+  ret = gst_mpd_client_setup_media_presentation (newclient, -1, 0, NULL);
+  assert_equals_int (ret, TRUE);
+  ret = gst_mpd_client_update_active_streams (newclient, mpdclient);
+  assert_equals_int (ret, FALSE);
+  assert_equals_int (gst_mpdparser_get_nb_active_stream (mpdclient), 1);
+  assert_equals_int (gst_mpdparser_get_nb_active_stream (newclient), 0);
+  gst_mpd_client_free (newclient);
+
+  newclient = gst_mpd_client_new ();
+  ret = gst_mpd_parse (newclient, xml_update, (gint) strlen (xml_update));
+  assert_equals_int (ret, TRUE);
+  ret = gst_mpd_client_setup_media_presentation (newclient, -1, 0, NULL);
+  assert_equals_int (ret, TRUE);
+  ret = gst_mpd_client_update_active_streams (newclient, mpdclient);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (gst_mpdparser_get_nb_active_stream (mpdclient), 0);
+  assert_equals_int (gst_mpdparser_get_nb_active_stream (newclient), 1);
+  fail_unless (gst_mpdparser_get_active_stream_by_index (newclient,
+          0) == activeStream);
+  gst_mpd_client_free (mpdclient);
+
+  /* the expired entry was dropped, the new 3s segments extended the last
+   * entry and the 1s segment was appended */
+  assert_equals_int (activeStream->segments->len, 2);
+  assert_equals_int (activeStream->segment_index, 0);
+  segment = &g_array_index (activeStream->segments, GstMediaSegment, 0);
+  assert_equals_int (segment->number, 3);
+  assert_equals_int (segment->repeat, 2);
+  assert_equals_uint64 (segment->start, 4 * GST_SECOND);
+  segment = &g_array_index (activeStream->segments, GstMediaSegment, 1);
+  assert_equals_int (segment->number, 6);
+  assert_equals_int (segment->repeat, 0);
+  assert_equals_uint64 (segment->start, 13 * GST_SECOND);
+
+  /* the stream kept its position */
+  ret = gst_mpd_client_get_next_fragment (newclient, 0, &fragment);
+  assert_equals_int (ret, TRUE);
+  assert_equals_string (fragment.uri, "/TestMedia3");
+  assert_equals_uint64 (fragment.timestamp, 4 * GST_SECOND);
+  assert_equals_uint64 (fragment.duration, 3 * GST_SECOND);
+  gst_media_fragment_info_clear (&fragment);
+
+  gst_mpd_client_free (newclient);
+}
+
+GST_END_TEST;
+
 /*
  * Test SegmentList with multiple inherited segmentURLs
  *
@@ -4766,6 +5099,217 @@ GST_START_TEST (dash_mpdparser_multiple_inherited_segmentURL)
 
 GST_END_TEST;
 
+/*
+ * Test that elements the parser does not know about are skipped together
+ * with their whole subtree, including nested MPD elements, and that
+ * comments do not break the order of the parsed elements
+ *
+ */
+GST_START_TEST (dash_mpdparser_unknown_elements)
+{
+  GstPeriodNode *periodNode;
+  GstAdaptationSetNode *adaptationSet;
+  GstRepresentationNode *representation;
+  GstSegmentURLNode *segmentURL;
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-on-demand:2011\">"
+      "  <!-- <Period id=\"Comment\"/> -->"
+      "  <Unknown><Period id=\"Hidden\"><AdaptationSet/></Period></Unknown>"
+      "  <Period id=\"TestId\">"
+      "    <AdaptationSet>"
+      "      <Unknown><Representation id=\"Hidden\"/></Unknown>"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentList duration=\"1\">"
+      "          <SegmentURL media=\"TestMedia0\"/>"
+      "          <!-- comment -->"
+      "          <Unknown><SegmentURL media=\"Hidden\"/></Unknown>"
+      "          <SegmentURL media=\"TestMedia1\"></SegmentURL>"
+      "          <SegmentURL media=\"TestMedia2\"/>"
+      "        </SegmentList>"
+      "      </Representation></AdaptationSet></Period>"
+      "  <Unknown/></MPD>";
+
+  gboolean ret;
+  GstMpdClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  assert_equals_int (g_list_length (mpdclient->mpd_node->Periods), 1);
+  periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
+  assert_equals_string (periodNode->id, "TestId");
+
+  assert_equals_int (g_list_length (periodNode->AdaptationSets), 1);
+  adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
+  assert_equals_int (adaptationSet->Representations->len, 1);
+  representation = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
+  assert_equals_string (representation->id, "1");
+
+  assert_equals_int (representation->SegmentList->SegmentURL->len, 3);
+  segmentURL = &g_array_index (representation->SegmentList->SegmentURL,
+      GstSegmentURLNode, 0);
+  assert_equals_string (segmentURL->media, "TestMedia0");
+  segmentURL = &g_array_index (representation->SegmentList->SegmentURL,
+      GstSegmentURLNode, 1);
+  assert_equals_string (segmentURL->media, "TestMedia1");
+  segmentURL = &g_array_index (representation->SegmentList->SegmentURL,
+      GstSegmentURLNode, 2);
+  assert_equals_string (segmentURL->media, "TestMedia2");
+
+  gst_mpd_client_free (mpdclient);
+}
+
+GST_END_TEST;
+
+/*
+ * Test parsing a large MPD: many Representations sharing their attribute
+ * values, long SegmentTimelines and long SegmentLists. The repeated
+ * children are stored in arrays and the repeated strings are interned,
+ * so every Representation points at the same codecs, mimeType and
+ * template strings.
+ *
+ * Set GST_ADAPTIVE_DEMUX_BENCHMARK to print the parse time next to a
+ * plain libxml2 DOM read of the same document.
+ *
+ */
+#define LARGE_MPD_N_REPRESENTATIONS 40
+#define LARGE_MPD_N_SEGMENTS 500
+
+GST_START_TEST (dash_mpdparser_large_mpd)
+{
+  GstPeriodNode *periodNode;
+  GstAdaptationSetNode *adaptationSet;
+  GstRepresentationNode *first, *representation;
+  GstSegmentTimelineNode *segmentTimeline;
+  GstSegmentURLNode *segmentURL;
+  GstSNode *sNode;
+  GString *xml;
+  gchar *media;
+  gint64 start, parse_time, dom_time;
+  gboolean ret;
+  guint i, j;
+  GstMpdClient *mpdclient;
+
+  xml = g_string_new ("<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-on-demand:2011\">"
+      "  <Period id=\"TestId\">"
+      "    <AdaptationSet mimeType=\"video/mp4\">");
+  for (i = 0; i < LARGE_MPD_N_REPRESENTATIONS; i++) {
+    g_string_append_printf (xml,
+        "<Representation id=\"v%u\" bandwidth=\"%u\" mimeType=\"video/mp4\""
+        "    codecs=\"avc1.64001f\">"
+        "  <SegmentTemplate timescale=\"1000\""
+        "      media=\"$RepresentationID$/$Number$.m4s\""
+        "      initialization=\"$RepresentationID$/init.mp4\">"
+        "    <SegmentTimeline>", i, 100000 * (i + 1));
+    for (j = 0; j < LARGE_MPD_N_SEGMENTS; j++)
+      g_string_append_printf (xml, "<S t=\"%u\" d=\"2000\"/>", 2000 * j);
+    g_string_append (xml, "</SegmentTimeline></SegmentTemplate>"
+        "</Representation>");
+  }
+  g_string_append (xml, "</AdaptationSet>"
+      "    <AdaptationSet mimeType=\"audio/mp4\">");
+  for (i = 0; i < LARGE_MPD_N_REPRESENTATIONS; i++) {
+    g_string_append_printf (xml,
+        "<Representation id=\"a%u\" bandwidth=\"%u\" codecs=\"mp4a.40.2\">"
+        "  <SegmentList duration=\"2\">", i, 64000 + i);
+    for (j = 0; j < LARGE_MPD_N_SEGMENTS; j++)
+      g_string_append_printf (xml, "<SegmentURL media=\"a%u/%u.m4s\"/>", i,
+          j);
+    g_string_append (xml, "</SegmentList></Representation>");
+  }
+  g_string_append (xml, "</AdaptationSet></Period></MPD>");
+
+  mpdclient = gst_mpd_client_new ();
+  start = g_get_monotonic_time ();
+  ret = gst_mpd_parse (mpdclient, xml->str, (gint) xml->len);
+  parse_time = g_get_monotonic_time () - start;
+  assert_equals_int (ret, TRUE);
+
+  if (g_getenv ("GST_ADAPTIVE_DEMUX_BENCHMARK")) {
+    xmlDocPtr doc;
+
+    start = g_get_monotonic_time ();
+    doc = xmlReadMemory (xml->str, (gint) xml->len, "noname.xml", NULL,
+        XML_PARSE_NONET);
+    dom_time = g_get_monotonic_time () - start;
+    fail_unless (doc != NULL);
+    xmlFreeDoc (doc);
+
+    g_print ("large MPD (%" G_GSIZE_FORMAT " bytes, %u Representations, "
+        "%u segments each): parsed in %" G_GINT64_FORMAT " us, "
+        "DOM read alone %" G_GINT64_FORMAT " us\n", xml->len,
+        2 * LARGE_MPD_N_REPRESENTATIONS, LARGE_MPD_N_SEGMENTS, parse_time,
+        dom_time);
+  }
+
+  assert_equals_int (g_list_length (mpdclient->mpd_node->Periods), 1);
+  periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
+  assert_equals_int (g_list_length (periodNode->AdaptationSets), 2);
+
+  /* video: one SegmentTimeline of S nodes per Representation */
+  adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
+  assert_equals_int (adaptationSet->Representations->len,
+      LARGE_MPD_N_REPRESENTATIONS);
+  first = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
+  for (i = 0; i < LARGE_MPD_N_REPRESENTATIONS; i++) {
+    representation = &g_array_index (adaptationSet->Representations,
+        GstRepresentationNode, i);
+    assert_equals_int (representation->bandwidth, 100000 * (i + 1));
+    assert_equals_string (representation->RepresentationBase->codecs,
+        "avc1.64001f");
+    fail_unless (representation->RepresentationBase->codecs ==
+        first->RepresentationBase->codecs);
+    fail_unless (representation->RepresentationBase->mimeType ==
+        adaptationSet->RepresentationBase->mimeType);
+    fail_unless (representation->SegmentTemplate->media ==
+        first->SegmentTemplate->media);
+    fail_unless (representation->SegmentTemplate->initialization ==
+        first->SegmentTemplate->initialization);
+
+    segmentTimeline =
+        representation->SegmentTemplate->MultSegBaseType->SegmentTimeline;
+    assert_equals_int (segmentTimeline->S->len, LARGE_MPD_N_SEGMENTS);
+    sNode = &g_array_index (segmentTimeline->S, GstSNode,
+        LARGE_MPD_N_SEGMENTS - 1);
+    assert_equals_uint64 (sNode->t, 2000 * (LARGE_MPD_N_SEGMENTS - 1));
+    assert_equals_uint64 (sNode->d, 2000);
+  }
+  assert_equals_string (first->SegmentTemplate->media,
+      "$RepresentationID$/$Number$.m4s");
+
+  /* audio: one SegmentList of SegmentURLs per Representation */
+  adaptationSet =
+      (GstAdaptationSetNode *) periodNode->AdaptationSets->next->data;
+  assert_equals_int (adaptationSet->Representations->len,
+      LARGE_MPD_N_REPRESENTATIONS);
+  first = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
+  for (i = 0; i < LARGE_MPD_N_REPRESENTATIONS; i++) {
+    representation = &g_array_index (adaptationSet->Representations,
+        GstRepresentationNode, i);
+    fail_unless (representation->RepresentationBase->codecs ==
+        first->RepresentationBase->codecs);
+    assert_equals_int (representation->SegmentList->SegmentURL->len,
+        LARGE_MPD_N_SEGMENTS);
+    segmentURL = &g_array_index (representation->SegmentList->SegmentURL,
+        GstSegmentURLNode, LARGE_MPD_N_SEGMENTS - 1);
+    media = g_strdup_printf ("a%u/%u.m4s", i, LARGE_MPD_N_SEGMENTS - 1);
+    assert_equals_string (segmentURL->media, media);
+    g_free (media);
+  }
+
+  gst_mpd_client_free (mpdclient);
+  g_string_free (xml, TRUE);
+}
+
+GST_END_TEST;
+
 /*
  * Test parsing empty xml string
  *
@@ -5045,8 +5589,8 @@ GST_START_TEST (dash_mpdparser_read_unsigned_from_negative_values)
   periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
   segmentBase = periodNode->SegmentBase;
   adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
-  representation = (GstRepresentationNode *)
-      adaptationSet->Representations->data;
+  representation = &g_array_index (adaptationSet->Representations,
+      GstRepresentationNode, 0);
   subRepresentation = (GstSubRepresentationNode *)
       representation->SubRepresentations->data;
 
@@ -5390,6 +5934,8 @@ dash_suite (void)
       dash_mpdparser_period_adaptationSet_segmentTemplate);
   tcase_add_test (tc_simpleMPD,
       dash_mpdparser_period_adaptationSet_segmentTemplate_inherit);
+  tcase_add_test (tc_simpleMPD,
+      dash_mpdparser_segmentTemplate_inherit_document_order);
   tcase_add_test (tc_simpleMPD,
       dash_mpdparser_period_adaptationSet_representation);
   tcase_add_test (tc_simpleMPD,
@@ -5449,7 +5995,11 @@ dash_suite (void)
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_list);
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_template);
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_timeline);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_segment_timeline_seek);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_update_active_streams);
   tcase_add_test (tc_complexMPD, dash_mpdparser_multiple_inherited_segmentURL);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_unknown_elements);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_large_mpd);
 
   /* tests checking the parsing of missing/incomplete attributes of xml */
   tcase_add_test (tc_negativeTests, dash_mpdparser_missing_xml);
@@ -393,6 +393,605 @@ GST_START_TEST (testSeek)
 
 GST_END_TEST;
 
+typedef struct _GstHlsDemuxTestPrefetch
+{
+  GstHlsDemuxTestCase test_case;
+  GMutex lock;
+  GCond cond;
+  /* number of downloads of each fragment started by the stream source, and
+   * completed by the prefetch downloader */
+  guint downloads[4];
+  guint prefetches[4];
+} GstHlsDemuxTestPrefetch;
+
+static gint
+gst_hlsdemux_test_prefetch_fragment (const gchar * uri)
+{
+  guint n;
+
+  if (sscanf (uri, "http://unit.test/%03u.ts", &n) == 1 && n >= 1 && n <= 4)
+    return n - 1;
+  return -1;
+}
+
+static gboolean
+gst_hlsdemux_test_prefetch_src_start (GstTestHTTPSrc * src,
+    const gchar * uri, GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  GstHlsDemuxTestPrefetch *prefetch = user_data;
+  gboolean ret;
+
+  /* the prefetch downloader requests concurrently with the stream */
+  g_mutex_lock (&prefetch->lock);
+  ret = gst_hlsdemux_test_src_start (src, uri, input_data,
+      &prefetch->test_case);
+  g_mutex_unlock (&prefetch->lock);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_hlsdemux_test_prefetch_src_create (GstTestHTTPSrc * src,
+    guint64 offset,
+    guint length, GstBuffer ** retbuf, gpointer context, gpointer user_data)
+{
+  GstHlsDemuxTestPrefetch *prefetch = user_data;
+  GstHlsDemuxTestInputData *input = (GstHlsDemuxTestInputData *) context;
+  gint fragment = gst_hlsdemux_test_prefetch_fragment (input->uri);
+  /* the sources of the downloaders are not in a bin */
+  gboolean prefetching = GST_OBJECT_PARENT (src) == NULL;
+
+  g_mutex_lock (&prefetch->lock);
+  if (fragment >= 0 && prefetching && offset + length >= input->size) {
+    prefetch->prefetches[fragment]++;
+    g_cond_broadcast (&prefetch->cond);
+  } else if (fragment >= 0 && !prefetching && offset == 0) {
+    prefetch->downloads[fragment]++;
+  }
+
+  if (fragment == 0 && !prefetching && offset == 0) {
+    guint run = prefetch->downloads[0];
+    gint64 end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+
+    /* hold the first fragment until the next prefetch-depth fragments were
+     * downloaded ahead, before and after the seek */
+    while (prefetch->prefetches[1] < run || prefetch->prefetches[2] < run) {
+      if (!g_cond_wait_until (&prefetch->cond, &prefetch->lock, end_time))
+        break;
+    }
+    fail_unless (prefetch->prefetches[1] == run);
+    fail_unless (prefetch->prefetches[2] == run);
+    /* not more than prefetch-depth fragments ahead of the current one */
+    fail_unless (prefetch->prefetches[3] == 0);
+  }
+  g_mutex_unlock (&prefetch->lock);
+
+  return gst_hlsdemux_test_src_create (src, offset, length, retbuf, context,
+      &prefetch->test_case);
+}
+
+/*
+ * Test downloading fragments ahead with prefetch-depth. The seek in the
+ * first fragment must drop the prefetched fragments, which are downloaded
+ * again after the seek
+ *
+ */
+GST_START_TEST (testPrefetch)
+{
+  const guint segment_size = 30 * TS_PACKET_LEN;
+  const gchar *manifest =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXTINF:1,Test\n" "001.ts\n"
+      "#EXTINF:1,Test\n" "002.ts\n"
+      "#EXTINF:1,Test\n" "003.ts\n"
+      "#EXTINF:1,Test\n" "004.ts\n" "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/media.m3u8", (guint8 *) manifest, 0},
+    {"http://unit.test/001.ts", NULL, segment_size},
+    {"http://unit.test/002.ts", NULL, segment_size},
+    {"http://unit.test/003.ts", NULL, segment_size},
+    {"http://unit.test/004.ts", NULL, segment_size},
+    {NULL, NULL, 0},
+  };
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"src_0", 4 * segment_size, NULL},
+    {NULL, 0, NULL}
+  };
+  GstTestHTTPSrcCallbacks http_src_callbacks = { 0 };
+  GstAdaptiveDemuxTestCase *engineTestData;
+  GstHlsDemuxTestPrefetch prefetch = { {0} };
+  GByteArray *mpeg_ts = NULL;
+
+  engineTestData = gst_adaptive_demux_test_case_new ();
+  mpeg_ts = setup_test_variables (inputTestData, outputTestData,
+      &prefetch.test_case, engineTestData, segment_size);
+  g_mutex_init (&prefetch.lock);
+  g_cond_init (&prefetch.cond);
+
+  http_src_callbacks.src_start = gst_hlsdemux_test_prefetch_src_start;
+  http_src_callbacks.src_create = gst_hlsdemux_test_prefetch_src_create;
+  engineTestData->demux_properties = gst_structure_new ("properties",
+      "prefetch-depth", G_TYPE_UINT, 2, NULL);
+  engineTestData->threshold_for_seek = 10 * TS_PACKET_LEN;
+  engineTestData->seek_event =
+      gst_event_new_seek (1.0, GST_FORMAT_TIME,
+      GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT, GST_SEEK_TYPE_SET,
+      0, GST_SEEK_TYPE_NONE, 0);
+
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &prefetch);
+  gst_adaptive_demux_test_seek (DEMUX_ELEMENT_NAME,
+      inputTestData[0].uri, engineTestData);
+
+  /* the first fragment is downloaded by the stream before and after the
+   * seek, the two following ones are always taken from the prefetched
+   * ones */
+  assert_equals_int (prefetch.downloads[0], 2);
+  assert_equals_int (prefetch.prefetches[0], 0);
+  assert_equals_int (prefetch.downloads[1], 0);
+  assert_equals_int (prefetch.prefetches[1], 2);
+  assert_equals_int (prefetch.downloads[2], 0);
+  assert_equals_int (prefetch.prefetches[2], 2);
+  assert_equals_int (prefetch.downloads[3] + prefetch.prefetches[3], 1);
+
+  g_cond_clear (&prefetch.cond);
+  g_mutex_clear (&prefetch.lock);
+  g_byte_array_free (mpeg_ts, TRUE);
+  gst_structure_free (prefetch.test_case.state);
+  g_object_unref (engineTestData);
+}
+
+GST_END_TEST;
+
+typedef struct _GstHlsDemuxTestKeys
+{
+  GstHlsDemuxTestCase test_case;
+  GMutex lock;
+  GCond cond;
+  /* number of requests of key1.bin and key2.bin */
+  guint key_requests[2];
+  /* hold the first fragment until the key of the second one was
+   * requested by the prefetch downloader */
+  gboolean wait_for_key;
+} GstHlsDemuxTestKeys;
+
+static gboolean
+gst_hlsdemux_test_keys_src_start (GstTestHTTPSrc * src,
+    const gchar * uri, GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  GstHlsDemuxTestKeys *keys = user_data;
+  gboolean ret;
+
+  g_mutex_lock (&keys->lock);
+  if (strcmp (uri, "http://unit.test/key1.bin") == 0)
+    keys->key_requests[0]++;
+  else if (strcmp (uri, "http://unit.test/key2.bin") == 0)
+    keys->key_requests[1]++;
+  g_cond_broadcast (&keys->cond);
+  ret = gst_hlsdemux_test_src_start (src, uri, input_data, &keys->test_case);
+  g_mutex_unlock (&keys->lock);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_hlsdemux_test_keys_src_create (GstTestHTTPSrc * src,
+    guint64 offset,
+    guint length, GstBuffer ** retbuf, gpointer context, gpointer user_data)
+{
+  GstHlsDemuxTestKeys *keys = user_data;
+  GstHlsDemuxTestInputData *input = (GstHlsDemuxTestInputData *) context;
+
+  if (keys->wait_for_key && offset == 0
+      && strcmp (input->uri, "http://unit.test/001.ts") == 0) {
+    gint64 end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+
+    g_mutex_lock (&keys->lock);
+    while (keys->key_requests[0] == 0) {
+      if (!g_cond_wait_until (&keys->cond, &keys->lock, end_time))
+        break;
+    }
+    fail_unless (keys->key_requests[0] == 1);
+    g_mutex_unlock (&keys->lock);
+  }
+
+  return gst_hlsdemux_test_src_create (src, offset, length, retbuf, context,
+      &keys->test_case);
+}
+
+static void
+testDecryptionPreTestCallback (GstAdaptiveDemuxTestEngine * engine,
+    gpointer user_data)
+{
+  GstAdaptiveDemuxTestCase *testData = GST_ADAPTIVE_DEMUX_TEST_CASE (user_data);
+  guint prefetch_depth;
+
+  if (gst_structure_get_uint (testData->demux_properties, "prefetch-depth",
+          &prefetch_depth))
+    g_object_set (engine->demux, "prefetch-depth", prefetch_depth, NULL);
+}
+
+/*
+ * The first fragment is in the clear, so that it can be typefound. The
+ * next ones are the following 20 bytes of the stream each, encrypted with
+ * the first key twice and then with the second key. Their padding fills a
+ * second AES block, which is held back until the end of the fragment
+ */
+static void
+run_decryption_test (guint prefetch_depth)
+{
+  const guint clear_size = 16 * TS_PACKET_LEN;
+  static const guint8 key1[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+  };
+  static const guint8 key2[16] = {
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+    0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f
+  };
+  static const guint8 fragment2[32] = {
+    0x5e, 0x3b, 0xf3, 0xd9, 0xa6, 0x41, 0xa8, 0xa7,
+    0xee, 0x47, 0xa1, 0x5f, 0x60, 0x2f, 0x99, 0xc6,
+    0x3f, 0x3f, 0xe0, 0x26, 0x14, 0x3f, 0xf6, 0x20,
+    0xb4, 0xf2, 0xd9, 0x34, 0xa3, 0xff, 0x8e, 0xd8
+  };
+  static const guint8 fragment3[32] = {
+    0xb3, 0x84, 0xec, 0xa4, 0xb3, 0x99, 0x15, 0xa7,
+    0x23, 0xf5, 0x82, 0xe9, 0x20, 0x85, 0x44, 0x59,
+    0xdd, 0x03, 0xbc, 0x25, 0x78, 0xeb, 0x16, 0x5b,
+    0xbc, 0x2f, 0x0c, 0xf0, 0x4d, 0x65, 0xab, 0xbc
+  };
+  static const guint8 fragment4[32] = {
+    0x14, 0xb3, 0xd4, 0x34, 0xfb, 0xcf, 0xc3, 0x73,
+    0x2e, 0x00, 0x86, 0x0d, 0xe5, 0x31, 0x80, 0x20,
+    0x06, 0xf5, 0x48, 0x6c, 0xa3, 0xb6, 0x65, 0x1c,
+    0x18, 0x01, 0x64, 0xd4, 0x96, 0xa7, 0xfd, 0x7d
+  };
+  const gchar *manifest =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXTINF:1,Test\n" "001.ts\n"
+      "#EXT-X-KEY:METHOD=AES-128,URI=\"key1.bin\","
+      "IV=0x000102030405060708090a0b0c0d0e0f\n"
+      "#EXTINF:1,Test\n" "002.ts\n"
+      "#EXTINF:1,Test\n" "003.ts\n"
+      "#EXT-X-KEY:METHOD=AES-128,URI=\"key2.bin\","
+      "IV=0x0f0e0d0c0b0a09080706050403020100\n"
+      "#EXTINF:1,Test\n" "004.ts\n" "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/media.m3u8", (guint8 *) manifest, 0},
+    {"http://unit.test/key1.bin", key1, sizeof (key1)},
+    {"http://unit.test/key2.bin", key2, sizeof (key2)},
+    {"http://unit.test/001.ts", NULL, clear_size},
+    {"http://unit.test/002.ts", NULL, sizeof (fragment2)},
+    {"http://unit.test/003.ts", NULL, sizeof (fragment3)},
+    {"http://unit.test/004.ts", NULL, sizeof (fragment4)},
+    {NULL, NULL, 0},
+  };
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"src_0", clear_size + 3 * 20, NULL},
+    {NULL, 0, NULL}
+  };
+  GstTestHTTPSrcCallbacks http_src_callbacks = { 0 };
+  GstAdaptiveDemuxTestCallbacks engine_callbacks = { 0 };
+  GstAdaptiveDemuxTestCase *engineTestData;
+  GstHlsDemuxTestKeys keys = { {0} };
+  GByteArray *mpeg_ts = NULL;
+
+  engineTestData = gst_adaptive_demux_test_case_new ();
+  /* the stream continues with the decrypted data in the next packet */
+  mpeg_ts = setup_test_variables (inputTestData, outputTestData,
+      &keys.test_case, engineTestData, clear_size + TS_PACKET_LEN);
+  inputTestData[4].payload = fragment2;
+  inputTestData[5].payload = fragment3;
+  inputTestData[6].payload = fragment4;
+  g_mutex_init (&keys.lock);
+  g_cond_init (&keys.cond);
+  keys.wait_for_key = prefetch_depth > 0;
+
+  http_src_callbacks.src_start = gst_hlsdemux_test_keys_src_start;
+  http_src_callbacks.src_create = gst_hlsdemux_test_keys_src_create;
+  engine_callbacks.pre_test = testDecryptionPreTestCallback;
+  engine_callbacks.appsink_received_data =
+      gst_adaptive_demux_test_check_received_data;
+  engine_callbacks.appsink_eos =
+      gst_adaptive_demux_test_check_size_of_received_data;
+  engineTestData->demux_properties = gst_structure_new ("properties",
+      "prefetch-depth", G_TYPE_UINT, prefetch_depth, NULL);
+
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &keys);
+  gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME,
+      inputTestData[0].uri, &engine_callbacks, engineTestData);
+
+  /* the third fragment uses the cached first key */
+  assert_equals_int (keys.key_requests[0], 1);
+  assert_equals_int (keys.key_requests[1], 1);
+
+  g_cond_clear (&keys.cond);
+  g_mutex_clear (&keys.lock);
+  g_byte_array_free (mpeg_ts, TRUE);
+  gst_structure_free (keys.test_case.state);
+  g_object_unref (engineTestData);
+}
+
+/*
+ * Test AES-128 decryption, key rotation and the cache of the keys
+ *
+ */
+GST_START_TEST (testDecryption)
+{
+  run_decryption_test (0);
+}
+
+GST_END_TEST;
+
+/*
+ * Test that the keys are downloaded ahead by the prefetch task, while the
+ * previous fragment is downloading
+ *
+ */
+GST_START_TEST (testDecryptionPrefetchKeys)
+{
+  run_decryption_test (2);
+}
+
+GST_END_TEST;
+
+#define STATISTICS_MESSAGE_NAME "adaptive-streaming-statistics"
+
+typedef struct _GstHlsDemuxTestStatistics
+{
+  /* demux properties */
+  guint prefetch_depth;
+  guint history_size;
+  gboolean post_statistics;
+
+  GMutex lock;
+  /* structures of the fragment statistics messages, in posting order */
+  GPtrArray *messages;
+  /* the statistics property when the stream ended, then after shrinking
+   * the history to a single fragment and growing it again */
+  GstStructure *history;
+  GstStructure *shrunk_history;
+  GstStructure *grown_history;
+  guint grown_size;
+  /* the statistics property after the pipeline stopped */
+  GstStructure *stopped_history;
+} GstHlsDemuxTestStatistics;
+
+static void
+gst_hlsdemux_test_statistics_message (GstBus * bus, GstMessage * msg,
+    gpointer user_data)
+{
+  GstHlsDemuxTestStatistics *statistics = user_data;
+  const GstStructure *s = gst_message_get_structure (msg);
+
+  /* the manifest download is reported with the same name */
+  if (!gst_structure_has_name (s, STATISTICS_MESSAGE_NAME) ||
+      !gst_structure_has_field (s, "fragment-size"))
+    return;
+
+  g_mutex_lock (&statistics->lock);
+  g_ptr_array_add (statistics->messages, gst_structure_copy (s));
+  g_mutex_unlock (&statistics->lock);
+}
+
+static void
+testStatisticsPreTestCallback (GstAdaptiveDemuxTestEngine * engine,
+    gpointer user_data)
+{
+  GstAdaptiveDemuxTestCase *testData = GST_ADAPTIVE_DEMUX_TEST_CASE (user_data);
+  GstHlsDemuxTestStatistics *statistics = testData->signal_context;
+  GstBus *bus = gst_pipeline_get_bus (GST_PIPELINE (engine->pipeline));
+
+  g_object_set (engine->demux, "prefetch-depth", statistics->prefetch_depth,
+      "statistics-history", statistics->history_size, "post-statistics",
+      statistics->post_statistics, NULL);
+
+  gst_bus_enable_sync_message_emission (bus);
+  g_signal_connect (bus, "sync-message::element",
+      G_CALLBACK (gst_hlsdemux_test_statistics_message), statistics);
+  gst_object_unref (bus);
+}
+
+static void
+testStatisticsEosCallback (GstAdaptiveDemuxTestEngine * engine,
+    GstAdaptiveDemuxTestOutputStream * stream, gpointer user_data)
+{
+  GstAdaptiveDemuxTestCase *testData = GST_ADAPTIVE_DEMUX_TEST_CASE (user_data);
+  GstHlsDemuxTestStatistics *statistics = testData->signal_context;
+
+  g_object_get (engine->demux, "statistics", &statistics->history, NULL);
+  g_object_set (engine->demux, "statistics-history", 1, NULL);
+  g_object_get (engine->demux, "statistics", &statistics->shrunk_history,
+      NULL);
+  g_object_set (engine->demux, "statistics-history", 4, NULL);
+  g_object_get (engine->demux, "statistics", &statistics->grown_history,
+      "statistics-history", &statistics->grown_size, NULL);
+
+  gst_adaptive_demux_test_check_size_of_received_data (engine, stream,
+      user_data);
+}
+
+static void
+testStatisticsPostTestCallback (GstAdaptiveDemuxTestEngine * engine,
+    gpointer user_data)
+{
+  GstAdaptiveDemuxTestCase *testData = GST_ADAPTIVE_DEMUX_TEST_CASE (user_data);
+  GstHlsDemuxTestStatistics *statistics = testData->signal_context;
+  GstBus *bus = gst_pipeline_get_bus (GST_PIPELINE (engine->pipeline));
+
+  g_signal_handlers_disconnect_by_func (bus,
+      G_CALLBACK (gst_hlsdemux_test_statistics_message), statistics);
+  gst_bus_disable_sync_message_emission (bus);
+  gst_object_unref (bus);
+
+  g_object_get (engine->demux, "statistics", &statistics->stopped_history,
+      NULL);
+}
+
+static void
+check_fragment_statistics (const GstStructure * s, guint fragment,
+    guint size, gboolean prefetched)
+{
+  gchar *uri = g_strdup_printf ("http://unit.test/%03u.ts", fragment);
+  GstClockTime latency, download_time;
+  guint64 fragment_size;
+
+  fail_unless (gst_structure_has_name (s, STATISTICS_MESSAGE_NAME));
+  assert_equals_string (gst_structure_get_string (s, "uri"), uri);
+  assert_equals_string (gst_structure_get_string (s, "stream"), "src_0");
+  fail_unless (gst_structure_get_uint64 (s, "fragment-size", &fragment_size));
+  assert_equals_uint64 (fragment_size, size);
+  fail_unless (gst_structure_get_clock_time (s, "fragment-download-time",
+          &download_time));
+  fail_unless (GST_CLOCK_TIME_IS_VALID (download_time));
+
+  /* the request of a prefetched fragment isn't timed by the stream */
+  fail_unless (gst_structure_get_clock_time (s, "fragment-request-latency",
+          &latency));
+  fail_unless_equals_int (GST_CLOCK_TIME_IS_VALID (latency), !prefetched);
+
+  g_free (uri);
+}
+
+/* Checks that the "fragments" of @history are the statistics of the
+ * fragments @first to @first + @n - 1, oldest first */
+static void
+check_statistics_history (const GstStructure * history, guint first,
+    guint n, guint size, guint prefetched_from)
+{
+  const GValue *fragments;
+  guint i;
+
+  fail_unless (history != NULL);
+  fragments = gst_structure_get_value (history, "fragments");
+  fail_unless (fragments != NULL);
+  fail_unless_equals_int (gst_value_array_get_size (fragments), n);
+  for (i = 0; i < n; i++) {
+    const GValue *v = gst_value_array_get_value (fragments, i);
+
+    check_fragment_statistics (gst_value_get_structure (v), first + i, size,
+        first + i >= prefetched_from);
+  }
+}
+
+static void
+run_statistics_test (GstHlsDemuxTestStatistics * statistics)
+{
+  const guint segment_size = 30 * TS_PACKET_LEN;
+  const gchar *manifest =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXTINF:1,Test\n" "001.ts\n"
+      "#EXTINF:1,Test\n" "002.ts\n"
+      "#EXTINF:1,Test\n" "003.ts\n" "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/media.m3u8", (guint8 *) manifest, 0},
+    {"http://unit.test/001.ts", NULL, segment_size},
+    {"http://unit.test/002.ts", NULL, segment_size},
+    {"http://unit.test/003.ts", NULL, segment_size},
+    {NULL, NULL, 0},
+  };
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"src_0", 3 * segment_size, NULL},
+    {NULL, 0, NULL}
+  };
+  GstTestHTTPSrcCallbacks http_src_callbacks = { 0 };
+  GstAdaptiveDemuxTestCallbacks engine_callbacks = { 0 };
+  GstAdaptiveDemuxTestCase *engineTestData;
+  GstHlsDemuxTestCase hlsTestCase = { 0 };
+  GByteArray *mpeg_ts = NULL;
+  guint prefetched_from;
+  guint i, n;
+
+  engineTestData = gst_adaptive_demux_test_case_new ();
+  mpeg_ts = setup_test_variables (inputTestData, outputTestData,
+      &hlsTestCase, engineTestData, segment_size);
+  g_mutex_init (&statistics->lock);
+  statistics->messages =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) gst_structure_free);
+  engineTestData->signal_context = statistics;
+
+  http_src_callbacks.src_start = gst_hlsdemux_test_src_start;
+  http_src_callbacks.src_create = gst_hlsdemux_test_src_create;
+  engine_callbacks.pre_test = testStatisticsPreTestCallback;
+  engine_callbacks.appsink_eos = testStatisticsEosCallback;
+  engine_callbacks.post_test = testStatisticsPostTestCallback;
+
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &hlsTestCase);
+  gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME,
+      inputTestData[0].uri, &engine_callbacks, engineTestData);
+
+  /* the fragments after the first one are downloaded ahead */
+  prefetched_from = statistics->prefetch_depth > 0 ? 2 : G_MAXUINT;
+
+  if (statistics->post_statistics) {
+    fail_unless_equals_int (statistics->messages->len, 3);
+    for (i = 0; i < 3; i++)
+      check_fragment_statistics (g_ptr_array_index (statistics->messages, i),
+          i + 1, segment_size, i + 1 >= prefetched_from);
+  } else {
+    fail_unless_equals_int (statistics->messages->len, 0);
+  }
+
+  /* the ring keeps the newest fragments, also when resized */
+  n = MIN (statistics->history_size, 3);
+  check_statistics_history (statistics->history, 4 - n, n, segment_size,
+      prefetched_from);
+  check_statistics_history (statistics->shrunk_history, 3, 1, segment_size,
+      prefetched_from);
+  check_statistics_history (statistics->grown_history, 3, 1, segment_size,
+      prefetched_from);
+  fail_unless_equals_int (statistics->grown_size, 4);
+  check_statistics_history (statistics->stopped_history, 1, 0, segment_size,
+      prefetched_from);
+
+  gst_structure_free (statistics->stopped_history);
+  gst_structure_free (statistics->grown_history);
+  gst_structure_free (statistics->shrunk_history);
+  gst_structure_free (statistics->history);
+  g_ptr_array_unref (statistics->messages);
+  g_mutex_clear (&statistics->lock);
+  engineTestData->signal_context = NULL;
+  g_byte_array_free (mpeg_ts, TRUE);
+  gst_structure_free (hlsTestCase.state);
+  g_object_unref (engineTestData);
+}
+
+/*
+ * Test the statistics messages and the history of the last two fragments
+ * in the statistics property
+ *
+ */
+GST_START_TEST (testStatistics)
+{
+  GstHlsDemuxTestStatistics statistics = { 0 };
+
+  statistics.history_size = 2;
+  statistics.post_statistics = TRUE;
+  run_statistics_test (&statistics);
+}
+
+GST_END_TEST;
+
+/*
+ * Test the statistics property without messages, with prefetched
+ * fragments whose request latency isn't known
+ *
+ */
+GST_START_TEST (testStatisticsPrefetchNoMessages)
+{
+  GstHlsDemuxTestStatistics statistics = { 0 };
+
+  statistics.prefetch_depth = 2;
+  statistics.history_size = 16;
+  statistics.post_statistics = FALSE;
+  run_statistics_test (&statistics);
+}
+
+GST_END_TEST;
+
 static void
 run_seek_position_test (gdouble rate, GstSeekType start_type,
     guint64 seek_start, GstSeekType stop_type,
@@ -527,6 +1126,114 @@ GST_START_TEST (testReverseSeekSnapAfterPosition)
 
 GST_END_TEST;
 
+/*
+ * Test a key unit trick mode seek on a stream with an I-frame variant.
+ * The seek must switch to the I-frame playlist and download its byte
+ * ranges. Downloading an I-frame at connection-speed takes longer than
+ * displaying it, so every other I-frame is skipped
+ *
+ */
+GST_START_TEST (testSeekIFrameTrickMode)
+{
+  /* 16 packets, so that the continuity counters of the I-frames follow
+   * each other like in the generated stream */
+  const guint iframe_size = 16 * TS_PACKET_LEN;
+  const guint segment_size = 4 * iframe_size;
+  const gchar *master_playlist =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:4\n"
+      "#EXT-X-STREAM-INF:PROGRAM-ID=1, BANDWIDTH=200000\n"
+      "media.m3u8\n"
+      "#EXT-X-I-FRAME-STREAM-INF:BANDWIDTH=24000,URI=\"iframe.m3u8\"\n";
+  const gchar *media_playlist =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXTINF:1,Test\n" "001.ts\n"
+      "#EXTINF:1,Test\n" "002.ts\n"
+      "#EXTINF:1,Test\n" "003.ts\n"
+      "#EXTINF:1,Test\n" "004.ts\n" "#EXT-X-ENDLIST\n";
+  const gchar *iframe_playlist =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:4\n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXT-X-I-FRAMES-ONLY\n"
+      "#EXTINF:1,\n" "#EXT-X-BYTERANGE:3008@0\n" "001.ts\n"
+      "#EXTINF:1,\n" "#EXT-X-BYTERANGE:3008@0\n" "002.ts\n"
+      "#EXTINF:1,\n" "#EXT-X-BYTERANGE:3008@0\n" "003.ts\n"
+      "#EXTINF:1,\n" "#EXT-X-BYTERANGE:3008@0\n" "004.ts\n"
+      "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/master.m3u8", (guint8 *) master_playlist, 0},
+    {"http://unit.test/media.m3u8", (guint8 *) media_playlist, 0},
+    {"http://unit.test/iframe.m3u8", (guint8 *) iframe_playlist, 0},
+    {"http://unit.test/001.ts", NULL, segment_size},
+    {"http://unit.test/002.ts", NULL, segment_size},
+    {"http://unit.test/003.ts", NULL, segment_size},
+    {"http://unit.test/004.ts", NULL, segment_size},
+    {NULL, NULL, 0},
+  };
+  /* the first, third and fourth I-frames */
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"src_0", 3 * iframe_size, NULL},
+    {NULL, 0, NULL}
+  };
+  const gchar *expected_fragments[] = {
+    "http://unit.test/001.ts", "http://unit.test/003.ts",
+    "http://unit.test/004.ts"
+  };
+  GstTestHTTPSrcCallbacks http_src_callbacks = { 0 };
+  GstAdaptiveDemuxTestCase *engineTestData;
+  GstHlsDemuxTestCase hlsTestCase = { 0 };
+  GByteArray *mpeg_ts = NULL;
+  const GValue *requests;
+  gboolean on_iframes = FALSE;
+  guint i, fragments = 0;
+
+  fail_unless (iframe_size == 3008);
+
+  engineTestData = gst_adaptive_demux_test_case_new ();
+  mpeg_ts = setup_test_variables (inputTestData, outputTestData,
+      &hlsTestCase, engineTestData, segment_size);
+
+  http_src_callbacks.src_start = gst_hlsdemux_test_src_start;
+  http_src_callbacks.src_create = gst_hlsdemux_test_src_create;
+  /* 3008 bytes take 1.003s to download at 24 kbps */
+  engineTestData->demux_properties = gst_structure_new ("properties",
+      "connection-speed", G_TYPE_UINT, 24, NULL);
+  engineTestData->threshold_for_seek = 10 * TS_PACKET_LEN;
+  engineTestData->seek_event =
+      gst_event_new_seek (1.0, GST_FORMAT_TIME,
+      GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT |
+      GST_SEEK_FLAG_TRICKMODE_KEY_UNITS, GST_SEEK_TYPE_SET, 0,
+      GST_SEEK_TYPE_NONE, 0);
+
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &hlsTestCase);
+  gst_adaptive_demux_test_seek (DEMUX_ELEMENT_NAME,
+      inputTestData[0].uri, engineTestData);
+
+  /* only the selected I-frames are requested after the switch */
+  requests = gst_structure_get_value (hlsTestCase.state, "requests");
+  fail_unless (requests != NULL);
+  for (i = 0; i < gst_value_array_get_size (requests); i++) {
+    const gchar *uri =
+        g_value_get_string (gst_value_array_get_value (requests, i));
+
+    if (strcmp (uri, "http://unit.test/iframe.m3u8") == 0) {
+      on_iframes = TRUE;
+    } else if (on_iframes && g_str_has_suffix (uri, ".ts")) {
+      fail_unless (fragments < G_N_ELEMENTS (expected_fragments));
+      assert_equals_string (uri, expected_fragments[fragments]);
+      fragments++;
+    }
+  }
+  fail_unless (on_iframes);
+  assert_equals_int (fragments, G_N_ELEMENTS (expected_fragments));
+
+  TESTCASE_UNREF_BOILERPLATE;
+}
+
+GST_END_TEST;
+
 static void
 testDownloadErrorMessageCallback (GstAdaptiveDemuxTestEngine * engine,
     GstMessage * msg, gpointer user_data)
@@ -630,6 +1337,47 @@ GST_START_TEST (testFragmentNotFound)
 
 GST_END_TEST;
 
+/* test that a key that is not 16 bytes long is rejected with an error */
+GST_START_TEST (testDecryptionInvalidKey)
+{
+  static const guint8 key[8] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07
+  };
+  static const guint8 fragment[32] = { 0 };
+  const gchar *media_playlist =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXT-X-KEY:METHOD=AES-128,URI=\"key.bin\","
+      "IV=0x000102030405060708090a0b0c0d0e0f\n"
+      "#EXTINF:1,Test\n" "001.ts\n" "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/media.m3u8", (guint8 *) media_playlist, 0},
+    {"http://unit.test/key.bin", key, sizeof (key)},
+    {"http://unit.test/001.ts", fragment, sizeof (fragment)},
+    {NULL, NULL, 0}
+  };
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"src_0", 0, NULL},
+    {NULL, 0, NULL}
+  };
+  TESTCASE_INIT_BOILERPLATE (0);
+
+  http_src_callbacks.src_start = gst_hlsdemux_test_src_start;
+  http_src_callbacks.src_create = gst_hlsdemux_test_src_create;
+  engine_callbacks.appsink_received_data =
+      gst_adaptive_demux_test_check_received_data;
+  engine_callbacks.appsink_eos = hlsdemux_test_check_no_data_received;
+  engine_callbacks.bus_error_message = testDownloadErrorMessageCallback;
+
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &hlsTestCase);
+  gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME,
+      "http://unit.test/media.m3u8", &engine_callbacks, engineTestData);
+
+  TESTCASE_UNREF_BOILERPLATE;
+}
+
+GST_END_TEST;
+
 /* work-around that adaptivedemux is not posting an error message
    about failure to download a fragment */
 static void
@@ -712,6 +1460,76 @@ GST_START_TEST (testFragmentDownloadError)
 
 GST_END_TEST;
 
+static gchar *
+gst_hlsdemux_test_simulation_playlist (const gchar * uri,
+    const guint64 * bitrates, guint n_bitrates, guint n_fragments)
+{
+  GString *playlist;
+  guint kbps, i;
+  gchar name[16];
+
+  fail_unless (g_str_has_prefix (uri, "http://unit.test/"));
+  uri += strlen ("http://unit.test/");
+
+  if (strcmp (uri, "master.m3u8") == 0) {
+    playlist = g_string_new ("#EXTM3U\n" "#EXT-X-VERSION:4\n");
+    for (i = 0; i < n_bitrates; i++) {
+      g_string_append_printf (playlist, "#EXT-X-STREAM-INF:PROGRAM-ID=1, "
+          "BANDWIDTH=%" G_GUINT64_FORMAT "\n%" G_GUINT64_FORMAT
+          "/media.m3u8\n", bitrates[i], bitrates[i] / 1000);
+    }
+    return g_string_free (playlist, FALSE);
+  }
+
+  if (sscanf (uri, "%u/%15s", &kbps, name) != 2
+      || strcmp (name, "media.m3u8") != 0)
+    return NULL;
+  for (i = 0; i < n_bitrates && bitrates[i] != kbps * 1000; i++);
+  if (i == n_bitrates)
+    return NULL;
+
+  playlist = g_string_new ("#EXTM3U\n"
+      "#EXT-X-VERSION:4\n" "#EXT-X-TARGETDURATION:2\n");
+  for (i = 0; i < n_fragments; i++)
+    g_string_append_printf (playlist, "#EXTINF:2,\n%03u.ts\n", i);
+  g_string_append (playlist, "#EXT-X-ENDLIST\n");
+  return g_string_free (playlist, FALSE);
+}
+
+static guint64
+gst_hlsdemux_test_simulation_match_uri (const gchar * uri, guint n_fragments)
+{
+  guint kbps, number;
+
+  if (sscanf (uri, "http://unit.test/%u/%03u.ts", &kbps, &number) == 2
+      && number < n_fragments)
+    return kbps * (guint64) 1000;
+  return 0;
+}
+
+/*
+ * Test the bitrate adaptation algorithms
+ * Plays a stream with three variants over a simulated network whose
+ * bandwidth drops below the lowest variant and recovers, and checks that
+ * every algorithm plays it completely, and reproducibly when based on the
+ * download statistics.
+ */
+GST_START_TEST (testAbrSimulation)
+{
+  /* a whole cycle of the continuity counter */
+  const guint payload_size = 16 * TS_PACKET_LEN;
+  GByteArray *mpeg_ts;
+
+  mpeg_ts = generate_transport_stream (payload_size);
+  fail_unless (mpeg_ts != NULL);
+  gst_adaptive_demux_test_abr_simulation (DEMUX_ELEMENT_NAME,
+      "http://unit.test/master.m3u8", gst_hlsdemux_test_simulation_playlist,
+      gst_hlsdemux_test_simulation_match_uri, mpeg_ts->data, payload_size);
+  g_byte_array_free (mpeg_ts, TRUE);
+}
+
+GST_END_TEST;
+
 static Suite *
 hls_demux_suite (void)
 {
@@ -724,6 +1542,12 @@ hls_demux_suite (void)
   tcase_add_test (tc_basicTest, testFragmentNotFound);
   tcase_add_test (tc_basicTest, testFragmentDownloadError);
   tcase_add_test (tc_basicTest, testSeek);
+  tcase_add_test (tc_basicTest, testPrefetch);
+  tcase_add_test (tc_basicTest, testDecryption);
+  tcase_add_test (tc_basicTest, testDecryptionPrefetchKeys);
+  tcase_add_test (tc_basicTest, testDecryptionInvalidKey);
+  tcase_add_test (tc_basicTest, testStatistics);
+  tcase_add_test (tc_basicTest, testStatisticsPrefetchNoMessages);
   tcase_add_test (tc_basicTest, testSeekKeyUnitPosition);
   tcase_add_test (tc_basicTest, testSeekPosition);
   tcase_add_test (tc_basicTest, testSeekUpdateStopPosition);
@@ -731,6 +1555,8 @@ hls_demux_suite (void)
   tcase_add_test (tc_basicTest, testSeekSnapAfterPosition);
   tcase_add_test (tc_basicTest, testReverseSeekSnapBeforePosition);
   tcase_add_test (tc_basicTest, testReverseSeekSnapAfterPosition);
+  tcase_add_test (tc_basicTest, testSeekIFrameTrickMode);
+  tcase_add_test (tc_basicTest, testAbrSimulation);
 
   tcase_add_unchecked_fixture (tc_basicTest, gst_adaptive_demux_test_setup,
       gst_adaptive_demux_test_teardown);
@@ -355,8 +355,8 @@ GST_START_TEST (test_load_main_playlist_rendition)
 
   client = load_playlist (ON_DEMAND_PLAYLIST);
 
-  assert_equals_int (g_list_length (client->main->files), 4);
-  assert_equals_int (g_list_length (client->current->files), 4);
+  assert_equals_int (client->main->files->len, 4);
+  assert_equals_int (client->current->files->len, 4);
   assert_equals_int (client->sequence, 0);
 
   gst_m3u8_client_free (client);
@@ -465,13 +465,13 @@ check_on_demand_playlist (const gchar * data)
   /* Check that we are not live */
   assert_equals_int (gst_m3u8_client_is_live (client), FALSE);
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_FILE_AT (pl, 0);
   assert_equals_string (file->uri, "http://media.example.com/001.ts");
   assert_equals_int (file->sequence, 0);
   /* Check last media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  file = GST_M3U8_FILE_AT (pl, pl->files->len - 1);
   assert_equals_string (file->uri, "http://media.example.com/004.ts");
   assert_equals_int (file->sequence, 3);
 
@@ -521,14 +521,14 @@ GST_START_TEST (test_live_playlist)
   assert_equals_int (gst_m3u8_client_is_live (client), TRUE);
   assert_equals_int (client->sequence, 2681);
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_FILE_AT (pl, 0);
   assert_equals_string (file->uri,
       "https://priv.example.com/fileSequence2680.ts");
   assert_equals_int (file->sequence, 2680);
   /* Check last media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  file = GST_M3U8_FILE_AT (pl, pl->files->len - 1);
   assert_equals_string (file->uri,
       "https://priv.example.com/fileSequence2683.ts");
   assert_equals_int (file->sequence, 2683);
@@ -555,7 +555,7 @@ GST_START_TEST (test_live_playlist_rotated)
   pl = client->current;
   assert_equals_int (client->sequence, 2681);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_FILE_AT (pl, 0);
   assert_equals_int (file->sequence, 2680);
 
   ret = gst_m3u8_client_update (client, g_strdup (LIVE_ROTATED_PLAYLIST));
@@ -565,7 +565,7 @@ GST_START_TEST (test_live_playlist_rotated)
   /* FIXME: Sequence should last - 3. Should it? */
   assert_equals_int (client->sequence, 3001);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_FILE_AT (pl, 0);
   assert_equals_int (file->sequence, 3001);
 
   gst_m3u8_client_free (client);
@@ -585,13 +585,13 @@ GST_START_TEST (test_playlist_with_doubles_duration)
 
   pl = client->current;
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 0));
+  file = GST_M3U8_FILE_AT (pl, 0);
   assert_equals_float (file->duration / (double) GST_SECOND, 10.321);
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 1));
+  file = GST_M3U8_FILE_AT (pl, 1);
   assert_equals_float (file->duration / (double) GST_SECOND, 9.6789);
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 2));
+  file = GST_M3U8_FILE_AT (pl, 2);
   assert_equals_float (file->duration / (double) GST_SECOND, 10.2344);
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 3));
+  file = GST_M3U8_FILE_AT (pl, 3);
   assert_equals_float (file->duration / (double) GST_SECOND, 9.92);
   fail_unless (gst_m3u8_client_get_seek_range (client, &start, &stop));
   assert_equals_int64 (start, 0);
@@ -616,26 +616,26 @@ GST_START_TEST (test_playlist_with_encryption)
   client = load_playlist (AES_128_ENCRYPTED_PLAYLIST);
 
   pl = client->current;
-  assert_equals_int (g_list_length (pl->files), 5);
+  assert_equals_int (pl->files->len, 5);
 
   /* Check all media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 0));
+  file = GST_M3U8_FILE_AT (pl, 0);
   fail_unless (file->key == NULL);
 
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 1));
+  file = GST_M3U8_FILE_AT (pl, 1);
   fail_unless (file->key == NULL);
 
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 2));
+  file = GST_M3U8_FILE_AT (pl, 2);
   fail_unless (file->key != NULL);
   assert_equals_string (file->key, "https://priv.example.com/key.bin");
   fail_unless (memcmp (&file->iv, iv2, 16) == 0);
 
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 3));
+  file = GST_M3U8_FILE_AT (pl, 3);
   fail_unless (file->key != NULL);
   assert_equals_string (file->key, "https://priv.example.com/key2.bin");
   fail_unless (memcmp (&file->iv, iv1, 16) == 0);
 
-  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 4));
+  file = GST_M3U8_FILE_AT (pl, 4);
   fail_unless (file->key != NULL);
   assert_equals_string (file->key, "https://priv.example.com/key2.bin");
   fail_unless (memcmp (&file->iv, iv1, 16) == 0);
@@ -654,7 +654,7 @@ GST_START_TEST (test_update_invalid_playlist)
   /* Test updates in on-demand playlists */
   client = load_playlist (ON_DEMAND_PLAYLIST);
   pl = client->current;
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   ret = gst_m3u8_client_update (client, g_strdup ("#INVALID"));
   assert_equals_int (ret, FALSE);
 
@@ -673,26 +673,77 @@ GST_START_TEST (test_update_playlist)
   /* Test updates in on-demand playlists */
   client = load_playlist (ON_DEMAND_PLAYLIST);
   pl = client->current;
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   ret = gst_m3u8_client_update (client, g_strdup (ON_DEMAND_PLAYLIST));
   assert_equals_int (ret, TRUE);
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   gst_m3u8_client_free (client);
 
   /* Test updates in live playlists */
   client = load_playlist (LIVE_PLAYLIST);
   pl = client->current;
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Add a new entry to the playlist and check the update */
   live_pl = g_strdup_printf ("%s\n%s\n%s", LIVE_PLAYLIST, "#EXTINF:8",
       "https://priv.example.com/fileSequence2683.ts");
   ret = gst_m3u8_client_update (client, live_pl);
   assert_equals_int (ret, TRUE);
-  assert_equals_int (g_list_length (pl->files), 5);
+  assert_equals_int (pl->files->len, 5);
   /* Test sliding window */
   ret = gst_m3u8_client_update (client, g_strdup (LIVE_PLAYLIST));
   assert_equals_int (ret, TRUE);
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_update_playlist_appended)
+{
+  GstM3U8Client *client;
+  GstM3U8MediaFile *file;
+  GstM3U8 *pl;
+  gchar *live_pl;
+  gboolean ret;
+
+  client = load_playlist (LIVE_PLAYLIST);
+  pl = client->current;
+  file = GST_M3U8_FILE_AT (pl, 1);
+
+  /* The first fragment expired and a new one was appended */
+  live_pl = g_strdup ("#EXTM3U\n\
+#EXT-X-TARGETDURATION:8\n\
+#EXT-X-MEDIA-SEQUENCE:2681\n\
+\n\
+#EXTINF:8,\n\
+https://priv.example.com/fileSequence2681.ts\n\
+#EXTINF:8,\n\
+https://priv.example.com/fileSequence2682.ts\n\
+#EXTINF:8,\n\
+https://priv.example.com/fileSequence2683.ts\n\
+#EXTINF:4,\n\
+https://priv.example.com/fileSequence2684.ts");
+  ret = gst_m3u8_client_update (client, live_pl);
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (pl->files->len, 4);
+
+  /* The fragments that were kept were not parsed again */
+  fail_unless (GST_M3U8_FILE_AT (pl, 0) == file);
+  assert_equals_int (file->sequence, 2681);
+  assert_equals_uint64 (file->start, 0);
+
+  file = GST_M3U8_FILE_AT (pl, 3);
+  assert_equals_int (file->sequence, 2684);
+  assert_equals_string (file->uri,
+      "https://priv.example.com/fileSequence2684.ts");
+  assert_equals_uint64 (file->start, 24 * GST_SECOND);
+  assert_equals_uint64 (file->duration, 4 * GST_SECOND);
+
+  /* The same playlist again doesn't change anything */
+  ret = gst_m3u8_client_update (client, g_strdup (pl->last_data));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (pl->files->len, 4);
+
   gst_m3u8_client_free (client);
 }
 
@@ -708,9 +759,9 @@ GST_START_TEST (test_playlist_media_files)
   pl = client->current;
 
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_FILE_AT (pl, 0);
   assert_equals_string (file->uri, "http://media.example.com/001.ts");
   assert_equals_int (file->sequence, 0);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
@@ -733,16 +784,16 @@ GST_START_TEST (test_playlist_byte_range_media_files)
   pl = client->current;
 
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_FILE_AT (pl, 0);
   assert_equals_string (file->uri, "http://media.example.com/all.ts");
   assert_equals_int (file->sequence, 0);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
   assert_equals_int (file->offset, 100);
   assert_equals_int (file->size, 1000);
   /* Check last media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  file = GST_M3U8_FILE_AT (pl, pl->files->len - 1);
   assert_equals_string (file->uri, "http://media.example.com/all.ts");
   assert_equals_int (file->sequence, 3);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
@@ -756,16 +807,16 @@ GST_START_TEST (test_playlist_byte_range_media_files)
   pl = client->current;
 
   /* Check number of entries */
-  assert_equals_int (g_list_length (pl->files), 4);
+  assert_equals_int (pl->files->len, 4);
   /* Check first media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_first (pl->files)->data);
+  file = GST_M3U8_FILE_AT (pl, 0);
   assert_equals_string (file->uri, "http://media.example.com/all.ts");
   assert_equals_int (file->sequence, 0);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
   assert_equals_int (file->offset, 0);
   assert_equals_int (file->size, 1000);
   /* Check last media segments */
-  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  file = GST_M3U8_FILE_AT (pl, pl->files->len - 1);
   assert_equals_string (file->uri, "http://media.example.com/all.ts");
   assert_equals_int (file->sequence, 3);
   assert_equals_float (file->duration, 10 * (double) GST_SECOND);
@@ -829,6 +880,40 @@ GST_START_TEST (test_get_next_fragment)
 
 GST_END_TEST;
 
+GST_START_TEST (test_find_file)
+{
+  GstM3U8Client *client;
+  GstM3U8 *pl;
+
+  client = load_playlist (DOUBLES_PLAYLIST);
+  pl = client->current;
+
+  /* Files start at the sum of the previous durations */
+  assert_equals_uint64 (GST_M3U8_FILE_AT (pl, 0)->start, 0);
+  assert_equals_uint64 (GST_M3U8_FILE_AT (pl, 2)->start,
+      GST_M3U8_FILE_AT (pl, 0)->duration + GST_M3U8_FILE_AT (pl, 1)->duration);
+
+  assert_equals_int (gst_m3u8_find_file_by_position (pl, 0), 0);
+  assert_equals_int (gst_m3u8_find_file_by_position (pl,
+          GST_M3U8_FILE_AT (pl, 1)->start - 1), 0);
+  assert_equals_int (gst_m3u8_find_file_by_position (pl,
+          GST_M3U8_FILE_AT (pl, 1)->start), 1);
+  assert_equals_int (gst_m3u8_find_file_by_position (pl, 35 * GST_SECOND), 3);
+  assert_equals_int (gst_m3u8_find_file_by_position (pl, 50 * GST_SECOND), 4);
+  gst_m3u8_client_free (client);
+
+  client = load_playlist (LIVE_PLAYLIST);
+  pl = client->current;
+
+  assert_equals_int (gst_m3u8_find_file_by_sequence (pl, 2680), 0);
+  assert_equals_int (gst_m3u8_find_file_by_sequence (pl, 2683), 3);
+  assert_equals_int (gst_m3u8_find_file_by_sequence (pl, 2679), -1);
+  assert_equals_int (gst_m3u8_find_file_by_sequence (pl, 2684), -1);
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_get_duration)
 {
   GstM3U8Client *client;
@@ -1400,9 +1485,11 @@ hlsdemux_suite (void)
   tcase_add_test (tc_m3u8, test_live_playlist_rotated);
   tcase_add_test (tc_m3u8, test_update_invalid_playlist);
   tcase_add_test (tc_m3u8, test_update_playlist);
+  tcase_add_test (tc_m3u8, test_update_playlist_appended);
   tcase_add_test (tc_m3u8, test_playlist_media_files);
   tcase_add_test (tc_m3u8, test_playlist_byte_range_media_files);
   tcase_add_test (tc_m3u8, test_get_next_fragment);
+  tcase_add_test (tc_m3u8, test_find_file);
   tcase_add_test (tc_m3u8, test_get_duration);
   tcase_add_test (tc_m3u8, test_get_target_duration);
   tcase_add_test (tc_m3u8, test_get_stream_for_bitrate);
@@ -0,0 +1,504 @@
+/* GStreamer
+ *
+ * unit test for hlssink
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+#include <glib/gstdio.h>
+
+#define TS_PACKET_LEN 188
+#define BUFFER_DURATION (250 * GST_MSECOND)
+
+static gchar *tmp_dir;
+
+static void
+setup (void)
+{
+  tmp_dir = g_dir_make_tmp ("hlssink-XXXXXX", NULL);
+  fail_unless (tmp_dir != NULL);
+}
+
+static void
+teardown (void)
+{
+  const gchar *name;
+  GDir *dir;
+
+  dir = g_dir_open (tmp_dir, 0, NULL);
+  fail_unless (dir != NULL);
+  while ((name = g_dir_read_name (dir))) {
+    gchar *filename = g_build_filename (tmp_dir, name, NULL);
+
+    if (g_file_test (filename, G_FILE_TEST_IS_DIR))
+      g_rmdir (filename);
+    else
+      g_remove (filename);
+    g_free (filename);
+  }
+  g_dir_close (dir);
+  g_rmdir (tmp_dir);
+  g_free (tmp_dir);
+  tmp_dir = NULL;
+}
+
+static gchar *
+tmp_file (const gchar * name)
+{
+  return g_build_filename (tmp_dir, name, NULL);
+}
+
+/* one packet filled with its index, with a key unit every 4 buffers */
+static GstBuffer *
+create_buffer (guint i)
+{
+  GstBuffer *buf;
+
+  buf = gst_buffer_new_allocate (NULL, TS_PACKET_LEN, NULL);
+  gst_buffer_memset (buf, 0, i, TS_PACKET_LEN);
+  GST_BUFFER_PTS (buf) = i * BUFFER_DURATION;
+  GST_BUFFER_DURATION (buf) = BUFFER_DURATION;
+  if (i % 4 != 0)
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  return buf;
+}
+
+static void
+push_buffers (GstHarness * h, guint first, guint n)
+{
+  guint i;
+
+  for (i = first; i < first + n; i++)
+    fail_unless_equals_int (gst_harness_push (h, create_buffer (i)),
+        GST_FLOW_OK);
+}
+
+/* cuts the segment like the force-key-unit events sent by the encoder in
+ * front of hlssink */
+static void
+push_key_unit (GstHarness * h, guint i, guint count)
+{
+  GstClockTime timestamp = i * BUFFER_DURATION;
+
+  fail_unless (gst_harness_push_event (h,
+          gst_video_event_new_downstream_force_key_unit (timestamp, timestamp,
+              timestamp, TRUE, count)));
+}
+
+static void
+check_file (const gchar * name, guint first, guint n)
+{
+  gchar *filename = tmp_file (name);
+  gchar *data;
+  gsize size, i;
+
+  fail_unless (g_file_get_contents (filename, &data, &size, NULL),
+      "Could not read %s", name);
+  fail_unless_equals_int (size, n * TS_PACKET_LEN);
+  for (i = 0; i < size; i++)
+    fail_unless_equals_int ((guint8) data[i], first + i / TS_PACKET_LEN);
+
+  g_free (data);
+  g_free (filename);
+}
+
+static gchar *
+read_playlist (const gchar * location)
+{
+  gchar *tmp_location = g_strdup_printf ("%s.tmp", location);
+  gchar *playlist;
+
+  /* only the renamed playlist is left */
+  fail_unless (g_file_get_contents (location, &playlist, NULL, NULL));
+  fail_if (g_file_test (tmp_location, G_FILE_TEST_EXISTS));
+  g_free (tmp_location);
+
+  return playlist;
+}
+
+static void
+check_playlist_message (GstBus * bus, guint media_sequence, guint parts)
+{
+  GstMessage *msg;
+  const GstStructure *s;
+  guint value;
+
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+  fail_unless (msg != NULL);
+  s = gst_message_get_structure (msg);
+  fail_unless (gst_structure_has_name (s, "GstHlsSinkPlaylist"));
+  fail_unless (gst_structure_get_uint (s, "media-sequence", &value));
+  fail_unless_equals_int (value, media_sequence);
+  fail_unless (gst_structure_get_uint (s, "parts", &value));
+  fail_unless_equals_int (value, parts);
+  gst_message_unref (msg);
+}
+
+GST_START_TEST (test_partial_segments)
+{
+  GstHarness *h;
+  GstBus *bus;
+  gchar *location, *part_location, *playlist_location, *playlist;
+
+  location = tmp_file ("segment%05d.ts");
+  part_location = tmp_file ("part%05d.ts");
+  playlist_location = tmp_file ("playlist.m3u8");
+
+  h = gst_harness_new ("hlssink");
+  g_object_set (h->element, "location", location, "part-location",
+      part_location, "playlist-location", playlist_location,
+      "target-duration", 0, "part-duration", 500, "max-files", 0,
+      "can-block-reload", TRUE, NULL);
+  bus = gst_bus_new ();
+  gst_element_set_bus (h->element, bus);
+  gst_harness_play (h);
+  gst_harness_set_src_caps_str (h, "video/mpegts, systemstream=(boolean)true");
+
+  /* two parts of 500ms in the first segment, the second one is closed with
+   * the segment */
+  push_buffers (h, 0, 4);
+  push_key_unit (h, 4, 1);
+  push_buffers (h, 4, 2);
+
+  check_file ("part00000.ts", 0, 2);
+  check_file ("part00001.ts", 2, 2);
+  check_file ("segment00000.ts", 0, 4);
+
+  playlist = read_playlist (playlist_location);
+  fail_unless_equals_string (playlist,
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "#EXT-X-ALLOW-CACHE:NO\n"
+      "#EXT-X-MEDIA-SEQUENCE:1\n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXT-X-PART-INF:PART-TARGET=0.5\n"
+      "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=1.5\n"
+      "\n"
+      "#EXT-X-PART:DURATION=0.5,URI=\"part00000.ts\",INDEPENDENT=YES\n"
+      "#EXT-X-PART:DURATION=0.5,URI=\"part00001.ts\"\n"
+      "#EXTINF:1,\n"
+      "segment00000.ts\n"
+      "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"part00002.ts\"\n");
+  g_free (playlist);
+
+  /* the first part of the first segment, then the whole segment */
+  check_playlist_message (bus, 0, 1);
+  check_playlist_message (bus, 2, 0);
+
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+  playlist = read_playlist (playlist_location);
+  fail_unless (g_str_has_suffix (playlist, "#EXT-X-ENDLIST"));
+  fail_if (strstr (playlist, "#EXT-X-PRELOAD-HINT") != NULL);
+  g_free (playlist);
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+  g_free (playlist_location);
+  g_free (part_location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* The playlist can't replace a directory, the temporary file must be
+ * removed and the error posted */
+GST_START_TEST (test_playlist_rename_failure)
+{
+  GstHarness *h;
+  GstBus *bus;
+  GstMessage *msg;
+  GError *err = NULL;
+  gchar *location, *playlist_location, *tmp_location;
+
+  location = tmp_file ("segment%05d.ts");
+  playlist_location = tmp_file ("playlist.m3u8");
+  tmp_location = tmp_file ("playlist.m3u8.tmp");
+  fail_unless (g_mkdir (playlist_location, 0700) == 0);
+
+  h = gst_harness_new ("hlssink");
+  g_object_set (h->element, "location", location, "playlist-location",
+      playlist_location, "target-duration", 0, NULL);
+  bus = gst_bus_new ();
+  gst_element_set_bus (h->element, bus);
+  gst_harness_play (h);
+  gst_harness_set_src_caps_str (h, "video/mpegts, systemstream=(boolean)true");
+
+  push_buffers (h, 0, 4);
+  push_key_unit (h, 4, 1);
+  push_buffers (h, 4, 1);
+
+  check_file ("segment00000.ts", 0, 4);
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  gst_message_parse_error (msg, &err, NULL);
+  fail_unless (g_error_matches (err, GST_RESOURCE_ERROR,
+          GST_RESOURCE_ERROR_OPEN_WRITE));
+  g_error_free (err);
+  gst_message_unref (msg);
+
+  fail_unless (g_file_test (playlist_location, G_FILE_TEST_IS_DIR));
+  fail_if (g_file_test (tmp_location, G_FILE_TEST_EXISTS));
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+  g_free (tmp_location);
+  g_free (playlist_location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* an MP4 box of @size bytes filled with a counter, also appended to
+ * @contents, the data expected in the file the box is written to */
+static GstBuffer *
+create_box (guint32 fourcc, guint size, GByteArray * contents)
+{
+  static guint8 counter = 0;
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint i;
+
+  buf = gst_buffer_new_allocate (NULL, size, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  GST_WRITE_UINT32_BE (map.data, size);
+  GST_WRITE_UINT32_LE (map.data + 4, fourcc);
+  for (i = 8; i < size; i++)
+    map.data[i] = counter++;
+  g_byte_array_append (contents, map.data, size);
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+static void
+push_box (GstHarness * h, GstBuffer * buf)
+{
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+}
+
+/* a fragment of 500ms, the moof box has no timestamp like with mp4mux */
+static void
+push_fragment (GstHarness * h, guint i, GByteArray * contents)
+{
+  GstBuffer *buf;
+
+  push_box (h, create_box (GST_MAKE_FOURCC ('m', 'o', 'o', 'f'), 32,
+          contents));
+  buf = create_box (GST_MAKE_FOURCC ('m', 'd', 'a', 't'), 40, contents);
+  GST_BUFFER_PTS (buf) = i * 2 * BUFFER_DURATION;
+  GST_BUFFER_DURATION (buf) = 2 * BUFFER_DURATION;
+  push_box (h, buf);
+}
+
+static void
+check_contents (const gchar * name, GByteArray * contents)
+{
+  gchar *filename = tmp_file (name);
+  gchar *data;
+  gsize size;
+
+  fail_unless (g_file_get_contents (filename, &data, &size, NULL),
+      "Could not read %s", name);
+  fail_unless_equals_int (size, contents->len);
+  fail_unless (memcmp (data, contents->data, size) == 0);
+
+  g_free (data);
+  g_free (filename);
+}
+
+/* The boxes before the first moof go to the init segment, referenced with
+ * EXT-X-MAP, and the segments are split before moof boxes */
+GST_START_TEST (test_fragmented_mp4)
+{
+  GstHarness *h;
+  GByteArray *init, *segment0, *segment1;
+  gchar *location, *init_location, *playlist_location, *playlist;
+
+  location = tmp_file ("segment%05d.m4s");
+  init_location = tmp_file ("init.mp4");
+  playlist_location = tmp_file ("playlist.m3u8");
+
+  h = gst_harness_new ("hlssink");
+  g_object_set (h->element, "location", location, "init-location",
+      init_location, "playlist-location", playlist_location,
+      "target-duration", 1, "max-files", 0, NULL);
+  gst_harness_play (h);
+  gst_harness_set_src_caps_str (h, "video/quicktime, variant=(string)iso");
+
+  init = g_byte_array_new ();
+  segment0 = g_byte_array_new ();
+  segment1 = g_byte_array_new ();
+
+  push_box (h, create_box (GST_MAKE_FOURCC ('f', 't', 'y', 'p'), 24, init));
+  push_box (h, create_box (GST_MAKE_FOURCC ('m', 'o', 'o', 'v'), 64, init));
+  push_fragment (h, 0, segment0);
+  check_contents ("init.mp4", init);
+  push_fragment (h, 1, segment0);
+
+  /* the third fragment starts at the target duration */
+  push_fragment (h, 2, segment1);
+  check_contents ("segment00000.m4s", segment0);
+
+  playlist = read_playlist (playlist_location);
+  fail_unless_equals_string (playlist,
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "#EXT-X-ALLOW-CACHE:NO\n"
+      "#EXT-X-MEDIA-SEQUENCE:0\n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXT-X-MAP:URI=\"init.mp4\"\n"
+      "\n"
+      "#EXTINF:1,\n"
+      "segment00000.m4s\n");
+  g_free (playlist);
+
+  push_fragment (h, 3, segment1);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+  check_contents ("segment00001.m4s", segment1);
+
+  gst_harness_teardown (h);
+  g_byte_array_unref (segment1);
+  g_byte_array_unref (segment0);
+  g_byte_array_unref (init);
+  g_free (playlist_location);
+  g_free (init_location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* The samples of a regular MP4 file come before any moof box, the file must
+ * be written as is without any init segment */
+GST_START_TEST (test_regular_mp4)
+{
+  GstHarness *h;
+  GByteArray *segment;
+  GstBuffer *buf;
+  gchar *location, *init_location, *playlist_location, *playlist;
+
+  location = tmp_file ("segment%05d.mp4");
+  init_location = tmp_file ("init.mp4");
+  playlist_location = tmp_file ("playlist.m3u8");
+
+  h = gst_harness_new ("hlssink");
+  g_object_set (h->element, "location", location, "init-location",
+      init_location, "playlist-location", playlist_location,
+      "target-duration", 0, NULL);
+  gst_harness_play (h);
+  gst_harness_set_src_caps_str (h, "video/quicktime, variant=(string)iso");
+
+  segment = g_byte_array_new ();
+  push_box (h, create_box (GST_MAKE_FOURCC ('f', 't', 'y', 'p'), 24,
+          segment));
+  push_box (h, create_box (GST_MAKE_FOURCC ('m', 'o', 'o', 'v'), 64,
+          segment));
+  buf = create_box (GST_MAKE_FOURCC ('m', 'd', 'a', 't'), 40, segment);
+  GST_BUFFER_PTS (buf) = 0;
+  GST_BUFFER_DURATION (buf) = 4 * BUFFER_DURATION;
+  push_box (h, buf);
+  push_key_unit (h, 4, 1);
+
+  check_contents ("segment00000.mp4", segment);
+  fail_if (g_file_test (init_location, G_FILE_TEST_EXISTS));
+
+  playlist = read_playlist (playlist_location);
+  fail_unless_equals_string (playlist,
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:3\n"
+      "#EXT-X-ALLOW-CACHE:NO\n"
+      "#EXT-X-MEDIA-SEQUENCE:1\n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "\n"
+      "#EXTINF:1,\n"
+      "segment00000.mp4\n");
+  g_free (playlist);
+
+  gst_harness_teardown (h);
+  g_byte_array_unref (segment);
+  g_free (playlist_location);
+  g_free (init_location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* In low latency mode, the held back boxes must also be written to the
+ * segment, in front of the samples */
+GST_START_TEST (test_regular_mp4_partial_segments)
+{
+  GstHarness *h;
+  GByteArray *segment;
+  GstBuffer *buf;
+  gchar *location, *part_location, *playlist_location;
+
+  location = tmp_file ("segment%05d.mp4");
+  part_location = tmp_file ("part%05d.mp4");
+  playlist_location = tmp_file ("playlist.m3u8");
+
+  h = gst_harness_new ("hlssink");
+  g_object_set (h->element, "location", location, "part-location",
+      part_location, "playlist-location", playlist_location,
+      "target-duration", 0, "part-duration", 500, NULL);
+  gst_harness_play (h);
+  gst_harness_set_src_caps_str (h, "video/quicktime, variant=(string)iso");
+
+  segment = g_byte_array_new ();
+  push_box (h, create_box (GST_MAKE_FOURCC ('f', 't', 'y', 'p'), 24,
+          segment));
+  push_box (h, create_box (GST_MAKE_FOURCC ('m', 'o', 'o', 'v'), 64,
+          segment));
+  buf = create_box (GST_MAKE_FOURCC ('m', 'd', 'a', 't'), 40, segment);
+  GST_BUFFER_PTS (buf) = 0;
+  GST_BUFFER_DURATION (buf) = 4 * BUFFER_DURATION;
+  push_box (h, buf);
+  push_key_unit (h, 4, 1);
+
+  check_contents ("part00000.mp4", segment);
+  check_contents ("segment00000.mp4", segment);
+
+  gst_harness_teardown (h);
+  g_byte_array_unref (segment);
+  g_free (playlist_location);
+  g_free (part_location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+static Suite *
+hlssink_suite (void)
+{
+  Suite *s = suite_create ("hlssink");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_checked_fixture (tc_chain, setup, teardown);
+  tcase_add_test (tc_chain, test_partial_segments);
+  tcase_add_test (tc_chain, test_playlist_rename_failure);
+  tcase_add_test (tc_chain, test_fragmented_mp4);
+  tcase_add_test (tc_chain, test_regular_mp4);
+  tcase_add_test (tc_chain, test_regular_mp4_partial_segments);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlssink);
@@ -19,9 +19,14 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include "../../ext/smoothstreaming/gstmssmanifest.c"
+#undef GST_CAT_DEFAULT
+
 #include <gst/check/gstcheck.h>
 #include "adaptive_demux_common.h"
 
+GST_DEBUG_CATEGORY (mssdemux_debug);
+
 #define DEMUX_ELEMENT_NAME "mssdemux"
 
 #define COPY_OUTPUT_TEST_DATA(outputTestData,testData) do { \
@@ -602,12 +607,296 @@ GST_START_TEST (testFragmentDownloadError)
 
 GST_END_TEST;
 
+static gchar *
+gst_mssdemux_simulation_manifest (const gchar * uri,
+    const guint64 * bitrates, guint n_bitrates, guint n_fragments)
+{
+  GString *manifest;
+  guint i;
+
+  if (strcmp (uri, "http://unit.test/Manifest") != 0)
+    return NULL;
+
+  manifest = g_string_new ("<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+      "<SmoothStreamingMedia MajorVersion=\"2\" MinorVersion=\"0\"");
+  g_string_append_printf (manifest, " Duration=\"%u\">"
+      "<StreamIndex Type=\"video\" QualityLevels=\"%u\" Chunks=\"%u\""
+      " Url=\"QualityLevels({bitrate})/Fragments(video={start time})\">",
+      n_fragments * 20000000, n_bitrates, n_fragments);
+  for (i = 0; i < n_bitrates; i++) {
+    g_string_append_printf (manifest, "<QualityLevel Index=\"%u\""
+        " Bitrate=\"%" G_GUINT64_FORMAT "\" FourCC=\"H264\" MaxWidth=\"1024\""
+        " MaxHeight=\"436\" CodecPrivateData=\"000\" />", i, bitrates[i]);
+  }
+  for (i = 0; i < n_fragments; i++)
+    g_string_append_printf (manifest, "<c n=\"%u\" d=\"20000000\" />", i);
+  g_string_append (manifest, "</StreamIndex></SmoothStreamingMedia>");
+  return g_string_free (manifest, FALSE);
+}
+
+static guint64
+gst_mssdemux_simulation_match_uri (const gchar * uri, guint n_fragments)
+{
+  guint64 start_time;
+  guint bitrate;
+
+  if (sscanf (uri, "http://unit.test/QualityLevels(%u)/Fragments(video=%"
+          G_GUINT64_FORMAT ")", &bitrate, &start_time) == 2
+      && start_time < n_fragments * (guint64) 20000000)
+    return bitrate;
+  return 0;
+}
+
+/*
+ * Test the bitrate adaptation algorithms
+ * Plays a manifest with three quality levels over a simulated network whose
+ * bandwidth drops below the lowest quality level and recovers, and
+ * checks that every algorithm plays it completely, and reproducibly when
+ * based on the download statistics.
+ */
+GST_START_TEST (testAbrSimulation)
+{
+  gst_adaptive_demux_test_abr_simulation (DEMUX_ELEMENT_NAME,
+      "http://unit.test/Manifest", gst_mssdemux_simulation_manifest,
+      gst_mssdemux_simulation_match_uri, NULL, 0);
+}
+
+GST_END_TEST;
+
+#define LIVE_MANIFEST_FORMAT \
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>" \
+    "<SmoothStreamingMedia MajorVersion=\"2\" MinorVersion=\"0\"" \
+    " Duration=\"0\" IsLive=\"TRUE\">" \
+    "<StreamIndex Type=\"video\" QualityLevels=\"1\"" \
+    " Url=\"QualityLevels({bitrate})/Fragments(video={start time})\">" \
+    "<QualityLevel Index=\"0\" Bitrate=\"500000\" FourCC=\"H264\"" \
+    " MaxWidth=\"1024\" MaxHeight=\"436\" CodecPrivateData=\"000\" />" \
+    "%s</StreamIndex></SmoothStreamingMedia>"
+
+/* 2 seconds in the default timescale of 100ns */
+#define FRAGMENT_DURATION 20000000
+
+static GstBuffer *
+live_manifest_buffer (const gchar * fragments)
+{
+  gchar *manifest = g_strdup_printf (LIVE_MANIFEST_FORMAT, fragments);
+
+  return gst_buffer_new_wrapped (manifest, strlen (manifest));
+}
+
+/* A live manifest with a single video stream made of @fragments */
+static GstMssManifest *
+load_live_manifest (const gchar * fragments, GstMssStream ** stream)
+{
+  GstMssManifest *manifest;
+  GstBuffer *buf = live_manifest_buffer (fragments);
+
+  manifest = gst_mss_manifest_new (buf);
+  gst_buffer_unref (buf);
+  fail_unless (manifest != NULL);
+  fail_unless (gst_mss_manifest_is_live (manifest));
+
+  *stream = gst_mss_manifest_get_streams (manifest)->data;
+  gst_mss_stream_set_active (*stream, TRUE);
+  return manifest;
+}
+
+static void
+reload_live_manifest (GstMssManifest * manifest, const gchar * fragments)
+{
+  GstBuffer *buf = live_manifest_buffer (fragments);
+
+  gst_mss_manifest_reload_fragments (manifest, buf);
+  gst_buffer_unref (buf);
+}
+
+/* @expected lists the time, duration and repetitions of each run */
+static void
+check_fragment_runs (GstMssStream * stream, const guint64 * expected, guint n)
+{
+  guint i;
+
+  fail_unless_equals_int (stream->fragments->len, n);
+  for (i = 0; i < n; i++) {
+    GstMssStreamFragment *fragment = &g_array_index (stream->fragments,
+        GstMssStreamFragment, i);
+
+    fail_unless_equals_uint64 (fragment->time, expected[i * 3]);
+    fail_unless_equals_uint64 (fragment->duration, expected[i * 3 + 1]);
+    fail_unless_equals_int (fragment->repetitions, expected[i * 3 + 2]);
+  }
+}
+
+/*
+ * Test merging a live manifest whose last run has more repetitions: the
+ * new ones extend the known run, the others are appended
+ */
+GST_START_TEST (testMergeRepetitions)
+{
+  static const guint64 extended[] = { 0, FRAGMENT_DURATION, 5 };
+  static const guint64 appended[] = {
+    0, FRAGMENT_DURATION, 6,
+    6 * FRAGMENT_DURATION, FRAGMENT_DURATION / 2, 2
+  };
+  GstMssManifest *manifest;
+  GstMssStream *stream;
+
+  manifest = load_live_manifest ("<c t=\"0\" d=\"20000000\" r=\"3\" />",
+      &stream);
+  gst_mss_stream_advance_fragment (stream);
+
+  reload_live_manifest (manifest, "<c t=\"0\" d=\"20000000\" r=\"5\" />");
+  check_fragment_runs (stream, extended, 1);
+
+  reload_live_manifest (manifest, "<c t=\"0\" d=\"20000000\" r=\"6\" />"
+      "<c d=\"10000000\" r=\"2\" />");
+  check_fragment_runs (stream, appended, 2);
+
+  /* the position didn't change */
+  fail_unless_equals_uint64 (gst_mss_stream_get_fragment_gst_timestamp
+      (stream), 2 * GST_SECOND);
+
+  gst_mss_manifest_free (manifest);
+}
+
+GST_END_TEST;
+
+/*
+ * Test merging a live manifest where the newest fragment, whose duration
+ * wasn't known, is now complete
+ */
+GST_START_TEST (testMergeLastFragment)
+{
+  static const guint64 initial[] = {
+    0, FRAGMENT_DURATION, 1,
+    FRAGMENT_DURATION, 0, 1
+  };
+  static const guint64 merged[] = {
+    0, FRAGMENT_DURATION, 1,
+    FRAGMENT_DURATION, FRAGMENT_DURATION, 1,
+    2 * FRAGMENT_DURATION, 0, 1
+  };
+  GstMssManifest *manifest;
+  GstMssStream *stream;
+
+  manifest = load_live_manifest ("<c t=\"0\" d=\"20000000\" />"
+      "<c t=\"20000000\" />", &stream);
+  check_fragment_runs (stream, initial, 2);
+
+  reload_live_manifest (manifest, "<c t=\"0\" d=\"20000000\" />"
+      "<c t=\"20000000\" d=\"20000000\" /><c t=\"40000000\" />");
+  check_fragment_runs (stream, merged, 3);
+
+  gst_mss_manifest_free (manifest);
+}
+
+GST_END_TEST;
+
+/*
+ * Test that the fragments before the current one are dropped once they
+ * left the live window, and that the current one is kept
+ */
+GST_START_TEST (testMergeDropOldFragments)
+{
+  static const guint64 merged[] = {
+    2 * FRAGMENT_DURATION, FRAGMENT_DURATION, 1,
+    3 * FRAGMENT_DURATION, FRAGMENT_DURATION, 1,
+    4 * FRAGMENT_DURATION, FRAGMENT_DURATION, 1
+  };
+  GstMssManifest *manifest;
+  GstMssStream *stream;
+
+  manifest = load_live_manifest ("<c t=\"0\" d=\"20000000\" />"
+      "<c d=\"20000000\" /><c d=\"20000000\" />", &stream);
+  gst_mss_stream_advance_fragment (stream);
+  gst_mss_stream_advance_fragment (stream);
+  fail_unless_equals_int (stream->current_fragment, 2);
+
+  /* the window moved past the current fragment, which stays */
+  reload_live_manifest (manifest, "<c t=\"60000000\" d=\"20000000\" />"
+      "<c d=\"20000000\" />");
+  check_fragment_runs (stream, merged, 3);
+  fail_unless_equals_int (stream->current_fragment, 0);
+  fail_unless_equals_uint64 (gst_mss_stream_get_fragment_gst_timestamp
+      (stream), 4 * GST_SECOND);
+
+  gst_mss_manifest_free (manifest);
+}
+
+GST_END_TEST;
+
+/*
+ * Test that fragments whose timestamps restarted below the known ones
+ * replace them
+ */
+GST_START_TEST (testMergeRestartedTimestamps)
+{
+  static const guint64 merged[] = { 0, FRAGMENT_DURATION, 2 };
+  GstMssManifest *manifest;
+  GstMssStream *stream;
+
+  manifest = load_live_manifest ("<c t=\"1000000000\" d=\"20000000\""
+      " r=\"3\" />", &stream);
+  gst_mss_stream_advance_fragment (stream);
+
+  reload_live_manifest (manifest, "<c t=\"0\" d=\"20000000\" r=\"2\" />");
+  check_fragment_runs (stream, merged, 1);
+  fail_unless_equals_int (stream->current_fragment, 0);
+  fail_unless_equals_uint64 (gst_mss_stream_get_fragment_gst_timestamp
+      (stream), 0);
+
+  gst_mss_manifest_free (manifest);
+}
+
+GST_END_TEST;
+
+/*
+ * Test seeking in a live window that starts at 4 seconds and ends at 10
+ */
+GST_START_TEST (testSeekLiveWindow)
+{
+  GstMssManifest *manifest;
+  GstMssStream *stream;
+  guint64 final_time;
+
+  manifest = load_live_manifest ("<c t=\"40000000\" d=\"20000000\""
+      " r=\"3\" />", &stream);
+
+  /* before the window: its first fragment */
+  gst_mss_stream_seek (stream, TRUE, 0, 1 * GST_SECOND, &final_time);
+  fail_unless_equals_uint64 (final_time, 4 * GST_SECOND);
+  fail_unless_equals_uint64 (gst_mss_stream_get_fragment_gst_timestamp
+      (stream), 4 * GST_SECOND);
+
+  /* inside the window: the fragment containing the position, or the next
+   * one when snapping after */
+  gst_mss_stream_seek (stream, TRUE, 0, 7 * GST_SECOND, &final_time);
+  fail_unless_equals_uint64 (final_time, 6 * GST_SECOND);
+  fail_unless_equals_uint64 (gst_mss_stream_get_fragment_gst_timestamp
+      (stream), 6 * GST_SECOND);
+  gst_mss_stream_seek (stream, TRUE, GST_SEEK_FLAG_SNAP_AFTER,
+      7 * GST_SECOND, &final_time);
+  fail_unless_equals_uint64 (final_time, 8 * GST_SECOND);
+
+  /* after the window: nothing left until the next update */
+  gst_mss_stream_seek (stream, TRUE, 0, 12 * GST_SECOND, &final_time);
+  fail_unless_equals_uint64 (final_time, 10 * GST_SECOND);
+  fail_if (gst_mss_stream_has_next_fragment (stream));
+
+  gst_mss_manifest_free (manifest);
+}
+
+GST_END_TEST;
+
 static Suite *
 mss_demux_suite (void)
 {
   Suite *s = suite_create ("mss_demux");
   TCase *tc_basicTest = tcase_create ("basicTest");
 
+  GST_DEBUG_CATEGORY_INIT (mssdemux_debug, "mssdemux_debug", 0,
+      "mssdemux tests");
+
   tcase_add_test (tc_basicTest, simpleTest);
   tcase_add_test (tc_basicTest, testSeek);
   tcase_add_test (tc_basicTest, testSeekKeyUnitPosition);
@@ -620,6 +909,12 @@ mss_demux_suite (void)
   tcase_add_test (tc_basicTest, testDownloadError);
   tcase_add_test (tc_basicTest, testFragmentDownloadError);
   tcase_add_test (tc_basicTest, testQuery);
+  tcase_add_test (tc_basicTest, testAbrSimulation);
+  tcase_add_test (tc_basicTest, testMergeRepetitions);
+  tcase_add_test (tc_basicTest, testMergeLastFragment);
+  tcase_add_test (tc_basicTest, testMergeDropOldFragments);
+  tcase_add_test (tc_basicTest, testMergeRestartedTimestamps);
+  tcase_add_test (tc_basicTest, testSeekLiveWindow);
 
   tcase_add_unchecked_fixture (tc_basicTest, gst_adaptive_demux_test_setup,
       gst_adaptive_demux_test_teardown);
@@ -24,6 +24,8 @@
 #include "config.h"
 #endif
 
+#include "../../sys/shm/shmalloc.c"
+
 #include <gst/gst.h>
 #include <gst/check/gstcheck.h>
 
@@ -42,7 +44,7 @@ GstElement *src, *sink;
 GstPad *sinkpad, *srcpad;
 
 static void
-setup_shm (void)
+setup_shm_with_rings (gboolean use_rings)
 {
   gchar *socket_path = NULL;
 
@@ -52,7 +54,8 @@ setup_shm (void)
   srcpad = gst_check_setup_src_pad (sink, &src_template);
   sinkpad = gst_check_setup_sink_pad (src, &sink_template);
 
-  g_object_set (sink, "socket-path", "shm-unit-test", NULL);
+  g_object_set (sink, "socket-path", "shm-unit-test", "use-rings", use_rings,
+      NULL);
 
   fail_unless (gst_element_set_state (sink, GST_STATE_PLAYING) ==
       GST_STATE_CHANGE_ASYNC);
@@ -69,6 +72,18 @@ setup_shm (void)
       GST_STATE_CHANGE_SUCCESS);
 }
 
+static void
+setup_shm (void)
+{
+  setup_shm_with_rings (FALSE);
+}
+
+static void
+setup_shm_rings (void)
+{
+  setup_shm_with_rings (TRUE);
+}
+
 static void
 teardown_shm (void)
 {
@@ -169,6 +184,157 @@ GST_START_TEST (test_shm_alloc)
 
 GST_END_TEST;
 
+/* more buffers than a client can hold in the rings, so they must be acked
+ * for the sink to keep sending them */
+GST_START_TEST (test_shm_rings)
+{
+  GstBuffer *buf;
+  GstSegment segment;
+  GstMapInfo map;
+  guint i;
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  for (i = 0; i < 300; i++) {
+    buf = gst_buffer_new_allocate (NULL, 1000, NULL);
+    gst_buffer_memset (buf, 0, i & 0xff, 1000);
+    fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+
+    g_mutex_lock (&check_mutex);
+    while (buffers == NULL)
+      g_cond_wait (&check_cond, &check_mutex);
+    g_mutex_unlock (&check_mutex);
+    fail_unless (g_list_length (buffers) == 1);
+
+    buf = buffers->data;
+    fail_unless (gst_buffer_get_size (buf) == 1000);
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless (map.data[0] == (i & 0xff));
+    fail_unless (map.data[999] == (i & 0xff));
+    gst_buffer_unmap (buf, &map);
+
+    gst_check_drop_buffers ();
+  }
+
+  teardown_shm ();
+}
+
+GST_END_TEST;
+
+/* a reader that keeps all the buffers fills its ring, the next buffers
+ * must reach it through the socket, in order, instead of being dropped */
+GST_START_TEST (test_shm_rings_full)
+{
+  GstBuffer *buf;
+  GstSegment segment;
+  GstMapInfo map;
+  GList *l;
+  guint i;
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  for (i = 0; i < 300; i++) {
+    buf = gst_buffer_new_allocate (NULL, 1000, NULL);
+    gst_buffer_memset (buf, 0, i & 0xff, 1000);
+    fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+  }
+
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < 300)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    buf = l->data;
+    fail_unless (gst_buffer_get_size (buf) == 1000);
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless (map.data[0] == (i & 0xff));
+    gst_buffer_unmap (buf, &map);
+  }
+  assert_equals_int (i, 300);
+
+  /* once everything is released, the buffers go through the ring again */
+  gst_check_drop_buffers ();
+  buf = gst_buffer_new_allocate (NULL, 1000, NULL);
+  gst_buffer_memset (buf, 0, 42, 1000);
+  fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+
+  g_mutex_lock (&check_mutex);
+  while (buffers == NULL)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+  buf = buffers->data;
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  fail_unless (map.data[0] == 42);
+  gst_buffer_unmap (buf, &map);
+
+  gst_check_drop_buffers ();
+  teardown_shm ();
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_shm_alloc_space)
+{
+  ShmAllocSpace *space = shm_alloc_space_new (1000);
+  ShmAllocBlock *blocks[10];
+  ShmAllocBlock *block;
+  guint i;
+
+  for (i = 0; i < 10; i++) {
+    blocks[i] = shm_alloc_space_alloc_block (space, 100);
+    fail_unless (blocks[i] != NULL);
+    assert_equals_int (shm_alloc_space_alloc_block_get_offset (blocks[i]),
+        i * 100);
+  }
+  fail_unless (shm_alloc_space_alloc_block (space, 1) == NULL);
+  assert_equals_int (shm_alloc_space_get_free_size (space), 0);
+
+  fail_unless (shm_alloc_space_block_get (space, 0) == blocks[0]);
+  fail_unless (shm_alloc_space_block_get (space, 450) == blocks[4]);
+  fail_unless (shm_alloc_space_block_get (space, 999) == blocks[9]);
+  fail_unless (shm_alloc_space_block_get (space, 1000) == NULL);
+
+  /* free every other block, the free space is split in 5 holes */
+  for (i = 0; i < 10; i += 2)
+    shm_alloc_space_block_dec (blocks[i]);
+  fail_unless (shm_alloc_space_block_get (space, 450) == NULL);
+  assert_equals_int (shm_alloc_space_get_free_size (space), 500);
+  assert_equals_int (shm_alloc_space_get_largest_free_block (space), 100);
+  fail_unless (shm_alloc_space_alloc_block (space, 101) == NULL);
+
+  /* a block keeps its space as long as it is referenced */
+  shm_alloc_space_block_inc (blocks[3]);
+  shm_alloc_space_block_dec (blocks[3]);
+  fail_unless (shm_alloc_space_block_get (space, 350) == blocks[3]);
+
+  /* freeing a block merges it with the free blocks around it */
+  shm_alloc_space_block_dec (blocks[3]);
+  assert_equals_int (shm_alloc_space_get_largest_free_block (space), 300);
+  block = shm_alloc_space_alloc_block (space, 250);
+  fail_unless (block != NULL);
+  assert_equals_int (shm_alloc_space_alloc_block_get_offset (block), 200);
+  fail_unless (shm_alloc_space_block_get (space, 449) == block);
+  assert_equals_int (shm_alloc_space_get_free_size (space), 350);
+  assert_equals_int (shm_alloc_space_get_largest_free_block (space), 100);
+
+  shm_alloc_space_block_dec (block);
+  for (i = 1; i < 10; i += 2) {
+    if (i != 3)
+      shm_alloc_space_block_dec (blocks[i]);
+  }
+  assert_equals_int (shm_alloc_space_get_free_size (space), 1000);
+  assert_equals_int (shm_alloc_space_get_largest_free_block (space), 1000);
+
+  shm_alloc_space_free (space);
+}
+
+GST_END_TEST;
+
 static Suite *
 shm_suite (void)
 {
@@ -181,6 +347,16 @@ shm_suite (void)
   tcase_add_test (tc, test_shm_alloc);
   suite_add_tcase (s, tc);
 
+  tc = tcase_create ("shm-rings");
+  tcase_add_checked_fixture (tc, setup_shm_rings, NULL);
+  tcase_add_test (tc, test_shm_rings);
+  tcase_add_test (tc, test_shm_rings_full);
+  suite_add_tcase (s, tc);
+
+  tc = tcase_create ("shmalloc");
+  tcase_add_test (tc, test_shm_alloc_space);
+  suite_add_tcase (s, tc);
+
   return s;
 }
 
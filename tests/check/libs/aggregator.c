@@ -701,6 +701,179 @@ GST_START_TEST (test_timeout_pipeline_with_wait)
 
 GST_END_TEST;
 
+GST_START_TEST (test_adaptive_latency_pipeline)
+{
+  GstBus *bus;
+  GstMessage *msg;
+  GstElement *pipeline, *src, *src1, *agg, *sink;
+  gboolean got_stats = FALSE;
+
+  gint count = 0;
+
+  pipeline = gst_pipeline_new ("pipeline");
+  src = gst_element_factory_make ("fakesrc", NULL);
+  g_object_set (src, "num-buffers", TIMEOUT_NUM_BUFFERS, "sizetype", 2,
+      "sizemax", 4, "is-live", TRUE, "datarate", 4000, NULL);
+
+  src1 = gst_element_factory_make ("fakesrc", NULL);
+  g_object_set (src1, "num-buffers", TIMEOUT_NUM_BUFFERS, "sizetype", 2,
+      "sizemax", 4, "is-live", TRUE, "datarate", 4000, NULL);
+
+  agg = gst_check_setup_element ("testaggregator");
+  g_object_set (agg, "latency", 50 * GST_MSECOND, "adaptive-latency", TRUE,
+      "adaptive-latency-min", GST_MSECOND, NULL);
+  sink = gst_check_setup_element ("fakesink");
+  g_object_set (sink, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", (GCallback) handoff, &count);
+
+  fail_unless (gst_bin_add (GST_BIN (pipeline), src));
+  fail_unless (gst_bin_add (GST_BIN (pipeline), src1));
+  fail_unless (gst_bin_add (GST_BIN (pipeline), agg));
+  fail_unless (gst_bin_add (GST_BIN (pipeline), sink));
+  fail_unless (gst_element_link (src, agg));
+  fail_unless (gst_element_link (src1, agg));
+  fail_unless (gst_element_link (agg, sink));
+
+  bus = gst_element_get_bus (pipeline);
+  fail_if (bus == NULL);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  while ((msg = gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR |
+              GST_MESSAGE_ELEMENT, -1))) {
+    const GstStructure *s;
+    guint64 latency;
+
+    if (GST_MESSAGE_TYPE (msg) != GST_MESSAGE_ELEMENT)
+      break;
+
+    s = gst_message_get_structure (msg);
+    if (GST_MESSAGE_SRC (msg) == GST_OBJECT (agg)
+        && gst_structure_has_name (s, "GstAggregatorLatency")) {
+      /* the latency always stays within the configured bounds */
+      fail_unless (gst_structure_get_uint64 (s, "latency", &latency));
+      fail_unless (latency >= GST_MSECOND);
+      fail_unless (latency <= 50 * GST_MSECOND);
+      fail_unless_equals_int (gst_value_array_get_size
+          (gst_structure_get_value (s, "pads")), 2);
+      got_stats = TRUE;
+    }
+    gst_message_unref (msg);
+  }
+  fail_if (GST_MESSAGE_TYPE (msg) != GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  fail_unless (got_stats);
+  fail_if (count < TIMEOUT_NUM_BUFFERS);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static GstPadProbeReturn
+_jitter_probe_cb (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  gint *jitter = user_data;
+  static guint n = 0;
+
+  /* hold back every fourth buffer, the following ones catch up */
+  if (g_atomic_int_get (jitter) && (n++ % 4) == 0)
+    g_usleep (40 * G_TIME_SPAN_MILLISECOND);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Waits for the next latency report of @agg within or outside of the
+ * given bound */
+static GstClockTime
+_wait_adaptive_latency (GstBus * bus, GstElement * agg, GstClockTime bound,
+    gboolean above)
+{
+  GstMessage *msg;
+
+  while ((msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+              GST_MESSAGE_EOS | GST_MESSAGE_ERROR | GST_MESSAGE_ELEMENT))) {
+    const GstStructure *s;
+    guint64 latency;
+
+    fail_unless (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ELEMENT);
+
+    s = gst_message_get_structure (msg);
+    if (GST_MESSAGE_SRC (msg) == GST_OBJECT (agg)
+        && gst_structure_has_name (s, "GstAggregatorLatency")) {
+      fail_unless (gst_structure_get_uint64 (s, "latency", &latency));
+      if (above ? latency >= bound : latency <= bound) {
+        gst_message_unref (msg);
+        return latency;
+      }
+    }
+    gst_message_unref (msg);
+  }
+
+  fail ("No latency %s %" GST_TIME_FORMAT " reported",
+      above ? "above" : "below", GST_TIME_ARGS (bound));
+  return GST_CLOCK_TIME_NONE;
+}
+
+/* The latency first shrinks with steady input, grows as soon as one pad
+ * gets jittery and shrinks back once the input is steady for longer than
+ * the hold time again */
+GST_START_TEST (test_adaptive_latency_jitter)
+{
+  GstBus *bus;
+  GstElement *pipeline, *src, *src1, *agg, *sink;
+  GstPad *src1pad;
+  gint jitter = 0;
+
+  pipeline = gst_pipeline_new ("pipeline");
+
+  /* 5ms buffers, pushed in time */
+  src = gst_element_factory_make ("fakesrc", NULL);
+  g_object_set (src, "sizetype", 2, "sizemax", 4, "is-live", TRUE,
+      "datarate", 800, "sync", TRUE, NULL);
+  src1 = gst_element_factory_make ("fakesrc", NULL);
+  g_object_set (src1, "sizetype", 2, "sizemax", 4, "is-live", TRUE,
+      "datarate", 800, "sync", TRUE, NULL);
+
+  agg = gst_check_setup_element ("testaggregator");
+  g_object_set (agg, "latency", 100 * GST_MSECOND, "adaptive-latency", TRUE,
+      "adaptive-latency-min", GST_MSECOND, NULL);
+  sink = gst_check_setup_element ("fakesink");
+
+  fail_unless (gst_bin_add (GST_BIN (pipeline), src));
+  fail_unless (gst_bin_add (GST_BIN (pipeline), src1));
+  fail_unless (gst_bin_add (GST_BIN (pipeline), agg));
+  fail_unless (gst_bin_add (GST_BIN (pipeline), sink));
+  fail_unless (gst_element_link (src, agg));
+  fail_unless (gst_element_link (src1, agg));
+  fail_unless (gst_element_link (agg, sink));
+
+  src1pad = gst_element_get_static_pad (src1, "src");
+  gst_pad_add_probe (src1pad, GST_PAD_PROBE_TYPE_BUFFER,
+      (GstPadProbeCallback) _jitter_probe_cb, &jitter, NULL);
+
+  bus = gst_element_get_bus (pipeline);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  /* starting from the configured latency */
+  _wait_adaptive_latency (bus, agg, 10 * GST_MSECOND, FALSE);
+
+  g_atomic_int_set (&jitter, 1);
+  _wait_adaptive_latency (bus, agg, 20 * GST_MSECOND, TRUE);
+
+  g_atomic_int_set (&jitter, 0);
+  _wait_adaptive_latency (bus, agg, 10 * GST_MSECOND, FALSE);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (src1pad);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_flushing_seek)
 {
   GstEvent *event;
@@ -1187,6 +1360,8 @@ gst_aggregator_suite (void)
   tcase_add_test (general, test_two_src_pipeline);
   tcase_add_test (general, test_timeout_pipeline);
   tcase_add_test (general, test_timeout_pipeline_with_wait);
+  tcase_add_test (general, test_adaptive_latency_pipeline);
+  tcase_add_test (general, test_adaptive_latency_jitter);
   tcase_add_test (general, test_add_remove);
   tcase_add_test (general, test_change_state_intensive);
 